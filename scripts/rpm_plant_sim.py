@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+RPM Closed-Loop Trace Plotter
+繪製閉迴路轉速控制 (MOTOR RPM) 的主機端模擬軌跡
+
+模擬本身是主機端單元測試 test/test_rpm_controller：它直接編譯韌體的
+src/RPMController.cpp 與 src/RPMFilter.cpp，接上一階風扇模型與多週期
+轉速計取樣，所以控制器只有一份實作。設定環境變數 RPM_SIM_CSV 時，
+測試會把步階響應（2000 → 3000 → 1000 RPM）寫成 CSV：
+
+    RPM_SIM_CSV=trace.csv pio test -e native -f test_rpm_controller
+
+本腳本只負責讀取該 CSV，列出每段目標的上升時間、超越量與穩定時間並繪圖。
+調參時修改測試中的 SimConfig（Kp/Ki/Kd、迴路頻率、slew、RPM_PERIODS/GATE）
+後重新執行即可。
+
+使用方式：
+    python rpm_plant_sim.py trace.csv
+    python rpm_plant_sim.py trace.csv --no-plot   # 只列出數據
+
+模擬結果可直接套用到裝置：
+    MOTOR PID <kp> <ki> <kd>
+    MOTOR LOOP <Hz>
+    MOTOR SLEW <%/s>
+"""
+
+import argparse
+import csv
+import sys
+from typing import List, Tuple
+
+Row = Tuple[float, float, float, float, float]   # t, target, rpm, measured, duty
+
+
+def load(path: str) -> List[Row]:
+    with open(path, newline="") as f:
+        reader = csv.DictReader(f)
+        return [(float(r["t"]), float(r["target"]), float(r["rpm"]),
+                 float(r["measured"]), float(r["duty"])) for r in reader]
+
+
+def segments(trace: List[Row]) -> List[List[Row]]:
+    """依目標值切段"""
+    result: List[List[Row]] = []
+    for row in trace:
+        if not result or result[-1][-1][1] != row[1]:
+            result.append([])
+        result[-1].append(row)
+    return result
+
+
+def analyse(segment: List[Row], start_rpm: float) -> dict:
+    """上升時間 (10-90%)、超越量與穩定時間 (±2%)"""
+    t0 = segment[0][0]
+    target = segment[0][1]
+    span = target - start_rpm
+    rising = span >= 0
+    lo = start_rpm + 0.1 * span
+    hi = start_rpm + 0.9 * span
+
+    def reached(rpm: float, level: float) -> bool:
+        return rpm >= level if rising else rpm <= level
+
+    t10 = next((t for t, _, rpm, _, _ in segment if reached(rpm, lo)), None)
+    t90 = next((t for t, _, rpm, _, _ in segment if reached(rpm, hi)), None)
+    peak = max(r[2] for r in segment) if rising else min(r[2] for r in segment)
+    over = (peak - target) if rising else (target - peak)
+    settle = t0
+    for t, _, rpm, _, _ in segment:
+        if abs(rpm - target) > 0.02 * target:
+            settle = t
+    return {
+        "target": target,
+        "rise_s": (t90 - t10) if t10 is not None and t90 is not None else float("nan"),
+        "overshoot_pct": max(0.0, over) / abs(span) * 100.0 if span else 0.0,
+        "settle_s": settle - t0,
+        "final_error": target - segment[-1][2],
+    }
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Plot a MOTOR RPM closed-loop simulation trace")
+    parser.add_argument("csv", help="trace written by test_rpm_controller (RPM_SIM_CSV)")
+    parser.add_argument("--no-plot", action="store_true", help="print the step metrics only")
+    args = parser.parse_args()
+
+    trace = load(args.csv)
+    if not trace:
+        print("❌ Empty trace")
+        return 1
+
+    print(f"{'target':>8} {'rise s':>8} {'over %':>8} {'settle s':>9} {'final RPM':>10}")
+    start_rpm = trace[0][2]
+    for segment in segments(trace):
+        m = analyse(segment, start_rpm)
+        print(f"{m['target']:8.0f} {m['rise_s']:8.3f} {m['overshoot_pct']:8.1f} "
+              f"{m['settle_s']:9.3f} {m['final_error']:10.1f}")
+        start_rpm = segment[-1][2]
+
+    if args.no_plot:
+        return 0
+
+    try:
+        import matplotlib.pyplot as plt
+    except ImportError:
+        print("matplotlib not installed: pip install matplotlib")
+        return 1
+
+    t = [row[0] for row in trace]
+    fig, (ax1, ax2) = plt.subplots(2, 1, sharex=True)
+    ax1.plot(t, [row[1] for row in trace], "--", label="target")
+    ax1.plot(t, [row[2] for row in trace], label="rpm")
+    ax1.plot(t, [row[3] for row in trace], alpha=0.6, label="measured")
+    ax1.set_ylabel("RPM")
+    ax1.legend()
+    ax2.plot(t, [row[4] for row in trace], color="tab:red")
+    ax2.set_ylabel("duty %")
+    ax2.set_xlabel("s")
+    plt.show()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -7,6 +7,7 @@
 #include "StatusLED.h"
 #include "WiFiManager.h"
 #include "WebServer.h"
+#include "WebRequestBody.h"
 #include "freertos/FreeRTOS.h"
 #include "soc/mcpwm_struct.h"  // For direct MCPWM register access
 #include "freertos/semphr.h"
@@ -124,58 +125,151 @@ bool CommandParser::processCommand(const String& cmd, ICommandResponse* response
         return true;
     }
 
-    // 濾波器狀態 - REMOVED IN v3.0 (filtering not available)
-    // if (upper == "FILTER STATUS") {
-    //     handleFilterStatus(response);
-    //     return true;
-    // }
-
-    // RAMP 命令 - REMOVED IN v3.0 (ramping not available)
-    // if (upper.startsWith("RAMP ")) {
-    //     String params = upper.substring(5);  // Remove "RAMP "
-    //     params.trim();
-    //
-    //     // Parse: PARAMETER VALUE TIME
-    //     int firstSpace = params.indexOf(' ');
-    //     if (firstSpace == -1) {
-    //         response->println("❌ 錯誤：格式應為 RAMP <parameter> <value> <time_ms>");
-    //         return true;
-    //     }
-    //
-    //     String parameter = params.substring(0, firstSpace);
-    //     parameter.trim();
-    //
-    //     String rest = params.substring(firstSpace + 1);
-    //     rest.trim();
-    //
-    //     int secondSpace = rest.indexOf(' ');
-    //     if (secondSpace == -1) {
-    //         response->println("❌ 錯誤：格式應為 RAMP <parameter> <value> <time_ms>");
-    //         return true;
-    //     }
-    //
-    //     String value = rest.substring(0, secondSpace);
-    //     value.trim();
-    //
-    //     String timeStr = rest.substring(secondSpace + 1);
-    //     timeStr.trim();
-    //     uint32_t rampTimeMs = timeStr.toInt();
-    //
-    //     if (parameter == "PWM_FREQ") {
-    //         uint32_t freq = value.toInt();
-    //         handleSetPWMFreqRamped(response, freq, rampTimeMs);
-    //         return true;
-    //     }
-    //
-    //     if (parameter == "PWM_DUTY") {
-    //         float duty = value.toFloat();
-    //         handleSetPWMDutyRamped(response, duty, rampTimeMs);
-    //         return true;
-    //     }
-    //
-    //     response->println("❌ 錯誤：不支援的 RAMP 參數（支援: PWM_FREQ, PWM_DUTY）");
-    //     return true;
-    // }
+    // RPM 濾波器狀態
+    if (upper == "FILTER STATUS") {
+        handleFilterStatus(response);
+        return true;
+    }
+
+    // 清除 RPM 濾波器統計
+    if (upper == "FILTER RESET") {
+        handleFilterReset(response);
+        return true;
+    }
+
+    // 失速偵測狀態
+    if (upper == "STALL STATUS") {
+        handleStallStatus(response);
+        return true;
+    }
+
+    if (upper == "STALL RESET") {
+        peripheralManager.getUART1().resetStallStats();
+        response->println("✅ 失速統計已清除");
+        return true;
+    }
+
+    // 脈寬 / 占空比量測
+    if (upper == "PULSE STATUS" || upper == "PULSE") {
+        handlePulseStatus(response);
+        return true;
+    }
+
+    if (upper == "PULSE RESET") {
+        peripheralManager.getUART1().resetPulseStatistics();
+        response->println("✅ 脈寬統計已清除");
+        return true;
+    }
+
+    if (upper.startsWith("PULSE ")) {
+        handlePulse(upper, response);
+        return true;
+    }
+
+    // 邏輯分析擷取
+    if (upper == "CAPTURE STATUS" || upper == "CAPTURE") {
+        handleCaptureStatus(response);
+        return true;
+    }
+
+    if (upper == "CAPTURE STOP") {
+        auto& capture = peripheralManager.getLogicCapture();
+        if (!capture.isRunning()) {
+            response->println("ℹ️ 目前沒有進行中的擷取");
+        } else {
+            capture.stop();
+            response->println("✅ 已要求停止擷取，保留已擷取的邊緣");
+        }
+        return true;
+    }
+
+    if (upper == "CAPTURE DUMP" || upper.startsWith("CAPTURE DUMP ")) {
+        handleCaptureDump(upper, response, source);
+        return true;
+    }
+
+    if (upper.startsWith("CAPTURE START ")) {
+        handleCaptureStart(upper, response);
+        return true;
+    }
+
+    if (upper.startsWith("CAPTURE TRIGGER ")) {
+        handleCaptureTrigger(upper, response);
+        return true;
+    }
+
+    if (upper.startsWith("CAPTURE PRE ")) {
+        handleCapturePre(upper, response);
+        return true;
+    }
+
+    // RAMP 命令（硬體計時漸變）
+    if (upper == "RAMP STATUS") {
+        handleRampStatus(response);
+        return true;
+    }
+
+    if (upper == "RAMP STOP") {
+        handleRampStop(response);
+        return true;
+    }
+
+    if (upper.startsWith("RAMP ")) {
+        handleRamp(upper, response);
+        return true;
+    }
+
+    // SEQ 命令（波形序列播放）
+    if (upper == "SEQ STATUS") {
+        handleSequenceStatus(response);
+        return true;
+    }
+
+    if (upper == "SEQ STOP") {
+        handleSequenceStop(response);
+        return true;
+    }
+
+    if (upper == "SEQ PLAY" || upper.startsWith("SEQ PLAY ")) {
+        handleSequencePlay(upper, response);
+        return true;
+    }
+
+    if (upper == "SEQ RESULT" || upper.startsWith("SEQ RESULT ")) {
+        handleSequenceResult(upper, response);
+        return true;
+    }
+
+    if (upper.startsWith("SEQ ")) {
+        handleSequence(upper, response);
+        return true;
+    }
+
+    // CHARACTERIZE 命令（風扇特性量測）
+    if (upper == "CHARACTERIZE STATUS") {
+        handleCharacterizeStatus(response);
+        return true;
+    }
+
+    if (upper == "CHARACTERIZE STOP") {
+        handleCharacterizeStop(response);
+        return true;
+    }
+
+    if (upper == "CHARACTERIZE RESULT") {
+        handleCharacterizeResult(response);
+        return true;
+    }
+
+    if (upper == "CHARACTERIZE TRACE" || upper.startsWith("CHARACTERIZE TRACE ")) {
+        handleCharacterizeTrace(upper, response);
+        return true;
+    }
+
+    if (upper.startsWith("CHARACTERIZE ")) {
+        handleCharacterize(upper, response);
+        return true;
+    }
 
     // 馬達停止
     if (upper == "MOTOR STOP") {
@@ -189,6 +283,49 @@ bool CommandParser::processCommand(const String& cmd, ICommandResponse* response
         return true;
     }
 
+    // 閉迴路轉速控制
+    if (upper == "MOTOR RPM STATUS") {
+        handleMotorLoopStatus(response);
+        return true;
+    }
+
+    if (upper.startsWith("MOTOR RPM ")) {
+        handleMotorRPM(upper, response);
+        return true;
+    }
+
+    if (upper.startsWith("MOTOR PID ")) {
+        handleMotorPID(upper, response);
+        return true;
+    }
+
+    if (upper.startsWith("MOTOR LOOP ")) {
+        handleMotorLoopRate(upper, response);
+        return true;
+    }
+
+    if (upper.startsWith("MOTOR SLEW ")) {
+        handleMotorSlew(upper, response);
+        return true;
+    }
+
+    if (upper.startsWith("MOTOR FF ")) {
+        handleMotorFF(upper, response);
+        return true;
+    }
+
+    // 批次設定（單一 PWM 週期邊界生效）
+    if (upper == "BATCH" || upper.startsWith("BATCH ")) {
+        handleBatch(trimmed, response);
+        return true;
+    }
+
+    // 預設工作點（預先計算的暫存器映像，下一個 TEZ 生效）
+    if (upper == "PRESET" || upper.startsWith("PRESET ")) {
+        handlePreset(trimmed, response);
+        return true;
+    }
+
     // 儲存設定
     if (upper == "SAVE") {
         handleSaveSettings(response);
@@ -253,12 +390,59 @@ bool CommandParser::processCommand(const String& cmd, ICommandResponse* response
                 }
             }
 
-            // SET RPM_FILTER_SIZE <size> - REMOVED IN v3.0 (filtering not available)
-            // if (parameter == "RPM_FILTER_SIZE") {
-            //     uint8_t size = value.toInt();
-            //     handleSetRPMFilterSize(response, size);
-            //     return true;
-            // }
+            // SET RPM_FILTER <NONE|MEDIAN|EMA|WINDOW>
+            if (parameter == "RPM_FILTER") {
+                handleSetRPMFilter(response, value);
+                return true;
+            }
+
+            // SET RPM_FILTER_SIZE <size>
+            if (parameter == "RPM_FILTER_SIZE") {
+                handleSetRPMFilterSize(response, value.toInt());
+                return true;
+            }
+
+            // SET RPM_EMA_ALPHA <alpha>
+            if (parameter == "RPM_EMA_ALPHA") {
+                handleSetRPMEmaAlpha(response, value.toFloat());
+                return true;
+            }
+
+            // SET RPM_PERIODS <n>
+            if (parameter == "RPM_PERIODS") {
+                handleSetRPMPeriods(response, value.toInt());
+                return true;
+            }
+
+            // SET RPM_GATE <ms>
+            if (parameter == "RPM_GATE") {
+                handleSetRPMGate(response, value.toInt());
+                return true;
+            }
+
+            // SET RPM_OUTLIER <%>
+            if (parameter == "RPM_OUTLIER") {
+                handleSetRPMOutlier(response, value.toFloat());
+                return true;
+            }
+
+            // SET RPM_STALL <ON|OFF>
+            if (parameter == "RPM_STALL") {
+                handleSetRPMStall(response, value);
+                return true;
+            }
+
+            // SET RPM_STALL_PERIODS <n>
+            if (parameter == "RPM_STALL_PERIODS") {
+                handleSetRPMStallPeriods(response, value.toInt());
+                return true;
+            }
+
+            // SET RPM_STALL_ACTION <NONE|CUT,BEEP,NOTIFY>
+            if (parameter == "RPM_STALL_ACTION") {
+                handleSetRPMStallAction(response, value);
+                return true;
+            }
 
             // SET POLE_PAIRS <num>
             if (parameter == "POLE_PAIRS") {
@@ -338,6 +522,12 @@ bool CommandParser::processCommand(const String& cmd, ICommandResponse* response
         return true;
     }
 
+    // SSE 推播間隔: WEB SSE <ms>
+    if (upper.startsWith("WEB SSE ")) {
+        handleWebSSE(upper, response);
+        return true;
+    }
+
     // ========================================================================
     // Peripheral Commands
     // ========================================================================
@@ -363,6 +553,22 @@ bool CommandParser::processCommand(const String& cmd, ICommandResponse* response
         handleUART1Write(trimmed, response);
         return true;
     }
+    if (upper.startsWith("UART1 BENCH ")) {
+        handleUART1Bench(upper, response);
+        return true;
+    }
+    if (upper == "UART1 TXBENCH" || upper.startsWith("UART1 TXBENCH ")) {
+        handleUARTTxBench(upper, response, 1);
+        return true;
+    }
+    if (upper == "UART1 BERT STATUS") {
+        handleUARTBertStatus(response);
+        return true;
+    }
+    if (upper.startsWith("UART1 BERT ")) {
+        handleUARTBert(upper, response, 1);
+        return true;
+    }
 
     // UART2 Commands
     if (upper.startsWith("UART2 CONFIG ")) {
@@ -377,6 +583,112 @@ bool CommandParser::processCommand(const String& cmd, ICommandResponse* response
         handleUART2Write(trimmed, response);
         return true;
     }
+    if (upper.startsWith("UART2 FRAME ")) {
+        handleUART2Frame(trimmed, response);
+        return true;
+    }
+    if (upper == "UART2 READ" || upper.startsWith("UART2 READ ")) {
+        handleUART2Read(upper, response);
+        return true;
+    }
+    if (upper == "UART2 TXBENCH" || upper.startsWith("UART2 TXBENCH ")) {
+        handleUARTTxBench(upper, response, 2);
+        return true;
+    }
+    if (upper == "UART2 BERT STATUS") {
+        handleUARTBertStatus(response);
+        return true;
+    }
+    if (upper.startsWith("UART2 BERT ")) {
+        handleUARTBert(upper, response, 2);
+        return true;
+    }
+
+    // UART2 packet link
+    if (upper == "PKT START" || upper.startsWith("PKT START ")) {
+        handlePacketStart(upper, response);
+        return true;
+    }
+    if (upper == "PKT STOP") {
+        handlePacketStop(response);
+        return true;
+    }
+    if (upper.startsWith("PKT SEND ")) {
+        handlePacketSend(upper, response, false);
+        return true;
+    }
+    if (upper.startsWith("PKT XFER ")) {
+        handlePacketSend(upper, response, true);
+        return true;
+    }
+    if (upper == "PKT RECV" || upper.startsWith("PKT RECV ")) {
+        handlePacketRecv(upper, response);
+        return true;
+    }
+    if (upper.startsWith("PKT STREAM ")) {
+        handlePacketStream(upper, response);
+        return true;
+    }
+    if (upper == "PKT STATUS") {
+        handlePacketStatus(response);
+        return true;
+    }
+
+    // UART2 Modbus RTU server
+    if (upper.startsWith("MODBUS START ")) {
+        handleModbusStart(upper, response);
+        return true;
+    }
+    if (upper == "MODBUS STOP") {
+        handleModbusStop(response);
+        return true;
+    }
+    if (upper == "MODBUS STATUS") {
+        handleModbusStatus(response);
+        return true;
+    }
+
+    // UART traffic sniffer
+    if (upper.startsWith("SNIFF START ")) {
+        handleSnifferStart(upper, response);
+        return true;
+    }
+    if (upper == "SNIFF STOP") {
+        handleSnifferStop(response);
+        return true;
+    }
+    if (upper == "SNIFF STATUS") {
+        handleSnifferStatus(response);
+        return true;
+    }
+    if (upper.startsWith("SNIFF TAIL ")) {
+        handleSnifferTail(upper, response);
+        return true;
+    }
+
+    // USB-CDC <-> UART bridge
+    if (upper == "BRIDGE STATUS") {
+        handleBridgeStatus(response);
+        return true;
+    }
+    if (upper.startsWith("BRIDGE ")) {
+        handleBridge(upper, response, source);
+        return true;
+    }
+
+    // HID data reports <-> UART
+    if (upper.startsWith("HIDUART START ")) {
+        handleHIDChannelStart(upper, response);
+        return true;
+    }
+    if (upper == "HIDUART STOP") {
+        handleHIDChannelStop(response);
+        return true;
+    }
+    if (upper == "HIDUART STATUS") {
+        handleHIDChannelStatus(response);
+        return true;
+    }
 
     // Buzzer Commands
     if (upper.startsWith("BUZZER BEEP ")) {
@@ -410,6 +722,34 @@ bool CommandParser::processCommand(const String& cmd, ICommandResponse* response
         return true;
     }
 
+    // RMT Pattern Generator Commands
+    if (upper == "PATTERN STATUS" || upper == "PATTERN") {
+        handlePatternStatus(response);
+        return true;
+    }
+    if (upper == "PATTERN STOP") {
+        handlePatternStop(response);
+        return true;
+    }
+    if (upper.startsWith("PATTERN PLAY ")) {
+        handlePatternPlay(upper, response);
+        return true;
+    }
+    if (upper.startsWith("PATTERN ")) {
+        handlePatternEdit(upper, response);
+        return true;
+    }
+
+    // Fan Bank Commands
+    if (upper == "FAN STATUS" || upper == "FANS") {
+        handleFanStatus(response);
+        return true;
+    }
+    if (upper.startsWith("FAN ")) {
+        handleFanChannel(upper, response);
+        return true;
+    }
+
     // Keys Commands
     if (upper == "KEYS STATUS" || upper == "KEYS") {
         handleKeysStatus(response);
@@ -540,12 +880,82 @@ void CommandParser::handleHelp(ICommandResponse* response) {
     response->println("  MOTOR STATUS      - 顯示馬達控制狀態");
     response->println("  MOTOR STOP        - 緊急停止（設定占空比為 0%）");
     response->println("  CLEAR ERROR (or RESUME) - 清除緊急停止狀態");
+    response->println("  BATCH {json}      - 批次設定（先驗證後一次套用）");
+    response->println("");
+    response->println("預設工作點 (預先計算暫存器，下一個 TEZ 生效，Key 3 切換下一個):");
+    response->println("  PRESET <n>              - 切換至預設 n (1-8)");
+    response->println("  PRESET SAVE <n> [名稱]  - 以目前 PWM/LED/繼電器狀態儲存預設");
+    response->println("  PRESET SET <n> [名稱] {json} - 定義預設（欄位: freq, duty, led, ledEnabled, relay）");
+    response->println("  PRESET LIST             - 列出預設與預除頻衝突");
+    response->println("  PRESET DELETE <n>       - 刪除預設");
     response->println("");
-    response->println("進階功能 (Priority 3):");
-    response->println("  RAMP PWM_FREQ <Hz> <ms>  - 漸變 PWM 頻率");
-    response->println("  RAMP PWM_DUTY <%> <ms>   - 漸變 PWM 占空比");
-    response->println("  SET RPM_FILTER_SIZE <n>  - 設定 RPM 濾波器大小 (1-20)");
-    response->println("  FILTER STATUS           - 顯示濾波器狀態");
+    response->println("閉迴路轉速控制 (PID, 硬體計時):");
+    response->println("  MOTOR RPM <rpm>         - 以 PID 穩定在目標轉速");
+    response->println("  MOTOR RPM OFF           - 離開閉迴路，保持目前占空比");
+    response->println("  MOTOR RPM STATUS        - 顯示迴路狀態與時序/誤差/飽和統計");
+    response->println("  MOTOR PID <kp> <ki> <kd> - 設定 PID 增益（占空比 % / RPM）");
+    response->println("  MOTOR LOOP <Hz>         - 設定控制迴路頻率 (100-1000 Hz)");
+    response->println("  MOTOR SLEW <%/s>        - 設定占空比變化率限制 (0=不限制)");
+    response->println("  MOTOR FF <ON|OFF|CLEAR> - 前饋（學習的占空比→RPM 曲線）");
+    response->println("");
+    response->println("PWM 漸變 (硬體計時，不阻塞):");
+    response->println("  RAMP PWM_FREQ <Hz> <ms> [曲線] - 漸變 PWM 頻率");
+    response->println("  RAMP PWM_DUTY <%> <ms> [曲線]  - 漸變 PWM 占空比");
+    response->println("                          曲線: LINEAR (預設), SCURVE, EXP");
+    response->println("  RAMP STATUS             - 顯示漸變進度");
+    response->println("  RAMP STOP               - 停止漸變並保持目前輸出");
+    response->println("");
+    response->println("PWM 波形序列 (硬體計時，每步記錄 RPM):");
+    response->println("  SEQ ADD <Hz> <%> <ms>[; ...] - 新增序列點（可一行多點）");
+    response->println("  SEQ CLEAR               - 清除序列");
+    response->println("  SEQ LIST                - 列出序列點");
+    response->println("  SEQ LOOP <index>        - 重複播放時從此點開始");
+    response->println("  SEQ PLAY [次數]         - 播放序列 (預設 1 次, 0=無限重複)");
+    response->println("  SEQ STOP                - 停止播放並保持目前輸出");
+    response->println("  SEQ STATUS              - 顯示播放進度");
+    response->println("  SEQ RESULT [起點] [筆數] - 下載每步 RPM 結果 (CSV)");
+    response->println("  SEQ SAVE / SEQ LOAD     - 儲存/載入序列（快閃記憶體）");
+    response->println("");
+    response->println("風扇特性量測 (背景執行):");
+    response->println("  CHARACTERIZE DUTY <起%> <終%> <間隔%> [停留ms] - 占空比掃描（上升後下降）");
+    response->println("  CHARACTERIZE FREQ <起Hz> <終Hz> <點數> [停留ms] - PWM 頻率對數掃描");
+    response->println("  CHARACTERIZE STEP <低%> <高%> [次數] [停留ms]  - 步階響應");
+    response->println("  CHARACTERIZE STATUS     - 顯示量測進度");
+    response->println("  CHARACTERIZE STOP       - 停止量測並恢復原輸出");
+    response->println("  CHARACTERIZE RESULT     - 每步上升/穩定時間、過衝、漣波與死區 (CSV)");
+    response->println("  CHARACTERIZE TRACE [步] - 下載原始 RPM 軌跡 (CSV)");
+    response->println("");
+    response->println("RPM 量測濾波:");
+    response->println("  SET RPM_FILTER <type>    - 濾波器類型 (NONE/MEDIAN/EMA/WINDOW)");
+    response->println("  SET RPM_FILTER_SIZE <n>  - 中位數/移動平均視窗 (1-32)");
+    response->println("  SET RPM_EMA_ALPHA <a>    - EMA 平滑係數 (0.01-1.0)");
+    response->println("  SET RPM_PERIODS <n>      - 每次取樣的週期數 (1-256)");
+    response->println("  SET RPM_GATE <ms>        - 最長取樣閘門時間 (1-1000 ms)");
+    response->println("  SET RPM_OUTLIER <%>      - 異常週期剔除容差 (0=關閉, 5-90)");
+    response->println("  FILTER STATUS           - 顯示濾波器狀態與統計");
+    response->println("  FILTER RESET            - 清除濾波器統計");
+    response->println("");
+    response->println("失速偵測 (硬體計時):");
+    response->println("  SET RPM_STALL <ON|OFF>       - 啟用/停用失速偵測");
+    response->println("  SET RPM_STALL_PERIODS <n>    - 逾時 = n 個轉速脈衝間隔 (2-16)");
+    response->println("  SET RPM_STALL_ACTION <動作>  - NONE 或 CUT,BEEP,NOTIFY 組合");
+    response->println("  STALL STATUS            - 顯示失速偵測狀態與統計");
+    response->println("  STALL RESET             - 清除失速統計");
+    response->println("");
+    response->println("脈寬 / 占空比量測 (雙邊緣擷取):");
+    response->println("  PULSE <OFF|INPUT|LOOPBACK> - 量測 RX 輸入或回授自身 PWM 輸出");
+    response->println("  PULSE STATUS            - 高/低電位時間、週期、占空比統計");
+    response->println("  PULSE RESET             - 清除脈寬統計");
+    response->println("");
+    response->println("邏輯分析擷取 (RX 邊緣時間戳記):");
+    response->println("  CAPTURE START <n> [EDGES|MS] - 觸發後擷取 n 個邊緣或 n 毫秒");
+    response->println("  CAPTURE TRIGGER NONE    - 第一個邊緣即觸發");
+    response->println("  CAPTURE TRIGGER PERIOD <最小µs> <最大µs> - 週期超出範圍時觸發");
+    response->println("  CAPTURE TRIGGER GAP <µs> - 邊緣間隔超過指定時間時觸發");
+    response->println("  CAPTURE PRE <n>         - 保留觸發前 n 個邊緣");
+    response->println("  CAPTURE STATUS          - 顯示擷取狀態");
+    response->println("  CAPTURE STOP            - 停止擷取");
+    response->println("  CAPTURE DUMP [VCD|CSV]  - 經 CDC 下載擷取結果 (亦可 GET /api/capture.vcd)");
     response->println("");
     response->println("設定管理:");
     response->println("  SAVE          - 儲存設定到 NVS");
@@ -560,6 +970,7 @@ void CommandParser::handleHelp(ICommandResponse* response) {
     response->println("  WIFI STOP     - 停止 WiFi");
     response->println("  WIFI SCAN     - 掃描可用網路");
     response->println("  WEB STATUS    - 顯示 Web 伺服器狀態");
+    response->println("  WEB SSE <ms>  - 設定 SSE (/api/events) 推播間隔 (50-60000ms)");
     response->println("");
     response->println("週邊控制:");
     response->println("  UART1 MODE <UART|PWM|OFF> - 設定 UART1 模式");
@@ -567,9 +978,35 @@ void CommandParser::handleHelp(ICommandResponse* response) {
     response->println("  UART1 PWM <freq> <duty>   - 設定 UART1 PWM");
     response->println("  UART1 STATUS              - 顯示 UART1 狀態");
     response->println("  UART1 WRITE <text>        - 寫入 UART1");
+    response->println("  UART1 BENCH <n>           - 模式切換 n 次並顯示延遲百分位數");
     response->println("  UART2 CONFIG <baud>       - 設定 UART2 參數");
     response->println("  UART2 STATUS              - 顯示 UART2 狀態");
     response->println("  UART2 WRITE <text>        - 寫入 UART2");
+    response->println("  UART2 FRAME <LINE|IDLE|OFF> - UART2 中斷式行/訊框接收");
+    response->println("  UART2 FRAME DELIM <c|0xNN> - 自訂分隔字元訊框");
+    response->println("  UART2 READ [n]            - 讀取已接收的行/訊框");
+    response->println("  UART1|UART2 BERT <baud> <sec> [PRBS7|PRBS15|PRBS31] [LOOPBACK]");
+    response->println("                            - PRBS 位元錯誤率與吞吐量測試 (背景執行)");
+    response->println("  UART1|UART2 BERT STATUS|STOP - BERT 結果 / 停止測試");
+    response->println("  UART1|UART2 TXBENCH [chunk] - 同步/非同步/合併寫入的 TX 吞吐量比較");
+    response->println("  PKT START [COBS|SLIP] [CRC16|CRC32] [WINDOW n] [TIMEOUT ms] [RETRIES n]");
+    response->println("                            - 啟動 UART2 二進位封包鏈路");
+    response->println("  PKT SEND <hex>            - 送出一個封包");
+    response->println("  PKT XFER <hex> [ms]       - 送出封包並等待回覆封包");
+    response->println("  PKT RECV [n]              - 讀取已接收的封包");
+    response->println("  PKT STREAM <ON|OFF>       - 接收封包即時推送 (EVENT PKT)");
+    response->println("  PKT STATUS / PKT STOP     - 封包鏈路統計 / 停止");
+    response->println("  MODBUS START <unit> [baud] [8N1|8E1|8O1|8N2]");
+    response->println("                            - 啟動 UART2 Modbus RTU 伺服器 (FC 3/4/6/16)");
+    response->println("  MODBUS STATUS / MODBUS STOP - Modbus 統計與回應時間 / 停止");
+    response->println("  SNIFF START <UART1|UART2|ALL> [MONITOR]");
+    response->println("                            - UART 流量擷取至 PSRAM (µs 時間戳記)");
+    response->println("  SNIFF TAIL <ON|OFF>       - WebSocket 即時推送擷取內容");
+    response->println("  SNIFF STATUS / SNIFF STOP - 擷取統計 / 停止 (/api/uart/capture 下載)");
+    response->println("  BRIDGE <UART1|UART2>      - CDC 透明橋接 (+++ 返回控制台)");
+    response->println("  BRIDGE STATUS             - 上次橋接的流量與丟失統計");
+    response->println("  HIDUART START <UART1|UART2> - HID 資料報告 (0xA0) ↔ UART 通道");
+    response->println("  HIDUART STATUS / HIDUART STOP - 通道流量、序號缺口統計 / 停止");
     response->println("");
     response->println("  BUZZER <freq> <duty>      - 設定蜂鳴器");
     response->println("  BUZZER ON/OFF             - 開/關蜂鳴器");
@@ -582,6 +1019,24 @@ void CommandParser::handleHelp(ICommandResponse* response) {
     response->println("  RELAY PULSE <ms>          - 繼電器脈衝");
     response->println("  GPIO HIGH/LOW/TOGGLE      - 控制 GPIO");
     response->println("  GPIO STATUS               - 顯示 GPIO 狀態");
+    response->println("  PATTERN ADD <0|1>:<時間> ... - 加入波形片段 (如 1:2.5us 0:500ns)");
+    response->println("  PATTERN PULSE <高> <低> [n] - 加入 n 個脈衝週期 (模擬轉速訊號)");
+    response->println("  PATTERN BITS <01...> <位元時間> - 加入位元序列");
+    response->println("  PATTERN RES <ns> / PATTERN CLEAR - 時間解析度 (12.5 ns 倍數) / 清除波形");
+    response->println("  PATTERN PLAY <41|12> [次數|LOOP] - 由 RMT 在 GPIO 41/12 輸出波形");
+    response->println("  PATTERN STATUS / PATTERN STOP - 波形產生器狀態 / 停止");
+    response->println("");
+    response->println("  FAN STATUS                - 顯示所有風扇通道");
+    response->println("  FAN <n> ENABLE/DISABLE    - 啟用 / 停用通道 (開機時皆停用)");
+    response->println("  FAN <n> FREQ <hz>         - 設定通道 PWM 頻率");
+    response->println("  FAN <n> DUTY <0-100>      - 設定通道占空比");
+    response->println("  FAN <n> POLES <n>         - 設定通道極對數");
+    response->println("  FAN <n> FILTER <type>     - 通道濾波器 (NONE/MEDIAN/EMA/WINDOW)");
+    response->println("  FAN <n> FILTER_SIZE <n>   - 通道濾波視窗");
+    response->println("  FAN <n> STALL ON/OFF      - 通道失速偵測");
+    response->println("  FAN <n> STALL_PERIODS <n> - 通道失速逾時倍數");
+    response->println("  FAN <n> STALL_ACTION <list> - 通道失速動作 (CUT,BEEP,NOTIFY / NONE)");
+    response->println("  FAN SAVE / FAN RESET      - 儲存 / 重設風扇通道設定");
     response->println("");
     response->println("  KEYS                      - 顯示按鍵狀態");
     response->println("  KEYS CONFIG <duty_step> <freq_step> - 設定步進值");
@@ -749,8 +1204,14 @@ void CommandParser::handleSetPWMFreq(ICommandResponse* response, uint32_t freq)
         return;
     }
 
-    if (uart1.setPWMFrequency(freq)) {
+    PWMSynthResult synth;
+    if (uart1.setPWMFrequency(freq, &synth)) {
         response->printf("✅ PWM 頻率設定為: %d Hz\n", freq);
+        response->printf("   實際輸出: %.3f Hz (誤差 %+.1f ppm), 占空比解析度: %.3f%%\n",
+                        synth.frequency, synth.errorPpm, synth.dutyResolution);
+        if (!synth.keptPrescaler) {
+            response->println("⚠️ 已變更預除頻（立即生效，該週期可能不完整）");
+        }
 
         // Notify web clients about the change
         if (webServerManager.isRunning()) {
@@ -837,14 +1298,12 @@ void CommandParser::handleSetPWMFreqAndDuty(ICommandResponse* response, uint32_t
                          cfg0_after_delay, (cfg0_after_delay & 0xFF), ((cfg0_after_delay >> 8) & 0xFFFF));
     }
 
-    // Calculate expected frequency
+    // Calculate expected frequency (register fields are value - 1)
     uint32_t reg_prescaler = (cfg0_after & 0xFF);
     uint32_t reg_period = ((cfg0_after >> 8) & 0xFFFF);
-    if (reg_prescaler > 0 && reg_period > 0) {
-        uint32_t calculated_freq = 80000000 / (reg_prescaler * reg_period);
-        response->printf("🔵 Calculated from register: 80MHz / (%u × %u) = %u Hz\n",
-                         reg_prescaler, reg_period, calculated_freq);
-    }
+    response->printf("🔵 Calculated from register: %u Hz / (%u × %u) = %.3f Hz\n",
+                     uart1.getPWMClock(), reg_prescaler + 1, reg_period + 1,
+                     PWMSynth::achievedFrequency(uart1.getPWMClock(), reg_prescaler, reg_period));
 
     // Get state AFTER update
     uint32_t new_freq = uart1.getPWMFrequency();
@@ -856,19 +1315,22 @@ void CommandParser::handleSetPWMFreqAndDuty(ICommandResponse* response, uint32_t
 
     // Analyze what changed
     if (old_prescaler != new_prescaler) {
-        response->printf("⚠️  PRESCALER CHANGED: %u → %u (calls mcpwm_set_frequency)\n", old_prescaler, new_prescaler);
+        response->printf("⚠️  PRESCALER CHANGED: %u → %u (not shadowed, applies immediately)\n", old_prescaler, new_prescaler);
     }
     if (old_period != new_period) {
-        response->printf("⚠️  PERIOD CHANGED: %u → %u (calls mcpwm_set_frequency)\n", old_period, new_period);
+        response->printf("ℹ️  PERIOD CHANGED: %u → %u (shadow register, latched at TEZ)\n", old_period, new_period);
     }
     if (old_freq == new_freq && old_duty != new_duty && old_prescaler == new_prescaler && old_period == new_period) {
-        response->println("✅ DUTY-ONLY UPDATE (mcpwm_set_duty TEZ-sync, should be glitch-free!)");
+        response->println("✅ DUTY-ONLY UPDATE (compare shadow register, TEZ-sync, glitch-free)");
     }
 
     response->println("═══════════════════════════════════════");
 
     if (result) {
+        const PWMSynthResult& synth = uart1.getPWMSynthesis();
         response->printf("✅ PWM 原子性更新: %u Hz, %.1f%%\n", freq, duty);
+        response->printf("   實際輸出: %.3f Hz (誤差 %+.1f ppm), 占空比解析度: %.3f%%\n",
+                        synth.frequency, synth.errorPpm, synth.dutyResolution);
         response->println("ℹ️ 頻率和占空比已在下一個 PWM 週期同時生效");
 
         // Notify web clients about the change
@@ -1005,9 +1467,22 @@ void CommandParser::handleMotorStatus(ICommandResponse* response) {
 
     // PWM output status
     response->println("PWM 輸出:");
+    const PWMSynthResult& synth = uart1.getPWMSynthesis();
     response->printf("  頻率: %d Hz\n", uart1.getPWMFrequency());
+    response->printf("  實際頻率: %.3f Hz (誤差 %+.1f ppm)\n", synth.frequency, synth.errorPpm);
     response->printf("  占空比: %.1f%%\n", uart1.getPWMDuty());
+    response->printf("  占空比解析度: %.3f%% (%u 階)\n", synth.dutyResolution, synth.dutySteps);
+    response->printf("  暫存器: 預除頻=%u, 週期=%u (時脈 %u Hz)\n",
+                    uart1.getPWMPrescaler(), uart1.getPWMPeriod(), uart1.getPWMClock());
     response->printf("  最大頻率限制: %d Hz\n", uart1.getMaxFrequency());
+    if (uart1.isRamping()) {
+        UART1Mux::RampStatus ramp = uart1.getRampStatus();
+        response->printf("  漸變: 進行中 (步驟 %u / %u)\n", ramp.step, ramp.steps);
+    }
+    if (uart1.isRPMLoopActive()) {
+        response->printf("  閉迴路: 目標 %.0f RPM (%u Hz)\n",
+                        uart1.getRPMController().getTarget(), uart1.getRPMLoopRate());
+    }
     response->println("");
 
     // Tachometer status
@@ -1048,44 +1523,284 @@ void CommandParser::handleMotorStop(ICommandResponse* response) {
     }
 }
 
-void CommandParser::handleSaveSettings(ICommandResponse* response) {
-    // Route to UART1 motor control (migrated from old MotorControl)
-    auto& uart1 = peripheralManager.getUART1();
+void CommandParser::handleBatch(const String& cmd, ICommandResponse* response) {
+    // BATCH {"freq":20000,"duty":40,"polePairs":2,"maxFreq":50000,"led":80,"ledEnabled":true,"relay":false}
+    // Original-case text is needed because JSON keys are case-sensitive
+    String json = cmd.substring(5);
+    json.trim();
 
-    if (uart1.saveSettings()) {
-        response->println("✅ UART1 馬達控制設定已儲存到 NVS");
-    } else {
-        response->println("❌ 儲存 UART1 設定失敗");
+    if (json.length() == 0 || json[0] != '{') {
+        response->println("❌ 錯誤：格式應為 BATCH {\"freq\":<Hz>,\"duty\":<%>,...}");
+        response->println("   欄位: freq, duty, polePairs, maxFreq, led, ledEnabled, relay");
+        return;
     }
-}
-
-void CommandParser::handleLoadSettings(ICommandResponse* response) {
-    // Route to UART1 motor control (migrated from old MotorControl)
-    auto& uart1 = peripheralManager.getUART1();
 
-    if (uart1.loadSettings()) {
-        response->println("✅ UART1 馬達控制設定已從 NVS 載入");
-        response->printf("  PWM 頻率: %d Hz\n", uart1.getPWMFrequency());
-        response->printf("  PWM 占空比: %.1f%%\n", uart1.getPWMDuty());
-        response->printf("  極對數: %d\n", uart1.getPolePairs());
-        response->printf("  最大頻率: %d Hz\n", uart1.getMaxFrequency());
-        response->printf("  UART 鮑率: %u bps\n", uart1.getUARTBaudRate());
+    PeripheralBatch batch;
+    String error;
+    JsonFieldReader reader(json.begin(), json.length());
+    const char* key;
+    const char* value;
+    WebRequestBody::FieldType type;
 
-        // Notify web clients about the changes
-        if (webServerManager.isRunning()) {
-            webServerManager.broadcastStatus();
+    // Parse every field first; nothing is applied unless all of them are valid
+    while (reader.next(key, value, type)) {
+        if (!batch.setField(key, value, error)) {
+            response->printf("❌ 批次驗證失敗: %s（未套用任何變更）\n", error.c_str());
+            return;
         }
-    } else {
-        response->println("❌ 載入 UART1 設定失敗");
     }
-}
-
-void CommandParser::handleResetSettings(ICommandResponse* response) {
-    // Route to UART1 motor control (migrated from old MotorControl)
-    auto& uart1 = peripheralManager.getUART1();
+    if (reader.failed()) {
+        response->println("❌ 錯誤：JSON 格式錯誤（未套用任何變更）");
+        return;
+    }
 
-    uart1.resetToDefaults();
-    uart1.saveSettings();
+    if (!peripheralManager.applyBatch(batch, error)) {
+        response->printf("❌ 批次套用失敗: %s\n", error.c_str());
+        return;
+    }
+
+    auto& uart1 = peripheralManager.getUART1();
+    response->println("✅ 批次設定已套用:");
+    if (batch.hasFrequency || batch.hasDuty) {
+        response->printf("  PWM: %u Hz, %.1f%%（同一 TEZ 生效）\n", uart1.getPWMFrequency(), uart1.getPWMDuty());
+    }
+    if (batch.hasPolePairs) {
+        response->printf("  極對數: %u\n", uart1.getPolePairs());
+    }
+    if (batch.hasMaxFrequency) {
+        response->printf("  最大頻率限制: %u Hz\n", uart1.getMaxFrequency());
+    }
+    if (batch.hasLedBrightness || batch.hasLedEnabled) {
+        response->printf("  LED: %.1f%% (%s)\n", peripheralManager.getLEDPWM().getBrightness(),
+                        peripheralManager.getLEDPWM().isEnabled() ? "ON" : "OFF");
+    }
+    if (batch.hasRelay) {
+        response->printf("  繼電器: %s\n", peripheralManager.getRelay().getState() ? "ON" : "OFF");
+    }
+
+    // One notification for the whole operating point
+    if (webServerManager.isRunning()) {
+        webServerManager.broadcastStatus();
+    }
+}
+
+static void printPresetMask(ICommandResponse* response, uint8_t mask) {
+    bool first = true;
+    for (uint8_t i = 0; i < OperatingPresets::MAX_PRESETS; i++) {
+        if (mask & (1 << i)) {
+            response->printf(first ? "%u" : ", %u", i + 1);
+            first = false;
+        }
+    }
+}
+
+static void printPresetSaved(ICommandResponse* response, OperatingPresets& presets, uint8_t index) {
+    const OperatingPresets::Preset* preset = presets.get(index);
+    const UART1Mux::PWMImage& pwm = preset->pwm;
+    response->printf("✅ 預設 %u (%s) 已儲存: %u Hz (實際 %.3f Hz, %+.1f ppm), %.1f%%, LED %.1f%% (%s), 繼電器 %s\n",
+                    index, preset->name, pwm.frequency, pwm.synth.frequency, pwm.synth.errorPpm, pwm.duty,
+                    preset->ledBrightness, preset->ledEnabled ? "ON" : "OFF", preset->relay ? "ON" : "OFF");
+    response->printf("   暫存器: prescaler=%u, period=%u, compare=%u\n", pwm.prescaler, pwm.period, pwm.compare);
+
+    // Flag prescaler changes now, so a glitch-free set can be picked before testing
+    uint8_t conflicts = presets.getPrescalerConflicts(index);
+    uint8_t shared = 0;
+    for (uint8_t i = 1; i <= OperatingPresets::MAX_PRESETS; i++) {
+        if (i != index && presets.get(i) && !(conflicts & (1 << (i - 1)))) {
+            shared |= 1 << (i - 1);
+        }
+    }
+    if (shared) {
+        response->print("   與預設 ");
+        printPresetMask(response, shared);
+        response->println(" 切換無毛刺（相同預除頻，下一個 TEZ 生效）");
+    }
+    if (conflicts) {
+        response->print("   ⚠️ 與預設 ");
+        printPresetMask(response, conflicts);
+        response->println(" 切換需變更預除頻（立即生效，不與 TEZ 同步）");
+    }
+}
+
+void CommandParser::handlePreset(const String& cmd, ICommandResponse* response) {
+    // PRESET <n> | SAVE <n> [name] | SET <n> [name] {json} | LIST | DELETE <n>
+    // Original-case text is needed for names and JSON keys
+    auto& presets = peripheralManager.getPresets();
+    String args = cmd.substring(6);
+    args.trim();
+    int space = args.indexOf(' ');
+    String sub = space < 0 ? args : args.substring(0, space);
+    String rest = space < 0 ? "" : args.substring(space + 1);
+    sub.toUpperCase();
+    rest.trim();
+
+    if (sub.length() == 0 || sub == "LIST") {
+        response->printf("預設工作點 (%u/%u):\n", presets.getCount(), OperatingPresets::MAX_PRESETS);
+        if (presets.getCount() == 0) {
+            response->println("  （無）使用 PRESET SAVE <n> [名稱] 儲存目前狀態");
+            return;
+        }
+        response->println("   #  名稱             頻率 (Hz)  占空比   LED            繼電器  prescaler  period");
+        for (uint8_t i = 1; i <= OperatingPresets::MAX_PRESETS; i++) {
+            const OperatingPresets::Preset* preset = presets.get(i);
+            if (!preset) {
+                continue;
+            }
+            response->printf("  %s%u  %-15s  %9u  %5.1f%%  %5.1f%% (%-3s)  %-6s  %9u  %6u%s\n",
+                            presets.getActive() == i ? "*" : " ", i, preset->name,
+                            preset->pwm.frequency, preset->pwm.duty,
+                            preset->ledBrightness, preset->ledEnabled ? "ON" : "OFF",
+                            preset->relay ? "ON" : "OFF", preset->pwm.prescaler, preset->pwm.period,
+                            presets.getPrescalerConflicts(i) ? "  ⚠️" : "");
+        }
+        response->println("  * = 目前套用；⚠️ = 與部分預設切換需變更預除頻");
+        const OperatingPresets::Statistics& stats = presets.getStatistics();
+        response->printf("  切換 %u 次（變更預除頻 %u 次），最近 %u µs，最長 %u µs\n",
+                        stats.recalls, stats.prescalerChanges, stats.lastRecallUs, stats.maxRecallUs);
+        return;
+    }
+
+    if (sub == "SAVE" || sub == "SET" || sub == "DELETE") {
+        space = rest.indexOf(' ');
+        int index = (space < 0 ? rest : rest.substring(0, space)).toInt();
+        String tail = space < 0 ? "" : rest.substring(space + 1);
+        tail.trim();
+        if (index < 1 || index > OperatingPresets::MAX_PRESETS) {
+            response->printf("❌ 錯誤：預設編號應為 1-%u\n", OperatingPresets::MAX_PRESETS);
+            return;
+        }
+
+        if (sub == "DELETE") {
+            if (presets.remove(index)) {
+                response->printf("✅ 預設 %d 已刪除\n", index);
+            } else {
+                response->printf("❌ 預設 %d 不存在\n", index);
+            }
+            return;
+        }
+
+        String error;
+        if (sub == "SAVE") {
+            if (!presets.saveCurrent(index, tail.c_str(), error)) {
+                response->printf("❌ 儲存預設失敗: %s\n", error.c_str());
+                return;
+            }
+            printPresetSaved(response, presets, index);
+            return;
+        }
+
+        // SET: fields not given are taken from the current state
+        int brace = tail.indexOf('{');
+        if (brace < 0) {
+            response->println("❌ 錯誤：格式應為 PRESET SET <n> [名稱] {\"freq\":<Hz>,\"duty\":<%>,...}");
+            response->println("   欄位: freq, duty, led, ledEnabled, relay");
+            return;
+        }
+        String name = tail.substring(0, brace);
+        String json = tail.substring(brace);
+        name.trim();
+
+        PeripheralBatch batch;
+        JsonFieldReader reader(json.begin(), json.length());
+        const char* key;
+        const char* value;
+        WebRequestBody::FieldType type;
+        while (reader.next(key, value, type)) {
+            if (!batch.setField(key, value, error)) {
+                response->printf("❌ 預設驗證失敗: %s\n", error.c_str());
+                return;
+            }
+        }
+        if (reader.failed()) {
+            response->println("❌ 錯誤：JSON 格式錯誤");
+            return;
+        }
+        if (batch.hasPolePairs || batch.hasMaxFrequency) {
+            response->println("❌ 錯誤：polePairs / maxFreq 不屬於預設工作點");
+            return;
+        }
+
+        auto& uart1 = peripheralManager.getUART1();
+        auto& ledPWM = peripheralManager.getLEDPWM();
+        if (!presets.define(index, name.c_str(),
+                            batch.hasFrequency ? batch.frequency : uart1.getPWMFrequency(),
+                            batch.hasDuty ? batch.duty : uart1.getPWMDuty(),
+                            batch.hasLedBrightness ? batch.ledBrightness : ledPWM.getBrightness(),
+                            batch.hasLedEnabled ? batch.ledEnabled : ledPWM.isEnabled(),
+                            batch.hasRelay ? batch.relay : peripheralManager.getRelay().getState(),
+                            error)) {
+            response->printf("❌ 定義預設失敗: %s\n", error.c_str());
+            return;
+        }
+        printPresetSaved(response, presets, index);
+        return;
+    }
+
+    int index = sub.toInt();
+    if (index < 1 || index > OperatingPresets::MAX_PRESETS) {
+        response->println("❌ 錯誤：格式應為 PRESET <n> | SAVE <n> [名稱] | SET <n> [名稱] {json} | LIST | DELETE <n>");
+        return;
+    }
+
+    String error;
+    bool prescalerChanged = false;
+    if (!presets.recall(index, error, &prescalerChanged)) {
+        response->printf("❌ 切換預設 %d 失敗: %s\n", index, error.c_str());
+        return;
+    }
+
+    const OperatingPresets::Preset* preset = presets.get(index);
+    response->printf("✅ 已切換至預設 %d (%s): %u Hz, %.1f%%（下一個 TEZ 生效，%u µs）\n",
+                    index, preset->name, preset->pwm.frequency, preset->pwm.duty,
+                    presets.getStatistics().lastRecallUs);
+    if (prescalerChanged) {
+        response->printf("   ⚠️ 預除頻已變更為 %u（立即生效，不與 TEZ 同步）\n", preset->pwm.prescaler);
+    }
+
+    // One notification for the whole operating point
+    if (webServerManager.isRunning()) {
+        webServerManager.broadcastStatus();
+    }
+}
+
+void CommandParser::handleSaveSettings(ICommandResponse* response) {
+    // Route to UART1 motor control (migrated from old MotorControl)
+    auto& uart1 = peripheralManager.getUART1();
+
+    if (uart1.saveSettings()) {
+        response->println("✅ UART1 馬達控制設定已儲存到 NVS");
+    } else {
+        response->println("❌ 儲存 UART1 設定失敗");
+    }
+}
+
+void CommandParser::handleLoadSettings(ICommandResponse* response) {
+    // Route to UART1 motor control (migrated from old MotorControl)
+    auto& uart1 = peripheralManager.getUART1();
+
+    if (uart1.loadSettings()) {
+        response->println("✅ UART1 馬達控制設定已從 NVS 載入");
+        response->printf("  PWM 頻率: %d Hz\n", uart1.getPWMFrequency());
+        response->printf("  PWM 占空比: %.1f%%\n", uart1.getPWMDuty());
+        response->printf("  極對數: %d\n", uart1.getPolePairs());
+        response->printf("  最大頻率: %d Hz\n", uart1.getMaxFrequency());
+        response->printf("  UART 鮑率: %u bps\n", uart1.getUARTBaudRate());
+
+        // Notify web clients about the changes
+        if (webServerManager.isRunning()) {
+            webServerManager.broadcastStatus();
+        }
+    } else {
+        response->println("❌ 載入 UART1 設定失敗");
+    }
+}
+
+void CommandParser::handleResetSettings(ICommandResponse* response) {
+    // Route to UART1 motor control (migrated from old MotorControl)
+    auto& uart1 = peripheralManager.getUART1();
+
+    uart1.resetToDefaults();
+    uart1.saveSettings();
 
     response->println("✅ UART1 馬達控制設定已重設為出廠預設值");
     response->printf("  PWM 頻率: %d Hz\n", uart1.getPWMFrequency());
@@ -1093,95 +1808,1251 @@ void CommandParser::handleResetSettings(ICommandResponse* response) {
     response->printf("  極對數: %d\n", uart1.getPolePairs());
     response->printf("  最大頻率: %d Hz\n", uart1.getMaxFrequency());
 
-    // Notify web clients about the changes
+    // Notify web clients about the changes
+    if (webServerManager.isRunning()) {
+        webServerManager.broadcastStatus();
+    }
+}
+
+// ==================== RPM Measurement Filter ====================
+
+void CommandParser::handleSetRPMFilter(ICommandResponse* response, const String& type) {
+    auto& filter = peripheralManager.getUART1().getRPMFilter();
+
+    RPMFilter::FilterType filterType;
+    if (type == "NONE") {
+        filterType = RPMFilter::FILTER_NONE;
+    } else if (type == "MEDIAN") {
+        filterType = RPMFilter::FILTER_MEDIAN;
+    } else if (type == "EMA") {
+        filterType = RPMFilter::FILTER_EMA;
+    } else if (type == "WINDOW") {
+        filterType = RPMFilter::FILTER_WINDOW;
+    } else {
+        response->println("❌ 錯誤：濾波器類型必須為 NONE, MEDIAN, EMA 或 WINDOW");
+        return;
+    }
+
+    filter.setFilterType(filterType);
+    response->printf("✅ RPM 濾波器已設定為: %s\n", RPMFilter::getFilterName(filterType));
+    response->println("ℹ️ 使用 SAVE 命令儲存設定");
+}
+
+void CommandParser::handleSetRPMFilterSize(ICommandResponse* response, int size) {
+    auto& filter = peripheralManager.getUART1().getRPMFilter();
+
+    if (size < 1 || size > RPMFilter::MAX_WINDOW || !filter.setWindowSize(size)) {
+        response->printf("❌ 錯誤：濾波器大小必須在 1 - %d 之間\n", RPMFilter::MAX_WINDOW);
+        return;
+    }
+
+    response->printf("✅ RPM 濾波器大小已設定為: %d 個樣本\n", size);
+    response->println("ℹ️ 使用 SAVE 命令儲存設定");
+}
+
+void CommandParser::handleSetRPMEmaAlpha(ICommandResponse* response, float alpha) {
+    auto& filter = peripheralManager.getUART1().getRPMFilter();
+
+    if (!filter.setEmaAlpha(alpha)) {
+        response->println("❌ 錯誤：EMA 係數必須在 0.01 - 1.0 之間");
+        return;
+    }
+
+    response->printf("✅ RPM EMA 係數已設定為: %.2f\n", alpha);
+    response->println("ℹ️ 使用 SAVE 命令儲存設定");
+}
+
+void CommandParser::handleSetRPMPeriods(ICommandResponse* response, int periods) {
+    auto& filter = peripheralManager.getUART1().getRPMFilter();
+
+    if (periods < 1 || periods > RPMFilter::MAX_SAMPLE_PERIODS || !filter.setSamplePeriods(periods)) {
+        response->printf("❌ 錯誤：週期數必須在 1 - %d 之間\n", RPMFilter::MAX_SAMPLE_PERIODS);
+        return;
+    }
+
+    response->printf("✅ 每次取樣週期數已設定為: %d\n", periods);
+    response->println("ℹ️ 使用 SAVE 命令儲存設定");
+}
+
+void CommandParser::handleSetRPMGate(ICommandResponse* response, int gateMs) {
+    auto& filter = peripheralManager.getUART1().getRPMFilter();
+
+    if (gateMs < 1 || gateMs > 1000 || !filter.setMaxGateMs(gateMs)) {
+        response->println("❌ 錯誤：閘門時間必須在 1 - 1000 ms 之間");
+        return;
+    }
+
+    response->printf("✅ 最長取樣閘門時間已設定為: %d ms\n", gateMs);
+    response->println("ℹ️ 使用 SAVE 命令儲存設定");
+}
+
+void CommandParser::handleSetRPMOutlier(ICommandResponse* response, float percent) {
+    auto& filter = peripheralManager.getUART1().getRPMFilter();
+
+    if (!filter.setOutlierTolerance(percent)) {
+        response->println("❌ 錯誤：異常容差必須為 0（關閉）或 5 - 90%");
+        return;
+    }
+
+    if (percent == 0.0f) {
+        response->println("✅ 異常週期剔除已關閉");
+    } else {
+        response->printf("✅ 異常週期剔除容差已設定為: ±%.0f%%\n", percent);
+    }
+    response->println("ℹ️ 使用 SAVE 命令儲存設定");
+}
+
+void CommandParser::handleFilterStatus(ICommandResponse* response) {
+    auto& uart1 = peripheralManager.getUART1();
+    auto& filter = uart1.getRPMFilter();
+    RPMFilter::Statistics stats = filter.getStatistics();
+    float polePairs = (float)uart1.getPolePairs();
+
+    response->println("=== RPM 濾波器狀態 ===");
+    response->printf("濾波器類型: %s\n", RPMFilter::getFilterName(filter.getFilterType()));
+    response->printf("視窗大小: %d 個樣本\n", filter.getWindowSize());
+    response->printf("EMA 係數: %.2f\n", filter.getEmaAlpha());
+    response->printf("每次取樣週期數: %d (閘門上限 %d ms)\n",
+                    filter.getSamplePeriods(), filter.getMaxGateMs());
+    if (filter.getOutlierTolerance() > 0.0f) {
+        response->printf("異常剔除容差: ±%.0f%%\n", filter.getOutlierTolerance());
+    } else {
+        response->println("異常剔除容差: 關閉");
+    }
+    response->println("");
+
+    response->printf("原始頻率: %.2f Hz (%.1f RPM)\n",
+                    filter.getRawFrequency(), filter.getRawFrequency() * 60.0f / polePairs);
+    response->printf("濾波後頻率: %.2f Hz (%.1f RPM)\n",
+                    uart1.getRPMFrequency(), uart1.getCalculatedRPM());
+    response->printf("量測範圍: %s (中斷 %u 次/秒)\n", uart1.getRPMRangeName(), uart1.getRPMIsrRate());
+    response->println("");
+
+    response->println("統計 (原始取樣):");
+    response->printf("  邊緣數: %u\n", stats.edges);
+    response->printf("  取樣數: %u\n", stats.samples);
+    response->printf("  剔除週期: %u\n", stats.outliers);
+    response->printf("  擷取丟失: %u\n", uart1.getCaptureDrops());
+    if (stats.samples > 0) {
+        response->printf("  最小: %.2f Hz\n", stats.min);
+        response->printf("  最大: %.2f Hz\n", stats.max);
+        response->printf("  平均: %.2f Hz\n", stats.mean);
+        response->printf("  標準差: %.3f Hz\n", stats.stddev);
+    }
+    response->println("");
+}
+
+void CommandParser::handleFilterReset(ICommandResponse* response) {
+    peripheralManager.getUART1().getRPMFilter().resetStatistics();
+    response->println("✅ RPM 濾波器統計已清除");
+}
+
+// ==================== Stall Detection ====================
+
+void CommandParser::handleSetRPMStall(ICommandResponse* response, const String& value) {
+    auto& uart1 = peripheralManager.getUART1();
+
+    bool enable;
+    if (value == "ON" || value == "1") {
+        enable = true;
+    } else if (value == "OFF" || value == "0") {
+        enable = false;
+    } else {
+        response->println("❌ 錯誤：參數必須為 ON 或 OFF");
+        return;
+    }
+
+    if (!uart1.setStallDetection(enable)) {
+        response->println("❌ 失速偵測啟動失敗（計時器或任務無法建立）");
+        return;
+    }
+
+    response->printf("✅ 失速偵測已%s\n", enable ? "啟用" : "停用");
+    response->println("ℹ️ 使用 SAVE 命令儲存設定");
+}
+
+void CommandParser::handleSetRPMStallPeriods(ICommandResponse* response, int periods) {
+    if (periods < 0 || !peripheralManager.getUART1().setStallPeriods((uint8_t)periods)) {
+        response->printf("❌ 錯誤：週期數必須在 %u - %u 之間\n",
+                        UART1Mux::STALL_MIN_PERIODS, UART1Mux::STALL_MAX_PERIODS);
+        return;
+    }
+
+    response->printf("✅ 失速逾時已設定為: %d 個脈衝間隔\n", periods);
+    response->println("ℹ️ 使用 SAVE 命令儲存設定");
+}
+
+void CommandParser::handleSetRPMStallAction(ICommandResponse* response, const String& value) {
+    uint8_t actions;
+    if (!parseStallActions(value, actions)) {
+        response->println("❌ 錯誤：動作必須為 NONE 或 CUT, BEEP, NOTIFY 的組合");
+        return;
+    }
+
+    peripheralManager.getUART1().setStallActions(actions);
+    response->printf("✅ 失速動作已設定為: %s\n", formatStallActions(actions).c_str());
+    response->println("ℹ️ 使用 SAVE 命令儲存設定");
+}
+
+bool CommandParser::parseStallActions(const String& value, uint8_t& actions) {
+    actions = 0;
+    if (value == "NONE") {
+        return true;
+    }
+
+    // Comma-separated list, e.g. CUT,NOTIFY
+    int start = 0;
+    while (start <= (int)value.length()) {
+        int comma = value.indexOf(',', start);
+        if (comma < 0) {
+            comma = value.length();
+        }
+        String token = value.substring(start, comma);
+        token.trim();
+
+        if (token == "CUT") {
+            actions |= UART1Mux::STALL_ACTION_CUT_PWM;
+        } else if (token == "BEEP") {
+            actions |= UART1Mux::STALL_ACTION_BEEP;
+        } else if (token == "NOTIFY") {
+            actions |= UART1Mux::STALL_ACTION_NOTIFY;
+        } else {
+            return false;
+        }
+        start = comma + 1;
+    }
+    return true;
+}
+
+String CommandParser::formatStallActions(uint8_t actions) {
+    if (actions == 0) {
+        return "NONE";
+    }
+    String text;
+    if (actions & UART1Mux::STALL_ACTION_CUT_PWM) text += "CUT,";
+    if (actions & UART1Mux::STALL_ACTION_BEEP) text += "BEEP,";
+    if (actions & UART1Mux::STALL_ACTION_NOTIFY) text += "NOTIFY,";
+    text.remove(text.length() - 1);
+    return text;
+}
+
+void CommandParser::handleStallStatus(ICommandResponse* response) {
+    auto& uart1 = peripheralManager.getUART1();
+    UART1Mux::StallStats stats = uart1.getStallStats();
+
+    response->println("=== 失速偵測狀態 ===");
+    response->printf("偵測: %s\n", uart1.isStallDetectionEnabled() ? "啟用" : "停用");
+    response->printf("逾時倍數: %u 個脈衝間隔\n", uart1.getStallPeriods());
+    response->printf("目前逾時: %.1f ms\n", uart1.getStallTimeoutUs() / 1000.0f);
+    response->printf("動作: %s\n", formatStallActions(uart1.getStallActions()).c_str());
+    response->println("");
+
+    response->printf("失速次數: %u\n", stats.count);
+    if (stats.count > 0) {
+        response->printf("上次失速: %lu ms 前\n", millis() - stats.lastTimeMs);
+        response->println("偵測延遲 (最後邊緣 → 處理):");
+        response->printf("  最後: %.2f ms\n", stats.lastDetectUs / 1000.0f);
+        response->printf("  最小: %.2f ms\n", stats.minDetectUs / 1000.0f);
+        response->printf("  最大: %.2f ms\n", stats.maxDetectUs / 1000.0f);
+        response->printf("  平均: %.2f ms\n", (float)(stats.totalDetectUs / stats.count) / 1000.0f);
+    }
+    response->println("");
+}
+
+// ==================== Pulse Width / Duty Measurement ====================
+
+void CommandParser::handlePulse(const String& cmd, ICommandResponse* response) {
+    // PULSE <OFF|INPUT|LOOPBACK>
+    String value = cmd.substring(6);  // Remove "PULSE "
+    value.trim();
+
+    UART1Mux::PulseSource source;
+    if (value == "OFF") {
+        source = UART1Mux::PULSE_OFF;
+    } else if (value == "INPUT" || value == "ON") {
+        source = UART1Mux::PULSE_INPUT;
+    } else if (value == "LOOPBACK") {
+        source = UART1Mux::PULSE_LOOPBACK;
+    } else {
+        response->println("❌ 錯誤：參數必須為 OFF, INPUT 或 LOOPBACK");
+        return;
+    }
+
+    if (!peripheralManager.getUART1().setPulseSource(source)) {
+        if (source == UART1Mux::PULSE_LOOPBACK) {
+            response->println("❌ 閉迴路 RPM 控制執行中，無法切換到回授量測 (先 MOTOR RPM OFF)");
+        } else {
+            response->println("❌ 擷取通道設定失敗");
+        }
+        return;
+    }
+
+    response->printf("✅ 脈寬量測: %s\n", UART1Mux::getPulseSourceName(source));
+    if (source == UART1Mux::PULSE_LOOPBACK) {
+        response->println("ℹ️ 擷取輸入改接 TX 腳 (GPIO 17)，RPM 顯示的是 PWM 頻率");
+    }
+}
+
+void CommandParser::handlePulseStatus(ICommandResponse* response) {
+    auto& uart1 = peripheralManager.getUART1();
+    UART1Mux::PulseSource source = uart1.getPulseSource();
+
+    response->println("=== 脈寬 / 占空比量測 ===");
+    response->printf("來源: %s\n", UART1Mux::getPulseSourceName(source));
+    if (source == UART1Mux::PULSE_OFF) {
+        response->println("ℹ️ 使用 PULSE INPUT 或 PULSE LOOPBACK 啟用雙邊緣擷取");
+        response->println("");
+        return;
+    }
+
+    PulseMeter::Statistics stats = uart1.getPulseStatistics();
+    response->printf("邊緣數: %u, 完整週期: %u, 不成對: %u, 擷取丟失: %u\n",
+                    stats.edges, stats.cycles, stats.unpaired, uart1.getCaptureDrops());
+
+    if (stats.cycles == 0) {
+        response->printf("無完整週期 (線路電平: %s)\n", uart1.getPulseLineLevel() ? "HIGH" : "LOW");
+        response->println("");
+        return;
+    }
+
+    response->println("              最後        最小        最大        平均");
+    response->printf("  高電位 (µs) %-11.3f %-11.3f %-11.3f %.3f\n",
+                    stats.highUs.last, stats.highUs.min, stats.highUs.max, stats.highUs.mean);
+    response->printf("  低電位 (µs) %-11.3f %-11.3f %-11.3f %.3f\n",
+                    stats.lowUs.last, stats.lowUs.min, stats.lowUs.max, stats.lowUs.mean);
+    response->printf("  週期 (µs)   %-11.3f %-11.3f %-11.3f %.3f\n",
+                    stats.periodUs.last, stats.periodUs.min, stats.periodUs.max, stats.periodUs.mean);
+    response->printf("  占空比 (%%)  %-11.3f %-11.3f %-11.3f %.3f\n",
+                    stats.duty.last, stats.duty.min, stats.duty.max, stats.duty.mean);
+    response->printf("占空比標準差: %.4f %%\n", stats.dutyStddev);
+    response->printf("頻率: %.3f Hz\n", stats.frequency);
+
+    if (source == UART1Mux::PULSE_LOOPBACK) {
+        const PWMSynthResult& synth = uart1.getPWMSynthesis();
+        float dutyError = stats.duty.mean - uart1.getPWMDuty();
+        response->println("回授比對:");
+        response->printf("  設定占空比: %.3f %%, 實測: %.3f %% (誤差 %+.3f %%)\n",
+                        uart1.getPWMDuty(), stats.duty.mean, dutyError);
+        if (synth.frequency > 0.0f) {
+            response->printf("  合成頻率: %.3f Hz, 實測: %.3f Hz (%+.1f ppm)\n",
+                            synth.frequency, stats.frequency,
+                            (stats.frequency - synth.frequency) / synth.frequency * 1e6f);
+        }
+    }
+    response->println("");
+}
+
+// ==================== Logic-analyzer Capture ====================
+
+void CommandParser::handleCaptureStart(const String& cmd, ICommandResponse* response) {
+    // CAPTURE START <n> [EDGES|MS]
+    String params = cmd.substring(14);  // Remove "CAPTURE START "
+    params.trim();
+
+    String unit = "EDGES";
+    int space = params.indexOf(' ');
+    if (space != -1) {
+        unit = params.substring(space + 1);
+        unit.trim();
+        params = params.substring(0, space);
+    }
+
+    LogicCapture::Limit limit;
+    if (unit == "EDGES") {
+        limit = LogicCapture::LIMIT_EDGES;
+    } else if (unit == "MS") {
+        limit = LogicCapture::LIMIT_TIME;
+    } else {
+        response->println("❌ 錯誤：格式應為 CAPTURE START <n> [EDGES|MS]");
+        return;
+    }
+
+    auto& uart1 = peripheralManager.getUART1();
+    auto& capture = peripheralManager.getLogicCapture();
+
+    if (capture.isRunning()) {
+        response->println("❌ 錯誤：擷取進行中，請先 CAPTURE STOP");
+        return;
+    }
+    if (uart1.getMode() != UART1Mux::MODE_PWM_RPM) {
+        response->println("❌ 錯誤：UART1 不在 PWM/RPM 模式");
+        return;
+    }
+
+    long amount = params.toInt();
+    if (!capture.start(amount > 0 ? (uint32_t)amount : 0, limit)) {
+        if (capture.getCapacity() == 0) {
+            response->println("❌ 擷取緩衝區配置失敗");
+        } else {
+            response->printf("❌ 錯誤：數量必須在 1 - %u 邊緣或 1 - %u ms 之間\n",
+                            LogicCapture::MAX_EDGES, LogicCapture::MAX_TIME_MS);
+        }
+        return;
+    }
+
+    response->printf("✅ 擷取已啟動: 觸發 %s, 觸發後 %u %s, 觸發前保留 %u 個邊緣\n",
+                    capture.getTriggerName(), capture.getAmount(),
+                    limit == LogicCapture::LIMIT_EDGES ? "個邊緣" : "ms", capture.getPreTrigger());
+    response->printf("ℹ️ 緩衝區: %u 個邊緣 (%s)\n",
+                    capture.getCapacity(), capture.isInPSRAM() ? "PSRAM" : "內部 RAM");
+    if (uart1.getPulseSource() == UART1Mux::PULSE_LOOPBACK) {
+        response->println("ℹ️ 回授量測啟用中，擷取的是 TX 腳 (GPIO 17)");
+    }
+    response->println("ℹ️ 使用 CAPTURE STATUS 查詢進度，CAPTURE DUMP 下載結果");
+}
+
+void CommandParser::handleCaptureTrigger(const String& cmd, ICommandResponse* response) {
+    // CAPTURE TRIGGER NONE | PERIOD <min_us> <max_us> | GAP <us>
+    String params = cmd.substring(16);  // Remove "CAPTURE TRIGGER "
+    params.trim();
+
+    String args[3];
+    int argc = 0;
+    while (params.length() > 0 && argc < 3) {
+        int space = params.indexOf(' ');
+        args[argc++] = space == -1 ? params : params.substring(0, space);
+        params = space == -1 ? "" : params.substring(space + 1);
+        params.trim();
+    }
+    if (params.length() > 0) {
+        argc = 0;  // Too many arguments
+    }
+
+    auto& capture = peripheralManager.getLogicCapture();
+    if (capture.isRunning()) {
+        response->println("❌ 錯誤：擷取進行中，請先 CAPTURE STOP");
+        return;
+    }
+
+    if (args[0] == "NONE" && argc == 1) {
+        capture.setNoTrigger();
+        response->println("✅ 觸發條件: NONE (第一個邊緣)");
+    } else if (args[0] == "PERIOD" && argc == 3) {
+        long minUs = args[1].toInt();
+        long maxUs = args[2].toInt();
+        if (minUs < 0 || maxUs < 0 || !capture.setPeriodTrigger((uint32_t)minUs, (uint32_t)maxUs)) {
+            response->printf("❌ 錯誤：需 0 ≤ 最小 ≤ 最大 ≤ %u µs\n", LogicCapture::MAX_TRIGGER_US);
+            return;
+        }
+        response->printf("✅ 觸發條件: 上升緣週期 < %u µs 或 > %u µs\n",
+                        capture.getTriggerMinUs(), capture.getTriggerMaxUs());
+    } else if (args[0] == "GAP" && argc == 2) {
+        long gapUs = args[1].toInt();
+        if (gapUs <= 0 || !capture.setGapTrigger((uint32_t)gapUs)) {
+            response->printf("❌ 錯誤：間隔必須在 1 - %u µs 之間\n", LogicCapture::MAX_TRIGGER_US);
+            return;
+        }
+        response->printf("✅ 觸發條件: 邊緣間隔 > %u µs (結束間隔的邊緣為觸發點)\n", capture.getTriggerGapUs());
+    } else {
+        response->println("❌ 錯誤：格式應為 CAPTURE TRIGGER NONE | PERIOD <最小µs> <最大µs> | GAP <µs>");
+    }
+}
+
+void CommandParser::handleCapturePre(const String& cmd, ICommandResponse* response) {
+    // CAPTURE PRE <edges>
+    String value = cmd.substring(12);  // Remove "CAPTURE PRE "
+    value.trim();
+
+    auto& capture = peripheralManager.getLogicCapture();
+    if (capture.isRunning()) {
+        response->println("❌ 錯誤：擷取進行中，請先 CAPTURE STOP");
+        return;
+    }
+
+    long edges = value.toInt();
+    if (edges < 0 || (edges == 0 && value != "0") || !capture.setPreTrigger((uint32_t)edges)) {
+        response->printf("❌ 錯誤：觸發前邊緣數必須在 0 - %u 之間\n", LogicCapture::MAX_PRE_TRIGGER);
+        return;
+    }
+    response->printf("✅ 觸發前保留 %u 個邊緣 (最多為緩衝區的一半)\n", capture.getPreTrigger());
+}
+
+void CommandParser::handleCaptureStatus(ICommandResponse* response) {
+    auto& capture = peripheralManager.getLogicCapture();
+
+    response->println("=== 邏輯分析擷取 ===");
+    response->printf("狀態: %s\n", capture.getStateName());
+    switch (capture.getTrigger()) {
+        case LogicCapture::TRIGGER_PERIOD:
+            response->printf("觸發: PERIOD (< %u µs 或 > %u µs)\n",
+                            capture.getTriggerMinUs(), capture.getTriggerMaxUs());
+            break;
+        case LogicCapture::TRIGGER_GAP:
+            response->printf("觸發: GAP (> %u µs)\n", capture.getTriggerGapUs());
+            break;
+        default:
+            response->println("觸發: NONE");
+            break;
+    }
+    response->printf("觸發前保留: %u 個邊緣\n", capture.getPreTrigger());
+    if (capture.getCapacity() > 0) {
+        response->printf("緩衝區: %u 個邊緣 (%s)\n",
+                        capture.getCapacity(), capture.isInPSRAM() ? "PSRAM" : "內部 RAM");
+    }
+    if (capture.getState() == LogicCapture::STATE_IDLE) {
+        response->println("");
+        return;
+    }
+
+    response->printf("限制: 觸發後 %u %s\n", capture.getAmount(),
+                    capture.getLimit() == LogicCapture::LIMIT_EDGES ? "個邊緣" : "ms");
+    response->printf("時間: %u ms\n", capture.getElapsedMs());
+    response->printf("已見邊緣: %u, 已儲存: %u (觸發前 %u), 擷取丟失: %u\n",
+                    capture.getSeenCount(), capture.getEdgeCount(),
+                    capture.getPreTriggerCount(), capture.getDropCount());
+    if (!capture.isRunning()) {
+        response->printf("擷取長度: %.3f ms\n", capture.getDurationMs());
+    }
+    if (capture.getMessage()[0]) {
+        response->printf("訊息: %s\n", capture.getMessage());
+    }
+    response->println("");
+}
+
+void CommandParser::handleCaptureDump(const String& cmd, ICommandResponse* response, CommandSource source) {
+    // CAPTURE DUMP [VCD|CSV]
+    String value = cmd.length() > 12 ? cmd.substring(13) : "";  // Remove "CAPTURE DUMP "
+    value.trim();
+
+    LogicCapture::Format format;
+    if (value.length() == 0 || value == "VCD") {
+        format = LogicCapture::FORMAT_VCD;
+    } else if (value == "CSV") {
+        format = LogicCapture::FORMAT_CSV;
+    } else {
+        response->println("❌ 錯誤：格式應為 CAPTURE DUMP [VCD|CSV]");
+        return;
+    }
+
+    if (source != CMD_SOURCE_CDC) {
+        // HID/BLE/WebSocket reports cannot carry megabytes
+        response->println("❌ 擷取結果請透過 CDC 或 HTTP (GET /api/capture.vcd, /api/capture.csv) 下載");
+        return;
+    }
+
+    auto& capture = peripheralManager.getLogicCapture();
+    if (capture.isRunning()) {
+        response->println("❌ 錯誤：擷取進行中，請先 CAPTURE STOP 或等待完成");
+        return;
+    }
+    if (!capture.hasData()) {
+        response->println("ℹ️ 沒有可下載的擷取資料");
+        return;
+    }
+
+    static char chunk[1024];
+    LogicCapture::ExportCursor cursor;
+    while (!capture.isExportDone(cursor)) {
+        size_t length = capture.exportChunk(format, cursor, chunk, sizeof(chunk) - 1);
+        if (length == 0) {
+            break;
+        }
+        chunk[length] = '\0';
+        response->print(chunk);
+    }
+}
+
+// ==================== PWM Ramp ====================
+
+void CommandParser::handleRamp(const String& cmd, ICommandResponse* response) {
+    // RAMP <PWM_FREQ|PWM_DUTY> <value> <time_ms> [LINEAR|SCURVE|EXP]
+    String params = cmd.substring(5);  // Remove "RAMP "
+    params.trim();
+
+    String tokens[4];
+    int count = 0;
+    while (params.length() > 0 && count < 4) {
+        int space = params.indexOf(' ');
+        if (space == -1) {
+            tokens[count++] = params;
+            params = "";
+        } else {
+            tokens[count++] = params.substring(0, space);
+            params = params.substring(space + 1);
+            params.trim();
+        }
+    }
+
+    if (count < 3 || params.length() > 0) {
+        response->println("❌ 錯誤：格式應為 RAMP <PWM_FREQ|PWM_DUTY> <value> <time_ms> [LINEAR|SCURVE|EXP]");
+        return;
+    }
+
+    PWMRamp::Profile profile = PWMRamp::PROFILE_LINEAR;
+    if (count == 4 && !PWMRamp::parseProfile(tokens[3].c_str(), profile)) {
+        response->println("❌ 錯誤：漸變曲線必須為 LINEAR, SCURVE 或 EXP");
+        return;
+    }
+
+    long rampTimeMs = tokens[2].toInt();
+    if (rampTimeMs < 0 || rampTimeMs > 600000) {
+        response->println("❌ 錯誤：漸變時間必須在 0 - 600000 ms 之間");
+        return;
+    }
+
+    auto& uart1 = peripheralManager.getUART1();
+    if (uart1.getMode() != UART1Mux::MODE_PWM_RPM) {
+        response->println("❌ 錯誤：UART1 不在 PWM/RPM 模式");
+        return;
+    }
+
+    if (tokens[0] == "PWM_FREQ") {
+        uint32_t freq = tokens[1].toInt();
+        uint32_t maxFreq = uart1.getMaxFrequency();
+        if (freq < 10 || freq > 500000) {
+            response->println("❌ 錯誤：頻率必須在 10 - 500000 Hz 之間");
+            return;
+        }
+        if (freq > maxFreq) {
+            response->printf("❌ 錯誤：頻率超過最大限制 %u Hz\n", maxFreq);
+            return;
+        }
+
+        uint32_t startFreq = uart1.getPWMFrequency();
+        if (uart1.rampPWMFrequency(freq, rampTimeMs, profile)) {
+            if (rampTimeMs == 0) {
+                response->printf("✅ 漸變時間為 0，頻率已立即設定為 %u Hz\n", freq);
+            } else {
+                response->printf("✅ 開始頻率漸變: %u Hz → %u Hz (耗時 %ld ms, %s)\n",
+                                startFreq, freq, rampTimeMs, PWMRamp::getProfileName(profile));
+            }
+        } else {
+            response->println("❌ 啟動頻率漸變失敗（PWM 未啟用或需要變更預除頻，請先以 SET PWM_FREQ 設定接近的頻率）");
+            return;
+        }
+    } else if (tokens[0] == "PWM_DUTY") {
+        float duty = tokens[1].toFloat();
+        if (duty < 0.0 || duty > 100.0) {
+            response->println("❌ 錯誤：占空比必須在 0 - 100% 之間");
+            return;
+        }
+
+        float startDuty = uart1.getPWMDuty();
+        if (uart1.rampPWMDuty(duty, rampTimeMs, profile)) {
+            if (rampTimeMs == 0) {
+                response->printf("✅ 漸變時間為 0，占空比已立即設定為 %.1f%%\n", duty);
+            } else {
+                response->printf("✅ 開始占空比漸變: %.1f%% → %.1f%% (耗時 %ld ms, %s)\n",
+                                startDuty, duty, rampTimeMs, PWMRamp::getProfileName(profile));
+            }
+        } else {
+            response->println("❌ 啟動占空比漸變失敗（PWM 未啟用）");
+            return;
+        }
+    } else {
+        response->println("❌ 錯誤：不支援的 RAMP 參數（支援: PWM_FREQ, PWM_DUTY）");
+        return;
+    }
+
+    response->println("ℹ️ 使用 RAMP STATUS 查詢進度");
+
+    // Notify web clients - they will see gradual change via periodic updates
+    if (webServerManager.isRunning()) {
+        webServerManager.broadcastStatus();
+    }
+}
+
+void CommandParser::handleRampStatus(ICommandResponse* response) {
+    auto& uart1 = peripheralManager.getUART1();
+    UART1Mux::RampStatus status = uart1.getRampStatus();
+
+    response->println("=== PWM 漸變狀態 ===");
+    if (!status.active) {
+        response->println("目前沒有進行中的漸變");
+        response->printf("PWM: %u Hz, %.1f%%\n", uart1.getPWMFrequency(), uart1.getPWMDuty());
+        response->println("");
+        return;
+    }
+
+    const char* unit = status.frequencyRamp ? "Hz" : "%";
+    uint32_t elapsed = status.elapsedMs < status.durationMs ? status.elapsedMs : status.durationMs;
+
+    response->printf("參數: %s (%s)\n", status.frequencyRamp ? "PWM_FREQ" : "PWM_DUTY",
+                    PWMRamp::getProfileName(status.profile));
+    response->printf("起點 → 目標: %.1f %s → %.1f %s\n", status.startValue, unit, status.targetValue, unit);
+    response->printf("進度: 步驟 %u / %u (%.0f%%)\n", status.step, status.steps,
+                    status.steps ? status.step * 100.0f / status.steps : 0.0f);
+    response->printf("時間: %u / %u ms\n", elapsed, status.durationMs);
+    response->printf("步進來源: %s\n", status.timerPaced ? "硬體計時器" : "MCPWM TEZ 中斷");
+    response->printf("目前輸出: %u Hz, %.1f%%\n", uart1.getPWMFrequency(), uart1.getPWMDuty());
+    response->println("");
+}
+
+void CommandParser::handleRampStop(ICommandResponse* response) {
+    auto& uart1 = peripheralManager.getUART1();
+
+    if (!uart1.isRamping()) {
+        response->println("ℹ️ 目前沒有進行中的漸變");
+        return;
+    }
+
+    uart1.stopRamp();
+    response->printf("✅ 漸變已停止，保持在 %u Hz, %.1f%%\n", uart1.getPWMFrequency(), uart1.getPWMDuty());
+
+    if (webServerManager.isRunning()) {
+        webServerManager.broadcastStatus();
+    }
+}
+
+// ==================== PWM Sequencer ====================
+
+void CommandParser::handleSequence(const String& cmd, ICommandResponse* response) {
+    // SEQ ADD <Hz> <%> <ms>[; ...] | SEQ CLEAR | SEQ LIST | SEQ LOOP <index> | SEQ SAVE | SEQ LOAD
+    String params = cmd.substring(4);  // Remove "SEQ "
+    params.trim();
+
+    auto& uart1 = peripheralManager.getUART1();
+
+    if (uart1.isSequencePlaying() && params != "LIST" && params != "SAVE") {
+        response->println("❌ 錯誤：序列播放中，請先 SEQ STOP");
+        return;
+    }
+
+    if (params.startsWith("ADD ")) {
+        String points = params.substring(4);
+        int added = 0;
+        while (points.length() > 0) {
+            int sep = points.indexOf(';');
+            String point = sep == -1 ? points : points.substring(0, sep);
+            points = sep == -1 ? "" : points.substring(sep + 1);
+            point.trim();
+            if (point.length() == 0) {
+                continue;
+            }
+
+            PWMSequenceEntry entry;
+            if (!PWMSequence::parseEntry(point.c_str(), entry)) {
+                response->printf("❌ 錯誤：序列點格式錯誤或超出範圍: %s\n", point.c_str());
+                response->println("   格式: <Hz 1-500000> <占空比 0-100> <停留 1-3600000 ms>");
+                break;
+            }
+            if (!uart1.appendSequence(entry)) {
+                response->printf("❌ 錯誤：序列已滿 (最多 %u 點)\n", (unsigned)PWMSequence::MAX_ENTRIES);
+                break;
+            }
+            added++;
+        }
+        if (added > 0) {
+            response->printf("✅ 已新增 %d 點，序列共 %u 點\n", added, uart1.getSequenceLength());
+        }
+    } else if (params == "CLEAR") {
+        uart1.clearSequence();
+        response->println("✅ 序列已清除");
+    } else if (params == "LIST") {
+        uint32_t length = uart1.getSequenceLength();
+        response->printf("=== PWM 序列 (%u 點, 重複自第 %u 點) ===\n", length, uart1.getSequenceLoopStart());
+        for (uint32_t i = 0; i < length; i++) {
+            const PWMSequenceEntry* entry = uart1.getSequenceEntry(i);
+            response->printf("  %4u: %6u Hz  %5.1f%%  %7u ms\n", i, entry->frequency, entry->duty, entry->dwellMs);
+        }
+        if (length == 0) {
+            response->println("  (空)");
+        }
+        response->println("");
+    } else if (params.startsWith("LOOP ")) {
+        String value = params.substring(5);
+        value.trim();
+        long index = value.toInt();
+        if (index < 0 || !uart1.setSequenceLoopStart((uint32_t)index)) {
+            response->printf("❌ 錯誤：重複起點必須在 0 - %d 之間\n", (int)uart1.getSequenceLength() - 1);
+            return;
+        }
+        response->printf("✅ 重複播放將從第 %ld 點開始\n", index);
+    } else if (params == "SAVE") {
+        if (!uart1.saveSequence()) {
+            response->println("❌ 儲存序列失敗（序列為空或檔案系統錯誤）");
+            return;
+        }
+        response->printf("✅ 序列已儲存到快閃記憶體 (%u 點)\n", uart1.getSequenceLength());
+    } else if (params == "LOAD") {
+        if (!uart1.loadSequence()) {
+            response->println("❌ 載入序列失敗（尚未儲存或檔案格式錯誤）");
+            return;
+        }
+        response->printf("✅ 已從快閃記憶體載入序列 (%u 點)\n", uart1.getSequenceLength());
+    } else {
+        response->println("❌ 錯誤：未知的 SEQ 命令（支援: ADD, CLEAR, LIST, LOOP, PLAY, STOP, STATUS, RESULT, SAVE, LOAD）");
+    }
+}
+
+void CommandParser::handleSequencePlay(const String& cmd, ICommandResponse* response) {
+    // SEQ PLAY [repeat]
+    long repeat = 1;
+    if (cmd.length() > 8) {
+        String value = cmd.substring(9);  // Remove "SEQ PLAY "
+        value.trim();
+        repeat = value.toInt();
+        if (repeat < 0 || (repeat == 0 && value != "0")) {
+            response->println("❌ 錯誤：播放次數必須為 0（無限）或正整數");
+            return;
+        }
+    }
+
+    auto& uart1 = peripheralManager.getUART1();
+    if (uart1.getMode() != UART1Mux::MODE_PWM_RPM) {
+        response->println("❌ 錯誤：UART1 不在 PWM/RPM 模式");
+        return;
+    }
+    if (uart1.getSequenceLength() == 0) {
+        response->println("❌ 錯誤：序列為空，請先以 SEQ ADD 或 SEQ LOAD 建立");
+        return;
+    }
+
+    if (!uart1.playSequence((uint32_t)repeat)) {
+        response->println("❌ 啟動序列失敗（PWM 未啟用、頻率超過上限或頻率跨度無法共用預除頻）");
+        return;
+    }
+
+    UART1Mux::SequenceStatus status = uart1.getSequenceStatus();
+    if (repeat == 0) {
+        response->printf("✅ 開始播放序列: %u 點, 無限重複 (每輪 %llu ms)\n",
+                        status.length, (unsigned long long)status.durationMs);
+    } else {
+        response->printf("✅ 開始播放序列: %u 點 × %ld 次 (共 %llu ms)\n",
+                        status.length, repeat, (unsigned long long)status.durationMs);
+    }
+    response->printf("   預除頻: %u, 最大頻率誤差: %.1f ppm\n", status.prescaler, status.worstPpm);
+    response->println("ℹ️ 使用 SEQ STATUS 查詢進度，SEQ RESULT 下載結果");
+
+    if (webServerManager.isRunning()) {
+        webServerManager.broadcastStatus();
+    }
+}
+
+void CommandParser::handleSequenceStop(ICommandResponse* response) {
+    auto& uart1 = peripheralManager.getUART1();
+
+    if (!uart1.isSequencePlaying()) {
+        response->println("ℹ️ 目前沒有播放中的序列");
+        return;
+    }
+
+    uart1.stopSequence();
+    response->printf("✅ 序列已停止，保持在 %u Hz, %.1f%% (已記錄 %u 步)\n",
+                    uart1.getPWMFrequency(), uart1.getPWMDuty(), uart1.getSequenceResultCount());
+
+    if (webServerManager.isRunning()) {
+        webServerManager.broadcastStatus();
+    }
+}
+
+void CommandParser::handleSequenceStatus(ICommandResponse* response) {
+    auto& uart1 = peripheralManager.getUART1();
+    UART1Mux::SequenceStatus status = uart1.getSequenceStatus();
+
+    response->println("=== PWM 序列狀態 ===");
+    response->printf("狀態: %s\n", status.playing ? "✅ 播放中" : "❌ 未播放");
+    response->printf("序列: %u 點, 重複自第 %u 點\n", status.length, status.loopStart);
+    if (status.playing) {
+        response->printf("進度: 第 %u / %u 點, 第 %u 輪", status.index + 1, status.length, status.pass + 1);
+        if (status.repeat == 0) {
+            response->println(" (無限重複)");
+        } else {
+            response->printf(" / %u 輪\n", status.repeat);
+        }
+        response->printf("時間: %u / %llu ms\n", status.elapsedMs, (unsigned long long)status.durationMs);
+        response->printf("目前輸出: %u Hz, %.1f%%\n", uart1.getPWMFrequency(), uart1.getPWMDuty());
+    }
+    response->printf("已完成步數: %u\n", status.stepsPlayed);
+    response->printf("結果: %u 筆", status.results);
+    if (status.resultsDropped > 0) {
+        response->printf(" (⚠️ 緩衝區已滿，遺失 %u 筆)", status.resultsDropped);
+    }
+    response->println("");
+    if (status.stepsPlayed > 0 || status.playing) {
+        response->printf("預除頻: %u, 最大頻率誤差: %.1f ppm\n", status.prescaler, status.worstPpm);
+    }
+    response->println("");
+}
+
+void CommandParser::handleSequenceResult(const String& cmd, ICommandResponse* response) {
+    // SEQ RESULT [start] [count]
+    auto& uart1 = peripheralManager.getUART1();
+    uint32_t total = uart1.getSequenceResultCount();
+    uint32_t start = 0;
+    uint32_t count = total;
+
+    if (cmd.length() > 10) {
+        String params = cmd.substring(11);  // Remove "SEQ RESULT "
+        params.trim();
+        int space = params.indexOf(' ');
+        start = (uint32_t)params.substring(0, space == -1 ? params.length() : space).toInt();
+        if (space != -1) {
+            String countStr = params.substring(space + 1);
+            countStr.trim();
+            count = (uint32_t)countStr.toInt();
+        }
+    }
+
+    if (start > total) {
+        start = total;
+    }
+    if (count > total - start) {
+        count = total - start;
+    }
+
+    response->printf("# %u / %u results\n", count, total);
+    response->println("index,pass,end_ms,freq_hz,duty_pct,rpm_hz,rpm,flags");
+    for (uint32_t i = start; i < start + count; i++) {
+        const PWMSequenceResult* r = uart1.getSequenceResult(i);
+        if (!r) {
+            break;
+        }
+        response->printf("%u,%u,%u,%u,%.2f,%.2f,%.1f,%u\n", r->index, r->pass, r->endMs,
+                        r->frequency, r->duty, r->rpmFrequency, r->rpm, r->flags);
+    }
+}
+
+// ==================== Fan Characterization ====================
+
+void CommandParser::handleCharacterize(const String& cmd, ICommandResponse* response) {
+    // CHARACTERIZE DUTY <from> <to> <step> [dwell] | FREQ <from> <to> <points> [dwell] | STEP <low> <high> [cycles] [dwell]
+    String params = cmd.substring(13);  // Remove "CHARACTERIZE "
+    params.trim();
+
+    String args[5];
+    int argc = 0;
+    while (params.length() > 0 && argc < 5) {
+        int space = params.indexOf(' ');
+        args[argc++] = space == -1 ? params : params.substring(0, space);
+        params = space == -1 ? "" : params.substring(space + 1);
+        params.trim();
+    }
+    if (params.length() > 0) {
+        argc = 0;  // Too many arguments
+    }
+
+    auto& uart1 = peripheralManager.getUART1();
+    auto& job = peripheralManager.getCharacterizer();
+
+    if (job.isRunning()) {
+        response->println("❌ 錯誤：量測進行中，請先 CHARACTERIZE STOP");
+        return;
+    }
+    if (uart1.getMode() != UART1Mux::MODE_PWM_RPM || !uart1.isPWMEnabled()) {
+        response->println("❌ 錯誤：UART1 不在 PWM/RPM 模式或 PWM 未啟用");
+        return;
+    }
+
+    uint32_t dwellMs = 3000;
+    bool started = false;
+
+    if (args[0] == "DUTY" && (argc == 4 || argc == 5)) {
+        if (argc == 5) {
+            dwellMs = (uint32_t)args[4].toInt();
+        }
+        started = job.startDutySweep(args[1].toFloat(), args[2].toFloat(), args[3].toFloat(), dwellMs);
+    } else if (args[0] == "FREQ" && (argc == 4 || argc == 5)) {
+        if (argc == 5) {
+            dwellMs = (uint32_t)args[4].toInt();
+        }
+        started = job.startFrequencySweep((uint32_t)args[1].toInt(), (uint32_t)args[2].toInt(),
+                                          (uint32_t)args[3].toInt(), dwellMs);
+    } else if (args[0] == "STEP" && argc >= 3) {
+        uint32_t cycles = argc >= 4 ? (uint32_t)args[3].toInt() : 3;
+        if (argc == 5) {
+            dwellMs = (uint32_t)args[4].toInt();
+        }
+        started = job.startStep(args[1].toFloat(), args[2].toFloat(), cycles, dwellMs);
+    } else {
+        response->println("❌ 錯誤：格式錯誤");
+        response->println("   CHARACTERIZE DUTY <起%> <終%> <間隔%> [停留ms]");
+        response->println("   CHARACTERIZE FREQ <起Hz> <終Hz> <點數> [停留ms]");
+        response->println("   CHARACTERIZE STEP <低%> <高%> [次數] [停留ms]");
+        return;
+    }
+
+    if (!started) {
+        response->printf("❌ 啟動量測失敗：參數超出範圍（最多 %u 步, 停留 %u - %u ms, 總時間 ≤ %u 秒）\n",
+                        (unsigned)FanCharacterizer::MAX_STEPS, FanCharacterizer::MIN_DWELL_MS,
+                        FanCharacterizer::MAX_DWELL_MS, FanCharacterizer::MAX_JOB_MS / 1000);
+        return;
+    }
+
+    response->printf("✅ 開始 %s 量測: %u 步 × %u ms (約 %u 秒), 每 %u ms 取樣\n",
+                    job.getModeName(), job.getStepCount(), job.getDwellMs(),
+                    job.getStepCount() * job.getDwellMs() / 1000, job.getSamplePeriodMs());
+    response->println("ℹ️ 量測期間 RPM 濾波器暫時改為原始取樣，手動調整 PWM 會中止量測");
+    response->println("ℹ️ 使用 CHARACTERIZE STATUS 查詢進度，CHARACTERIZE RESULT 取得結果");
+
+    if (webServerManager.isRunning()) {
+        webServerManager.broadcastStatus();
+    }
+}
+
+void CommandParser::handleCharacterizeStop(ICommandResponse* response) {
+    auto& job = peripheralManager.getCharacterizer();
+
+    if (!job.isRunning()) {
+        response->println("ℹ️ 目前沒有進行中的量測");
+        return;
+    }
+
+    job.stop();
+    response->printf("✅ 已要求停止量測 (已完成 %u / %u 步)，將恢復原輸出\n",
+                    job.getCompletedSteps(), job.getStepCount());
+}
+
+void CommandParser::handleCharacterizeStatus(ICommandResponse* response) {
+    auto& job = peripheralManager.getCharacterizer();
+
+    response->println("=== 風扇特性量測狀態 ===");
+    response->printf("狀態: %s\n", job.getStateName());
+    if (job.getState() == FanCharacterizer::STATE_IDLE) {
+        response->println("");
+        return;
+    }
+    response->printf("模式: %s\n", job.getModeName());
+    response->printf("進度: %u / %u 步, 每步 %u ms\n", job.getCompletedSteps(), job.getStepCount(), job.getDwellMs());
+    response->printf("時間: %u ms\n", job.getElapsedMs());
+    response->printf("軌跡: %u 筆 (每 %u ms 取樣)\n", job.getTraceCount(), job.getSamplePeriodMs());
+    if (job.getMessage()[0]) {
+        response->printf("訊息: %s\n", job.getMessage());
+    }
+    response->println("");
+}
+
+void CommandParser::handleCharacterizeResult(ICommandResponse* response) {
+    auto& job = peripheralManager.getCharacterizer();
+    uint32_t count = job.getCompletedSteps();
+
+    response->printf("# %s %s, %u / %u steps\n", job.getModeName(), job.getStateName(), count, job.getStepCount());
+    response->println("step,setpoint,dir,initial_rpm,final_rpm,rise_ms,settle_ms,overshoot_pct,ripple_rpm,settled");
+    for (uint32_t i = 0; i < count; i++) {
+        const FanCharacterizer::Row* row = job.getRow(i);
+        if (!row) {
+            break;
+        }
+        const FanStepMetrics& m = row->metrics;
+        response->printf("%u,%.2f,%s,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%u\n", i, row->setpoint,
+                        row->rising ? "up" : "down", m.initialRpm, m.finalRpm, m.riseMs, m.settleMs,
+                        m.overshootPct, m.rippleRpm, m.settled ? 1 : 0);
+    }
+
+    if (job.getMode() != FanCharacterizer::MODE_FREQ_SWEEP && count > 0) {
+        const FanDeadBand& band = job.getDeadBand();
+        if (band.hasStart) {
+            response->printf("# start_duty=%.2f", band.startDuty);
+        } else {
+            response->print("# start_duty=none");
+        }
+        if (band.hasStop) {
+            response->printf(" stop_duty=%.2f", band.stopDuty);
+        } else {
+            response->print(" stop_duty=none");
+        }
+        response->printf(" threshold_rpm=%.1f\n", band.thresholdRpm);
+    }
+}
+
+void CommandParser::handleCharacterizeTrace(const String& cmd, ICommandResponse* response) {
+    // CHARACTERIZE TRACE [step]
+    auto& job = peripheralManager.getCharacterizer();
+    uint32_t start = 0;
+    uint32_t count = job.getTraceCount();
+
+    if (cmd.length() > 18) {
+        String value = cmd.substring(19);  // Remove "CHARACTERIZE TRACE "
+        value.trim();
+        long step = value.toInt();
+        const FanCharacterizer::Row* row = step >= 0 ? job.getRow((uint32_t)step) : nullptr;
+        if (!row) {
+            response->printf("❌ 錯誤：步驟必須在 0 - %d 之間（僅限已完成步驟）\n", (int)job.getCompletedSteps() - 1);
+            return;
+        }
+        start = row->traceStart;
+        count = row->traceCount;
+    }
+
+    response->printf("# %u samples\n", count);
+    response->println("time_ms,rpm");
+    for (uint32_t i = start; i < start + count; i++) {
+        const FanTraceSample* sample = job.getTraceSample(i);
+        if (!sample) {
+            break;
+        }
+        response->printf("%.1f,%.1f\n", sample->timeUs / 1000.0f, sample->rpm);
+    }
+}
+
+// ==================== Closed-loop RPM Control ====================
+
+void CommandParser::handleMotorRPM(const String& cmd, ICommandResponse* response) {
+    // MOTOR RPM <target> | MOTOR RPM OFF
+    String value = cmd.substring(10);  // Remove "MOTOR RPM "
+    value.trim();
+
+    auto& uart1 = peripheralManager.getUART1();
+
+    if (value == "OFF") {
+        if (!uart1.isRPMLoopActive()) {
+            response->println("ℹ️ 閉迴路轉速控制未啟動");
+            return;
+        }
+        uart1.stopRPMLoop();
+        response->printf("✅ 已離開閉迴路，占空比保持在 %.1f%%\n", uart1.getPWMDuty());
+    } else {
+        float target = value.toFloat();
+        float maxRPM = uart1.getMaxFrequency() * 60.0f / uart1.getPolePairs();
+        if (target <= 0.0f || target > maxRPM) {
+            response->printf("❌ 錯誤：目標轉速必須在 1 - %.0f RPM 之間\n", maxRPM);
+            return;
+        }
+        if (uart1.getMode() != UART1Mux::MODE_PWM_RPM) {
+            response->println("❌ 錯誤：UART1 不在 PWM/RPM 模式");
+            return;
+        }
+
+        bool wasActive = uart1.isRPMLoopActive();
+        if (!uart1.startRPMLoop(target)) {
+            response->println("❌ 啟動閉迴路失敗（PWM 未啟用或計時器無法啟動）");
+            return;
+        }
+
+        if (wasActive) {
+            response->printf("✅ 目標轉速已更新為 %.0f RPM\n", target);
+        } else {
+            RPMController& pid = uart1.getRPMController();
+            response->printf("✅ 閉迴路轉速控制已啟動: 目標 %.0f RPM, 迴路 %u Hz\n",
+                            target, uart1.getRPMLoopRate());
+            response->printf("   PID: Kp=%.4f Ki=%.4f Kd=%.4f, 前饋: %s (%u 點)\n",
+                            pid.getKp(), pid.getKi(), pid.getKd(),
+                            pid.isFeedForwardEnabled() ? "啟用" : "停用", pid.getCurveKnownPoints());
+            response->println("ℹ️ 手動設定 PWM 或 MOTOR STOP 會離開閉迴路");
+        }
+    }
+
     if (webServerManager.isRunning()) {
         webServerManager.broadcastStatus();
     }
 }
 
-// ==================== Advanced Features (Priority 3) ====================
-// REMOVED IN v3.0: Motor control merged to UART1, ramping and filtering not available
-
-// void CommandParser::handleSetPWMFreqRamped(ICommandResponse* response, uint32_t freq, uint32_t rampTimeMs) {
-//     if (freq < MotorLimits::MIN_FREQUENCY || freq > MotorLimits::MAX_FREQUENCY) {
-//         response->printf("❌ 錯誤：頻率必須在 %d - %d Hz 之間\n",
-//                         MotorLimits::MIN_FREQUENCY, MotorLimits::MAX_FREQUENCY);
-//         return;
-//     }
-//
-//     if (rampTimeMs == 0) {
-//         response->println("⚠️ 漸變時間為 0，將立即設定");
-//         handleSetPWMFreq(response, freq);
-//         return;
-//     }
-//
-//     if (motorControl.setPWMFrequencyRamped(freq, rampTimeMs)) {
-//         response->printf("✅ 開始頻率漸變: %d Hz → %d Hz (耗時 %d ms)\n",
-//                         motorControl.getPWMFrequency(), freq, rampTimeMs);
-//
-//         // Notify web clients - they will see gradual change via periodic updates
-//         if (webServerManager.isRunning()) {
-//             webServerManager.broadcastStatus();
-//         }
-//     } else {
-//         response->println("❌ 啟動頻率漸變失敗");
-//     }
-// }
-//
-// void CommandParser::handleSetPWMDutyRamped(ICommandResponse* response, float duty, uint32_t rampTimeMs) {
-//     if (duty < MotorLimits::MIN_DUTY || duty > MotorLimits::MAX_DUTY) {
-//         response->printf("❌ 錯誤：占空比必須在 %.0f - %.0f%% 之間\n",
-//                         MotorLimits::MIN_DUTY, MotorLimits::MAX_DUTY);
-//         return;
-//     }
-//
-//     if (rampTimeMs == 0) {
-//         response->println("⚠️ 漸變時間為 0，將立即設定");
-//         handleSetPWMDuty(response, duty);
-//         return;
-//     }
-//
-//     if (motorControl.setPWMDutyRamped(duty, rampTimeMs)) {
-//         response->printf("✅ 開始占空比漸變: %.1f%% → %.1f%% (耗時 %d ms)\n",
-//                         motorControl.getPWMDuty(), duty, rampTimeMs);
-//
-//         // Notify web clients - they will see gradual change via periodic updates
-//         if (webServerManager.isRunning()) {
-//             webServerManager.broadcastStatus();
-//         }
-//     } else {
-//         response->println("❌ 啟動占空比漸變失敗");
-//     }
-// }
-//
-// void CommandParser::handleSetRPMFilterSize(ICommandResponse* response, uint8_t size) {
-//     if (size < 1 || size > 20) {
-//         response->println("❌ 錯誤：濾波器大小必須在 1 - 20 之間");
-//         return;
-//     }
-//
-//     motorControl.setRPMFilterSize(size);
-//     response->printf("✅ RPM 濾波器大小已設定為: %d 個樣本\n", size);
-// }
-//
-// void CommandParser::handleFilterStatus(ICommandResponse* response) {
-//     response->println("=== RPM 濾波器狀態 ===");
-//     response->printf("濾波器大小: %d 個樣本\n", motorControl.getRPMFilterSize());
-//     response->printf("原始 RPM: %.0f RPM\n", motorControl.getRawRPM());
-//     response->printf("濾波後 RPM: %.0f RPM\n", motorControl.getCurrentRPM());
-//
-//     float difference = motorControl.getCurrentRPM() - motorControl.getRawRPM();
-//     response->printf("濾波差異: %.1f RPM\n", difference);
-//
-//     if (motorControl.isRamping()) {
-//         response->println("");
-//         response->println("⚙️ PWM 漸變進行中...");
-//         response->printf("  當前頻率: %d Hz\n", motorControl.getPWMFrequency());
-//         response->printf("  當前占空比: %.1f%%\n", motorControl.getPWMDuty());
-//     }
-//
-//     response->println("");
-// }
+void CommandParser::handleMotorPID(const String& cmd, ICommandResponse* response) {
+    // MOTOR PID <kp> <ki> <kd>
+    String params = cmd.substring(10);  // Remove "MOTOR PID "
+    params.trim();
+
+    int first = params.indexOf(' ');
+    int second = first > 0 ? params.indexOf(' ', first + 1) : -1;
+    if (first <= 0 || second <= first) {
+        response->println("❌ 錯誤：格式應為 MOTOR PID <kp> <ki> <kd>");
+        return;
+    }
+
+    float kp = params.substring(0, first).toFloat();
+    float ki = params.substring(first + 1, second).toFloat();
+    String kdStr = params.substring(second + 1);
+    kdStr.trim();
+    float kd = kdStr.toFloat();
+
+    if (!peripheralManager.getUART1().getRPMController().setGains(kp, ki, kd)) {
+        response->println("❌ 錯誤：PID 增益不可為負值");
+        return;
+    }
+
+    response->printf("✅ PID 增益設定為: Kp=%.4f Ki=%.4f Kd=%.4f\n", kp, ki, kd);
+    response->println("ℹ️ 使用 SAVE 命令儲存設定");
+}
+
+void CommandParser::handleMotorLoopRate(const String& cmd, ICommandResponse* response) {
+    // MOTOR LOOP <Hz>
+    String value = cmd.substring(11);  // Remove "MOTOR LOOP "
+    value.trim();
+    int hz = value.toInt();
+
+    if (!peripheralManager.getUART1().setRPMLoopRate(hz)) {
+        response->println("❌ 錯誤：迴路頻率必須在 100 - 1000 Hz 之間");
+        return;
+    }
+
+    response->printf("✅ 控制迴路頻率設定為: %d Hz\n", hz);
+    response->println("ℹ️ 使用 SAVE 命令儲存設定");
+}
+
+void CommandParser::handleMotorSlew(const String& cmd, ICommandResponse* response) {
+    // MOTOR SLEW <%/s>
+    String value = cmd.substring(11);  // Remove "MOTOR SLEW "
+    value.trim();
+    float rate = value.toFloat();
+
+    if (!peripheralManager.getUART1().getRPMController().setSlewRate(rate)) {
+        response->println("❌ 錯誤：變化率必須為 0（不限制）或 0.1 - 10000 %/s");
+        return;
+    }
+
+    if (rate == 0.0f) {
+        response->println("✅ 占空比變化率限制已關閉");
+    } else {
+        response->printf("✅ 占空比變化率限制設定為: %.1f %%/s\n", rate);
+    }
+    response->println("ℹ️ 使用 SAVE 命令儲存設定");
+}
+
+void CommandParser::handleMotorFF(const String& cmd, ICommandResponse* response) {
+    // MOTOR FF <ON|OFF|CLEAR>
+    String value = cmd.substring(9);  // Remove "MOTOR FF "
+    value.trim();
+
+    RPMController& pid = peripheralManager.getUART1().getRPMController();
+
+    if (value == "ON") {
+        pid.setFeedForwardEnabled(true);
+        response->printf("✅ 前饋已啟用 (曲線已知 %u / %u 點)\n",
+                        pid.getCurveKnownPoints(), RPMController::CURVE_POINTS);
+    } else if (value == "OFF") {
+        pid.setFeedForwardEnabled(false);
+        response->println("✅ 前饋已停用（僅 PID）");
+    } else if (value == "CLEAR") {
+        pid.clearCurve();
+        response->println("✅ 前饋曲線已清除，將於閉迴路運轉時重新學習");
+    } else {
+        response->println("❌ 錯誤：格式應為 MOTOR FF <ON|OFF|CLEAR>");
+        return;
+    }
+    response->println("ℹ️ 使用 SAVE 命令儲存設定");
+}
+
+void CommandParser::handleMotorLoopStatus(ICommandResponse* response) {
+    auto& uart1 = peripheralManager.getUART1();
+    RPMController& pid = uart1.getRPMController();
+    RPMController::Metrics m = pid.getMetrics();
+
+    response->println("=== 閉迴路轉速控制 ===");
+    response->printf("狀態: %s\n", uart1.isRPMLoopActive() ? "✅ 運作中" : "❌ 未啟動");
+    response->printf("目標 / 實際: %.0f / %.1f RPM\n", pid.getTarget(), uart1.getCalculatedRPM());
+    response->printf("迴路頻率: %u Hz (計時器中斷喚醒控制任務)\n", uart1.getRPMLoopRate());
+    response->printf("PID: Kp=%.4f Ki=%.4f Kd=%.4f\n", pid.getKp(), pid.getKi(), pid.getKd());
+    if (pid.getSlewRate() > 0.0f) {
+        response->printf("變化率限制: %.1f %%/s\n", pid.getSlewRate());
+    } else {
+        response->println("變化率限制: 無");
+    }
+    response->println("");
+
+    response->println("輸出:");
+    response->printf("  占空比: %.2f%% (前饋 %.2f%% + 積分 %.2f%%)\n", m.output, m.feedForward, m.integral);
+    response->println("");
+
+    response->println("統計:");
+    response->printf("  迭代次數: %u\n", m.iterations);
+    response->printf("  迴路週期: %u - %u us (抖動 RMS %.1f us)\n",
+                    m.periodMinUs, m.periodMaxUs, m.jitterRmsUs);
+    response->printf("  誤差: %.1f RPM (RMS %.1f RPM)\n", m.error, m.errorRms);
+    response->printf("  飽和: %u 次 (%.1f%%)\n", m.saturated, m.saturationPct);
+    response->println("");
+
+    response->printf("前饋曲線 (%s):\n", pid.isFeedForwardEnabled() ? "啟用" : "停用");
+    for (uint8_t i = 0; i < RPMController::CURVE_POINTS; i++) {
+        float rpm = pid.getCurvePoint(i);
+        if (rpm >= 0.0f) {
+            response->printf("  %3u%% → %.0f RPM\n", i * 10, rpm);
+        }
+    }
+    if (pid.getCurveKnownPoints() == 0) {
+        response->println("  (尚未學習)");
+    }
+    response->println("");
+}
 
 // ==================== WiFi and Web Server Commands ====================
 
@@ -1269,6 +3140,13 @@ void CommandParser::handleWebStatus(ICommandResponse* response) {
     response->printf("連接埠: %d\n", wifiSettingsManager.get().web_port);
     response->printf("WebSocket 客戶端: %d\n", webServerManager.getWSClientCount());
 
+    uint32_t lastEventId, ticksSkipped, clientsRejected;
+    webServerManager.getSSEStatistics(&lastEventId, &ticksSkipped, &clientsRejected);
+    response->printf("SSE 客戶端: %u / %u (/api/events)\n",
+                     webServerManager.getSSEClientCount(), WebServerManager::SSE_MAX_CLIENTS);
+    response->printf("SSE 推播間隔: %u ms\n", webServerManager.getSSEInterval());
+    response->printf("SSE 事件 ID: %u, 跳過: %u, 拒絕連線: %u\n", lastEventId, ticksSkipped, clientsRejected);
+
     if (wifiManager.isConnected()) {
         response->println("");
         response->printf("存取網址: http://%s/\n", wifiManager.getIPAddress().c_str());
@@ -1277,6 +3155,19 @@ void CommandParser::handleWebStatus(ICommandResponse* response) {
     response->println("");
 }
 
+void CommandParser::handleWebSSE(const String& cmd, ICommandResponse* response) {
+    // WEB SSE <ms>
+    uint32_t intervalMs = cmd.substring(8).toInt();
+
+    if (!webServerManager.setSSEInterval(intervalMs)) {
+        response->printf("❌ 錯誤：SSE 間隔必須在 %u - %u ms 之間\n",
+                         WebServerManager::SSE_MIN_INTERVAL_MS, WebServerManager::SSE_MAX_INTERVAL_MS);
+        return;
+    }
+
+    response->printf("✅ SSE 推播間隔設定為: %u ms\n", intervalMs);
+}
+
 void CommandParser::handleWiFiConnect(const String& cmd, ICommandResponse* response) {
     // Parse command: WIFI <ssid> <password>
     // Format: "WIFI ssid password" or "wifi ssid password"
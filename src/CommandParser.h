@@ -56,17 +56,67 @@ private:
     void handleRPM(ICommandResponse* response);
     void handleMotorStatus(ICommandResponse* response);
     void handleMotorStop(ICommandResponse* response);
+    void handleBatch(const String& cmd, ICommandResponse* response);
+    void handlePreset(const String& cmd, ICommandResponse* response);
     void handleSaveSettings(ICommandResponse* response);
     void handleLoadSettings(ICommandResponse* response);
     void handleResetSettings(ICommandResponse* response);
 
-    // Advanced features (Priority 3) - REMOVED IN v3.0
-    // These functions were removed when motor control merged to UART1
-    // Ramping and filtering features are not available in v3.0
-    // void handleSetPWMFreqRamped(ICommandResponse* response, uint32_t freq, uint32_t rampTimeMs);
-    // void handleSetPWMDutyRamped(ICommandResponse* response, float duty, uint32_t rampTimeMs);
-    // void handleSetRPMFilterSize(ICommandResponse* response, uint8_t size);
-    // void handleFilterStatus(ICommandResponse* response);
+    // RPM measurement filter
+    void handleSetRPMFilter(ICommandResponse* response, const String& type);
+    void handleSetRPMFilterSize(ICommandResponse* response, int size);
+    void handleSetRPMEmaAlpha(ICommandResponse* response, float alpha);
+    void handleSetRPMPeriods(ICommandResponse* response, int periods);
+    void handleSetRPMGate(ICommandResponse* response, int gateMs);
+    void handleSetRPMOutlier(ICommandResponse* response, float percent);
+    void handleFilterStatus(ICommandResponse* response);
+    void handleFilterReset(ICommandResponse* response);
+
+    // RPM stall detection
+    void handleSetRPMStall(ICommandResponse* response, const String& value);
+    void handleSetRPMStallPeriods(ICommandResponse* response, int periods);
+    void handleSetRPMStallAction(ICommandResponse* response, const String& value);
+    void handleStallStatus(ICommandResponse* response);
+    String formatStallActions(uint8_t actions);
+    bool parseStallActions(const String& value, uint8_t& actions);
+
+    // Pulse width / duty measurement (dual-edge capture)
+    void handlePulse(const String& cmd, ICommandResponse* response);
+    void handlePulseStatus(ICommandResponse* response);
+
+    // Logic-analyzer capture (edge timestamps into PSRAM)
+    void handleCaptureStart(const String& cmd, ICommandResponse* response);
+    void handleCaptureTrigger(const String& cmd, ICommandResponse* response);
+    void handleCapturePre(const String& cmd, ICommandResponse* response);
+    void handleCaptureStatus(ICommandResponse* response);
+    void handleCaptureDump(const String& cmd, ICommandResponse* response, CommandSource source);
+
+    // PWM ramp (hardware-timed, non-blocking)
+    void handleRamp(const String& cmd, ICommandResponse* response);
+    void handleRampStatus(ICommandResponse* response);
+    void handleRampStop(ICommandResponse* response);
+
+    // PWM sequencer (profile playback with per-step RPM capture)
+    void handleSequence(const String& cmd, ICommandResponse* response);
+    void handleSequencePlay(const String& cmd, ICommandResponse* response);
+    void handleSequenceStop(ICommandResponse* response);
+    void handleSequenceStatus(ICommandResponse* response);
+    void handleSequenceResult(const String& cmd, ICommandResponse* response);
+
+    // Fan characterization (background sweep / step-response job)
+    void handleCharacterize(const String& cmd, ICommandResponse* response);
+    void handleCharacterizeStop(ICommandResponse* response);
+    void handleCharacterizeStatus(ICommandResponse* response);
+    void handleCharacterizeResult(ICommandResponse* response);
+    void handleCharacterizeTrace(const String& cmd, ICommandResponse* response);
+
+    // Closed-loop RPM control
+    void handleMotorRPM(const String& cmd, ICommandResponse* response);
+    void handleMotorPID(const String& cmd, ICommandResponse* response);
+    void handleMotorLoopRate(const String& cmd, ICommandResponse* response);
+    void handleMotorSlew(const String& cmd, ICommandResponse* response);
+    void handleMotorFF(const String& cmd, ICommandResponse* response);
+    void handleMotorLoopStatus(ICommandResponse* response);
 
     // WiFi and Web Server commands (WiFi Web Server feature)
     void handleWiFiConnect(const String& cmd, ICommandResponse* response);
@@ -76,6 +126,7 @@ private:
     void handleWiFiStop(ICommandResponse* response);
     void handleWiFiScan(ICommandResponse* response);
     void handleWebStatus(ICommandResponse* response);
+    void handleWebSSE(const String& cmd, ICommandResponse* response);
 
     // Peripheral commands (UART, Buzzer, LED, Relay, GPIO, Keys)
     void handleUART1Mode(const String& cmd, ICommandResponse* response);
@@ -83,21 +134,61 @@ private:
     void handleUART1PWM(const String& cmd, ICommandResponse* response);
     void handleUART1Status(ICommandResponse* response);
     void handleUART1Write(const String& cmd, ICommandResponse* response);
+    void handleUART1Bench(const String& cmd, ICommandResponse* response);
     void handleUART2Config(const String& cmd, ICommandResponse* response);
     void handleUART2Status(ICommandResponse* response);
     void handleUART2Write(const String& cmd, ICommandResponse* response);
+    void handleUART2Frame(const String& cmd, ICommandResponse* response);
+    void handleUART2Read(const String& cmd, ICommandResponse* response);
+    void handleUARTBert(const String& cmd, ICommandResponse* response, uint8_t port);
+    void handleUARTBertStatus(ICommandResponse* response);
+    void handleUARTTxBench(const String& cmd, ICommandResponse* response, uint8_t port);
+
+    // UART2 packet link
+    void handlePacketStart(const String& cmd, ICommandResponse* response);
+    void handlePacketStop(ICommandResponse* response);
+    void handlePacketSend(const String& cmd, ICommandResponse* response, bool exchange);
+    void handlePacketRecv(const String& cmd, ICommandResponse* response);
+    void handlePacketStream(const String& cmd, ICommandResponse* response);
+    void handlePacketStatus(ICommandResponse* response);
+
+    // UART2 Modbus RTU server
+    void handleModbusStart(const String& cmd, ICommandResponse* response);
+    void handleModbusStop(ICommandResponse* response);
+    void handleModbusStatus(ICommandResponse* response);
+
+    // UART traffic sniffer
+    void handleSnifferStart(const String& cmd, ICommandResponse* response);
+    void handleSnifferStop(ICommandResponse* response);
+    void handleSnifferStatus(ICommandResponse* response);
+    void handleSnifferTail(const String& cmd, ICommandResponse* response);
+    void handleBridge(const String& cmd, ICommandResponse* response, CommandSource source);
+    void handleBridgeStatus(ICommandResponse* response);
+
+    // HID data reports <-> UART
+    void handleHIDChannelStart(const String& cmd, ICommandResponse* response);
+    void handleHIDChannelStop(ICommandResponse* response);
+    void handleHIDChannelStatus(ICommandResponse* response);
     void handleBuzzerControl(const String& cmd, ICommandResponse* response);
     void handleBuzzerBeep(const String& cmd, ICommandResponse* response);
     void handleLEDPWM(const String& cmd, ICommandResponse* response);
     void handleLEDFade(const String& cmd, ICommandResponse* response);
     void handleRelayControl(const String& cmd, ICommandResponse* response);
     void handleGPIOControl(const String& cmd, ICommandResponse* response);
+    void handlePatternEdit(const String& cmd, ICommandResponse* response);
+    void handlePatternPlay(const String& cmd, ICommandResponse* response);
+    void handlePatternStop(ICommandResponse* response);
+    void handlePatternStatus(ICommandResponse* response);
     void handleKeysStatus(ICommandResponse* response);
     void handleKeysConfig(const String& cmd, ICommandResponse* response);
     void handleKeysMode(const String& cmd, ICommandResponse* response);
     void handlePeripheralStatus(ICommandResponse* response);
     void handlePeripheralStats(ICommandResponse* response);
 
+    // Fan bank commands (multi-channel PWM/tach)
+    void handleFanStatus(ICommandResponse* response);
+    void handleFanChannel(const String& cmd, ICommandResponse* response);
+
     // Peripheral settings commands
     void handlePeripheralSave(ICommandResponse* response);
     void handlePeripheralLoad(ICommandResponse* response);
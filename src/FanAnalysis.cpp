@@ -0,0 +1,184 @@
+#include "FanAnalysis.h"
+#include <math.h>
+
+FanAnalysis::Options FanAnalysis::defaultOptions() {
+    Options options;
+    options.settleBand = 0.02f;
+    options.steadyFraction = 0.25f;
+    options.minDeltaRpm = 10.0f;
+    return options;
+}
+
+FanStepMetrics FanAnalysis::analyzeStep(const FanTraceSample* samples, size_t count, uint32_t stepTimeUs,
+                                        float initialRpm, const Options& options) {
+    FanStepMetrics m = {};
+    m.initialRpm = initialRpm;
+    m.finalRpm = initialRpm;
+    m.samples = (uint32_t)count;
+    if (count == 0) {
+        return m;
+    }
+
+    // Final value and ripple from the steady tail (at least one sample)
+    uint32_t endUs = samples[count - 1].timeUs;
+    uint32_t tailUs = (uint32_t)((float)(endUs - stepTimeUs) * options.steadyFraction);
+    size_t tailStart = count - 1;
+    while (tailStart > 0 && samples[tailStart - 1].timeUs >= endUs - tailUs) {
+        tailStart--;
+    }
+    double sum = 0.0;
+    double sumSq = 0.0;
+    size_t tailCount = count - tailStart;
+    for (size_t i = tailStart; i < count; i++) {
+        sum += samples[i].rpm;
+        sumSq += (double)samples[i].rpm * samples[i].rpm;
+    }
+    double mean = sum / tailCount;
+    double variance = sumSq / tailCount - mean * mean;
+    m.finalRpm = (float)mean;
+    m.rippleRpm = variance > 0.0 ? (float)sqrt(variance) : 0.0f;
+
+    float delta = m.finalRpm - initialRpm;
+    if (fabsf(delta) < options.minDeltaRpm) {
+        m.settled = true;
+        return m;
+    }
+    m.transition = true;
+
+    // Work on the change normalised to 0 → 1 so rising and falling steps share the logic
+    float sign = delta > 0.0f ? 1.0f : -1.0f;
+    float magnitude = fabsf(delta);
+    float base = fabsf(m.finalRpm) > magnitude ? fabsf(m.finalRpm) : magnitude;
+    float band = options.settleBand * base / magnitude;
+
+    bool have10 = false;
+    bool have90 = false;
+    uint32_t t10 = 0, t90 = 0;
+    float peak = 0.0f;
+    size_t lastOutside = count;  // None yet
+
+    for (size_t i = 0; i < count; i++) {
+        float progress = (samples[i].rpm - initialRpm) * sign / magnitude;
+        uint32_t t = samples[i].timeUs - stepTimeUs;
+        if (!have10 && progress >= 0.1f) {
+            have10 = true;
+            t10 = t;
+        }
+        if (!have90 && progress >= 0.9f) {
+            have90 = true;
+            t90 = t;
+        }
+        if (progress > peak) {
+            peak = progress;
+        }
+        if (fabsf(progress - 1.0f) > band) {
+            lastOutside = i;
+        }
+    }
+
+    if (have10 && have90) {
+        m.riseMs = (float)(t90 - t10) / 1000.0f;
+    }
+    m.overshootPct = peak > 1.0f ? (peak - 1.0f) * 100.0f : 0.0f;
+
+    if (lastOutside == count) {
+        m.settleMs = 0.0f;  // Already inside the band at the first reading
+        m.settled = true;
+    } else if (lastOutside + 1 < count) {
+        m.settleMs = (float)(samples[lastOutside + 1].timeUs - stepTimeUs) / 1000.0f;
+        m.settled = true;
+    } else {
+        m.settleMs = (float)(samples[count - 1].timeUs - stepTimeUs) / 1000.0f;
+        m.settled = false;
+    }
+    return m;
+}
+
+FanDeadBand FanAnalysis::findDeadBand(const float* duty, const float* rpm, const bool* rising, size_t count,
+                                      float thresholdFraction) {
+    FanDeadBand result = {};
+
+    float maxRpm = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        if (rpm[i] > maxRpm) {
+            maxRpm = rpm[i];
+        }
+    }
+    result.thresholdRpm = thresholdFraction * maxRpm;
+    if (result.thresholdRpm < 1.0f) {
+        result.thresholdRpm = 1.0f;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        bool turning = rpm[i] > result.thresholdRpm;
+        if (rising[i] && turning && (!result.hasStart || duty[i] < result.startDuty)) {
+            result.hasStart = true;
+            result.startDuty = duty[i];
+        }
+        if (!rising[i] && !turning && (!result.hasStop || duty[i] > result.stopDuty)) {
+            result.hasStop = true;
+            result.stopDuty = duty[i];
+        }
+    }
+    return result;
+}
+
+size_t FanAnalysis::planDutySweep(float fromDuty, float toDuty, float stepDuty, float* out, bool* rising,
+                                  size_t maxSteps) {
+    if (!(fromDuty >= 0.0f && toDuty <= 100.0f && fromDuty < toDuty && stepDuty > 0.0f)) {
+        return 0;
+    }
+
+    size_t intervals = (size_t)ceilf((toDuty - fromDuty) / stepDuty - 1e-4f);
+    size_t total = 2 * intervals + 1;
+    if (intervals == 0 || total > maxSteps) {
+        return 0;
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i <= intervals; i++) {
+        float duty = fromDuty + stepDuty * i;
+        out[n] = duty > toDuty ? toDuty : duty;
+        rising[n++] = true;
+    }
+    for (size_t i = intervals; i-- > 0;) {
+        out[n] = out[i];
+        rising[n++] = false;
+    }
+    return n;
+}
+
+size_t FanAnalysis::planFrequencySweep(float fromHz, float toHz, size_t points, float* out, bool* rising,
+                                       size_t maxSteps) {
+    if (!(fromHz > 0.0f && toHz > fromHz) || points < 2 || points > maxSteps) {
+        return 0;
+    }
+
+    float ratio = logf(toHz / fromHz);
+    for (size_t i = 0; i < points; i++) {
+        out[i] = roundf(fromHz * expf(ratio * (float)i / (float)(points - 1)));
+        rising[i] = true;
+    }
+    out[points - 1] = toHz;
+    return points;
+}
+
+size_t FanAnalysis::planStep(float lowDuty, float highDuty, size_t cycles, float* out, bool* rising,
+                             size_t maxSteps) {
+    if (!(lowDuty >= 0.0f && highDuty <= 100.0f && lowDuty < highDuty) || cycles == 0 ||
+        2 * cycles + 1 > maxSteps) {
+        return 0;
+    }
+
+    // Settle at the low level first so the first up-step starts from steady state
+    size_t n = 0;
+    out[n] = lowDuty;
+    rising[n++] = false;
+    for (size_t c = 0; c < cycles; c++) {
+        out[n] = highDuty;
+        rising[n++] = true;
+        out[n] = lowDuty;
+        rising[n++] = false;
+    }
+    return n;
+}
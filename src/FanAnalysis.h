@@ -0,0 +1,109 @@
+#ifndef FAN_ANALYSIS_H
+#define FAN_ANALYSIS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief One RPM reading of a characterization trace
+ */
+struct FanTraceSample {
+    uint32_t timeUs;        ///< Since job start
+    float rpm;
+};
+
+/**
+ * @brief Transition metrics of one step
+ *
+ * Times are measured from the moment the setpoint was applied. rise is
+ * the 10 % → 90 % time of the change, settle the time after which the
+ * reading stays within the settle band of the final value. A step whose
+ * change is below the minimum delta has no transition (rise/settle 0).
+ */
+struct FanStepMetrics {
+    float initialRpm;       ///< Steady value before the step
+    float finalRpm;         ///< Mean over the steady tail of the step
+    float rippleRpm;        ///< Standard deviation over the steady tail
+    float riseMs;
+    float settleMs;
+    float overshootPct;     ///< Peak beyond final, % of the change
+    uint32_t samples;
+    bool transition;        ///< Change exceeded the minimum delta
+    bool settled;           ///< Reading was inside the band at the end of the step
+};
+
+/**
+ * @brief Start/stop duty of the fan
+ *
+ * startDuty is the lowest duty on the rising sweep that turns the fan,
+ * stopDuty the highest duty on the falling sweep where it has stopped;
+ * the difference is the start-up hysteresis.
+ */
+struct FanDeadBand {
+    bool hasStart;
+    bool hasStop;
+    float startDuty;
+    float stopDuty;
+    float thresholdRpm;     ///< "Turning" means above this
+};
+
+/**
+ * @brief Step-response and sweep analysis for fan characterization
+ *
+ * Pure computation, no hardware access, so recorded traces can be
+ * analysed on the host with the same code the firmware runs. Also
+ * builds the setpoint lists the characterization job walks through.
+ */
+namespace FanAnalysis {
+
+    /**
+     * @brief Analysis tuning
+     */
+    struct Options {
+        float settleBand;           ///< Fraction of max(|final|, |change|), e.g. 0.02
+        float steadyFraction;       ///< Tail of the step averaged for the final value
+        float minDeltaRpm;          ///< Smaller changes are not treated as transitions
+    };
+
+    Options defaultOptions();
+
+    /**
+     * @brief Analyse the samples recorded during one step
+     * @param samples Trace entries of this step, in time order
+     * @param stepTimeUs Time the setpoint was applied (same base as samples)
+     * @param initialRpm Steady value before the step (previous step's final)
+     */
+    FanStepMetrics analyzeStep(const FanTraceSample* samples, size_t count, uint32_t stepTimeUs,
+                               float initialRpm, const Options& options);
+
+    /**
+     * @brief Find start/stop duty from a sweep
+     * @param rising Per step: true on the upward half of the sweep
+     * @param thresholdFraction Fraction of the highest RPM that counts as turning
+     */
+    FanDeadBand findDeadBand(const float* duty, const float* rpm, const bool* rising, size_t count,
+                             float thresholdFraction);
+
+    /**
+     * @brief Duty staircase from → to and back down
+     * @return Number of setpoints written, 0 if the arguments are invalid
+     */
+    size_t planDutySweep(float fromDuty, float toDuty, float stepDuty, float* out, bool* rising,
+                         size_t maxSteps);
+
+    /**
+     * @brief Log-spaced frequency points from → to
+     * @return Number of setpoints written, 0 if the arguments are invalid
+     */
+    size_t planFrequencySweep(float fromHz, float toHz, size_t points, float* out, bool* rising,
+                              size_t maxSteps);
+
+    /**
+     * @brief Alternating low → high → low steps
+     * @return Number of setpoints written (a settling step plus 2 per cycle), 0 if the arguments are invalid
+     */
+    size_t planStep(float lowDuty, float highDuty, size_t cycles, float* out, bool* rising,
+                    size_t maxSteps);
+}
+
+#endif // FAN_ANALYSIS_H
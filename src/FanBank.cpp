@@ -0,0 +1,758 @@
+#include "FanBank.h"
+#include "PeripheralPins.h"
+#include "driver/gpio.h"
+#include "esp_timer.h"
+#include <Preferences.h>
+
+// One entry per channel; channel numbers follow the table order
+static const FanChannelPins FAN_CHANNEL_TABLE[] = {
+    {PIN_FAN1_PWM, PIN_FAN1_TACH},
+    {PIN_FAN2_PWM, PIN_FAN2_TACH},
+    {PIN_FAN3_PWM, PIN_FAN3_TACH},
+    {PIN_FAN4_PWM, PIN_FAN4_TACH},
+    {PIN_FAN5_PWM, PIN_FAN5_TACH},
+};
+static const uint8_t FAN_CHANNEL_TABLE_SIZE = sizeof(FAN_CHANNEL_TABLE) / sizeof(FAN_CHANNEL_TABLE[0]);
+
+static const char* NVS_NAMESPACE = "fan_bank";
+
+// MCPWM timer resolution: 10 MHz keeps 0.1 % duty steps at 25 kHz; below
+// 200 Hz the 16-bit period needs the 1 MHz resolution
+static const uint32_t MCPWM_HIGH_RES_HZ = 10000000;
+static const uint32_t MCPWM_LOW_RES_HZ = 1000000;
+static const uint32_t MCPWM_HIGH_RES_MIN_FREQ = 200;
+
+static const uint32_t LEDC_CLOCK_HZ = 80000000;     // APB, chosen by LEDC_AUTO_CLK
+static const uint8_t LEDC_MAX_BITS = 14;
+
+static const int64_t SIGNAL_TIMEOUT_US = 500000;     // Same as UART1
+
+static const uint8_t MCPWM_TIMER_SLOTS = 3;          // Timers of MCPWM_UNIT_FAN
+static const uint8_t CAPTURE_SLOTS = 3;              // Capture channels of MCPWM_UNIT_FAN
+
+FanBank::FanBank() {
+    lock = xSemaphoreCreateMutex();
+}
+
+FanBank::~FanBank() {
+    if (taskHandle) {
+        vTaskDelete(taskHandle);
+        taskHandle = nullptr;
+    }
+    for (uint8_t i = 0; i < channelCount; i++) {
+        if (channels[i].enabled) {
+            releaseHardware(channels[i]);
+        }
+    }
+}
+
+// ============================================================================
+// Initialization
+// ============================================================================
+
+bool FanBank::begin() {
+    if (channelCount > 0) {
+        return true;
+    }
+
+    uint8_t nextMcpwm = 0, nextLedc = 0, nextCapture = 0, nextPcnt = 0;
+    uint8_t tableSize = FAN_CHANNEL_TABLE_SIZE < MAX_CHANNELS ? FAN_CHANNEL_TABLE_SIZE : MAX_CHANNELS;
+
+    for (uint8_t i = 0; i < tableSize; i++) {
+        Channel& c = channels[channelCount];
+        c.pins = FAN_CHANNEL_TABLE[i];
+        c.number = channelCount + 1;
+
+        if (!allocatePWM(c, nextMcpwm, nextLedc) || !allocateTach(c, nextCapture, nextPcnt)) {
+            Serial.printf("[FAN] ❌ No free hardware for GPIO %u/%u, %u channel(s) available\n",
+                          c.pins.pwmPin, c.pins.tachPin, channelCount);
+            break;
+        }
+
+        channelCount++;
+        Serial.printf("[FAN] ✅ Channel %u: PWM GPIO %u (%s), tach GPIO %u (%s), disabled\n",
+                      c.number, c.pins.pwmPin, getPWMDriverName(c.pwmDriver),
+                      c.pins.tachPin, getTachDriverName(c.tachDriver));
+    }
+
+    if (channelCount == 0) {
+        return false;
+    }
+
+    loadSettings();  // Enables the channels saved as enabled
+
+    BaseType_t ok = xTaskCreatePinnedToCore(
+        bankTask,
+        "Fan_Bank",
+        4096,
+        this,
+        3,                  // Same as the UART1 RPM loop
+        &taskHandle,
+        1);
+    if (ok != pdPASS) {
+        taskHandle = nullptr;
+        Serial.println("[FAN] ❌ Bank task creation failed");
+        return false;
+    }
+    return true;
+}
+
+// Slots are only assigned here; the hardware is configured by setEnabled()
+
+bool FanBank::allocatePWM(Channel& c, uint8_t& nextMcpwm, uint8_t& nextLedc) {
+    // A whole MCPWM timer per channel so every channel keeps its own frequency
+    if (nextMcpwm < MCPWM_TIMER_SLOTS) {
+        c.pwmDriver = PWM_MCPWM;
+        c.mcpwmUnit = MCPWM_UNIT_FAN;
+        c.mcpwmTimer = (mcpwm_timer_t)nextMcpwm++;
+        return true;
+    }
+
+    // Then LEDC, one timer per channel for the same reason
+    if (LEDC_TIMER_FAN_FIRST + nextLedc < LEDC_TIMER_MAX &&
+        LEDC_CHANNEL_FAN_FIRST + nextLedc < LEDC_CHANNEL_MAX) {
+        c.pwmDriver = PWM_LEDC;
+        c.ledcTimer = (ledc_timer_t)(LEDC_TIMER_FAN_FIRST + nextLedc);
+        c.ledcChannel = (ledc_channel_t)(LEDC_CHANNEL_FAN_FIRST + nextLedc);
+        nextLedc++;
+        return true;
+    }
+
+    c.pwmDriver = PWM_NONE;
+    return false;
+}
+
+bool FanBank::allocateTach(Channel& c, uint8_t& nextCapture, uint8_t& nextPcnt) {
+    while (nextCapture < CAPTURE_SLOTS) {
+        mcpwm_capture_channel_id_t cap = (mcpwm_capture_channel_id_t)nextCapture;
+        nextCapture++;
+        if (MCPWM_UNIT_FAN == MCPWM_UNIT_UART1_RPM && cap == MCPWM_CAP_UART1_RPM) {
+            continue;
+        }
+        c.tachDriver = TACH_CAPTURE;
+        c.captureUnit = MCPWM_UNIT_FAN;
+        c.captureChannel = cap;
+        return true;
+    }
+
+    while (nextPcnt < PCNT_UNIT_MAX) {
+        pcnt_unit_t unit = (pcnt_unit_t)nextPcnt;
+        nextPcnt++;
+        if (unit == PCNT_UNIT_UART1_RPM) {
+            continue;
+        }
+        c.tachDriver = TACH_PCNT;
+        c.pcntUnit = unit;
+        return true;
+    }
+
+    c.tachDriver = TACH_NONE;
+    return false;
+}
+
+bool FanBank::initMCPWM(Channel& c) {
+    // Generator A of the operator paired with this timer
+    mcpwm_io_signals_t signal = (mcpwm_io_signals_t)(MCPWM0A + 2 * c.mcpwmTimer);
+    if (mcpwm_gpio_init(c.mcpwmUnit, signal, c.pins.pwmPin) != ESP_OK) {
+        return false;
+    }
+    c.mcpwmResolutionHz = 0;  // Forces a full timer init
+    return applyFrequency(c, c.frequency);
+}
+
+bool FanBank::initLEDC(Channel& c) {
+    if (!applyFrequency(c, c.frequency)) {
+        return false;
+    }
+
+    ledc_channel_config_t channel_conf = {};
+    channel_conf.gpio_num = c.pins.pwmPin;
+    channel_conf.speed_mode = LEDC_LOW_SPEED_MODE;
+    channel_conf.channel = c.ledcChannel;
+    channel_conf.intr_type = LEDC_INTR_DISABLE;
+    channel_conf.timer_sel = c.ledcTimer;
+    channel_conf.duty = 0;
+    channel_conf.hpoint = 0;
+    esp_err_t err = ledc_channel_config(&channel_conf);
+    if (err != ESP_OK) {
+        Serial.printf("[FAN] ❌ LEDC channel config failed: %s\n", esp_err_to_name(err));
+        return false;
+    }
+    applyDuty(c, c.duty);  // The channel config starts at duty 0
+    return true;
+}
+
+bool FanBank::initCapture(Channel& c) {
+    mcpwm_io_signals_t signal = (mcpwm_io_signals_t)(MCPWM_CAP_0 + c.captureChannel);
+    if (mcpwm_gpio_init(c.captureUnit, signal, c.pins.tachPin) != ESP_OK) {
+        return false;
+    }
+    gpio_set_pull_mode((gpio_num_t)c.pins.tachPin, GPIO_PULLUP_ONLY);  // Open-collector tach
+
+    mcpwm_capture_config_t cap_conf;
+    cap_conf.cap_edge = MCPWM_POS_EDGE;
+    cap_conf.cap_prescale = 1;
+    cap_conf.capture_cb = captureCallback;
+    cap_conf.user_data = &c;
+
+    c.captureRing.clear();
+    esp_err_t err = mcpwm_capture_enable_channel(c.captureUnit, c.captureChannel, &cap_conf);
+    if (err != ESP_OK) {
+        Serial.printf("[FAN] ❌ MCPWM Capture enable failed: %s\n", esp_err_to_name(err));
+        return false;
+    }
+    return true;
+}
+
+bool FanBank::initPCNT(Channel& c) {
+    pcnt_config_t pcnt_conf = {};
+    pcnt_conf.pulse_gpio_num = c.pins.tachPin;
+    pcnt_conf.ctrl_gpio_num = PCNT_PIN_NOT_USED;
+    pcnt_conf.channel = PCNT_CHANNEL_0;
+    pcnt_conf.unit = c.pcntUnit;
+    pcnt_conf.pos_mode = PCNT_COUNT_INC;       // Count rising edges
+    pcnt_conf.neg_mode = PCNT_COUNT_DIS;
+    pcnt_conf.lctrl_mode = PCNT_MODE_KEEP;
+    pcnt_conf.hctrl_mode = PCNT_MODE_KEEP;
+    pcnt_conf.counter_h_lim = INT16_MAX;       // Max gate × fan tach rate stays far below
+    pcnt_conf.counter_l_lim = 0;
+
+    esp_err_t err = pcnt_unit_config(&pcnt_conf);
+    if (err != ESP_OK) {
+        Serial.printf("[FAN] ❌ PCNT config failed: %s\n", esp_err_to_name(err));
+        return false;
+    }
+    gpio_set_pull_mode((gpio_num_t)c.pins.tachPin, GPIO_PULLUP_ONLY);
+
+    // Tach lines ring on slow open-collector edges: reject pulses under ~12 µs
+    pcnt_set_filter_value(c.pcntUnit, 1000);
+    pcnt_filter_enable(c.pcntUnit);
+
+    pcnt_counter_pause(c.pcntUnit);
+    pcnt_counter_clear(c.pcntUnit);
+    pcnt_counter_resume(c.pcntUnit);
+    c.pcntGateStartUs = esp_timer_get_time();
+    c.pcntLastCount = 0;
+    return true;
+}
+
+void FanBank::releaseHardware(Channel& c) {
+    if (c.tachDriver == TACH_CAPTURE) {
+        mcpwm_capture_disable_channel(c.captureUnit, c.captureChannel);
+    } else if (c.tachDriver == TACH_PCNT) {
+        pcnt_counter_pause(c.pcntUnit);
+    }
+    if (c.pwmDriver == PWM_MCPWM) {
+        mcpwm_stop(c.mcpwmUnit, c.mcpwmTimer);
+    } else if (c.pwmDriver == PWM_LEDC) {
+        ledc_stop(LEDC_LOW_SPEED_MODE, c.ledcChannel, 0);
+    }
+
+    // Back to plain GPIO, output disabled
+    gpio_reset_pin((gpio_num_t)c.pins.pwmPin);
+    gpio_reset_pin((gpio_num_t)c.pins.tachPin);
+    c.mcpwmResolutionHz = 0;
+}
+
+// ============================================================================
+// Output
+// ============================================================================
+
+bool FanBank::applyFrequency(Channel& c, uint32_t frequency) {
+    esp_err_t err = ESP_OK;
+
+    if (c.pwmDriver == PWM_MCPWM) {
+        uint32_t resolution = frequency >= MCPWM_HIGH_RES_MIN_FREQ ? MCPWM_HIGH_RES_HZ : MCPWM_LOW_RES_HZ;
+        if (resolution != c.mcpwmResolutionHz) {
+            // Resolution only takes effect through a timer init
+            err = mcpwm_timer_set_resolution(c.mcpwmUnit, c.mcpwmTimer, resolution);
+            if (err == ESP_OK) {
+                mcpwm_config_t pwm_config;
+                pwm_config.frequency = frequency;
+                pwm_config.cmpr_a = c.duty;
+                pwm_config.cmpr_b = 0;
+                pwm_config.duty_mode = MCPWM_DUTY_MODE_0;
+                pwm_config.counter_mode = MCPWM_UP_COUNTER;
+                err = mcpwm_init(c.mcpwmUnit, c.mcpwmTimer, &pwm_config);
+            }
+            if (err == ESP_OK) {
+                c.mcpwmResolutionHz = resolution;
+            }
+        } else {
+            err = mcpwm_set_frequency(c.mcpwmUnit, c.mcpwmTimer, frequency);
+        }
+        if (err != ESP_OK) {
+            Serial.printf("[FAN] ❌ Channel %u MCPWM %u Hz failed: %s\n", c.number, frequency, esp_err_to_name(err));
+            return false;
+        }
+    } else if (c.pwmDriver == PWM_LEDC) {
+        // Widest duty resolution the 80 MHz clock allows at this frequency
+        uint8_t bits = 1;
+        while (bits < LEDC_MAX_BITS && ((uint64_t)frequency << (bits + 1)) <= LEDC_CLOCK_HZ) {
+            bits++;
+        }
+
+        ledc_timer_config_t timer_conf = {};
+        timer_conf.speed_mode = LEDC_LOW_SPEED_MODE;
+        timer_conf.duty_resolution = (ledc_timer_bit_t)bits;
+        timer_conf.timer_num = c.ledcTimer;
+        timer_conf.freq_hz = frequency;
+        timer_conf.clk_cfg = LEDC_AUTO_CLK;
+        err = ledc_timer_config(&timer_conf);
+        if (err != ESP_OK) {
+            Serial.printf("[FAN] ❌ Channel %u LEDC %u Hz failed: %s\n", c.number, frequency, esp_err_to_name(err));
+            return false;
+        }
+        c.ledcBits = bits;
+    } else {
+        return false;
+    }
+
+    c.frequency = frequency;
+    applyDuty(c, c.duty);  // Compare values are in ticks and must follow the new period
+    return true;
+}
+
+void FanBank::applyDuty(Channel& c, float duty) {
+    if (c.pwmDriver == PWM_MCPWM) {
+        // Force the rails at 0 / 100 % so no narrow pulse is left at the update
+        if (duty <= 0.0f) {
+            mcpwm_set_signal_low(c.mcpwmUnit, c.mcpwmTimer, MCPWM_OPR_A);
+        } else if (duty >= 100.0f) {
+            mcpwm_set_signal_high(c.mcpwmUnit, c.mcpwmTimer, MCPWM_OPR_A);
+        } else {
+            mcpwm_set_duty(c.mcpwmUnit, c.mcpwmTimer, MCPWM_OPR_A, duty);
+            mcpwm_set_duty_type(c.mcpwmUnit, c.mcpwmTimer, MCPWM_OPR_A, MCPWM_DUTY_MODE_0);
+        }
+    } else if (c.pwmDriver == PWM_LEDC) {
+        uint32_t value = (uint32_t)(duty / 100.0f * (float)(1u << c.ledcBits) + 0.5f);
+        ledc_set_duty(LEDC_LOW_SPEED_MODE, c.ledcChannel, value);
+        ledc_update_duty(LEDC_LOW_SPEED_MODE, c.ledcChannel);
+    }
+}
+
+// ============================================================================
+// Channel Control
+// ============================================================================
+
+FanBank::Channel* FanBank::getChannel(uint8_t channel) {
+    return isValidChannel(channel) ? &channels[channel - 1] : nullptr;
+}
+
+const FanBank::Channel* FanBank::getChannel(uint8_t channel) const {
+    return isValidChannel(channel) ? &channels[channel - 1] : nullptr;
+}
+
+bool FanBank::setEnabled(uint8_t channel, bool enabled) {
+    Channel* c = getChannel(channel);
+    if (!c) {
+        return false;
+    }
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool ok = true;
+    if (enabled && !c->enabled) {
+        // Pins are first touched here, with the stored frequency and duty
+        ok = (c->pwmDriver == PWM_MCPWM ? initMCPWM(*c) : initLEDC(*c)) &&
+             (c->tachDriver == TACH_CAPTURE ? initCapture(*c) : initPCNT(*c));
+        if (!ok) {
+            releaseHardware(*c);
+            Serial.printf("[FAN] ❌ Channel %u enable failed\n", c->number);
+        }
+    } else if (!enabled && c->enabled) {
+        releaseHardware(*c);
+    }
+    if (ok && enabled != c->enabled) {
+        c->enabled = enabled;
+        c->filter.reset();
+        c->tachFrequency = 0.0f;
+        c->lastEdgeUs = esp_timer_get_time();
+        c->stallArmed = false;
+        c->stalled = false;
+    }
+    xSemaphoreGive(lock);
+    return ok;
+}
+
+bool FanBank::isEnabled(uint8_t channel) const {
+    const Channel* c = getChannel(channel);
+    return c && c->enabled;
+}
+
+bool FanBank::setFrequency(uint8_t channel, uint32_t frequency) {
+    Channel* c = getChannel(channel);
+    if (!c || frequency < MIN_FREQUENCY || frequency > MAX_FREQUENCY) {
+        return false;
+    }
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool ok = true;
+    if (c->enabled) {
+        ok = applyFrequency(*c, frequency);
+    } else {
+        c->frequency = frequency;  // Applied on enable
+    }
+    xSemaphoreGive(lock);
+    return ok;
+}
+
+bool FanBank::setDuty(uint8_t channel, float duty) {
+    Channel* c = getChannel(channel);
+    if (!c || !(duty >= 0.0f && duty <= 100.0f)) {
+        return false;
+    }
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (c->enabled) {
+        applyDuty(*c, duty);
+    }
+    c->duty = duty;
+    if (duty <= 0.0f) {
+        c->stallArmed = false;  // A fan told to stop is not stalled
+    }
+    xSemaphoreGive(lock);
+    return true;
+}
+
+bool FanBank::setPolePairs(uint8_t channel, uint8_t polePairs) {
+    Channel* c = getChannel(channel);
+    if (!c || polePairs < 1 || polePairs > MAX_POLE_PAIRS) {
+        return false;
+    }
+    c->polePairs = polePairs;
+    return true;
+}
+
+bool FanBank::setStallDetection(uint8_t channel, bool enabled) {
+    Channel* c = getChannel(channel);
+    if (!c) {
+        return false;
+    }
+    xSemaphoreTake(lock, portMAX_DELAY);
+    c->stallEnabled = enabled;
+    c->stallArmed = false;  // Re-armed by the next edge
+    xSemaphoreGive(lock);
+    return true;
+}
+
+bool FanBank::setStallPeriods(uint8_t channel, uint8_t periods) {
+    Channel* c = getChannel(channel);
+    if (!c || periods < UART1Mux::STALL_MIN_PERIODS || periods > UART1Mux::STALL_MAX_PERIODS) {
+        return false;
+    }
+    c->stallPeriods = periods;
+    return true;
+}
+
+bool FanBank::setStallActions(uint8_t channel, uint8_t actions) {
+    Channel* c = getChannel(channel);
+    if (!c) {
+        return false;
+    }
+    c->stallActions = actions & 0x07;
+    return true;
+}
+
+bool FanBank::setFilterType(uint8_t channel, RPMFilter::FilterType type) {
+    Channel* c = getChannel(channel);
+    if (!c) {
+        return false;
+    }
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool ok = c->filter.setFilterType(type);
+    xSemaphoreGive(lock);
+    return ok;
+}
+
+bool FanBank::setFilterWindow(uint8_t channel, uint8_t size) {
+    Channel* c = getChannel(channel);
+    if (!c) {
+        return false;
+    }
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool ok = c->filter.setWindowSize(size);
+    xSemaphoreGive(lock);
+    return ok;
+}
+
+const RPMFilter* FanBank::getRPMFilter(uint8_t channel) const {
+    const Channel* c = getChannel(channel);
+    return c ? &c->filter : nullptr;
+}
+
+float FanBank::getRPM(uint8_t channel) const {
+    const Channel* c = getChannel(channel);
+    if (!c) {
+        return 0.0f;
+    }
+    return c->tachFrequency * 60.0f / (float)c->polePairs;
+}
+
+bool FanBank::getInfo(uint8_t channel, ChannelInfo& info) const {
+    const Channel* c = getChannel(channel);
+    if (!c) {
+        return false;
+    }
+
+    info.pwmPin = c->pins.pwmPin;
+    info.tachPin = c->pins.tachPin;
+    info.pwmDriver = c->pwmDriver;
+    info.tachDriver = c->tachDriver;
+    info.pwmUnit = c->pwmDriver == PWM_MCPWM ? (uint8_t)c->mcpwmUnit : (uint8_t)c->ledcChannel;
+    info.pwmTimer = c->pwmDriver == PWM_MCPWM ? (uint8_t)c->mcpwmTimer : (uint8_t)c->ledcTimer;
+    info.tachUnit = c->tachDriver == TACH_CAPTURE ? (uint8_t)c->captureUnit : (uint8_t)c->pcntUnit;
+    info.tachChannel = (uint8_t)c->captureChannel;
+    info.enabled = c->enabled;
+    info.frequency = c->frequency;
+    info.duty = c->duty;
+    info.polePairs = c->polePairs;
+    info.tachFrequency = c->tachFrequency;
+    info.rpm = getRPM(channel);
+    info.stallEnabled = c->stallEnabled;
+    info.stallPeriods = c->stallPeriods;
+    info.stallActions = c->stallActions;
+    info.stallTimeoutUs = c->stallTimeoutUs;
+    info.stalled = c->stalled;
+    info.stallCount = c->stallCount;
+    info.captureDrops = c->captureRing.getDrops();
+    return true;
+}
+
+const char* FanBank::getPWMDriverName(PWMDriver driver) {
+    switch (driver) {
+        case PWM_MCPWM: return "MCPWM";
+        case PWM_LEDC:  return "LEDC";
+        default:        return "None";
+    }
+}
+
+const char* FanBank::getTachDriverName(TachDriver driver) {
+    switch (driver) {
+        case TACH_CAPTURE: return "Capture";
+        case TACH_PCNT:    return "PCNT";
+        default:           return "None";
+    }
+}
+
+void FanBank::setStallCallback(StallCallback callback, void* arg) {
+    stallCallbackArg = arg;
+    stallCallback = callback;
+}
+
+// ============================================================================
+// Measurement (bank task)
+// ============================================================================
+
+bool IRAM_ATTR FanBank::captureCallback(mcpwm_unit_t mcpwm,
+                                         mcpwm_capture_channel_id_t cap_channel,
+                                         const cap_event_data_t *edata,
+                                         void *user_data) {
+    // Same ring as UART1; a full ring only drops (fan rates never keep it full)
+    static_cast<Channel*>(user_data)->captureRing.push(edata->cap_value);
+    return false;
+}
+
+void FanBank::bankTask(void* arg) {
+    FanBank* self = static_cast<FanBank*>(arg);
+    TickType_t lastWake = xTaskGetTickCount();
+    for (;;) {
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(POLL_PERIOD_MS));
+        self->poll();
+    }
+}
+
+void FanBank::poll() {
+    UART1Mux::StallEvent events[MAX_CHANNELS];
+    bool stalls[MAX_CHANNELS];
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    int64_t nowUs = esp_timer_get_time();
+    for (uint8_t i = 0; i < channelCount; i++) {
+        stalls[i] = channels[i].enabled && measure(channels[i], nowUs, events[i]);
+    }
+    xSemaphoreGive(lock);
+
+    // Callbacks may block (buzzer), so they run without the lock
+    for (uint8_t i = 0; i < channelCount; i++) {
+        if (!stalls[i]) {
+            continue;
+        }
+        const UART1Mux::StallEvent& event = events[i];
+        Serial.printf("[FAN] ⚠️ Channel %u stall #%u: no tach edge for %u µs (timeout %u µs), was %.0f RPM at %.1f%%%s\n",
+                      i + 1, event.sequence, event.detectUs, event.timeoutUs, event.lastRpm, event.duty,
+                      (event.actions & UART1Mux::STALL_ACTION_CUT_PWM) ? ", PWM cut" : "");
+        if (stallCallback) {
+            stallCallback(i + 1, event, stallCallbackArg);
+        }
+    }
+}
+
+bool FanBank::measure(Channel& c, int64_t nowUs, UART1Mux::StallEvent& event) {
+    bool gotEdge = false;
+
+    if (c.tachDriver == TACH_CAPTURE) {
+        uint32_t timestamp;
+        bool gap;
+        while (c.captureRing.pop(timestamp, gap)) {
+            if (gap) {
+                c.filter.markGap();
+            }
+            c.filter.addEdge(timestamp);
+            gotEdge = true;
+        }
+    } else if (c.tachDriver == TACH_PCNT) {
+        // Gate stretches until enough edges are in, so slow fans still get resolution
+        int16_t count = 0;
+        pcnt_get_counter_value(c.pcntUnit, &count);
+        gotEdge = count != c.pcntLastCount;
+        c.pcntLastCount = count;
+
+        int64_t elapsedUs = nowUs - c.pcntGateStartUs;
+        if ((count >= PCNT_MIN_COUNTS && elapsedUs >= (int64_t)PCNT_MIN_GATE_MS * 1000) ||
+            elapsedUs >= (int64_t)PCNT_MAX_GATE_MS * 1000) {
+            pcnt_counter_clear(c.pcntUnit);
+            c.pcntGateStartUs = nowUs;
+            c.pcntLastCount = 0;
+            if (count > 0) {
+                c.filter.addSample((float)((double)count * 1000000.0 / elapsedUs));
+            }
+        }
+    }
+
+    if (gotEdge) {
+        c.lastEdgeUs = nowUs;
+        c.stalled = false;
+        c.stallArmed = c.stallEnabled && c.duty > 0.0f;
+    }
+
+    // Checked before the signal timeout so the event still carries the last reading
+    if (c.stallArmed && nowUs - c.lastEdgeUs > (int64_t)c.stallTimeoutUs) {
+        c.stallArmed = false;
+        c.stalled = true;
+        c.stallCount++;
+
+        event = {};
+        event.sequence = c.stallCount;
+        event.timeMs = millis();
+        event.detectUs = (uint32_t)(nowUs - c.lastEdgeUs);
+        event.timeoutUs = c.stallTimeoutUs;
+        event.lastRpm = c.lastRpm;
+        event.duty = c.duty;
+        event.actions = c.stallActions;
+
+        if (c.stallActions & UART1Mux::STALL_ACTION_CUT_PWM) {
+            applyDuty(c, 0.0f);
+            c.duty = 0.0f;
+        }
+        c.filter.reset();
+        c.tachFrequency = 0.0f;
+        return true;
+    }
+
+    if (nowUs - c.lastEdgeUs > SIGNAL_TIMEOUT_US) {
+        if (c.tachFrequency != 0.0f) {
+            c.filter.reset();  // Next edge starts a fresh measurement
+        }
+        c.tachFrequency = 0.0f;
+    } else {
+        c.tachFrequency = c.filter.getFrequency();
+    }
+
+    if (c.tachFrequency > 0.0f) {
+        c.lastRpm = c.tachFrequency * 60.0f / (float)c.polePairs;
+        float t = 1000000.0f * c.stallPeriods / c.tachFrequency;
+        if (t < (float)STALL_MIN_TIMEOUT_US) {
+            c.stallTimeoutUs = STALL_MIN_TIMEOUT_US;
+        } else if (t > (float)UART1Mux::STALL_MAX_TIMEOUT_US) {
+            c.stallTimeoutUs = UART1Mux::STALL_MAX_TIMEOUT_US;
+        } else {
+            c.stallTimeoutUs = (uint32_t)t;
+        }
+    }
+    return false;
+}
+
+// ============================================================================
+// Settings Persistence
+// ============================================================================
+
+bool FanBank::saveSettings() {
+    Preferences prefs;
+    if (!prefs.begin(NVS_NAMESPACE, false)) {
+        Serial.println("[FAN] Failed to open NVS for saving");
+        return false;
+    }
+
+    char key[16];
+    for (uint8_t i = 0; i < channelCount; i++) {
+        const Channel& c = channels[i];
+        snprintf(key, sizeof(key), "c%uFreq", c.number);
+        prefs.putUInt(key, c.frequency);
+        snprintf(key, sizeof(key), "c%uDuty", c.number);
+        prefs.putFloat(key, c.duty);
+        snprintf(key, sizeof(key), "c%uPoles", c.number);
+        prefs.putUChar(key, c.polePairs);
+        snprintf(key, sizeof(key), "c%uFilter", c.number);
+        prefs.putUChar(key, c.filter.getFilterType());
+        snprintf(key, sizeof(key), "c%uWindow", c.number);
+        prefs.putUChar(key, c.filter.getWindowSize());
+        snprintf(key, sizeof(key), "c%uStall", c.number);
+        prefs.putBool(key, c.stallEnabled);
+        snprintf(key, sizeof(key), "c%uStallN", c.number);
+        prefs.putUChar(key, c.stallPeriods);
+        snprintf(key, sizeof(key), "c%uStallAct", c.number);
+        prefs.putUChar(key, c.stallActions);
+        snprintf(key, sizeof(key), "c%uEn", c.number);
+        prefs.putBool(key, c.enabled);
+    }
+
+    prefs.end();
+    Serial.println("[FAN] Settings saved to NVS");
+    return true;
+}
+
+bool FanBank::loadSettings() {
+    Preferences prefs;
+    if (!prefs.begin(NVS_NAMESPACE, true)) {  // Read-only
+        return false;
+    }
+
+    char key[16];
+    for (uint8_t i = 0; i < channelCount; i++) {
+        uint8_t ch = i + 1;
+
+        snprintf(key, sizeof(key), "c%uFreq", ch);
+        setFrequency(ch, prefs.getUInt(key, 25000));
+        snprintf(key, sizeof(key), "c%uDuty", ch);
+        setDuty(ch, prefs.getFloat(key, 0.0));
+        snprintf(key, sizeof(key), "c%uPoles", ch);
+        setPolePairs(ch, prefs.getUChar(key, 2));
+        snprintf(key, sizeof(key), "c%uFilter", ch);
+        setFilterType(ch, (RPMFilter::FilterType)prefs.getUChar(key, RPMFilter::FILTER_MEDIAN));
+        snprintf(key, sizeof(key), "c%uWindow", ch);
+        setFilterWindow(ch, prefs.getUChar(key, 5));
+        snprintf(key, sizeof(key), "c%uStall", ch);
+        setStallDetection(ch, prefs.getBool(key, false));
+        snprintf(key, sizeof(key), "c%uStallN", ch);
+        setStallPeriods(ch, prefs.getUChar(key, 4));
+        snprintf(key, sizeof(key), "c%uStallAct", ch);
+        setStallActions(ch, prefs.getUChar(key, UART1Mux::STALL_ACTION_NOTIFY));
+        snprintf(key, sizeof(key), "c%uEn", ch);
+        setEnabled(ch, prefs.getBool(key, false));  // Last, so it starts with the loaded settings
+    }
+
+    prefs.end();
+    return true;
+}
+
+void FanBank::resetToDefaults() {
+    for (uint8_t ch = 1; ch <= channelCount; ch++) {
+        setEnabled(ch, false);
+        setDuty(ch, 0.0);
+        setFrequency(ch, 25000);
+        setPolePairs(ch, 2);
+        setFilterType(ch, RPMFilter::FILTER_MEDIAN);
+        setFilterWindow(ch, 5);
+        setStallDetection(ch, false);
+        setStallPeriods(ch, 4);
+        setStallActions(ch, UART1Mux::STALL_ACTION_NOTIFY);
+    }
+    Serial.println("[FAN] Settings reset to factory defaults");
+}
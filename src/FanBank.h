@@ -0,0 +1,259 @@
+#ifndef FAN_BANK_H
+#define FAN_BANK_H
+
+#include <Arduino.h>
+#include "driver/mcpwm.h"
+#include "driver/ledc.h"
+#include "driver/pcnt.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "RPMFilter.h"
+#include "UART1Mux.h"
+
+/**
+ * @brief PWM output / tach input pins of one fan channel
+ */
+struct FanChannelPins {
+    uint8_t pwmPin;
+    uint8_t tachPin;
+};
+
+/**
+ * @brief Independent fan channels next to the UART1 motor channel
+ *
+ * Each entry of the pin table in FanBank.cpp becomes one channel with
+ * its own PWM frequency, duty, pole pairs, RPM filter and stall
+ * detection. Hardware is allocated at begin() from what UART1 and the
+ * buzzer/LED leave free:
+ * - PWM: an MCPWM_UNIT_FAN timer per channel (own frequency), then LEDC
+ *   timer/channel pairs
+ * - Tach: a free MCPWM_UNIT_FAN capture channel, then a PCNT unit (gated
+ *   counting)
+ * MCPWM unit 1 is never touched: it carries the UART1 PWM, whose prescaler
+ * and shadow registers a second mcpwm_init() on that unit would rewrite.
+ *
+ * Capture interrupts of all channels go through one shared callback that
+ * only queues the timestamp into the channel's ring; a single bank task
+ * drains every ring, updates the filters and checks for stalls every
+ * POLL_PERIOD_MS. There are no per-channel tasks or timers.
+ *
+ * Channels start disabled: begin() only assigns hardware slots and no pin
+ * is configured until setEnabled() (FAN <n> ENABLE or the saved setting)
+ * turns the channel on. Settings written while disabled are stored and
+ * applied on enable; disabling stops the drivers and resets both pins.
+ *
+ * Channels are numbered from 1 in the API, matching FAN <n> commands.
+ *
+ * Usage:
+ *   FanBank fans;
+ *   fans.begin();
+ *   fans.setEnabled(1, true);
+ *   fans.setFrequency(1, 25000);
+ *   fans.setDuty(1, 40.0);
+ *   float rpm = fans.getRPM(1);
+ */
+class FanBank {
+public:
+    enum PWMDriver : uint8_t {
+        PWM_NONE = 0,
+        PWM_MCPWM,
+        PWM_LEDC
+    };
+
+    enum TachDriver : uint8_t {
+        TACH_NONE = 0,
+        TACH_CAPTURE,       ///< MCPWM capture, reciprocal measurement
+        TACH_PCNT           ///< PCNT gated counting (adaptive gate)
+    };
+
+    /**
+     * @brief Snapshot of one channel
+     */
+    struct ChannelInfo {
+        uint8_t pwmPin;
+        uint8_t tachPin;
+        PWMDriver pwmDriver;
+        TachDriver tachDriver;
+        uint8_t pwmUnit;        ///< MCPWM unit or LEDC channel
+        uint8_t pwmTimer;       ///< MCPWM or LEDC timer
+        uint8_t tachUnit;       ///< MCPWM unit or PCNT unit
+        uint8_t tachChannel;    ///< MCPWM capture channel
+        bool enabled;           ///< Pins configured and driven
+        uint32_t frequency;
+        float duty;
+        uint8_t polePairs;
+        float tachFrequency;    ///< Filtered, 0 without signal
+        float rpm;
+        bool stallEnabled;
+        uint8_t stallPeriods;
+        uint8_t stallActions;   ///< UART1Mux::StallAction bits
+        uint32_t stallTimeoutUs;
+        bool stalled;           ///< Cleared by the next tach edge
+        uint32_t stallCount;
+        uint32_t captureDrops;
+    };
+
+    typedef void (*StallCallback)(uint8_t channel, const UART1Mux::StallEvent& event, void* arg);
+
+    static const uint8_t MAX_CHANNELS = 8;
+    static const uint32_t MIN_FREQUENCY = 20;
+    static const uint32_t MAX_FREQUENCY = 100000;
+    static const uint8_t MAX_POLE_PAIRS = 12;
+    static const uint32_t POLL_PERIOD_MS = 10;
+    static const uint32_t PCNT_MIN_GATE_MS = 100;
+    static const uint32_t PCNT_MAX_GATE_MS = 1000;
+    static const int16_t PCNT_MIN_COUNTS = 50;     // Gate closes early once this many edges are in
+    static const uint32_t STALL_MIN_TIMEOUT_US = 2 * POLL_PERIOD_MS * 1000;
+
+    FanBank();
+    ~FanBank();
+
+    /**
+     * @brief Assign hardware to every table entry, load settings and start the bank task
+     *
+     * Pins are left alone; only channels saved as enabled are configured.
+     * @return false if no channel could be assigned
+     */
+    bool begin();
+
+    uint8_t getChannelCount() const { return channelCount; }
+
+    /**
+     * @brief Check a 1-based channel number
+     */
+    bool isValidChannel(uint8_t channel) const { return channel >= 1 && channel <= channelCount; }
+
+    /**
+     * @brief Configure (true) or release (false) the channel's pins and drivers
+     * @return false for an invalid channel or if the drivers failed to start
+     *         (the channel is then left disabled)
+     */
+    bool setEnabled(uint8_t channel, bool enabled);
+    bool isEnabled(uint8_t channel) const;
+
+    bool setFrequency(uint8_t channel, uint32_t frequency);
+    bool setDuty(uint8_t channel, float duty);
+    bool setPolePairs(uint8_t channel, uint8_t polePairs);
+
+    /**
+     * @brief Enable polled stall detection
+     *
+     * The timeout is periods × the current tach period, bounded to
+     * STALL_MIN_TIMEOUT_US - UART1Mux::STALL_MAX_TIMEOUT_US and checked
+     * every POLL_PERIOD_MS. Armed by the first edge while duty > 0.
+     */
+    bool setStallDetection(uint8_t channel, bool enabled);
+    bool setStallPeriods(uint8_t channel, uint8_t periods);
+    bool setStallActions(uint8_t channel, uint8_t actions);
+
+    /**
+     * @brief Configure the channel's RPM filter (taken under the bank lock)
+     */
+    bool setFilterType(uint8_t channel, RPMFilter::FilterType type);
+    bool setFilterWindow(uint8_t channel, uint8_t size);
+
+    /**
+     * @brief Get the channel's RPM filter (read-only)
+     * @return nullptr for an invalid channel
+     */
+    const RPMFilter* getRPMFilter(uint8_t channel) const;
+
+    float getRPM(uint8_t channel) const;
+
+    /**
+     * @brief Get a snapshot of a channel
+     * @return false for an invalid channel
+     */
+    bool getInfo(uint8_t channel, ChannelInfo& info) const;
+
+    static const char* getPWMDriverName(PWMDriver driver);
+    static const char* getTachDriverName(TachDriver driver);
+
+    /**
+     * @brief Register the function called (from the bank task) for every stall
+     */
+    void setStallCallback(StallCallback callback, void* arg);
+
+    // ========================================================================
+    // Settings Persistence (NVS namespace "fan_bank")
+    // ========================================================================
+
+    bool saveSettings();
+    bool loadSettings();
+    void resetToDefaults();
+
+private:
+    static const size_t CAPTURE_RING_SIZE = 64;    // Fan tach rates: a few hundred edges/s at most
+
+    struct Channel {
+        FanChannelPins pins;
+        uint8_t number;                             // 1-based
+        bool enabled = false;                       // Pins untouched until set
+
+        PWMDriver pwmDriver = PWM_NONE;
+        mcpwm_unit_t mcpwmUnit = MCPWM_UNIT_0;
+        mcpwm_timer_t mcpwmTimer = MCPWM_TIMER_0;
+        uint32_t mcpwmResolutionHz = 0;
+        ledc_channel_t ledcChannel = LEDC_CHANNEL_0;
+        ledc_timer_t ledcTimer = LEDC_TIMER_0;
+        uint8_t ledcBits = 0;
+
+        TachDriver tachDriver = TACH_NONE;
+        mcpwm_unit_t captureUnit = MCPWM_UNIT_0;
+        mcpwm_capture_channel_id_t captureChannel = MCPWM_SELECT_CAP0;
+        pcnt_unit_t pcntUnit = PCNT_UNIT_0;
+        int64_t pcntGateStartUs = 0;
+        int16_t pcntLastCount = 0;                  // Count at the previous poll (liveness)
+
+        uint32_t frequency = 25000;
+        float duty = 0.0f;
+        uint8_t polePairs = 2;
+
+        CaptureRing<CAPTURE_RING_SIZE> captureRing; // Capture ISR → bank task
+        RPMFilter filter;
+        float tachFrequency = 0.0f;
+        float lastRpm = 0.0f;
+        int64_t lastEdgeUs = 0;
+
+        bool stallEnabled = false;
+        bool stallArmed = false;
+        bool stalled = false;
+        uint8_t stallPeriods = 4;
+        uint8_t stallActions = UART1Mux::STALL_ACTION_NOTIFY;
+        uint32_t stallTimeoutUs = UART1Mux::STALL_MAX_TIMEOUT_US;
+        uint32_t stallCount = 0;
+    };
+
+    Channel channels[MAX_CHANNELS];
+    uint8_t channelCount = 0;
+    SemaphoreHandle_t lock = nullptr;               // Bank task vs. setters
+    TaskHandle_t taskHandle = nullptr;
+    StallCallback stallCallback = nullptr;
+    void* stallCallbackArg = nullptr;
+
+    Channel* getChannel(uint8_t channel);
+    const Channel* getChannel(uint8_t channel) const;
+
+    bool allocatePWM(Channel& c, uint8_t& nextMcpwm, uint8_t& nextLedc);
+    bool allocateTach(Channel& c, uint8_t& nextCapture, uint8_t& nextPcnt);
+    bool initMCPWM(Channel& c);
+    bool initLEDC(Channel& c);
+    bool initCapture(Channel& c);
+    bool initPCNT(Channel& c);
+    void releaseHardware(Channel& c);
+    bool applyFrequency(Channel& c, uint32_t frequency);
+    void applyDuty(Channel& c, float duty);
+
+    void poll();
+    bool measure(Channel& c, int64_t nowUs, UART1Mux::StallEvent& event);
+    static void bankTask(void* arg);
+
+    // Shared by all capture channels; queues the timestamp only
+    static bool IRAM_ATTR captureCallback(mcpwm_unit_t mcpwm,
+                                          mcpwm_capture_channel_id_t cap_channel,
+                                          const cap_event_data_t *edata,
+                                          void *user_data);
+};
+
+#endif // FAN_BANK_H
@@ -0,0 +1,297 @@
+#include "FanCharacterizer.h"
+#include "UART1Mux.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include <math.h>
+
+// Reading recorded even without a new measurement, so a stopped fan still shows up
+static const int64_t TRACE_KEEPALIVE_US = 50000;
+static const uint32_t TRACE_MIN_PERIOD_MS = 2;
+
+FanCharacterizer::FanCharacterizer(UART1Mux& uart1) : uart1(uart1) {
+}
+
+// ============================================================================
+// Job Control
+// ============================================================================
+
+bool FanCharacterizer::startDutySweep(float fromDuty, float toDuty, float stepDuty, uint32_t dwellMs) {
+    if (taskHandle) {
+        return false;
+    }
+    size_t steps = FanAnalysis::planDutySweep(fromDuty, toDuty, stepDuty, setpoints, rising, MAX_STEPS);
+    return start(MODE_DUTY_SWEEP, steps, dwellMs);
+}
+
+bool FanCharacterizer::startFrequencySweep(uint32_t fromHz, uint32_t toHz, uint32_t points, uint32_t dwellMs) {
+    if (taskHandle) {
+        return false;
+    }
+    size_t steps = FanAnalysis::planFrequencySweep(fromHz, toHz, points, setpoints, rising, MAX_STEPS);
+    return start(MODE_FREQ_SWEEP, steps, dwellMs);
+}
+
+bool FanCharacterizer::startStep(float lowDuty, float highDuty, uint32_t cycles, uint32_t dwellMs) {
+    if (taskHandle) {
+        return false;
+    }
+    size_t steps = FanAnalysis::planStep(lowDuty, highDuty, cycles, setpoints, rising, MAX_STEPS);
+    return start(MODE_STEP, steps, dwellMs);
+}
+
+bool FanCharacterizer::start(Mode newMode, size_t steps, uint32_t newDwellMs) {
+    if (steps == 0 || newDwellMs < MIN_DWELL_MS || newDwellMs > MAX_DWELL_MS ||
+        (uint64_t)steps * newDwellMs > MAX_JOB_MS) {
+        return false;
+    }
+    if (uart1.getMode() != UART1Mux::MODE_PWM_RPM || !uart1.isPWMEnabled()) {
+        return false;
+    }
+
+    if (!trace) {
+        size_t size = sizeof(FanTraceSample) * MAX_TRACE;
+        trace = static_cast<FanTraceSample*>(heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+        if (!trace) {
+            trace = static_cast<FanTraceSample*>(heap_caps_malloc(size, MALLOC_CAP_8BIT));
+        }
+        if (!trace) {
+            Serial.println("[CHAR] ❌ Trace buffer allocation failed");
+            return false;
+        }
+    }
+
+    // Spread the trace budget over the whole job
+    uint64_t totalMs = (uint64_t)steps * newDwellMs;
+    samplePeriodMs = (uint32_t)((totalMs + MAX_TRACE - 1) / MAX_TRACE);
+    if (samplePeriodMs < TRACE_MIN_PERIOD_MS) {
+        samplePeriodMs = TRACE_MIN_PERIOD_MS;
+    }
+
+    mode = newMode;
+    stepCount = steps;
+    dwellMs = newDwellMs;
+    completedSteps = 0;
+    traceCount = 0;
+    deadBand = FanDeadBand();
+    message = "";
+    stopRequested = false;
+    startTime = millis();
+    state = STATE_RUNNING;
+
+    BaseType_t ok = xTaskCreatePinnedToCore(
+        jobTask,
+        "Fan_Char",
+        4096,
+        this,
+        2,                  // Below the RPM loop / sequencer, same as HID
+        &taskHandle,
+        1);
+    if (ok != pdPASS) {
+        taskHandle = nullptr;
+        state = STATE_FAILED;
+        message = "Task creation failed";
+        return false;
+    }
+
+    Serial.printf("[CHAR] %s started: %u steps × %u ms, trace every %u ms\n",
+                 getModeName(), stepCount, dwellMs, samplePeriodMs);
+    return true;
+}
+
+void FanCharacterizer::stop() {
+    if (state == STATE_RUNNING) {
+        stopRequested = true;
+    }
+}
+
+void FanCharacterizer::jobTask(void* arg) {
+    FanCharacterizer* self = static_cast<FanCharacterizer*>(arg);
+    self->run();
+    self->taskHandle = nullptr;
+    vTaskDelete(NULL);
+}
+
+// ============================================================================
+// Job Execution
+// ============================================================================
+
+void FanCharacterizer::run() {
+    RPMFilter& filter = uart1.getRPMFilter();
+    RPMFilter::FilterType savedType = filter.getFilterType();
+    uint16_t savedPeriods = filter.getSamplePeriods();
+    float savedOutlier = filter.getOutlierTolerance();
+    uint32_t savedFrequency = uart1.getPWMFrequency();
+    float savedDuty = uart1.getPWMDuty();
+
+    // Raw one-revolution samples: filtering would show up as fake rise time
+    uint32_t periods = uart1.getPolePairs();
+    filter.setFilterType(RPMFilter::FILTER_NONE);
+    filter.setSamplePeriods(periods > 0 ? periods : 1);
+    filter.setOutlierTolerance(0.0f);
+
+    FanAnalysis::Options options = FanAnalysis::defaultOptions();
+    int64_t jobStartUs = esp_timer_get_time();
+    float initialRpm = uart1.getCalculatedRPM();
+    State result = STATE_DONE;
+    bool restorePWM = true;
+
+    for (uint32_t i = 0; i < stepCount; i++) {
+        if (stopRequested) {
+            result = STATE_ABORTED;
+            message = "Stopped by command";
+            break;
+        }
+
+        if (!applySetpoint(setpoints[i])) {
+            result = STATE_FAILED;
+            message = "PWM setpoint rejected";
+            break;
+        }
+
+        int64_t stepStartUs = esp_timer_get_time();
+        Row& row = rows[i];
+        row.setpoint = setpoints[i];
+        row.rising = rising[i];
+        row.traceStart = traceCount;
+        row.stepTimeUs = (uint32_t)(stepStartUs - jobStartUs);
+
+        bool completed = recordStep(jobStartUs, stepStartUs, setpoints[i]);
+        row.traceCount = traceCount - row.traceStart;
+        if (!completed) {
+            result = STATE_ABORTED;
+            if (!setpointHeld(setpoints[i])) {
+                restorePWM = false;
+            }
+            break;
+        }
+
+        row.metrics = FanAnalysis::analyzeStep(trace + row.traceStart, row.traceCount,
+                                               row.stepTimeUs, initialRpm, options);
+        initialRpm = row.metrics.finalRpm;
+        completedSteps = i + 1;
+    }
+
+    filter.setFilterType(savedType);
+    filter.setSamplePeriods(savedPeriods);
+    filter.setOutlierTolerance(savedOutlier);
+
+    // Leave the fan where it was, unless someone took over the output
+    if (restorePWM) {
+        if (mode == MODE_FREQ_SWEEP) {
+            uart1.setPWMFrequency(savedFrequency);
+        } else {
+            uart1.setPWMDuty(savedDuty);
+        }
+    }
+
+    if (mode != MODE_FREQ_SWEEP && completedSteps > 0) {
+        float finals[MAX_STEPS];
+        for (uint32_t i = 0; i < completedSteps; i++) {
+            finals[i] = rows[i].metrics.finalRpm;
+        }
+        deadBand = FanAnalysis::findDeadBand(setpoints, finals, rising, completedSteps, 0.05f);
+    }
+
+    endTime = millis();
+    state = result;
+    Serial.printf("[CHAR] %s %s: %u / %u steps, %u trace samples%s%s\n",
+                 getModeName(), getStateName(), completedSteps, stepCount, traceCount,
+                 message[0] ? " - " : "", message);
+}
+
+bool FanCharacterizer::recordStep(int64_t jobStartUs, int64_t stepStartUs, float value) {
+    RPMFilter& filter = uart1.getRPMFilter();
+    TickType_t period = pdMS_TO_TICKS(samplePeriodMs);
+    if (period == 0) {
+        period = 1;
+    }
+    TickType_t lastWake = xTaskGetTickCount();
+    uint32_t lastSamples = filter.getSampleCount();
+    int64_t lastRecordUs = 0;
+    int64_t dwellUs = (int64_t)dwellMs * 1000;
+
+    for (;;) {
+        vTaskDelayUntil(&lastWake, period);
+        int64_t now = esp_timer_get_time();
+
+        if (stopRequested) {
+            message = "Stopped by command";
+            return false;
+        }
+        if (!setpointHeld(value)) {
+            message = "Interrupted by manual PWM change";
+            return false;
+        }
+
+        // Times come from esp_timer, so scheduling jitter does not skew the analysis
+        uart1.updateRPMFrequency();
+        uint32_t samples = filter.getSampleCount();
+        if ((samples != lastSamples || now - lastRecordUs >= TRACE_KEEPALIVE_US) && traceCount < MAX_TRACE) {
+            trace[traceCount].timeUs = (uint32_t)(now - jobStartUs);
+            trace[traceCount].rpm = uart1.getCalculatedRPM();
+            traceCount = traceCount + 1;
+            lastSamples = samples;
+            lastRecordUs = now;
+        }
+
+        if (now - stepStartUs >= dwellUs) {
+            return true;
+        }
+    }
+}
+
+bool FanCharacterizer::applySetpoint(float value) {
+    if (mode == MODE_FREQ_SWEEP) {
+        return uart1.setPWMFrequency((uint32_t)value);
+    }
+    return uart1.setPWMDuty(value);
+}
+
+bool FanCharacterizer::setpointHeld(float value) const {
+    if (uart1.getMode() != UART1Mux::MODE_PWM_RPM || !uart1.isPWMEnabled()) {
+        return false;
+    }
+    if (mode == MODE_FREQ_SWEEP) {
+        return uart1.getPWMFrequency() == (uint32_t)value;
+    }
+    return fabsf(uart1.getPWMDuty() - value) < 0.001f;
+}
+
+// ============================================================================
+// Results
+// ============================================================================
+
+const char* FanCharacterizer::getStateName() const {
+    switch (state) {
+        case STATE_IDLE:    return "IDLE";
+        case STATE_RUNNING: return "RUNNING";
+        case STATE_DONE:    return "DONE";
+        case STATE_ABORTED: return "ABORTED";
+        case STATE_FAILED:  return "FAILED";
+        default:            return "UNKNOWN";
+    }
+}
+
+const char* FanCharacterizer::getModeName() const {
+    switch (mode) {
+        case MODE_DUTY_SWEEP: return "DUTY";
+        case MODE_FREQ_SWEEP: return "FREQ";
+        case MODE_STEP:       return "STEP";
+        default:              return "UNKNOWN";
+    }
+}
+
+uint32_t FanCharacterizer::getElapsedMs() const {
+    if (state == STATE_IDLE) {
+        return 0;
+    }
+    return (uint32_t)((state == STATE_RUNNING ? millis() : endTime) - startTime);
+}
+
+const FanCharacterizer::Row* FanCharacterizer::getRow(uint32_t index) const {
+    return index < completedSteps ? &rows[index] : nullptr;
+}
+
+const FanTraceSample* FanCharacterizer::getTraceSample(uint32_t index) const {
+    return index < traceCount ? &trace[index] : nullptr;
+}
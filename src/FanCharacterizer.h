@@ -0,0 +1,165 @@
+#ifndef FAN_CHARACTERIZER_H
+#define FAN_CHARACTERIZER_H
+
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "FanAnalysis.h"
+
+class UART1Mux;
+
+/**
+ * @brief Background fan characterization job
+ *
+ * Walks a list of duty or PWM-frequency setpoints through UART1Mux,
+ * holding each for a dwell time while a low-priority task records the
+ * RPM measurement into a trace. The RPM filter is switched to raw
+ * one-revolution samples for the duration of the job so the trace shows
+ * the real transition instead of the filter's lag; previous filter and
+ * PWM settings are restored afterwards.
+ *
+ * After each step FanAnalysis computes rise/settle time, overshoot and
+ * ripple; a duty sweep also yields the start/stop dead band and the
+ * steady-state duty→RPM curve (the rising rows of the table).
+ *
+ * Commands return immediately; any manual PWM change aborts the job.
+ *
+ * Usage:
+ *   FanCharacterizer job(uart1);
+ *   job.startDutySweep(0, 100, 10, 3000);
+ *   // ... later
+ *   if (job.getState() == FanCharacterizer::STATE_DONE) { ... job.getRow(i) ... }
+ */
+class FanCharacterizer {
+public:
+    /**
+     * @brief What the job drives
+     */
+    enum Mode : uint8_t {
+        MODE_DUTY_SWEEP = 0,    ///< Duty staircase up and back down
+        MODE_FREQ_SWEEP,        ///< Log-spaced PWM frequency points at the current duty
+        MODE_STEP               ///< Repeated low ↔ high duty steps
+    };
+
+    enum State : uint8_t {
+        STATE_IDLE = 0,
+        STATE_RUNNING,
+        STATE_DONE,
+        STATE_ABORTED,          ///< Stopped by command or by a manual PWM change
+        STATE_FAILED            ///< PWM setter refused a setpoint
+    };
+
+    /**
+     * @brief One analysed step
+     */
+    struct Row {
+        float setpoint;         ///< Duty (%) or frequency (Hz)
+        bool rising;            ///< Upward half of a sweep
+        uint32_t traceStart;    ///< First trace sample of this step
+        uint32_t traceCount;
+        uint32_t stepTimeUs;    ///< Setpoint applied (trace time base)
+        FanStepMetrics metrics;
+    };
+
+    static const size_t MAX_STEPS = 128;
+    static const size_t MAX_TRACE = 32768;
+    static const uint32_t MIN_DWELL_MS = 200;
+    static const uint32_t MAX_DWELL_MS = 60000;
+    static const uint32_t MAX_JOB_MS = 3600000;         // Trace time base is 32-bit µs
+
+    explicit FanCharacterizer(UART1Mux& uart1);
+
+    /**
+     * @brief Sweep duty from → to in steps, then back down
+     * @return false if a job is running, PWM is not active or the plan is invalid
+     */
+    bool startDutySweep(float fromDuty, float toDuty, float stepDuty, uint32_t dwellMs);
+
+    /**
+     * @brief Sweep PWM frequency over log-spaced points at the current duty
+     */
+    bool startFrequencySweep(uint32_t fromHz, uint32_t toHz, uint32_t points, uint32_t dwellMs);
+
+    /**
+     * @brief Step duty low → high → low for a number of cycles
+     */
+    bool startStep(float lowDuty, float highDuty, uint32_t cycles, uint32_t dwellMs);
+
+    /**
+     * @brief Request the running job to stop (returns immediately)
+     */
+    void stop();
+
+    bool isRunning() const { return state == STATE_RUNNING; }
+    State getState() const { return state; }
+    Mode getMode() const { return mode; }
+    const char* getStateName() const;
+    const char* getModeName() const;
+
+    /**
+     * @brief Reason for STATE_ABORTED / STATE_FAILED
+     */
+    const char* getMessage() const { return message; }
+
+    uint32_t getStepCount() const { return stepCount; }
+    uint32_t getCompletedSteps() const { return completedSteps; }
+    uint32_t getDwellMs() const { return dwellMs; }
+    uint32_t getSamplePeriodMs() const { return samplePeriodMs; }
+    uint32_t getElapsedMs() const;
+
+    /**
+     * @brief Get an analysed step
+     * @return nullptr if the step has not completed
+     */
+    const Row* getRow(uint32_t index) const;
+
+    uint32_t getTraceCount() const { return traceCount; }
+
+    /**
+     * @brief Get a trace sample
+     * @return nullptr if index is out of range
+     */
+    const FanTraceSample* getTraceSample(uint32_t index) const;
+
+    /**
+     * @brief Start/stop duty (duty sweep and step modes)
+     */
+    const FanDeadBand& getDeadBand() const { return deadBand; }
+
+private:
+    UART1Mux& uart1;
+    TaskHandle_t taskHandle = nullptr;
+
+    volatile State state = STATE_IDLE;
+    volatile bool stopRequested = false;
+    Mode mode = MODE_DUTY_SWEEP;
+    const char* message = "";
+
+    float setpoints[MAX_STEPS];
+    bool rising[MAX_STEPS];
+    Row rows[MAX_STEPS];
+    uint32_t stepCount = 0;
+    volatile uint32_t completedSteps = 0;
+    uint32_t dwellMs = 0;
+    uint32_t samplePeriodMs = 0;
+    unsigned long startTime = 0;
+    unsigned long endTime = 0;
+
+    FanTraceSample* trace = nullptr;    // PSRAM when available
+    volatile uint32_t traceCount = 0;
+    FanDeadBand deadBand = {};
+
+    bool start(Mode newMode, size_t steps, uint32_t newDwellMs);
+    void run();
+    bool applySetpoint(float value);
+    bool setpointHeld(float value) const;
+    static void jobTask(void* arg);
+
+    /**
+     * @brief Sample the trace for one step
+     * @return false if the job was stopped or interrupted
+     */
+    bool recordStep(int64_t jobStartUs, int64_t stepStartUs, float value);
+};
+
+#endif // FAN_CHARACTERIZER_H
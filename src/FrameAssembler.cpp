@@ -0,0 +1,76 @@
+#include "FrameAssembler.h"
+
+void FrameAssembler::start(Mode mode, uint8_t delimiter, size_t splitLength) {
+    this->mode = mode;
+    this->delimiter = mode == MODE_LINE ? '\n' : delimiter;
+    this->splitLength = splitLength;
+    loss = false;
+    stats = {};
+}
+
+bool FrameAssembler::collectOne(Input& input, Output& output, bool idle) {
+    if (mode == MODE_OFF || splitLength == 0) {
+        return false;
+    }
+
+    // Each recorded delimiter ends a complete frame in the receive buffer
+    if (mode != MODE_IDLE) {
+        int pos = input.delimiterPosition();
+        if (pos >= 0 && (size_t)pos < splitLength) {
+            input.popDelimiter();
+            emit(input, output, pos + 1, true, 0);
+            return true;
+        }
+    }
+
+    // No delimiter within reach: cut so the receive buffer cannot fill up
+    size_t buffered = input.buffered();
+    if (buffered >= splitLength) {
+        stats.splitFrames++;
+        emit(input, output, splitLength, false, FLAG_SPLIT);
+        return true;
+    }
+
+    if (mode == MODE_IDLE && idle && buffered > 0) {
+        emit(input, output, buffered, false, 0);
+        return true;
+    }
+    return false;
+}
+
+void FrameAssembler::emit(Input& input, Output& output, size_t length, bool delimited, uint8_t flags) {
+    if (loss) {
+        flags |= FLAG_LOSS;
+    }
+
+    uint8_t* data = output.acquire(length);
+    if (!data) {
+        // Consumer too slow: the bytes still have to leave the receive buffer
+        uint8_t discard[128];
+        size_t remaining = length;
+        while (remaining > 0) {
+            size_t got = input.read(discard, remaining < sizeof(discard) ? remaining : sizeof(discard));
+            if (got == 0) {
+                break;
+            }
+            remaining -= got;
+        }
+        stats.droppedFrames++;
+        stats.droppedBytes += length;
+        loss = true;
+        return;
+    }
+
+    // One read moves the whole frame from the receive buffer into the slot
+    size_t payload = input.read(data, length);
+    if (delimited && payload > 0 && data[payload - 1] == delimiter) {
+        payload--;
+        if (mode == MODE_LINE && payload > 0 && data[payload - 1] == '\r') {
+            payload--;
+        }
+    }
+
+    output.complete(data, payload, flags);
+    stats.frames++;
+    loss = false;
+}
@@ -0,0 +1,109 @@
+#ifndef FRAME_ASSEMBLER_H
+#define FRAME_ASSEMBLER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Cuts a received byte stream into line / delimiter / idle frames
+ *
+ * Pure logic, no hardware access: the bytes stay in a receive buffer
+ * behind Input (the UART driver buffer on the device), which also
+ * reports where the delimiters are (the UART's pattern detection). Each
+ * collectOne() decides the next cut, moves the frame with one read into
+ * a slot from Output (the frame ring) and strips the delimiter (plus a
+ * '\r' before it in MODE_LINE).
+ *
+ * - A delimiter within splitLength bytes ends a frame
+ * - splitLength bytes without one are cut as a FLAG_SPLIT frame, so the
+ *   receive buffer cannot fill up
+ * - In MODE_IDLE everything buffered is a frame once the line goes idle
+ * - A frame Output has no room for is read and discarded; it and every
+ *   markLoss() (receive overflow) set FLAG_LOSS on the next frame
+ *
+ * Usage:
+ *   FrameAssembler assembler;
+ *   assembler.start(FrameAssembler::MODE_LINE, '\n', 1024);
+ *   while (assembler.collectOne(input, output, idle)) {}
+ */
+class FrameAssembler {
+public:
+    enum Mode : uint8_t {
+        MODE_OFF = 0,
+        MODE_LINE,              ///< '\n'-terminated lines, a trailing '\r' is removed
+        MODE_DELIMITER,         ///< Terminated by a custom delimiter byte
+        MODE_IDLE               ///< Everything up to a receive idle gap
+    };
+
+    enum Flags : uint8_t {
+        FLAG_SPLIT = 0x01,      ///< No delimiter within splitLength: continues in the next frame
+        FLAG_LOSS = 0x02        ///< Data was lost before this frame
+    };
+
+    struct Statistics {
+        uint32_t frames;        ///< Frames handed to Output
+        uint32_t splitFrames;
+        uint32_t droppedFrames; ///< Frames Output had no room for
+        uint32_t droppedBytes;
+    };
+
+    /**
+     * @brief Receive buffer the frames are cut from
+     */
+    class Input {
+    public:
+        virtual ~Input() {}
+        virtual size_t buffered() = 0;
+        /** Offset of the oldest unconsumed delimiter from the read position, -1 if none */
+        virtual int delimiterPosition() = 0;
+        virtual void popDelimiter() = 0;
+        virtual size_t read(uint8_t* buffer, size_t length) = 0;
+    };
+
+    /**
+     * @brief Frame storage
+     */
+    class Output {
+    public:
+        virtual ~Output() {}
+        /** Room for a frame of up to length bytes, nullptr if full */
+        virtual uint8_t* acquire(size_t length) = 0;
+        /** Publish an acquired frame with its final (trimmed) length */
+        virtual void complete(uint8_t* data, size_t length, uint8_t flags) = 0;
+    };
+
+    /**
+     * @brief Set the mode and clear the loss state and statistics
+     * @param delimiter Delimiter byte for MODE_DELIMITER ('\n' for MODE_LINE)
+     * @param splitLength Longest frame, at most half the receive buffer
+     */
+    void start(Mode mode, uint8_t delimiter, size_t splitLength);
+
+    /**
+     * @brief Record a receive overflow: the next frame gets FLAG_LOSS
+     */
+    void markLoss() { loss = true; }
+
+    /**
+     * @brief Move the next complete frame from input to output
+     * @param idle The line went idle (ends a MODE_IDLE frame)
+     * @return false if no complete frame is buffered
+     */
+    bool collectOne(Input& input, Output& output, bool idle);
+
+    Mode getMode() const { return mode; }
+    uint8_t getDelimiter() const { return delimiter; }
+    size_t getSplitLength() const { return splitLength; }
+    const Statistics& getStatistics() const { return stats; }
+
+private:
+    Mode mode = MODE_OFF;
+    uint8_t delimiter = '\n';
+    size_t splitLength = 0;
+    bool loss = false;
+    Statistics stats = {};
+
+    void emit(Input& input, Output& output, size_t length, bool delimited, uint8_t flags);
+};
+
+#endif // FRAME_ASSEMBLER_H
@@ -0,0 +1,257 @@
+#include "HIDDataChannel.h"
+#include "CustomHID.h"
+#include "HIDProtocol.h"
+#include "UART1Mux.h"
+#include "UART2Manager.h"
+
+static const uint32_t SEND_LOCK_MS = 100;
+static const uint32_t STOP_TIMEOUT_MS = 500;
+
+HIDDataChannel::HIDDataChannel(CustomHID64& hid) : hid(hid) {
+}
+
+const char* HIDDataChannel::getPortName(Port port) {
+    switch (port) {
+        case PORT_UART1: return "UART1";
+        case PORT_UART2: return "UART2";
+        default:         return "UNKNOWN";
+    }
+}
+
+HIDDataChannel::Statistics HIDDataChannel::getStatistics() const {
+    Statistics copy = stats;
+    copy.durationMs = (active ? millis() : endTime) - startTime;
+    return copy;
+}
+
+// ============================================================================
+// Control
+// ============================================================================
+
+bool HIDDataChannel::start(Port newPort, UART1Mux& newUart1, UART2Manager& newUart2, SemaphoreHandle_t newSendLock) {
+    if (active || taskHandle) {
+        return false;
+    }
+    if (newPort == PORT_UART1) {
+        if (newUart1.getMode() != UART1Mux::MODE_UART) {
+            return false;
+        }
+    } else if (newPort == PORT_UART2) {
+        // The frame receiver owns RX
+        if (!newUart2.isInitialized() || newUart2.getFrameMode() != UART2Manager::FRAME_OFF) {
+            return false;
+        }
+    } else {
+        return false;
+    }
+
+    if (!outQueue) {
+        outQueue = xQueueCreate(WINDOW, sizeof(Report));
+        if (!outQueue) {
+            return false;
+        }
+    }
+    xQueueReset(outQueue);
+
+    port = newPort;
+    uart1 = &newUart1;
+    uart2 = &newUart2;
+    sendLock = newSendLock;
+    stats = {};
+    message = "";
+    expectedSeq = 0;
+    creditLimit = 0;
+    inSeq = 0;
+    pendingLength = 0;
+    creditRequested = false;
+    stopRequested = false;
+    startTime = millis();
+    endTime = startTime;
+    active = true;
+
+    BaseType_t ok = xTaskCreatePinnedToCore(channelTask, "HID_UART", 4096, this, CHANNEL_PRIORITY, &taskHandle, 1);
+    if (ok != pdPASS) {
+        taskHandle = nullptr;
+        active = false;
+        return false;
+    }
+    return true;
+}
+
+void HIDDataChannel::stop() {
+    if (!taskHandle) {
+        return;
+    }
+    stopRequested = true;
+    unsigned long start = millis();
+    while (taskHandle && millis() - start < STOP_TIMEOUT_MS) {
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+}
+
+// ============================================================================
+// Host → UART
+// ============================================================================
+
+void HIDDataChannel::receiveFromISR(const uint8_t* report, uint16_t length) {
+    if (!active || length < HEADER_SIZE || report[0] != HIDProtocol::TYPE_DATA) {
+        return;
+    }
+    uint8_t payload = report[1];
+    if (payload > MAX_PAYLOAD || payload > length - HEADER_SIZE) {
+        stats.badReports++;
+        return;
+    }
+    if (payload == 0) {
+        creditRequested = true;     // Not sequenced
+        return;
+    }
+
+    uint8_t seq = report[2];
+    if (seq != expectedSeq) {
+        stats.seqGaps++;
+        stats.missingReports += (uint8_t)(seq - expectedSeq);
+    }
+    uint8_t allowed = creditLimit - seq;
+    if (allowed == 0 || allowed > WINDOW) {
+        stats.overCredit++;
+    }
+
+    Report copy;
+    memcpy(copy.data, report, HEADER_SIZE + payload);
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    if (xQueueSendFromISR(outQueue, &copy, &xHigherPriorityTaskWoken) != pdTRUE) {
+        stats.dropped++;
+    }
+    // After queueing: a credit computed in between is one report short, never one over
+    expectedSeq = seq + 1;
+    stats.outReports++;
+
+    if (xHigherPriorityTaskWoken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+uint8_t HIDDataChannel::currentCredit() const {
+    return expectedSeq + (uint8_t)uxQueueSpacesAvailable(outQueue);
+}
+
+int HIDDataChannel::writeUART(const uint8_t* data, size_t length) {
+    // Returns once queued; blocks only while the TX ring is full, which holds back credits
+    return port == PORT_UART1 ? uart1->write(data, length, 0) : uart2->write(data, length, 0);
+}
+
+// ============================================================================
+// UART → Host
+// ============================================================================
+
+int HIDDataChannel::readUART(uint8_t* buffer, size_t maxLength) {
+    // Zero timeout: take what the driver ring holds
+    return port == PORT_UART1 ? uart1->read(buffer, maxLength, 0) : uart2->read(buffer, maxLength, 0);
+}
+
+bool HIDDataChannel::sendReport(const uint8_t* data, uint8_t length) {
+    uint8_t report[REPORT_SIZE] = {0};
+    uint8_t credit = currentCredit();
+    report[0] = HIDProtocol::TYPE_DATA;
+    report[1] = length;
+    report[2] = inSeq;
+    report[3] = credit;
+    if (length > 0) {
+        memcpy(report + HEADER_SIZE, data, length);
+    }
+
+    if (xSemaphoreTake(sendLock, pdMS_TO_TICKS(SEND_LOCK_MS)) != pdTRUE) {
+        return false;
+    }
+    bool sent = hid.send(report, REPORT_SIZE);
+    xSemaphoreGive(sendLock);
+
+    if (sent) {
+        creditLimit = credit;
+        if (length > 0) {
+            inSeq++;
+        }
+    }
+    return sent;
+}
+
+// ============================================================================
+// Channel Task
+// ============================================================================
+
+void HIDDataChannel::run() {
+    Report report;
+
+    // Initial credit: the host starts at seq 0
+    if (sendReport(nullptr, 0)) {
+        stats.creditReports++;
+    }
+
+    while (!stopRequested && message[0] == '\0') {
+        bool idle = true;
+
+        // Host → UART, in arrival order
+        while (xQueueReceive(outQueue, &report, 0) == pdTRUE) {
+            idle = false;
+            uint8_t length = report.data[1];
+            if (writeUART(report.data + HEADER_SIZE, length) != length) {
+                message = port == PORT_UART1 ? "UART1 left UART mode" : "UART2 not available";
+                break;
+            }
+            stats.hostToUart += length;
+        }
+
+        // UART → host; an unsent report is kept and retried
+        if (pendingLength == 0) {
+            int length = readUART(pending, MAX_PAYLOAD);
+            if (length < 0) {
+                message = port == PORT_UART1 ? "UART1 left UART mode" : "UART2 not available";
+                break;
+            }
+            pendingLength = length;
+        }
+        if (pendingLength > 0) {
+            idle = false;
+            if (sendReport(pending, pendingLength)) {
+                stats.uartToHost += pendingLength;
+                stats.inReports++;
+                pendingLength = 0;
+            } else {
+                stats.inRetries++;
+            }
+        } else {
+            uint8_t freed = currentCredit() - creditLimit;
+            bool hostBlocked = creditLimit == expectedSeq;
+            if (creditRequested || freed >= WINDOW / 4 || (freed > 0 && hostBlocked)) {
+                creditRequested = false;
+                if (sendReport(nullptr, 0)) {
+                    stats.creditReports++;
+                }
+            }
+        }
+
+        if (idle) {
+            // Wake on the next OUT report, or poll RX again after a tick
+            xQueuePeek(outQueue, &report, pdMS_TO_TICKS(1));
+        }
+    }
+
+    active = false;
+
+    // Reports accepted under the last credit still go out
+    while (message[0] == '\0' && xQueueReceive(outQueue, &report, 0) == pdTRUE) {
+        uint8_t length = report.data[1];
+        if (writeUART(report.data + HEADER_SIZE, length) == length) {
+            stats.hostToUart += length;
+        }
+    }
+    endTime = millis();
+}
+
+void HIDDataChannel::channelTask(void* arg) {
+    HIDDataChannel* self = static_cast<HIDDataChannel*>(arg);
+    self->run();
+    self->taskHandle = nullptr;
+    vTaskDelete(NULL);
+}
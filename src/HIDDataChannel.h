@@ -0,0 +1,145 @@
+#ifndef HID_DATA_CHANNEL_H
+#define HID_DATA_CHANNEL_H
+
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+class CustomHID64;
+class UART1Mux;
+class UART2Manager;
+
+/**
+ * @brief Byte stream between HID data reports (0xA0) and UART1 / UART2
+ *
+ * For hosts that allow HID but not a CDC driver. While the channel runs,
+ * 0xA0 OUT reports are forwarded in order to the UART's TX and received
+ * UART data comes back as 0xA0 IN reports. Command reports (0xA1 and
+ * plain text) keep working alongside.
+ *
+ * Report (64 bytes, both directions):
+ *   [0xA0][length 0-60][seq][credit][data...]
+ * - seq counts data reports per direction (wraps at 256); the receiver
+ *   counts gaps.
+ * - Flow control (host → device) is credit based: the host may send data
+ *   reports while (credit - seq) mod 256 > 0, using the credit from the
+ *   newest IN report. The device advertises the next expected seq plus
+ *   the free report slots, so a host that respects it never loses a
+ *   report however fast it sends. A credit-only IN report (length 0) is
+ *   sent at start, when a quarter of the window has been freed, or in
+ *   answer to an OUT report of length 0 (not sequenced).
+ * - Device → host needs no credits: the interrupt IN endpoint NAKs until
+ *   the host polls, and unsent UART data waits in the driver's RX ring.
+ *
+ * OUT reports are queued from the HID receive callback (WINDOW slots);
+ * a channel task writes them to the UART (blocking only while the TX
+ * ring is full, which holds back the credits) and packs UART RX into IN
+ * reports.
+ *
+ * Usage:
+ *   HIDDataChannel channel(HID);
+ *   channel.start(HIDDataChannel::PORT_UART2, uart1, uart2, hidSendMutex);
+ *   // in the HID OUT callback:
+ *   if (channel.isActive() && data[0] == HIDProtocol::TYPE_DATA) channel.receiveFromISR(data, len);
+ */
+class HIDDataChannel {
+public:
+    enum Port : uint8_t {
+        PORT_UART1 = 1,
+        PORT_UART2 = 2
+    };
+
+    struct Statistics {
+        uint64_t hostToUart;        ///< Bytes written to the UART
+        uint64_t uartToHost;        ///< Bytes sent in IN reports
+        uint32_t outReports;        ///< Data reports received
+        uint32_t inReports;         ///< Data reports sent
+        uint32_t creditReports;     ///< Credit-only reports sent
+        uint32_t seqGaps;           ///< OUT sequence discontinuities
+        uint32_t missingReports;    ///< OUT reports skipped by those gaps
+        uint32_t overCredit;        ///< OUT reports sent beyond the advertised credit
+        uint32_t dropped;           ///< OUT reports lost because the queue was full
+        uint32_t badReports;        ///< Length field out of range
+        uint32_t inRetries;         ///< IN reports the host did not take in time (resent)
+        uint32_t durationMs;
+    };
+
+    static const uint8_t REPORT_SIZE = 64;
+    static const uint8_t HEADER_SIZE = 4;
+    static const uint8_t MAX_PAYLOAD = REPORT_SIZE - HEADER_SIZE;
+    static const uint8_t WINDOW = 32;               // OUT report slots (credits)
+    static const uint8_t CHANNEL_PRIORITY = 3;      // Above the console tasks, like the bridge
+
+    explicit HIDDataChannel(CustomHID64& hid);
+
+    /**
+     * @brief Start forwarding (runs in its own task)
+     * @param sendLock Mutex serializing HID IN reports with command responses
+     * @return false if running, the port is not available (UART1 not in
+     *         UART mode, UART2 not initialized or its frame receiver on) or
+     *         the queue / task cannot be created
+     */
+    bool start(Port port, UART1Mux& uart1, UART2Manager& uart2, SemaphoreHandle_t sendLock);
+
+    /**
+     * @brief Stop forwarding (reports still queued are written first)
+     */
+    void stop();
+
+    /**
+     * @brief Queue an OUT data report (HID receive callback)
+     */
+    void receiveFromISR(const uint8_t* report, uint16_t length);
+
+    bool isActive() const { return active; }
+    Port getPort() const { return port; }
+    static const char* getPortName(Port port);
+
+    /**
+     * @brief Why the channel stopped by itself ("" while running or after stop())
+     */
+    const char* getMessage() const { return message; }
+
+    Statistics getStatistics() const;
+
+private:
+    struct Report {
+        uint8_t data[REPORT_SIZE];
+    };
+
+    CustomHID64& hid;
+    SemaphoreHandle_t sendLock = nullptr;
+    QueueHandle_t outQueue = nullptr;
+    TaskHandle_t taskHandle = nullptr;
+    UART1Mux* uart1 = nullptr;
+    UART2Manager* uart2 = nullptr;
+    Port port = PORT_UART2;
+    volatile bool active = false;
+    volatile bool stopRequested = false;
+    volatile bool creditRequested = false;
+    const char* message = "";
+    unsigned long startTime = 0;
+    unsigned long endTime = 0;
+
+    // OUT side: next expected seq (callback) and credits
+    volatile uint8_t expectedSeq = 0;
+    volatile uint8_t creditLimit = 0;       // Last advertised
+
+    // IN side: a report the host has not taken yet is kept and resent
+    uint8_t inSeq = 0;
+    uint8_t pending[MAX_PAYLOAD];
+    uint8_t pendingLength = 0;
+
+    Statistics stats = {};
+
+    uint8_t currentCredit() const;
+    int writeUART(const uint8_t* data, size_t length);
+    int readUART(uint8_t* buffer, size_t maxLength);
+    bool sendReport(const uint8_t* data, uint8_t length);
+    void run();
+    static void channelTask(void* arg);
+};
+
+#endif // HID_DATA_CHANNEL_H
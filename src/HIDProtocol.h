@@ -16,7 +16,7 @@ class HIDProtocol {
 public:
     // 封包類型定義
     static const uint8_t TYPE_COMMAND = 0xA1;    // 命令封包
-    static const uint8_t TYPE_DATA = 0xA0;       // 原始資料（保留供未來使用）
+    static const uint8_t TYPE_DATA = 0xA0;       // 資料通道報告（HIDDataChannel，HIDUART 命令）
     static const uint8_t TYPE_RESPONSE = 0xA2;   // 命令回應（保留供未來使用）
 
     /**
@@ -0,0 +1,488 @@
+#include "LogicCapture.h"
+#include "UART1Mux.h"
+#include "esp_heap_caps.h"
+
+// VCD time unit: one 12.5 ns capture tick is 125 × 100 ps
+static const uint32_t VCD_UNITS_PER_TICK = 125;
+
+LogicCapture::LogicCapture(UART1Mux& uart1) : uart1(uart1) {
+}
+
+// ============================================================================
+// Configuration
+// ============================================================================
+
+bool LogicCapture::setNoTrigger() {
+    if (isRunning()) {
+        return false;
+    }
+    trigger = TRIGGER_NONE;
+    return true;
+}
+
+bool LogicCapture::setPeriodTrigger(uint32_t minUs, uint32_t maxUs) {
+    if (isRunning() || minUs > maxUs || maxUs == 0 || maxUs > MAX_TRIGGER_US) {
+        return false;
+    }
+    trigger = TRIGGER_PERIOD;
+    triggerMinUs = minUs;
+    triggerMaxUs = maxUs;
+    return true;
+}
+
+bool LogicCapture::setGapTrigger(uint32_t gapUs) {
+    if (isRunning() || gapUs == 0 || gapUs > MAX_TRIGGER_US) {
+        return false;
+    }
+    trigger = TRIGGER_GAP;
+    triggerGapUs = gapUs;
+    return true;
+}
+
+bool LogicCapture::setPreTrigger(uint32_t edges) {
+    if (isRunning() || edges > MAX_PRE_TRIGGER) {
+        return false;
+    }
+    preTrigger = edges;
+    return true;
+}
+
+const char* LogicCapture::getTriggerName() const {
+    switch (trigger) {
+        case TRIGGER_NONE:   return "NONE";
+        case TRIGGER_PERIOD: return "PERIOD";
+        case TRIGGER_GAP:    return "GAP";
+        default:             return "UNKNOWN";
+    }
+}
+
+// ============================================================================
+// Capture Control
+// ============================================================================
+
+bool LogicCapture::start(uint32_t newAmount, Limit newLimit) {
+    if (taskHandle || isRunning()) {
+        return false;
+    }
+    if (newAmount == 0 ||
+        (newLimit == LIMIT_EDGES && newAmount > MAX_EDGES) ||
+        (newLimit == LIMIT_TIME && newAmount > MAX_TIME_MS)) {
+        return false;
+    }
+    if (uart1.getMode() != UART1Mux::MODE_PWM_RPM) {
+        return false;
+    }
+    if (!allocate()) {
+        return false;
+    }
+
+    limit = newLimit;
+    amount = newAmount;
+    generation++;
+    head = 0;
+    total = 0;
+    first = 0;
+    firstSeq = 0;
+    preKept = 0;
+    seen = 0;
+    drops = 0;
+    dropCount = 0;
+    triggeredCapture = false;
+    complete = false;
+    postTicks = 0;
+    limitTicks = (uint64_t)newAmount * 1000 * (uint32_t)TICKS_PER_US;
+    durationTicks = 0;
+    triggerOffsetTicks = 0;
+    haveEdge = false;
+    haveRise = false;
+    message = "";
+    stopRequested = false;
+    startTime = millis();
+    triggerTime = 0;
+    state = STATE_ARMED;
+
+    // Switches the capture to both edges; edges arrive from here on
+    uart1.setEdgeTap(edgeTap, this);
+
+    BaseType_t ok = xTaskCreatePinnedToCore(
+        captureTask,
+        "Logic_Cap",
+        4096,
+        this,
+        3,                  // Same as the RPM loop: the ring must be drained every tick
+        &taskHandle,
+        1);
+    if (ok != pdPASS) {
+        uart1.setEdgeTap(nullptr, nullptr);
+        taskHandle = nullptr;
+        total = 0;
+        message = "Task creation failed";
+        state = STATE_FAILED;
+        return false;
+    }
+
+    Serial.printf("[CAPTURE] Armed: trigger %s, %lu %s after trigger, %lu pre-trigger\n",
+                  getTriggerName(), (unsigned long)amount,
+                  limit == LIMIT_EDGES ? "edges" : "ms", (unsigned long)preTrigger);
+    return true;
+}
+
+void LogicCapture::stop() {
+    if (isRunning()) {
+        stopRequested = true;
+    }
+}
+
+const char* LogicCapture::getStateName() const {
+    switch (state) {
+        case STATE_IDLE:      return "IDLE";
+        case STATE_ARMED:     return "ARMED";
+        case STATE_CAPTURING: return "CAPTURING";
+        case STATE_DONE:      return "DONE";
+        case STATE_ABORTED:   return "ABORTED";
+        case STATE_FAILED:    return "FAILED";
+        default:              return "UNKNOWN";
+    }
+}
+
+uint32_t LogicCapture::getElapsedMs() const {
+    if (state == STATE_IDLE) {
+        return 0;
+    }
+    return (isRunning() ? millis() : endTime) - startTime;
+}
+
+bool LogicCapture::allocate() {
+    if (buffer) {
+        return true;
+    }
+
+    // As much PSRAM as is free in one block, leaving a reserve
+    size_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM);
+    if (largest > PSRAM_RESERVE + FALLBACK_EDGES * sizeof(uint32_t)) {
+        size_t edges = (largest - PSRAM_RESERVE) / sizeof(uint32_t);
+        if (edges > MAX_EDGES) {
+            edges = MAX_EDGES;
+        }
+        buffer = static_cast<uint32_t*>(heap_caps_malloc(edges * sizeof(uint32_t),
+                                                         MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+        if (buffer) {
+            capacity = edges;
+            inPSRAM = true;
+        }
+    }
+    if (!buffer) {
+        buffer = static_cast<uint32_t*>(heap_caps_malloc(FALLBACK_EDGES * sizeof(uint32_t), MALLOC_CAP_8BIT));
+        if (buffer) {
+            capacity = FALLBACK_EDGES;
+            inPSRAM = false;
+        }
+    }
+    if (!buffer) {
+        Serial.println("[CAPTURE] ❌ Buffer allocation failed");
+        return false;
+    }
+
+    Serial.printf("[CAPTURE] Buffer: %lu edges in %s\n",
+                  (unsigned long)capacity, inPSRAM ? "PSRAM" : "internal RAM");
+    return true;
+}
+
+// ============================================================================
+// Capture Task
+// ============================================================================
+
+void LogicCapture::captureTask(void* arg) {
+    LogicCapture* self = static_cast<LogicCapture*>(arg);
+    self->run();
+    self->taskHandle = nullptr;
+    vTaskDelete(NULL);
+}
+
+void LogicCapture::run() {
+    State endState = STATE_DONE;
+    while (!complete) {
+        vTaskDelay(pdMS_TO_TICKS(DRAIN_PERIOD_MS));
+
+        // Drains the capture ring into edgeTap() (no-op while the RPM loop drains it)
+        uart1.updateRPMFrequency();
+
+        if (stopRequested) {
+            endState = STATE_ABORTED;
+            message = "Stopped";
+            break;
+        }
+        if (uart1.getMode() != UART1Mux::MODE_PWM_RPM) {
+            endState = STATE_ABORTED;
+            message = "UART1 left PWM/RPM mode";
+            break;
+        }
+        // A quiet line after the trigger still ends a timed capture
+        if (state == STATE_CAPTURING && limit == LIMIT_TIME && millis() - triggerTime >= amount) {
+            break;
+        }
+    }
+
+    // No edgeTap() call can be in progress after this returns
+    uart1.setEdgeTap(nullptr, nullptr);
+
+    if (!triggeredCapture) {
+        // Stopped while armed: export whatever the circular buffer holds
+        first = (head + capacity - total) % capacity;
+        firstSeq = seen - total;
+        preKept = total;
+        keepDrops();
+    }
+    measureSpan();
+
+    endTime = millis();
+    state = endState;
+
+    Serial.printf("[CAPTURE] %s: %lu edges (%lu pre-trigger), %.3f ms, %lu lost\n",
+                  getStateName(), (unsigned long)total, (unsigned long)preKept,
+                  getDurationMs(), (unsigned long)drops);
+}
+
+// ============================================================================
+// Edge Recording (called under the UART1 measurement lock)
+// ============================================================================
+
+void LogicCapture::edgeTap(uint32_t timestamp, bool rising, bool gap, void* arg) {
+    static_cast<LogicCapture*>(arg)->addEdge(timestamp, rising, gap);
+}
+
+void LogicCapture::addEdge(uint32_t timestamp, bool rising, bool gap) {
+    if (complete || !isRunning()) {
+        return;
+    }
+
+    uint32_t seq = seen++;
+    if (gap) {
+        drops++;
+        // Intervals across lost edges are meaningless for the trigger
+        haveEdge = false;
+        haveRise = false;
+        if (state == STATE_ARMED || dropCount < MAX_DROP_MARKS) {
+            // Circular while armed; keepDrops() sorts it out at the trigger
+            dropSeq[dropCount % MAX_DROP_MARKS] = seq;
+            dropCount++;
+        }
+    }
+
+    if (state == STATE_ARMED) {
+        bool hit = triggered(timestamp, rising);
+        haveEdge = true;
+        lastEdge = timestamp;
+        if (rising) {
+            haveRise = true;
+            lastRise = timestamp;
+        }
+        if (hit) {
+            fire(seq);
+            previousEdge = timestamp;
+        }
+        store(timestamp);
+        if (hit && total - preKept >= postLimit) {
+            complete = true;
+        }
+        return;
+    }
+
+    // STATE_CAPTURING
+    postTicks += (uint32_t)((timestamp & ~1u) - (previousEdge & ~1u));
+    previousEdge = timestamp;
+    if (limit == LIMIT_TIME && postTicks >= limitTicks) {
+        complete = true;
+        return;
+    }
+    store(timestamp);
+    if (total - preKept >= postLimit) {
+        complete = true;  // Edge count reached or buffer full
+    }
+}
+
+bool LogicCapture::triggered(uint32_t timestamp, bool rising) const {
+    switch (trigger) {
+        case TRIGGER_NONE:
+            return true;
+
+        case TRIGGER_PERIOD: {
+            if (!rising || !haveRise) {
+                return false;
+            }
+            uint32_t ticks = (timestamp & ~1u) - (lastRise & ~1u);
+            return ticks < triggerMinUs * (uint32_t)TICKS_PER_US ||
+                   ticks > triggerMaxUs * (uint32_t)TICKS_PER_US;
+        }
+
+        case TRIGGER_GAP: {
+            if (!haveEdge) {
+                return false;
+            }
+            uint32_t ticks = (timestamp & ~1u) - (lastEdge & ~1u);
+            return ticks > triggerGapUs * (uint32_t)TICKS_PER_US;
+        }
+
+        default:
+            return false;
+    }
+}
+
+void LogicCapture::fire(uint32_t seq) {
+    // Keep the last pre-trigger edges; the rest of the buffer is for after the trigger
+    uint32_t pre = preTrigger < capacity / 2 ? preTrigger : capacity / 2;
+    preKept = total < pre ? total : pre;
+    first = (head + capacity - preKept) % capacity;
+    firstSeq = seq - preKept;
+    total = preKept;
+    postLimit = capacity - preKept;
+    if (limit == LIMIT_EDGES && amount < postLimit) {
+        postLimit = amount;
+    }
+    keepDrops();
+
+    triggeredCapture = true;
+    triggerTime = millis();
+    state = STATE_CAPTURING;
+}
+
+void LogicCapture::store(uint32_t timestamp) {
+    buffer[head] = timestamp;
+    head = head + 1 < capacity ? head + 1 : 0;
+    if (total < capacity) {
+        total++;
+    }
+}
+
+void LogicCapture::keepDrops() {
+    // Keep the markers inside the exported range, oldest first
+    uint32_t kept[MAX_DROP_MARKS];
+    uint32_t count = dropCount < MAX_DROP_MARKS ? dropCount : MAX_DROP_MARKS;
+    uint32_t oldest = dropCount > MAX_DROP_MARKS ? dropCount % MAX_DROP_MARKS : 0;
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t seq = dropSeq[(oldest + i) % MAX_DROP_MARKS];
+        if ((int32_t)(seq - firstSeq) >= 0) {
+            kept[n++] = seq;
+        }
+    }
+    memcpy(dropSeq, kept, n * sizeof(uint32_t));
+    dropCount = n;
+}
+
+void LogicCapture::measureSpan() {
+    durationTicks = 0;
+    triggerOffsetTicks = 0;
+    for (uint32_t i = 1; i < total; i++) {
+        durationTicks += (uint32_t)((entry(i) & ~1u) - (entry(i - 1) & ~1u));
+        if (i == preKept) {
+            triggerOffsetTicks = durationTicks;
+        }
+    }
+}
+
+uint32_t LogicCapture::entry(uint32_t index) const {
+    uint32_t position = first + index;
+    if (position >= capacity) {
+        position -= capacity;
+    }
+    return buffer[position];
+}
+
+// ============================================================================
+// Export
+// ============================================================================
+
+bool LogicCapture::isExportDone(const ExportCursor& cursor) const {
+    return cursor.stage == 2;
+}
+
+bool LogicCapture::dropBefore(const ExportCursor& cursor) const {
+    return cursor.dropMark < dropCount && dropSeq[cursor.dropMark] == firstSeq + cursor.next;
+}
+
+size_t LogicCapture::exportChunk(Format format, ExportCursor& cursor, char* out, size_t maxLen) const {
+    size_t written = 0;
+
+    if (cursor.stage == 0) {
+        if (!hasData()) {
+            cursor.stage = 2;
+            return 0;
+        }
+        if (maxLen < EXPORT_HEADER_MAX) {
+            return 0;
+        }
+        cursor = ExportCursor();
+        cursor.generation = generation;
+        cursor.stage = 1;
+
+        bool initial = !(entry(0) & 1u);   // Level before the first edge
+        if (format == FORMAT_VCD) {
+            written += snprintf(out, maxLen,
+                                "$version composite_device_test logic capture $end\n"
+                                "$comment UART1 capture input, trigger %s, %lu edges "
+                                "(%lu before trigger), %lu lost $end\n"
+                                "$timescale 100ps $end\n"
+                                "$scope module uart1 $end\n"
+                                "$var wire 1 ! rx $end\n"
+                                "$var wire 1 \" trigger $end\n"
+                                "$upscope $end\n"
+                                "$enddefinitions $end\n"
+                                "#0\n"
+                                "$dumpvars\n"
+                                "%d!\n"
+                                "0\"\n"
+                                "$end\n",
+                                triggeredCapture ? getTriggerName() : "none (stopped while armed)",
+                                (unsigned long)total, (unsigned long)preKept, (unsigned long)drops,
+                                initial ? 1 : 0);
+        } else {
+            written += snprintf(out, maxLen,
+                                "# %lu edges, trigger at index %ld, %lu lost\n"
+                                "index,time_us,level,lost\n",
+                                (unsigned long)total, triggeredCapture ? (long)preKept : -1L,
+                                (unsigned long)drops);
+        }
+    }
+
+    if (cursor.stage == 1 && (cursor.generation != generation || isRunning())) {
+        cursor.stage = 2;  // A new capture has been started
+        return written;
+    }
+
+    while (cursor.stage == 1 && cursor.next < total && maxLen - written >= EXPORT_LINE_MAX) {
+        uint32_t raw = entry(cursor.next);
+        if (cursor.next > 0) {
+            cursor.ticks += (uint32_t)((raw & ~1u) - (cursor.previous & ~1u));
+        }
+        cursor.previous = raw;
+
+        int level = (raw & 1u) ? 1 : 0;
+        bool lost = dropBefore(cursor);
+        if (lost) {
+            cursor.dropMark++;
+        }
+
+        if (format == FORMAT_VCD) {
+            // Everything is shifted by one tick so the initial values own #0
+            if (lost) {
+                written += snprintf(out + written, maxLen - written, "$comment edges lost $end\n");
+            }
+            written += snprintf(out + written, maxLen - written, "#%llu\n%d!\n",
+                                (unsigned long long)((cursor.ticks + 1) * VCD_UNITS_PER_TICK), level);
+            if (triggeredCapture && cursor.next == preKept) {
+                written += snprintf(out + written, maxLen - written, "1\"\n");
+            }
+        } else {
+            double timeUs = ((double)cursor.ticks - (double)triggerOffsetTicks) / TICKS_PER_US;
+            written += snprintf(out + written, maxLen - written, "%lu,%.4f,%d,%d\n",
+                                (unsigned long)cursor.next, timeUs, level, lost ? 1 : 0);
+        }
+        cursor.next++;
+    }
+
+    if (cursor.stage == 1 && cursor.next >= total) {
+        cursor.stage = 2;
+    }
+    return written;
+}
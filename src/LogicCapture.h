@@ -0,0 +1,253 @@
+#ifndef LOGIC_CAPTURE_H
+#define LOGIC_CAPTURE_H
+
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+class UART1Mux;
+
+/**
+ * @brief Logic-analyzer capture of the UART1 RX pin
+ *
+ * Records the timestamp and polarity of every edge seen by the UART1
+ * capture input (the RX pin, or the TX pad with pulse loopback) into one
+ * large buffer. The buffer is allocated from PSRAM on the first start and
+ * kept; nothing is allocated while a capture runs. Each entry is the raw
+ * 80 MHz capture timer value with the polarity in bit 0, as queued by
+ * the capture ISR.
+ *
+ * Edges are taken from UART1Mux through its edge tap, which switches the
+ * capture to both edges. A capture task drains the capture ring every
+ * DRAIN_PERIOD_MS; above the ring's rate the capture throttles and the
+ * lost edges are counted and marked in the export.
+ *
+ * Until the trigger fires the buffer runs circularly and keeps the last
+ * pre-trigger edges. Triggers:
+ * - NONE:   the first edge
+ * - PERIOD: a rising-to-rising period outside [min, max] µs
+ * - GAP:    an edge more than N µs after the previous one (the edge
+ *           ending the gap is the trigger)
+ * After the trigger the capture stops after a number of edges or a time,
+ * or when the buffer is full.
+ *
+ * The result is exported as VCD (opens in PulseView/sigrok and GTKWave)
+ * or CSV with times relative to the trigger, in chunks for HTTP or CDC.
+ *
+ * Usage:
+ *   LogicCapture capture(uart1);
+ *   capture.setPeriodTrigger(90, 110);
+ *   capture.start(100000, LogicCapture::LIMIT_EDGES);
+ *   // ... later, when getState() == STATE_DONE
+ *   LogicCapture::ExportCursor cursor;
+ *   while ((n = capture.exportChunk(LogicCapture::FORMAT_VCD, cursor, buf, sizeof(buf))) > 0) { ... }
+ */
+class LogicCapture {
+public:
+    enum Trigger : uint8_t {
+        TRIGGER_NONE = 0,
+        TRIGGER_PERIOD,         ///< Rising-to-rising period out of range
+        TRIGGER_GAP             ///< No edge for longer than the gap time
+    };
+
+    enum Limit : uint8_t {
+        LIMIT_EDGES = 0,        ///< Edges after the trigger (trigger edge included)
+        LIMIT_TIME              ///< Milliseconds after the trigger
+    };
+
+    enum State : uint8_t {
+        STATE_IDLE = 0,
+        STATE_ARMED,            ///< Waiting for the trigger
+        STATE_CAPTURING,        ///< Triggered, filling the buffer
+        STATE_DONE,
+        STATE_ABORTED,          ///< Stopped by command or UART1 left PWM/RPM mode
+        STATE_FAILED
+    };
+
+    enum Format : uint8_t {
+        FORMAT_VCD = 0,
+        FORMAT_CSV
+    };
+
+    /**
+     * @brief Position of a chunked export
+     */
+    struct ExportCursor {
+        uint32_t next = 0;          ///< Next edge in output order
+        uint64_t ticks = 0;         ///< Unwrapped time of the previous edge
+        uint32_t previous = 0;      ///< Raw timestamp of the previous edge
+        uint16_t dropMark = 0;      ///< Next drop marker
+        uint16_t generation = 0;    ///< Capture being exported
+        uint8_t stage = 0;          ///< Header, edges, done
+    };
+
+    static const uint32_t MAX_EDGES = 4 * 1024 * 1024;     // 16 MB of PSRAM
+    static const uint32_t FALLBACK_EDGES = 8192;           // Internal RAM without PSRAM
+    static const size_t PSRAM_RESERVE = 256 * 1024;        // Left free for other PSRAM users
+    static const uint32_t MAX_PRE_TRIGGER = 1000000;
+    static const uint32_t MAX_TIME_MS = 600000;
+    static const uint32_t MAX_TRIGGER_US = 10000000;       // Well inside the 53 s timer wrap
+    static const uint32_t DRAIN_PERIOD_MS = 1;
+    static const uint16_t MAX_DROP_MARKS = 64;
+    static const size_t EXPORT_HEADER_MAX = 512;           // exportChunk() needs this much for the header
+    static const size_t EXPORT_LINE_MAX = 64;
+
+    explicit LogicCapture(UART1Mux& uart1);
+
+    // ========================================================================
+    // Configuration (applies to the next start, refused while running)
+    // ========================================================================
+
+    bool setNoTrigger();
+    bool setPeriodTrigger(uint32_t minUs, uint32_t maxUs);
+    bool setGapTrigger(uint32_t gapUs);
+    bool setPreTrigger(uint32_t edges);
+
+    Trigger getTrigger() const { return trigger; }
+    const char* getTriggerName() const;
+    uint32_t getTriggerMinUs() const { return triggerMinUs; }
+    uint32_t getTriggerMaxUs() const { return triggerMaxUs; }
+    uint32_t getTriggerGapUs() const { return triggerGapUs; }
+    uint32_t getPreTrigger() const { return preTrigger; }
+
+    // ========================================================================
+    // Capture Control
+    // ========================================================================
+
+    /**
+     * @brief Arm a capture
+     * @param amount Edges or milliseconds after the trigger
+     * @return false if a capture is running, UART1 is not in PWM/RPM mode,
+     *         the amount is out of range or the buffer cannot be allocated
+     */
+    bool start(uint32_t amount, Limit limit);
+
+    /**
+     * @brief Stop the running capture (returns immediately, keeps what was captured)
+     */
+    void stop();
+
+    bool isRunning() const { return state == STATE_ARMED || state == STATE_CAPTURING; }
+    State getState() const { return state; }
+    const char* getStateName() const;
+    Limit getLimit() const { return limit; }
+    uint32_t getAmount() const { return amount; }
+
+    /**
+     * @brief Reason for STATE_ABORTED / STATE_FAILED
+     */
+    const char* getMessage() const { return message; }
+
+    /**
+     * @brief Buffer size in edges (0 before the first start)
+     */
+    uint32_t getCapacity() const { return capacity; }
+    bool isInPSRAM() const { return inPSRAM; }
+
+    uint32_t getEdgeCount() const { return total; }         ///< Stored edges (after trigger: pre + post)
+    uint32_t getPreTriggerCount() const { return preKept; } ///< Stored edges before the trigger edge
+    uint32_t getSeenCount() const { return seen; }          ///< Edges seen since start
+    uint32_t getDropCount() const { return drops; }         ///< Ring overflows (edges lost)
+    uint32_t getElapsedMs() const;
+
+    /**
+     * @brief Time from the first to the last stored edge (valid once finished)
+     */
+    float getDurationMs() const { return durationTicks / (TICKS_PER_US * 1000.0f); }
+
+    // ========================================================================
+    // Export
+    // ========================================================================
+
+    /**
+     * @brief Write the next part of the export
+     *
+     * Writes whole lines only: the header needs EXPORT_HEADER_MAX bytes,
+     * edge lines EXPORT_LINE_MAX. Starting a new capture ends an export
+     * in progress.
+     *
+     * @return Bytes written; 0 when the export is complete (or nothing to
+     *         export) or maxLen is too small for the next line
+     */
+    size_t exportChunk(Format format, ExportCursor& cursor, char* out, size_t maxLen) const;
+
+    /**
+     * @brief Check whether an export has been written completely
+     */
+    bool isExportDone(const ExportCursor& cursor) const;
+
+    /**
+     * @brief Check whether there is a finished capture to export
+     */
+    bool hasData() const { return !isRunning() && total > 0; }
+
+private:
+    static constexpr float TICKS_PER_US = 80.0f;
+
+    UART1Mux& uart1;
+    TaskHandle_t taskHandle = nullptr;
+
+    // Configuration
+    Trigger trigger = TRIGGER_NONE;
+    uint32_t triggerMinUs = 0;
+    uint32_t triggerMaxUs = 0;
+    uint32_t triggerGapUs = 0;
+    uint32_t preTrigger = 1000;
+
+    // Buffer (kept once allocated)
+    uint32_t* buffer = nullptr;
+    uint32_t capacity = 0;
+    bool inPSRAM = false;
+
+    // Capture state (written under the UART1 measurement lock)
+    volatile State state = STATE_IDLE;
+    volatile bool stopRequested = false;
+    const char* message = "";
+    Limit limit = LIMIT_EDGES;
+    uint32_t amount = 0;
+    uint16_t generation = 0;
+    uint32_t head = 0;                  // Next write position
+    volatile uint32_t total = 0;        // Valid entries
+    uint32_t first = 0;                 // First entry in output order
+    uint32_t firstSeq = 0;              // seen-count of the first entry
+    uint32_t preKept = 0;
+    uint32_t postLimit = 0;             // Entries allowed after the trigger edge
+    volatile uint32_t seen = 0;
+    volatile uint32_t drops = 0;
+    bool triggeredCapture = false;      // The trigger fired (else stopped while armed)
+    volatile bool complete = false;     // Limit reached, the task finishes up
+    uint32_t previousEdge = 0;
+    uint64_t postTicks = 0;             // Time since the trigger edge
+    uint64_t limitTicks = 0;
+    uint64_t durationTicks = 0;
+    uint64_t triggerOffsetTicks = 0;    // First stored edge → trigger edge
+    unsigned long startTime = 0;
+    volatile unsigned long triggerTime = 0;
+    unsigned long endTime = 0;
+
+    // Trigger evaluation
+    bool haveEdge = false;
+    bool haveRise = false;
+    uint32_t lastEdge = 0;
+    uint32_t lastRise = 0;
+
+    // Lost-edge markers: seen-count of the first edge after each drop
+    uint32_t dropSeq[MAX_DROP_MARKS];
+    uint32_t dropCount = 0;
+
+    bool allocate();
+    void addEdge(uint32_t timestamp, bool rising, bool gap);
+    bool triggered(uint32_t timestamp, bool rising) const;
+    void fire(uint32_t seq);
+    void store(uint32_t timestamp);
+    void keepDrops();
+    void measureSpan();
+    void run();
+    static void captureTask(void* arg);
+    static void edgeTap(uint32_t timestamp, bool rising, bool gap, void* arg);
+
+    uint32_t entry(uint32_t index) const;
+    bool dropBefore(const ExportCursor& cursor) const;
+};
+
+#endif // LOGIC_CAPTURE_H
@@ -0,0 +1,398 @@
+#include "ModbusServer.h"
+#include "UART2Manager.h"
+#include "UART1Mux.h"
+#include "RelayControl.h"
+#include "GPIOControl.h"
+#include "esp_timer.h"
+
+static const uint8_t FC_READ_HOLDING = 0x03;
+static const uint8_t FC_READ_INPUT = 0x04;
+static const uint8_t FC_WRITE_SINGLE = 0x06;
+static const uint8_t FC_WRITE_MULTIPLE = 0x10;
+
+static const uint16_t MAX_READ_COUNT = 125;
+static const uint16_t MAX_WRITE_COUNT = 123;
+
+static const uint32_t SERVER_POLL_MS = 50;     // Check for stop
+static const uint32_t SERVER_STOP_TIMEOUT_MS = 500;
+
+// ============================================================================
+// CRC-16/MODBUS (table for the reflected polynomial 0xA001)
+// ============================================================================
+
+static const uint16_t CRC_TABLE[256] = {
+    0x0000, 0xC0C1, 0xC181, 0x0140, 0xC301, 0x03C0, 0x0280, 0xC241,
+    0xC601, 0x06C0, 0x0780, 0xC741, 0x0500, 0xC5C1, 0xC481, 0x0440,
+    0xCC01, 0x0CC0, 0x0D80, 0xCD41, 0x0F00, 0xCFC1, 0xCE81, 0x0E40,
+    0x0A00, 0xCAC1, 0xCB81, 0x0B40, 0xC901, 0x09C0, 0x0880, 0xC841,
+    0xD801, 0x18C0, 0x1980, 0xD941, 0x1B00, 0xDBC1, 0xDA81, 0x1A40,
+    0x1E00, 0xDEC1, 0xDF81, 0x1F40, 0xDD01, 0x1DC0, 0x1C80, 0xDC41,
+    0x1400, 0xD4C1, 0xD581, 0x1540, 0xD701, 0x17C0, 0x1680, 0xD641,
+    0xD201, 0x12C0, 0x1380, 0xD341, 0x1100, 0xD1C1, 0xD081, 0x1040,
+    0xF001, 0x30C0, 0x3180, 0xF141, 0x3300, 0xF3C1, 0xF281, 0x3240,
+    0x3600, 0xF6C1, 0xF781, 0x3740, 0xF501, 0x35C0, 0x3480, 0xF441,
+    0x3C00, 0xFCC1, 0xFD81, 0x3D40, 0xFF01, 0x3FC0, 0x3E80, 0xFE41,
+    0xFA01, 0x3AC0, 0x3B80, 0xFB41, 0x3900, 0xF9C1, 0xF881, 0x3840,
+    0x2800, 0xE8C1, 0xE981, 0x2940, 0xEB01, 0x2BC0, 0x2A80, 0xEA41,
+    0xEE01, 0x2EC0, 0x2F80, 0xEF41, 0x2D00, 0xEDC1, 0xEC81, 0x2C40,
+    0xE401, 0x24C0, 0x2580, 0xE541, 0x2700, 0xE7C1, 0xE681, 0x2640,
+    0x2200, 0xE2C1, 0xE381, 0x2340, 0xE101, 0x21C0, 0x2080, 0xE041,
+    0xA001, 0x60C0, 0x6180, 0xA141, 0x6300, 0xA3C1, 0xA281, 0x6240,
+    0x6600, 0xA6C1, 0xA781, 0x6740, 0xA501, 0x65C0, 0x6480, 0xA441,
+    0x6C00, 0xACC1, 0xAD81, 0x6D40, 0xAF01, 0x6FC0, 0x6E80, 0xAE41,
+    0xAA01, 0x6AC0, 0x6B80, 0xAB41, 0x6900, 0xA9C1, 0xA881, 0x6840,
+    0x7800, 0xB8C1, 0xB981, 0x7940, 0xBB01, 0x7BC0, 0x7A80, 0xBA41,
+    0xBE01, 0x7EC0, 0x7F80, 0xBF41, 0x7D00, 0xBDC1, 0xBC81, 0x7C40,
+    0xB401, 0x74C0, 0x7580, 0xB541, 0x7700, 0xB7C1, 0xB681, 0x7640,
+    0x7200, 0xB2C1, 0xB381, 0x7340, 0xB101, 0x71C0, 0x7080, 0xB041,
+    0x5000, 0x90C1, 0x9181, 0x5140, 0x9301, 0x53C0, 0x5280, 0x9241,
+    0x9601, 0x56C0, 0x5780, 0x9741, 0x5500, 0x95C1, 0x9481, 0x5440,
+    0x9C01, 0x5CC0, 0x5D80, 0x9D41, 0x5F00, 0x9FC1, 0x9E81, 0x5E40,
+    0x5A00, 0x9AC1, 0x9B81, 0x5B40, 0x9901, 0x59C0, 0x5880, 0x9841,
+    0x8801, 0x48C0, 0x4980, 0x8941, 0x4B00, 0x8BC1, 0x8A81, 0x4A40,
+    0x4E00, 0x8EC1, 0x8F81, 0x4F40, 0x8D01, 0x4DC0, 0x4C80, 0x8C41,
+    0x4400, 0x84C1, 0x8581, 0x4540, 0x8701, 0x47C0, 0x4680, 0x8641,
+    0x8201, 0x42C0, 0x4380, 0x8341, 0x4100, 0x81C1, 0x8081, 0x4040,
+};
+
+uint16_t ModbusServer::crc16(const uint8_t* data, size_t length) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc = (crc >> 8) ^ CRC_TABLE[(crc ^ data[i]) & 0xFF];
+    }
+    return crc;
+}
+
+// ============================================================================
+// Server Control
+// ============================================================================
+
+ModbusServer::ModbusServer(UART2Manager& uart2, UART1Mux& uart1, RelayControl& relay, GPIOControl& gpio)
+    : uart2(uart2), uart1(uart1), relay(relay), gpio(gpio) {
+}
+
+bool ModbusServer::begin(uint8_t newUnit, uint32_t baudRate, uart_parity_t parity, uart_stop_bits_t stopBits) {
+    if (newUnit < 1 || newUnit > MAX_UNIT) {
+        return false;
+    }
+    if (!uart2.isInitialized()) {
+        return false;
+    }
+
+    end();
+    if (!uart2.reconfigure(baudRate, stopBits, parity, UART_DATA_8_BITS)) {
+        return false;
+    }
+
+    // t3.5: 3.5 characters of 11 bits up to 19200 baud, fixed 1.75 ms above
+    uint32_t characters;
+    if (baudRate <= 19200) {
+        characters = 4;
+    } else {
+        characters = (1750ULL * baudRate + 11000000 - 1) / 11000000;
+    }
+    if (characters > UART2Manager::IDLE_MAX_CHARACTERS) {
+        characters = UART2Manager::IDLE_MAX_CHARACTERS;
+    }
+    if (!uart2.setIdleCharacters(characters)) {
+        return false;
+    }
+    idleCharacters = characters;
+
+    if (!uart2.startFrames(UART2Manager::FRAME_IDLE)) {
+        uart2.setIdleCharacters(UART2Manager::IDLE_DEFAULT_CHARACTERS);
+        return false;
+    }
+
+    unit = newUnit;
+    stats = {};
+    message = "";
+    stopRequested = false;
+    running = true;
+    BaseType_t ok = xTaskCreatePinnedToCore(
+        serverTask,
+        "Modbus",
+        4096,
+        this,
+        3,                  // Same as the UART2 frame receiver feeding it
+        &taskHandle,
+        1);
+    if (ok != pdPASS) {
+        taskHandle = nullptr;
+        running = false;
+        uart2.stopFrames();
+        uart2.setIdleCharacters(UART2Manager::IDLE_DEFAULT_CHARACTERS);
+        return false;
+    }
+
+    Serial.printf("[MODBUS] Server started: unit %u, %u baud, t3.5 = %u characters\n",
+                  unit, baudRate, idleCharacters);
+    return true;
+}
+
+void ModbusServer::end() {
+    if (taskHandle) {
+        stopRequested = true;
+        unsigned long stopStart = millis();
+        while (taskHandle && millis() - stopStart < SERVER_STOP_TIMEOUT_MS) {
+            vTaskDelay(pdMS_TO_TICKS(5));
+        }
+        uart2.stopFrames();
+        uart2.setIdleCharacters(UART2Manager::IDLE_DEFAULT_CHARACTERS);
+        message = "";
+    }
+    running = false;
+}
+
+void ModbusServer::resetStatistics() {
+    stats = {};
+}
+
+// ============================================================================
+// Register Map
+// ============================================================================
+
+uint16_t ModbusServer::readHolding(uint16_t address) const {
+    switch (address) {
+        case 0: return uart1.getPWMFrequency() >> 16;
+        case 1: return uart1.getPWMFrequency() & 0xFFFF;
+        case 2: return (uint16_t)lroundf(uart1.getPWMDuty() * 100.0f);
+        case 3: return uart1.isPWMEnabled() ? 1 : 0;
+        case 4: return uart1.getPolePairs();
+        case 5: return relay.getState() ? 1 : 0;
+        case 6: return gpio.getState() ? 1 : 0;
+        default: return 0;
+    }
+}
+
+uint16_t ModbusServer::readInput(uint16_t address) const {
+    uint32_t value;
+    bool high = false;
+
+    switch (address) {
+        case 0: high = true;    // fall through
+        case 1: value = (uint32_t)lroundf(uart1.getCalculatedRPM()); break;
+        case 2: high = true;    // fall through
+        case 3: value = (uint32_t)lroundf(uart1.getRPMFrequency() * 10.0f); break;
+        case 4: return uart1.hasRPMSignal() ? 1 : 0;
+        case 5: high = true;    // fall through
+        case 6: value = millis() / 1000; break;
+        case 7: high = true;    // fall through
+        case 8: value = stats.requests; break;
+        case 9: high = true;    // fall through
+        case 10: value = stats.broadcasts; break;
+        case 11: high = true;   // fall through
+        case 12: value = stats.exceptions; break;
+        case 13: high = true;   // fall through
+        case 14: value = stats.crcErrors; break;
+        case 15: high = true;   // fall through
+        case 16: value = stats.frameErrors; break;
+        case 17: return stats.turnaroundLastUs > 0xFFFF ? 0xFFFF : stats.turnaroundLastUs;
+        case 18: return stats.turnaroundMaxUs > 0xFFFF ? 0xFFFF : stats.turnaroundMaxUs;
+        default: return 0;
+    }
+    return high ? value >> 16 : value & 0xFFFF;
+}
+
+uint8_t ModbusServer::writeHolding(uint16_t start, const uint16_t* values, uint16_t count) {
+    uint16_t regs[HOLDING_COUNT];
+    bool touched[HOLDING_COUNT] = {};
+    for (uint16_t i = 0; i < HOLDING_COUNT; i++) {
+        regs[i] = readHolding(i);
+    }
+    for (uint16_t i = 0; i < count; i++) {
+        regs[start + i] = values[i];
+        touched[start + i] = true;
+    }
+
+    // Check everything before anything is applied
+    bool frequency = touched[0] || touched[1];
+    uint32_t hz = ((uint32_t)regs[0] << 16) | regs[1];
+    if ((frequency && hz == 0) || (touched[2] && regs[2] > 10000) || (touched[3] && regs[3] > 1) ||
+        (touched[4] && (regs[4] < 1 || regs[4] > 12)) || (touched[5] && regs[5] > 1) ||
+        (touched[6] && regs[6] > 1)) {
+        return EXCEPTION_ILLEGAL_VALUE;
+    }
+    if ((frequency || touched[2] || touched[3]) && uart1.getMode() != UART1Mux::MODE_PWM_RPM) {
+        return EXCEPTION_DEVICE_FAILURE;
+    }
+
+    if (frequency && !uart1.setPWMFrequency(hz)) {
+        return EXCEPTION_ILLEGAL_VALUE;     // Outside the range the PWM can synthesize
+    }
+    if (touched[2] && !uart1.setPWMDuty(regs[2] / 100.0f)) {
+        return EXCEPTION_DEVICE_FAILURE;
+    }
+    if (touched[3]) {
+        uart1.setPWMEnabled(regs[3] != 0);
+    }
+    if (touched[4] && !uart1.setPolePairs(regs[4])) {
+        return EXCEPTION_DEVICE_FAILURE;
+    }
+    if (touched[5]) {
+        relay.setState(regs[5] != 0);
+    }
+    if (touched[6]) {
+        gpio.setState(regs[6] != 0);
+    }
+    return 0;
+}
+
+// ============================================================================
+// Requests
+// ============================================================================
+
+size_t ModbusServer::exception(uint8_t function, uint8_t code) {
+    reply[1] = function | 0x80;
+    reply[2] = code;
+    return 3;
+}
+
+size_t ModbusServer::handleRequest(const uint8_t* request, size_t length) {
+    uint8_t function = request[1];
+    reply[0] = request[0];
+    reply[1] = function;
+
+    if (function != FC_READ_HOLDING && function != FC_READ_INPUT &&
+        function != FC_WRITE_SINGLE && function != FC_WRITE_MULTIPLE) {
+        return exception(function, EXCEPTION_ILLEGAL_FUNCTION);
+    }
+    if (length < 6) {
+        return exception(function, EXCEPTION_ILLEGAL_VALUE);
+    }
+
+    uint16_t start = (request[2] << 8) | request[3];
+    uint16_t count = (request[4] << 8) | request[5];     // The value for FC 6
+
+    switch (function) {
+        case FC_READ_HOLDING:
+        case FC_READ_INPUT: {
+            uint16_t limit = function == FC_READ_HOLDING ? HOLDING_COUNT : INPUT_COUNT;
+            if (length != 6 || count < 1 || count > MAX_READ_COUNT) {
+                return exception(function, EXCEPTION_ILLEGAL_VALUE);
+            }
+            if ((uint32_t)start + count > limit) {
+                return exception(function, EXCEPTION_ILLEGAL_ADDRESS);
+            }
+            reply[2] = count * 2;
+            for (uint16_t i = 0; i < count; i++) {
+                uint16_t value = function == FC_READ_HOLDING ? readHolding(start + i) : readInput(start + i);
+                reply[3 + 2 * i] = value >> 8;
+                reply[4 + 2 * i] = value & 0xFF;
+            }
+            return 3 + count * 2;
+        }
+
+        case FC_WRITE_SINGLE: {
+            if (length != 6) {
+                return exception(function, EXCEPTION_ILLEGAL_VALUE);
+            }
+            if (start >= HOLDING_COUNT) {
+                return exception(function, EXCEPTION_ILLEGAL_ADDRESS);
+            }
+            uint8_t code = writeHolding(start, &count, 1);
+            if (code != 0) {
+                return exception(function, code);
+            }
+            memcpy(reply, request, 6);      // Echo
+            return 6;
+        }
+
+        default: {  // FC_WRITE_MULTIPLE
+            if (length < 7 || count < 1 || count > MAX_WRITE_COUNT ||
+                request[6] != count * 2 || length != 7 + (size_t)count * 2) {
+                return exception(function, EXCEPTION_ILLEGAL_VALUE);
+            }
+            if ((uint32_t)start + count > HOLDING_COUNT) {
+                return exception(function, EXCEPTION_ILLEGAL_ADDRESS);
+            }
+            uint16_t values[HOLDING_COUNT];
+            for (uint16_t i = 0; i < count; i++) {
+                values[i] = (request[7 + 2 * i] << 8) | request[8 + 2 * i];
+            }
+            uint8_t code = writeHolding(start, values, count);
+            if (code != 0) {
+                return exception(function, code);
+            }
+            memcpy(reply, request, 6);      // Address, function, start, count
+            return 6;
+        }
+    }
+}
+
+void ModbusServer::handleFrame(const uint8_t* data, size_t length, uint8_t flags, uint32_t timestampUs) {
+    if ((flags & (UART2Manager::FRAME_FLAG_SPLIT | UART2Manager::FRAME_FLAG_LOSS)) ||
+        length < 4 || length > MAX_ADU) {
+        stats.frameErrors++;
+        return;
+    }
+
+    uint16_t crc = data[length - 2] | (data[length - 1] << 8);
+    if (crc16(data, length - 2) != crc) {
+        stats.crcErrors++;
+        return;
+    }
+
+    uint8_t address = data[0];
+    if (address != 0 && address != unit) {
+        stats.otherUnits++;
+        return;
+    }
+    stats.requests++;
+
+    size_t replyLength = handleRequest(data, length - 2);
+    if (address == 0) {
+        stats.broadcasts++;     // Executed, never answered
+        return;
+    }
+
+    crc = crc16(reply, replyLength);
+    reply[replyLength++] = crc & 0xFF;
+    reply[replyLength++] = crc >> 8;
+
+    uint32_t turnaround = (uint32_t)esp_timer_get_time() - timestampUs;
+    // No TX-done wait: the driver's TX ring carries the reply
+    uart2.write(reply, replyLength, 0);
+
+    if (reply[1] & 0x80) {
+        stats.exceptions++;
+    }
+    stats.turnaroundLastUs = turnaround;
+    if (stats.replies == 0 || turnaround < stats.turnaroundMinUs) {
+        stats.turnaroundMinUs = turnaround;
+    }
+    if (turnaround > stats.turnaroundMaxUs) {
+        stats.turnaroundMaxUs = turnaround;
+    }
+    stats.turnaroundTotalUs += turnaround;
+    stats.replies++;
+}
+
+// ============================================================================
+// Server Task
+// ============================================================================
+
+void ModbusServer::serverTask(void* arg) {
+    ModbusServer* self = static_cast<ModbusServer*>(arg);
+    self->run();
+    self->running = false;
+    self->taskHandle = nullptr;
+    vTaskDelete(NULL);
+}
+
+void ModbusServer::run() {
+    while (!stopRequested) {
+        // Someone else reconfigured the frame receiver: the server is gone
+        if (uart2.getFrameMode() != UART2Manager::FRAME_IDLE) {
+            message = "UART2 frame receiver changed";
+            Serial.println("[MODBUS] Server stopped: UART2 frame receiver changed");
+            return;
+        }
+
+        UART2Manager::Frame frame;
+        if (uart2.receiveFrame(frame, SERVER_POLL_MS)) {
+            handleFrame(frame.data, frame.length, frame.flags, frame.timestampUs);
+            uart2.releaseFrame(frame);
+        }
+    }
+}
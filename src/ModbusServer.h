@@ -0,0 +1,138 @@
+#ifndef MODBUS_SERVER_H
+#define MODBUS_SERVER_H
+
+#include <Arduino.h>
+#include "driver/uart.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+class UART2Manager;
+class UART1Mux;
+class RelayControl;
+class GPIOControl;
+
+/**
+ * @brief Modbus RTU server (slave) on UART2
+ *
+ * Requests are delimited by the UART2 frame receiver in FRAME_IDLE mode
+ * with the RX idle gap set to t3.5 (3.5 character times, rounded up; a
+ * fixed 1.75 ms above 19200 baud as the specification recommends). The
+ * gap is detected by the UART's RX timeout interrupt, so no timer runs
+ * per character. The CRC-16 is computed from a 256-entry table.
+ *
+ * The server runs in its own task and answers without the command
+ * parser; the text consoles keep working while it runs.
+ *
+ * Function codes: 3 (read holding registers), 4 (read input
+ * registers), 6 (write single register) and 16 (write multiple
+ * registers). Broadcast (unit 0) writes are executed without a reply.
+ * 32-bit values take two registers, high word first.
+ *
+ * Holding registers (read/write):
+ *   0-1  PWM frequency (Hz)      2  PWM duty (0.01 %)    3  PWM output (0/1)
+ *   4    Pole pairs              5  Relay (0/1)          6  GPIO output (0/1)
+ *
+ * Input registers (read only):
+ *   0-1  RPM                     2-3  RPM input frequency (0.1 Hz)
+ *   4    RPM signal present      5-6  Uptime (s)
+ *   7-8  Requests                9-10 Broadcasts         11-12 Exceptions
+ *   13-14 CRC errors             15-16 Frame errors
+ *   17   Last turnaround (us)    18   Max turnaround (us)
+ *
+ * Turnaround is the time from the end of a request (t3.5 detected) to
+ * the reply being handed to the UART driver.
+ *
+ * Usage:
+ *   ModbusServer modbus(uart2, uart1, relay, gpio);
+ *   modbus.begin(1, 19200, UART_PARITY_EVEN, UART_STOP_BITS_1);
+ */
+class ModbusServer {
+public:
+    struct Statistics {
+        uint32_t requests;          ///< Valid requests for this unit (including broadcasts)
+        uint32_t broadcasts;
+        uint32_t exceptions;        ///< Exception replies sent
+        uint32_t crcErrors;
+        uint32_t frameErrors;       ///< Too short, too long or received across an RX loss
+        uint32_t otherUnits;        ///< Valid requests for other units
+        uint32_t turnaroundLastUs;
+        uint32_t turnaroundMinUs;
+        uint32_t turnaroundMaxUs;
+        uint64_t turnaroundTotalUs;
+        uint32_t replies;
+    };
+
+    enum Exception : uint8_t {
+        EXCEPTION_ILLEGAL_FUNCTION = 0x01,
+        EXCEPTION_ILLEGAL_ADDRESS = 0x02,
+        EXCEPTION_ILLEGAL_VALUE = 0x03,
+        EXCEPTION_DEVICE_FAILURE = 0x04
+    };
+
+    static const uint16_t HOLDING_COUNT = 7;
+    static const uint16_t INPUT_COUNT = 19;
+    static const size_t MAX_ADU = 256;          // Address + PDU + CRC
+    static const uint8_t MAX_UNIT = 247;
+
+    ModbusServer(UART2Manager& uart2, UART1Mux& uart1, RelayControl& relay, GPIOControl& gpio);
+
+    /**
+     * @brief Start the server (reconfigures UART2, takes over its frame receiver)
+     * @param unit Server address (1-MAX_UNIT)
+     * @return false if UART2 is not initialized, a parameter is out of range
+     *         or the frame receiver / task cannot start
+     */
+    bool begin(uint8_t unit, uint32_t baudRate, uart_parity_t parity, uart_stop_bits_t stopBits);
+
+    /**
+     * @brief Stop the server and the UART2 frame receiver
+     */
+    void end();
+
+    bool isRunning() const { return running; }
+    uint8_t getUnit() const { return unit; }
+
+    /**
+     * @brief Why the server stopped by itself ("" while running or after end())
+     */
+    const char* getMessage() const { return message; }
+
+    /**
+     * @brief t3.5 as set on the UART (character times)
+     */
+    uint8_t getIdleCharacters() const { return idleCharacters; }
+
+    Statistics getStatistics() const { return stats; }
+    void resetStatistics();
+
+    /**
+     * @brief CRC-16/MODBUS (init 0xFFFF, reflected 0x8005), sent low byte first
+     */
+    static uint16_t crc16(const uint8_t* data, size_t length);
+
+private:
+    UART2Manager& uart2;
+    UART1Mux& uart1;
+    RelayControl& relay;
+    GPIOControl& gpio;
+    TaskHandle_t taskHandle = nullptr;
+    volatile bool running = false;
+    volatile bool stopRequested = false;
+    const char* message = "";
+    uint8_t unit = 1;
+    uint8_t idleCharacters = 4;
+
+    uint8_t reply[MAX_ADU];
+    Statistics stats = {};
+
+    uint16_t readHolding(uint16_t address) const;
+    uint16_t readInput(uint16_t address) const;
+    uint8_t writeHolding(uint16_t start, const uint16_t* values, uint16_t count);
+    size_t handleRequest(const uint8_t* request, size_t length);
+    size_t exception(uint8_t function, uint8_t code);
+    void handleFrame(const uint8_t* data, size_t length, uint8_t flags, uint32_t timestampUs);
+    void run();
+    static void serverTask(void* arg);
+};
+
+#endif // MODBUS_SERVER_H
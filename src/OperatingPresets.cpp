@@ -0,0 +1,262 @@
+#include "OperatingPresets.h"
+#include <Preferences.h>
+#include "esp_timer.h"
+
+static const char* NVS_NAMESPACE = "op_presets";
+
+// NVS blob layout; a version or size mismatch drops the preset
+struct PresetRecord {
+    uint8_t version;
+    OperatingPresets::Preset preset;
+};
+
+OperatingPresets::OperatingPresets(UART1Mux& uart1, LEDPWMControl& ledPWM, RelayControl& relay)
+    : uart1(uart1), ledPWM(ledPWM), relay(relay) {
+}
+
+bool OperatingPresets::begin() {
+    Preferences prefs;
+    if (!prefs.begin(NVS_NAMESPACE, true)) {  // Read-only; fails until the first save
+        return false;
+    }
+
+    char key[8];
+    for (uint8_t i = 0; i < MAX_PRESETS; i++) {
+        snprintf(key, sizeof(key), "p%u", i + 1);
+        PresetRecord record;
+        if (prefs.isKey(key) && prefs.getBytesLength(key) == sizeof(record) &&
+            prefs.getBytes(key, &record, sizeof(record)) == sizeof(record) &&
+            record.version == RECORD_VERSION) {
+            presets[i] = record.preset;
+            presets[i].name[NAME_LENGTH - 1] = '\0';
+        } else {
+            presets[i] = {};
+        }
+    }
+
+    prefs.end();
+    return true;
+}
+
+bool OperatingPresets::persist(uint8_t index) {
+    Preferences prefs;
+    if (!prefs.begin(NVS_NAMESPACE, false)) {
+        Serial.println("[Presets] Failed to open NVS for saving");
+        return false;
+    }
+
+    char key[8];
+    snprintf(key, sizeof(key), "p%u", index);
+    bool ok;
+    if (presets[index - 1].valid) {
+        PresetRecord record;
+        record.version = RECORD_VERSION;
+        record.preset = presets[index - 1];
+        ok = prefs.putBytes(key, &record, sizeof(record)) == sizeof(record);
+    } else {
+        ok = !prefs.isKey(key) || prefs.remove(key);
+    }
+
+    prefs.end();
+    return ok;
+}
+
+// ============================================================================
+// Save
+// ============================================================================
+
+uint32_t OperatingPresets::preferredPrescaler(uint8_t exclude) const {
+    // The prescaler most presets already run on, so new ones join their glitch-free set
+    uint8_t bestCount = 0;
+    uint32_t best = uart1.getPWMPrescaler();
+    for (uint8_t i = 0; i < MAX_PRESETS; i++) {
+        const Preset& a = presets[i];
+        if (!a.valid || i + 1 == exclude || a.pwm.clockHz != uart1.getPWMClock()) {
+            continue;
+        }
+        uint8_t count = 0;
+        for (uint8_t j = 0; j < MAX_PRESETS; j++) {
+            const Preset& b = presets[j];
+            if (b.valid && j + 1 != exclude && b.pwm.clockHz == a.pwm.clockHz &&
+                b.pwm.prescaler == a.pwm.prescaler) {
+                count++;
+            }
+        }
+        if (count > bestCount) {
+            bestCount = count;
+            best = a.pwm.prescaler;
+        }
+    }
+    return best;
+}
+
+bool OperatingPresets::define(uint8_t index, const char* name, uint32_t frequency, float duty,
+                              float ledBrightness, bool ledEnabled, bool relayState, String& error) {
+    if (index < 1 || index > MAX_PRESETS) {
+        error = "Preset must be 1-" + String(MAX_PRESETS);
+        return false;
+    }
+    if (uart1.getMode() != UART1Mux::MODE_PWM_RPM) {
+        error = "UART1 not in PWM mode";
+        return false;
+    }
+    if (frequency < 10 || frequency > 500000) {
+        error = "freq must be 10-500000 Hz";
+        return false;
+    }
+    if (frequency > uart1.getMaxFrequency()) {
+        error = "freq exceeds maxFreq";
+        return false;
+    }
+    if (duty < 0.0 || duty > 100.0) {
+        error = "duty must be 0-100%";
+        return false;
+    }
+    if (ledBrightness < 0.0 || ledBrightness > 100.0) {
+        error = "led must be 0-100%";
+        return false;
+    }
+
+    Preset preset = {};
+    if (!uart1.resolvePWMImage(frequency, duty, preferredPrescaler(index), preset.pwm)) {
+        error = "freq cannot be synthesized";
+        return false;
+    }
+    preset.valid = true;
+    if (name && name[0] != '\0') {
+        strlcpy(preset.name, name, NAME_LENGTH);
+    } else {
+        snprintf(preset.name, NAME_LENGTH, "P%u", index);
+    }
+    preset.ledBrightness = ledBrightness;
+    preset.ledEnabled = ledEnabled;
+    preset.relay = relayState;
+
+    presets[index - 1] = preset;
+    if (!persist(index)) {
+        error = "NVS write failed (kept until reboot)";
+        return false;
+    }
+    return true;
+}
+
+bool OperatingPresets::saveCurrent(uint8_t index, const char* name, String& error) {
+    return define(index, name, uart1.getPWMFrequency(), uart1.getPWMDuty(),
+                  ledPWM.getBrightness(), ledPWM.isEnabled(), relay.getState(), error);
+}
+
+bool OperatingPresets::remove(uint8_t index) {
+    if (index < 1 || index > MAX_PRESETS || !presets[index - 1].valid) {
+        return false;
+    }
+    presets[index - 1] = {};
+    if (active == index) {
+        active = 0;
+    }
+    return persist(index);
+}
+
+// ============================================================================
+// Recall
+// ============================================================================
+
+bool OperatingPresets::recall(uint8_t index, String& error, bool* prescalerChanged) {
+    if (index < 1 || index > MAX_PRESETS || !presets[index - 1].valid) {
+        error = "Preset empty";
+        return false;
+    }
+    if (uart1.getMode() != UART1Mux::MODE_PWM_RPM) {
+        error = "UART1 not in PWM mode";
+        return false;
+    }
+
+    Preset& preset = presets[index - 1];
+    int64_t start = esp_timer_get_time();
+
+    if (preset.pwm.clockHz != uart1.getPWMClock()) {
+        // Slow path, once: the image was resolved for another MCPWM clock
+        UART1Mux::PWMImage image;
+        if (!uart1.resolvePWMImage(preset.pwm.frequency, preset.pwm.duty, preferredPrescaler(0), image)) {
+            error = "freq cannot be synthesized";
+            return false;
+        }
+        preset.pwm = image;
+        stats.reResolved++;
+    }
+
+    bool changed = preset.pwm.prescaler != uart1.getPWMPrescaler();
+    if (!uart1.applyPWMImage(preset.pwm)) {
+        error = "freq exceeds maxFreq";
+        return false;
+    }
+
+    // LEDC latches the new duty at the end of its own period
+    ledPWM.setBrightness(preset.ledBrightness);
+    ledPWM.enable(preset.ledEnabled);
+    if (relay.getState() != preset.relay) {
+        relay.setState(preset.relay);
+    }
+
+    uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+    stats.recalls++;
+    if (changed) {
+        stats.prescalerChanges++;
+    }
+    stats.lastRecallUs = elapsed;
+    if (elapsed > stats.maxRecallUs) {
+        stats.maxRecallUs = elapsed;
+    }
+    active = index;
+    if (prescalerChanged) {
+        *prescalerChanged = changed;
+    }
+    return true;
+}
+
+uint8_t OperatingPresets::recallNext(String& error) {
+    error = "No presets stored";
+    for (uint8_t step = 1; step <= MAX_PRESETS; step++) {
+        uint8_t index = (active + step - 1) % MAX_PRESETS + 1;
+        if (presets[index - 1].valid) {
+            return recall(index, error) ? index : 0;
+        }
+    }
+    return 0;
+}
+
+// ============================================================================
+// Query
+// ============================================================================
+
+const OperatingPresets::Preset* OperatingPresets::get(uint8_t index) const {
+    if (index < 1 || index > MAX_PRESETS || !presets[index - 1].valid) {
+        return nullptr;
+    }
+    return &presets[index - 1];
+}
+
+uint8_t OperatingPresets::getPrescalerConflicts(uint8_t index) const {
+    const Preset* preset = get(index);
+    if (!preset) {
+        return 0;
+    }
+    uint8_t mask = 0;
+    for (uint8_t i = 0; i < MAX_PRESETS; i++) {
+        const Preset& other = presets[i];
+        if (other.valid && i + 1 != index &&
+            (other.pwm.prescaler != preset->pwm.prescaler || other.pwm.clockHz != preset->pwm.clockHz)) {
+            mask |= 1 << i;
+        }
+    }
+    return mask;
+}
+
+uint8_t OperatingPresets::getCount() const {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < MAX_PRESETS; i++) {
+        if (presets[i].valid) {
+            count++;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,123 @@
+#ifndef OPERATING_PRESETS_H
+#define OPERATING_PRESETS_H
+
+#include <Arduino.h>
+#include "UART1Mux.h"
+#include "LEDPWMControl.h"
+#include "RelayControl.h"
+
+/**
+ * @brief Named operating points with precomputed register images
+ *
+ * Each preset holds the UART1 PWM image resolved once at save time
+ * (prescaler, period, compare) plus the LED brightness/enable and relay
+ * state. Recalling it does no validation or synthesis: the PWM image is
+ * one shadow-register write that latches at the next TEZ, followed by the
+ * LED duty and relay level, so a switch takes the same few microseconds
+ * whatever the operating point.
+ *
+ * The MCPWM prescaler is not shadowed. Presets are resolved against the
+ * prescaler the other presets already use whenever its frequency error is
+ * within tolerance; presets that still end up on another prescaler are
+ * reported at save time (getPrescalerConflicts()) because switching
+ * between them changes the timer clock immediately instead of at TEZ.
+ *
+ * Presets are numbered from 1 in the API, matching PRESET <n>, and kept
+ * in NVS (one blob per preset), loaded at begin().
+ *
+ * Usage:
+ *   OperatingPresets presets(uart1, ledPWM, relay);
+ *   presets.begin();
+ *   presets.saveCurrent(1, "idle", error);
+ *   presets.recall(1, error);
+ */
+class OperatingPresets {
+public:
+    static const uint8_t MAX_PRESETS = 8;
+    static const uint8_t NAME_LENGTH = 16;      // Including terminator
+
+    struct Preset {
+        bool valid;
+        char name[NAME_LENGTH];
+        UART1Mux::PWMImage pwm;
+        float ledBrightness;                    ///< LED PWM brightness (%)
+        bool ledEnabled;
+        bool relay;
+    };
+
+    struct Statistics {
+        uint32_t recalls;
+        uint32_t prescalerChanges;              ///< Recalls that changed the prescaler
+        uint32_t reResolved;                    ///< Recalls that had to re-resolve (PWM clock changed)
+        uint32_t lastRecallUs;                  ///< Duration of the last recall
+        uint32_t maxRecallUs;
+    };
+
+    OperatingPresets(UART1Mux& uart1, LEDPWMControl& ledPWM, RelayControl& relay);
+
+    /**
+     * @brief Load presets from NVS
+     */
+    bool begin();
+
+    /**
+     * @brief Store the current PWM frequency/duty, LED and relay state
+     * @param index 1-MAX_PRESETS
+     * @param name Optional label (truncated), nullptr or "" keeps "P<n>"
+     * @param error Receives reason on failure
+     */
+    bool saveCurrent(uint8_t index, const char* name, String& error);
+
+    /**
+     * @brief Store an explicit operating point (nothing is applied)
+     */
+    bool define(uint8_t index, const char* name, uint32_t frequency, float duty,
+                float ledBrightness, bool ledEnabled, bool relayState, String& error);
+
+    /**
+     * @brief Apply a preset
+     * @param prescalerChanged Optional: receives whether the prescaler changed
+     * @return false if empty, UART1 not in PWM mode or the frequency now
+     *         exceeds the maximum
+     */
+    bool recall(uint8_t index, String& error, bool* prescalerChanged = nullptr);
+
+    /**
+     * @brief Recall the next stored preset after the active one (key control)
+     * @return Index recalled, 0 if none could be applied
+     */
+    uint8_t recallNext(String& error);
+
+    bool remove(uint8_t index);
+
+    /**
+     * @brief Get a preset (nullptr if index out of range or empty)
+     */
+    const Preset* get(uint8_t index) const;
+
+    /**
+     * @brief Presets a switch to/from this one would change the prescaler for
+     * @return Bit (n - 1) set for each stored preset n
+     */
+    uint8_t getPrescalerConflicts(uint8_t index) const;
+
+    uint8_t getCount() const;
+    uint8_t getActive() const { return active; }
+    const Statistics& getStatistics() const { return stats; }
+
+private:
+    static const uint8_t RECORD_VERSION = 1;
+
+    UART1Mux& uart1;
+    LEDPWMControl& ledPWM;
+    RelayControl& relay;
+
+    Preset presets[MAX_PRESETS] = {};
+    uint8_t active = 0;                         // Last recalled, 0 = none
+    Statistics stats = {};
+
+    uint32_t preferredPrescaler(uint8_t exclude) const;
+    bool persist(uint8_t index);
+};
+
+#endif // OPERATING_PRESETS_H
@@ -0,0 +1,119 @@
+#include "PWMRamp.h"
+#include <math.h>
+#include <string.h>
+#include <strings.h>
+
+float PWMRamp::shape(Profile profile, float x) {
+    if (x <= 0.0f) return 0.0f;
+    if (x >= 1.0f) return 1.0f;
+
+    switch (profile) {
+        case PROFILE_SCURVE:
+            return x * x * (3.0f - 2.0f * x);
+
+        case PROFILE_EXP: {
+            // Normalised 1 - e^(-kx) so the curve still ends exactly at 1
+            const float k = 5.0f;
+            return (1.0f - expf(-k * x)) / (1.0f - expf(-k));
+        }
+
+        case PROFILE_LINEAR:
+        default:
+            return x;
+    }
+}
+
+bool PWMRamp::parseProfile(const char* name, Profile& profile) {
+    if (strcasecmp(name, "LINEAR") == 0 || strcasecmp(name, "LIN") == 0) {
+        profile = PROFILE_LINEAR;
+    } else if (strcasecmp(name, "SCURVE") == 0 || strcasecmp(name, "S") == 0) {
+        profile = PROFILE_SCURVE;
+    } else if (strcasecmp(name, "EXP") == 0) {
+        profile = PROFILE_EXP;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* PWMRamp::getProfileName(Profile profile) {
+    switch (profile) {
+        case PROFILE_LINEAR: return "LINEAR";
+        case PROFILE_SCURVE: return "SCURVE";
+        case PROFILE_EXP:    return "EXP";
+        default:             return "UNKNOWN";
+    }
+}
+
+uint32_t PWMRamp::frequencyToPeriod(float frequency, uint32_t periodClockHz) {
+    if (frequency <= 0.0f) {
+        return 0;
+    }
+    // One cycle is (period field + 1) ticks in up-count mode
+    uint32_t ticks = (uint32_t)((float)periodClockHz / frequency + 0.5f);
+    if (ticks < 2 || ticks > 65536) {
+        return 0;
+    }
+    return ticks - 1;
+}
+
+uint32_t PWMRamp::dutyToCompare(uint32_t period, float duty) {
+    return (uint32_t)(((float)(period + 1) * duty) / 100.0f);
+}
+
+size_t PWMRamp::build(PWMRampStep* out, size_t maxSteps,
+                      const Endpoint& from, const Endpoint& to,
+                      uint32_t durationMs, uint32_t periodClockHz,
+                      uint32_t pacingHz, Profile profile) {
+    if (maxSteps == 0 || periodClockHz == 0) {
+        return 0;
+    }
+    if (maxSteps > MAX_STEPS) {
+        maxSteps = MAX_STEPS;
+    }
+
+    // One entry per pacing event is the finest useful resolution. With TEZ
+    // pacing an entry lasts at least one PWM period, so size the table for
+    // the slower end of the ramp.
+    float minFreq = from.frequency < to.frequency ? from.frequency : to.frequency;
+    float eventRate = pacingHz ? (float)pacingHz : minFreq;
+    float events = eventRate * (float)durationMs / 1000.0f;
+    size_t steps = events < 1.0f ? 1 : (size_t)events;
+    if (steps > maxSteps) {
+        steps = maxSteps;
+    }
+
+    float stepSeconds = (float)durationMs / 1000.0f / (float)steps;
+    float carry = 0.0f;     // Fractional events carried so rounding does not accumulate
+
+    for (size_t k = 0; k < steps; k++) {
+        float p = shape(profile, (float)(k + 1) / (float)steps);
+        float freq = from.frequency + (to.frequency - from.frequency) * p;
+        float duty = from.duty + (to.duty - from.duty) * p;
+        if (k == steps - 1) {
+            freq = to.frequency;
+            duty = to.duty;
+        }
+
+        uint32_t period = frequencyToPeriod(freq, periodClockHz);
+        if (period == 0) {
+            return 0;
+        }
+
+        // Hold time expressed in pacing events at this step's own rate
+        float rate = pacingHz ? (float)pacingHz : freq;
+        carry += stepSeconds * rate;
+        uint32_t repeat = (uint32_t)carry;
+        if (repeat < 1) {
+            repeat = 1;
+        }
+        carry -= (float)repeat;
+
+        out[k].period = (uint16_t)period;
+        uint32_t compare = dutyToCompare(period, duty);
+        out[k].compare = (uint16_t)(compare > 0xFFFF ? 0xFFFF : compare);
+        out[k].repeat = repeat;
+    }
+
+    return steps;
+}
@@ -0,0 +1,92 @@
+#ifndef PWM_RAMP_H
+#define PWM_RAMP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief One entry of a precomputed PWM ramp
+ *
+ * period/compare are raw MCPWM register values for the current prescaler.
+ * The entry stays active for `repeat` pacing events (PWM periods when paced
+ * by TEZ, timer ticks when paced by the ramp timer).
+ */
+struct PWMRampStep {
+    uint16_t period;
+    uint16_t compare;
+    uint32_t repeat;
+};
+
+/**
+ * @brief Ramp table builder
+ *
+ * Pure computation, no hardware access: the table is built in task context
+ * and consumed by the ramp interrupt, which only copies entries into the
+ * MCPWM shadow registers.
+ */
+namespace PWMRamp {
+
+    /**
+     * @brief Ramp shape
+     */
+    enum Profile : uint8_t {
+        PROFILE_LINEAR = 0,     ///< Constant rate
+        PROFILE_SCURVE,         ///< Smoothstep: zero slope at both ends
+        PROFILE_EXP             ///< Exponential approach: fast start, slow settle
+    };
+
+    static const size_t MAX_STEPS = 1024;
+
+    /**
+     * @brief Ramp endpoint
+     */
+    struct Endpoint {
+        float frequency;    ///< Hz
+        float duty;         ///< 0-100 %
+    };
+
+    /**
+     * @brief Evaluate the profile
+     * @param x Normalised time 0.0 - 1.0
+     * @return Normalised progress 0.0 - 1.0
+     */
+    float shape(Profile profile, float x);
+
+    /**
+     * @brief Parse profile name (LINEAR, SCURVE/S, EXP)
+     * @return true if recognised
+     */
+    bool parseProfile(const char* name, Profile& profile);
+
+    const char* getProfileName(Profile profile);
+
+    /**
+     * @brief Convert frequency to period register value
+     * @param periodClockHz Counter clock after prescaler
+     * @return Period field (cycle = field + 1 ticks), or 0 if the cycle is not 2 - 65536 ticks
+     */
+    uint32_t frequencyToPeriod(float frequency, uint32_t periodClockHz);
+
+    /**
+     * @brief Convert duty to compare register value (same scaling as mcpwm_set_duty)
+     */
+    uint32_t dutyToCompare(uint32_t period, float duty);
+
+    /**
+     * @brief Build a ramp table
+     * @param out Destination, at least maxSteps entries
+     * @param maxSteps Table capacity (<= MAX_STEPS)
+     * @param from Starting point (entry 0 is the first step after it)
+     * @param to Target; the last entry is exactly this point
+     * @param durationMs Ramp time
+     * @param periodClockHz Counter clock after prescaler (for period values)
+     * @param pacingHz Timer pacing rate, or 0 to pace on every PWM period (TEZ)
+     * @return Number of entries written, 0 if a period does not fit 16 bits
+     */
+    size_t build(PWMRampStep* out, size_t maxSteps,
+                 const Endpoint& from, const Endpoint& to,
+                 uint32_t durationMs, uint32_t periodClockHz,
+                 uint32_t pacingHz, Profile profile);
+}
+
+#endif // PWM_RAMP_H
@@ -0,0 +1,210 @@
+#include "PWMSequence.h"
+#include "PWMSynth.h"
+#include "PWMRamp.h"
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+const char* skipSeparators(const char* p) {
+    while (*p == ' ' || *p == '\t' || *p == ',') {
+        p++;
+    }
+    return p;
+}
+
+}  // namespace
+
+bool PWMSequence::isValid(const PWMSequenceEntry& entry) {
+    return entry.frequency >= 1 && entry.frequency <= MAX_FREQUENCY &&
+           entry.duty >= 0.0f && entry.duty <= 100.0f &&
+           entry.dwellMs >= MIN_DWELL_MS && entry.dwellMs <= MAX_DWELL_MS;
+}
+
+bool PWMSequence::parseEntry(const char* text, PWMSequenceEntry& out) {
+    const char* p = skipSeparators(text);
+    char* end;
+
+    unsigned long freq = strtoul(p, &end, 10);
+    if (end == p) {
+        return false;
+    }
+    p = skipSeparators(end);
+
+    float duty = strtof(p, &end);
+    if (end == p) {
+        return false;
+    }
+    p = skipSeparators(end);
+
+    unsigned long dwell = strtoul(p, &end, 10);
+    if (end == p) {
+        return false;
+    }
+    p = end;
+    while (*p == ' ' || *p == '\t' || *p == '\r') {
+        p++;
+    }
+    if (*p != '\0') {
+        return false;  // Trailing garbage
+    }
+
+    PWMSequenceEntry entry = { (uint32_t)freq, duty, (uint32_t)dwell };
+    if (!isValid(entry)) {
+        return false;
+    }
+    out = entry;
+    return true;
+}
+
+size_t PWMSequence::parseText(const char* text, size_t length, PWMSequenceEntry* out,
+                              size_t maxEntries, uint32_t& loopStart, size_t& errorLine) {
+    size_t count = 0;
+    size_t lineNumber = 0;
+    bool seenContent = false;
+    char line[64];
+
+    loopStart = 0;
+    errorLine = 0;
+
+    size_t pos = 0;
+    while (pos < length) {
+        size_t end = pos;
+        while (end < length && text[end] != '\n') {
+            end++;
+        }
+        lineNumber++;
+
+        size_t lineLength = end - pos;
+        if (lineLength >= sizeof(line)) {
+            errorLine = lineNumber;
+            return 0;
+        }
+        memcpy(line, text + pos, lineLength);
+        line[lineLength] = '\0';
+        pos = end + 1;
+
+        const char* p = line;
+        while (*p == ' ' || *p == '\t' || *p == '\r') {
+            p++;
+        }
+        if (*p == '\0') {
+            continue;
+        }
+
+        if (*p == '#') {
+            const char* key = p + 1;
+            while (*key == ' ') {
+                key++;
+            }
+            if (strncmp(key, "loop=", 5) == 0) {
+                loopStart = (uint32_t)strtoul(key + 5, nullptr, 10);
+            }
+            continue;
+        }
+
+        // Column header, e.g. "freq_hz,duty_pct,dwell_ms"
+        if (!seenContent && isalpha((unsigned char)*p)) {
+            seenContent = true;
+            continue;
+        }
+        seenContent = true;
+
+        if (count >= maxEntries || !parseEntry(p, out[count])) {
+            errorLine = lineNumber;
+            return 0;
+        }
+        count++;
+    }
+
+    if (count > 0 && loopStart >= count) {
+        errorLine = 0;
+        loopStart = 0;
+        return 0;
+    }
+    return count;
+}
+
+int PWMSequence::formatEntry(char* buffer, size_t size, const PWMSequenceEntry& entry) {
+    return snprintf(buffer, size, "%u,%.2f,%u", (unsigned)entry.frequency, entry.duty,
+                    (unsigned)entry.dwellMs);
+}
+
+bool PWMSequence::selectPrescaler(uint32_t groupClockHz, const PWMSequenceEntry* entries,
+                                  size_t count, uint32_t& prescaler) {
+    if (count == 0 || groupClockHz == 0) {
+        return false;
+    }
+
+    uint32_t minFreq = entries[0].frequency;
+    uint32_t maxFreq = entries[0].frequency;
+    for (size_t i = 1; i < count; i++) {
+        if (entries[i].frequency < minFreq) minFreq = entries[i].frequency;
+        if (entries[i].frequency > maxFreq) maxFreq = entries[i].frequency;
+    }
+
+    // Lowest frequency bounds the prescaler from below (16-bit period);
+    // the smallest such prescaler gives every other entry the most ticks
+    for (uint32_t p = 0; p < PWMSynth::MAX_DIVIDER; p++) {
+        uint32_t lowPeriod, highPeriod;
+        if (PWMSynth::periodForPrescaler(groupClockHz, minFreq, p, lowPeriod) &&
+            PWMSynth::periodForPrescaler(groupClockHz, maxFreq, p, highPeriod)) {
+            prescaler = p;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PWMSequence::compile(uint32_t groupClockHz, uint32_t prescaler, const PWMSequenceEntry* entries,
+                          size_t count, PWMSequenceStep* out, double& worstPpm) {
+    worstPpm = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t period;
+        if (!PWMSynth::periodForPrescaler(groupClockHz, entries[i].frequency, prescaler, period)) {
+            return false;
+        }
+        double achieved = PWMSynth::achievedFrequency(groupClockHz, prescaler, period);
+        double ppm = fabs(achieved - entries[i].frequency) / entries[i].frequency * 1e6;
+        if (ppm > worstPpm) {
+            worstPpm = ppm;
+        }
+
+        out[i].period = (uint16_t)period;
+        out[i].compare = PWMRamp::dutyToCompare(period, entries[i].duty);
+        out[i].dwellUs = entries[i].dwellMs * 1000;
+    }
+    return true;
+}
+
+void PWMSequence::position(uint32_t ordinal, uint32_t length, uint32_t loopStart,
+                           uint32_t& index, uint32_t& pass) {
+    if (ordinal < length) {
+        index = ordinal;
+        pass = 0;
+        return;
+    }
+    uint32_t loopLength = length - loopStart;
+    uint32_t offset = ordinal - length;
+    index = loopStart + offset % loopLength;
+    pass = 1 + offset / loopLength;
+}
+
+uint64_t PWMSequence::durationMs(const PWMSequenceEntry* entries, size_t count, uint32_t loopStart,
+                                 uint32_t repeat) {
+    uint64_t first = 0;
+    uint64_t loop = 0;
+    for (size_t i = 0; i < count; i++) {
+        first += entries[i].dwellMs;
+        if (i >= loopStart) {
+            loop += entries[i].dwellMs;
+        }
+    }
+    if (repeat <= 1) {
+        return first;
+    }
+    return first + loop * (uint64_t)(repeat - 1);
+}
@@ -0,0 +1,127 @@
+#ifndef PWM_SEQUENCE_H
+#define PWM_SEQUENCE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief One point of a frequency/duty profile as uploaded
+ */
+struct PWMSequenceEntry {
+    uint32_t frequency;     ///< Hz
+    float duty;             ///< 0-100 %
+    uint32_t dwellMs;       ///< Time this point is held
+};
+
+/**
+ * @brief One entry compiled for playback
+ *
+ * period/compare are raw MCPWM register values for the prescaler chosen
+ * by PWMSequence::selectPrescaler(); dwellUs is the sequencer timer alarm.
+ */
+struct PWMSequenceStep {
+    uint32_t dwellUs;
+    uint32_t compare;
+    uint16_t period;
+};
+
+/**
+ * @brief RPM captured at the end of one played step
+ */
+struct PWMSequenceResult {
+    uint32_t endMs;         ///< Scheduled end of the step since playback start
+    uint32_t pass;          ///< 0 = first pass through the table
+    uint32_t frequency;     ///< Setpoint (Hz)
+    float duty;             ///< Setpoint (%)
+    float rpmFrequency;     ///< Measured RPM signal (Hz)
+    float rpm;              ///< Motor RPM (pole pairs applied)
+    uint16_t index;         ///< Table entry
+    uint16_t flags;         ///< PWMSequence::RESULT_* bits
+};
+
+/**
+ * @brief Profile table parsing and compilation
+ *
+ * Pure computation, no hardware access. Profiles are plain text, one
+ * point per line as "freq_hz,duty_pct,dwell_ms" (spaces or tabs also
+ * separate fields). Blank lines, a header line and lines starting with
+ * '#' are skipped; "#loop=<index>" sets the entry later passes restart
+ * from, so a warm-up section can precede the repeated part.
+ *
+ * The whole table is played with one prescaler so that every transition
+ * goes through the shadow registers: the smallest prescaler whose 16-bit
+ * period still reaches the lowest frequency in the table.
+ */
+namespace PWMSequence {
+
+    static const size_t MAX_ENTRIES = 4096;
+    static const size_t MAX_RESULTS = 16384;
+    static const uint32_t MIN_DWELL_MS = 1;
+    static const uint32_t MAX_DWELL_MS = 3600000;     // 1 hour per point
+    static const uint32_t MAX_FREQUENCY = 500000;
+
+    static const uint16_t RESULT_LATE = 0x01;         ///< Sampled after later steps had already started
+    static const uint16_t RESULT_NO_SIGNAL = 0x02;    ///< No RPM signal at the end of the step
+
+    /**
+     * @brief Check frequency, duty and dwell ranges
+     */
+    bool isValid(const PWMSequenceEntry& entry);
+
+    /**
+     * @brief Parse "freq,duty,dwell" (comma, space or tab separated)
+     * @return true if all three fields were read and are in range
+     */
+    bool parseEntry(const char* text, PWMSequenceEntry& out);
+
+    /**
+     * @brief Parse a whole profile
+     * @param text Profile text (need not be NUL-terminated)
+     * @param out Destination, at least maxEntries entries
+     * @param loopStart Receives the "#loop=" index (0 if absent)
+     * @param errorLine Receives the 1-based line number of the first bad line
+     * @return Number of entries parsed, 0 on error (errorLine set) or empty profile
+     */
+    size_t parseText(const char* text, size_t length, PWMSequenceEntry* out, size_t maxEntries,
+                     uint32_t& loopStart, size_t& errorLine);
+
+    /**
+     * @brief Format one entry as a profile line (no newline)
+     * @return Characters written (snprintf semantics)
+     */
+    int formatEntry(char* buffer, size_t size, const PWMSequenceEntry& entry);
+
+    /**
+     * @brief Pick one prescaler for the whole table
+     * @param groupClockHz Clock feeding the timer prescaler
+     * @return false if some frequency cannot be reached by any prescaler
+     */
+    bool selectPrescaler(uint32_t groupClockHz, const PWMSequenceEntry* entries, size_t count,
+                         uint32_t& prescaler);
+
+    /**
+     * @brief Compile entries to register values for a fixed prescaler
+     * @param worstPpm Receives the largest |frequency error| in the table
+     * @return false if an entry does not fit the prescaler
+     */
+    bool compile(uint32_t groupClockHz, uint32_t prescaler, const PWMSequenceEntry* entries,
+                 size_t count, PWMSequenceStep* out, double& worstPpm);
+
+    /**
+     * @brief Map a played-step ordinal to its table entry and pass
+     *
+     * Pass 0 plays entries 0 .. length-1; every later pass plays
+     * loopStart .. length-1.
+     */
+    void position(uint32_t ordinal, uint32_t length, uint32_t loopStart,
+                  uint32_t& index, uint32_t& pass);
+
+    /**
+     * @brief Total playback time
+     * @param repeat Number of passes (0 = endless, returns one pass)
+     */
+    uint64_t durationMs(const PWMSequenceEntry* entries, size_t count, uint32_t loopStart,
+                        uint32_t repeat);
+}
+
+#endif // PWM_SEQUENCE_H
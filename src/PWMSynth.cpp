@@ -0,0 +1,143 @@
+#include "PWMSynth.h"
+#include <math.h>
+
+PWMSynth::Constraints PWMSynth::defaultConstraints() {
+    Constraints c;
+    c.minDutySteps = 100;
+    c.keepTolerancePpm = 100.0;
+    return c;
+}
+
+double PWMSynth::achievedFrequency(uint32_t groupClockHz, uint32_t prescaler, uint32_t period) {
+    return (double)groupClockHz / ((double)(prescaler + 1) * (double)(period + 1));
+}
+
+bool PWMSynth::periodForPrescaler(uint32_t groupClockHz, double frequency, uint32_t prescaler,
+                                  uint32_t& period) {
+    if (frequency <= 0.0 || prescaler >= MAX_DIVIDER) {
+        return false;
+    }
+
+    double exactTicks = (double)groupClockHz / ((double)(prescaler + 1) * frequency);
+    double lower = floor(exactTicks);
+    double upper = lower + 1.0;
+
+    // Candidates clamped to the 16-bit range; compare them by frequency error,
+    // not tick distance, since f ∝ 1/ticks
+    bool found = false;
+    double bestError = 0.0;
+    double candidates[2] = { lower, upper };
+    for (int i = 0; i < 2; i++) {
+        double ticks = candidates[i];
+        if (ticks < MIN_TICKS || ticks > MAX_TICKS) {
+            continue;
+        }
+        double f = (double)groupClockHz / ((double)(prescaler + 1) * ticks);
+        double error = fabs(f - frequency);
+        if (!found || error < bestError) {
+            found = true;
+            bestError = error;
+            period = (uint32_t)ticks - 1;
+        }
+    }
+    return found;
+}
+
+void PWMSynth::describe(uint32_t groupClockHz, double frequency, uint32_t prescaler,
+                        uint32_t period, PWMSynthResult& out) {
+    out.prescaler = (uint16_t)prescaler;
+    out.period = (uint16_t)period;
+    out.frequency = PWMSynth::achievedFrequency(groupClockHz, prescaler, period);
+    out.errorPpm = frequency > 0.0 ? (out.frequency - frequency) / frequency * 1e6 : 0.0;
+    out.dutySteps = period + 1;
+    out.dutyResolution = 100.0f / (float)(period + 1);
+    out.keptPrescaler = false;
+}
+
+// The nearest period may fall one tick short of the resolution while the
+// other period bracketing the frequency (one tick longer) meets it
+static uint32_t meetResolution(uint32_t groupClockHz, double frequency, uint32_t prescaler,
+                               uint32_t period, uint32_t minDutySteps) {
+    if (period + 2 == minDutySteps && period + 2 <= PWMSynth::MAX_TICKS &&
+        PWMSynth::achievedFrequency(groupClockHz, prescaler, period) > frequency) {
+        return period + 1;
+    }
+    return period;
+}
+
+bool PWMSynth::synthesize(uint32_t groupClockHz, double frequency, int32_t currentPrescaler,
+                          const Constraints& constraints, PWMSynthResult& out) {
+    if (groupClockHz == 0 || !(frequency > 0.0)) {
+        return false;
+    }
+
+    // Best pair meeting the resolution constraint, and best pair overall
+    // (finest resolution first) as the fallback when none does
+    bool haveBest = false;
+    double bestError = 0.0;
+    uint32_t bestPrescaler = 0, bestPeriod = 0;
+    bool haveFallback = false;
+    double fallbackError = 0.0;
+    uint32_t fallbackPrescaler = 0, fallbackPeriod = 0;
+
+    for (uint32_t prescaler = 0; prescaler < MAX_DIVIDER; prescaler++) {
+        uint32_t period;
+        if (!periodForPrescaler(groupClockHz, frequency, prescaler, period)) {
+            continue;
+        }
+        double error = fabs(achievedFrequency(groupClockHz, prescaler, period) - frequency);
+
+        uint32_t constrainedPeriod = meetResolution(groupClockHz, frequency, prescaler, period,
+                                                     constraints.minDutySteps);
+        double constrainedError = constrainedPeriod == period ? error :
+            fabs(achievedFrequency(groupClockHz, prescaler, constrainedPeriod) - frequency);
+
+        if (constrainedPeriod + 1 >= constraints.minDutySteps) {
+            // Ascending prescaler: on a tie the earlier (finer) pair is kept
+            if (!haveBest || constrainedError < bestError) {
+                haveBest = true;
+                bestError = constrainedError;
+                bestPrescaler = prescaler;
+                bestPeriod = constrainedPeriod;
+            }
+        }
+        if (period + 1 < constraints.minDutySteps &&
+            (!haveFallback || period > fallbackPeriod ||
+             (period == fallbackPeriod && error < fallbackError))) {
+            haveFallback = true;
+            fallbackError = error;
+            fallbackPrescaler = prescaler;
+            fallbackPeriod = period;
+        }
+    }
+
+    if (!haveBest && !haveFallback) {
+        return false;
+    }
+
+    uint32_t prescaler = haveBest ? bestPrescaler : fallbackPrescaler;
+    uint32_t period = haveBest ? bestPeriod : fallbackPeriod;
+    double chosenError = haveBest ? bestError : fallbackError;
+
+    // Prefer the glitch-free path when it is good enough
+    if (currentPrescaler >= 0 && (uint32_t)currentPrescaler < MAX_DIVIDER &&
+        (uint32_t)currentPrescaler != prescaler) {
+        uint32_t keepPeriod;
+        if (periodForPrescaler(groupClockHz, frequency, (uint32_t)currentPrescaler, keepPeriod)) {
+            keepPeriod = meetResolution(groupClockHz, frequency, currentPrescaler, keepPeriod,
+                                        constraints.minDutySteps);
+            double keepError = fabs(achievedFrequency(groupClockHz, currentPrescaler, keepPeriod) - frequency);
+            double keepPpm = keepError / frequency * 1e6;
+            bool resolutionOk = keepPeriod + 1 >= constraints.minDutySteps || keepPeriod >= period;
+            if (resolutionOk && (keepPpm <= constraints.keepTolerancePpm || keepError <= chosenError)) {
+                describe(groupClockHz, frequency, currentPrescaler, keepPeriod, out);
+                out.keptPrescaler = true;
+                return true;
+            }
+        }
+    }
+
+    describe(groupClockHz, frequency, prescaler, period, out);
+    out.keptPrescaler = currentPrescaler >= 0 && (uint32_t)currentPrescaler == prescaler;
+    return true;
+}
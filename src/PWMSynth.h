@@ -0,0 +1,87 @@
+#ifndef PWM_SYNTH_H
+#define PWM_SYNTH_H
+
+#include <stdint.h>
+
+/**
+ * @brief Result of a prescaler/period search
+ *
+ * prescaler/period are raw MCPWM register fields: the timer clock is the
+ * group clock divided by (prescaler + 1), and in up-count mode one PWM
+ * cycle is (period + 1) timer ticks.
+ */
+struct PWMSynthResult {
+    uint16_t prescaler;         ///< timer_prescale field (0 - 255)
+    uint16_t period;            ///< timer_period field (1 - 65535)
+    double frequency;           ///< Achieved frequency (Hz)
+    double errorPpm;            ///< (achieved − requested) / requested × 1e6
+    uint32_t dutySteps;         ///< Distinct duty levels = period + 1
+    float dutyResolution;       ///< Smallest duty step (%)
+    bool keptPrescaler;         ///< true if the current prescaler was reused (glitch-free path)
+};
+
+/**
+ * @brief Exact PWM frequency synthesis for a 16-bit MCPWM timer
+ *
+ * Pure computation, no hardware access. For each of the 256 prescalers
+ * the two periods bracketing the exact tick count are evaluated and the
+ * pair with the smallest frequency error wins, subject to a minimum
+ * number of duty steps (either bracketing period may satisfy it). When no pair meets the resolution constraint
+ * (high frequencies), the finest achievable resolution is used instead.
+ *
+ * Reusing the current prescaler keeps the update on the shadow-register
+ * path (period and compare latch together at TEZ); it is preferred as
+ * long as its error is within the keep tolerance.
+ */
+namespace PWMSynth {
+
+    static const uint32_t MAX_DIVIDER = 256;        ///< prescaler field + 1
+    static const uint32_t MAX_TICKS = 65536;        ///< period field + 1
+    static const uint32_t MIN_TICKS = 2;
+
+    /**
+     * @brief Search constraints
+     */
+    struct Constraints {
+        uint32_t minDutySteps;      ///< Required duty levels (period + 1), e.g. 100 for 1 %
+        double keepTolerancePpm;    ///< Max error accepted to keep the current prescaler
+    };
+
+    /**
+     * @brief Default constraints: 1 % duty resolution, keep prescaler within 100 ppm
+     */
+    Constraints defaultConstraints();
+
+    /**
+     * @brief Frequency produced by a register pair
+     */
+    double achievedFrequency(uint32_t groupClockHz, uint32_t prescaler, uint32_t period);
+
+    /**
+     * @brief Describe a register pair already in use
+     * @param frequency Requested frequency the pair was chosen for
+     */
+    void describe(uint32_t groupClockHz, double frequency, uint32_t prescaler, uint32_t period,
+                  PWMSynthResult& out);
+
+    /**
+     * @brief Best period for a fixed prescaler
+     * @return false if no period in range can produce the frequency
+     */
+    bool periodForPrescaler(uint32_t groupClockHz, double frequency, uint32_t prescaler,
+                            uint32_t& period);
+
+    /**
+     * @brief Search for the best (prescaler, period) pair
+     * @param groupClockHz Clock feeding the timer prescaler
+     * @param frequency Requested frequency (Hz)
+     * @param currentPrescaler Prescaler field in use, or < 0 if none
+     * @param constraints Resolution / keep-prescaler policy
+     * @param out Receives the chosen pair and its error
+     * @return false if the frequency is outside the synthesizable range
+     */
+    bool synthesize(uint32_t groupClockHz, double frequency, int32_t currentPrescaler,
+                    const Constraints& constraints, PWMSynthResult& out);
+}
+
+#endif // PWM_SYNTH_H
@@ -0,0 +1,596 @@
+#include "PacketLink.h"
+#include "UART2Manager.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_crc.h"
+
+static const uint8_t TYPE_DATA = 0x00;
+static const uint8_t TYPE_DATA_ACK = 0x01;     // ACK requested
+static const uint8_t TYPE_ACK = 0x02;
+
+static const uint8_t SLIP_END = 0xC0;
+static const uint8_t SLIP_ESC = 0xDB;
+static const uint8_t SLIP_ESC_END = 0xDC;
+static const uint8_t SLIP_ESC_ESC = 0xDD;
+
+static const uint32_t LINK_POLL_MS = 5;        // Granularity of ACK timeouts
+static const uint32_t LINK_STOP_TIMEOUT_MS = 500;
+
+// A received frame includes its delimiter; the leading one is a separate (empty) frame
+static_assert(PacketLink::MAX_FRAME - 1 <= UART2Manager::MAX_FRAME_LENGTH,
+              "Largest encoded packet must fit into one UART2 frame");
+
+// ============================================================================
+// CRC (ROM routines; see esp_rom_crc.h for the parameter mapping)
+// ============================================================================
+
+static uint32_t crcInit(PacketLink::CrcType type) {
+    return type == PacketLink::CRC_32 ? 0 : 0xFFFF;
+}
+
+static uint32_t crcUpdate(PacketLink::CrcType type, uint32_t crc, const uint8_t* data, size_t length) {
+    if (type == PacketLink::CRC_32) {
+        return esp_rom_crc32_le(crc, data, length);
+    }
+    // CRC-16/CCITT-FALSE: the ROM routine inverts on entry and exit
+    return (uint16_t)~esp_rom_crc16_be((uint16_t)~crc, data, length);
+}
+
+// ============================================================================
+// Frame Encoder
+// ============================================================================
+
+namespace {
+
+/**
+ * @brief Writes packet bytes as one COBS or SLIP frame, one segment at a time
+ */
+class FrameEncoder {
+public:
+    FrameEncoder(PacketLink::Framing framing, uint8_t* out) : framing(framing), out(out) {
+        // Leading delimiter ends whatever noise preceded the frame
+        out[pos++] = framing == PacketLink::FRAMING_COBS ? 0x00 : SLIP_END;
+        if (framing == PacketLink::FRAMING_COBS) {
+            codeIndex = pos++;
+        }
+    }
+
+    void put(const uint8_t* data, size_t length) {
+        if (framing == PacketLink::FRAMING_COBS) {
+            for (size_t i = 0; i < length; i++) {
+                putCOBS(data[i]);
+            }
+        } else {
+            for (size_t i = 0; i < length; i++) {
+                putSLIP(data[i]);
+            }
+        }
+    }
+
+    size_t finish() {
+        if (framing == PacketLink::FRAMING_COBS) {
+            out[codeIndex] = blockFull ? 0xFF : code;
+            out[pos++] = 0x00;
+        } else {
+            out[pos++] = SLIP_END;
+        }
+        return pos;
+    }
+
+private:
+    PacketLink::Framing framing;
+    uint8_t* out;
+    size_t pos = 0;
+    size_t codeIndex = 0;
+    uint8_t code = 1;
+    bool blockFull = false;     // 254 data bytes: the next byte opens a new block
+
+    void putCOBS(uint8_t b) {
+        if (blockFull) {
+            out[codeIndex] = 0xFF;
+            codeIndex = pos++;
+            code = 1;
+            blockFull = false;
+        }
+        if (b == 0) {
+            out[codeIndex] = code;
+            codeIndex = pos++;
+            code = 1;
+            return;
+        }
+        out[pos++] = b;
+        if (++code == 0xFF) {
+            blockFull = true;
+        }
+    }
+
+    void putSLIP(uint8_t b) {
+        if (b == SLIP_END) {
+            out[pos++] = SLIP_ESC;
+            out[pos++] = SLIP_ESC_END;
+        } else if (b == SLIP_ESC) {
+            out[pos++] = SLIP_ESC;
+            out[pos++] = SLIP_ESC_ESC;
+        } else {
+            out[pos++] = b;
+        }
+    }
+};
+
+}  // namespace
+
+// ============================================================================
+// Setup
+// ============================================================================
+
+PacketLink::PacketLink(UART2Manager& uart2) : uart2(uart2) {
+    memset(slots, 0, sizeof(slots));
+}
+
+const char* PacketLink::getFramingName(Framing framing) {
+    switch (framing) {
+        case FRAMING_COBS: return "COBS";
+        case FRAMING_SLIP: return "SLIP";
+        default:           return "UNKNOWN";
+    }
+}
+
+const char* PacketLink::getCrcName(CrcType crc) {
+    switch (crc) {
+        case CRC_16: return "CRC16";
+        case CRC_32: return "CRC32";
+        default:     return "UNKNOWN";
+    }
+}
+
+bool PacketLink::allocate() {
+    if (!frames) {
+        // Window frames plus one for packets sent without ACK, then the decode buffer
+        frames = static_cast<uint8_t*>(heap_caps_malloc((MAX_WINDOW + 2) * MAX_FRAME, MALLOC_CAP_8BIT));
+        if (!frames) {
+            Serial.println("[PKT] Buffer allocation failed");
+            return false;
+        }
+        decodeBuffer = frames + (MAX_WINDOW + 1) * MAX_FRAME;
+        for (uint8_t i = 0; i < MAX_WINDOW; i++) {
+            slots[i].frame = frames + i * MAX_FRAME;
+        }
+    }
+    if (!lock) {
+        lock = xSemaphoreCreateMutex();
+    }
+    if (!freeSlots) {
+        freeSlots = xSemaphoreCreateCounting(MAX_WINDOW, 0);
+    }
+    if (!rxQueue) {
+        rxQueue = xRingbufferCreate(RX_QUEUE_SIZE, RINGBUF_TYPE_NOSPLIT);
+    }
+    return lock && freeSlots && rxQueue;
+}
+
+bool PacketLink::begin(Framing newFraming, CrcType newCrc, uint8_t newWindow,
+                       uint16_t newAckTimeoutMs, uint8_t newRetries) {
+    if (newFraming > FRAMING_SLIP || newCrc > CRC_32 || newWindow > MAX_WINDOW ||
+        newAckTimeoutMs < 5 || newRetries > 10) {
+        return false;
+    }
+    if (!uart2.isInitialized()) {
+        return false;
+    }
+
+    end();
+    if (!allocate()) {
+        return false;
+    }
+
+    framing = newFraming;
+    crcType = newCrc;
+    window = newWindow;
+    ackTimeoutMs = newAckTimeoutMs;
+    retries = newRetries;
+    delimiter = framing == FRAMING_COBS ? 0x00 : SLIP_END;
+
+    // Nothing in flight, nothing queued from an earlier session
+    for (uint8_t i = 0; i < MAX_WINDOW; i++) {
+        slots[i].used = false;
+    }
+    while (xSemaphoreTake(freeSlots, 0) == pdTRUE) {
+    }
+    for (uint8_t i = 0; i < window; i++) {
+        xSemaphoreGive(freeSlots);
+    }
+    size_t size;
+    void* item;
+    while ((item = xRingbufferReceive(rxQueue, &size, 0)) != nullptr) {
+        vRingbufferReturnItem(rxQueue, item);
+    }
+    recentCount = 0;
+    recentNext = 0;
+    stats = {};
+    message = "";
+
+    if (!uart2.startFrames(UART2Manager::FRAME_DELIMITER, delimiter)) {
+        return false;
+    }
+
+    stopRequested = false;
+    running = true;
+    BaseType_t ok = xTaskCreatePinnedToCore(
+        linkTask,
+        "UART2_Packet",
+        4096,
+        this,
+        3,                  // Same as the UART2 frame receiver feeding it
+        &taskHandle,
+        1);
+    if (ok != pdPASS) {
+        taskHandle = nullptr;
+        running = false;
+        uart2.stopFrames();
+        return false;
+    }
+
+    Serial.printf("[PKT] Link started: %s, %s, window %u\n",
+                  getFramingName(framing), getCrcName(crcType), window);
+    return true;
+}
+
+void PacketLink::end() {
+    if (taskHandle) {
+        stopRequested = true;
+        unsigned long stopStart = millis();
+        while (taskHandle && millis() - stopStart < LINK_STOP_TIMEOUT_MS) {
+            vTaskDelay(pdMS_TO_TICKS(5));
+        }
+        uart2.stopFrames();
+        message = "";
+    }
+    running = false;
+}
+
+void PacketLink::setPacketCallback(PacketCallback callback, void* arg) {
+    packetCallback = callback;
+    packetCallbackArg = arg;
+}
+
+void PacketLink::resetStatistics() {
+    stats = {};
+}
+
+uint8_t PacketLink::getInFlight() const {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < MAX_WINDOW; i++) {
+        if (slots[i].used) {
+            count++;
+        }
+    }
+    return count;
+}
+
+// ============================================================================
+// Send
+// ============================================================================
+
+size_t PacketLink::encode(uint8_t type, uint8_t seq, const Segment* segments, size_t count, uint8_t* out) const {
+    FrameEncoder encoder(framing, out);
+    uint8_t header[2] = {type, seq};
+    uint32_t crc = crcUpdate(crcType, crcInit(crcType), header, sizeof(header));
+    encoder.put(header, sizeof(header));
+
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t* data = static_cast<const uint8_t*>(segments[i].data);
+        crc = crcUpdate(crcType, crc, data, segments[i].length);
+        encoder.put(data, segments[i].length);
+    }
+
+    uint8_t trailer[4] = {(uint8_t)crc, (uint8_t)(crc >> 8), (uint8_t)(crc >> 16), (uint8_t)(crc >> 24)};
+    encoder.put(trailer, crcLength());
+    return encoder.finish();
+}
+
+bool PacketLink::writeFrame(const uint8_t* frame, size_t length) {
+    // No TX-done wait: the UART TX ring buffer carries the frame
+    return uart2.write(frame, length, 0) == (int)length;
+}
+
+bool PacketLink::send(const Segment* segments, size_t count, uint32_t timeoutMs) {
+    if (!running) {
+        return false;
+    }
+
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (segments[i].length > 0 && segments[i].data == nullptr) {
+            return false;
+        }
+        total += segments[i].length;
+    }
+    if (total > MAX_PAYLOAD) {
+        return false;
+    }
+
+    if (window > 0 && xSemaphoreTake(freeSlots, pdMS_TO_TICKS(timeoutMs)) != pdTRUE) {
+        return false;   // Window still full
+    }
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    uint8_t seq = nextSeq++;
+    bool ok;
+    if (window > 0) {
+        Slot* slot = nullptr;
+        for (uint8_t i = 0; i < MAX_WINDOW; i++) {
+            if (!slots[i].used) {
+                slot = &slots[i];
+                break;
+            }
+        }
+        // The counting semaphore guarantees a free slot
+        slot->length = encode(TYPE_DATA_ACK, seq, segments, count, slot->frame);
+        slot->seq = seq;
+        slot->attempts = 1;
+        slot->sentAt = millis();
+        slot->used = true;
+        ok = writeFrame(slot->frame, slot->length);
+        if (!ok) {
+            // Not queued: release the slot and its token, the caller sees the failure
+            slot->used = false;
+            nextSeq--;
+            xSemaphoreGive(freeSlots);
+        }
+    } else {
+        uint8_t* frame = frames + MAX_WINDOW * MAX_FRAME;
+        size_t length = encode(TYPE_DATA, seq, segments, count, frame);
+        ok = writeFrame(frame, length);
+    }
+    if (ok) {
+        stats.txPackets++;
+        stats.txBytes += total;
+    }
+    xSemaphoreGive(lock);
+    return ok;
+}
+
+bool PacketLink::send(const uint8_t* data, size_t length, uint32_t timeoutMs) {
+    Segment segment = {data, length};
+    return send(&segment, 1, timeoutMs);
+}
+
+void PacketLink::sendAck(uint8_t seq) {
+    uint8_t frame[16];      // Delimiters, header and CRC, every byte escaped
+    size_t length = encode(TYPE_ACK, seq, nullptr, 0, frame);
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (writeFrame(frame, length)) {
+        stats.acksSent++;
+    }
+    xSemaphoreGive(lock);
+}
+
+void PacketLink::checkTimeouts() {
+    unsigned long now = millis();
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    for (uint8_t i = 0; i < MAX_WINDOW; i++) {
+        Slot& slot = slots[i];
+        if (!slot.used || now - slot.sentAt < ackTimeoutMs) {
+            continue;
+        }
+        if (slot.attempts <= retries) {
+            writeFrame(slot.frame, slot.length);
+            slot.attempts++;
+            slot.sentAt = now;
+            stats.retransmits++;
+        } else {
+            slot.used = false;
+            stats.ackFailures++;
+            xSemaphoreGive(freeSlots);
+        }
+    }
+    xSemaphoreGive(lock);
+}
+
+// ============================================================================
+// Receive (link task)
+// ============================================================================
+
+bool PacketLink::decode(const uint8_t* in, size_t length, size_t& outLength) const {
+    size_t out = 0;
+
+    if (framing == FRAMING_COBS) {
+        size_t i = 0;
+        while (i < length) {
+            uint8_t code = in[i++];
+            if (code == 0) {
+                return false;
+            }
+            for (uint8_t j = 1; j < code; j++) {
+                if (i >= length || in[i] == 0) {
+                    return false;
+                }
+                decodeBuffer[out++] = in[i++];
+            }
+            // A block shorter than 254 bytes stands for a zero, except at the end
+            if (code < 0xFF && i < length) {
+                decodeBuffer[out++] = 0;
+            }
+        }
+    } else {
+        for (size_t i = 0; i < length; i++) {
+            uint8_t b = in[i];
+            if (b == SLIP_ESC) {
+                if (++i >= length) {
+                    return false;
+                }
+                if (in[i] == SLIP_ESC_END) {
+                    b = SLIP_END;
+                } else if (in[i] == SLIP_ESC_ESC) {
+                    b = SLIP_ESC;
+                } else {
+                    return false;
+                }
+            }
+            decodeBuffer[out++] = b;
+        }
+    }
+
+    outLength = out;
+    return true;
+}
+
+void PacketLink::handleFrame(const uint8_t* data, size_t length, uint8_t flags) {
+    // Empty frames: the leading delimiter of each frame
+    if (length == 0 && !(flags & UART2Manager::FRAME_FLAG_SPLIT)) {
+        return;
+    }
+    if ((flags & UART2Manager::FRAME_FLAG_SPLIT) || length > MAX_FRAME) {
+        stats.framingErrors++;
+        return;
+    }
+
+    size_t decoded = 0;
+    if (!decode(data, length, decoded) || decoded < 2 + crcLength()) {
+        stats.framingErrors++;
+        return;
+    }
+
+    size_t body = decoded - crcLength();
+    uint32_t expected = crcUpdate(crcType, crcInit(crcType), decodeBuffer, body);
+    uint32_t received = 0;
+    for (size_t i = 0; i < crcLength(); i++) {
+        received |= (uint32_t)decodeBuffer[body + i] << (8 * i);
+    }
+    if (received != expected) {
+        stats.crcErrors++;
+        return;
+    }
+
+    uint8_t type = decodeBuffer[0];
+    uint8_t seq = decodeBuffer[1];
+    switch (type) {
+        case TYPE_DATA:
+        case TYPE_DATA_ACK:
+            handleData(seq, decodeBuffer + 2, body - 2, type == TYPE_DATA_ACK);
+            break;
+        case TYPE_ACK:
+            handleAck(seq);
+            break;
+        default:
+            stats.framingErrors++;
+            break;
+    }
+}
+
+void PacketLink::handleData(uint8_t seq, const uint8_t* payload, size_t length, bool ackRequested) {
+    if (ackRequested) {
+        // Acknowledge duplicates too: the first ACK may have been lost
+        sendAck(seq);
+
+        for (uint8_t i = 0; i < recentCount; i++) {
+            if (recentSeq[i] == seq) {
+                stats.duplicates++;
+                return;
+            }
+        }
+        recentSeq[recentNext] = seq;
+        recentNext = (recentNext + 1) % (2 * MAX_WINDOW);
+        if (recentCount < 2 * MAX_WINDOW) {
+            recentCount++;
+        }
+    }
+
+    unsigned long now = millis();
+    if (streaming && packetCallback) {
+        Packet packet;
+        packet.data = payload;
+        packet.length = length;
+        packet.seq = seq;
+        packet.timestamp = now;
+        packetCallback(packet, packetCallbackArg);
+    } else {
+        void* item = nullptr;
+        if (xRingbufferSendAcquire(rxQueue, &item, sizeof(QueuedHeader) + length, 0) != pdTRUE) {
+            stats.rxDropped++;
+            return;
+        }
+        QueuedHeader* header = static_cast<QueuedHeader*>(item);
+        header->timestamp = now;
+        header->length = length;
+        header->seq = seq;
+        header->reserved = 0;
+        memcpy(header + 1, payload, length);
+        xRingbufferSendComplete(rxQueue, item);
+    }
+
+    stats.rxPackets++;
+    stats.rxBytes += length;
+}
+
+void PacketLink::handleAck(uint8_t seq) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    for (uint8_t i = 0; i < MAX_WINDOW; i++) {
+        if (slots[i].used && slots[i].seq == seq) {
+            slots[i].used = false;
+            stats.acksReceived++;
+            xSemaphoreGive(freeSlots);
+            break;
+        }
+    }
+    // Late ACKs for packets already given up are ignored
+    xSemaphoreGive(lock);
+}
+
+bool PacketLink::receive(Packet& packet, uint32_t timeoutMs) {
+    if (!rxQueue) {
+        return false;
+    }
+
+    size_t size = 0;
+    QueuedHeader* header = static_cast<QueuedHeader*>(
+        xRingbufferReceive(rxQueue, &size, pdMS_TO_TICKS(timeoutMs)));
+    if (!header) {
+        return false;
+    }
+
+    packet.data = reinterpret_cast<const uint8_t*>(header + 1);
+    packet.length = header->length;
+    packet.seq = header->seq;
+    packet.timestamp = header->timestamp;
+    packet.item = header;
+    return true;
+}
+
+void PacketLink::release(Packet& packet) {
+    if (rxQueue && packet.item) {
+        vRingbufferReturnItem(rxQueue, packet.item);
+    }
+    packet.item = nullptr;
+    packet.data = nullptr;
+}
+
+void PacketLink::linkTask(void* arg) {
+    PacketLink* self = static_cast<PacketLink*>(arg);
+    self->run();
+    self->running = false;
+    self->taskHandle = nullptr;
+    vTaskDelete(NULL);
+}
+
+void PacketLink::run() {
+    while (!stopRequested) {
+        // Someone else reconfigured the frame receiver: the link is gone
+        if (uart2.getFrameMode() != UART2Manager::FRAME_DELIMITER || uart2.getFrameDelimiter() != delimiter) {
+            message = "UART2 frame receiver changed";
+            Serial.println("[PKT] Link stopped: UART2 frame receiver changed");
+            return;
+        }
+
+        UART2Manager::Frame frame;
+        if (uart2.receiveFrame(frame, LINK_POLL_MS)) {
+            handleFrame(frame.data, frame.length, frame.flags);
+            uart2.releaseFrame(frame);
+        }
+
+        if (window > 0) {
+            checkTimeouts();
+        }
+    }
+}
@@ -0,0 +1,220 @@
+#ifndef PACKET_LINK_H
+#define PACKET_LINK_H
+
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/ringbuf.h"
+
+class UART2Manager;
+
+/**
+ * @brief Framed binary packet transport on UART2
+ *
+ * Packets are framed with COBS (0x00 delimiter) or SLIP (0xC0 END) and
+ * protected by CRC-16/CCITT-FALSE or CRC-32 (IEEE). Received frames come
+ * from the UART2 frame receiver in FRAME_DELIMITER mode, so a frame is
+ * already complete when the link task sees it.
+ *
+ * Packet before framing (CRC over type, seq and payload, little-endian):
+ *   [type:1][seq:1][payload:0..MAX_PAYLOAD][crc:2|4]
+ *   type 0x00 DATA, 0x01 DATA with ACK requested, 0x02 ACK (no payload)
+ *
+ * With a window > 0 every DATA packet asks for an ACK. Up to `window`
+ * packets may be unacknowledged; each is sent again after the ACK timeout
+ * until the retry limit. Received duplicates are acknowledged again but
+ * delivered once. With window 0 packets are sent once, without ACK.
+ *
+ * send() takes scatter/gather segments: the CRC runs over the segments
+ * and the encoder writes them straight into the frame that goes to the
+ * UART, so the payload is never assembled in a separate buffer.
+ *
+ * Received packets are queued for receive(), or passed to the packet
+ * callback in streaming mode.
+ *
+ * Usage:
+ *   PacketLink link(uart2);
+ *   link.begin(PacketLink::FRAMING_COBS, PacketLink::CRC_16, 4);
+ *   PacketLink::Segment parts[] = {{header, 4}, {payload, 100}};
+ *   link.send(parts, 2, 100);
+ *   PacketLink::Packet packet;
+ *   if (link.receive(packet, 1000)) { ...; link.release(packet); }
+ */
+class PacketLink {
+public:
+    enum Framing : uint8_t {
+        FRAMING_COBS = 0,
+        FRAMING_SLIP
+    };
+
+    enum CrcType : uint8_t {
+        CRC_16 = 0,             ///< CRC-16/CCITT-FALSE
+        CRC_32                  ///< CRC-32 (IEEE 802.3, as zlib)
+    };
+
+    /**
+     * @brief One part of a packet payload
+     */
+    struct Segment {
+        const void* data;
+        size_t length;
+    };
+
+    /**
+     * @brief A received packet, valid until release()
+     */
+    struct Packet {
+        const uint8_t* data = nullptr;
+        size_t length = 0;
+        uint8_t seq = 0;
+        uint32_t timestamp = 0;         ///< millis() at reception
+        void* item = nullptr;
+    };
+
+    struct Statistics {
+        uint32_t txPackets;         ///< DATA packets sent (first transmission)
+        uint32_t txBytes;           ///< Payload bytes sent
+        uint32_t rxPackets;         ///< DATA packets delivered
+        uint32_t rxBytes;           ///< Payload bytes delivered
+        uint32_t framingErrors;     ///< Bad COBS/SLIP encoding, wrong length or split frame
+        uint32_t crcErrors;
+        uint32_t retransmits;
+        uint32_t ackFailures;       ///< Packets given up after the last retry
+        uint32_t acksSent;
+        uint32_t acksReceived;
+        uint32_t duplicates;        ///< Retransmitted packets received again
+        uint32_t rxDropped;         ///< Packets dropped because the receive queue was full
+    };
+
+    /**
+     * @brief Called from the link task for each packet in streaming mode
+     */
+    typedef void (*PacketCallback)(const Packet& packet, void* arg);
+
+    static const size_t MAX_PAYLOAD = 500;                  // SLIP worst case must fit a UART2 frame
+    static const size_t MAX_FRAME = 2 * (2 + MAX_PAYLOAD + 4) + 2;
+    static const uint8_t MAX_WINDOW = 8;
+    static const uint16_t DEFAULT_ACK_TIMEOUT_MS = 50;
+    static const uint8_t DEFAULT_RETRIES = 3;
+    static const size_t RX_QUEUE_SIZE = 8 * 1024;
+
+    explicit PacketLink(UART2Manager& uart2);
+
+    /**
+     * @brief Start the link (takes over the UART2 frame receiver)
+     * @param window Unacknowledged packets in flight (0 = no ACK, up to MAX_WINDOW)
+     * @return false if UART2 is not initialized, a parameter is out of range or
+     *         the buffers / task cannot be created
+     */
+    bool begin(Framing framing, CrcType crc, uint8_t window = 0,
+               uint16_t ackTimeoutMs = DEFAULT_ACK_TIMEOUT_MS, uint8_t retries = DEFAULT_RETRIES);
+
+    /**
+     * @brief Stop the link and the UART2 frame receiver
+     */
+    void end();
+
+    bool isRunning() const { return running; }
+    Framing getFraming() const { return framing; }
+    CrcType getCrcType() const { return crcType; }
+    uint8_t getWindow() const { return window; }
+    uint16_t getAckTimeoutMs() const { return ackTimeoutMs; }
+    uint8_t getRetries() const { return retries; }
+    uint8_t getInFlight() const;
+    static const char* getFramingName(Framing framing);
+    static const char* getCrcName(CrcType crc);
+
+    /**
+     * @brief Why the link stopped by itself ("" while running or after end())
+     */
+    const char* getMessage() const { return message; }
+
+    /**
+     * @brief Send one packet made of several segments
+     * @param timeoutMs Wait for a free window slot (ACK mode)
+     * @return false if not running, the payload is too long, the window stays
+     *         full or the frame could not be queued (nothing is left in flight)
+     */
+    bool send(const Segment* segments, size_t count, uint32_t timeoutMs = 100);
+    bool send(const uint8_t* data, size_t length, uint32_t timeoutMs = 100);
+
+    /**
+     * @brief Take the next received packet (not used in streaming mode)
+     */
+    bool receive(Packet& packet, uint32_t timeoutMs);
+    void release(Packet& packet);
+
+    /**
+     * @brief Streaming mode: deliver packets to the callback instead of the queue
+     */
+    void setPacketCallback(PacketCallback callback, void* arg);
+    void setStreaming(bool enabled) { streaming = enabled; }
+    bool isStreaming() const { return streaming; }
+
+    Statistics getStatistics() const { return stats; }
+    void resetStatistics();
+
+private:
+    struct Slot {
+        bool used;
+        uint8_t seq;
+        uint8_t attempts;
+        uint32_t sentAt;
+        uint16_t length;
+        uint8_t* frame;
+    };
+
+    struct QueuedHeader {
+        uint32_t timestamp;
+        uint16_t length;
+        uint8_t seq;
+        uint8_t reserved;
+    };
+
+    UART2Manager& uart2;
+    TaskHandle_t taskHandle = nullptr;
+    SemaphoreHandle_t lock = nullptr;           // Slots and UART writes
+    SemaphoreHandle_t freeSlots = nullptr;      // Counting: window slots available
+    RingbufHandle_t rxQueue = nullptr;
+    volatile bool running = false;
+    volatile bool stopRequested = false;
+    volatile bool streaming = false;
+    const char* message = "";
+
+    Framing framing = FRAMING_COBS;
+    CrcType crcType = CRC_16;
+    uint8_t window = 0;
+    uint16_t ackTimeoutMs = DEFAULT_ACK_TIMEOUT_MS;
+    uint8_t retries = DEFAULT_RETRIES;
+    uint8_t delimiter = 0x00;
+
+    PacketCallback packetCallback = nullptr;
+    void* packetCallbackArg = nullptr;
+
+    // Buffers (kept once allocated)
+    uint8_t* frames = nullptr;                  // MAX_WINDOW window frames + one unacknowledged frame
+    uint8_t* decodeBuffer = nullptr;
+    Slot slots[MAX_WINDOW];
+    uint8_t nextSeq = 0;
+    uint8_t recentSeq[2 * MAX_WINDOW];          // Received DATA seqs, for duplicates
+    uint8_t recentCount = 0;
+    uint8_t recentNext = 0;
+
+    Statistics stats = {};
+
+    bool allocate();
+    size_t crcLength() const { return crcType == CRC_32 ? 4 : 2; }
+    size_t encode(uint8_t type, uint8_t seq, const Segment* segments, size_t count, uint8_t* out) const;
+    bool decode(const uint8_t* in, size_t length, size_t& outLength) const;
+    bool writeFrame(const uint8_t* frame, size_t length);
+    void sendAck(uint8_t seq);
+    void handleFrame(const uint8_t* data, size_t length, uint8_t flags);
+    void handleData(uint8_t seq, const uint8_t* payload, size_t length, bool ackRequested);
+    void handleAck(uint8_t seq);
+    void checkTimeouts();
+    void run();
+    static void linkTask(void* arg);
+};
+
+#endif // PACKET_LINK_H
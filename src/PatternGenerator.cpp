@@ -0,0 +1,418 @@
+#include "PatternGenerator.h"
+#include "PeripheralPins.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_gpio.h"
+#include "soc/gpio_sig_map.h"
+#include <math.h>
+
+PatternGenerator::PatternGenerator() {
+}
+
+// ============================================================================
+// Pattern Editing
+// ============================================================================
+
+bool PatternGenerator::clear() {
+    if (isPlaying()) {
+        return false;
+    }
+    segments = 0;
+    totalTicks = 0;
+    lastLevel = false;
+    return true;
+}
+
+bool PatternGenerator::setResolution(float ns) {
+    if (isPlaying() || segments > 0) {
+        return false;
+    }
+    long div = lroundf(ns / BASE_TICK_NS);
+    if (div < 1 || div > 255 || fabsf(div * BASE_TICK_NS - ns) > 0.01f) {
+        return false;
+    }
+    clockDiv = (uint8_t)div;
+    return true;
+}
+
+bool PatternGenerator::durationToTicks(const char* text, uint32_t& ticks) const {
+    char* end = nullptr;
+    double value = strtod(text, &end);
+    if (end == text || value <= 0) {
+        return false;
+    }
+    while (*end == ' ') {
+        end++;
+    }
+
+    double ns;
+    if (*end == '\0' || strcasecmp(end, "us") == 0 || strcmp(end, "µs") == 0) {
+        ns = value * 1000.0;
+    } else if (strcasecmp(end, "ns") == 0) {
+        ns = value;
+    } else if (strcasecmp(end, "ms") == 0) {
+        ns = value * 1000000.0;
+    } else {
+        return false;
+    }
+
+    double count = round(ns / getResolutionNs());
+    if (count < 1 || count > 0xFFFFFFFFu) {
+        return false;
+    }
+    ticks = (uint32_t)count;
+    return true;
+}
+
+bool PatternGenerator::allocate() {
+    if (symbols) {
+        return true;
+    }
+
+    symbols = static_cast<rmt_item32_t*>(heap_caps_malloc(MAX_SYMBOLS * sizeof(rmt_item32_t),
+                                                          MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+    if (symbols) {
+        capacity = MAX_SYMBOLS;
+        inPSRAM = true;
+    } else {
+        symbols = static_cast<rmt_item32_t*>(heap_caps_malloc(FALLBACK_SYMBOLS * sizeof(rmt_item32_t), MALLOC_CAP_8BIT));
+        if (symbols) {
+            capacity = FALLBACK_SYMBOLS;
+            inPSRAM = false;
+        }
+    }
+    if (!symbols) {
+        Serial.println("[PATTERN] ❌ Buffer allocation failed");
+        return false;
+    }
+
+    Serial.printf("[PATTERN] Buffer: %lu symbols in %s\n",
+                  (unsigned long)capacity, inPSRAM ? "PSRAM" : "internal RAM");
+    return true;
+}
+
+bool PatternGenerator::appendHalf(bool level, uint16_t ticks) {
+    uint32_t index = segments / 2;
+    if (index >= capacity) {
+        return false;
+    }
+    rmt_item32_t& symbol = symbols[index];
+    if (segments & 1) {
+        symbol.level1 = level;
+        symbol.duration1 = ticks;
+    } else {
+        symbol.level0 = level;
+        symbol.duration0 = ticks;
+    }
+    segments++;
+    return true;
+}
+
+bool PatternGenerator::addSegment(bool level, uint32_t ticks) {
+    if (isPlaying() || ticks == 0 || !allocate()) {
+        return false;
+    }
+
+    uint32_t savedSegments = segments;
+    uint32_t remaining = ticks;
+    while (remaining > 0) {
+        uint16_t part = remaining > MAX_SEGMENT_TICKS ? MAX_SEGMENT_TICKS : remaining;
+        if (!appendHalf(level, part)) {
+            segments = savedSegments;
+            return false;
+        }
+        remaining -= part;
+    }
+    totalTicks += ticks;
+    lastLevel = level;
+    return true;
+}
+
+bool PatternGenerator::addSegments(const char* spec, String& error) {
+    if (isPlaying()) {
+        error = "Pattern is playing";
+        return false;
+    }
+
+    uint32_t savedSegments = segments;
+    uint64_t savedTicks = totalTicks;
+    bool savedLevel = lastLevel;
+    int added = 0;
+
+    String text(spec);
+    text.replace(',', ' ');
+    text.trim();
+    int pos = 0;
+    while (pos < (int)text.length()) {
+        int space = text.indexOf(' ', pos);
+        if (space < 0) {
+            space = text.length();
+        }
+        String token = text.substring(pos, space);
+        pos = space + 1;
+        if (token.length() == 0) {
+            continue;
+        }
+
+        uint32_t ticks;
+        int colon = token.indexOf(':');
+        String level = token.substring(0, colon);
+        if (colon < 0 || (level != "0" && level != "1")) {
+            error = "Bad segment '" + token + "' (use <0|1>:<duration>)";
+        } else if (!durationToTicks(token.c_str() + colon + 1, ticks)) {
+            error = "Bad duration in '" + token + "'";
+        } else if (!addSegment(level == "1", ticks)) {
+            error = "Pattern buffer full";
+        } else {
+            added++;
+            continue;
+        }
+
+        segments = savedSegments;
+        totalTicks = savedTicks;
+        lastLevel = savedLevel;
+        return false;
+    }
+
+    if (added == 0) {
+        error = "No segments";
+        return false;
+    }
+    return true;
+}
+
+bool PatternGenerator::addPulses(uint32_t highTicks, uint32_t lowTicks, uint32_t count) {
+    if (isPlaying() || count == 0) {
+        return false;
+    }
+
+    uint32_t savedSegments = segments;
+    uint64_t savedTicks = totalTicks;
+    bool savedLevel = lastLevel;
+    for (uint32_t i = 0; i < count; i++) {
+        if (!addSegment(true, highTicks) || !addSegment(false, lowTicks)) {
+            segments = savedSegments;
+            totalTicks = savedTicks;
+            lastLevel = savedLevel;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PatternGenerator::addBits(const char* bits, uint32_t bitTicks) {
+    if (isPlaying() || bits[0] == '\0') {
+        return false;
+    }
+
+    uint32_t savedSegments = segments;
+    uint64_t savedTicks = totalTicks;
+    bool savedLevel = lastLevel;
+    const char* p = bits;
+    while (*p) {
+        if (*p == '_') {
+            p++;
+            continue;
+        }
+        if (*p != '0' && *p != '1') {
+            break;
+        }
+
+        // A run of equal bits is one segment
+        char bit = *p;
+        uint32_t run = 0;
+        while (*p == bit || *p == '_') {
+            if (*p == bit) {
+                run++;
+            }
+            p++;
+        }
+        if ((uint64_t)run * bitTicks > 0xFFFFFFFFu || !addSegment(bit == '1', run * bitTicks)) {
+            break;
+        }
+    }
+
+    if (*p != '\0') {
+        segments = savedSegments;
+        totalTicks = savedTicks;
+        lastLevel = savedLevel;
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Playback
+// ============================================================================
+
+int PatternGenerator::outputPin(Output output) {
+    return output == OUTPUT_GPIO12 ? PIN_PWM_CHANGE_PULSE : PIN_GPIO_OUTPUT;
+}
+
+const char* PatternGenerator::getOutputName(Output output) {
+    switch (output) {
+        case OUTPUT_GPIO41: return "GPIO41";
+        case OUTPUT_GPIO12: return "GPIO12";
+        default:            return "UNKNOWN";
+    }
+}
+
+bool PatternGenerator::parseOutput(const String& text, Output& output) {
+    if (text == "41" || text.equalsIgnoreCase("GPIO41")) {
+        output = OUTPUT_GPIO41;
+    } else if (text == "12" || text.equalsIgnoreCase("GPIO12")) {
+        output = OUTPUT_GPIO12;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* PatternGenerator::getStateName() const {
+    switch (state) {
+        case STATE_IDLE:    return "IDLE";
+        case STATE_PLAYING: return "PLAYING";
+        case STATE_DONE:    return "DONE";
+        case STATE_STOPPED: return "STOPPED";
+        case STATE_FAILED:  return "FAILED";
+        default:            return "UNKNOWN";
+    }
+}
+
+bool PatternGenerator::play(Output newOutput, uint32_t newLoops) {
+    if (taskHandle || isPlaying()) {
+        return false;
+    }
+    if (segments == 0 || newLoops > MAX_LOOPS) {
+        return false;
+    }
+
+    // Odd count: a zero duration in the last symbol ends the pattern
+    if (segments & 1) {
+        rmt_item32_t& last = symbols[segments / 2];
+        last.level1 = last.level0;
+        last.duration1 = 0;
+    }
+
+    output = newOutput;
+    rmt_config_t config = RMT_DEFAULT_CONFIG_TX((gpio_num_t)outputPin(output), CHANNEL);
+    config.clk_div = clockDiv;
+    config.mem_block_num = MEM_BLOCKS;
+    config.tx_config.idle_output_en = true;
+    config.tx_config.idle_level = lastLevel ? RMT_IDLE_LEVEL_HIGH : RMT_IDLE_LEVEL_LOW;
+    if (rmt_config(&config) != ESP_OK) {
+        esp_rom_gpio_connect_out_signal(outputPin(output), SIG_GPIO_OUT_IDX, false, false);
+        message = "RMT configuration failed";
+        state = STATE_FAILED;
+        return false;
+    }
+    if (rmt_driver_install(CHANNEL, 0, 0) != ESP_OK) {
+        esp_rom_gpio_connect_out_signal(outputPin(output), SIG_GPIO_OUT_IDX, false, false);
+        message = "RMT channel not available";
+        state = STATE_FAILED;
+        return false;
+    }
+
+    loops = newLoops;
+    loopsDone = 0;
+    hardwareLoop = getSymbolCount() <= HW_LOOP_SYMBOLS && loops != 1;
+    message = "";
+    stopRequested = false;
+    state = STATE_PLAYING;
+
+    BaseType_t ok = xTaskCreatePinnedToCore(
+        playerTask,
+        "Pattern",
+        4096,
+        this,
+        2,                  // Only restarts repeats; the RMT produces the edges
+        &taskHandle,
+        1);
+    if (ok != pdPASS) {
+        taskHandle = nullptr;
+        release();
+        message = "Task creation failed";
+        state = STATE_FAILED;
+        return false;
+    }
+
+    Serial.printf("[PATTERN] Playing %lu segments (%.1f µs) on %s, %s%s\n",
+                  (unsigned long)segments, getDurationUs(), getOutputName(output),
+                  loops == 0 ? "forever" : String(loops).c_str(),
+                  hardwareLoop ? " (hardware loop)" : "");
+    return true;
+}
+
+void PatternGenerator::stop() {
+    if (!taskHandle) {
+        return;
+    }
+    stopRequested = true;
+    unsigned long start = millis();
+    while (taskHandle && millis() - start < STOP_TIMEOUT_MS) {
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+}
+
+void PatternGenerator::release() {
+    rmt_tx_stop(CHANNEL);
+    rmt_driver_uninstall(CHANNEL);
+    // Back to plain GPIO; the output register still holds the owner's level
+    esp_rom_gpio_connect_out_signal(outputPin(output), SIG_GPIO_OUT_IDX, false, false);
+}
+
+// ============================================================================
+// Player Task
+// ============================================================================
+
+void PatternGenerator::run() {
+    uint32_t count = getSymbolCount();
+    bool failed = false;
+
+    if (hardwareLoop) {
+        rmt_set_tx_loop_mode(CHANNEL, true);
+    }
+
+    while (!stopRequested && (loops == 0 || loopsDone < loops)) {
+        uint32_t batch = 1;
+        if (hardwareLoop && loops > 0) {
+            batch = loops - loopsDone;
+            if (batch > MAX_HW_LOOPS) {
+                batch = MAX_HW_LOOPS;
+            }
+            rmt_set_tx_loop_count(CHANNEL, batch);
+#if SOC_RMT_SUPPORT_TX_LOOP_AUTO_STOP
+            rmt_enable_tx_loop_autostop(CHANNEL, true);
+#endif
+        }
+
+        // Non-blocking: the driver refills the channel memory from the buffer
+        if (rmt_write_items(CHANNEL, symbols, count, false) != ESP_OK) {
+            failed = true;
+            break;
+        }
+
+        // An endless hardware loop only ends by stop
+        while (!stopRequested && rmt_wait_tx_done(CHANNEL, pdMS_TO_TICKS(WAIT_SLICE_MS)) != ESP_OK) {
+        }
+        if (stopRequested) {
+            break;
+        }
+        loopsDone += batch;
+    }
+
+    release();
+
+    if (failed) {
+        message = "RMT write failed";
+        state = STATE_FAILED;
+    } else {
+        state = stopRequested ? STATE_STOPPED : STATE_DONE;
+    }
+}
+
+void PatternGenerator::playerTask(void* arg) {
+    PatternGenerator* self = static_cast<PatternGenerator*>(arg);
+    self->run();
+    self->taskHandle = nullptr;
+    vTaskDelete(NULL);
+}
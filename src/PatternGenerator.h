@@ -0,0 +1,188 @@
+#ifndef PATTERN_GENERATOR_H
+#define PATTERN_GENERATOR_H
+
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/rmt.h"
+
+/**
+ * @brief Pulse-train / bit-pattern generator on the RMT peripheral
+ *
+ * Plays an arbitrary sequence of (level, duration) segments on GPIO 41
+ * (general output) or GPIO 12 (PWM change pulse) with one RMT tick of
+ * resolution: 12.5 ns × clock divider, 100 ns by default. The hardware
+ * produces every edge; the CPU does no work per edge.
+ *
+ * The pattern is kept as RMT symbols (two segments each) in a buffer
+ * allocated from PSRAM on first use and kept. Segments longer than one
+ * RMT duration (32767 ticks) are split. Playback:
+ * - Patterns that fit the channel memory (HW_LOOP_SYMBOLS) repeat in the
+ *   RMT's own loop mode: seamless, up to MAX_HW_LOOPS per batch or
+ *   forever.
+ * - Longer patterns are streamed by the RMT driver, which refills half
+ *   of the channel memory from the buffer at a time (ping-pong); repeats
+ *   are restarted by the player task with a gap of a few µs.
+ * Between repeats and after the end the pin holds the level of the last
+ * segment.
+ *
+ * Uses RMT TX channel 2 together with channel 3's memory; the status
+ * LED driver takes the first free channel. While playing the pin is
+ * routed to the RMT; afterwards it returns to plain GPIO with the level
+ * last set by its owner (GPIOControl / UART1Mux).
+ *
+ * Usage:
+ *   PatternGenerator pattern;
+ *   uint32_t high, low;
+ *   pattern.durationToTicks("250us", high);
+ *   pattern.durationToTicks("750us", low);
+ *   pattern.addPulses(high, low, 100);
+ *   pattern.play(PatternGenerator::OUTPUT_GPIO41, 0);     // 0 = forever
+ */
+class PatternGenerator {
+public:
+    enum Output : uint8_t {
+        OUTPUT_GPIO41 = 0,
+        OUTPUT_GPIO12
+    };
+
+    enum State : uint8_t {
+        STATE_IDLE = 0,
+        STATE_PLAYING,
+        STATE_DONE,
+        STATE_STOPPED,          ///< Stopped by command
+        STATE_FAILED
+    };
+
+    static const uint32_t MAX_SYMBOLS = 256 * 1024;         // 1 MB of PSRAM
+    static const uint32_t FALLBACK_SYMBOLS = 1024;          // Internal RAM without PSRAM
+    static const uint16_t MAX_SEGMENT_TICKS = 32767;        // 15-bit RMT duration
+    static const uint8_t MEM_BLOCKS = 2;
+    static const uint16_t HW_LOOP_SYMBOLS = MEM_BLOCKS * 48 - 1;   // Channel memory minus the end marker
+    static const uint16_t MAX_HW_LOOPS = 1023;              // 10-bit loop counter
+    static const uint32_t MAX_LOOPS = 100000000;
+    static const uint8_t DEFAULT_CLOCK_DIV = 8;             // 100 ns ticks
+    static constexpr float BASE_TICK_NS = 12.5f;            // 80 MHz APB
+
+    PatternGenerator();
+
+    // ========================================================================
+    // Pattern Editing (refused while playing)
+    // ========================================================================
+
+    /**
+     * @brief Remove all segments (keeps the resolution)
+     */
+    bool clear();
+
+    /**
+     * @brief Set the tick length
+     * @param ns Multiple of 12.5 ns, 12.5-3187.5 ns
+     * @return false while playing, if segments exist (clear first) or out of range
+     */
+    bool setResolution(float ns);
+
+    float getResolutionNs() const { return clockDiv * BASE_TICK_NS; }
+
+    /**
+     * @brief Convert "2.5us", "500ns", "1.2ms" or a bare number (µs) to ticks
+     * @return false if unparsable, below one tick or too long
+     */
+    bool durationToTicks(const char* text, uint32_t& ticks) const;
+
+    /**
+     * @brief Append one segment
+     * @param ticks Duration in ticks (split above MAX_SEGMENT_TICKS)
+     */
+    bool addSegment(bool level, uint32_t ticks);
+
+    /**
+     * @brief Append segments written as "<0|1>:<duration>" separated by spaces or commas
+     * @param error Receives the reason on failure (nothing is appended then)
+     */
+    bool addSegments(const char* spec, String& error);
+
+    /**
+     * @brief Append count periods of high then low (e.g. a tach signal)
+     */
+    bool addPulses(uint32_t highTicks, uint32_t lowTicks, uint32_t count);
+
+    /**
+     * @brief Append a bit string ('0' / '1', '_' ignored), bitTicks per bit
+     */
+    bool addBits(const char* bits, uint32_t bitTicks);
+
+    uint32_t getSegmentCount() const { return segments; }
+    uint32_t getSymbolCount() const { return (segments + 1) / 2; }
+    uint64_t getTotalTicks() const { return totalTicks; }
+    float getDurationUs() const { return totalTicks * getResolutionNs() / 1000.0f; }
+
+    /**
+     * @brief Buffer size in symbols (0 before the first segment)
+     */
+    uint32_t getCapacity() const { return capacity; }
+    bool isInPSRAM() const { return inPSRAM; }
+
+    // ========================================================================
+    // Playback
+    // ========================================================================
+
+    /**
+     * @brief Start playing the pattern (runs in its own task)
+     * @param loops Repeats, 0 = until stop()
+     * @return false if playing, the pattern is empty, loops out of range or
+     *         the RMT channel / task cannot be set up
+     */
+    bool play(Output output, uint32_t loops);
+
+    /**
+     * @brief Stop playback (waits for the player task)
+     */
+    void stop();
+
+    bool isPlaying() const { return state == STATE_PLAYING; }
+    State getState() const { return state; }
+    const char* getStateName() const;
+    Output getOutput() const { return output; }
+    static const char* getOutputName(Output output);
+    static bool parseOutput(const String& text, Output& output);
+    uint32_t getLoops() const { return loops; }
+    uint32_t getLoopsDone() const { return loopsDone; }
+    bool isHardwareLoop() const { return hardwareLoop; }
+
+    /**
+     * @brief Reason for STATE_FAILED
+     */
+    const char* getMessage() const { return message; }
+
+private:
+    static const rmt_channel_t CHANNEL = RMT_CHANNEL_2;
+    static const uint32_t WAIT_SLICE_MS = 20;
+    static const uint32_t STOP_TIMEOUT_MS = 500;
+
+    rmt_item32_t* symbols = nullptr;
+    uint32_t capacity = 0;
+    bool inPSRAM = false;
+    uint32_t segments = 0;
+    uint64_t totalTicks = 0;
+    bool lastLevel = false;
+    uint8_t clockDiv = DEFAULT_CLOCK_DIV;
+
+    TaskHandle_t taskHandle = nullptr;
+    volatile State state = STATE_IDLE;
+    volatile bool stopRequested = false;
+    const char* message = "";
+    Output output = OUTPUT_GPIO41;
+    uint32_t loops = 1;
+    volatile uint32_t loopsDone = 0;
+    bool hardwareLoop = false;
+
+    bool allocate();
+    bool appendHalf(bool level, uint16_t ticks);
+    static int outputPin(Output output);
+    void release();
+    void run();
+    static void playerTask(void* arg);
+};
+
+#endif // PATTERN_GENERATOR_H
@@ -1,8 +1,16 @@
 #include "CommandParser.h"
 #include "PeripheralManager.h"
+#include "WebServer.h"
+#include "UARTBridge.h"
+#include "HIDDataChannel.h"
+#include "esp_timer.h"
 
 // External reference to peripheral manager (defined in main.cpp)
 extern PeripheralManager peripheralManager;
+extern WebServerManager webServerManager;
+extern UARTBridge uartBridge;
+extern HIDDataChannel hidChannel;
+extern SemaphoreHandle_t hidSendMutex;
 
 // ============================================================================
 // UART1 Commands
@@ -109,125 +117,1394 @@ void CommandParser::handleUART1PWM(const String& cmd, ICommandResponse* response
     }
 
     // Use atomic setPWMFrequencyAndDuty() to update both parameters with single pulse
-    if (peripheralManager.getUART1().setPWMFrequencyAndDuty(freq, duty)) {
+    PWMSynthResult synth;
+    if (peripheralManager.getUART1().setPWMFrequencyAndDuty(freq, duty, &synth)) {
         peripheralManager.getUART1().setPWMEnabled(enablePWM);
 
-        // Get actual frequency (may differ from requested due to hardware limitations)
-        uint32_t actualFreq = peripheralManager.getUART1().getPWMFrequency();
-        response->printf("UART1 PWM: %u Hz, %.1f%% duty, %s\n", actualFreq, duty, enablePWM ? "enabled" : "disabled");
+        response->printf("UART1 PWM: %u Hz, %.1f%% duty, %s\n", freq, duty, enablePWM ? "enabled" : "disabled");
+        response->printf("  Achieved: %.3f Hz (%+.1f ppm), duty resolution %.3f%%\n",
+                         synth.frequency, synth.errorPpm, synth.dutyResolution);
 
-        // Warn if actual frequency differs significantly from requested
-        if (actualFreq != freq) {
-            float error = abs((int32_t)actualFreq - (int32_t)freq) * 100.0 / freq;
-            if (error > 5.0) {
-                response->printf("WARNING: Requested %u Hz, achieved %u Hz (%.1f%% difference)\n", freq, actualFreq, error);
-                response->println("Note: MCPWM hardware may adjust frequency for optimal resolution");
+        // Warn if the 16-bit timer cannot hit the request closely
+        if (fabs(synth.errorPpm) > 10000.0) {
+            response->printf("WARNING: Achieved frequency is %.2f%% off the request (timer clock %u Hz)\n",
+                             synth.errorPpm / 10000.0, peripheralManager.getUART1().getPWMClock());
+        }
+    } else {
+        response->println("ERROR: Failed to set UART1 PWM parameters");
+    }
+}
+
+void CommandParser::handleUART1Status(ICommandResponse* response) {
+    auto& uart1 = peripheralManager.getUART1();
+
+    response->println("UART1 Status:");
+    response->printf("  Mode: %s\n", uart1.getModeName());
+
+    if (uart1.getMode() == UART1Mux::MODE_UART) {
+        response->printf("  Baud: %u\n", uart1.getUARTBaudRate());
+        uint32_t tx, rx, err;
+        uart1.getUARTStatistics(&tx, &rx, &err);
+        response->printf("  TX: %u bytes, RX: %u bytes, Errors: %u\n", tx, rx, err);
+    } else if (uart1.getMode() == UART1Mux::MODE_PWM_RPM) {
+        const PWMSynthResult& synth = uart1.getPWMSynthesis();
+        response->printf("  PWM Frequency: %u Hz (achieved %.3f Hz, %+.1f ppm)\n",
+                         uart1.getPWMFrequency(), synth.frequency, synth.errorPpm);
+        response->printf("  PWM Duty: %.1f%% (resolution %.3f%%)\n", uart1.getPWMDuty(), synth.dutyResolution);
+        response->printf("  PWM Enabled: %s\n", uart1.isPWMEnabled() ? "Yes" : "No");
+        response->printf("  RPM Frequency: %.1f Hz\n", uart1.getRPMFrequency());
+        response->printf("  RPM Signal: %s\n", uart1.hasRPMSignal() ? "Present" : "None");
+        response->printf("  RPM Range: %s (%u switches)\n", uart1.getRPMRangeName(), uart1.getRPMRangeSwitches());
+        response->printf("  RPM ISR Load: %u interrupts/s\n", uart1.getRPMIsrRate());
+    }
+
+    UART1Mux::ModeSwitchStats stats = uart1.getModeSwitchStats();
+    if (stats.count > 0) {
+        response->printf("  Mode Switches: %u (last %u us, min %u, avg %u, max %u us, settle timeouts %u)\n",
+                         stats.count, stats.lastUs, stats.minUs, (uint32_t)(stats.totalUs / stats.count),
+                         stats.maxUs, stats.settleTimeouts);
+    }
+}
+
+void CommandParser::handleUART1Bench(const String& cmd, ICommandResponse* response) {
+    // UART1 BENCH <cycles>
+    // "UART1 BENCH " is exactly 12 characters, cycles start at position 12
+    String value = cmd.substring(12);
+    value.trim();
+    long cycles = value.toInt();
+    if (cycles < 1 || cycles > (long)UART1Mux::MAX_BENCH_CYCLES) {
+        response->printf("Usage: UART1 BENCH <cycles 1-%u>\n", UART1Mux::MAX_BENCH_CYCLES);
+        return;
+    }
+
+    auto& uart1 = peripheralManager.getUART1();
+    response->printf("Cycling UART1 PWM/RPM <-> UART %ld times...\n", cycles);
+
+    UART1Mux::ModeSwitchBench bench = {};
+    bool ok = uart1.benchmarkModeSwitch((uint32_t)cycles, bench);
+    if (bench.cycles == 0) {
+        response->println("ERROR: Mode switch benchmark failed");
+        return;
+    }
+
+    response->printf("UART1 Mode Switch Benchmark (%u cycles%s):\n", bench.cycles, ok ? "" : ", aborted on error");
+    response->println("  Direction     min     p50     p90     p99     max (us)");
+    const UART1Mux::ModeSwitchPercentiles* rows[] = { &bench.toPWM, &bench.toUART };
+    const char* names[] = { "-> PWM/RPM", "-> UART" };
+    for (int i = 0; i < 2; i++) {
+        response->printf("  %-10s %7u %7u %7u %7u %7u\n", names[i], rows[i]->minUs, rows[i]->p50Us,
+                         rows[i]->p90Us, rows[i]->p99Us, rows[i]->maxUs);
+    }
+    response->printf("  Settle timeouts: %u\n", bench.settleTimeouts);
+    response->printf("  Mode restored: %s\n", uart1.getModeName());
+}
+
+void CommandParser::handleUART1Write(const String& cmd, ICommandResponse* response) {
+    // UART1 WRITE <text>
+    // "UART1 WRITE " is exactly 12 characters, text starts at position 12
+    String text = cmd.substring(12);
+    text.trim();
+
+    if (text.length() == 0) {
+        response->println("Usage: UART1 WRITE <text>");
+        return;
+    }
+
+    text += "\n";  // Add newline
+
+    int written = peripheralManager.getUART1().write(text.c_str());
+    if (written > 0) {
+        response->printf("Wrote %d bytes to UART1\n", written);
+    } else {
+        response->println("ERROR: Failed to write to UART1");
+    }
+}
+
+// ============================================================================
+// UART2 Commands
+// ============================================================================
+
+void CommandParser::handleUART2Config(const String& cmd, ICommandResponse* response) {
+    // UART2 CONFIG <baud>
+    // "UART2 CONFIG " is exactly 13 characters, baud starts at position 13
+    String baudStr = cmd.substring(13);
+    baudStr.trim();
+
+    if (baudStr.length() == 0) {
+        response->println("Usage: UART2 CONFIG <baud>");
+        return;
+    }
+
+    uint32_t baud = baudStr.toInt();
+
+    if (baud < 2400 || baud > 1500000) {
+        response->println("ERROR: Baud rate must be 2400-1500000");
+        return;
+    }
+
+    if (peripheralManager.getModbus().isRunning()) {
+        response->println("ERROR: Modbus server is running on UART2 (use MODBUS STOP)");
+        return;
+    }
+
+    if (peripheralManager.getUART2().reconfigure(baud)) {
+        response->printf("UART2 configured: %u baud\n", baud);
+    } else {
+        response->println("ERROR: Failed to configure UART2");
+    }
+}
+
+void CommandParser::handleUART2Status(ICommandResponse* response) {
+    auto& uart2 = peripheralManager.getUART2();
+
+    response->println("UART2 Status:");
+    response->printf("  Baud: %u\n", uart2.getBaudRate());
+    uint32_t tx, rx, err;
+    uart2.getStatistics(&tx, &rx, &err);
+    response->printf("  TX: %u bytes, RX: %u bytes, Errors: %u\n", tx, rx, err);
+
+    UART2Manager::FrameMode mode = uart2.getFrameMode();
+    if (mode == UART2Manager::FRAME_OFF) {
+        response->println("  Frames: OFF");
+    } else if (mode == UART2Manager::FRAME_DELIMITER) {
+        response->printf("  Frames: DELIMITER 0x%02X\n", uart2.getFrameDelimiter());
+    } else {
+        response->printf("  Frames: %s\n", UART2Manager::getFrameModeName(mode));
+    }
+    if (uart2.getFrameRingSize() > 0) {
+        UART2Manager::FrameStatistics stats = uart2.getFrameStatistics();
+        response->printf("  Frame ring: %u / %u bytes (%s)\n",
+                         (unsigned)uart2.getFrameRingUsed(), (unsigned)uart2.getFrameRingSize(),
+                         uart2.isFrameRingInPSRAM() ? "PSRAM" : "internal RAM");
+        response->printf("  Frames: %u, Split: %u, Dropped: %u (%u bytes), RX overflows: %u\n",
+                         stats.frames, stats.splitFrames, stats.droppedFrames,
+                         stats.droppedBytes, stats.rxOverflows);
+    }
+}
+
+void CommandParser::handleUART2Write(const String& cmd, ICommandResponse* response) {
+    // UART2 WRITE <text>
+    // "UART2 WRITE " is exactly 12 characters, text starts at position 12
+    String text = cmd.substring(12);
+    text.trim();
+
+    if (text.length() == 0) {
+        response->println("Usage: UART2 WRITE <text>");
+        return;
+    }
+
+    text += "\n";
+
+    int written = peripheralManager.getUART2().write(text.c_str());
+    if (written > 0) {
+        response->printf("Wrote %d bytes to UART2\n", written);
+    } else {
+        response->println("ERROR: Failed to write to UART2");
+    }
+}
+
+void CommandParser::handleUART2Frame(const String& cmd, ICommandResponse* response) {
+    // UART2 FRAME <LINE|IDLE|OFF> or UART2 FRAME DELIM <char|0xNN>
+    // "UART2 FRAME " is exactly 12 characters, mode starts at position 12
+    String param = cmd.substring(12);
+    param.trim();
+    String paramUpper = param;
+    paramUpper.toUpperCase();
+
+    auto& uart2 = peripheralManager.getUART2();
+
+    if (peripheralManager.getPacketLink().isRunning()) {
+        response->println("ERROR: UART2 packet link is running (use PKT STOP)");
+        return;
+    }
+    if (peripheralManager.getModbus().isRunning()) {
+        response->println("ERROR: Modbus server is running on UART2 (use MODBUS STOP)");
+        return;
+    }
+
+    if (paramUpper == "OFF") {
+        uart2.stopFrames();
+        response->println("UART2 frame receiver stopped");
+        return;
+    }
+
+    if (uartBridge.isActive() && uartBridge.getPort() == UARTBridge::PORT_UART2) {
+        response->println("ERROR: UART2 is bridged");
+        return;
+    }
+    if (peripheralManager.getBert().isRunning() && peripheralManager.getBert().getPort() == UARTBert::PORT_UART2) {
+        response->println("ERROR: UART2 BERT is running (use UART2 BERT STOP)");
+        return;
+    }
+    if (hidChannel.isActive() && hidChannel.getPort() == HIDDataChannel::PORT_UART2) {
+        response->println("ERROR: UART2 is used by the HID data channel (use HIDUART STOP)");
+        return;
+    }
+
+    UART2Manager::FrameMode mode;
+    uint8_t delimiter = '\n';
+    if (paramUpper == "LINE") {
+        mode = UART2Manager::FRAME_LINE;
+    } else if (paramUpper == "IDLE") {
+        mode = UART2Manager::FRAME_IDLE;
+    } else if (paramUpper.startsWith("DELIM ")) {
+        // Case kept: the delimiter may be a letter
+        String value = param.substring(6);
+        value.trim();
+        if (value.length() == 1) {
+            delimiter = (uint8_t)value[0];
+        } else if (value.length() > 2 && value.length() <= 4 && (value.startsWith("0x") || value.startsWith("0X"))) {
+            char* end = nullptr;
+            long parsed = strtol(value.c_str() + 2, &end, 16);
+            if (*end != '\0' || parsed < 0 || parsed > 0xFF) {
+                response->println("ERROR: Delimiter must be one character or 0x00-0xFF");
+                return;
+            }
+            delimiter = (uint8_t)parsed;
+        } else {
+            response->println("ERROR: Delimiter must be one character or 0x00-0xFF");
+            return;
+        }
+        mode = UART2Manager::FRAME_DELIMITER;
+    } else {
+        response->println("Usage: UART2 FRAME <LINE|IDLE|OFF> or UART2 FRAME DELIM <char|0xNN>");
+        return;
+    }
+
+    if (!uart2.startFrames(mode, delimiter)) {
+        response->println("ERROR: Failed to start UART2 frame receiver");
+        return;
+    }
+
+    if (mode == UART2Manager::FRAME_DELIMITER) {
+        response->printf("UART2 frame receiver: DELIMITER 0x%02X\n", delimiter);
+    } else {
+        response->printf("UART2 frame receiver: %s\n", UART2Manager::getFrameModeName(mode));
+    }
+}
+
+void CommandParser::handleUART2Read(const String& cmd, ICommandResponse* response) {
+    // UART2 READ [count]
+    // "UART2 READ" is exactly 10 characters, count starts after it
+    const int MAX_SHOWN = 64;
+    int count = 10;
+    String countStr = cmd.substring(10);
+    countStr.trim();
+    if (countStr.length() > 0) {
+        count = countStr.toInt();
+        if (count < 1 || count > 100) {
+            response->println("ERROR: Count must be 1-100");
+            return;
+        }
+    }
+
+    auto& uart2 = peripheralManager.getUART2();
+    if (uart2.getFrameMode() == UART2Manager::FRAME_OFF && uart2.getFrameRingSize() == 0) {
+        response->println("ERROR: UART2 frame receiver not started (use UART2 FRAME LINE)");
+        return;
+    }
+
+    int shown = 0;
+    UART2Manager::Frame frame;
+    while (shown < count && uart2.receiveFrame(frame, 0)) {
+        char text[MAX_SHOWN + 1];
+        size_t len = frame.length < (size_t)MAX_SHOWN ? frame.length : MAX_SHOWN;
+        for (size_t i = 0; i < len; i++) {
+            uint8_t c = frame.data[i];
+            text[i] = (c >= 0x20 && c < 0x7F) ? (char)c : '.';
+        }
+        text[len] = '\0';
+
+        response->printf("[%lu] %s%s%s%s\n", (unsigned long)frame.timestamp, text,
+                         frame.length > len ? "..." : "",
+                         (frame.flags & UART2Manager::FRAME_FLAG_SPLIT) ? " (split)" : "",
+                         (frame.flags & UART2Manager::FRAME_FLAG_LOSS) ? " (after loss)" : "");
+        uart2.releaseFrame(frame);
+        shown++;
+    }
+
+    if (shown == 0) {
+        response->println("No UART2 frames");
+    }
+}
+
+// ============================================================================
+// BERT Commands
+// ============================================================================
+
+void CommandParser::handleUARTBert(const String& cmd, ICommandResponse* response, uint8_t port) {
+    // UART1|UART2 BERT <baud> <seconds> [PRBS7|PRBS15|PRBS31] [LOOPBACK] or ... BERT STOP
+    // "UARTn BERT " is exactly 11 characters, parameters start at position 11
+    String params = cmd.substring(11);
+    params.trim();
+
+    auto& bert = peripheralManager.getBert();
+    UARTBert::Port bertPort = port == 1 ? UARTBert::PORT_UART1 : UARTBert::PORT_UART2;
+
+    if (params == "STOP") {
+        if (!bert.isRunning() || bert.getPort() != bertPort) {
+            response->printf("No BERT running on %s\n", UARTBert::getPortName(bertPort));
+            return;
+        }
+        bert.stop();
+        response->println("BERT stopping");
+        return;
+    }
+
+    uint32_t baud = 0;
+    uint32_t seconds = 0;
+    UARTBert::Pattern pattern = UARTBert::PRBS_15;
+    bool loopback = false;
+    bool valid = true;
+    int index = 0;
+
+    while (params.length() > 0 && valid) {
+        int space = params.indexOf(' ');
+        String token = space == -1 ? params : params.substring(0, space);
+        params = space == -1 ? "" : params.substring(space + 1);
+        params.trim();
+
+        if (index == 0) {
+            baud = token.toInt();
+        } else if (index == 1) {
+            seconds = token.toInt();
+        } else if (token == "PRBS7") {
+            pattern = UARTBert::PRBS_7;
+        } else if (token == "PRBS15") {
+            pattern = UARTBert::PRBS_15;
+        } else if (token == "PRBS31") {
+            pattern = UARTBert::PRBS_31;
+        } else if (token == "LOOPBACK") {
+            loopback = true;
+        } else {
+            valid = false;
+        }
+        index++;
+    }
+
+    if (!valid || index < 2) {
+        response->printf("Usage: %s BERT <baud> <seconds> [PRBS7|PRBS15|PRBS31] [LOOPBACK]\n",
+                         UARTBert::getPortName(bertPort));
+        return;
+    }
+    if (baud < 2400 || baud > 1500000) {
+        response->println("ERROR: Baud rate must be 2400-1500000");
+        return;
+    }
+    if (seconds < 1 || seconds > UARTBert::MAX_SECONDS) {
+        response->printf("ERROR: Duration must be 1-%u s\n", UARTBert::MAX_SECONDS);
+        return;
+    }
+    if (bert.isRunning()) {
+        response->printf("ERROR: BERT already running on %s (use %s BERT STOP)\n",
+                         UARTBert::getPortName(bert.getPort()), UARTBert::getPortName(bert.getPort()));
+        return;
+    }
+    if (uartBridge.isActive() && (uint8_t)uartBridge.getPort() == port) {
+        response->printf("ERROR: %s is bridged\n", UARTBert::getPortName(bertPort));
+        return;
+    }
+    if (hidChannel.isActive() && (uint8_t)hidChannel.getPort() == port) {
+        response->printf("ERROR: %s is used by the HID data channel (use HIDUART STOP)\n", UARTBert::getPortName(bertPort));
+        return;
+    }
+    auto& sniffer = peripheralManager.getSniffer();
+    if (sniffer.isRunning() && sniffer.isMonitor() && (sniffer.getPorts() & port)) {
+        response->printf("ERROR: %s is monitored by the sniffer (use SNIFF STOP)\n", UARTBert::getPortName(bertPort));
+        return;
+    }
+
+    if (bertPort == UARTBert::PORT_UART1) {
+        auto& uart1 = peripheralManager.getUART1();
+        if (uart1.getMode() != UART1Mux::MODE_UART) {
+            response->println("ERROR: UART1 is not in UART mode (use UART1 MODE UART)");
+            return;
+        }
+        if (uart1.getUARTDataBits() != UART_DATA_8_BITS) {
+            response->println("ERROR: BERT needs 8 data bits");
+            return;
+        }
+    } else {
+        auto& uart2 = peripheralManager.getUART2();
+        if (!uart2.isInitialized()) {
+            response->println("ERROR: UART2 not initialized");
+            return;
+        }
+        if (peripheralManager.getPacketLink().isRunning()) {
+            response->println("ERROR: UART2 packet link is running (use PKT STOP)");
+            return;
+        }
+        if (uart2.getFrameMode() != UART2Manager::FRAME_OFF) {
+            response->println("ERROR: UART2 frame receiver is running (use UART2 FRAME OFF)");
+            return;
+        }
+        if (uart2.getDataBits() != UART_DATA_8_BITS) {
+            response->println("ERROR: BERT needs 8 data bits");
+            return;
+        }
+    }
+
+    if (!bert.start(bertPort, baud, seconds, pattern, loopback)) {
+        response->printf("ERROR: Failed to start BERT%s%s\n",
+                         strlen(bert.getMessage()) > 0 ? ": " : "", bert.getMessage());
+        return;
+    }
+
+    response->printf("BERT started on %s: %u baud, %u s, %s, %s\n",
+                     UARTBert::getPortName(bertPort), baud, seconds, UARTBert::getPatternName(pattern),
+                     loopback ? "internal loopback" : "external (jumper / peer)");
+    response->printf("Use %s BERT STATUS for results\n", UARTBert::getPortName(bertPort));
+}
+
+void CommandParser::handleUARTBertStatus(ICommandResponse* response) {
+    auto& bert = peripheralManager.getBert();
+    if (bert.getState() == UARTBert::STATE_IDLE) {
+        response->println("No BERT run yet");
+        return;
+    }
+
+    UARTBert::Result result = bert.getResult();
+    float seconds = result.elapsedMs / 1000.0f;
+    float kBps = seconds > 0 ? result.rxBytes / 1024.0f / seconds : 0;
+    float lineUse = seconds > 0 ? result.rxBytes * bert.getBitsPerChar() * 100.0f / (seconds * bert.getBaudRate()) : 0;
+
+    response->printf("BERT Status: %s\n", bert.getStateName());
+    if (strlen(bert.getMessage()) > 0) {
+        response->printf("  Message: %s\n", bert.getMessage());
+    }
+    response->printf("  Port: %s, %u baud, %s, %s\n",
+                     UARTBert::getPortName(bert.getPort()), bert.getBaudRate(),
+                     UARTBert::getPatternName(bert.getPattern()),
+                     bert.isInternalLoopback() ? "internal loopback" : "external");
+    response->printf("  Elapsed: %.1f / %u s\n", seconds, bert.getSeconds());
+    response->printf("  TX: %llu bytes, RX: %llu bytes\n",
+                     (unsigned long long)result.txBytes, (unsigned long long)result.rxBytes);
+    response->printf("  Throughput: %.1f kB/s (%.1f%% of line rate)\n", kBps, lineUse);
+    response->printf("  Sync: %s, losses: %u\n", result.synced ? "locked" : "searching", result.syncLosses);
+    response->printf("  Checked: %llu bits, Bit errors: %llu\n",
+                     (unsigned long long)result.checkedBits, (unsigned long long)result.bitErrors);
+    if (result.checkedBits == 0) {
+        response->println("  BER: n/a");
+    } else if (result.bitErrors == 0) {
+        response->printf("  BER: < %.2e\n", 1.0 / result.checkedBits);
+    } else {
+        response->printf("  BER: %.2e\n", (double)result.bitErrors / result.checkedBits);
+    }
+    response->printf("  Longest error burst: %u bits\n", result.longestBurstBits);
+    response->printf("  Frame errors: %u, Parity errors: %u, FIFO overflows: %u\n",
+                     result.frameErrors, result.parityErrors, result.fifoOverflows);
+}
+
+// ============================================================================
+// TX Benchmark Commands
+// ============================================================================
+
+// One port's TX calls, so the benchmark loop does not care which UART it drives
+struct TxBenchPort {
+    UART1Mux* uart1;
+    UART2Manager* uart2;
+
+    int write(const uint8_t* data, size_t len, uint32_t timeoutMs) {
+        return uart1 ? uart1->write(data, len, timeoutMs) : uart2->write(data, len, timeoutMs);
+    }
+    int writeCombined(const uint8_t* data, size_t len) {
+        return uart1 ? uart1->writeCombined(data, len) : uart2->writeCombined(data, len);
+    }
+    uint32_t getTxFence() {
+        return uart1 ? uart1->getTxFence() : uart2->getTxFence();
+    }
+    bool waitTxFence(uint32_t fence, uint32_t timeoutMs) {
+        return uart1 ? uart1->waitTxFence(fence, timeoutMs) : uart2->waitTxFence(fence, timeoutMs);
+    }
+};
+
+struct TxBenchResult {
+    uint32_t callAvgUs;         // Time the writing task spent inside write()
+    uint32_t callMaxUs;
+    uint32_t doneUs;            // First write to last byte sent
+    bool completed;
+};
+
+enum TxBenchMode : uint8_t {
+    TX_BENCH_SYNC = 0,          // write() waiting for each chunk to be sent (the old default)
+    TX_BENCH_ASYNC,             // write() into the TX ring, one fence at the end
+    TX_BENCH_COMBINED           // writeCombined(), one fence at the end
+};
+
+static TxBenchResult runTxBench(TxBenchPort& port, TxBenchMode mode, const uint8_t* data,
+                                size_t chunk, size_t total, uint32_t timeoutMs) {
+    TxBenchResult result = {};
+    uint64_t callTotalUs = 0;
+    uint32_t calls = 0;
+    bool ok = true;
+
+    int64_t start = esp_timer_get_time();
+    for (size_t sent = 0; sent < total && ok; sent += chunk) {
+        int64_t callStart = esp_timer_get_time();
+        int written = mode == TX_BENCH_COMBINED ? port.writeCombined(data, chunk)
+                                                : port.write(data, chunk, mode == TX_BENCH_SYNC ? timeoutMs : 0);
+        uint32_t callUs = (uint32_t)(esp_timer_get_time() - callStart);
+        ok = written == (int)chunk;
+        callTotalUs += callUs;
+        calls++;
+        if (callUs > result.callMaxUs) {
+            result.callMaxUs = callUs;
+        }
+    }
+    result.completed = ok && port.waitTxFence(port.getTxFence(), timeoutMs);
+    result.doneUs = (uint32_t)(esp_timer_get_time() - start);
+    result.callAvgUs = calls > 0 ? (uint32_t)(callTotalUs / calls) : 0;
+    return result;
+}
+
+void CommandParser::handleUARTTxBench(const String& cmd, ICommandResponse* response, uint8_t port) {
+    // UART1|UART2 TXBENCH [chunk]
+    // "UARTn TXBENCH" is exactly 13 characters, chunk starts at position 13
+    String value = cmd.substring(13);
+    value.trim();
+    long chunk = value.length() > 0 ? value.toInt() : 64;
+    const char* name = port == 1 ? "UART1" : "UART2";
+    if (chunk < 1 || chunk > 1024) {
+        response->printf("Usage: %s TXBENCH [chunk 1-1024]\n", name);
+        return;
+    }
+
+    auto& uart1 = peripheralManager.getUART1();
+    auto& uart2 = peripheralManager.getUART2();
+    auto& bert = peripheralManager.getBert();
+    if (bert.isRunning() && (uint8_t)bert.getPort() == port) {
+        response->printf("ERROR: %s BERT is running (use %s BERT STOP)\n", name, name);
+        return;
+    }
+    if (hidChannel.isActive() && (uint8_t)hidChannel.getPort() == port) {
+        response->printf("ERROR: %s is used by the HID data channel (use HIDUART STOP)\n", name);
+        return;
+    }
+
+    TxBenchPort bench = {};
+    uint32_t savedBaud;
+    float bitsPerChar;
+    if (port == 1) {
+        if (uart1.getMode() != UART1Mux::MODE_UART) {
+            response->println("ERROR: UART1 is not in UART mode (use UART1 MODE UART)");
+            return;
+        }
+        bench.uart1 = &uart1;
+        savedBaud = uart1.getUARTBaudRate();
+        bitsPerChar = 1 + (uart1.getUARTDataBits() + 5) + (uart1.getUARTParity() != UART_PARITY_DISABLE ? 1 : 0) +
+                      (uart1.getUARTStopBits() == UART_STOP_BITS_2 ? 2.0f :
+                       uart1.getUARTStopBits() == UART_STOP_BITS_1_5 ? 1.5f : 1.0f);
+    } else {
+        if (!uart2.isInitialized()) {
+            response->println("ERROR: UART2 not initialized");
+            return;
+        }
+        if (peripheralManager.getModbus().isRunning()) {
+            response->println("ERROR: Modbus server is running on UART2 (use MODBUS STOP)");
+            return;
+        }
+        if (peripheralManager.getPacketLink().isRunning()) {
+            response->println("ERROR: UART2 packet link is running (use PKT STOP)");
+            return;
+        }
+        bench.uart2 = &uart2;
+        savedBaud = uart2.getBaudRate();
+        bitsPerChar = 1 + (uart2.getDataBits() + 5) + (uart2.getParity() != UART_PARITY_DISABLE ? 1 : 0) +
+                      (uart2.getStopBits() == UART_STOP_BITS_2 ? 2.0f :
+                       uart2.getStopBits() == UART_STOP_BITS_1_5 ? 1.5f : 1.0f);
+    }
+
+    uint8_t* data = static_cast<uint8_t*>(malloc(chunk));
+    if (!data) {
+        response->println("ERROR: Out of memory");
+        return;
+    }
+    for (long i = 0; i < chunk; i++) {
+        data[i] = 'A' + (i % 26);
+    }
+
+    static const uint32_t BAUD_RATES[] = { 9600, 115200, 921600 };
+    static const uint32_t LINE_TIME_MS = 200;       // Per mode and baud rate
+    static const char* MODE_NAMES[] = { "SYNC", "ASYNC", "COMBINED" };
+
+    response->printf("%s TX Benchmark (%ld-byte writes, %u ms of line time each):\n", name, chunk, LINE_TIME_MS);
+    response->println("  Baud     Mode      call avg/max (us)   done (ms)   kB/s  line %");
+
+    bool ok = true;
+    for (uint32_t baud : BAUD_RATES) {
+        bool configured = port == 1 ?
+            uart1.reconfigureUART(baud, uart1.getUARTStopBits(), uart1.getUARTParity(), uart1.getUARTDataBits()) :
+            uart2.reconfigure(baud, uart2.getStopBits(), uart2.getParity(), uart2.getDataBits());
+        if (!configured) {
+            response->printf("ERROR: Failed to set %u baud\n", baud);
+            ok = false;
+            break;
+        }
+
+        size_t chunks = (size_t)(baud / bitsPerChar * LINE_TIME_MS / 1000) / chunk;
+        size_t total = (chunks > 0 ? chunks : 1) * chunk;
+        uint32_t timeoutMs = (uint32_t)(total * bitsPerChar * 1000 / baud) + 1000;
+
+        for (uint8_t mode = TX_BENCH_SYNC; mode <= TX_BENCH_COMBINED; mode++) {
+            TxBenchResult result = runTxBench(bench, (TxBenchMode)mode, data, chunk, total, timeoutMs);
+            if (!result.completed) {
+                response->printf("  %-8u %-9s did not complete\n", baud, MODE_NAMES[mode]);
+                continue;
+            }
+            float seconds = result.doneUs / 1000000.0f;
+            float kBps = seconds > 0 ? total / 1024.0f / seconds : 0;
+            float lineUse = seconds > 0 ? total * bitsPerChar * 100.0f / (seconds * baud) : 0;
+            response->printf("  %-8u %-9s %8u / %-8u %9.1f %7.1f %6.1f\n", baud, MODE_NAMES[mode],
+                             result.callAvgUs, result.callMaxUs, result.doneUs / 1000.0f, kBps, lineUse);
+        }
+    }
+
+    free(data);
+    if (port == 1) {
+        uart1.reconfigureUART(savedBaud, uart1.getUARTStopBits(), uart1.getUARTParity(), uart1.getUARTDataBits());
+    } else {
+        uart2.reconfigure(savedBaud, uart2.getStopBits(), uart2.getParity(), uart2.getDataBits());
+    }
+    response->printf("  Baud restored: %u%s\n", savedBaud, ok ? "" : " (aborted)");
+}
+
+// ============================================================================
+// Packet Commands
+// ============================================================================
+
+static bool parseHex(const String& hex, uint8_t* out, size_t maxLen, size_t& length) {
+    if (hex.length() % 2 != 0 || hex.length() / 2 > maxLen) {
+        return false;
+    }
+    for (size_t i = 0; i < hex.length(); i += 2) {
+        char pair[3] = {hex[i], hex[i + 1], '\0'};
+        char* end = nullptr;
+        long value = strtol(pair, &end, 16);
+        if (*end != '\0' || !isxdigit((unsigned char)pair[0])) {
+            return false;
+        }
+        out[i / 2] = (uint8_t)value;
+    }
+    length = hex.length() / 2;
+    return true;
+}
+
+static void printPacket(ICommandResponse* response, const PacketLink::Packet& packet) {
+    static const char HEX_DIGITS[] = "0123456789ABCDEF";
+    static char line[48 + 2 * PacketLink::MAX_PAYLOAD];
+
+    int pos = snprintf(line, sizeof(line), "PKT RX seq=%u len=%u data=",
+                       packet.seq, (unsigned)packet.length);
+    for (size_t i = 0; i < packet.length && pos + 3 < (int)sizeof(line); i++) {
+        line[pos++] = HEX_DIGITS[packet.data[i] >> 4];
+        line[pos++] = HEX_DIGITS[packet.data[i] & 0x0F];
+    }
+    line[pos] = '\0';
+    response->println(line);
+}
+
+void CommandParser::handlePacketStart(const String& cmd, ICommandResponse* response) {
+    // PKT START [COBS|SLIP] [CRC16|CRC32] [WINDOW n] [TIMEOUT ms] [RETRIES n]
+    String params = cmd.substring(9);   // Remove "PKT START"
+    params.trim();
+
+    PacketLink::Framing framing = PacketLink::FRAMING_COBS;
+    PacketLink::CrcType crc = PacketLink::CRC_16;
+    long window = 0;
+    long timeoutMs = PacketLink::DEFAULT_ACK_TIMEOUT_MS;
+    long retries = PacketLink::DEFAULT_RETRIES;
+
+    while (params.length() > 0) {
+        int space = params.indexOf(' ');
+        String token = space == -1 ? params : params.substring(0, space);
+        params = space == -1 ? "" : params.substring(space + 1);
+        params.trim();
+
+        if (token == "COBS") {
+            framing = PacketLink::FRAMING_COBS;
+        } else if (token == "SLIP") {
+            framing = PacketLink::FRAMING_SLIP;
+        } else if (token == "CRC16") {
+            crc = PacketLink::CRC_16;
+        } else if (token == "CRC32") {
+            crc = PacketLink::CRC_32;
+        } else if (token == "WINDOW" || token == "TIMEOUT" || token == "RETRIES") {
+            space = params.indexOf(' ');
+            String value = space == -1 ? params : params.substring(0, space);
+            params = space == -1 ? "" : params.substring(space + 1);
+            params.trim();
+            if (value.length() == 0) {
+                response->printf("ERROR: %s needs a value\n", token.c_str());
+                return;
+            }
+            long number = value.toInt();
+            if (token == "WINDOW") {
+                window = number;
+            } else if (token == "TIMEOUT") {
+                timeoutMs = number;
+            } else {
+                retries = number;
+            }
+        } else {
+            response->println("Usage: PKT START [COBS|SLIP] [CRC16|CRC32] [WINDOW n] [TIMEOUT ms] [RETRIES n]");
+            return;
+        }
+    }
+
+    if (window < 0 || window > PacketLink::MAX_WINDOW) {
+        response->printf("ERROR: Window must be 0-%u (0 = no ACK)\n", PacketLink::MAX_WINDOW);
+        return;
+    }
+    if (timeoutMs < 5 || timeoutMs > 10000) {
+        response->println("ERROR: ACK timeout must be 5-10000 ms");
+        return;
+    }
+    if (retries < 0 || retries > 10) {
+        response->println("ERROR: Retries must be 0-10");
+        return;
+    }
+
+    if (uartBridge.isActive() && uartBridge.getPort() == UARTBridge::PORT_UART2) {
+        response->println("ERROR: UART2 is bridged");
+        return;
+    }
+    if (hidChannel.isActive() && hidChannel.getPort() == HIDDataChannel::PORT_UART2) {
+        response->println("ERROR: UART2 is used by the HID data channel (use HIDUART STOP)");
+        return;
+    }
+    if (peripheralManager.getBert().isRunning() && peripheralManager.getBert().getPort() == UARTBert::PORT_UART2) {
+        response->println("ERROR: UART2 BERT is running (use UART2 BERT STOP)");
+        return;
+    }
+    if (peripheralManager.getModbus().isRunning()) {
+        response->println("ERROR: Modbus server is running on UART2 (use MODBUS STOP)");
+        return;
+    }
+
+    auto& link = peripheralManager.getPacketLink();
+    if (!link.begin(framing, crc, (uint8_t)window, (uint16_t)timeoutMs, (uint8_t)retries)) {
+        response->println("ERROR: Failed to start packet link");
+        return;
+    }
+
+    response->printf("Packet link started: %s, %s, ", PacketLink::getFramingName(framing), PacketLink::getCrcName(crc));
+    if (window > 0) {
+        response->printf("window %ld, ACK timeout %ld ms, %ld retries\n", window, timeoutMs, retries);
+    } else {
+        response->println("no ACK");
+    }
+}
+
+void CommandParser::handlePacketStop(ICommandResponse* response) {
+    peripheralManager.getPacketLink().end();
+    response->println("Packet link stopped");
+}
+
+void CommandParser::handlePacketSend(const String& cmd, ICommandResponse* response, bool exchange) {
+    // PKT SEND <hex> or PKT XFER <hex> [timeout_ms]
+    // Both prefixes are exactly 9 characters, data starts at position 9
+    String params = cmd.substring(9);
+    params.trim();
+
+    uint32_t replyTimeoutMs = 1000;
+    int space = params.indexOf(' ');
+    if (space != -1) {
+        if (!exchange) {
+            response->println("Usage: PKT SEND <hex>");
+            return;
+        }
+        String timeoutStr = params.substring(space + 1);
+        timeoutStr.trim();
+        long value = timeoutStr.toInt();
+        if (value < 1 || value > 60000) {
+            response->println("ERROR: Timeout must be 1-60000 ms");
+            return;
+        }
+        replyTimeoutMs = value;
+        params = params.substring(0, space);
+    }
+
+    static uint8_t payload[PacketLink::MAX_PAYLOAD];
+    size_t length = 0;
+    if (!parseHex(params, payload, sizeof(payload), length)) {
+        response->printf("ERROR: Payload must be hex, up to %u bytes\n", (unsigned)PacketLink::MAX_PAYLOAD);
+        return;
+    }
+
+    auto& link = peripheralManager.getPacketLink();
+    if (!link.isRunning()) {
+        response->println("ERROR: Packet link not started (use PKT START)");
+        return;
+    }
+    if (exchange && link.isStreaming()) {
+        response->println("ERROR: Replies are streamed (use PKT STREAM OFF)");
+        return;
+    }
+
+    // The reply must be the first packet after ours
+    PacketLink::Packet packet;
+    while (exchange && link.receive(packet, 0)) {
+        link.release(packet);
+    }
+
+    if (!link.send(payload, length, 1000)) {
+        response->println("ERROR: Send failed (window full or UART2 write error)");
+        return;
+    }
+
+    if (!exchange) {
+        response->printf("Sent %u bytes\n", (unsigned)length);
+        return;
+    }
+
+    if (!link.receive(packet, replyTimeoutMs)) {
+        response->println("ERROR: No reply");
+        return;
+    }
+    printPacket(response, packet);
+    link.release(packet);
+}
+
+void CommandParser::handlePacketRecv(const String& cmd, ICommandResponse* response) {
+    // PKT RECV [count]
+    int count = 10;
+    String countStr = cmd.substring(8);     // Remove "PKT RECV"
+    countStr.trim();
+    if (countStr.length() > 0) {
+        count = countStr.toInt();
+        if (count < 1 || count > 100) {
+            response->println("ERROR: Count must be 1-100");
+            return;
+        }
+    }
+
+    auto& link = peripheralManager.getPacketLink();
+    int shown = 0;
+    PacketLink::Packet packet;
+    while (shown < count && link.receive(packet, 0)) {
+        printPacket(response, packet);
+        link.release(packet);
+        shown++;
+    }
+
+    if (shown == 0) {
+        response->println("No packets");
+    }
+}
+
+void CommandParser::handlePacketStream(const String& cmd, ICommandResponse* response) {
+    // PKT STREAM <ON|OFF>
+    String param = cmd.substring(11);   // Remove "PKT STREAM "
+    param.trim();
+
+    auto& link = peripheralManager.getPacketLink();
+    if (param == "ON") {
+        link.setStreaming(true);
+        response->println("Packet streaming ON (EVENT PKT seq=<n> len=<n> data=<hex>)");
+    } else if (param == "OFF") {
+        link.setStreaming(false);
+        response->println("Packet streaming OFF");
+    } else {
+        response->println("Usage: PKT STREAM <ON|OFF>");
+    }
+}
+
+void CommandParser::handlePacketStatus(ICommandResponse* response) {
+    auto& link = peripheralManager.getPacketLink();
+    PacketLink::Statistics stats = link.getStatistics();
+
+    response->println("Packet Link Status:");
+    if (link.isRunning()) {
+        response->printf("  Running: %s, %s\n",
+                         PacketLink::getFramingName(link.getFraming()), PacketLink::getCrcName(link.getCrcType()));
+        if (link.getWindow() > 0) {
+            response->printf("  Window: %u (%u in flight), ACK timeout %u ms, %u retries\n",
+                             link.getWindow(), link.getInFlight(), link.getAckTimeoutMs(), link.getRetries());
+        } else {
+            response->println("  ACK: off");
+        }
+    } else if (strlen(link.getMessage()) > 0) {
+        response->printf("  Stopped: %s\n", link.getMessage());
+    } else {
+        response->println("  Stopped");
+    }
+    response->printf("  Streaming: %s\n", link.isStreaming() ? "ON" : "OFF");
+    response->printf("  TX: %u packets (%u bytes), RX: %u packets (%u bytes)\n",
+                     stats.txPackets, stats.txBytes, stats.rxPackets, stats.rxBytes);
+    response->printf("  Framing errors: %u, CRC errors: %u\n", stats.framingErrors, stats.crcErrors);
+    response->printf("  Retransmits: %u, ACK failures: %u, Duplicates: %u\n",
+                     stats.retransmits, stats.ackFailures, stats.duplicates);
+    response->printf("  ACKs sent/received: %u/%u, RX dropped: %u\n",
+                     stats.acksSent, stats.acksReceived, stats.rxDropped);
+}
+
+// ============================================================================
+// Modbus Commands
+// ============================================================================
+
+void CommandParser::handleModbusStart(const String& cmd, ICommandResponse* response) {
+    // MODBUS START <unit> [baud] [8N1|8E1|8O1|8N2]
+    String params = cmd.substring(13);  // Remove "MODBUS START "
+    params.trim();
+
+    long unit = -1;
+    uint32_t baud = peripheralManager.getUART2().getBaudRate();
+    uart_parity_t parity = UART_PARITY_EVEN;    // Modbus RTU default: 8E1
+    uart_stop_bits_t stopBits = UART_STOP_BITS_1;
+    bool valid = true;
+    int index = 0;
+
+    while (params.length() > 0 && valid) {
+        int space = params.indexOf(' ');
+        String token = space == -1 ? params : params.substring(0, space);
+        params = space == -1 ? "" : params.substring(space + 1);
+        params.trim();
+
+        if (index == 0) {
+            unit = token.toInt();
+        } else if (token == "8N1") {
+            parity = UART_PARITY_DISABLE;
+            stopBits = UART_STOP_BITS_1;
+        } else if (token == "8E1") {
+            parity = UART_PARITY_EVEN;
+            stopBits = UART_STOP_BITS_1;
+        } else if (token == "8O1") {
+            parity = UART_PARITY_ODD;
+            stopBits = UART_STOP_BITS_1;
+        } else if (token == "8N2") {
+            parity = UART_PARITY_DISABLE;
+            stopBits = UART_STOP_BITS_2;
+        } else if (index == 1 && token.toInt() > 0) {
+            baud = token.toInt();
+        } else {
+            valid = false;
+        }
+        index++;
+    }
+
+    if (!valid || index == 0) {
+        response->println("Usage: MODBUS START <unit> [baud] [8N1|8E1|8O1|8N2]");
+        return;
+    }
+    if (unit < 1 || unit > ModbusServer::MAX_UNIT) {
+        response->printf("ERROR: Unit must be 1-%u\n", ModbusServer::MAX_UNIT);
+        return;
+    }
+    if (baud < 2400 || baud > 1500000) {
+        response->println("ERROR: Baud rate must be 2400-1500000");
+        return;
+    }
+
+    if (uartBridge.isActive() && uartBridge.getPort() == UARTBridge::PORT_UART2) {
+        response->println("ERROR: UART2 is bridged");
+        return;
+    }
+    if (hidChannel.isActive() && hidChannel.getPort() == HIDDataChannel::PORT_UART2) {
+        response->println("ERROR: UART2 is used by the HID data channel (use HIDUART STOP)");
+        return;
+    }
+    if (peripheralManager.getPacketLink().isRunning()) {
+        response->println("ERROR: UART2 packet link is running (use PKT STOP)");
+        return;
+    }
+    if (peripheralManager.getBert().isRunning() && peripheralManager.getBert().getPort() == UARTBert::PORT_UART2) {
+        response->println("ERROR: UART2 BERT is running (use UART2 BERT STOP)");
+        return;
+    }
+
+    auto& modbus = peripheralManager.getModbus();
+    if (!modbus.begin((uint8_t)unit, baud, parity, stopBits)) {
+        response->println("ERROR: Failed to start Modbus server");
+        return;
+    }
+
+    response->printf("Modbus RTU server started: unit %ld, %u baud, 8%c%c, t3.5 = %u characters\n",
+                     unit, baud,
+                     parity == UART_PARITY_EVEN ? 'E' : parity == UART_PARITY_ODD ? 'O' : 'N',
+                     stopBits == UART_STOP_BITS_2 ? '2' : '1', modbus.getIdleCharacters());
+}
+
+void CommandParser::handleModbusStop(ICommandResponse* response) {
+    peripheralManager.getModbus().end();
+    response->println("Modbus server stopped");
+}
+
+void CommandParser::handleModbusStatus(ICommandResponse* response) {
+    auto& modbus = peripheralManager.getModbus();
+    ModbusServer::Statistics stats = modbus.getStatistics();
+
+    response->println("Modbus Server Status:");
+    if (modbus.isRunning()) {
+        response->printf("  Running: unit %u, %u baud, t3.5 = %u characters\n",
+                         modbus.getUnit(), peripheralManager.getUART2().getBaudRate(), modbus.getIdleCharacters());
+    } else if (strlen(modbus.getMessage()) > 0) {
+        response->printf("  Stopped: %s\n", modbus.getMessage());
+    } else {
+        response->println("  Stopped");
+    }
+    response->printf("  Requests: %u (broadcast %u), Exceptions: %u\n",
+                     stats.requests, stats.broadcasts, stats.exceptions);
+    response->printf("  CRC errors: %u, Frame errors: %u, Other units: %u\n",
+                     stats.crcErrors, stats.frameErrors, stats.otherUnits);
+    if (stats.replies > 0) {
+        response->printf("  Turnaround: last %u us, min %u us, avg %u us, max %u us\n",
+                         stats.turnaroundLastUs, stats.turnaroundMinUs,
+                         (uint32_t)(stats.turnaroundTotalUs / stats.replies), stats.turnaroundMaxUs);
+    } else {
+        response->println("  Turnaround: no replies yet");
+    }
+}
+
+// ============================================================================
+// Sniffer Commands
+// ============================================================================
+
+void CommandParser::handleSnifferStart(const String& cmd, ICommandResponse* response) {
+    // SNIFF START <UART1|UART2|ALL> [MONITOR]
+    String params = cmd.substring(12);  // Remove "SNIFF START "
+    params.trim();
+
+    bool monitor = false;
+    if (params.endsWith(" MONITOR")) {
+        monitor = true;
+        params = params.substring(0, params.length() - 8);
+        params.trim();
+    }
+
+    uint8_t ports;
+    if (params == "UART1") {
+        ports = UARTSniffer::PORT_UART1;
+    } else if (params == "UART2") {
+        ports = UARTSniffer::PORT_UART2;
+    } else if (params == "ALL") {
+        ports = UARTSniffer::PORT_BOTH;
+    } else {
+        response->println("Usage: SNIFF START <UART1|UART2|ALL> [MONITOR]");
+        return;
+    }
+
+    auto& sniffer = peripheralManager.getSniffer();
+    if (sniffer.isRunning()) {
+        response->println("ERROR: Sniffer already running (use SNIFF STOP)");
+        return;
+    }
+
+    // MONITOR reads RX itself: the port must not have another reader
+    if (monitor) {
+        auto& bert = peripheralManager.getBert();
+        for (uint8_t port = 1; port <= 2; port++) {
+            const char* name = port == 1 ? "UART1" : "UART2";
+            if (!(ports & port)) {
+                continue;
+            }
+            if (uartBridge.isActive() && (uint8_t)uartBridge.getPort() == port) {
+                response->printf("ERROR: %s is bridged\n", name);
+                return;
+            }
+            if (hidChannel.isActive() && (uint8_t)hidChannel.getPort() == port) {
+                response->printf("ERROR: %s is used by the HID data channel (use HIDUART STOP)\n", name);
+                return;
+            }
+            if (bert.isRunning() && (uint8_t)bert.getPort() == port) {
+                response->printf("ERROR: %s BERT is running (use %s BERT STOP)\n", name, name);
+                return;
             }
         }
-    } else {
-        response->println("ERROR: Failed to set UART1 PWM parameters");
     }
-}
-
-void CommandParser::handleUART1Status(ICommandResponse* response) {
-    auto& uart1 = peripheralManager.getUART1();
 
-    response->println("UART1 Status:");
-    response->printf("  Mode: %s\n", uart1.getModeName());
+    if (!sniffer.start(ports, monitor)) {
+        response->println("ERROR: Failed to start sniffer");
+        return;
+    }
 
-    if (uart1.getMode() == UART1Mux::MODE_UART) {
-        response->printf("  Baud: %u\n", uart1.getUARTBaudRate());
-        uint32_t tx, rx, err;
-        uart1.getUARTStatistics(&tx, &rx, &err);
-        response->printf("  TX: %u bytes, RX: %u bytes, Errors: %u\n", tx, rx, err);
-    } else if (uart1.getMode() == UART1Mux::MODE_PWM_RPM) {
-        response->printf("  PWM Frequency: %u Hz\n", uart1.getPWMFrequency());
-        response->printf("  PWM Duty: %.1f%%\n", uart1.getPWMDuty());
-        response->printf("  PWM Enabled: %s\n", uart1.isPWMEnabled() ? "Yes" : "No");
-        response->printf("  RPM Frequency: %.1f Hz\n", uart1.getRPMFrequency());
-        response->printf("  RPM Signal: %s\n", uart1.hasRPMSignal() ? "Present" : "None");
+    response->printf("Sniffer started on %s%s, %u KB ring in %s\n",
+                     UARTSniffer::getPortsName(ports), monitor ? " (monitor)" : "",
+                     (unsigned)(sniffer.getCapacity() / 1024), sniffer.isInPSRAM() ? "PSRAM" : "internal RAM");
+    if (monitor && (ports & UARTSniffer::PORT_UART2) &&
+        peripheralManager.getUART2().getFrameMode() != UART2Manager::FRAME_OFF) {
+        response->println("Note: UART2 RX is captured from the frame receiver");
     }
+    response->println("Download: /api/uart/capture (binary) or /api/uart/capture?format=pcap");
 }
 
-void CommandParser::handleUART1Write(const String& cmd, ICommandResponse* response) {
-    // UART1 WRITE <text>
-    // "UART1 WRITE " is exactly 12 characters, text starts at position 12
-    String text = cmd.substring(12);
-    text.trim();
+void CommandParser::handleSnifferStop(ICommandResponse* response) {
+    auto& sniffer = peripheralManager.getSniffer();
+    sniffer.stop();
+    response->printf("Sniffer stopped, %u records kept\n", (unsigned)sniffer.getStatistics().records);
+}
 
-    if (text.length() == 0) {
-        response->println("Usage: UART1 WRITE <text>");
+void CommandParser::handleSnifferStatus(ICommandResponse* response) {
+    auto& sniffer = peripheralManager.getSniffer();
+    UARTSniffer::Statistics stats = sniffer.getStatistics();
+
+    response->println("Sniffer Status:");
+    if (sniffer.isRunning()) {
+        response->printf("  Running: %s%s, %.1f s\n", UARTSniffer::getPortsName(sniffer.getPorts()),
+                         sniffer.isMonitor() ? " (monitor)" : "", sniffer.getElapsedMs() / 1000.0f);
+    } else {
+        response->println("  Stopped");
+    }
+    if (sniffer.getCapacity() == 0) {
         return;
     }
+    response->printf("  Ring: %u / %u KB (%s)\n", (unsigned)(sniffer.getUsed() / 1024),
+                     (unsigned)(sniffer.getCapacity() / 1024), sniffer.isInPSRAM() ? "PSRAM" : "internal RAM");
+    response->printf("  Records: %u, Overwritten: %u, Lock misses: %u\n",
+                     stats.records, stats.overwritten, stats.lockMisses);
+    response->printf("  UART1 TX: %llu bytes, RX: %llu bytes\n",
+                     (unsigned long long)stats.txBytes[0], (unsigned long long)stats.rxBytes[0]);
+    response->printf("  UART2 TX: %llu bytes, RX: %llu bytes\n",
+                     (unsigned long long)stats.txBytes[1], (unsigned long long)stats.rxBytes[1]);
+    response->printf("  Live tail: %s\n", sniffer.isLiveTail() ? "ON" : "OFF");
+}
 
-    text += "\n";  // Add newline
-
-    int written = peripheralManager.getUART1().write(text.c_str());
-    if (written > 0) {
-        response->printf("Wrote %d bytes to UART1\n", written);
+void CommandParser::handleSnifferTail(const String& cmd, ICommandResponse* response) {
+    // SNIFF TAIL <ON|OFF>
+    String state = cmd.substring(11);  // Remove "SNIFF TAIL "
+    state.trim();
+
+    auto& sniffer = peripheralManager.getSniffer();
+    if (state == "ON") {
+        sniffer.setLiveTail(true);
+        response->println("Sniffer live tail ON (WebSocket \"uart\" messages)");
+    } else if (state == "OFF") {
+        sniffer.setLiveTail(false);
+        response->println("Sniffer live tail OFF");
     } else {
-        response->println("ERROR: Failed to write to UART1");
+        response->println("Usage: SNIFF TAIL <ON|OFF>");
     }
 }
 
 // ============================================================================
-// UART2 Commands
+// Bridge Commands
 // ============================================================================
 
-void CommandParser::handleUART2Config(const String& cmd, ICommandResponse* response) {
-    // UART2 CONFIG <baud>
-    // "UART2 CONFIG " is exactly 13 characters, baud starts at position 13
-    String baudStr = cmd.substring(13);
-    baudStr.trim();
+static void printBridgeStatistics(ICommandResponse* response, const UARTBridge::Statistics& stats) {
+    float seconds = stats.durationMs / 1000.0f;
+    float hostKBps = seconds > 0 ? stats.hostToUart / 1024.0f / seconds : 0;
+    float uartKBps = seconds > 0 ? stats.uartToHost / 1024.0f / seconds : 0;
+
+    response->printf("  Duration: %.1f s\n", seconds);
+    response->printf("  Host -> UART: %llu bytes (%.1f kB/s)\n",
+                     (unsigned long long)stats.hostToUart, hostKBps);
+    response->printf("  UART -> Host: %llu bytes (%.1f kB/s)\n",
+                     (unsigned long long)stats.uartToHost, uartKBps);
+    response->printf("  RX overflows: %u (>= %u bytes lost)\n", stats.rxOverflows, stats.rxDroppedBytes);
+    response->printf("  Host dropped: %u bytes\n", stats.hostDroppedBytes);
+    response->printf("  Line errors: %u, Breaks: %u\n", stats.lineErrors, stats.breaks);
+}
 
-    if (baudStr.length() == 0) {
-        response->println("Usage: UART2 CONFIG <baud>");
+void CommandParser::handleBridge(const String& cmd, ICommandResponse* response, CommandSource source) {
+    // BRIDGE <UART1|UART2>
+    // "BRIDGE " is exactly 7 characters, port starts at position 7
+    String portStr = cmd.substring(7);
+    portStr.trim();
+
+    UARTBridge::Port port;
+    if (portStr == "UART1") {
+        port = UARTBridge::PORT_UART1;
+    } else if (portStr == "UART2") {
+        port = UARTBridge::PORT_UART2;
+    } else {
+        response->println("Usage: BRIDGE <UART1|UART2>");
         return;
     }
 
-    uint32_t baud = baudStr.toInt();
+    // The bridge takes over the CDC port itself
+    if (source != CMD_SOURCE_CDC) {
+        response->println("ERROR: BRIDGE is only available on the USB CDC console");
+        return;
+    }
 
-    if (baud < 2400 || baud > 1500000) {
-        response->println("ERROR: Baud rate must be 2400-1500000");
+    auto& bert = peripheralManager.getBert();
+    if (bert.isRunning() && (uint8_t)bert.getPort() == (uint8_t)port) {
+        response->printf("ERROR: %s BERT is running\n", UARTBridge::getPortName(port));
+        return;
+    }
+    auto& sniffer = peripheralManager.getSniffer();
+    if (sniffer.isRunning() && sniffer.isMonitor() && (sniffer.getPorts() & (uint8_t)port)) {
+        response->printf("ERROR: %s is monitored by the sniffer (use SNIFF STOP)\n", UARTBridge::getPortName(port));
+        return;
+    }
+    if (hidChannel.isActive() && (uint8_t)hidChannel.getPort() == (uint8_t)port) {
+        response->printf("ERROR: %s is used by the HID data channel (use HIDUART STOP)\n", UARTBridge::getPortName(port));
         return;
     }
 
-    if (peripheralManager.getUART2().reconfigure(baud)) {
-        response->printf("UART2 configured: %u baud\n", baud);
+    auto& uart1 = peripheralManager.getUART1();
+    auto& uart2 = peripheralManager.getUART2();
+    uint32_t baud;
+    if (port == UARTBridge::PORT_UART1) {
+        if (uart1.getMode() != UART1Mux::MODE_UART) {
+            response->println("ERROR: UART1 is not in UART mode (use UART1 MODE UART)");
+            return;
+        }
+        baud = uart1.getUARTBaudRate();
     } else {
-        response->println("ERROR: Failed to configure UART2");
+        if (!uart2.isInitialized()) {
+            response->println("ERROR: UART2 not initialized");
+            return;
+        }
+        if (uart2.getFrameMode() != UART2Manager::FRAME_OFF) {
+            response->println("ERROR: UART2 frame receiver is running (use UART2 FRAME OFF)");
+            return;
+        }
+        baud = uart2.getBaudRate();
+    }
+
+    response->printf("Bridging USB CDC <-> %s at %u baud\n", UARTBridge::getPortName(port), baud);
+    response->printf("Send +++ with %u s of silence before and after to return\n",
+                     UARTBridge::ESCAPE_GUARD_MS / 1000);
+
+    if (!uartBridge.run(port, uart1, uart2)) {
+        response->println("ERROR: Failed to start bridge");
+        return;
     }
+
+    response->println("");
+    response->printf("Bridge to %s closed (%s)\n", UARTBridge::getPortName(port), uartBridge.getEndReason());
+    printBridgeStatistics(response, uartBridge.getStatistics());
 }
 
-void CommandParser::handleUART2Status(ICommandResponse* response) {
-    auto& uart2 = peripheralManager.getUART2();
+void CommandParser::handleBridgeStatus(ICommandResponse* response) {
+    UARTBridge::Statistics stats = uartBridge.getStatistics();
 
-    response->println("UART2 Status:");
-    response->printf("  Baud: %u\n", uart2.getBaudRate());
-    uint32_t tx, rx, err;
-    uart2.getStatistics(&tx, &rx, &err);
-    response->printf("  TX: %u bytes, RX: %u bytes, Errors: %u\n", tx, rx, err);
+    response->println("Bridge Status:");
+    if (uartBridge.isActive()) {
+        response->printf("  Active: %s\n", UARTBridge::getPortName(uartBridge.getPort()));
+    } else if (stats.durationMs == 0 && stats.hostToUart == 0 && stats.uartToHost == 0) {
+        response->println("  No bridge session yet");
+        return;
+    } else {
+        response->printf("  Last: %s, ended by %s\n",
+                         UARTBridge::getPortName(uartBridge.getPort()), uartBridge.getEndReason());
+    }
+    printBridgeStatistics(response, stats);
 }
 
-void CommandParser::handleUART2Write(const String& cmd, ICommandResponse* response) {
-    // UART2 WRITE <text>
-    // "UART2 WRITE " is exactly 12 characters, text starts at position 12
-    String text = cmd.substring(12);
-    text.trim();
+// ============================================================================
+// HID Data Channel Commands
+// ============================================================================
 
-    if (text.length() == 0) {
-        response->println("Usage: UART2 WRITE <text>");
+static void printHIDChannelStatistics(ICommandResponse* response, const HIDDataChannel::Statistics& stats) {
+    float seconds = stats.durationMs / 1000.0f;
+    float hostKBps = seconds > 0 ? stats.hostToUart / 1024.0f / seconds : 0;
+    float uartKBps = seconds > 0 ? stats.uartToHost / 1024.0f / seconds : 0;
+
+    response->printf("  Duration: %.1f s\n", seconds);
+    response->printf("  Host -> UART: %llu bytes in %u reports (%.1f kB/s)\n",
+                     (unsigned long long)stats.hostToUart, stats.outReports, hostKBps);
+    response->printf("  UART -> Host: %llu bytes in %u reports (%.1f kB/s)\n",
+                     (unsigned long long)stats.uartToHost, stats.inReports, uartKBps);
+    response->printf("  Credit reports: %u, IN retries: %u\n", stats.creditReports, stats.inRetries);
+    response->printf("  Sequence gaps: %u (%u reports missing)\n", stats.seqGaps, stats.missingReports);
+    response->printf("  Over credit: %u, Dropped: %u, Bad length: %u\n",
+                     stats.overCredit, stats.dropped, stats.badReports);
+}
+
+void CommandParser::handleHIDChannelStart(const String& cmd, ICommandResponse* response) {
+    // HIDUART START <UART1|UART2>
+    // "HIDUART START " is exactly 14 characters, port starts at position 14
+    String portStr = cmd.substring(14);
+    portStr.trim();
+
+    HIDDataChannel::Port port;
+    if (portStr == "UART1") {
+        port = HIDDataChannel::PORT_UART1;
+    } else if (portStr == "UART2") {
+        port = HIDDataChannel::PORT_UART2;
+    } else {
+        response->println("Usage: HIDUART START <UART1|UART2>");
         return;
     }
+    const char* name = HIDDataChannel::getPortName(port);
 
-    text += "\n";
+    if (hidChannel.isActive()) {
+        response->printf("ERROR: HID data channel already running on %s (use HIDUART STOP)\n",
+                         HIDDataChannel::getPortName(hidChannel.getPort()));
+        return;
+    }
+    if (uartBridge.isActive() && (uint8_t)uartBridge.getPort() == (uint8_t)port) {
+        response->printf("ERROR: %s is bridged\n", name);
+        return;
+    }
+    auto& bert = peripheralManager.getBert();
+    if (bert.isRunning() && (uint8_t)bert.getPort() == (uint8_t)port) {
+        response->printf("ERROR: %s BERT is running (use %s BERT STOP)\n", name, name);
+        return;
+    }
+    auto& sniffer = peripheralManager.getSniffer();
+    if (sniffer.isRunning() && sniffer.isMonitor() && (sniffer.getPorts() & (uint8_t)port)) {
+        response->printf("ERROR: %s is monitored by the sniffer (use SNIFF STOP)\n", name);
+        return;
+    }
 
-    int written = peripheralManager.getUART2().write(text.c_str());
-    if (written > 0) {
-        response->printf("Wrote %d bytes to UART2\n", written);
+    auto& uart1 = peripheralManager.getUART1();
+    auto& uart2 = peripheralManager.getUART2();
+    uint32_t baud;
+    if (port == HIDDataChannel::PORT_UART1) {
+        if (uart1.getMode() != UART1Mux::MODE_UART) {
+            response->println("ERROR: UART1 is not in UART mode (use UART1 MODE UART)");
+            return;
+        }
+        baud = uart1.getUARTBaudRate();
     } else {
-        response->println("ERROR: Failed to write to UART2");
+        if (!uart2.isInitialized()) {
+            response->println("ERROR: UART2 not initialized");
+            return;
+        }
+        if (peripheralManager.getPacketLink().isRunning()) {
+            response->println("ERROR: UART2 packet link is running (use PKT STOP)");
+            return;
+        }
+        if (peripheralManager.getModbus().isRunning()) {
+            response->println("ERROR: Modbus server is running on UART2 (use MODBUS STOP)");
+            return;
+        }
+        if (uart2.getFrameMode() != UART2Manager::FRAME_OFF) {
+            response->println("ERROR: UART2 frame receiver is running (use UART2 FRAME OFF)");
+            return;
+        }
+        baud = uart2.getBaudRate();
+    }
+
+    if (!hidChannel.start(port, uart1, uart2, hidSendMutex)) {
+        response->println("ERROR: Failed to start HID data channel");
+        return;
+    }
+
+    response->printf("HID data channel: 0xA0 reports <-> %s at %u baud\n", name, baud);
+    response->printf("Report: [0xA0][len 0-%u][seq][credit][data], window %u reports\n",
+                     HIDDataChannel::MAX_PAYLOAD, HIDDataChannel::WINDOW);
+}
+
+void CommandParser::handleHIDChannelStop(ICommandResponse* response) {
+    if (!hidChannel.isActive()) {
+        response->println("HID data channel is not running");
+        return;
+    }
+
+    hidChannel.stop();
+    response->printf("HID data channel to %s stopped\n", HIDDataChannel::getPortName(hidChannel.getPort()));
+    printHIDChannelStatistics(response, hidChannel.getStatistics());
+}
+
+void CommandParser::handleHIDChannelStatus(ICommandResponse* response) {
+    HIDDataChannel::Statistics stats = hidChannel.getStatistics();
+
+    response->println("HID Data Channel Status:");
+    if (hidChannel.isActive()) {
+        response->printf("  Active: %s\n", HIDDataChannel::getPortName(hidChannel.getPort()));
+    } else if (stats.durationMs == 0 && stats.outReports == 0 && stats.inReports == 0) {
+        response->println("  No channel session yet");
+        return;
+    } else if (hidChannel.getMessage()[0] != '\0') {
+        response->printf("  Last: %s, stopped: %s\n",
+                         HIDDataChannel::getPortName(hidChannel.getPort()), hidChannel.getMessage());
+    } else {
+        response->printf("  Last: %s\n", HIDDataChannel::getPortName(hidChannel.getPort()));
     }
+    printHIDChannelStatistics(response, stats);
 }
 
 // ============================================================================
@@ -484,6 +1761,188 @@ void CommandParser::handleGPIOControl(const String& cmd, ICommandResponse* respo
     }
 }
 
+// ============================================================================
+// Pattern Generator Commands
+// ============================================================================
+
+static void printPatternSummary(ICommandResponse* response, const PatternGenerator& pattern) {
+    response->printf("Pattern: %lu segments, %lu symbols, %.3f us (%.1f ns resolution)\n",
+                     (unsigned long)pattern.getSegmentCount(), (unsigned long)pattern.getSymbolCount(),
+                     pattern.getDurationUs(), pattern.getResolutionNs());
+}
+
+void CommandParser::handlePatternEdit(const String& cmd, ICommandResponse* response) {
+    // PATTERN CLEAR | RES <ns> | ADD <0|1>:<dur> ... | PULSE <high> <low> [count] | BITS <bits> <bit time>
+    // "PATTERN " is exactly 8 characters, the subcommand starts at position 8
+    String params = cmd.substring(8);
+    params.trim();
+    int space = params.indexOf(' ');
+    String sub = space < 0 ? params : params.substring(0, space);
+    String args = space < 0 ? String() : params.substring(space + 1);
+    args.trim();
+
+    auto& pattern = peripheralManager.getPattern();
+    if (pattern.isPlaying()) {
+        response->println("ERROR: Pattern is playing (use PATTERN STOP)");
+        return;
+    }
+
+    if (sub == "CLEAR") {
+        pattern.clear();
+        response->println("Pattern cleared");
+        return;
+    }
+
+    if (sub == "RES") {
+        float ns = args.toFloat();
+        if (pattern.getSegmentCount() > 0) {
+            response->println("ERROR: Clear the pattern before changing the resolution (PATTERN CLEAR)");
+        } else if (!pattern.setResolution(ns)) {
+            response->println("ERROR: Resolution must be a multiple of 12.5 ns, 12.5-3187.5 ns");
+        } else {
+            response->printf("Pattern resolution: %.1f ns (max %.1f us per segment before splitting)\n",
+                             pattern.getResolutionNs(),
+                             PatternGenerator::MAX_SEGMENT_TICKS * pattern.getResolutionNs() / 1000.0f);
+        }
+        return;
+    }
+
+    if (sub == "ADD") {
+        String error;
+        if (!pattern.addSegments(args.c_str(), error)) {
+            response->printf("ERROR: %s\n", error.c_str());
+            return;
+        }
+        printPatternSummary(response, pattern);
+        return;
+    }
+
+    if (sub == "PULSE") {
+        // <high> <low> [count]
+        int first = args.indexOf(' ');
+        int second = first < 0 ? -1 : args.indexOf(' ', first + 1);
+        String highStr = first < 0 ? args : args.substring(0, first);
+        String lowStr = first < 0 ? String() : (second < 0 ? args.substring(first + 1) : args.substring(first + 1, second));
+        long count = second < 0 ? 1 : args.substring(second + 1).toInt();
+
+        uint32_t high, low;
+        if (!pattern.durationToTicks(highStr.c_str(), high) || !pattern.durationToTicks(lowStr.c_str(), low) ||
+            count < 1) {
+            response->println("Usage: PATTERN PULSE <high> <low> [count] (e.g. PATTERN PULSE 250us 750us 100)");
+            return;
+        }
+        if (!pattern.addPulses(high, low, (uint32_t)count)) {
+            response->println("ERROR: Pattern buffer full");
+            return;
+        }
+        printPatternSummary(response, pattern);
+        return;
+    }
+
+    if (sub == "BITS") {
+        // <bits> <bit time>
+        int split = args.indexOf(' ');
+        uint32_t bitTicks;
+        if (split < 0 || !pattern.durationToTicks(args.substring(split + 1).c_str(), bitTicks)) {
+            response->println("Usage: PATTERN BITS <bits> <bit time> (e.g. PATTERN BITS 1011_0010 1us)");
+            return;
+        }
+        if (!pattern.addBits(args.substring(0, split).c_str(), bitTicks)) {
+            response->println("ERROR: Bits must be 0/1 ('_' ignored), or pattern buffer full");
+            return;
+        }
+        printPatternSummary(response, pattern);
+        return;
+    }
+
+    response->println("Usage: PATTERN <ADD|PULSE|BITS|RES|CLEAR|PLAY|STOP|STATUS> ...");
+}
+
+void CommandParser::handlePatternPlay(const String& cmd, ICommandResponse* response) {
+    // PATTERN PLAY <41|12> [loops|LOOP]
+    // "PATTERN PLAY " is exactly 13 characters, the pin starts at position 13
+    String params = cmd.substring(13);
+    params.trim();
+    int space = params.indexOf(' ');
+    String pinStr = space < 0 ? params : params.substring(0, space);
+    String loopStr = space < 0 ? String("1") : params.substring(space + 1);
+    loopStr.trim();
+
+    PatternGenerator::Output output;
+    long loops = loopStr == "LOOP" ? 0 : loopStr.toInt();
+    if (!PatternGenerator::parseOutput(pinStr, output) || (loopStr != "LOOP" && loops < 1)) {
+        response->println("Usage: PATTERN PLAY <41|12> [loops|LOOP]");
+        return;
+    }
+    if ((uint32_t)loops > PatternGenerator::MAX_LOOPS) {
+        response->printf("ERROR: Loops must be 1-%lu or LOOP\n", (unsigned long)PatternGenerator::MAX_LOOPS);
+        return;
+    }
+
+    auto& pattern = peripheralManager.getPattern();
+    if (pattern.isPlaying()) {
+        response->println("ERROR: Pattern is playing (use PATTERN STOP)");
+        return;
+    }
+    if (pattern.getSegmentCount() == 0) {
+        response->println("ERROR: Pattern is empty (use PATTERN ADD/PULSE/BITS)");
+        return;
+    }
+    if (!pattern.play(output, (uint32_t)loops)) {
+        response->printf("ERROR: Failed to start pattern (%s)\n", pattern.getMessage());
+        return;
+    }
+
+    response->printf("Playing on %s: ", PatternGenerator::getOutputName(output));
+    if (loops == 0) {
+        response->print("until PATTERN STOP");
+    } else {
+        response->printf("%ld time(s)", loops);
+    }
+    response->println(pattern.isHardwareLoop() ? " (hardware loop, seamless)" : "");
+    printPatternSummary(response, pattern);
+}
+
+void CommandParser::handlePatternStop(ICommandResponse* response) {
+    auto& pattern = peripheralManager.getPattern();
+    if (!pattern.isPlaying()) {
+        response->println("Pattern is not playing");
+        return;
+    }
+
+    pattern.stop();
+    response->printf("Pattern stopped on %s after %lu loop(s)\n",
+                     PatternGenerator::getOutputName(pattern.getOutput()), (unsigned long)pattern.getLoopsDone());
+}
+
+void CommandParser::handlePatternStatus(ICommandResponse* response) {
+    auto& pattern = peripheralManager.getPattern();
+
+    response->println("Pattern Generator Status:");
+    response->printf("  State: %s\n", pattern.getStateName());
+    if (pattern.getState() != PatternGenerator::STATE_IDLE) {
+        response->printf("  Output: %s\n", PatternGenerator::getOutputName(pattern.getOutput()));
+        if (pattern.getLoops() == 0) {
+            response->printf("  Loops: %lu of forever%s\n", (unsigned long)pattern.getLoopsDone(),
+                             pattern.isHardwareLoop() ? " (hardware loop, not counted)" : "");
+        } else {
+            response->printf("  Loops: %lu of %lu%s\n", (unsigned long)pattern.getLoopsDone(),
+                             (unsigned long)pattern.getLoops(), pattern.isHardwareLoop() ? " (hardware loop)" : "");
+        }
+    }
+    response->printf("  Segments: %lu (%lu symbols)\n",
+                     (unsigned long)pattern.getSegmentCount(), (unsigned long)pattern.getSymbolCount());
+    response->printf("  Duration: %.3f us per loop\n", pattern.getDurationUs());
+    response->printf("  Resolution: %.1f ns\n", pattern.getResolutionNs());
+    if (pattern.getCapacity() > 0) {
+        response->printf("  Buffer: %lu symbols in %s\n", (unsigned long)pattern.getCapacity(),
+                         pattern.isInPSRAM() ? "PSRAM" : "internal RAM");
+    }
+    if (pattern.getMessage()[0] != '\0') {
+        response->printf("  Message: %s\n", pattern.getMessage());
+    }
+}
+
 // ============================================================================
 // Keys Commands
 // ============================================================================
@@ -547,6 +2006,167 @@ void CommandParser::handleKeysMode(const String& cmd, ICommandResponse* response
     }
 }
 
+// ============================================================================
+// Fan Bank Commands
+// ============================================================================
+
+void CommandParser::handleFanStatus(ICommandResponse* response) {
+    auto& fans = peripheralManager.getFans();
+
+    response->printf("Fan Bank: %u channel(s)\n", fans.getChannelCount());
+    for (uint8_t ch = 1; ch <= fans.getChannelCount(); ch++) {
+        FanBank::ChannelInfo info;
+        fans.getInfo(ch, info);
+        const RPMFilter* filter = fans.getRPMFilter(ch);
+
+        response->printf("  FAN %u: %s, PWM GPIO %u (%s), tach GPIO %u (%s)\n", ch,
+                         info.enabled ? "ENABLED" : "DISABLED",
+                         info.pwmPin, FanBank::getPWMDriverName(info.pwmDriver),
+                         info.tachPin, FanBank::getTachDriverName(info.tachDriver));
+        response->printf("    PWM: %u Hz, %.1f%% duty, %u pole pairs\n",
+                         info.frequency, info.duty, info.polePairs);
+        response->printf("    RPM: %.0f (tach %.2f Hz, filter %s/%u, drops %u)\n",
+                         info.rpm, info.tachFrequency, RPMFilter::getFilterName(filter->getFilterType()),
+                         filter->getWindowSize(), info.captureDrops);
+        if (info.stallEnabled) {
+            response->printf("    Stall: ON, %u periods (%.1f ms), actions %s, count %u%s\n",
+                             info.stallPeriods, info.stallTimeoutUs / 1000.0f,
+                             formatStallActions(info.stallActions).c_str(), info.stallCount,
+                             info.stalled ? ", STALLED" : "");
+        } else {
+            response->printf("    Stall: OFF (count %u)\n", info.stallCount);
+        }
+    }
+}
+
+void CommandParser::handleFanChannel(const String& cmd, ICommandResponse* response) {
+    // FAN <n> <FREQ|DUTY|POLES|FILTER|FILTER_SIZE|STALL|STALL_PERIODS|STALL_ACTION> <value>
+    // FAN <n> ENABLE|DISABLE
+    // FAN SAVE / FAN RESET
+    auto& fans = peripheralManager.getFans();
+    String params = cmd.substring(4);  // Remove "FAN "
+    params.trim();
+
+    if (params == "SAVE") {
+        if (fans.saveSettings()) {
+            response->println("OK: Fan bank settings saved to NVS");
+        } else {
+            response->println("ERROR: Failed to save fan bank settings");
+        }
+        return;
+    }
+    if (params == "RESET") {
+        fans.resetToDefaults();
+        fans.saveSettings();
+        response->println("OK: Fan bank settings reset to defaults");
+        return;
+    }
+
+    int idx1 = params.indexOf(' ');
+    int idx2 = idx1 < 0 ? -1 : params.indexOf(' ', idx1 + 1);
+    if (idx1 < 0) {
+        response->println("Usage: FAN <n> <FREQ|DUTY|POLES|FILTER|FILTER_SIZE|STALL|STALL_PERIODS|STALL_ACTION> <value>");
+        response->println("       FAN <n> ENABLE|DISABLE");
+        return;
+    }
+
+    uint8_t ch = params.substring(0, idx1).toInt();
+    String parameter = idx2 < 0 ? params.substring(idx1 + 1) : params.substring(idx1 + 1, idx2);
+    String value = idx2 < 0 ? String("") : params.substring(idx2 + 1);
+    value.trim();
+    bool toggle = parameter == "ENABLE" || parameter == "DISABLE";
+    if (idx2 < 0 && !toggle) {
+        response->println("Usage: FAN <n> <FREQ|DUTY|POLES|FILTER|FILTER_SIZE|STALL|STALL_PERIODS|STALL_ACTION> <value>");
+        response->println("       FAN <n> ENABLE|DISABLE");
+        return;
+    }
+
+    if (!fans.isValidChannel(ch)) {
+        response->printf("ERROR: Channel must be 1-%u\n", fans.getChannelCount());
+        return;
+    }
+
+    if (toggle) {
+        bool enable = parameter == "ENABLE";
+        if (!fans.setEnabled(ch, enable)) {
+            response->printf("ERROR: FAN %u failed to start\n", ch);
+            return;
+        }
+        response->printf("FAN %u: %s\n", ch, enable ? "enabled" : "disabled (pins released)");
+    } else if (parameter == "FREQ") {
+        uint32_t freq = value.toInt();
+        if (!fans.setFrequency(ch, freq)) {
+            response->printf("ERROR: Frequency must be %u-%u Hz\n", FanBank::MIN_FREQUENCY, FanBank::MAX_FREQUENCY);
+            return;
+        }
+        response->printf("FAN %u: %u Hz\n", ch, freq);
+    } else if (parameter == "DUTY") {
+        float duty = value.toFloat();
+        if (!fans.setDuty(ch, duty)) {
+            response->println("ERROR: Duty must be 0-100%");
+            return;
+        }
+        response->printf("FAN %u: %.1f%% duty\n", ch, duty);
+    } else if (parameter == "POLES") {
+        int poles = value.toInt();
+        if (poles < 1 || !fans.setPolePairs(ch, poles)) {
+            response->printf("ERROR: Pole pairs must be 1-%u\n", FanBank::MAX_POLE_PAIRS);
+            return;
+        }
+        response->printf("FAN %u: %d pole pairs\n", ch, poles);
+    } else if (parameter == "FILTER") {
+        bool found = false;
+        for (uint8_t t = RPMFilter::FILTER_NONE; t <= RPMFilter::FILTER_WINDOW; t++) {
+            if (value == RPMFilter::getFilterName((RPMFilter::FilterType)t)) {
+                found = fans.setFilterType(ch, (RPMFilter::FilterType)t);
+                break;
+            }
+        }
+        if (!found) {
+            response->println("ERROR: Filter must be NONE, MEDIAN, EMA or WINDOW");
+            return;
+        }
+        response->printf("FAN %u: filter %s\n", ch, value.c_str());
+    } else if (parameter == "FILTER_SIZE") {
+        int size = value.toInt();
+        if (size < 1 || size > RPMFilter::MAX_WINDOW || !fans.setFilterWindow(ch, size)) {
+            response->printf("ERROR: Filter size must be 1-%d\n", RPMFilter::MAX_WINDOW);
+            return;
+        }
+        response->printf("FAN %u: filter size %d\n", ch, size);
+    } else if (parameter == "STALL") {
+        if (value != "ON" && value != "OFF") {
+            response->println("ERROR: Use FAN <n> STALL ON|OFF");
+            return;
+        }
+        fans.setStallDetection(ch, value == "ON");
+        response->printf("FAN %u: stall detection %s\n", ch, value.c_str());
+    } else if (parameter == "STALL_PERIODS") {
+        int periods = value.toInt();
+        if (periods < 0 || !fans.setStallPeriods(ch, periods)) {
+            response->printf("ERROR: Stall periods must be %u-%u\n",
+                             UART1Mux::STALL_MIN_PERIODS, UART1Mux::STALL_MAX_PERIODS);
+            return;
+        }
+        response->printf("FAN %u: stall after %d periods\n", ch, periods);
+    } else if (parameter == "STALL_ACTION") {
+        uint8_t actions;
+        if (!parseStallActions(value, actions)) {
+            response->println("ERROR: Actions must be NONE or a list of CUT, BEEP, NOTIFY");
+            return;
+        }
+        fans.setStallActions(ch, actions);
+        response->printf("FAN %u: stall actions %s\n", ch, formatStallActions(actions).c_str());
+    } else {
+        response->printf("ERROR: Unknown fan parameter: %s\n", parameter.c_str());
+        return;
+    }
+
+    if (webServerManager.isRunning()) {
+        webServerManager.broadcastStatus();
+    }
+}
+
 // ============================================================================
 // Peripheral Status Commands
 // ============================================================================
@@ -567,6 +2187,7 @@ void CommandParser::handlePeripheralStatus(ICommandResponse* response) {
                     peripheralManager.getGPIO().getState() ? "HIGH" : "LOW");
     response->printf("  Keys: %s\n",
                     peripheralManager.isKeyControlEnabled() ? "Enabled" : "Disabled");
+    response->printf("  Fans: %u channel(s)\n", peripheralManager.getFans().getChannelCount());
 }
 
 void CommandParser::handlePeripheralStats(ICommandResponse* response) {
@@ -2,7 +2,9 @@
 
 
 
-PeripheralManager::PeripheralManager() {
+PeripheralManager::PeripheralManager() : characterizer(uart1), logicCapture(uart1), packetLink(uart2), bert(uart1, uart2),
+      modbus(uart2, uart1, relay, gpioOut), sniffer(uart1, uart2),
+      presets(uart1, ledPWM, relay) {
 }
 
 bool PeripheralManager::begin() {
@@ -12,6 +14,7 @@ bool PeripheralManager::begin() {
     // Initialize UART1 (start in disabled mode)
     Serial.print("[PeripheralManager] UART1... ");
     uart1.disable();
+    uart1.loadRPMSettings();
     Serial.println("OK (disabled)");
 
     // Initialize UART2
@@ -62,6 +65,19 @@ bool PeripheralManager::begin() {
     }
     Serial.println("OK");
 
+    // Initialize fan channels (optional: UART1 alone is still usable)
+    Serial.print("[PeripheralManager] Fan Bank... ");
+    if (fans.begin()) {
+        Serial.printf("OK (%u channels)\n", fans.getChannelCount());
+    } else {
+        Serial.println("FAILED (continuing without fan channels)");
+    }
+
+    // Operating-point presets (the NVS namespace does not exist before the first save)
+    Serial.print("[PeripheralManager] Presets... ");
+    presets.begin();
+    Serial.printf("OK (%u stored)\n", presets.getCount());
+
     allInitialized = true;
 
     Serial.println("=================================");
@@ -76,7 +92,13 @@ bool PeripheralManager::begin() {
     Serial.println("  • GPIO Out: GPIO 41 - General purpose");
     Serial.println("  • Key 1: GPIO 1 - Duty/Freq increase");
     Serial.println("  • Key 2: GPIO 2 - Duty/Freq decrease");
-    Serial.println("  • Key 3: GPIO 42 - Enter/Start (future)");
+    Serial.println("  • Key 3: GPIO 42 - Next preset / clear emergency stop");
+    for (uint8_t ch = 1; ch <= fans.getChannelCount(); ch++) {
+        FanBank::ChannelInfo info;
+        fans.getInfo(ch, info);
+        Serial.printf("  • Fan %u: GPIO %u (PWM), GPIO %u (Tach)%s\n", ch, info.pwmPin, info.tachPin,
+                      info.enabled ? "" : " - disabled");
+    }
     Serial.println("=================================\n");
 
     return true;
@@ -93,6 +115,8 @@ void PeripheralManager::update() {
     // Update UART1 RPM measurement if in PWM/RPM mode
     if (uart1.getMode() == UART1Mux::MODE_PWM_RPM) {
         uart1.updateRPMFrequency();
+        uart1.updateRamp();
+        uart1.updateSequence();
     }
 
     // Handle key events (motor control)
@@ -214,12 +238,19 @@ void PeripheralManager::handleKeyEvents() {
         buzzer.beep(2000, 100);
     }
 
-    // Check Key 3 (Enter/Start) - Future use
+    // Check Key 3 (Enter/Start)
     UserKeys::KeyEvent event3 = keys.getEvent(UserKeys::KEY3);
     if (event3 == UserKeys::EVENT_SHORT_PRESS) {
-        Serial.println("[Keys] Key 3 pressed (reserved for future use)");
-        // Optional: Beep acknowledgment
-        buzzer.beep(1500, 50);
+        // Short press: Step to the next stored operating-point preset
+        String error;
+        uint8_t index = presets.recallNext(error);
+        if (index > 0) {
+            Serial.printf("[Keys] Preset %u (%s) recalled\n", index, presets.get(index)->name);
+            buzzer.beep(1500, 50);
+        } else {
+            Serial.printf("[Keys] Key 3: %s\n", error.c_str());
+            buzzer.beep(500, 100);
+        }
     } else if (event3 == UserKeys::EVENT_LONG_PRESS) {
         // Long press Key 3: Clear emergency stop
         if (!uart1.isPWMEnabled()) {
@@ -261,6 +292,188 @@ void PeripheralManager::adjustMotorFrequency(bool increase) {
     }
 }
 
+// ============================================================================
+// Batch Operating-Point Changes
+// ============================================================================
+
+static bool parseBatchBool(const char* value, bool& out) {
+    if (strcasecmp(value, "true") == 0 || strcasecmp(value, "on") == 0 || strcmp(value, "1") == 0) {
+        out = true;
+        return true;
+    }
+    if (strcasecmp(value, "false") == 0 || strcasecmp(value, "off") == 0 || strcmp(value, "0") == 0) {
+        out = false;
+        return true;
+    }
+    return false;
+}
+
+static bool parseBatchNumber(const char* value, double& out) {
+    char* end;
+    out = strtod(value, &end);
+    return end != value && *end == '\0';
+}
+
+bool PeripheralBatch::setField(const char* key, const char* value, String& error) {
+    double num = 0.0;
+
+    if (strcmp(key, "freq") == 0 || strcmp(key, "frequency") == 0) {
+        if (!parseBatchNumber(value, num) || num < 0) {
+            error = "Invalid freq";
+            return false;
+        }
+        hasFrequency = true;
+        frequency = (uint32_t)num;
+    } else if (strcmp(key, "duty") == 0) {
+        if (!parseBatchNumber(value, num)) {
+            error = "Invalid duty";
+            return false;
+        }
+        hasDuty = true;
+        duty = (float)num;
+    } else if (strcmp(key, "polePairs") == 0) {
+        if (!parseBatchNumber(value, num) || num < 0) {
+            error = "Invalid polePairs";
+            return false;
+        }
+        hasPolePairs = true;
+        polePairs = (uint32_t)num;
+    } else if (strcmp(key, "maxFreq") == 0 || strcmp(key, "maxFrequency") == 0) {
+        if (!parseBatchNumber(value, num) || num < 0) {
+            error = "Invalid maxFreq";
+            return false;
+        }
+        hasMaxFrequency = true;
+        maxFrequency = (uint32_t)num;
+    } else if (strcmp(key, "led") == 0) {
+        if (!parseBatchNumber(value, num)) {
+            error = "Invalid led";
+            return false;
+        }
+        hasLedBrightness = true;
+        ledBrightness = (float)num;
+    } else if (strcmp(key, "ledEnabled") == 0) {
+        if (!parseBatchBool(value, ledEnabled)) {
+            error = "Invalid ledEnabled";
+            return false;
+        }
+        hasLedEnabled = true;
+    } else if (strcmp(key, "relay") == 0) {
+        if (!parseBatchBool(value, relay)) {
+            error = "Invalid relay";
+            return false;
+        }
+        hasRelay = true;
+    } else {
+        error = String("Unknown field: ") + key;
+        return false;
+    }
+    return true;
+}
+
+bool PeripheralBatch::isEmpty() const {
+    return !(hasFrequency || hasDuty || hasPolePairs || hasMaxFrequency ||
+             hasLedBrightness || hasLedEnabled || hasRelay);
+}
+
+bool PeripheralManager::applyBatch(const PeripheralBatch& batch, String& error) {
+    if (batch.isEmpty()) {
+        error = "Empty batch";
+        return false;
+    }
+
+    // ===== Phase 1: validate everything before touching hardware =====
+    bool pwmChange = batch.hasFrequency || batch.hasDuty;
+    if (pwmChange && uart1.getMode() != UART1Mux::MODE_PWM_RPM) {
+        error = "UART1 not in PWM mode";
+        return false;
+    }
+    if (batch.hasMaxFrequency && (batch.maxFrequency < 10 || batch.maxFrequency > 500000)) {
+        error = "maxFreq must be 10-500000 Hz";
+        return false;
+    }
+    uint32_t effectiveMax = batch.hasMaxFrequency ? batch.maxFrequency : uart1.getMaxFrequency();
+    if (batch.hasFrequency) {
+        if (batch.frequency < 10 || batch.frequency > 500000) {
+            error = "freq must be 10-500000 Hz";
+            return false;
+        }
+        if (batch.frequency > effectiveMax) {
+            error = "freq exceeds maxFreq";
+            return false;
+        }
+    } else if (batch.hasMaxFrequency && uart1.getMode() == UART1Mux::MODE_PWM_RPM &&
+               uart1.getPWMFrequency() > effectiveMax) {
+        // A lower limit alone must not leave the running PWM above it
+        error = "current freq exceeds new maxFreq (send freq too)";
+        return false;
+    }
+    if (batch.hasDuty && (batch.duty < 0.0 || batch.duty > 100.0)) {
+        error = "duty must be 0-100%";
+        return false;
+    }
+    if (batch.hasPolePairs && (batch.polePairs < 1 || batch.polePairs > 12)) {
+        error = "polePairs must be 1-12";
+        return false;
+    }
+    if (batch.hasLedBrightness && (batch.ledBrightness < 0.0 || batch.ledBrightness > 100.0)) {
+        error = "led must be 0-100%";
+        return false;
+    }
+
+    // ===== Phase 2: snapshot for rollback =====
+    uint32_t oldFrequency = uart1.getPWMFrequency();
+    float oldDuty = uart1.getPWMDuty();
+    uint32_t oldPolePairs = uart1.getPolePairs();
+    uint32_t oldMaxFrequency = uart1.getMaxFrequency();
+    float oldLedBrightness = ledPWM.getBrightness();
+    bool oldLedEnabled = ledPWM.isEnabled();
+    bool oldRelay = relay.getState();
+
+    // ===== Phase 3: apply =====
+    bool ok = true;
+    if (batch.hasMaxFrequency) {
+        ok = uart1.setMaxFrequency(batch.maxFrequency);
+    }
+    if (ok && batch.hasPolePairs) {
+        ok = uart1.setPolePairs(batch.polePairs);
+    }
+    if (ok && pwmChange) {
+        // One shadow commit: new period and compare latch on the same TEZ
+        uint32_t frequency = batch.hasFrequency ? batch.frequency : oldFrequency;
+        float duty = batch.hasDuty ? batch.duty : oldDuty;
+        ok = uart1.setPWMFrequencyAndDuty(frequency, duty);
+    }
+    if (ok && batch.hasLedBrightness) {
+        ok = ledPWM.setBrightness(batch.ledBrightness);
+    }
+    if (ok && batch.hasLedEnabled) {
+        ledPWM.enable(batch.ledEnabled);
+    }
+    if (ok && batch.hasRelay) {
+        relay.setState(batch.relay);
+    }
+
+    if (ok) {
+        Serial.println("[PeripheralManager] Batch applied");
+        return true;
+    }
+
+    // ===== Rollback =====
+    Serial.println("[PeripheralManager] Batch apply failed, rolling back");
+    uart1.setMaxFrequency(oldMaxFrequency);
+    uart1.setPolePairs(oldPolePairs);
+    if (pwmChange) {
+        uart1.setPWMFrequencyAndDuty(oldFrequency, oldDuty);
+    }
+    ledPWM.setBrightness(oldLedBrightness);
+    ledPWM.enable(oldLedEnabled);
+    relay.setState(oldRelay);
+
+    error = "Apply failed, previous state restored";
+    return false;
+}
+
 // ============================================================================
 // Settings Management Implementation
 // ============================================================================
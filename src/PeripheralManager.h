@@ -3,15 +3,61 @@
 
 #include <Arduino.h>
 #include "UART1Mux.h"
+#include "FanBank.h"
 #include "UART2Manager.h"
 #include "UserKeys.h"
 #include "BuzzerControl.h"
 #include "LEDPWMControl.h"
 #include "RelayControl.h"
 #include "GPIOControl.h"
+#include "FanCharacterizer.h"
+#include "LogicCapture.h"
+#include "PacketLink.h"
+#include "UARTBert.h"
+#include "ModbusServer.h"
+#include "UARTSniffer.h"
+#include "PatternGenerator.h"
+#include "OperatingPresets.h"
 // #include "MotorControl.h"  // DEPRECATED: Motor control merged to UART1Mux
 #include "PeripheralSettings.h"
 
+/**
+ * @brief Operating-point changes applied together by PeripheralManager::applyBatch()
+ *
+ * Only fields whose has* flag is set are touched. Field names match the
+ * JSON keys accepted by POST /api/batch and the BATCH command.
+ */
+struct PeripheralBatch {
+    bool hasFrequency = false;
+    uint32_t frequency = 0;         // "freq": PWM frequency (Hz)
+    bool hasDuty = false;
+    float duty = 0.0;               // "duty": PWM duty (%)
+    bool hasPolePairs = false;
+    uint32_t polePairs = 0;         // "polePairs": 1-12
+    bool hasMaxFrequency = false;
+    uint32_t maxFrequency = 0;      // "maxFreq": safety limit (Hz)
+    bool hasLedBrightness = false;
+    float ledBrightness = 0.0;      // "led": LED PWM brightness (%)
+    bool hasLedEnabled = false;
+    bool ledEnabled = false;        // "ledEnabled"
+    bool hasRelay = false;
+    bool relay = false;             // "relay"
+
+    /**
+     * @brief Parse one field by key
+     * @param key Field name (case-sensitive, see members)
+     * @param value Field text
+     * @param error Receives reason on failure
+     * @return false for unknown keys or unparsable values
+     */
+    bool setField(const char* key, const char* value, String& error);
+
+    /**
+     * @brief Check if any field is set
+     */
+    bool isEmpty() const;
+};
+
 /**
  * @brief Peripheral Manager - Centralized peripheral control
  *
@@ -68,11 +114,20 @@ public:
 
     UART1Mux& getUART1() { return uart1; }
     UART2Manager& getUART2() { return uart2; }
+    PacketLink& getPacketLink() { return packetLink; }
+    UARTBert& getBert() { return bert; }
+    ModbusServer& getModbus() { return modbus; }
+    UARTSniffer& getSniffer() { return sniffer; }
     UserKeys& getKeys() { return keys; }
     BuzzerControl& getBuzzer() { return buzzer; }
     LEDPWMControl& getLEDPWM() { return ledPWM; }
     RelayControl& getRelay() { return relay; }
     GPIOControl& getGPIO() { return gpioOut; }
+    PatternGenerator& getPattern() { return pattern; }
+    OperatingPresets& getPresets() { return presets; }
+    FanCharacterizer& getCharacterizer() { return characterizer; }
+    LogicCapture& getLogicCapture() { return logicCapture; }
+    FanBank& getFans() { return fans; }
 
     // ========================================================================
     // Configuration
@@ -121,6 +176,20 @@ public:
      */
     bool isKeyControlAdjustingDuty() const { return keyControlAdjustsDuty; }
 
+    /**
+     * @brief Validate and apply a batch of changes as one operating point
+     *
+     * Every field is validated before anything is touched. PWM frequency
+     * and duty are committed through one shadow-register write so they
+     * take effect on the same TEZ. If any step fails after validation,
+     * the previous values are restored.
+     *
+     * @param batch Changes to apply
+     * @param error Receives reason on failure
+     * @return true if all changes were applied
+     */
+    bool applyBatch(const PeripheralBatch& batch, String& error);
+
     /**
      * @brief Get statistics string for all peripherals
      * @return Statistics string
@@ -175,12 +244,21 @@ public:
 private:
     // Peripheral instances
     UART1Mux uart1;
+    FanCharacterizer characterizer;
+    LogicCapture logicCapture;
+    FanBank fans;
     UART2Manager uart2;
+    PacketLink packetLink;
+    UARTBert bert;
+    ModbusServer modbus;
+    UARTSniffer sniffer;
     UserKeys keys;
     BuzzerControl buzzer;
     LEDPWMControl ledPWM;
     RelayControl relay;
     GPIOControl gpioOut;
+    PatternGenerator pattern;
+    OperatingPresets presets;
 
     // Motor control is now integrated into UART1Mux (no separate reference needed)
 
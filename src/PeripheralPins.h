@@ -40,6 +40,22 @@
 #define PIN_UART2_TX                43  // UART2 TX (2400-1.5Mbps)
 #define PIN_UART2_RX                44  // UART2 RX (2400-1.5Mbps)
 
+// ============================================================================
+// FAN CHANNEL PINS (FanBank, PWM output / tach input pairs)
+// ============================================================================
+// Edit the table in FanBank.cpp to change the number of channels; PWM and
+// tach hardware is allocated from whatever UART1/LEDC peripherals leave free
+#define PIN_FAN1_PWM                4
+#define PIN_FAN1_TACH               5
+#define PIN_FAN2_PWM                6
+#define PIN_FAN2_TACH               7
+#define PIN_FAN3_PWM                8
+#define PIN_FAN3_TACH               9
+#define PIN_FAN4_PWM                10
+#define PIN_FAN4_TACH               11
+#define PIN_FAN5_PWM                15
+#define PIN_FAN5_TACH               16
+
 // ============================================================================
 // PWM OUTPUT PINS
 // ============================================================================
@@ -57,7 +73,7 @@
 // ============================================================================
 #define PIN_USER_KEY1               1   // User Key 1 - Duty/Frequency increase
 #define PIN_USER_KEY2               2   // User Key 2 - Duty/Frequency decrease
-#define PIN_USER_KEY3               42  // User Key 3 - Enter/Start (future use)
+#define PIN_USER_KEY3               42  // User Key 3 - Enter/Start (next preset)
 
 // ============================================================================
 // RESERVED PINS (DO NOT USE)
@@ -78,6 +94,10 @@
 #define LEDC_TIMER_BUZZER           0   // High-speed timer for buzzer
 #define LEDC_TIMER_LED              1   // High-speed timer for LED
 
+// LEDC resources FanBank may use once the MCPWM timers are taken (one timer per channel)
+#define LEDC_CHANNEL_FAN_FIRST      2
+#define LEDC_TIMER_FAN_FIRST        2
+
 // MCPWM for UART1 Motor Control
 // UART1 uses MCPWM for both PWM output and RPM capture (high precision, wide range)
 #define MCPWM_UNIT_UART1_PWM        MCPWM_UNIT_1
@@ -87,6 +107,31 @@
 #define MCPWM_UNIT_UART1_RPM        MCPWM_UNIT_0
 #define MCPWM_CAP_UART1_RPM         MCPWM_SELECT_CAP1
 
+// MCPWM unit FanBank may use (timers and the captures UART1 leaves free).
+// Never unit 1: mcpwm_init() there rewrites the group prescaler and shadow
+// setup the UART1 PWM synthesis is computed against.
+#define MCPWM_UNIT_FAN              MCPWM_UNIT_0
+
+// Hardware timer pacing UART1 PWM ramps above the TEZ-paced frequency limit
+#define TIMER_GROUP_UART1_RAMP      TIMER_GROUP_1
+#define TIMER_UART1_RAMP            TIMER_0
+
+// Hardware timer pacing the UART1 closed-loop RPM controller
+#define TIMER_GROUP_UART1_RPM_LOOP  TIMER_GROUP_0
+#define TIMER_UART1_RPM_LOOP        TIMER_0
+
+// Hardware timer timing UART1 PWM sequencer step transitions
+#define TIMER_GROUP_UART1_SEQ       TIMER_GROUP_1
+#define TIMER_UART1_SEQ             TIMER_1
+
+// Hardware timer timing out the UART1 tach signal (stall detection)
+#define TIMER_GROUP_UART1_STALL     TIMER_GROUP_0
+#define TIMER_UART1_STALL           TIMER_1
+
+// PCNT for UART1 RPM high-frequency range (gated edge counting on the same RX pin)
+#define PCNT_UNIT_UART1_RPM         PCNT_UNIT_0
+#define PCNT_CHANNEL_UART1_RPM      PCNT_CHANNEL_0
+
 // UART Numbers
 #define UART_NUM_UART1              UART_NUM_1
 #define UART_NUM_UART2              UART_NUM_2
@@ -0,0 +1,131 @@
+#include "PulseMeter.h"
+#include <math.h>
+
+PulseMeter::PulseMeter(uint32_t timerClockHz)
+    : ticksPerUs(timerClockHz / 1000000.0f) {
+}
+
+// ============================================================================
+// Measurement
+// ============================================================================
+
+bool PulseMeter::addEdge(uint32_t timestamp, bool rising) {
+    edges++;
+
+    if (!rising) {
+        if (!haveRise || haveFall) {
+            // Falling without a rise before it: the rise (or the next rise) was missed
+            if (haveRise) {
+                unpaired++;
+            }
+            haveRise = false;
+            haveFall = false;
+            return false;
+        }
+        fallTime = timestamp;
+        haveFall = true;
+        return false;
+    }
+
+    bool completed = false;
+    if (haveRise && haveFall) {
+        uint32_t highTicks = fallTime - riseTime;   // Wrap-safe
+        uint32_t lowTicks = timestamp - fallTime;
+        uint32_t periodTicks = timestamp - riseTime;
+
+        if (periodTicks > 0) {
+            bool first = cycles == 0;
+            high.add(highTicks, first);
+            low.add(lowTicks, first);
+            period.add(periodTicks, first);
+
+            float duty = (float)highTicks * 100.0f / (float)periodTicks;
+            dutyLast = duty;
+            if (first) {
+                dutyMin = duty;
+                dutyMax = duty;
+            } else {
+                if (duty < dutyMin) dutyMin = duty;
+                if (duty > dutyMax) dutyMax = duty;
+            }
+            cycles++;
+            double delta = duty - dutyMean;
+            dutyMean += delta / cycles;
+            dutyM2 += delta * (duty - dutyMean);
+            completed = true;
+        }
+    } else if (haveRise) {
+        unpaired++;  // Rise after rise: the falling edge was missed
+    }
+
+    // This rise starts the next cycle
+    riseTime = timestamp;
+    haveRise = true;
+    haveFall = false;
+    return completed;
+}
+
+void PulseMeter::markGap() {
+    haveRise = false;
+    haveFall = false;
+}
+
+void PulseMeter::reset() {
+    markGap();
+    edges = 0;
+    cycles = 0;
+    unpaired = 0;
+    high = Accumulator();
+    low = Accumulator();
+    period = Accumulator();
+    dutyLast = 0.0f;
+    dutyMin = 0.0f;
+    dutyMax = 0.0f;
+    dutyMean = 0.0;
+    dutyM2 = 0.0;
+}
+
+PulseMeter::Statistics PulseMeter::getStatistics() const {
+    float scale = 1.0f / ticksPerUs;
+
+    Statistics stats;
+    stats.edges = edges;
+    stats.cycles = cycles;
+    stats.unpaired = unpaired;
+    stats.highUs = high.toRange(scale, cycles);
+    stats.lowUs = low.toRange(scale, cycles);
+    stats.periodUs = period.toRange(scale, cycles);
+    stats.duty.last = dutyLast;
+    stats.duty.min = dutyMin;
+    stats.duty.max = dutyMax;
+    stats.duty.mean = (float)dutyMean;
+    stats.dutyStddev = cycles > 1 ? (float)sqrt(dutyM2 / (cycles - 1)) : 0.0f;
+    stats.frequency = stats.periodUs.mean > 0.0f ? 1000000.0f / stats.periodUs.mean : 0.0f;
+    return stats;
+}
+
+// ============================================================================
+// Internals
+// ============================================================================
+
+void PulseMeter::Accumulator::add(uint32_t value, bool first) {
+    last = value;
+    if (first) {
+        min = value;
+        max = value;
+        sum = 0;
+    } else {
+        if (value < min) min = value;
+        if (value > max) max = value;
+    }
+    sum += value;
+}
+
+PulseMeter::Range PulseMeter::Accumulator::toRange(float scale, uint32_t count) const {
+    Range range;
+    range.last = last * scale;
+    range.min = min * scale;
+    range.max = max * scale;
+    range.mean = count > 0 ? (float)((double)sum / count) * scale : 0.0f;
+    return range;
+}
@@ -0,0 +1,117 @@
+#ifndef PULSE_METER_H
+#define PULSE_METER_H
+
+#include <stdint.h>
+
+/**
+ * @brief Pulse width / duty measurement from dual-edge capture timestamps
+ *
+ * Fed with capture timestamps and their edge polarity. A complete cycle
+ * is rising → falling → rising:
+ *
+ *   high   = t_fall − t_rise1
+ *   low    = t_rise2 − t_fall
+ *   period = t_rise2 − t_rise1
+ *   duty   = high / period
+ *
+ * Two edges of the same polarity in a row mean an edge was missed (ISR
+ * latency, ring overflow); the partial cycle is dropped and counted as
+ * unpaired instead of producing a wrong width.
+ *
+ * Keeps the last cycle plus min/max/mean of every quantity (and the duty
+ * standard deviation) since the last reset.
+ *
+ * Has no Arduino or ESP-IDF dependencies so it can be built on a host.
+ */
+class PulseMeter {
+public:
+    /**
+     * @brief One quantity's statistics
+     */
+    struct Range {
+        float last;
+        float min;
+        float max;
+        float mean;
+    };
+
+    /**
+     * @brief Statistics since the last reset (times in µs, duty in %)
+     */
+    struct Statistics {
+        uint32_t edges;         ///< Edges consumed
+        uint32_t cycles;        ///< Complete rising-falling-rising cycles
+        uint32_t unpaired;      ///< Partial cycles dropped (missed edge or gap)
+        Range highUs;
+        Range lowUs;
+        Range periodUs;
+        Range duty;
+        float dutyStddev;
+        float frequency;        ///< From the mean period (Hz)
+    };
+
+    /**
+     * @brief Constructor
+     * @param timerClockHz Capture timer clock (MCPWM capture runs on 80 MHz APB)
+     */
+    explicit PulseMeter(uint32_t timerClockHz = 80000000);
+
+    /**
+     * @brief Feed one capture timestamp
+     * @param timestamp Capture timer value at the edge (wraps at 2^32)
+     * @param rising Edge polarity
+     * @return true if the edge completed a cycle
+     */
+    bool addEdge(uint32_t timestamp, bool rising);
+
+    /**
+     * @brief Mark lost edges; the next rising edge starts a new cycle
+     */
+    void markGap();
+
+    /**
+     * @brief Drop the partial cycle and clear statistics
+     */
+    void reset();
+
+    Statistics getStatistics() const;
+
+    /**
+     * @brief Cycles completed since the last reset
+     */
+    uint32_t getCycleCount() const { return cycles; }
+
+private:
+    struct Accumulator {
+        uint32_t last = 0;
+        uint32_t min = 0;
+        uint32_t max = 0;
+        uint64_t sum = 0;
+
+        void add(uint32_t value, bool first);
+        Range toRange(float scale, uint32_t count) const;
+    };
+
+    float ticksPerUs;
+
+    // Edge pairing
+    bool haveRise = false;          // t_rise1 valid
+    bool haveFall = false;          // t_fall valid (after t_rise1)
+    uint32_t riseTime = 0;
+    uint32_t fallTime = 0;
+
+    // Statistics
+    uint32_t edges = 0;
+    uint32_t cycles = 0;
+    uint32_t unpaired = 0;
+    Accumulator high;
+    Accumulator low;
+    Accumulator period;
+    float dutyLast = 0.0f;
+    float dutyMin = 0.0f;
+    float dutyMax = 0.0f;
+    double dutyMean = 0.0;          // Welford running mean / M2
+    double dutyM2 = 0.0;
+};
+
+#endif // PULSE_METER_H
@@ -0,0 +1,200 @@
+#include "RPMController.h"
+#include <math.h>
+
+RPMController::RPMController() {
+    clearCurve();
+}
+
+// ============================================================================
+// Configuration
+// ============================================================================
+
+bool RPMController::setGains(float newKp, float newKi, float newKd) {
+    if (!(newKp >= 0.0f && newKi >= 0.0f && newKd >= 0.0f) ||
+        !isfinite(newKp) || !isfinite(newKi) || !isfinite(newKd)) {
+        return false;
+    }
+    kp = newKp;
+    ki = newKi;
+    kd = newKd;
+    return true;
+}
+
+bool RPMController::setSlewRate(float percentPerSecond) {
+    if (percentPerSecond != 0.0f && !(percentPerSecond >= 0.1f && percentPerSecond <= 10000.0f)) {
+        return false;
+    }
+    slewRate = percentPerSecond;
+    return true;
+}
+
+bool RPMController::setOutputLimits(float minDuty, float maxDuty) {
+    if (!(minDuty >= 0.0f && maxDuty <= 100.0f && minDuty < maxDuty)) {
+        return false;
+    }
+    outMin = minDuty;
+    outMax = maxDuty;
+    return true;
+}
+
+// ============================================================================
+// Control
+// ============================================================================
+
+void RPMController::start(float currentDuty, float measuredRpm) {
+    output = currentDuty;
+    prevMeasured = measuredRpm;
+    lastError = target - measuredRpm;
+
+    // Preload the integrator so the first update continues from the current duty
+    float ff = ffEnabled ? feedForward(target) : -1.0f;
+    lastFF = ff < 0.0f ? 0.0f : ff;
+    integral = currentDuty - lastFF - kp * lastError;
+}
+
+float RPMController::update(float measuredRpm, float dt) {
+    if (dt <= 0.0f) {
+        return output;
+    }
+
+    float error = target - measuredRpm;
+    float derivative = -(measuredRpm - prevMeasured) / dt;
+    prevMeasured = measuredRpm;
+    lastError = error;
+
+    float ff = ffEnabled ? feedForward(target) : -1.0f;
+    if (ff < 0.0f) {
+        ff = 0.0f;
+    }
+    // A curve update moves FF; shift the integrator so the output does not jump
+    integral += lastFF - ff;
+    lastFF = ff;
+
+    float candidateIntegral = integral + ki * error * dt;
+    float desired = ff + kp * error + candidateIntegral + kd * derivative;
+
+    float limited = desired;
+    if (limited > outMax) limited = outMax;
+    if (limited < outMin) limited = outMin;
+
+    if (slewRate > 0.0f) {
+        float maxStep = slewRate * dt;
+        if (limited > output + maxStep) limited = output + maxStep;
+        if (limited < output - maxStep) limited = output - maxStep;
+    }
+
+    bool clamped = limited != desired;
+    if (clamped) {
+        saturated++;
+    }
+
+    // Conditional integration: don't wind up against a limit the error pushes into
+    bool pushingUp = error > 0.0f && limited < desired;
+    bool pushingDown = error < 0.0f && limited > desired;
+    if (!(pushingUp || pushingDown)) {
+        integral = candidateIntegral;
+    }
+
+    output = limited;
+    iterations++;
+
+    // ~1 s window at typical loop rates without storing history
+    float alpha = dt > 1.0f ? 1.0f : dt;
+    errorSqAvg += alpha * (error * error - errorSqAvg);
+
+    return output;
+}
+
+// ============================================================================
+// Feed-forward curve
+// ============================================================================
+
+void RPMController::learn(float duty, float rpm) {
+    if (duty < 0.0f || duty > 100.0f || rpm < 0.0f) {
+        return;
+    }
+    int index = (int)(duty / 10.0f + 0.5f);
+    if (fabsf(duty - index * 10.0f) > 2.5f) {
+        return;
+    }
+    if (curve[index] < 0.0f) {
+        curve[index] = rpm;
+    } else {
+        curve[index] += 0.02f * (rpm - curve[index]);
+    }
+}
+
+float RPMController::feedForward(float rpm) const {
+    // Piecewise-linear inverse over known points with increasing RPM
+    int lower = -1;
+    for (int i = 0; i < CURVE_POINTS; i++) {
+        if (curve[i] < 0.0f) {
+            continue;
+        }
+        if (lower >= 0 && curve[i] > curve[lower] && rpm <= curve[i]) {
+            if (rpm <= curve[lower]) {
+                return lower * 10.0f;
+            }
+            float t = (rpm - curve[lower]) / (curve[i] - curve[lower]);
+            return (lower + t * (i - lower)) * 10.0f;
+        }
+        if (lower < 0 || curve[i] >= curve[lower]) {
+            lower = i;
+        }
+    }
+    return -1.0f;
+}
+
+uint8_t RPMController::getCurveKnownPoints() const {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < CURVE_POINTS; i++) {
+        if (curve[i] >= 0.0f) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void RPMController::clearCurve() {
+    for (uint8_t i = 0; i < CURVE_POINTS; i++) {
+        curve[i] = -1.0f;
+    }
+}
+
+// ============================================================================
+// Metrics
+// ============================================================================
+
+void RPMController::recordPeriod(uint32_t periodUs, uint32_t nominalUs) {
+    if (periodCount == 0 || periodUs < periodMinUs) periodMinUs = periodUs;
+    if (periodCount == 0 || periodUs > periodMaxUs) periodMaxUs = periodUs;
+    periodCount++;
+    double deviation = (double)periodUs - (double)nominalUs;
+    jitterSq += deviation * deviation;
+}
+
+RPMController::Metrics RPMController::getMetrics() const {
+    Metrics m;
+    m.iterations = iterations;
+    m.periodMinUs = periodMinUs;
+    m.periodMaxUs = periodMaxUs;
+    m.jitterRmsUs = periodCount ? (float)sqrt(jitterSq / periodCount) : 0.0f;
+    m.error = lastError;
+    m.errorRms = sqrtf(errorSqAvg);
+    m.saturated = saturated;
+    m.saturationPct = iterations ? (float)saturated * 100.0f / (float)iterations : 0.0f;
+    m.output = output;
+    m.feedForward = lastFF;
+    m.integral = integral;
+    return m;
+}
+
+void RPMController::resetMetrics() {
+    iterations = 0;
+    saturated = 0;
+    periodCount = 0;
+    periodMinUs = 0;
+    periodMaxUs = 0;
+    jitterSq = 0.0;
+    errorSqAvg = 0.0f;
+}
@@ -0,0 +1,165 @@
+#ifndef RPM_CONTROLLER_H
+#define RPM_CONTROLLER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Fixed-rate PID speed controller with learned feed-forward
+ *
+ * Output is PWM duty (%), input is measured motor RPM. Each update():
+ *
+ *   duty = FF(target) + Kp·e + I + Kd·d(−rpm)/dt
+ *
+ * - Derivative acts on the measurement, so target steps do not kick.
+ * - Anti-windup: the integrator is frozen while the output is clamped at
+ *   a limit (or slew limited) in the direction the error is pushing.
+ * - The output change per update is limited to slewRate·dt.
+ * - FF is the inverse of a duty→RPM curve (one point per 10 % duty)
+ *   learned while the loop runs, so the integrator only has to trim.
+ *
+ * Loop period jitter, error and saturation are tracked as metrics.
+ * Has no Arduino or ESP-IDF dependencies; test/test_rpm_controller runs
+ * it against a simulated fan on the host for tuning.
+ */
+class RPMController {
+public:
+    static const uint8_t CURVE_POINTS = 11;     ///< 0, 10, ... 100 % duty
+
+    /**
+     * @brief Control loop metrics since the last reset
+     */
+    struct Metrics {
+        uint32_t iterations;        ///< Updates executed
+        uint32_t periodMinUs;       ///< Shortest measured loop period
+        uint32_t periodMaxUs;       ///< Longest measured loop period
+        float jitterRmsUs;          ///< RMS deviation from the nominal period
+        float error;                ///< Last error (target − measured, RPM)
+        float errorRms;             ///< RMS error over the last ~1 s (RPM)
+        uint32_t saturated;         ///< Updates clamped by limits or slew
+        float saturationPct;        ///< saturated / iterations × 100
+        float output;               ///< Last output duty (%)
+        float feedForward;          ///< Last feed-forward term (%)
+        float integral;             ///< Integrator contribution (%)
+    };
+
+    RPMController();
+
+    // ========================================================================
+    // Configuration
+    // ========================================================================
+
+    /**
+     * @brief Set PID gains (duty % per RPM, per RPM·s, per RPM/s)
+     * @return false if any gain is negative or not finite
+     */
+    bool setGains(float kp, float ki, float kd);
+    float getKp() const { return kp; }
+    float getKi() const { return ki; }
+    float getKd() const { return kd; }
+
+    /**
+     * @brief Set output slew limit
+     * @param percentPerSecond 0 (unlimited) or 0.1 - 10000 %/s
+     */
+    bool setSlewRate(float percentPerSecond);
+    float getSlewRate() const { return slewRate; }
+
+    /**
+     * @brief Set output limits (duty %)
+     */
+    bool setOutputLimits(float minDuty, float maxDuty);
+    float getOutputMin() const { return outMin; }
+    float getOutputMax() const { return outMax; }
+
+    void setFeedForwardEnabled(bool enable) { ffEnabled = enable; }
+    bool isFeedForwardEnabled() const { return ffEnabled; }
+
+    // ========================================================================
+    // Control
+    // ========================================================================
+
+    void setTarget(float rpm) { target = rpm; }
+    float getTarget() const { return target; }
+
+    /**
+     * @brief Bumpless start from the current output
+     * @param currentDuty Duty already applied to the motor
+     * @param measuredRpm Current measurement (derivative reference)
+     */
+    void start(float currentDuty, float measuredRpm);
+
+    /**
+     * @brief Run one control step
+     * @param measuredRpm Latest filtered speed
+     * @param dt Seconds since the previous step (measured)
+     * @return New duty (%)
+     */
+    float update(float measuredRpm, float dt);
+
+    // ========================================================================
+    // Feed-forward curve
+    // ========================================================================
+
+    /**
+     * @brief Update the duty→RPM curve from a steady operating point
+     *
+     * Only the curve point nearest to `duty` is adjusted, and only when
+     * duty is within 2.5 % of it.
+     */
+    void learn(float duty, float rpm);
+
+    /**
+     * @brief Duty expected to reach `rpm`, or -1 if the curve cannot tell
+     */
+    float feedForward(float rpm) const;
+
+    /**
+     * @brief Curve point (RPM at index × 10 % duty, < 0 = unknown)
+     */
+    float getCurvePoint(uint8_t index) const { return index < CURVE_POINTS ? curve[index] : -1.0f; }
+    void setCurvePoint(uint8_t index, float rpm) { if (index < CURVE_POINTS) curve[index] = rpm; }
+    uint8_t getCurveKnownPoints() const;
+    void clearCurve();
+
+    // ========================================================================
+    // Metrics
+    // ========================================================================
+
+    /**
+     * @brief Record the measured interval between two loop wake-ups
+     */
+    void recordPeriod(uint32_t periodUs, uint32_t nominalUs);
+
+    Metrics getMetrics() const;
+    void resetMetrics();
+
+private:
+    float kp = 0.01f;
+    float ki = 0.05f;
+    float kd = 0.0f;
+    float slewRate = 200.0f;
+    float outMin = 0.0f;
+    float outMax = 100.0f;
+    bool ffEnabled = true;
+
+    float target = 0.0f;
+    float integral = 0.0f;
+    float prevMeasured = 0.0f;
+    float output = 0.0f;
+    float lastFF = 0.0f;
+    float lastError = 0.0f;
+
+    float curve[CURVE_POINTS];
+
+    // Metrics
+    uint32_t iterations = 0;
+    uint32_t saturated = 0;
+    uint32_t periodCount = 0;
+    uint32_t periodMinUs = 0;
+    uint32_t periodMaxUs = 0;
+    double jitterSq = 0.0;
+    float errorSqAvg = 0.0f;
+};
+
+#endif // RPM_CONTROLLER_H
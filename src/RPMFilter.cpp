@@ -0,0 +1,320 @@
+#include "RPMFilter.h"
+#include <math.h>
+#include <string.h>
+
+RPMFilter::RPMFilter(uint32_t timerClockHz)
+    : timerClock(timerClockHz) {
+    setMaxGateMs(maxGateMs);
+    memset(recentPeriods, 0, sizeof(recentPeriods));
+    memset(window, 0, sizeof(window));
+}
+
+// ============================================================================
+// Configuration
+// ============================================================================
+
+bool RPMFilter::setFilterType(FilterType type) {
+    if (type > FILTER_WINDOW) {
+        return false;
+    }
+    filterType = type;
+    windowCount = 0;
+    windowIndex = 0;
+    emaValid = false;
+    return true;
+}
+
+bool RPMFilter::setWindowSize(uint8_t size) {
+    if (size < 1 || size > MAX_WINDOW) {
+        return false;
+    }
+    windowSize = size;
+    windowCount = 0;
+    windowIndex = 0;
+    return true;
+}
+
+bool RPMFilter::setEmaAlpha(float alpha) {
+    if (!(alpha >= 0.01f && alpha <= 1.0f)) {
+        return false;
+    }
+    emaAlpha = alpha;
+    return true;
+}
+
+bool RPMFilter::setSamplePeriods(uint16_t periods) {
+    if (periods < 1 || periods > MAX_SAMPLE_PERIODS) {
+        return false;
+    }
+    samplePeriods = periods;
+    return true;
+}
+
+bool RPMFilter::setMaxGateMs(uint16_t ms) {
+    if (ms < 1 || ms > 1000) {
+        return false;
+    }
+    maxGateMs = ms;
+    maxGateTicks = (uint32_t)((uint64_t)timerClock * ms / 1000);
+    return true;
+}
+
+bool RPMFilter::setOutlierTolerance(float percent) {
+    if (percent != 0.0f && !(percent >= 5.0f && percent <= 90.0f)) {
+        return false;
+    }
+    outlierTolerance = percent;
+    recentCount = 0;
+    recentIndex = 0;
+    rejectScore = 0;
+    return true;
+}
+
+void RPMFilter::setTimerClock(uint32_t hz) {
+    if (hz == 0 || hz == timerClock) {
+        return;
+    }
+    timerClock = hz;
+    setMaxGateMs(maxGateMs);
+    reset();
+}
+
+bool RPMFilter::setEdgeDivider(uint16_t divider) {
+    if (divider < 1 || divider > 256) {
+        return false;
+    }
+    if (divider != edgeDivider) {
+        edgeDivider = divider;
+        markGap();  // Queued span no longer matches the new divider
+    }
+    return true;
+}
+
+const char* RPMFilter::getFilterName(FilterType type) {
+    switch (type) {
+        case FILTER_NONE:   return "NONE";
+        case FILTER_MEDIAN: return "MEDIAN";
+        case FILTER_EMA:    return "EMA";
+        case FILTER_WINDOW: return "WINDOW";
+        default:            return "UNKNOWN";
+    }
+}
+
+// ============================================================================
+// Measurement
+// ============================================================================
+
+bool RPMFilter::addEdge(uint32_t timestamp) {
+    statEdges++;
+
+    if (!havePrevEdge) {
+        havePrevEdge = true;
+        restartGate(timestamp);
+        return false;
+    }
+
+    uint32_t period = timestamp - prevEdge;  // Unsigned subtraction handles counter wrap
+    if (period == 0) {
+        return false;
+    }
+
+    if (isOutlier(period)) {
+        statOutliers++;
+        if (period > recentMedian()) {
+            // Missed edge(s): the span is no longer a whole number of known periods
+            restartGate(timestamp);
+        }
+        // Glitch edge: ignore it and keep measuring from the previous real edge
+        return false;
+    }
+
+    pushRecent(period);
+    prevEdge = timestamp;
+    gatePeriods++;
+
+    uint32_t span = timestamp - gateStart;
+    if (gatePeriods < samplePeriods && span < maxGateTicks) {
+        return false;
+    }
+
+    float raw = (float)((double)gatePeriods * edgeDivider * timerClock / span);
+    restartGate(timestamp);
+
+    addSample(raw);
+    return true;
+}
+
+void RPMFilter::addSample(float hz) {
+    rawFrequency = hz;
+    applyFilter(hz);
+    updateStatistics(hz);
+}
+
+void RPMFilter::markGap() {
+    havePrevEdge = false;
+    gatePeriods = 0;
+}
+
+void RPMFilter::reset() {
+    havePrevEdge = false;
+    gatePeriods = 0;
+    recentCount = 0;
+    recentIndex = 0;
+    rejectScore = 0;
+    windowCount = 0;
+    windowIndex = 0;
+    emaValid = false;
+    rawFrequency = 0.0f;
+    filteredFrequency = 0.0f;
+}
+
+void RPMFilter::resetStatistics() {
+    statEdges = 0;
+    statSamples = 0;
+    statOutliers = 0;
+    statMin = 0.0f;
+    statMax = 0.0f;
+    statMean = 0.0;
+    statM2 = 0.0;
+}
+
+RPMFilter::Statistics RPMFilter::getStatistics() const {
+    Statistics stats;
+    stats.edges = statEdges;
+    stats.samples = statSamples;
+    stats.outliers = statOutliers;
+    stats.min = statMin;
+    stats.max = statMax;
+    stats.mean = (float)statMean;
+    stats.stddev = statSamples > 1 ? (float)sqrt(statM2 / (statSamples - 1)) : 0.0f;
+    return stats;
+}
+
+// ============================================================================
+// Internals
+// ============================================================================
+
+void RPMFilter::restartGate(uint32_t timestamp) {
+    prevEdge = timestamp;
+    gateStart = timestamp;
+    gatePeriods = 0;
+}
+
+bool RPMFilter::isOutlier(uint32_t period) {
+    if (outlierTolerance <= 0.0f || recentCount < RECENT_PERIODS) {
+        return false;
+    }
+
+    uint32_t ref = recentMedian();
+    float deviation = fabsf((float)period - (float)ref) / (float)ref * 100.0f;
+    if (deviation <= outlierTolerance) {
+        if (rejectScore > 0) {
+            rejectScore--;
+        }
+        return false;
+    }
+
+    // Rejections outpacing accepts mean a real speed change, not noise.
+    // Leaky score so that alternating reject/accept (frequency doubled,
+    // every other edge looks like a glitch) still triggers a relearn.
+    rejectScore += 2;
+    if (rejectScore > RELEARN_SCORE) {
+        rejectScore = 0;
+        recentCount = 0;
+        recentIndex = 0;
+        return false;
+    }
+    return true;
+}
+
+void RPMFilter::pushRecent(uint32_t period) {
+    recentPeriods[recentIndex] = period;
+    recentIndex = (recentIndex + 1) % RECENT_PERIODS;
+    if (recentCount < RECENT_PERIODS) {
+        recentCount++;
+    }
+}
+
+uint32_t RPMFilter::recentMedian() const {
+    if (recentCount == 0) {
+        return 0;
+    }
+    uint32_t sorted[RECENT_PERIODS];
+    memcpy(sorted, recentPeriods, recentCount * sizeof(uint32_t));
+    for (uint8_t i = 1; i < recentCount; i++) {
+        uint32_t v = sorted[i];
+        int8_t j = i - 1;
+        while (j >= 0 && sorted[j] > v) {
+            sorted[j + 1] = sorted[j];
+            j--;
+        }
+        sorted[j + 1] = v;
+    }
+    return sorted[recentCount / 2];
+}
+
+void RPMFilter::applyFilter(float raw) {
+    switch (filterType) {
+        case FILTER_EMA:
+            if (!emaValid) {
+                emaValue = raw;
+                emaValid = true;
+            } else {
+                emaValue += emaAlpha * (raw - emaValue);
+            }
+            filteredFrequency = emaValue;
+            return;
+
+        case FILTER_MEDIAN:
+        case FILTER_WINDOW:
+            window[windowIndex] = raw;
+            windowIndex = (windowIndex + 1) % windowSize;
+            if (windowCount < windowSize) {
+                windowCount++;
+            }
+            break;
+
+        case FILTER_NONE:
+        default:
+            filteredFrequency = raw;
+            return;
+    }
+
+    if (filterType == FILTER_WINDOW) {
+        float sum = 0.0f;
+        for (uint8_t i = 0; i < windowCount; i++) {
+            sum += window[i];
+        }
+        filteredFrequency = sum / windowCount;
+        return;
+    }
+
+    float sorted[MAX_WINDOW];
+    memcpy(sorted, window, windowCount * sizeof(float));
+    for (uint8_t i = 1; i < windowCount; i++) {
+        float v = sorted[i];
+        int8_t j = i - 1;
+        while (j >= 0 && sorted[j] > v) {
+            sorted[j + 1] = sorted[j];
+            j--;
+        }
+        sorted[j + 1] = v;
+    }
+    filteredFrequency = (windowCount & 1)
+        ? sorted[windowCount / 2]
+        : (sorted[windowCount / 2 - 1] + sorted[windowCount / 2]) * 0.5f;
+}
+
+void RPMFilter::updateStatistics(float raw) {
+    statSamples++;
+    if (statSamples == 1) {
+        statMin = raw;
+        statMax = raw;
+    } else {
+        if (raw < statMin) statMin = raw;
+        if (raw > statMax) statMax = raw;
+    }
+    double delta = raw - statMean;
+    statMean += delta / statSamples;
+    statM2 += delta * (raw - statMean);
+}
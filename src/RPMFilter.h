@@ -0,0 +1,309 @@
+#ifndef RPM_FILTER_H
+#define RPM_FILTER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Lock-free single-producer/single-consumer ring of capture timestamps
+ *
+ * The producer is the capture ISR, the consumer is one task. push() and
+ * pop() are forced inline so they can be used from IRAM interrupt code.
+ * When the ring is full, new edges are dropped and counted, and the next
+ * edge that fits is flagged so the consumer knows the sequence has a gap.
+ *
+ * @tparam N Capacity (power of two)
+ */
+template <size_t N>
+class CaptureRing {
+    static_assert((N & (N - 1)) == 0, "CaptureRing size must be a power of two");
+
+public:
+    /**
+     * @brief Push a timestamp (producer side, ISR safe)
+     * @return false if the ring was full
+     */
+    inline __attribute__((always_inline)) bool push(uint32_t value) {
+        uint32_t h = head;
+        if (h - __atomic_load_n(&tail, __ATOMIC_ACQUIRE) >= N) {
+            drops++;
+            gapPending = true;
+            return false;
+        }
+        buffer[h & (N - 1)] = value;
+        gapBefore[h & (N - 1)] = gapPending;
+        gapPending = false;
+        __atomic_store_n(&head, h + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    /**
+     * @brief Pop the oldest timestamp (consumer side)
+     * @param value Receives the timestamp
+     * @param gap Receives true if edges were dropped just before this one
+     * @return false if the ring was empty
+     */
+    inline __attribute__((always_inline)) bool pop(uint32_t& value, bool& gap) {
+        uint32_t t = tail;
+        if (__atomic_load_n(&head, __ATOMIC_ACQUIRE) == t) {
+            return false;
+        }
+        value = buffer[t & (N - 1)];
+        gap = gapBefore[t & (N - 1)];
+        __atomic_store_n(&tail, t + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    /**
+     * @brief Number of queued timestamps
+     */
+    size_t size() const { return head - tail; }
+
+    /**
+     * @brief Number of edges dropped because the ring was full
+     */
+    uint32_t getDrops() const { return drops; }
+
+    /**
+     * @brief Discard queued timestamps (consumer side)
+     */
+    void clear() { __atomic_store_n(&tail, __atomic_load_n(&head, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE); }
+
+private:
+    uint32_t buffer[N];
+    bool gapBefore[N];
+    bool gapPending = false;    // Producer-only
+    volatile uint32_t head = 0;
+    volatile uint32_t tail = 0;
+    volatile uint32_t drops = 0;
+};
+
+/**
+ * @brief Reciprocal-counting frequency estimator with digital filtering
+ *
+ * Fed with raw capture timestamps, one per rising edge. A raw sample is
+ * computed over several periods: samplePeriods edges, or fewer if the
+ * gate time runs out first at low frequency. Then:
+ *
+ *   raw = periods × timerClock / (t_last − t_first)
+ *
+ * Periods that deviate from the median of recent periods by more than
+ * the outlier tolerance are rejected. Short periods are tach glitches;
+ * long periods are missed edges. When rejections keep outpacing accepts
+ * the reference is relearned, so a real speed step is still followed.
+ *
+ * Raw samples pass through the selected filter (median, EMA or moving
+ * window) and are tracked in min/max/mean/stddev statistics.
+ *
+ * Has no Arduino or ESP-IDF dependencies so it can be built on a host.
+ */
+class RPMFilter {
+public:
+    /**
+     * @brief Filter applied to raw reciprocal samples
+     */
+    enum FilterType : uint8_t {
+        FILTER_NONE = 0,    ///< Raw samples
+        FILTER_MEDIAN,      ///< Median of last windowSize samples
+        FILTER_EMA,         ///< Exponential moving average (alpha)
+        FILTER_WINDOW       ///< Mean of last windowSize samples
+    };
+
+    /**
+     * @brief Statistics over raw samples since the last reset
+     */
+    struct Statistics {
+        uint32_t edges;         ///< Edges consumed
+        uint32_t samples;       ///< Raw samples produced
+        uint32_t outliers;      ///< Periods rejected as glitches / missed edges
+        float min;              ///< Minimum raw frequency (Hz)
+        float max;              ///< Maximum raw frequency (Hz)
+        float mean;             ///< Mean raw frequency (Hz)
+        float stddev;           ///< Standard deviation of raw frequency (Hz)
+    };
+
+    static const uint8_t MAX_WINDOW = 32;
+    static const uint16_t MAX_SAMPLE_PERIODS = 256;
+
+    /**
+     * @brief Constructor
+     * @param timerClockHz Capture timer clock (MCPWM capture runs on 80 MHz APB)
+     */
+    explicit RPMFilter(uint32_t timerClockHz = 80000000);
+
+    // ========================================================================
+    // Configuration
+    // ========================================================================
+
+    bool setFilterType(FilterType type);
+    FilterType getFilterType() const { return filterType; }
+
+    /**
+     * @brief Set median/window length
+     * @param size 1 - MAX_WINDOW samples
+     */
+    bool setWindowSize(uint8_t size);
+    uint8_t getWindowSize() const { return windowSize; }
+
+    /**
+     * @brief Set EMA smoothing factor
+     * @param alpha 0.01 - 1.0 (1.0 = no smoothing)
+     */
+    bool setEmaAlpha(float alpha);
+    float getEmaAlpha() const { return emaAlpha; }
+
+    /**
+     * @brief Set number of periods per reciprocal sample
+     * @param periods 1 - MAX_SAMPLE_PERIODS
+     */
+    bool setSamplePeriods(uint16_t periods);
+    uint16_t getSamplePeriods() const { return samplePeriods; }
+
+    /**
+     * @brief Set maximum gate time per sample
+     *
+     * At low frequency a sample is emitted after this time even if fewer
+     * than samplePeriods periods were seen.
+     * @param ms 1 - 1000 ms
+     */
+    bool setMaxGateMs(uint16_t ms);
+    uint16_t getMaxGateMs() const { return maxGateMs; }
+
+    /**
+     * @brief Set outlier rejection tolerance
+     * @param percent 0 (disabled) or 5 - 90 % deviation from recent median period
+     */
+    bool setOutlierTolerance(float percent);
+    float getOutlierTolerance() const { return outlierTolerance; }
+
+    /**
+     * @brief Set capture timer clock
+     */
+    void setTimerClock(uint32_t hz);
+
+    /**
+     * @brief Set input periods represented by one captured edge
+     *
+     * Matches the capture prescaler: with a prescaler of 16 every
+     * timestamp is 16 input periods after the previous one.
+     * @param divider 1 - 256
+     */
+    bool setEdgeDivider(uint16_t divider);
+    uint16_t getEdgeDivider() const { return edgeDivider; }
+
+    static const char* getFilterName(FilterType type);
+
+    // ========================================================================
+    // Measurement
+    // ========================================================================
+
+    /**
+     * @brief Feed one capture timestamp
+     * @param timestamp Capture timer value at the edge (wraps at 2^32)
+     * @return true if a new raw sample was produced
+     */
+    bool addEdge(uint32_t timestamp);
+
+    /**
+     * @brief Feed a frequency measured elsewhere (e.g. gated edge counting)
+     *
+     * Goes through the same filter and statistics as reciprocal samples.
+     * @param hz Measured frequency in Hz
+     */
+    void addSample(float hz);
+
+    /**
+     * @brief Get filtered frequency
+     * @return Frequency in Hz, 0 until the first sample
+     */
+    float getFrequency() const { return filteredFrequency; }
+
+    /**
+     * @brief Get last unfiltered reciprocal sample
+     * @return Frequency in Hz
+     */
+    float getRawFrequency() const { return rawFrequency; }
+
+    /**
+     * @brief Mark lost edges; the next edge starts a new gate
+     *
+     * Keeps the filter output and outlier reference, only discards the
+     * partial sample that would otherwise span the missing edges.
+     */
+    void markGap();
+
+    /**
+     * @brief Drop signal state (call when the input is lost); keeps configuration and statistics
+     */
+    void reset();
+
+    /**
+     * @brief Clear statistics
+     */
+    void resetStatistics();
+
+    /**
+     * @brief Get statistics
+     */
+    Statistics getStatistics() const;
+
+    /**
+     * @brief Raw samples produced since the last statistics reset
+     *
+     * Cheap way for a consumer to tell whether a new sample arrived.
+     */
+    uint32_t getSampleCount() const { return statSamples; }
+
+private:
+    // Configuration
+    uint32_t timerClock;
+    uint16_t edgeDivider = 1;
+    FilterType filterType = FILTER_MEDIAN;
+    uint8_t windowSize = 5;
+    float emaAlpha = 0.2f;
+    uint16_t samplePeriods = 8;
+    uint16_t maxGateMs = 50;
+    uint32_t maxGateTicks = 0;
+    float outlierTolerance = 0.0f;
+
+    // Edge / gate state
+    bool havePrevEdge = false;
+    uint32_t prevEdge = 0;
+    uint32_t gateStart = 0;
+    uint16_t gatePeriods = 0;
+
+    // Recent periods used as the outlier reference
+    static const uint8_t RECENT_PERIODS = 5;
+    static const uint8_t RELEARN_SCORE = 6;
+    uint32_t recentPeriods[RECENT_PERIODS];
+    uint8_t recentCount = 0;
+    uint8_t recentIndex = 0;
+    uint8_t rejectScore = 0;
+
+    // Filter state
+    float window[MAX_WINDOW];
+    uint8_t windowCount = 0;
+    uint8_t windowIndex = 0;
+    float emaValue = 0.0f;
+    bool emaValid = false;
+    float rawFrequency = 0.0f;
+    float filteredFrequency = 0.0f;
+
+    // Statistics (Welford)
+    uint32_t statEdges = 0;
+    uint32_t statSamples = 0;
+    uint32_t statOutliers = 0;
+    float statMin = 0.0f;
+    float statMax = 0.0f;
+    double statMean = 0.0;
+    double statM2 = 0.0;
+
+    bool isOutlier(uint32_t period);
+    void pushRecent(uint32_t period);
+    uint32_t recentMedian() const;
+    void applyFilter(float raw);
+    void updateStatistics(float raw);
+    void restartGate(uint32_t timestamp);
+};
+
+#endif // RPM_FILTER_H
@@ -2,26 +2,72 @@
 #include "driver/gpio.h"
 #include "soc/mcpwm_periph.h"
 #include "soc/mcpwm_struct.h"
+#include "hal/mcpwm_ll.h"
+#include "soc/soc_caps.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "driver/timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "esp_rom_gpio.h"
+#include "soc/uart_periph.h"
+#include "soc/gpio_sig_map.h"
+#include "soc/gpio_periph.h"
+#include "soc/io_mux_reg.h"
 #include <Preferences.h>
+#include <SPIFFS.h>
+#include <algorithm>
 
 
+// MCPWM source clock before the group prescaler (160 MHz PLL on ESP32-S3)
+#ifdef SOC_MCPWM_BASE_CLK_HZ
+#define UART1_MCPWM_BASE_CLK_HZ SOC_MCPWM_BASE_CLK_HZ
+#else
+#define UART1_MCPWM_BASE_CLK_HZ 160000000ULL
+#endif
+
+// GPIO matrix constant inputs (idle levels for a disconnected peripheral input)
+#ifndef GPIO_MATRIX_CONST_ONE_INPUT
+#define GPIO_MATRIX_CONST_ONE_INPUT 0x38
+#endif
+#ifndef GPIO_MATRIX_CONST_ZERO_INPUT
+#define GPIO_MATRIX_CONST_ZERO_INPUT 0x3C
+#endif
+
 // NVS namespace for UART1 settings persistence
 static const char* NVS_NAMESPACE = "uart1_settings";
 
-// Define static variables for MCPWM Capture
-volatile uint32_t UART1Mux::capturePeriod = 0;
-volatile bool UART1Mux::newCaptureAvailable = false;
-volatile unsigned long UART1Mux::lastCaptureTime = 0;
+// SPIFFS file holding the sequencer profile
+static const char* SEQUENCE_FILE = "/sequence.csv";
+
+namespace {
+
+// Holds rpmMeasureLock for a scope. The lock is recursive, so PWM setters
+// can call each other and the stop*() teardowns while holding it.
+class MeasureLockGuard {
+public:
+    explicit MeasureLockGuard(SemaphoreHandle_t lock) : lock(lock) {
+        xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    }
+    ~MeasureLockGuard() { xSemaphoreGiveRecursive(lock); }
+
+private:
+    SemaphoreHandle_t lock;
+};
+
+}  // namespace
 
 UART1Mux::UART1Mux() {
     // Initialize GPIO 12 for PWM parameter change pulse (glitch observation)
     initPWMChangePulse();
+
+    rpmMeasureLock = xSemaphoreCreateRecursiveMutex();
 }
 
 UART1Mux::~UART1Mux() {
+    setStallDetection(false);
     disable();
+    releaseDrivers();
 }
 
 // ============================================================================
@@ -40,27 +86,12 @@ bool UART1Mux::setModeUART(uint32_t baudRate, uart_stop_bits_t stopBits,
         return reconfigureUART(baudRate, stopBits, parity, dataBits);
     }
 
-    // Disable current mode
-    disable();
-
-    // Save UART configuration
-    uartBaudRate = baudRate;
-    uartStopBits = stopBits;
-    uartParity = parity;
-    uartDataBits = dataBits;
-
-    // Initialize UART
-    if (!initUART()) {
+    if (!switchToUART(baudRate, stopBits, parity, dataBits)) {
         Serial.println("[UART1] Failed to initialize UART mode");
         return false;
     }
 
-    currentMode = MODE_UART;
-    Serial.printf("[UART1] Switched to UART mode: %u baud\n", baudRate);
-
-    // Settling time
-    delay(10);
-
+    Serial.printf("[UART1] Switched to UART mode: %u baud (%u µs)\n", baudRate, switchStats.lastUs);
     return true;
 }
 
@@ -70,44 +101,19 @@ bool UART1Mux::setModePWM_RPM() {
         return true;
     }
 
-    // Disable current mode
-    disable();
-
-    // Initialize PWM and RPM capture
-    bool pwmOK = initPWM();
-    bool rpmOK = initRPM();
-
-    if (!pwmOK || !rpmOK) {
+    if (!switchToPWM_RPM()) {
         Serial.println("[UART1] Failed to initialize PWM/RPM mode");
-        disable();
         return false;
     }
 
-    currentMode = MODE_PWM_RPM;
-    Serial.println("[UART1] Switched to PWM/RPM mode");
-
-    // Settling time
-    delay(10);
-
+    Serial.printf("[UART1] Switched to PWM/RPM mode (%u µs)\n", switchStats.lastUs);
     return true;
 }
 
 void UART1Mux::disable() {
-    switch (currentMode) {
-        case MODE_UART:
-            deinitUART();
-            break;
-        case MODE_PWM_RPM:
-            deinitPWM();
-            deinitRPM();
-            break;
-        case MODE_DISABLED:
-            // Already disabled
-            break;
-    }
-
+    // Drivers stay installed; only the pins are handed back
+    parkMode();
     releasePins();
-    currentMode = MODE_DISABLED;
 }
 
 const char* UART1Mux::getModeName() const {
@@ -119,6 +125,69 @@ const char* UART1Mux::getModeName() const {
     }
 }
 
+bool UART1Mux::benchmarkModeSwitch(uint32_t cycles, ModeSwitchBench& result) {
+    if (cycles == 0 || cycles > MAX_BENCH_CYCLES) {
+        return false;
+    }
+
+    size_t size = sizeof(uint32_t) * cycles;
+    uint32_t* toUART = static_cast<uint32_t*>(heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+    uint32_t* toPWM = static_cast<uint32_t*>(heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+    if (!toUART || !toPWM) {
+        free(toUART);
+        free(toPWM);
+        toUART = static_cast<uint32_t*>(heap_caps_malloc(size, MALLOC_CAP_8BIT));
+        toPWM = static_cast<uint32_t*>(heap_caps_malloc(size, MALLOC_CAP_8BIT));
+    }
+    if (!toUART || !toPWM) {
+        free(toUART);
+        free(toPWM);
+        return false;
+    }
+
+    Mode originalMode = currentMode;
+    bool originalPWMEnabled = pwmEnabled;
+
+    // Warm-up cycle kept out of the percentiles so one-time driver installation is not measured
+    bool ok = switchToPWM_RPM() && switchToUART(uartBaudRate, uartStopBits, uartParity, uartDataBits);
+    uint32_t timeoutsBefore = switchStats.settleTimeouts;
+
+    uint32_t done = 0;
+    while (ok && done < cycles) {
+        ok = switchToPWM_RPM();
+        toPWM[done] = switchStats.lastUs;
+        ok = ok && switchToUART(uartBaudRate, uartStopBits, uartParity, uartDataBits);
+        toUART[done] = switchStats.lastUs;
+        if (ok) {
+            done++;
+        }
+        // Let the idle task run (task watchdog) without touching the measured windows
+        if ((done & 63) == 0) {
+            vTaskDelay(1);
+        }
+    }
+
+    // Back to the mode the benchmark started from
+    if (originalMode == MODE_PWM_RPM) {
+        switchToPWM_RPM();
+        if (!originalPWMEnabled) {
+            setPWMEnabled(false);
+        }
+    } else if (originalMode == MODE_DISABLED) {
+        disable();
+    }
+
+    result = {};
+    result.cycles = done;
+    result.settleTimeouts = switchStats.settleTimeouts - timeoutsBefore;
+    summarizeLatencies(toUART, done, result.toUART);
+    summarizeLatencies(toPWM, done, result.toPWM);
+
+    free(toUART);
+    free(toPWM);
+    return ok;
+}
+
 // ============================================================================
 // UART Mode Functions
 // ============================================================================
@@ -128,12 +197,7 @@ int UART1Mux::write(const uint8_t* data, size_t len, uint32_t timeoutMs) {
         return -1;
     }
 
-    int written = uart_write_bytes(uartNum, (const char*)data, len);
-    if (written > 0) {
-        uartTxBytes += written;
-    } else {
-        uartErrors++;
-    }
+    int written = txCombiner.write(data, len);     // Staged bytes go first
 
     if (timeoutMs > 0) {
         uart_wait_tx_done(uartNum, pdMS_TO_TICKS(timeoutMs));
@@ -157,6 +221,7 @@ int UART1Mux::read(uint8_t* buffer, size_t maxLen, uint32_t timeoutMs) {
     int len = uart_read_bytes(uartNum, buffer, maxLen, pdMS_TO_TICKS(timeoutMs));
     if (len > 0) {
         uartRxBytes += len;
+        tapTraffic(buffer, len, false);
     } else if (len < 0) {
         uartErrors++;
     }
@@ -174,6 +239,30 @@ int UART1Mux::available() {
     return (int)len;
 }
 
+int UART1Mux::queueTx(const uint8_t* data, size_t len) {
+    int written = uart_write_bytes(uartNum, (const char*)data, len);
+    if (written > 0) {
+        uartTxBytes += written;
+        tapTraffic(data, written, true);
+    } else {
+        uartErrors++;
+    }
+    return written;
+}
+
+void UART1Mux::setTrafficTap(TrafficTap tap, void* arg) {
+    // Argument first: a reader seeing the new tap also sees its argument
+    trafficTapArg = arg;
+    trafficTap = tap;
+}
+
+void UART1Mux::tapTraffic(const uint8_t* data, size_t length, bool tx) {
+    TrafficTap tap = trafficTap;
+    if (tap) {
+        tap(data, length, tx, trafficTapArg);
+    }
+}
+
 void UART1Mux::clearRxBuffer() {
     if (currentMode != MODE_UART) {
         return;
@@ -224,62 +313,63 @@ bool UART1Mux::reconfigureUART(uint32_t baudRate, uart_stop_bits_t stopBits,
 // PWM/RPM Mode Functions
 // ============================================================================
 
-bool UART1Mux::setPWMFrequency(uint32_t frequency) {
+bool UART1Mux::setPWMFrequency(uint32_t frequency, PWMSynthResult* result) {
+    MeasureLockGuard guard(rpmMeasureLock);
     if (currentMode != MODE_PWM_RPM) {
         return false;
     }
 
+    stopRamp();
+    stopRPMLoop();
+    stopSequence();
+
     if (!validatePWMFrequency(frequency)) {
         return false;
     }
 
+    PWMSynthResult synth;
+    if (!PWMSynth::synthesize(mcpwmClockFreq, frequency, pwmPrescaler, pwmSynthConstraints, synth)) {
+        Serial.printf("[UART1] ❌ %u Hz cannot be synthesized from %u Hz clock\n", frequency, mcpwmClockFreq);
+        return false;
+    }
+
     // Output pulse on GPIO 12 BEFORE changing frequency (to observe glitches)
     outputPWMChangePulse();
 
-    // TRULY GLITCH-FREE UPDATE USING LL API
-    // Calculate new prescaler and period for target frequency
-    uint32_t new_prescaler, new_period;
-    calculatePWMParameters(frequency, new_prescaler, new_period);
-
-    // Check if prescaler needs to change
-    if (new_prescaler != pwmPrescaler) {
-        // Prescaler change required - must use high-level API (will stop PWM briefly)
-        Serial.printf("[UART1] ⚠️ Prescaler change required (%u → %u), brief PWM stop unavoidable\n",
-                     pwmPrescaler, new_prescaler);
-
-        esp_err_t err = mcpwm_set_frequency(MCPWM_UNIT_UART1_PWM, MCPWM_TIMER_UART1_PWM, frequency);
-        if (err != ESP_OK) {
-            Serial.printf("[UART1] PWM frequency set failed: %s\n", esp_err_to_name(err));
-            return false;
-        }
-
-        // Update stored values
-        pwmPrescaler = new_prescaler;
-        pwmPeriod = new_period;
-        pwmFrequency = frequency;
-
-        Serial.printf("[UART1] PWM frequency updated: %u Hz (prescaler=%u, period=%u)\n",
-                     frequency, pwmPrescaler, pwmPeriod);
-    } else {
-        // Same prescaler - update period only using LL API (no PWM stop!)
-        updatePWMRegistersDirectly(new_period, pwmDuty);
+    if (synth.prescaler != pwmPrescaler) {
+        // The prescaler field is not shadowed: it applies immediately, so the
+        // cycle in progress runs at the new tick rate (no stop, one odd cycle)
+        Serial.printf("[UART1] ⚠️ Prescaler change required (%u → %u), not glitch-free\n",
+                     pwmPrescaler, synth.prescaler);
+        pwmPrescaler = synth.prescaler;
+    }
 
-        // Update stored values
-        pwmPeriod = new_period;
-        pwmFrequency = frequency;
+    // Period + compare latch together at TEZ
+    updatePWMRegistersDirectly(synth.period, pwmDuty);
 
-        Serial.printf("[UART1] PWM frequency updated (no-stop): %u Hz (period=%u)\n",
-                     frequency, pwmPeriod);
+    pwmPeriod = synth.period;
+    pwmFrequency = frequency;
+    pwmSynth = synth;
+    if (result) {
+        *result = synth;
     }
 
+    Serial.printf("[UART1] PWM frequency updated: %u Hz → %.3f Hz (%+.1f ppm, prescaler=%u, period=%u)\n",
+                 frequency, synth.frequency, synth.errorPpm, pwmPrescaler, pwmPeriod);
+
     return true;
 }
 
 bool UART1Mux::setPWMDuty(float duty) {
+    MeasureLockGuard guard(rpmMeasureLock);
     if (currentMode != MODE_PWM_RPM) {
         return false;
     }
 
+    stopRamp();
+    stopRPMLoop();
+    stopSequence();
+
     if (duty < 0.0 || duty > 100.0) {
         return false;
     }
@@ -298,18 +388,23 @@ bool UART1Mux::setPWMDuty(float duty) {
     return true;
 }
 
-bool UART1Mux::setPWMFrequencyAndDuty(uint32_t frequency, float duty) {
+bool UART1Mux::setPWMFrequencyAndDuty(uint32_t frequency, float duty, PWMSynthResult* result) {
     // ==== ENTRY DEBUG ====
     Serial.printf("[UART1] 🚀 setPWMFrequencyAndDuty() ENTRY: freq=%u Hz, duty=%.1f%%\n", frequency, duty);
     Serial.printf("[UART1] 📊 Current: prescaler=%u, period=%u, freq=%u, duty=%.1f\n",
                      pwmPrescaler, pwmPeriod, pwmFrequency, pwmDuty);
     Serial.flush();
 
+    MeasureLockGuard guard(rpmMeasureLock);
     if (currentMode != MODE_PWM_RPM) {
         Serial.println("[UART1] ❌ ABORT: Not in PWM_RPM mode");
         return false;
     }
 
+    stopRamp();
+    stopRPMLoop();
+    stopSequence();
+
     // Validate parameters
     if (!validatePWMFrequency(frequency)) {
         Serial.println("[UART1] ❌ ABORT: Frequency validation failed");
@@ -325,88 +420,111 @@ bool UART1Mux::setPWMFrequencyAndDuty(uint32_t frequency, float duty) {
     outputPWMChangePulse();
 
     // SMART FREQUENCY UPDATE STRATEGY:
-    // Try to achieve target frequency using CURRENT prescaler first
-    // This maximizes use of shadow register mode (glitch-free)
-
-    // Use detected clock frequency instead of hardcoded 80MHz
-    uint32_t target_ticks = mcpwmClockFreq / frequency;
-
-    // Try using current prescaler
-    uint32_t new_period_with_current_prescaler = target_ticks / pwmPrescaler;
+    // The synthesizer keeps the CURRENT prescaler whenever its error is within
+    // tolerance, which keeps the update on the glitch-free shadow register path
+    PWMSynthResult synth;
+    if (!PWMSynth::synthesize(mcpwmClockFreq, frequency, pwmPrescaler, pwmSynthConstraints, synth)) {
+        Serial.printf("[UART1] ❌ ABORT: %u Hz cannot be synthesized from %u Hz clock\n",
+                     frequency, mcpwmClockFreq);
+        return false;
+    }
 
-    Serial.printf("[UART1] 🧮 Clock=%u Hz, Target freq=%u Hz, current prescaler=%u\n",
-                 mcpwmClockFreq, frequency, pwmPrescaler);
-    Serial.printf("[UART1] 🧮 New period with current prescaler: %u ticks\n", new_period_with_current_prescaler);
-    Serial.flush();
+    Serial.printf("[UART1] 🧮 Clock=%u Hz, target=%u Hz → prescaler=%u, period=%u, achieved %.3f Hz (%+.1f ppm)\n",
+                 mcpwmClockFreq, frequency, synth.prescaler, synth.period, synth.frequency, synth.errorPpm);
 
-    // Check if new period is valid (2 to 65535)
-    if (new_period_with_current_prescaler >= 2 && new_period_with_current_prescaler <= 65535) {
-        // Can achieve target frequency with current prescaler!
+    if (synth.prescaler == pwmPrescaler) {
         // Use shadow register mode (glitch-free!)
         Serial.printf("[UART1] ✅ GLITCH-FREE PATH: Keep prescaler=%u, period: %u → %u\n",
-                     pwmPrescaler, pwmPeriod, new_period_with_current_prescaler);
-        Serial.flush();
+                     pwmPrescaler, pwmPeriod, synth.period);
+    } else {
+        // The prescaler field is not shadowed and applies immediately;
+        // period and compare still latch together at the next TEZ
+        Serial.printf("[UART1] ⚠️ PRESCALER CHANGE REQUIRED: %u → %u (applies immediately)\n",
+                     pwmPrescaler, synth.prescaler);
+        pwmPrescaler = synth.prescaler;
+    }
+    Serial.flush();
 
-        Serial.println("[UART1] 🔧 Calling updatePWMRegistersDirectly()...");
-        updatePWMRegistersDirectly(new_period_with_current_prescaler, duty);
-        Serial.println("[UART1] ✅ updatePWMRegistersDirectly() returned");
+    updatePWMRegistersDirectly(synth.period, duty);
 
-        // Update stored values
-        pwmPeriod = new_period_with_current_prescaler;
-        pwmFrequency = frequency;
-        pwmDuty = duty;
+    // Update stored values
+    pwmPeriod = synth.period;
+    pwmFrequency = frequency;
+    pwmDuty = duty;
+    pwmSynth = synth;
+    if (result) {
+        *result = synth;
+    }
 
-        Serial.printf("[UART1] ✅ PWM updated (glitch-free): %u Hz, %.1f%%\n", frequency, duty);
-        Serial.flush();
-    } else {
-        // Cannot achieve target frequency with current prescaler
-        // Must change prescaler - use mcpwm_set_frequency() (may glitch)
-        Serial.printf("[UART1] ⚠️ PRESCALER CHANGE REQUIRED: period %u out of range [2, 65535]\n",
-                     new_period_with_current_prescaler);
-        Serial.flush();
-
-        esp_err_t err_freq = mcpwm_set_frequency(MCPWM_UNIT_UART1_PWM, MCPWM_TIMER_UART1_PWM, frequency);
-        if (err_freq != ESP_OK) {
-            Serial.printf("[UART1] PWM frequency set failed: %s\n", esp_err_to_name(err_freq));
-            return false;
-        }
+    Serial.printf("[UART1] ✅ PWM updated: %u Hz, %.1f%% (prescaler=%u, period=%u)\n",
+                 frequency, duty, pwmPrescaler, pwmPeriod);
 
-        esp_err_t err_duty = mcpwm_set_duty(MCPWM_UNIT_UART1_PWM, MCPWM_TIMER_UART1_PWM,
-                                            MCPWM_GEN_UART1_PWM, duty);
-        if (err_duty != ESP_OK) {
-            Serial.printf("[UART1] PWM duty set failed: %s\n", esp_err_to_name(err_duty));
-            return false;
-        }
+    Serial.println("[UART1] 🏁 setPWMFrequencyAndDuty() RETURN TRUE");
+    Serial.flush();
+    return true;
+}
 
-        // CRITICAL: Read actual register values after mcpwm_set_frequency()
-        // ESP-IDF may use different prescaler/period calculation than ours!
-        uint32_t cfg0_actual = MCPWM1.timer[0].timer_cfg0.val;
-        uint32_t actual_prescaler = (cfg0_actual & 0xFF);
-        uint32_t actual_period = ((cfg0_actual >> 8) & 0xFFFF);
+bool UART1Mux::resolvePWMImage(uint32_t frequency, float duty, uint32_t preferredPrescaler, PWMImage& image) {
+    if (currentMode != MODE_PWM_RPM) {
+        return false;
+    }
+    if (!validatePWMFrequency(frequency) || duty < 0.0 || duty > 100.0) {
+        return false;
+    }
 
-        Serial.printf("[UART1] 📖 Register after mcpwm_set_frequency(): prescaler=%u, period=%u\n",
-                     actual_prescaler, actual_period);
+    PWMSynthResult synth;
+    if (!PWMSynth::synthesize(mcpwmClockFreq, frequency, preferredPrescaler, pwmSynthConstraints, synth)) {
+        return false;
+    }
 
-        // Update stored values with ACTUAL register values (not calculated values!)
-        pwmPrescaler = actual_prescaler;
-        pwmPeriod = actual_period;
-        pwmFrequency = frequency;
-        pwmDuty = duty;
+    image.clockHz = mcpwmClockFreq;
+    image.frequency = frequency;
+    image.duty = duty;
+    image.prescaler = synth.prescaler;
+    image.period = synth.period;
+    image.compare = dutyToCompare(synth.period, duty);
+    image.synth = synth;
+    return true;
+}
 
-        Serial.printf("[UART1] PWM updated: %u Hz, %.1f%% (prescaler=%u, period=%u)\n",
-                     frequency, duty, pwmPrescaler, pwmPeriod);
+bool UART1Mux::applyPWMImage(const PWMImage& image) {
+    MeasureLockGuard guard(rpmMeasureLock);
+    if (currentMode != MODE_PWM_RPM) {
+        return false;
+    }
+    // A clock change (re-init) or a lowered limit invalidates the image
+    if (image.clockHz != mcpwmClockFreq || image.frequency > maxFrequency) {
+        return false;
     }
 
-    Serial.println("[UART1] 🏁 setPWMFrequencyAndDuty() RETURN TRUE");
-    Serial.flush();
+    stopRamp();
+    stopRPMLoop();
+    stopSequence();
+
+    // Fast path: no synthesis and no logging, one shadow write
+    outputPWMChangePulse();
+    pwmPrescaler = image.prescaler;
+    writePWMShadow(image.period, image.compare);
+
+    pwmPeriod = image.period;
+    pwmFrequency = image.frequency;
+    pwmDuty = image.duty;
+    pwmSynth = image.synth;
     return true;
 }
 
 void UART1Mux::setPWMEnabled(bool enable) {
+    MeasureLockGuard guard(rpmMeasureLock);
     if (currentMode != MODE_PWM_RPM) {
         return;
     }
 
+    if (!enable) {
+        stopRamp();
+        stopRPMLoop();
+        stopSequence();
+    }
+
     pwmEnabled = enable;
 
     if (enable) {
@@ -419,134 +537,1037 @@ void UART1Mux::setPWMEnabled(bool enable) {
 }
 
 // ============================================================================
-// MCPWM Capture ISR Callback
+// PWM Ramp
 // ============================================================================
 
-bool IRAM_ATTR UART1Mux::captureCallback(mcpwm_unit_t mcpwm,
-                                          mcpwm_capture_channel_id_t cap_channel,
-                                          const cap_event_data_t *edata,
-                                          void *user_data) {
-    // This runs in ISR context - must be fast!
-    static uint32_t lastCapture = 0;
-    uint32_t currentCapture = edata->cap_value;
-
-    if (lastCapture != 0) {
-        // Calculate period between captures (in timer ticks)
-        if (currentCapture > lastCapture) {
-            capturePeriod = currentCapture - lastCapture;
-        } else {
-            // Handle timer overflow (32-bit counter)
-            capturePeriod = (UINT32_MAX - lastCapture) + currentCapture + 1;
-        }
-        newCaptureAvailable = true;
+bool UART1Mux::rampPWMFrequency(uint32_t frequency, uint32_t durationMs, PWMRamp::Profile profile) {
+    MeasureLockGuard guard(rpmMeasureLock);
+    if (currentMode != MODE_PWM_RPM || !validatePWMFrequency(frequency)) {
+        return false;
     }
 
-    lastCapture = currentCapture;
-    lastCaptureTime = millis();  // Track last valid capture time
+    if (durationMs == 0) {
+        return setPWMFrequencyAndDuty(frequency, pwmDuty);
+    }
 
-    return false;  // Don't wake higher priority task
+    stopRamp();  // Restart from wherever a previous ramp stopped
+    stopRPMLoop();
+    stopSequence();
+    float start = (float)pwmFrequency;
+    PWMRamp::Endpoint target = { (float)frequency, pwmDuty };
+    if (!startRamp(target, durationMs, profile)) {
+        return false;
+    }
+
+    rampIsFrequency = true;
+    rampStartValue = start;
+    rampTargetValue = (float)frequency;
+    return true;
 }
 
-void UART1Mux::updateRPMFrequency() {
-    if (currentMode != MODE_PWM_RPM) {
-        rpmFrequency = 0.0;
-        return;
+bool UART1Mux::rampPWMDuty(float duty, uint32_t durationMs, PWMRamp::Profile profile) {
+    MeasureLockGuard guard(rpmMeasureLock);
+    if (currentMode != MODE_PWM_RPM || duty < 0.0 || duty > 100.0) {
+        return false;
+    }
+
+    if (durationMs == 0) {
+        return setPWMDuty(duty);
+    }
+
+    stopRamp();
+    stopRPMLoop();
+    stopSequence();
+    float start = pwmDuty;
+    PWMRamp::Endpoint target = { (float)pwmFrequency, duty };
+    if (!startRamp(target, durationMs, profile)) {
+        return false;
     }
 
-    // Check if new capture data is available
-    if (newCaptureAvailable) {
-        newCaptureAvailable = false;
+    rampIsFrequency = false;
+    rampStartValue = start;
+    rampTargetValue = duty;
+    return true;
+}
+
+bool UART1Mux::startRamp(const PWMRamp::Endpoint& target, uint32_t durationMs, PWMRamp::Profile profile) {
+    if (!pwmEnabled) {
+        Serial.println("[UART1] ❌ Ramp requires PWM output enabled");
+        return false;
+    }
 
-        // Calculate frequency from captured period
-        // Formula: frequency = MCPWM_CAPTURE_CLK / period
-        // MCPWM_CAPTURE_CLK = 80,000,000 Hz (80 MHz APB clock)
-        if (capturePeriod > 0) {
-            rpmFrequency = 80000000.0 / (float)capturePeriod;
-            lastRPMUpdate = lastCaptureTime;
+    if (!rampTable) {
+        size_t size = sizeof(PWMRampStep) * PWMRamp::MAX_STEPS;
+        rampTable = static_cast<PWMRampStep*>(heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+        if (!rampTable) {
+            rampTable = static_cast<PWMRampStep*>(heap_caps_malloc(size, MALLOC_CAP_8BIT));
+        }
+        if (!rampTable) {
+            Serial.println("[UART1] ❌ Ramp table allocation failed");
+            return false;
         }
     }
 
-    // Check for signal timeout (no capture in last 500ms)
-    unsigned long now = millis();
-    if ((now - lastRPMUpdate) > 500) {
-        rpmFrequency = 0.0;  // Signal lost
+    // Ramps keep the current prescaler so every step can go through the shadow registers
+    uint32_t prescaler = pwmPrescaler + 1;
+    rampPeriodClock = mcpwmClockFreq / prescaler;
+
+    PWMRamp::Endpoint from = { (float)pwmFrequency, pwmDuty };
+    float maxFreq = from.frequency > target.frequency ? from.frequency : target.frequency;
+    bool timerPaced = maxFreq > RAMP_TEZ_MAX_HZ;
+
+    if (!timerPaced && !rampTezHandle) {
+        // Unit 1's interrupt is shared: the ISR only touches its own TEZ bit. The legacy
+        // capture driver allocates it exclusively, so once a capture on unit 1 holds it
+        // the ramp is paced by the timer instead. No ESP_INTR_FLAG_IRAM: the table may
+        // be in PSRAM, so the ISR must stay masked while the flash cache is disabled.
+        esp_err_t err = mcpwm_isr_register(MCPWM_UNIT_UART1_PWM, rampTezISR, this,
+                                           ESP_INTR_FLAG_SHARED, &rampTezHandle);
+        if (err != ESP_OK) {
+            Serial.printf("[UART1] ⚠️ MCPWM TEZ ISR unavailable (%s), ramp paced by timer\n",
+                         esp_err_to_name(err));
+            rampTezHandle = nullptr;
+            timerPaced = true;
+        }
     }
-}
 
-bool UART1Mux::hasRPMSignal() const {
-    if (currentMode != MODE_PWM_RPM) {
+    size_t steps = PWMRamp::build(rampTable, PWMRamp::MAX_STEPS, from, target, durationMs,
+                                  rampPeriodClock, timerPaced ? RAMP_TIMER_HZ : 0, profile);
+    if (steps == 0) {
+        Serial.printf("[UART1] ❌ Ramp %.0f → %.0f Hz is out of range for prescaler %u\n",
+                     from.frequency, target.frequency, pwmPrescaler);
         return false;
     }
 
-    // Signal detected if frequency > 0 and updated within last 500ms
-    return (rpmFrequency > 0.0) && ((millis() - lastRPMUpdate) < 500);
+    outputPWMChangePulse();
+
+    // Entry 0 is committed now; the interrupt walks the rest
+    rampLength = steps;
+    rampIndex = 0;
+    rampRemaining = rampTable[0].repeat;
+    rampDone = (steps == 1);
+    rampTimerPaced = timerPaced;
+    rampProfile = profile;
+    rampDurationMs = durationMs;
+    rampStartTime = millis();
+    writePWMShadow(rampTable[0].period, rampTable[0].compare);
+
+    if (timerPaced) {
+        timer_config_t config = {};
+        config.alarm_en = TIMER_ALARM_EN;
+        config.counter_en = TIMER_PAUSE;
+        config.intr_type = TIMER_INTR_LEVEL;
+        config.counter_dir = TIMER_COUNT_UP;
+        config.auto_reload = TIMER_AUTORELOAD_EN;
+        config.divider = 80;  // 1 MHz tick from 80 MHz APB
+
+        esp_err_t err = timer_init(TIMER_GROUP_UART1_RAMP, TIMER_UART1_RAMP, &config);
+        if (err == ESP_OK) {
+            timer_set_counter_value(TIMER_GROUP_UART1_RAMP, TIMER_UART1_RAMP, 0);
+            timer_set_alarm_value(TIMER_GROUP_UART1_RAMP, TIMER_UART1_RAMP, 1000000 / RAMP_TIMER_HZ);
+            timer_enable_intr(TIMER_GROUP_UART1_RAMP, TIMER_UART1_RAMP);
+            // Not ESP_INTR_FLAG_IRAM: the table may be in PSRAM, so the ISR must
+            // stay masked while the flash cache is disabled
+            err = timer_isr_callback_add(TIMER_GROUP_UART1_RAMP, TIMER_UART1_RAMP, rampTimerISR, this, 0);
+        }
+        if (err != ESP_OK) {
+            Serial.printf("[UART1] ❌ Ramp timer init failed: %s\n", esp_err_to_name(err));
+            timer_deinit(TIMER_GROUP_UART1_RAMP, TIMER_UART1_RAMP);
+            return false;
+        }
+        timer_start(TIMER_GROUP_UART1_RAMP, TIMER_UART1_RAMP);
+    } else {
+        portENTER_CRITICAL(&mux);
+        mcpwm_ll_intr_clear_timer_tez_status(&MCPWM1, 1 << MCPWM_TIMER_UART1_PWM);
+        mcpwm_ll_intr_enable_timer_tez(&MCPWM1, MCPWM_TIMER_UART1_PWM, true);
+        portEXIT_CRITICAL(&mux);
+    }
+
+    rampActive = true;
+    Serial.printf("[UART1] Ramp started: %u steps, %u ms, %s, paced by %s\n",
+                 (unsigned)steps, durationMs, PWMRamp::getProfileName(profile),
+                 timerPaced ? "timer" : "TEZ");
+    return true;
 }
 
-// ============================================================================
-// Status and Diagnostics
-// ============================================================================
+void IRAM_ATTR UART1Mux::rampTick() {
+    if (rampDone) {
+        return;
+    }
+    if (--rampRemaining > 0) {
+        return;
+    }
 
-void UART1Mux::getUARTStatistics(uint32_t* txBytes, uint32_t* rxBytes, uint32_t* errors) {
-    if (txBytes) *txBytes = uartTxBytes;
-    if (rxBytes) *rxBytes = uartRxBytes;
-    if (errors) *errors = uartErrors;
+    uint32_t next = rampIndex + 1;
+    if (next >= rampLength) {
+        rampDone = true;
+        if (!rampTimerPaced) {
+            mcpwm_ll_intr_enable_timer_tez(&MCPWM1, MCPWM_TIMER_UART1_PWM, false);
+        }
+        return;
+    }
+
+    const PWMRampStep& step = rampTable[next];
+    writePWMShadow(step.period, step.compare);
+    rampIndex = next;
+    rampRemaining = step.repeat;
 }
 
-void UART1Mux::resetUARTStatistics() {
-    uartTxBytes = 0;
-    uartRxBytes = 0;
-    uartErrors = 0;
+void IRAM_ATTR UART1Mux::rampTezISR(void* arg) {
+    // Shared interrupt: leave every other status bit to its own handler
+    const uint32_t mask = 1 << MCPWM_TIMER_UART1_PWM;
+    if (!(mcpwm_ll_intr_get_timer_tez_status(&MCPWM1) & mask)) {
+        return;
+    }
+    mcpwm_ll_intr_clear_timer_tez_status(&MCPWM1, mask);
+    static_cast<UART1Mux*>(arg)->rampTick();
 }
 
-// ============================================================================
-// Private Helper Functions
-// ============================================================================
+bool IRAM_ATTR UART1Mux::rampTimerISR(void* arg) {
+    static_cast<UART1Mux*>(arg)->rampTick();
+    return false;  // Don't wake higher priority task
+}
 
-bool UART1Mux::initUART() {
-    uart_config_t uart_config = {
-        .baud_rate = (int)uartBaudRate,
-        .data_bits = uartDataBits,
-        .parity = uartParity,
-        .stop_bits = uartStopBits,
-        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
-        .rx_flow_ctrl_thresh = 122,
-        .source_clk = UART_SCLK_APB,
-    };
+void UART1Mux::releaseRampSource() {
+    if (rampTimerPaced) {
+        timer_pause(TIMER_GROUP_UART1_RAMP, TIMER_UART1_RAMP);
+        timer_disable_intr(TIMER_GROUP_UART1_RAMP, TIMER_UART1_RAMP);
+        timer_isr_callback_remove(TIMER_GROUP_UART1_RAMP, TIMER_UART1_RAMP);
+        timer_deinit(TIMER_GROUP_UART1_RAMP, TIMER_UART1_RAMP);
+    } else {
+        portENTER_CRITICAL(&mux);
+        mcpwm_ll_intr_enable_timer_tez(&MCPWM1, MCPWM_TIMER_UART1_PWM, false);
+        mcpwm_ll_intr_clear_timer_tez_status(&MCPWM1, 1 << MCPWM_TIMER_UART1_PWM);
+        portEXIT_CRITICAL(&mux);
+    }
+}
 
-    esp_err_t err = uart_param_config(uartNum, &uart_config);
-    if (err != ESP_OK) {
-        return false;
+void UART1Mux::mirrorRampStep() {
+    const PWMRampStep& step = rampTable[rampIndex];
+    pwmPeriod = step.period;
+    if (rampIsFrequency) {
+        pwmFrequency = (rampPeriodClock + (step.period + 1) / 2) / (step.period + 1);
+    } else {
+        pwmDuty = (float)step.compare * 100.0f / (float)(step.period + 1);
     }
+    PWMSynth::describe(mcpwmClockFreq, pwmFrequency, pwmPrescaler, pwmPeriod, pwmSynth);
+}
 
-    err = uart_set_pin(uartNum, PIN_UART1_TX, PIN_UART1_RX,
-                      UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
-    if (err != ESP_OK) {
-        return false;
+void UART1Mux::stopRamp() {
+    MeasureLockGuard guard(rpmMeasureLock);
+    if (!rampActive) {
+        return;
     }
 
-    // Configure TX pin with internal pull-up (as requested)
-    gpio_set_pull_mode((gpio_num_t)PIN_UART1_TX, GPIO_PULLUP_ONLY);
-    gpio_set_pull_mode((gpio_num_t)PIN_UART1_RX, GPIO_PULLUP_ONLY);
+    releaseRampSource();
+    rampActive = false;
+    mirrorRampStep();  // Output holds the last committed step
 
-    err = uart_driver_install(uartNum, 2048, 1024, 0, NULL, 0);
-    if (err != ESP_OK) {
-        return false;
+    Serial.printf("[UART1] Ramp stopped at step %u/%u (%u Hz, %.1f%%)\n",
+                 rampIndex + 1, rampLength, pwmFrequency, pwmDuty);
+}
+
+void UART1Mux::updateRamp() {
+    MeasureLockGuard guard(rpmMeasureLock);
+    if (!rampActive) {
+        return;
     }
 
-    return true;
-}
+    if (!rampDone) {
+        mirrorRampStep();  // Let status/web readers follow the ramp
+        return;
+    }
 
-bool UART1Mux::initPWM() {
-    // Initialize MCPWM for PWM output (replaces LEDC)
-    // Step 1: Configure GPIO for MCPWM
-    mcpwm_gpio_init(MCPWM_UNIT_UART1_PWM, MCPWM0A, PIN_UART1_TX);
+    releaseRampSource();
+    rampActive = false;
 
-    // Step 2: Configure MCPWM clock source (CRITICAL: Use 160MHz PLL_CLK, not APB)
-    // ESP32-S3 MCPWM clock options:
-    // - MCPWM_TIMER_CLK_SRC_PLL160M: 160 MHz (recommended for high frequency)
-    // But this requires ESP-IDF 5.x API, for ESP-IDF 4.x we use default APB_CLK
+    pwmPeriod = rampTable[rampLength - 1].period;
+    if (rampIsFrequency) {
+        pwmFrequency = (uint32_t)rampTargetValue;
+    } else {
+        pwmDuty = rampTargetValue;
+    }
+    PWMSynth::describe(mcpwmClockFreq, pwmFrequency, pwmPrescaler, pwmPeriod, pwmSynth);
 
-    // Step 3: Configure MCPWM parameters
+    Serial.printf("[UART1] ✅ Ramp complete: %u Hz, %.1f%% (%lu ms)\n",
+                 pwmFrequency, pwmDuty, millis() - rampStartTime);
+}
+
+UART1Mux::RampStatus UART1Mux::getRampStatus() const {
+    RampStatus status;
+    status.active = rampActive;
+    status.frequencyRamp = rampIsFrequency;
+    status.profile = rampProfile;
+    status.timerPaced = rampTimerPaced;
+    status.durationMs = rampDurationMs;
+    status.elapsedMs = rampActive ? (uint32_t)(millis() - rampStartTime) : 0;
+    status.step = rampIndex + 1;
+    status.steps = rampLength;
+    status.startValue = rampStartValue;
+    status.targetValue = rampTargetValue;
+    return status;
+}
+
+// ============================================================================
+// MCPWM Capture ISR Callback
+// ============================================================================
+
+bool IRAM_ATTR UART1Mux::captureCallback(mcpwm_unit_t mcpwm,
+                                          mcpwm_capture_channel_id_t cap_channel,
+                                          const cap_event_data_t *edata,
+                                          void *user_data) {
+    // This runs in ISR context - must be fast!
+    // Only queue the raw timestamp; period math and filtering run in task context.
+    UART1Mux* self = static_cast<UART1Mux*>(user_data);
+    self->rpmIsrCount++;
+    uint32_t timestamp = edata->cap_value;
+    if (self->captureBothEdges) {
+        // Dual-edge capture: polarity rides in bit 0 of the timestamp
+        timestamp = (timestamp & ~1u) | (edata->cap_edge == MCPWM_POS_EDGE ? 1u : 0u);
+    }
+    if (!self->captureRing.push(timestamp)) {
+        // Consumer is not keeping up (input far above the current range).
+        // Mask our interrupt so the edge storm cannot starve core 1;
+        // updateRPMFrequency() re-enables it or switches range.
+        mcpwm_ll_intr_enable_capture(&MCPWM0, MCPWM_CAP_UART1_RPM, false);  // MCPWM_UNIT_UART1_RPM
+        self->captureThrottled = true;
+    }
+
+    if (self->stallArmed) {
+        // Push the stall deadline out; while throttled no edges arrive until
+        // the next poll, so give it the full timeout
+        uint64_t now = timer_group_get_counter_value_in_isr(TIMER_GROUP_UART1_STALL, TIMER_UART1_STALL);
+        uint32_t timeout = self->captureThrottled ? STALL_MAX_TIMEOUT_US : self->stallTimeoutUs;
+        self->stallLastEdgeUs = (uint32_t)now;
+        timer_group_set_alarm_value_in_isr(TIMER_GROUP_UART1_STALL, TIMER_UART1_STALL, now + timeout);
+        timer_group_enable_alarm_in_isr(TIMER_GROUP_UART1_STALL, TIMER_UART1_STALL);
+    }
+
+    return false;  // Don't wake higher priority task
+}
+
+void IRAM_ATTR UART1Mux::pcntOverflowHandler(void* arg) {
+    // Counter auto-resets to 0 at the high limit
+    UART1Mux* self = static_cast<UART1Mux*>(arg);
+    self->pcntOverflows++;
+    self->rpmIsrCount++;
+}
+
+void UART1Mux::updateRPMFrequency() {
+    if (rpmLoopActive) {
+        return;  // Loop task owns the measurement while it runs
+    }
+    if (xSemaphoreTakeRecursive(rpmMeasureLock, 0) != pdTRUE) {
+        return;  // Loop task is mid-step (starting or stopping)
+    }
+    measureRPM();
+    xSemaphoreGiveRecursive(rpmMeasureLock);
+}
+
+void UART1Mux::measureRPM() {
+    if (currentMode != MODE_PWM_RPM) {
+        rpmFrequency = 0.0;
+        return;
+    }
+
+    unsigned long now = millis();
+
+    if (rpmRange == RPM_RANGE_PCNT) {
+        updatePCNTSample();
+    } else {
+        // Drain every edge captured since the last call
+        uint32_t timestamp;
+        bool gap;
+        bool gotEdge = false;
+        bool dual = captureBothEdges;
+        bool pulse = pulseSource != PULSE_OFF;
+        if (pulseSource == PULSE_LOOPBACK && (pwmPeriod != pulseRefPeriod || pwmDuty != pulseRefDuty)) {
+            // Statistics belong to one PWM setting
+            pulseMeter.reset();
+            pulseRefPeriod = pwmPeriod;
+            pulseRefDuty = pwmDuty;
+        }
+        while (captureRing.pop(timestamp, gap)) {
+            if (gap) {
+                rpmFilter.markGap();  // Ring overflowed; don't measure across lost edges
+                pulseMeter.markGap();
+            }
+            bool rising = !dual || (timestamp & 1u);
+            if (edgeTap) {
+                edgeTap(timestamp, rising, gap, edgeTapArg);
+            }
+            if (rising) {
+                rpmFilter.addEdge(timestamp);
+            }
+            if (pulse) {
+                pulseMeter.addEdge(timestamp, rising);
+            }
+            gotEdge = true;
+        }
+        if (gotEdge) {
+            lastRPMUpdate = now;
+        }
+    }
+
+    // ISR load, averaged over one second
+    if (now - rpmIsrRateTime >= 1000) {
+        uint32_t count = rpmIsrCount;
+        rpmIsrRate = (uint32_t)((uint64_t)(count - rpmIsrCountLast) * 1000 / (now - rpmIsrRateTime));
+        rpmIsrCountLast = count;
+        rpmIsrRateTime = now;
+    }
+
+    // Check for signal timeout (no capture in last 500ms)
+    if ((now - lastRPMUpdate) > RPM_SIGNAL_TIMEOUT_MS) {
+        if (rpmFrequency != 0.0) {
+            rpmFilter.reset();  // Next edge starts a fresh measurement
+        }
+        rpmFrequency = 0.0;  // Signal lost
+    } else {
+        rpmFrequency = rpmFilter.getFrequency();
+    }
+
+    selectRPMRange();
+    updateStallTimeout();
+
+    if (captureThrottled && rpmRange != RPM_RANGE_PCNT) {
+        // Ring has been drained; resume capture interrupts
+        captureThrottled = false;
+        rpmFilter.markGap();
+        portENTER_CRITICAL(&mux);
+        mcpwm_ll_intr_enable_capture(&MCPWM0, MCPWM_CAP_UART1_RPM, true);
+        portEXIT_CRITICAL(&mux);
+    }
+}
+
+const char* UART1Mux::getRPMRangeName() const {
+    switch (rpmRange) {
+        case RPM_RANGE_CAPTURE:     return "Capture";
+        case RPM_RANGE_CAPTURE_DIV: return "Capture/16";
+        case RPM_RANGE_PCNT:        return "PCNT";
+        default:                    return "Unknown";
+    }
+}
+
+void UART1Mux::selectRPMRange() {
+    // Use the raw sample so a slow EMA cannot hold the ISR rate high
+    float freq = rpmFilter.getRawFrequency();
+    if (rpmFrequency == 0.0) {
+        freq = 0.0;
+    }
+
+    RPMRange target = rpmRange;
+    if (captureBothEdges) {
+        // Only every-edge capture sees both edges; overload is handled by throttling
+        setRPMRange(RPM_RANGE_CAPTURE);
+        return;
+    }
+
+    switch (rpmRange) {
+        case RPM_RANGE_CAPTURE:
+            if (freq > RPM_PCNT_UP_HZ) {
+                target = RPM_RANGE_PCNT;
+            } else if (freq > RPM_DIV_UP_HZ) {
+                target = RPM_RANGE_CAPTURE_DIV;
+            } else if (captureThrottled) {
+                target = RPM_RANGE_PCNT;  // Overflowed before producing a sample
+            }
+            break;
+
+        case RPM_RANGE_CAPTURE_DIV:
+            if (freq > RPM_PCNT_UP_HZ || captureThrottled) {
+                target = RPM_RANGE_PCNT;
+            } else if (freq < RPM_DIV_DOWN_HZ) {
+                target = RPM_RANGE_CAPTURE;
+            }
+            break;
+
+        case RPM_RANGE_PCNT:
+            if (freq < RPM_PCNT_DOWN_HZ) {
+                target = (freq > RPM_DIV_UP_HZ) ? RPM_RANGE_CAPTURE_DIV : RPM_RANGE_CAPTURE;
+            }
+            break;
+    }
+
+    setRPMRange(target);
+}
+
+void UART1Mux::setRPMRange(RPMRange range) {
+    if (range == rpmRange) {
+        return;
+    }
+
+    // Leave current range
+    if (rpmRange == RPM_RANGE_PCNT) {
+        stopPCNT();
+    } else {
+        mcpwm_capture_disable_channel(MCPWM_UNIT_UART1_RPM, MCPWM_CAP_UART1_RPM);
+        captureRing.clear();
+        captureThrottled = false;
+    }
+
+    const char* previousName = getRPMRangeName();
+    rpmRange = range;
+    rpmRangeSwitches++;
+    rpmFilter.markGap();
+    lastRPMUpdate = millis();  // Give the new range one timeout period to see the signal
+
+    // Enter new range
+    bool ok;
+    if (range == RPM_RANGE_PCNT) {
+        ok = startPCNT();
+    } else {
+        ok = enableCapture(range == RPM_RANGE_CAPTURE_DIV ? RPM_CAPTURE_DIV : 1);
+    }
+
+    if (!ok && range != RPM_RANGE_CAPTURE) {
+        Serial.printf("[UART1] ❌ RPM range %s failed, falling back to capture\n", getRPMRangeName());
+        rpmRange = RPM_RANGE_CAPTURE;
+        enableCapture(1);
+        return;
+    }
+
+    // The new range delivers its first edge or gate later; don't call that a stall
+    stallTimeoutUs = STALL_MAX_TIMEOUT_US;
+    rearmStallTimer();
+
+    Serial.printf("[UART1] RPM range: %s → %s (%.1f Hz)\n",
+                  previousName, getRPMRangeName(), rpmFilter.getRawFrequency());
+}
+
+bool UART1Mux::enableCapture(uint32_t prescale) {
+    if (captureBothEdges) {
+        prescale = 1;  // The prescaler counts rising edges only
+    }
+
+    mcpwm_capture_config_t cap_conf;
+    cap_conf.cap_edge = captureBothEdges ? MCPWM_BOTH_EDGE : MCPWM_POS_EDGE;
+    cap_conf.cap_prescale = prescale;           // 1 = every edge, N = every Nth edge
+    cap_conf.capture_cb = captureCallback;      // ISR callback
+    cap_conf.user_data = this;                  // ISR pushes into this instance's ring
+
+    captureRing.clear();
+    rpmFilter.setEdgeDivider(prescale);
+    pulseMeter.markGap();
+
+    esp_err_t result = mcpwm_capture_enable_channel(MCPWM_UNIT_UART1_RPM,
+                                                     MCPWM_CAP_UART1_RPM,
+                                                     &cap_conf);
+    if (result != ESP_OK) {
+        Serial.printf("[UART1] ❌ MCPWM Capture enable failed: %s\n", esp_err_to_name(result));
+        return false;
+    }
+    return true;
+}
+
+bool UART1Mux::startPCNT() {
+    pcnt_config_t pcnt_conf = {};
+    pcnt_conf.pulse_gpio_num = PIN_UART1_RX;   // Same pin as capture (GPIO matrix fan-out)
+    pcnt_conf.ctrl_gpio_num = PCNT_PIN_NOT_USED;
+    pcnt_conf.channel = PCNT_CHANNEL_UART1_RPM;
+    pcnt_conf.unit = PCNT_UNIT_UART1_RPM;
+    pcnt_conf.pos_mode = PCNT_COUNT_INC;       // Count rising edges
+    pcnt_conf.neg_mode = PCNT_COUNT_DIS;
+    pcnt_conf.lctrl_mode = PCNT_MODE_KEEP;
+    pcnt_conf.hctrl_mode = PCNT_MODE_KEEP;
+    pcnt_conf.counter_h_lim = PCNT_HIGH_LIMIT;
+    pcnt_conf.counter_l_lim = 0;
+
+    esp_err_t result = pcnt_unit_config(&pcnt_conf);
+    if (result != ESP_OK) {
+        Serial.printf("[UART1] ❌ PCNT config failed: %s\n", esp_err_to_name(result));
+        return false;
+    }
+
+    // Reject ringing shorter than 125 ns (10 APB cycles); 500 kHz high time is 1 µs
+    pcnt_set_filter_value(PCNT_UNIT_UART1_RPM, 10);
+    pcnt_filter_enable(PCNT_UNIT_UART1_RPM);
+
+    if (!pcntIsrInstalled) {
+        result = pcnt_isr_service_install(0);
+        if (result != ESP_OK && result != ESP_ERR_INVALID_STATE) {
+            Serial.printf("[UART1] ❌ PCNT ISR service install failed: %s\n", esp_err_to_name(result));
+            return false;
+        }
+        pcntIsrInstalled = true;
+    }
+    pcnt_isr_handler_add(PCNT_UNIT_UART1_RPM, pcntOverflowHandler, this);
+    pcnt_event_enable(PCNT_UNIT_UART1_RPM, PCNT_EVT_H_LIM);
+
+    pcnt_counter_pause(PCNT_UNIT_UART1_RPM);
+    pcnt_counter_clear(PCNT_UNIT_UART1_RPM);
+    pcntOverflows = 0;
+    pcnt_counter_resume(PCNT_UNIT_UART1_RPM);
+
+    pcntGateStartUs = esp_timer_get_time();
+    pcntGateCount = 0;
+    return true;
+}
+
+void UART1Mux::stopPCNT() {
+    pcnt_counter_pause(PCNT_UNIT_UART1_RPM);
+    pcnt_event_disable(PCNT_UNIT_UART1_RPM, PCNT_EVT_H_LIM);
+    pcnt_isr_handler_remove(PCNT_UNIT_UART1_RPM);
+}
+
+uint32_t UART1Mux::readPCNTTotal() {
+    // Re-read if an overflow lands between the two reads
+    uint32_t overflows;
+    int16_t count;
+    do {
+        overflows = pcntOverflows;
+        pcnt_get_counter_value(PCNT_UNIT_UART1_RPM, &count);
+    } while (overflows != pcntOverflows);
+    return overflows * (uint32_t)PCNT_HIGH_LIMIT + (uint16_t)count;
+}
+
+void UART1Mux::updatePCNTSample() {
+    int64_t nowUs = esp_timer_get_time();
+    int64_t elapsedUs = nowUs - pcntGateStartUs;
+    if (elapsedUs < (int64_t)PCNT_GATE_MS * 1000) {
+        return;  // Gate still open
+    }
+
+    uint32_t total = readPCNTTotal();
+    uint32_t counts = total - pcntGateCount;
+    pcntGateCount = total;
+    pcntGateStartUs = nowUs;
+
+    if (counts > 0) {
+        rpmFilter.addSample((float)((double)counts * 1000000.0 / elapsedUs));
+        lastRPMUpdate = millis();
+        rearmStallTimer();  // No per-edge interrupt in this range
+    }
+}
+
+bool UART1Mux::hasRPMSignal() const {
+    if (currentMode != MODE_PWM_RPM) {
+        return false;
+    }
+
+    // Signal detected if frequency > 0 and updated within last 500ms
+    return (rpmFrequency > 0.0) && ((millis() - lastRPMUpdate) < RPM_SIGNAL_TIMEOUT_MS);
+}
+
+// ============================================================================
+// Stall Detection
+// ============================================================================
+
+bool UART1Mux::setStallDetection(bool enabled) {
+    if (enabled == stallEnabled) {
+        return true;
+    }
+
+    if (!enabled) {
+        stallEnabled = false;
+        disarmStallTimer();
+        stopStallTimer();
+        Serial.println("[UART1] Stall detection disabled");
+        return true;
+    }
+
+    if (!stallTaskHandle) {
+        BaseType_t ok = xTaskCreatePinnedToCore(
+            stallTask,
+            "RPM_Stall",
+            4096,
+            this,
+            4,                  // Above the RPM loop so a stall is handled first
+            &stallTaskHandle,
+            1);
+        if (ok != pdPASS) {
+            stallTaskHandle = nullptr;
+            Serial.println("[UART1] ❌ Stall task creation failed");
+            return false;
+        }
+    }
+
+    if (!startStallTimer()) {
+        return false;
+    }
+
+    stallTimeoutUs = STALL_MAX_TIMEOUT_US;
+    stallEnabled = true;
+    stallArmed = currentMode == MODE_PWM_RPM;  // Alarm itself waits for the first edge
+    Serial.printf("[UART1] Stall detection enabled: %u periods\n", stallPeriods);
+    return true;
+}
+
+bool UART1Mux::setStallPeriods(uint8_t periods) {
+    if (periods < STALL_MIN_PERIODS || periods > STALL_MAX_PERIODS) {
+        return false;
+    }
+    stallPeriods = periods;
+    return true;
+}
+
+void UART1Mux::resetStallStats() {
+    stallStats = {};
+}
+
+void UART1Mux::setStallCallback(StallCallback callback, void* arg) {
+    stallCallbackArg = arg;
+    stallCallback = callback;
+}
+
+bool UART1Mux::startStallTimer() {
+    if (stallTimerRunning) {
+        return true;
+    }
+
+    timer_config_t config = {};
+    config.alarm_en = TIMER_ALARM_DIS;          // Set by the first edge
+    config.counter_en = TIMER_PAUSE;
+    config.intr_type = TIMER_INTR_LEVEL;
+    config.counter_dir = TIMER_COUNT_UP;
+    config.auto_reload = TIMER_AUTORELOAD_DIS;  // Free-running time base; the alarm is one-shot
+    config.divider = 80;  // 1 MHz tick from 80 MHz APB
+
+    esp_err_t err = timer_init(TIMER_GROUP_UART1_STALL, TIMER_UART1_STALL, &config);
+    if (err == ESP_OK) {
+        timer_set_counter_value(TIMER_GROUP_UART1_STALL, TIMER_UART1_STALL, 0);
+        timer_enable_intr(TIMER_GROUP_UART1_STALL, TIMER_UART1_STALL);
+        err = timer_isr_callback_add(TIMER_GROUP_UART1_STALL, TIMER_UART1_STALL, stallTimerISR, this, 0);
+    }
+    if (err != ESP_OK) {
+        Serial.printf("[UART1] ❌ Stall timer init failed: %s\n", esp_err_to_name(err));
+        timer_deinit(TIMER_GROUP_UART1_STALL, TIMER_UART1_STALL);
+        return false;
+    }
+    timer_start(TIMER_GROUP_UART1_STALL, TIMER_UART1_STALL);
+    stallTimerRunning = true;
+    return true;
+}
+
+void UART1Mux::stopStallTimer() {
+    if (!stallTimerRunning) {
+        return;
+    }
+    timer_pause(TIMER_GROUP_UART1_STALL, TIMER_UART1_STALL);
+    timer_disable_intr(TIMER_GROUP_UART1_STALL, TIMER_UART1_STALL);
+    timer_isr_callback_remove(TIMER_GROUP_UART1_STALL, TIMER_UART1_STALL);
+    timer_deinit(TIMER_GROUP_UART1_STALL, TIMER_UART1_STALL);
+    stallTimerRunning = false;
+}
+
+void UART1Mux::rearmStallTimer() {
+    if (!stallArmed) {
+        return;
+    }
+    uint64_t now = 0;
+    timer_get_counter_value(TIMER_GROUP_UART1_STALL, TIMER_UART1_STALL, &now);
+    stallLastEdgeUs = (uint32_t)now;
+    timer_set_alarm_value(TIMER_GROUP_UART1_STALL, TIMER_UART1_STALL, now + stallTimeoutUs);
+    timer_set_alarm(TIMER_GROUP_UART1_STALL, TIMER_UART1_STALL, TIMER_ALARM_EN);
+}
+
+void UART1Mux::disarmStallTimer() {
+    stallArmed = false;
+    if (stallTimerRunning) {
+        timer_set_alarm(TIMER_GROUP_UART1_STALL, TIMER_UART1_STALL, TIMER_ALARM_DIS);
+    }
+}
+
+void UART1Mux::updateStallTimeout() {
+    if (!stallEnabled) {
+        return;
+    }
+
+    // PCNT is re-armed once per gate, so only the full timeout is safe there
+    uint32_t timeout = STALL_MAX_TIMEOUT_US;
+    if (rpmRange != RPM_RANGE_PCNT && rpmFrequency > 0.0) {
+        // Time between capture interrupts, which is several tach periods when prescaled
+        float intervalUs = 1000000.0f * rpmFilter.getEdgeDivider() / rpmFrequency;
+        float t = intervalUs * stallPeriods;
+        if (t < (float)STALL_MIN_TIMEOUT_US) {
+            timeout = STALL_MIN_TIMEOUT_US;
+        } else if (t < (float)STALL_MAX_TIMEOUT_US) {
+            timeout = (uint32_t)t;
+        }
+    }
+    stallTimeoutUs = timeout;
+}
+
+bool IRAM_ATTR UART1Mux::stallTimerISR(void* arg) {
+    UART1Mux* self = static_cast<UART1Mux*>(arg);
+    if (!self->stallArmed) {
+        return false;
+    }
+
+    // An edge on the other core, or a longer timeout set since the alarm
+    // was armed, may have moved the deadline: re-arm for the remainder
+    uint64_t now = timer_group_get_counter_value_in_isr(TIMER_GROUP_UART1_STALL, TIMER_UART1_STALL);
+    uint32_t elapsed = (uint32_t)now - self->stallLastEdgeUs;
+    uint32_t timeout = self->stallTimeoutUs;
+    if (elapsed < timeout) {
+        timer_group_set_alarm_value_in_isr(TIMER_GROUP_UART1_STALL, TIMER_UART1_STALL, now + (timeout - elapsed));
+        timer_group_enable_alarm_in_isr(TIMER_GROUP_UART1_STALL, TIMER_UART1_STALL);
+        return false;
+    }
+
+    // Cut the drive right here; the task brings pwmDuty in line
+    if ((self->stallActions & STALL_ACTION_CUT_PWM) && self->pwmEnabled) {
+        self->writePWMShadow(self->pwmPeriod, 0);
+        self->stallPWMCut = true;
+    }
+
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(self->stallTaskHandle, &woken);
+    return woken == pdTRUE;
+}
+
+void UART1Mux::stallTask(void* arg) {
+    UART1Mux* self = static_cast<UART1Mux*>(arg);
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        self->handleStall();
+    }
+}
+
+void UART1Mux::handleStall() {
+    uint64_t now = 0;
+    timer_get_counter_value(TIMER_GROUP_UART1_STALL, TIMER_UART1_STALL, &now);
+    uint32_t detectUs = (uint32_t)now - stallLastEdgeUs;
+
+    // The cut and its ramp/loop/sequencer teardown run in this task; the lock
+    // orders them against the command tasks' PWM setters and the RPM loop
+    xSemaphoreTakeRecursive(rpmMeasureLock, portMAX_DELAY);
+    bool cut = stallPWMCut;
+    stallPWMCut = false;
+
+    // A fan that was told to stop is not stalled
+    if (!stallArmed || currentMode != MODE_PWM_RPM || !pwmEnabled || pwmDuty <= 0.0f) {
+        // Not a stall after all: undo the ISR's cut so the output matches pwmDuty
+        if (cut && currentMode == MODE_PWM_RPM && pwmEnabled) {
+            commitPWMShadow(pwmPeriod, pwmDuty);
+        }
+        xSemaphoreGiveRecursive(rpmMeasureLock);
+        return;
+    }
+
+    StallEvent event = {};
+    event.sequence = stallStats.count + 1;
+    event.timeMs = millis();
+    event.detectUs = detectUs;
+    event.timeoutUs = stallTimeoutUs;
+    event.lastRpm = getCalculatedRPM();
+    event.duty = pwmDuty;
+    event.actions = stallActions;
+    if (cut) {
+        event.actions |= STALL_ACTION_CUT_PWM;  // Already cut, even if the actions changed since
+    }
+
+    stallStats.count = event.sequence;
+    stallStats.lastDetectUs = detectUs;
+    stallStats.lastTimeMs = event.timeMs;
+    stallStats.totalDetectUs += detectUs;
+    if (event.sequence == 1 || detectUs < stallStats.minDetectUs) {
+        stallStats.minDetectUs = detectUs;
+    }
+    if (detectUs > stallStats.maxDetectUs) {
+        stallStats.maxDetectUs = detectUs;
+    }
+
+    if (event.actions & STALL_ACTION_CUT_PWM) {
+        setPWMDuty(0.0f);  // Also stops ramp, RPM loop and sequencer
+    }
+
+    // Report 0 RPM now instead of after the polled signal timeout
+    rpmFilter.reset();
+    rpmFrequency = 0.0;
+    xSemaphoreGiveRecursive(rpmMeasureLock);
+
+    Serial.printf("[UART1] ⚠️ Stall #%u: no tach edge for %u µs (timeout %u µs), was %.0f RPM at %.1f%%%s\n",
+                  event.sequence, detectUs, event.timeoutUs, event.lastRpm, event.duty,
+                  (event.actions & STALL_ACTION_CUT_PWM) ? ", PWM cut" : "");
+
+    if (stallCallback) {
+        stallCallback(event, stallCallbackArg);
+    }
+}
+
+// ============================================================================
+// Pulse Width / Duty Measurement
+// ============================================================================
+
+bool UART1Mux::setPulseSource(PulseSource source) {
+    if (source == pulseSource) {
+        return true;
+    }
+    if (source == PULSE_LOOPBACK && rpmLoopActive) {
+        return false;  // The loop would regulate on the PWM frequency
+    }
+
+    xSemaphoreTakeRecursive(rpmMeasureLock, portMAX_DELAY);
+
+    bool active = currentMode == MODE_PWM_RPM && rpmInitialized;
+    if (active) {
+        haltCapture();
+    }
+
+    PulseSource previous = pulseSource;
+    pulseSource = source;
+    captureBothEdges = source != PULSE_OFF || edgeTap != nullptr;
+    pulseMeter.reset();
+    pulseRefPeriod = pwmPeriod;
+    pulseRefDuty = pwmDuty;
+
+    if (previous == PULSE_LOOPBACK) {
+        PIN_INPUT_DISABLE(GPIO_PIN_MUX_REG[PIN_UART1_TX]);
+    }
+
+    bool ok = restartCapture(active);
+
+    xSemaphoreGiveRecursive(rpmMeasureLock);
+
+    Serial.printf("[UART1] Pulse measurement: %s\n", getPulseSourceName(source));
+    return ok;
+}
+
+const char* UART1Mux::getPulseSourceName(PulseSource source) {
+    switch (source) {
+        case PULSE_OFF:      return "OFF";
+        case PULSE_INPUT:    return "INPUT";
+        case PULSE_LOOPBACK: return "LOOPBACK";
+        default:             return "UNKNOWN";
+    }
+}
+
+void UART1Mux::resetPulseStatistics() {
+    xSemaphoreTakeRecursive(rpmMeasureLock, portMAX_DELAY);
+    pulseMeter.reset();
+    xSemaphoreGiveRecursive(rpmMeasureLock);
+}
+
+bool UART1Mux::getPulseLineLevel() const {
+    return gpio_get_level((gpio_num_t)(pulseSource == PULSE_LOOPBACK ? PIN_UART1_TX : PIN_UART1_RX)) != 0;
+}
+
+void UART1Mux::setEdgeTap(EdgeTap tap, void* arg) {
+    xSemaphoreTakeRecursive(rpmMeasureLock, portMAX_DELAY);
+
+    bool bothEdges = pulseSource != PULSE_OFF || tap != nullptr;
+    bool active = currentMode == MODE_PWM_RPM && rpmInitialized;
+    bool reconfigure = bothEdges != captureBothEdges;
+    if (reconfigure && active) {
+        haltCapture();
+    }
+
+    edgeTap = tap;
+    edgeTapArg = arg;
+    captureBothEdges = bothEdges;
+
+    if (reconfigure) {
+        restartCapture(active);
+    }
+
+    xSemaphoreGiveRecursive(rpmMeasureLock);
+}
+
+void UART1Mux::haltCapture() {
+    if (rpmRange == RPM_RANGE_PCNT) {
+        stopPCNT();
+    } else {
+        mcpwm_capture_disable_channel(MCPWM_UNIT_UART1_RPM, MCPWM_CAP_UART1_RPM);
+    }
+}
+
+bool UART1Mux::restartCapture(bool active) {
+    if (!active) {
+        captureRearm = true;  // initRPM() re-enables with the new edge setting
+        return true;
+    }
+
+    routeCaptureInput();
+    rpmRange = RPM_RANGE_CAPTURE;
+    captureThrottled = false;
+    rpmFilter.markGap();
+    bool ok = enableCapture(1);
+    lastRPMUpdate = millis();
+    stallTimeoutUs = STALL_MAX_TIMEOUT_US;  // First edges of the new edge setting
+    rearmStallTimer();
+    return ok;
+}
+
+// ============================================================================
+// Status and Diagnostics
+// ============================================================================
+
+void UART1Mux::getUARTStatistics(uint32_t* txBytes, uint32_t* rxBytes, uint32_t* errors) {
+    if (txBytes) *txBytes = uartTxBytes;
+    if (rxBytes) *rxBytes = uartRxBytes;
+    if (errors) *errors = uartErrors;
+}
+
+void UART1Mux::resetUARTStatistics() {
+    uartTxBytes = 0;
+    uartRxBytes = 0;
+    uartErrors = 0;
+}
+
+// ============================================================================
+// Private Helper Functions
+// ============================================================================
+
+bool UART1Mux::initUART() {
+    uart_config_t uart_config = {
+        .baud_rate = (int)uartBaudRate,
+        .data_bits = uartDataBits,
+        .parity = uartParity,
+        .stop_bits = uartStopBits,
+        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+        .rx_flow_ctrl_thresh = 122,
+        .source_clk = UART_SCLK_APB,
+    };
+
+    // Register writes only; cheap enough to repeat on every switch
+    esp_err_t err = uart_param_config(uartNum, &uart_config);
+    if (err != ESP_OK) {
+        return false;
+    }
+
+    // Driver and ring buffers are installed once and kept across mode switches
+    if (uartInstalled) {
+        return true;
+    }
+
+    err = uart_set_pin(uartNum, PIN_UART1_TX, PIN_UART1_RX,
+                      UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+    if (err != ESP_OK) {
+        return false;
+    }
+
+    // Configure TX pin with internal pull-up (as requested)
+    gpio_set_pull_mode((gpio_num_t)PIN_UART1_TX, GPIO_PULLUP_ONLY);
+    gpio_set_pull_mode((gpio_num_t)PIN_UART1_RX, GPIO_PULLUP_ONLY);
+
+    err = uart_driver_install(uartNum, 2048, TX_BUFFER_SIZE, UART_EVENT_QUEUE_SIZE, &uartEventQueue, 0);
+    if (err != ESP_OK) {
+        return false;
+    }
+
+    uartInstalled = true;
+    return true;
+}
+
+bool UART1Mux::initPWM() {
+    // Resume: the timer kept its prescaler/period/compare while parked
+    if (pwmInitialized) {
+        mcpwm_start(MCPWM_UNIT_UART1_PWM, MCPWM_TIMER_UART1_PWM);
+        pwmEnabled = true;
+        return true;
+    }
+
+    // Initialize MCPWM for PWM output (replaces LEDC)
+    // Step 1: Configure GPIO for MCPWM
+    mcpwm_gpio_init(MCPWM_UNIT_UART1_PWM, MCPWM0A, PIN_UART1_TX);
+
+    // Step 2: Configure MCPWM clock source (CRITICAL: Use 160MHz PLL_CLK, not APB)
+    // ESP32-S3 MCPWM clock options:
+    // - MCPWM_TIMER_CLK_SRC_PLL160M: 160 MHz (recommended for high frequency)
+    // But this requires ESP-IDF 5.x API, for ESP-IDF 4.x we use default APB_CLK
+
+    // Step 3: Configure MCPWM parameters
     mcpwm_config_t pwm_config;
     pwm_config.frequency = pwmFrequency;    // Frequency in Hz
     pwm_config.cmpr_a = pwmDuty;            // Duty cycle of PWMxA (0.0 - 100.0)
@@ -567,30 +1588,60 @@ bool UART1Mux::initPWM() {
                         MCPWM_GEN_UART1_PWM, MCPWM_DUTY_MODE_0);
 
     // Step 5: Read actual register values and detect clock frequency
+    // Timer prescaler input = MCPWM base clock / group prescaler (chosen by the driver).
+    // Register fields are "minus one": f = clock / ((prescaler + 1) × (period + 1))
     uint32_t cfg0_init = MCPWM1.timer[0].timer_cfg0.val;
     pwmPrescaler = (cfg0_init & 0xFF);
     pwmPeriod = ((cfg0_init >> 8) & 0xFFFF);
-
-    // Calculate actual clock frequency based on register values and expected frequency
-    // Expected: clock_freq / (prescaler × period) = pwmFrequency
-    // Therefore: clock_freq = pwmFrequency × prescaler × period
-    mcpwmClockFreq = pwmFrequency * pwmPrescaler * pwmPeriod;
+    mcpwmClockFreq = (uint32_t)(UART1_MCPWM_BASE_CLK_HZ / mcpwm_ll_group_get_clock_prescale(&MCPWM1));
+    PWMSynth::describe(mcpwmClockFreq, pwmFrequency, pwmPrescaler, pwmPeriod, pwmSynth);
 
     pwmEnabled = true;
     Serial.printf("[UART1] ✅ MCPWM PWM initialized (GPIO %d, %u Hz, %.1f%% duty)\n",
                  PIN_UART1_TX, pwmFrequency, pwmDuty);
     Serial.printf("[UART1] 📖 Actual register: prescaler=%u, period=%u\n", pwmPrescaler, pwmPeriod);
-    Serial.printf("[UART1] 🔍 Detected MCPWM clock: %u Hz (%.1f MHz)\n",
-                 mcpwmClockFreq, mcpwmClockFreq / 1000000.0f);
+    Serial.printf("[UART1] 🔍 MCPWM timer clock: %u Hz (%.1f MHz), achieved %.3f Hz (%+.1f ppm)\n",
+                 mcpwmClockFreq, mcpwmClockFreq / 1000000.0f, pwmSynth.frequency, pwmSynth.errorPpm);
 
-    if (mcpwmClockFreq < 10000000) {
-        Serial.printf("[UART1] ⚠️  WARNING: Clock frequency seems too low! Expected ~80MHz\n");
-        Serial.printf("[UART1] ⚠️  This will cause frequency errors in PWM output!\n");
+    if (fabs(pwmSynth.errorPpm) > 10000.0) {
+        Serial.printf("[UART1] ⚠️  WARNING: Driver registers do not match %u Hz at the detected clock\n",
+                     pwmFrequency);
     }
+
+    // Re-synthesize so the initial output gets the same exact pair as later updates
+    PWMSynthResult synth;
+    if (PWMSynth::synthesize(mcpwmClockFreq, pwmFrequency, pwmPrescaler, pwmSynthConstraints, synth) &&
+        (synth.prescaler != pwmPrescaler || synth.period != pwmPeriod)) {
+        pwmPrescaler = synth.prescaler;
+        commitPWMShadow(synth.period, pwmDuty);
+        pwmPeriod = synth.period;
+        pwmSynth = synth;
+        Serial.printf("[UART1] 🧮 Synthesized: prescaler=%u, period=%u, %.3f Hz (%+.1f ppm)\n",
+                     pwmPrescaler, pwmPeriod, pwmSynth.frequency, pwmSynth.errorPpm);
+    }
+    pwmInitialized = true;
     return true;
 }
 
 bool UART1Mux::initRPM() {
+    // Resume: capture channel and interrupt are still set up, only re-arm
+    // if the last session left it prescaled, throttled or on PCNT
+    if (rpmInitialized) {
+        if (captureRearm) {
+            if (!enableCapture(1)) {
+                return false;
+            }
+            captureRearm = false;
+        }
+        rpmRangeSwitches = 0;
+        lastRPMUpdate = millis();
+        rpmIsrCountLast = rpmIsrCount;
+        rpmIsrRateTime = millis();
+        stallTimeoutUs = STALL_MAX_TIMEOUT_US;
+        stallArmed = stallEnabled;
+        return true;
+    }
+
     // Initialize MCPWM Capture for frequency measurement
 
     // Step 1: Route GPIO to MCPWM capture signal
@@ -608,62 +1659,264 @@ bool UART1Mux::initRPM() {
     // Step 2: Set pull-up on capture input for stable idle state
     gpio_set_pull_mode((gpio_num_t)PIN_UART1_RX, GPIO_PULLUP_ONLY);
 
-    // Step 3: Configure capture parameters
-    mcpwm_capture_config_t cap_conf;
-    cap_conf.cap_edge = MCPWM_POS_EDGE;        // Capture on rising edge
-    cap_conf.cap_prescale = 1;                  // No prescaling (80 MHz)
-    cap_conf.capture_cb = captureCallback;      // ISR callback
-    cap_conf.user_data = nullptr;               // No user data needed
-
-    // Step 4: Enable capture channel
-    esp_err_t result = mcpwm_capture_enable_channel(MCPWM_UNIT_UART1_RPM,
-                                                     MCPWM_CAP_UART1_RPM,
-                                                     &cap_conf);
+    // Step 3: Start in the low-frequency range (capture every edge);
+    // updateRPMFrequency() moves to prescaled capture or PCNT as needed
+    rpmRange = RPM_RANGE_CAPTURE;
+    rpmRangeSwitches = 0;
+    captureThrottled = false;
+    rpmFilter.reset();
 
-    if (result == ESP_OK) {
+    if (enableCapture(1)) {
         // Initialize state variables
-        capturePeriod = 0;
-        newCaptureAvailable = false;
-        lastCaptureTime = millis();
         lastRPMUpdate = millis();
         rpmFrequency = 0.0;
+        rpmIsrCountLast = rpmIsrCount;
+        rpmIsrRateTime = millis();
+        rpmIsrRate = 0;
 
         Serial.printf("[UART1] ✅ MCPWM Capture initialized:\n");
         Serial.printf("  - Unit: MCPWM_UNIT_%d\n", MCPWM_UNIT_UART1_RPM);
         Serial.printf("  - Channel: CAP%d\n", (MCPWM_CAP_UART1_RPM == MCPWM_SELECT_CAP1) ? 1 : 0);
         Serial.printf("  - GPIO: %d (RX1)\n", PIN_UART1_RX);
-        Serial.printf("  - Edge: Rising, Clock: 80 MHz\n");
+        Serial.printf("  - Edge: %s, Clock: 80 MHz\n", captureBothEdges ? "Both" : "Rising");
+        Serial.printf("  - Filter: %s, %u periods/sample\n",
+                      RPMFilter::getFilterName(rpmFilter.getFilterType()),
+                      rpmFilter.getSamplePeriods());
+        Serial.printf("  - Auto-range: capture/16 > %.0f Hz, PCNT > %.0f Hz\n",
+                      RPM_DIV_UP_HZ, RPM_PCNT_UP_HZ);
+        rpmInitialized = true;
+        captureRearm = false;
+        stallTimeoutUs = STALL_MAX_TIMEOUT_US;
+        stallArmed = stallEnabled;
         return true;
     }
 
-    Serial.printf("[UART1] ❌ MCPWM Capture enable failed: %s\n", esp_err_to_name(result));
     return false;
 }
 
-void UART1Mux::deinitUART() {
-    uart_driver_delete(uartNum);
+bool UART1Mux::switchToUART(uint32_t baudRate, uart_stop_bits_t stopBits,
+                            uart_parity_t parity, uart_word_length_t dataBits) {
+    int64_t startUs = esp_timer_get_time();
+    parkMode();
+
+    uartBaudRate = baudRate;
+    uartStopBits = stopBits;
+    uartParity = parity;
+    uartDataBits = dataBits;
+    if (!initUART()) {
+        return false;
+    }
+
+    routePins(MODE_UART);
+    bool settled = waitRxIdle();
+    uart_flush_input(uartNum);  // Drop a frame that was cut by the switch
+
+    currentMode = MODE_UART;
+    recordModeSwitch(startUs, settled);
+    return true;
 }
 
-void UART1Mux::deinitPWM() {
-    // Stop MCPWM timer
+bool UART1Mux::switchToPWM_RPM() {
+    int64_t startUs = esp_timer_get_time();
+    parkMode();
+
+    bool pwmOK = initPWM();
+    bool rpmOK = initRPM();
+    if (!pwmOK || !rpmOK) {
+        disable();
+        return false;
+    }
+
+    routePins(MODE_PWM_RPM);
+    bool settled = waitPWMRunning();
+
+    currentMode = MODE_PWM_RPM;
+    recordModeSwitch(startUs, settled);
+    return true;
+}
+
+void UART1Mux::parkMode() {
+    switch (currentMode) {
+        case MODE_UART:
+            // Let queued bytes leave before TX is taken away
+            flushCombined();
+            uart_wait_tx_done(uartNum, pdMS_TO_TICKS(UART_DRAIN_TIMEOUT_MS));
+            break;
+        case MODE_PWM_RPM:
+            parkPWM();
+            parkRPM();
+            break;
+        case MODE_DISABLED:
+            // Already disabled
+            break;
+    }
+
+    // Neither peripheral sees the pins until routePins() connects one of them
+    esp_rom_gpio_connect_in_signal(GPIO_MATRIX_CONST_ONE_INPUT, uart_periph_signal[uartNum].rx_sig, false);
+    esp_rom_gpio_connect_in_signal(GPIO_MATRIX_CONST_ZERO_INPUT,
+                                   mcpwm_periph_signals.groups[MCPWM_UNIT_UART1_RPM].captures[MCPWM_CAP_UART1_RPM].cap_sig,
+                                   false);
+    currentMode = MODE_DISABLED;
+}
+
+void UART1Mux::parkPWM() {
+    MeasureLockGuard guard(rpmMeasureLock);
+    stopRPMLoop();
+    stopSequence();
+    stopRamp();
+    if (rampTezHandle) {
+        esp_intr_free(rampTezHandle);
+        rampTezHandle = nullptr;
+    }
+
+    // Timer stops but keeps its configuration for the next resume
     mcpwm_stop(MCPWM_UNIT_UART1_PWM, MCPWM_TIMER_UART1_PWM);
     pwmEnabled = false;
 }
 
-void UART1Mux::deinitRPM() {
-    // Disable MCPWM Capture channel
-    mcpwm_capture_disable_channel(MCPWM_UNIT_UART1_RPM, MCPWM_CAP_UART1_RPM);
+void UART1Mux::parkRPM() {
+    disarmStallTimer();  // Edges stop while parked
+
+    // Capture keeps its channel and interrupt; PCNT is paused and capture
+    // re-armed on resume so every resume starts in the capture range
+    if (rpmRange == RPM_RANGE_PCNT) {
+        stopPCNT();
+    }
+    captureRearm = captureRearm || rpmRange != RPM_RANGE_CAPTURE || captureThrottled;
+    rpmRange = RPM_RANGE_CAPTURE;
+    captureThrottled = false;
+    rpmIsrRate = 0;
+
+    // Reset state variables
+    captureRing.clear();
+    rpmFilter.reset();
+    pulseMeter.markGap();
+    rpmFrequency = 0.0;
+}
+
+void UART1Mux::routePins(Mode mode) {
+    // Pad direction only changes after releasePins(); re-setting it while
+    // a signal drives TX would glitch the line through the GPIO out register
+    if (pinsReleased) {
+        gpio_set_direction((gpio_num_t)PIN_UART1_TX, GPIO_MODE_OUTPUT);
+        gpio_set_direction((gpio_num_t)PIN_UART1_RX, GPIO_MODE_INPUT);
+        gpio_set_pull_mode((gpio_num_t)PIN_UART1_TX, GPIO_PULLUP_ONLY);
+        gpio_set_pull_mode((gpio_num_t)PIN_UART1_RX, GPIO_PULLUP_ONLY);
+        pinsReleased = false;
+    }
+
+    const auto& mcpwmSignals = mcpwm_periph_signals.groups;
+    if (mode == MODE_UART) {
+        esp_rom_gpio_connect_out_signal(PIN_UART1_TX, uart_periph_signal[uartNum].tx_sig, false, false);
+        esp_rom_gpio_connect_in_signal(PIN_UART1_RX, uart_periph_signal[uartNum].rx_sig, false);
+    } else {
+        esp_rom_gpio_connect_out_signal(
+            PIN_UART1_TX,
+            mcpwmSignals[MCPWM_UNIT_UART1_PWM].operators[MCPWM_TIMER_UART1_PWM].generators[MCPWM_GEN_UART1_PWM].pwm_sig,
+            false, false);
+        routeCaptureInput();
+    }
+}
+
+void UART1Mux::routeCaptureInput() {
+    int pin = PIN_UART1_RX;
+    if (pulseSource == PULSE_LOOPBACK) {
+        // Read the TX pad back: the capture sees the level actually driven
+        PIN_INPUT_ENABLE(GPIO_PIN_MUX_REG[PIN_UART1_TX]);
+        pin = PIN_UART1_TX;
+    }
+    esp_rom_gpio_connect_in_signal(pin,
+                                   mcpwm_periph_signals.groups[MCPWM_UNIT_UART1_RPM].captures[MCPWM_CAP_UART1_RPM].cap_sig,
+                                   false);
+}
+
+bool UART1Mux::waitRxIdle() {
+    // One idle character time on RX, so reception starts on a frame boundary
+    int64_t frameUs = 10 * 1000000LL / uartBaudRate + 1;
+    int64_t now = esp_timer_get_time();
+    int64_t idleSince = now;
+    int64_t deadline = now + frameUs * MODE_SETTLE_FRAMES;
+
+    while (now < deadline) {
+        if (gpio_get_level((gpio_num_t)PIN_UART1_RX) == 0) {
+            idleSince = now;
+        } else if (now - idleSince >= frameUs) {
+            return true;
+        }
+        now = esp_timer_get_time();
+    }
+    return false;  // Peer kept transmitting
+}
+
+bool UART1Mux::waitPWMRunning() {
+    // Counter advancing means the output is being generated
+    uint32_t first = mcpwm_ll_timer_get_count_value(&MCPWM1, MCPWM_TIMER_UART1_PWM);
+    int64_t deadline = esp_timer_get_time() + PWM_SETTLE_TIMEOUT_US;
+
+    while (mcpwm_ll_timer_get_count_value(&MCPWM1, MCPWM_TIMER_UART1_PWM) == first) {
+        if (esp_timer_get_time() >= deadline) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void UART1Mux::recordModeSwitch(int64_t startUs, bool settled) {
+    uint32_t us = (uint32_t)(esp_timer_get_time() - startUs);
+    switchStats.lastUs = us;
+    if (switchStats.count == 0 || us < switchStats.minUs) {
+        switchStats.minUs = us;
+    }
+    if (us > switchStats.maxUs) {
+        switchStats.maxUs = us;
+    }
+    switchStats.totalUs += us;
+    switchStats.count++;
+    if (!settled) {
+        switchStats.settleTimeouts++;
+    }
+}
+
+void UART1Mux::summarizeLatencies(uint32_t* samples, uint32_t count, ModeSwitchPercentiles& out) {
+    out = {};
+    if (count == 0) {
+        return;
+    }
 
-    // Reset state variables
-    capturePeriod = 0;
-    newCaptureAvailable = false;
-    rpmFrequency = 0.0;
+    // Nearest-rank percentiles
+    std::sort(samples, samples + count);
+    auto rank = [samples, count](uint32_t percent) {
+        uint32_t index = (uint32_t)(((uint64_t)percent * count + 99) / 100);
+        return samples[index > 0 ? index - 1 : 0];
+    };
+    out.minUs = samples[0];
+    out.p50Us = rank(50);
+    out.p90Us = rank(90);
+    out.p99Us = rank(99);
+    out.maxUs = samples[count - 1];
 }
 
 void UART1Mux::releasePins() {
     // Reset GPIO to input mode (high-impedance)
     gpio_reset_pin((gpio_num_t)PIN_UART1_TX);
     gpio_reset_pin((gpio_num_t)PIN_UART1_RX);
+    pinsReleased = true;
+}
+
+void UART1Mux::releaseDrivers() {
+    if (uartInstalled) {
+        uart_driver_delete(uartNum);
+        uartEventQueue = nullptr;
+        uartInstalled = false;
+    }
+    if (rpmInitialized) {
+        if (rpmRange == RPM_RANGE_PCNT) {
+            stopPCNT();
+        }
+        mcpwm_capture_disable_channel(MCPWM_UNIT_UART1_RPM, MCPWM_CAP_UART1_RPM);
+        rpmInitialized = false;
+    }
+    pwmInitialized = false;
 }
 
 bool UART1Mux::validateUARTConfig(uint32_t baudRate, uart_stop_bits_t stopBits,
@@ -726,6 +1979,582 @@ float UART1Mux::getCalculatedRPM() const {
     return (rpmFrequency * 60.0) / (float)polePairs;
 }
 
+// ============================================================================
+// Closed-loop RPM Control
+// ============================================================================
+
+bool UART1Mux::startRPMLoop(float targetRpm) {
+    MeasureLockGuard guard(rpmMeasureLock);
+    if (currentMode != MODE_PWM_RPM || !pwmEnabled || !(targetRpm > 0.0f)) {
+        return false;
+    }
+    if (pulseSource == PULSE_LOOPBACK) {
+        return false;  // "RPM" is our own PWM frequency
+    }
+
+    if (rpmLoopActive) {
+        rpmController.setTarget(targetRpm);  // Retarget without a bump
+        return true;
+    }
+
+    stopRamp();
+    stopSequence();
+
+    if (!rpmLoopTaskHandle) {
+        BaseType_t ok = xTaskCreatePinnedToCore(
+            rpmLoopTask,
+            "RPM_Loop",
+            4096,
+            this,
+            3,                  // Above HID/CDC tasks so loop timing stays tight
+            &rpmLoopTaskHandle,
+            1);
+        if (ok != pdPASS) {
+            rpmLoopTaskHandle = nullptr;
+            Serial.println("[UART1] ❌ RPM loop task creation failed");
+            return false;
+        }
+    }
+
+    rpmController.setTarget(targetRpm);
+    rpmController.start(pwmDuty, getCalculatedRPM());
+    rpmController.resetMetrics();
+    rpmLoopLastUs = 0;
+    rpmLoopLastSample = rpmFilter.getSampleCount();
+
+    rpmLoopActive = true;
+    if (!startRPMLoopTimer()) {
+        rpmLoopActive = false;
+        return false;
+    }
+
+    Serial.printf("[UART1] RPM loop started: target %.0f RPM, %u Hz\n", targetRpm, rpmLoopHz);
+    return true;
+}
+
+void UART1Mux::stopRPMLoop() {
+    // Waits for a step already in progress so it cannot overwrite the caller's duty
+    MeasureLockGuard guard(rpmMeasureLock);
+    if (!rpmLoopActive) {
+        return;
+    }
+
+    rpmLoopActive = false;
+    stopRPMLoopTimer();
+
+    Serial.printf("[UART1] RPM loop stopped, holding %.1f%%\n", pwmDuty);
+}
+
+bool UART1Mux::setRPMLoopRate(uint32_t hz) {
+    if (hz < RPM_LOOP_MIN_HZ || hz > RPM_LOOP_MAX_HZ) {
+        return false;
+    }
+    rpmLoopHz = hz;
+    if (rpmLoopActive) {
+        timer_set_alarm_value(TIMER_GROUP_UART1_RPM_LOOP, TIMER_UART1_RPM_LOOP, 1000000 / rpmLoopHz);
+        rpmController.resetMetrics();  // Jitter is relative to the nominal period
+        rpmLoopLastUs = 0;
+    }
+    return true;
+}
+
+bool UART1Mux::startRPMLoopTimer() {
+    timer_config_t config = {};
+    config.alarm_en = TIMER_ALARM_EN;
+    config.counter_en = TIMER_PAUSE;
+    config.intr_type = TIMER_INTR_LEVEL;
+    config.counter_dir = TIMER_COUNT_UP;
+    config.auto_reload = TIMER_AUTORELOAD_EN;
+    config.divider = 80;  // 1 MHz tick from 80 MHz APB
+
+    esp_err_t err = timer_init(TIMER_GROUP_UART1_RPM_LOOP, TIMER_UART1_RPM_LOOP, &config);
+    if (err == ESP_OK) {
+        timer_set_counter_value(TIMER_GROUP_UART1_RPM_LOOP, TIMER_UART1_RPM_LOOP, 0);
+        timer_set_alarm_value(TIMER_GROUP_UART1_RPM_LOOP, TIMER_UART1_RPM_LOOP, 1000000 / rpmLoopHz);
+        timer_enable_intr(TIMER_GROUP_UART1_RPM_LOOP, TIMER_UART1_RPM_LOOP);
+        err = timer_isr_callback_add(TIMER_GROUP_UART1_RPM_LOOP, TIMER_UART1_RPM_LOOP, rpmLoopTimerISR, this, 0);
+    }
+    if (err != ESP_OK) {
+        Serial.printf("[UART1] ❌ RPM loop timer init failed: %s\n", esp_err_to_name(err));
+        timer_deinit(TIMER_GROUP_UART1_RPM_LOOP, TIMER_UART1_RPM_LOOP);
+        return false;
+    }
+    timer_start(TIMER_GROUP_UART1_RPM_LOOP, TIMER_UART1_RPM_LOOP);
+    return true;
+}
+
+void UART1Mux::stopRPMLoopTimer() {
+    timer_pause(TIMER_GROUP_UART1_RPM_LOOP, TIMER_UART1_RPM_LOOP);
+    timer_disable_intr(TIMER_GROUP_UART1_RPM_LOOP, TIMER_UART1_RPM_LOOP);
+    timer_isr_callback_remove(TIMER_GROUP_UART1_RPM_LOOP, TIMER_UART1_RPM_LOOP);
+    timer_deinit(TIMER_GROUP_UART1_RPM_LOOP, TIMER_UART1_RPM_LOOP);
+}
+
+bool IRAM_ATTR UART1Mux::rpmLoopTimerISR(void* arg) {
+    // Wake the loop task; the PID itself needs the FPU and runs in task context
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(static_cast<UART1Mux*>(arg)->rpmLoopTaskHandle, &woken);
+    return woken == pdTRUE;
+}
+
+void UART1Mux::rpmLoopTask(void* arg) {
+    UART1Mux* self = static_cast<UART1Mux*>(arg);
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        self->rpmLoopStep();
+    }
+}
+
+void UART1Mux::rpmLoopStep() {
+    xSemaphoreTakeRecursive(rpmMeasureLock, portMAX_DELAY);
+    if (!rpmLoopActive) {
+        xSemaphoreGiveRecursive(rpmMeasureLock);
+        return;  // Stopped while this wake-up was pending
+    }
+
+    uint32_t nominalUs = 1000000 / rpmLoopHz;
+    int64_t now = esp_timer_get_time();
+    float dt = (float)nominalUs / 1000000.0f;
+    if (rpmLoopLastUs != 0) {
+        uint32_t periodUs = (uint32_t)(now - rpmLoopLastUs);
+        rpmController.recordPeriod(periodUs, nominalUs);
+        dt = (float)periodUs / 1000000.0f;
+    }
+    rpmLoopLastUs = now;
+
+    measureRPM();
+    float rpm = getCalculatedRPM();
+    float duty = rpmController.update(rpm, dt);
+
+    writePWMShadow(pwmPeriod, dutyToCompare(pwmPeriod, duty));
+    pwmDuty = duty;
+
+    // Learn the duty→RPM curve from settled operation, once per fresh measurement
+    uint32_t samples = rpmFilter.getSampleCount();
+    float target = rpmController.getTarget();
+    if (samples != rpmLoopLastSample && rpm > 0.0f && fabsf(target - rpm) < target * 0.02f) {
+        rpmController.learn(duty, rpm);
+    }
+    rpmLoopLastSample = samples;
+
+    xSemaphoreGiveRecursive(rpmMeasureLock);
+}
+
+// ============================================================================
+// PWM Sequencer
+// ============================================================================
+
+bool UART1Mux::allocateSequence() {
+    if (seqEntries && seqSteps && seqResults) {
+        return true;
+    }
+
+    auto allocate = [](size_t size) -> void* {
+        void* mem = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!mem) {
+            mem = heap_caps_malloc(size, MALLOC_CAP_8BIT);
+        }
+        return mem;
+    };
+
+    if (!seqEntries) {
+        seqEntries = static_cast<PWMSequenceEntry*>(allocate(sizeof(PWMSequenceEntry) * PWMSequence::MAX_ENTRIES));
+    }
+    if (!seqSteps) {
+        seqSteps = static_cast<PWMSequenceStep*>(allocate(sizeof(PWMSequenceStep) * PWMSequence::MAX_ENTRIES));
+    }
+    if (!seqResults) {
+        seqResults = static_cast<PWMSequenceResult*>(allocate(sizeof(PWMSequenceResult) * PWMSequence::MAX_RESULTS));
+    }
+
+    if (!seqEntries || !seqSteps || !seqResults) {
+        Serial.println("[UART1] ❌ Sequence buffer allocation failed");
+        return false;
+    }
+    return true;
+}
+
+bool UART1Mux::clearSequence() {
+    if (seqPlaying) {
+        return false;
+    }
+    seqLength = 0;
+    seqLoopStart = 0;
+    return true;
+}
+
+bool UART1Mux::appendSequence(const PWMSequenceEntry& entry) {
+    if (seqPlaying || !PWMSequence::isValid(entry) || seqLength >= PWMSequence::MAX_ENTRIES) {
+        return false;
+    }
+    if (!allocateSequence()) {
+        return false;
+    }
+    seqEntries[seqLength++] = entry;
+    return true;
+}
+
+bool UART1Mux::loadSequenceText(const char* text, size_t length, size_t* errorLine) {
+    if (errorLine) {
+        *errorLine = 0;
+    }
+    if (seqPlaying || !allocateSequence()) {
+        return false;
+    }
+
+    // Parse into a scratch table so a bad upload leaves the current profile intact
+    size_t size = sizeof(PWMSequenceEntry) * PWMSequence::MAX_ENTRIES;
+    PWMSequenceEntry* scratch = static_cast<PWMSequenceEntry*>(
+        heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+    if (!scratch) {
+        scratch = static_cast<PWMSequenceEntry*>(heap_caps_malloc(size, MALLOC_CAP_8BIT));
+    }
+    if (!scratch) {
+        return false;
+    }
+
+    uint32_t loopStart;
+    size_t badLine;
+    size_t count = PWMSequence::parseText(text, length, scratch, PWMSequence::MAX_ENTRIES,
+                                          loopStart, badLine);
+    if (count > 0) {
+        memcpy(seqEntries, scratch, count * sizeof(PWMSequenceEntry));
+        seqLength = count;
+        seqLoopStart = loopStart;
+    }
+    free(scratch);
+
+    if (count == 0) {
+        if (errorLine) {
+            *errorLine = badLine;
+        }
+        return false;
+    }
+    return true;
+}
+
+const PWMSequenceEntry* UART1Mux::getSequenceEntry(uint32_t index) const {
+    return index < seqLength ? &seqEntries[index] : nullptr;
+}
+
+bool UART1Mux::setSequenceLoopStart(uint32_t index) {
+    if (seqPlaying || index >= seqLength) {
+        return false;
+    }
+    seqLoopStart = index;
+    return true;
+}
+
+bool UART1Mux::playSequence(uint32_t repeat) {
+    MeasureLockGuard guard(rpmMeasureLock);
+    if (currentMode != MODE_PWM_RPM || !pwmEnabled || seqLength == 0) {
+        return false;
+    }
+
+    stopSequence();
+    stopRamp();
+    stopRPMLoop();
+
+    for (uint32_t i = 0; i < seqLength; i++) {
+        if (seqEntries[i].frequency > maxFrequency) {
+            Serial.printf("[UART1] ❌ Sequence entry %u: %u Hz exceeds max frequency %u Hz\n",
+                         i, seqEntries[i].frequency, maxFrequency);
+            return false;
+        }
+    }
+
+    uint32_t prescaler;
+    if (!PWMSequence::selectPrescaler(mcpwmClockFreq, seqEntries, seqLength, prescaler) ||
+        !PWMSequence::compile(mcpwmClockFreq, prescaler, seqEntries, seqLength, seqSteps, seqWorstPpm)) {
+        Serial.println("[UART1] ❌ Sequence frequency span does not fit one prescaler");
+        return false;
+    }
+
+    if (!seqTaskHandle) {
+        BaseType_t ok = xTaskCreatePinnedToCore(
+            sequenceTask,
+            "PWM_Seq",
+            4096,
+            this,
+            3,                  // Same as the RPM loop: sample promptly after each boundary
+            &seqTaskHandle,
+            1);
+        if (ok != pdPASS) {
+            seqTaskHandle = nullptr;
+            Serial.println("[UART1] ❌ Sequencer task creation failed");
+            return false;
+        }
+    }
+
+    xSemaphoreTakeRecursive(rpmMeasureLock, portMAX_DELAY);
+    seqIndex = 0;
+    seqPass = 0;
+    seqOrdinal = 0;
+    seqDone = false;
+    seqRecorded = 0;
+    seqRecordedEndUs = 0;
+    seqResultCount = 0;
+    seqResultsDropped = 0;
+    seqRepeat = repeat;
+    seqPrescaler = prescaler;
+    xSemaphoreGiveRecursive(rpmMeasureLock);
+
+    if (prescaler != pwmPrescaler) {
+        // One non-shadowed change up front; every step after it is glitch-free
+        Serial.printf("[UART1] ⚠️ Sequence prescaler %u → %u (applies immediately)\n",
+                     pwmPrescaler, prescaler);
+        pwmPrescaler = prescaler;
+    }
+
+    outputPWMChangePulse();
+    writePWMShadow(seqSteps[0].period, seqSteps[0].compare);
+    seqStartTime = millis();
+
+    timer_config_t config = {};
+    config.alarm_en = TIMER_ALARM_EN;
+    config.counter_en = TIMER_PAUSE;
+    config.intr_type = TIMER_INTR_LEVEL;
+    config.counter_dir = TIMER_COUNT_UP;
+    config.auto_reload = TIMER_AUTORELOAD_EN;
+    config.divider = 80;  // 1 MHz tick from 80 MHz APB
+
+    esp_err_t err = timer_init(TIMER_GROUP_UART1_SEQ, TIMER_UART1_SEQ, &config);
+    if (err == ESP_OK) {
+        timer_set_counter_value(TIMER_GROUP_UART1_SEQ, TIMER_UART1_SEQ, 0);
+        timer_set_alarm_value(TIMER_GROUP_UART1_SEQ, TIMER_UART1_SEQ, seqSteps[0].dwellUs);
+        timer_enable_intr(TIMER_GROUP_UART1_SEQ, TIMER_UART1_SEQ);
+        // Not ESP_INTR_FLAG_IRAM: the steps live in PSRAM
+        err = timer_isr_callback_add(TIMER_GROUP_UART1_SEQ, TIMER_UART1_SEQ, sequenceTimerISR, this, 0);
+    }
+    if (err != ESP_OK) {
+        Serial.printf("[UART1] ❌ Sequencer timer init failed: %s\n", esp_err_to_name(err));
+        timer_deinit(TIMER_GROUP_UART1_SEQ, TIMER_UART1_SEQ);
+        mirrorSequenceStep();
+        return false;
+    }
+
+    seqPlaying = true;
+    timer_start(TIMER_GROUP_UART1_SEQ, TIMER_UART1_SEQ);
+    mirrorSequenceStep();
+
+    Serial.printf("[UART1] Sequence started: %u entries, loop from %u, %s, prescaler %u (worst %.1f ppm)\n",
+                 seqLength, seqLoopStart, repeat ? "finite" : "endless", prescaler, seqWorstPpm);
+    return true;
+}
+
+void IRAM_ATTR UART1Mux::sequenceTick() {
+    if (seqDone) {
+        return;
+    }
+
+    uint32_t next = seqIndex + 1;
+    uint32_t pass = seqPass;
+    if (next >= seqLength) {
+        pass++;
+        if (seqRepeat != 0 && pass >= seqRepeat) {
+            // Last dwell is over: freeze the timer and hold the final step
+            timer_group_set_counter_enable_in_isr(TIMER_GROUP_UART1_SEQ, TIMER_UART1_SEQ, TIMER_PAUSE);
+            seqOrdinal = seqOrdinal + 1;
+            seqDone = true;
+            return;
+        }
+        next = seqLoopStart;
+    }
+
+    const PWMSequenceStep& step = seqSteps[next];
+    writePWMShadow(step.period, step.compare);
+    // Auto-reload restarts the count at 0, so the alarm is the new dwell
+    timer_group_set_alarm_value_in_isr(TIMER_GROUP_UART1_SEQ, TIMER_UART1_SEQ, step.dwellUs);
+    seqIndex = next;
+    seqPass = pass;
+    seqOrdinal = seqOrdinal + 1;
+}
+
+bool IRAM_ATTR UART1Mux::sequenceTimerISR(void* arg) {
+    UART1Mux* self = static_cast<UART1Mux*>(arg);
+    self->sequenceTick();
+
+    // RPM sampling needs the FPU and the measurement lock: hand it to the task
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(self->seqTaskHandle, &woken);
+    return woken == pdTRUE;
+}
+
+void UART1Mux::sequenceTask(void* arg) {
+    UART1Mux* self = static_cast<UART1Mux*>(arg);
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        self->recordSequenceSteps();
+    }
+}
+
+void UART1Mux::recordSequenceSteps() {
+    xSemaphoreTakeRecursive(rpmMeasureLock, portMAX_DELAY);
+
+    uint32_t completed = seqOrdinal;
+    if (seqRecorded != completed) {
+        measureRPM();
+        float rpm = getCalculatedRPM();
+
+        // Normally one step per wake-up; if the task fell behind (very short
+        // dwells), the older steps share this sample and are flagged late
+        while (seqRecorded < completed) {
+            uint32_t index, pass;
+            PWMSequence::position(seqRecorded, seqLength, seqLoopStart, index, pass);
+            seqRecordedEndUs += seqSteps[index].dwellUs;
+
+            if (seqResultCount < PWMSequence::MAX_RESULTS) {
+                PWMSequenceResult& result = seqResults[seqResultCount];
+                result.endMs = (uint32_t)(seqRecordedEndUs / 1000);
+                result.pass = pass;
+                result.frequency = seqEntries[index].frequency;
+                result.duty = seqEntries[index].duty;
+                result.rpmFrequency = rpmFrequency;
+                result.rpm = rpm;
+                result.index = (uint16_t)index;
+                result.flags = 0;
+                if (seqRecorded + 1 < completed) {
+                    result.flags |= PWMSequence::RESULT_LATE;
+                }
+                if (rpmFrequency == 0.0f) {
+                    result.flags |= PWMSequence::RESULT_NO_SIGNAL;
+                }
+                seqResultCount = seqResultCount + 1;
+            } else {
+                seqResultsDropped++;
+            }
+            seqRecorded++;
+        }
+    }
+
+    xSemaphoreGiveRecursive(rpmMeasureLock);
+}
+
+void UART1Mux::releaseSequenceTimer() {
+    timer_pause(TIMER_GROUP_UART1_SEQ, TIMER_UART1_SEQ);
+    timer_disable_intr(TIMER_GROUP_UART1_SEQ, TIMER_UART1_SEQ);
+    timer_isr_callback_remove(TIMER_GROUP_UART1_SEQ, TIMER_UART1_SEQ);
+    timer_deinit(TIMER_GROUP_UART1_SEQ, TIMER_UART1_SEQ);
+}
+
+void UART1Mux::mirrorSequenceStep() {
+    uint32_t index = seqIndex;
+    pwmPeriod = seqSteps[index].period;
+    pwmFrequency = seqEntries[index].frequency;
+    pwmDuty = seqEntries[index].duty;
+    PWMSynth::describe(mcpwmClockFreq, pwmFrequency, pwmPrescaler, pwmPeriod, pwmSynth);
+}
+
+void UART1Mux::stopSequence() {
+    MeasureLockGuard guard(rpmMeasureLock);
+    if (!seqPlaying) {
+        return;
+    }
+
+    releaseSequenceTimer();
+    seqPlaying = false;
+    recordSequenceSteps();  // Flush steps completed before the timer stopped
+    mirrorSequenceStep();
+
+    Serial.printf("[UART1] Sequence stopped at entry %u/%u, pass %u (%u Hz, %.1f%%)\n",
+                 seqIndex + 1, seqLength, seqPass + 1, pwmFrequency, pwmDuty);
+}
+
+void UART1Mux::updateSequence() {
+    MeasureLockGuard guard(rpmMeasureLock);
+    if (!seqPlaying) {
+        return;
+    }
+
+    if (!seqDone) {
+        mirrorSequenceStep();  // Let status/web readers follow playback
+        return;
+    }
+
+    releaseSequenceTimer();
+    seqPlaying = false;
+    recordSequenceSteps();
+    mirrorSequenceStep();
+
+    Serial.printf("[UART1] ✅ Sequence complete: %u steps, %u results (%lu ms)\n",
+                 seqOrdinal, seqResultCount, millis() - seqStartTime);
+}
+
+UART1Mux::SequenceStatus UART1Mux::getSequenceStatus() const {
+    SequenceStatus status;
+    status.playing = seqPlaying;
+    status.length = seqLength;
+    status.loopStart = seqLoopStart;
+    status.repeat = seqRepeat;
+    status.index = seqIndex;
+    status.pass = seqPass;
+    status.stepsPlayed = seqOrdinal;
+    status.elapsedMs = seqPlaying ? (uint32_t)(millis() - seqStartTime) : 0;
+    status.durationMs = seqLength ? PWMSequence::durationMs(seqEntries, seqLength, seqLoopStart, seqRepeat) : 0;
+    status.results = seqResultCount;
+    status.resultsDropped = seqResultsDropped;
+    status.prescaler = seqPrescaler;
+    status.worstPpm = seqWorstPpm;
+    return status;
+}
+
+const PWMSequenceResult* UART1Mux::getSequenceResult(uint32_t index) const {
+    return index < seqResultCount ? &seqResults[index] : nullptr;
+}
+
+bool UART1Mux::saveSequence() {
+    if (seqLength == 0) {
+        return false;
+    }
+
+    File file = SPIFFS.open(SEQUENCE_FILE, FILE_WRITE);
+    if (!file) {
+        Serial.println("[UART1] ❌ Failed to open sequence file for writing");
+        return false;
+    }
+
+    char line[48];
+    file.printf("# loop=%u\n", seqLoopStart);
+    file.println("freq_hz,duty_pct,dwell_ms");
+    for (uint32_t i = 0; i < seqLength; i++) {
+        PWMSequence::formatEntry(line, sizeof(line), seqEntries[i]);
+        file.println(line);
+    }
+    file.close();
+
+    Serial.printf("[UART1] Sequence saved: %u entries\n", seqLength);
+    return true;
+}
+
+bool UART1Mux::loadSequence() {
+    File file = SPIFFS.open(SEQUENCE_FILE, FILE_READ);
+    if (!file) {
+        return false;
+    }
+
+    size_t size = file.size();
+    char* text = static_cast<char*>(heap_caps_malloc(size + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+    if (!text) {
+        text = static_cast<char*>(heap_caps_malloc(size + 1, MALLOC_CAP_8BIT));
+    }
+    if (!text) {
+        file.close();
+        return false;
+    }
+
+    size_t length = file.read(reinterpret_cast<uint8_t*>(text), size);
+    file.close();
+    text[length] = '\0';
+
+    bool ok = loadSequenceText(text, length);
+    free(text);
+
+    if (ok) {
+        Serial.printf("[UART1] Sequence loaded: %u entries\n", seqLength);
+    }
+    return ok;
+}
+
 // ============================================================================
 // Settings Persistence
 // ============================================================================
@@ -742,6 +2571,27 @@ bool UART1Mux::saveSettings() {
     prefs.putUInt("polePairs", polePairs);
     prefs.putUInt("maxFreq", maxFrequency);
     prefs.putUInt("uartBaud", uartBaudRate);
+    prefs.putUChar("rpmFilter", rpmFilter.getFilterType());
+    prefs.putUChar("rpmWindow", rpmFilter.getWindowSize());
+    prefs.putFloat("rpmAlpha", rpmFilter.getEmaAlpha());
+    prefs.putUShort("rpmPeriods", rpmFilter.getSamplePeriods());
+    prefs.putUShort("rpmGateMs", rpmFilter.getMaxGateMs());
+    prefs.putFloat("rpmOutlier", rpmFilter.getOutlierTolerance());
+    prefs.putFloat("pidKp", rpmController.getKp());
+    prefs.putFloat("pidKi", rpmController.getKi());
+    prefs.putFloat("pidKd", rpmController.getKd());
+    prefs.putFloat("loopSlew", rpmController.getSlewRate());
+    prefs.putUShort("loopHz", rpmLoopHz);
+    prefs.putBool("ffEnable", rpmController.isFeedForwardEnabled());
+    prefs.putBool("stallEnable", stallEnabled);
+    prefs.putUChar("stallPeriods", stallPeriods);
+    prefs.putUChar("stallActions", stallActions);
+
+    float curve[RPMController::CURVE_POINTS];
+    for (uint8_t i = 0; i < RPMController::CURVE_POINTS; i++) {
+        curve[i] = rpmController.getCurvePoint(i);
+    }
+    prefs.putBytes("ffCurve", curve, sizeof(curve));
 
     prefs.end();
     Serial.println("[UART1] Settings saved to NVS");
@@ -762,16 +2612,65 @@ bool UART1Mux::loadSettings() {
     uartBaudRate = prefs.getUInt("uartBaud", 115200);
 
     prefs.end();
+    loadRPMSettings();
     Serial.println("[UART1] Settings loaded from NVS");
     return true;
 }
 
+bool UART1Mux::loadRPMSettings() {
+    Preferences prefs;
+    if (!prefs.begin(NVS_NAMESPACE, true)) {  // Read-only
+        return false;
+    }
+
+    rpmFilter.setFilterType((RPMFilter::FilterType)prefs.getUChar("rpmFilter", RPMFilter::FILTER_MEDIAN));
+    rpmFilter.setWindowSize(prefs.getUChar("rpmWindow", 5));
+    rpmFilter.setEmaAlpha(prefs.getFloat("rpmAlpha", 0.2));
+    rpmFilter.setSamplePeriods(prefs.getUShort("rpmPeriods", 8));
+    rpmFilter.setMaxGateMs(prefs.getUShort("rpmGateMs", 50));
+    rpmFilter.setOutlierTolerance(prefs.getFloat("rpmOutlier", 0.0));
+
+    rpmController.setGains(prefs.getFloat("pidKp", 0.01), prefs.getFloat("pidKi", 0.05),
+                           prefs.getFloat("pidKd", 0.0));
+    rpmController.setSlewRate(prefs.getFloat("loopSlew", 200.0));
+    setRPMLoopRate(prefs.getUShort("loopHz", 200));
+    rpmController.setFeedForwardEnabled(prefs.getBool("ffEnable", true));
+    setStallPeriods(prefs.getUChar("stallPeriods", 4));
+    setStallActions(prefs.getUChar("stallActions", STALL_ACTION_NOTIFY));
+    bool stallOn = prefs.getBool("stallEnable", false);
+
+    float curve[RPMController::CURVE_POINTS];
+    if (prefs.getBytes("ffCurve", curve, sizeof(curve)) == sizeof(curve)) {
+        for (uint8_t i = 0; i < RPMController::CURVE_POINTS; i++) {
+            rpmController.setCurvePoint(i, curve[i]);
+        }
+    }
+
+    prefs.end();
+    setStallDetection(stallOn);
+    return true;
+}
+
 void UART1Mux::resetToDefaults() {
     pwmFrequency = 1000;
     pwmDuty = 50.0;
     polePairs = 2;
     maxFrequency = 100000;
     uartBaudRate = 115200;
+    rpmFilter.setFilterType(RPMFilter::FILTER_MEDIAN);
+    rpmFilter.setWindowSize(5);
+    rpmFilter.setEmaAlpha(0.2);
+    rpmFilter.setSamplePeriods(8);
+    rpmFilter.setMaxGateMs(50);
+    rpmFilter.setOutlierTolerance(0.0);
+    rpmController.setGains(0.01, 0.05, 0.0);
+    rpmController.setSlewRate(200.0);
+    rpmController.setFeedForwardEnabled(true);
+    rpmController.clearCurve();
+    setRPMLoopRate(200);
+    setStallDetection(false);
+    setStallPeriods(4);
+    setStallActions(STALL_ACTION_NOTIFY);
 
     Serial.println("[UART1] Settings reset to factory defaults");
 }
@@ -818,92 +2717,61 @@ void UART1Mux::outputPWMChangePulse() {
 // PWM Low-Level Register Manipulation
 // ============================================================================
 
-void UART1Mux::calculatePWMParameters(uint32_t frequency, uint32_t& prescaler, uint32_t& period) {
-    // ESP32-S3 MCPWM uses APB clock: 80 MHz
-    // Formula: output_freq = APB_CLK / (prescaler * period)
-    // We want: prescaler * period = APB_CLK / output_freq
-
-    const uint32_t APB_CLK = 80000000;  // 80 MHz
-    uint32_t target_ticks = APB_CLK / frequency;
-
-    // Find optimal prescaler and period combination
-    // Goal: Maximize period for better resolution while keeping prescaler in range (1-256)
-
-    // Start with prescaler = 1 for maximum resolution
-    prescaler = 1;
-    period = target_ticks;
-
-    // If period exceeds 65535 (16-bit limit), increase prescaler
-    while (period > 65535 && prescaler < 256) {
-        prescaler++;
-        period = target_ticks / prescaler;
-    }
-
-    // Ensure period is at least 2 (minimum valid value)
-    if (period < 2) {
-        period = 2;
-    }
-}
-
 void UART1Mux::updatePWMRegistersDirectly(uint32_t period, float duty) {
     // UNIFIED SHADOW REGISTER UPDATE STRATEGY
     //
-    // Use shadow register mode for BOTH period and duty:
-    // 1. Period: Direct register access with PERIOD_UPMETHOD [24] = 1 (TEZ sync)
-    // 2. Duty: mcpwm_set_duty() API (already uses TEZ sync internally)
-    //
-    // Both updates synchronized to TEZ (Timer Equals Zero) → Completely glitch-free!
+    // Period and duty compare are both shadow registers latched at TEZ
+    // (Timer Equals Zero). Writing them one after another can still straddle
+    // a TEZ, so the new period would run one cycle with the old compare.
+    // commitPWMShadow() holds the shadow→active transfer while both are
+    // written, so they always take effect on the same PWM cycle boundary.
     //
     // Register details:
     // - timer_cfg0 [31:0]: prescaler[7:0], period[23:8], period_upmethod[24]
 
-    // Critical section for atomic register updates
-    taskENTER_CRITICAL(&mux);
-
-    // ===== Update Period (if changed) =====
     if (period != pwmPeriod) {
-        // CRITICAL: Must write BOTH prescaler and period together!
-        // The timer_cfg0 register contains:
-        //   bits [7:0]  = prescaler
-        //   bits [23:8] = period
-        //   bit  [24]   = period_upmethod (1 = shadow register mode)
-
-        // Read register BEFORE write for debugging
         uint32_t cfg0_before = MCPWM1.timer[0].timer_cfg0.val;
         Serial.printf("[UART1] 📖 BEFORE: cfg0=0x%08X, prescaler=%u, period=%u\n",
                      cfg0_before, (cfg0_before & 0xFF), ((cfg0_before >> 8) & 0xFFFF));
+    }
 
-        // Build the complete register value with prescaler + period + shadow mode
-        uint32_t cfg0_val = (pwmPrescaler & 0xFF)      // Prescaler [7:0]
-                          | (period << 8)               // Period [23:8]
-                          | (1 << 24);                  // Shadow mode [24]
-
-        Serial.printf("[UART1] 🔧 Writing: prescaler=%u, period=%u, cfg0_val=0x%08X\n",
-                     pwmPrescaler, period, cfg0_val);
-
-        // Write complete value to register
-        MCPWM1.timer[0].timer_cfg0.val = cfg0_val;
+    commitPWMShadow(period, duty);
 
-        // Read register AFTER write to verify
+    if (period != pwmPeriod) {
         uint32_t cfg0_after = MCPWM1.timer[0].timer_cfg0.val;
         Serial.printf("[UART1] 📖 AFTER:  cfg0=0x%08X, prescaler=%u, period=%u\n",
                      cfg0_after, (cfg0_after & 0xFF), ((cfg0_after >> 8) & 0xFFFF));
 
-        // Verify calculation
-        uint32_t calculated_freq = 80000000 / (pwmPrescaler * period);
-        Serial.printf("[UART1] 🧮 Expected frequency: 80MHz / (%u × %u) = %u Hz\n",
-                     pwmPrescaler, period, calculated_freq);
-
         // Update stored period value
         pwmPeriod = period;
     }
 
-    taskEXIT_CRITICAL(&mux);
-
-    // ===== Update Duty Cycle =====
-    // Use ESP-IDF API (TEZ-synchronized, shadow register mode)
-    mcpwm_set_duty(MCPWM_UNIT_UART1_PWM, MCPWM_TIMER_UART1_PWM, MCPWM_GEN_A, duty);
-
     // Update stored duty value
     pwmDuty = duty;
 }
+
+uint32_t UART1Mux::dutyToCompare(uint32_t period, float duty) const {
+    // Same scaling as mcpwm_set_duty(): peak = period field + 1 in up-count mode
+    return PWMRamp::dutyToCompare(period, duty);
+}
+
+void UART1Mux::commitPWMShadow(uint32_t period, float duty) {
+    writePWMShadow(period, dutyToCompare(period, duty));
+}
+
+void IRAM_ATTR UART1Mux::writePWMShadow(uint32_t period, uint32_t compare) {
+    uint32_t cfg0_val = (pwmPrescaler & 0xFF)          // Prescaler [7:0]
+                      | ((period & 0xFFFF) << 8)        // Period [23:8]
+                      | (1 << 24);                      // Shadow mode [24] (load at TEZ)
+
+    portENTER_CRITICAL_SAFE(&mux);  // Also used by the ramp ISR
+
+    // Hold all shadow→active transfers while writing, so a TEZ between the two
+    // writes cannot load the new period with the old compare (or vice versa)
+    MCPWM1.update_cfg.global_up_en = 0;
+    MCPWM1.timer[0].timer_cfg0.val = cfg0_val;
+    mcpwm_ll_operator_set_compare_value(&MCPWM1, 0, 0, compare);  // Operator 0, comparator A
+    MCPWM1.update_cfg.global_up_en = 1;
+
+    portEXIT_CRITICAL_SAFE(&mux);
+}
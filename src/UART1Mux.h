@@ -5,16 +5,26 @@
 #include "driver/uart.h"
 #include "driver/ledc.h"
 #include "driver/mcpwm.h"
+#include "driver/pcnt.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "PeripheralPins.h"
+#include "RPMFilter.h"
+#include "PulseMeter.h"
+#include "PWMRamp.h"
+#include "PWMSynth.h"
+#include "RPMController.h"
+#include "PWMSequence.h"
+#include "UARTTxCombiner.h"
 
 /**
  * @brief UART1 Multiplexing Manager
  *
  * Manages UART1 with three operating modes:
  * 1. UART Mode: Normal UART communication (TX with pull-up, RX standard)
- * 2. PWM Mode: TX outputs PWM (1Hz-500kHz), RX measures frequency via MCPWM Capture (1Hz-500kHz)
+ * 2. PWM Mode: TX outputs PWM (1Hz-500kHz), RX measures frequency via MCPWM Capture
+ *    (auto-ranging to PCNT gated counting at high frequency, 1Hz-500kHz)
  * 3. Disabled: Pins released
  *
  * Mode switching sequence:
@@ -39,7 +49,7 @@
  *   uart1.setPWMFrequency(1000);  // 1kHz PWM on TX
  *   float freq = uart1.getRPMFrequency();  // Read frequency on RX
  */
-class UART1Mux {
+class UART1Mux : private UARTTxCombiner::Port {
 public:
     /**
      * @brief Operating mode enumeration
@@ -50,6 +60,24 @@ public:
         MODE_PWM_RPM        ///< TX=PWM output, RX=RPM input
     };
 
+    /**
+     * @brief RPM measurement range (selected automatically with hysteresis)
+     */
+    enum RPMRange : uint8_t {
+        RPM_RANGE_CAPTURE = 0,  ///< MCPWM capture on every edge (low frequency)
+        RPM_RANGE_CAPTURE_DIV,  ///< MCPWM capture on every Nth edge (prescaled)
+        RPM_RANGE_PCNT          ///< PCNT gated edge counting (high frequency)
+    };
+
+    /**
+     * @brief Signal seen by the dual-edge pulse measurement
+     */
+    enum PulseSource : uint8_t {
+        PULSE_OFF = 0,          ///< Rising edges only (RPM measurement)
+        PULSE_INPUT,            ///< Both edges of the RX pin
+        PULSE_LOOPBACK          ///< Both edges of our own PWM output (TX pad read back)
+    };
+
     /**
      * @brief Constructor
      */
@@ -90,6 +118,9 @@ public:
 
     /**
      * @brief Disable UART1 and release pins
+     *
+     * UART driver and MCPWM stay installed, so the next mode switch is
+     * only a GPIO matrix reroute.
      */
     void disable();
 
@@ -105,26 +136,117 @@ public:
      */
     const char* getModeName() const;
 
+    /**
+     * @brief Mode switch latency since boot
+     *
+     * A switch is timed from the start of setModeUART()/setModePWM_RPM()
+     * until its settle condition holds: RX idle for one character time
+     * (UART) or the PWM counter running (PWM/RPM).
+     */
+    struct ModeSwitchStats {
+        uint32_t count;
+        uint32_t lastUs;
+        uint32_t minUs;
+        uint32_t maxUs;
+        uint64_t totalUs;
+        uint32_t settleTimeouts;    ///< Settle condition not met before its timeout
+    };
+
+    struct ModeSwitchPercentiles {
+        uint32_t minUs;
+        uint32_t p50Us;
+        uint32_t p90Us;
+        uint32_t p99Us;
+        uint32_t maxUs;
+    };
+
+    /**
+     * @brief Result of benchmarkModeSwitch()
+     */
+    struct ModeSwitchBench {
+        uint32_t cycles;            ///< Completed PWM → UART round trips
+        ModeSwitchPercentiles toUART;
+        ModeSwitchPercentiles toPWM;
+        uint32_t settleTimeouts;
+    };
+
+    static const uint32_t MAX_BENCH_CYCLES = 10000;
+
+    ModeSwitchStats getModeSwitchStats() const { return switchStats; }
+
+    /**
+     * @brief Toggle PWM/RPM ↔ UART mode and report latency percentiles
+     *
+     * Blocks for the whole run. Both directions are timed separately after
+     * one untimed warm-up cycle; the original mode is restored afterwards.
+     * Stops any ramp, speed loop or sequence.
+     * @param cycles 1 - MAX_BENCH_CYCLES round trips
+     * @return false on invalid count, allocation failure or a failed switch
+     */
+    bool benchmarkModeSwitch(uint32_t cycles, ModeSwitchBench& result);
+
     // ========================================================================
     // UART Mode Functions (only work in MODE_UART)
     // ========================================================================
 
+    static const size_t TX_BUFFER_SIZE = 4096;     // Driver TX ring: bursts are queued, not waited on
+    static const size_t TX_COMBINE_SIZE = UARTTxCombiner::SIZE;  // writeCombined() staging buffer
+
     /**
      * @brief Write data to UART (MODE_UART only)
+     *
+     * Returns once the data is in the driver's TX ring (blocks only while
+     * the ring is full). Use a TX fence to learn when it has been sent.
      * @param data Data buffer
      * @param len Number of bytes
-     * @param timeoutMs Timeout in milliseconds
+     * @param timeoutMs 0: do not wait; > 0: also wait up to this long until sent
      * @return Number of bytes written, -1 on error
      */
-    int write(const uint8_t* data, size_t len, uint32_t timeoutMs = 100);
+    int write(const uint8_t* data, size_t len, uint32_t timeoutMs = 0);
 
     /**
      * @brief Write string to UART (MODE_UART only)
      * @param str String to write
-     * @param timeoutMs Timeout in milliseconds
+     * @param timeoutMs 0: do not wait; > 0: also wait up to this long until sent
      * @return Number of bytes written, -1 on error
      */
-    int write(const char* str, uint32_t timeoutMs = 100);
+    int write(const char* str, uint32_t timeoutMs = 0);
+
+    /**
+     * @brief Collect small writes and hand them to the driver as one block (MODE_UART only)
+     *
+     * Bytes go into a TX_COMBINE_SIZE staging buffer that is sent when it
+     * fills, on flushCombined(), or ahead of the next write() or fence
+     * wait, so the stream keeps its order. Each driver write costs a ring
+     * buffer item and a lock, which dominates for writes of a few bytes.
+     * @return Number of bytes accepted, -1 on error
+     */
+    int writeCombined(const uint8_t* data, size_t len) { return txCombiner.writeCombined(data, len); }
+
+    /**
+     * @brief Send bytes staged by writeCombined()
+     */
+    void flushCombined() { txCombiner.flush(); }
+
+    /**
+     * @brief TX stream position after everything written so far
+     *
+     * write() returns once the data is in the driver's TX ring; pass the
+     * fence to isTxFenceDone() / waitTxFence() to learn when it has left
+     * the UART.
+     */
+    uint32_t getTxFence() const { return txCombiner.getFence(); }
+
+    /**
+     * @brief Whether everything up to a fence has been sent (does not block or flush)
+     */
+    bool isTxFenceDone(uint32_t fence) { return txCombiner.isFenceDone(fence); }
+
+    /**
+     * @brief Wait until everything up to a fence has been sent
+     * @return false on timeout
+     */
+    bool waitTxFence(uint32_t fence, uint32_t timeoutMs) { return txCombiner.waitFence(fence, timeoutMs); }
 
     /**
      * @brief Read data from UART (MODE_UART only)
@@ -141,11 +263,30 @@ public:
      */
     int available();
 
+    /**
+     * @brief Get the UART driver's event queue (RX data/timeout, overflow, errors)
+     * @return nullptr until UART mode has been entered once
+     */
+    QueueHandle_t getUARTEventQueue() const { return uartEventQueue; }
+
     /**
      * @brief Clear RX buffer (MODE_UART only)
      */
     void clearRxBuffer();
 
+    /**
+     * @brief Receives every block written to or read from the UART driver
+     */
+    typedef void (*TrafficTap)(const uint8_t* data, size_t length, bool tx, void* arg);
+
+    /**
+     * @brief Hand every block passing write() / read() to a consumer (traffic sniffer)
+     *
+     * Called from the writing or reading task right after the driver call,
+     * so it must be short.
+     */
+    void setTrafficTap(TrafficTap tap, void* arg);
+
     /**
      * @brief Reconfigure UART parameters without changing mode
      * @param baudRate New baud rate
@@ -165,10 +306,15 @@ public:
 
     /**
      * @brief Set PWM frequency on TX pin (MODE_PWM_RPM only)
+     *
+     * The prescaler/period pair is chosen by PWMSynth for the smallest
+     * frequency error; the current prescaler is kept when its error is
+     * within tolerance so the update stays on the shadow-register path.
      * @param frequency Frequency in Hz (1 - 500,000)
+     * @param result Optional: receives achieved frequency, ppm error and duty resolution
      * @return true if successful
      */
-    bool setPWMFrequency(uint32_t frequency);
+    bool setPWMFrequency(uint32_t frequency, PWMSynthResult* result = nullptr);
 
     /**
      * @brief Set PWM duty cycle on TX pin (MODE_PWM_RPM only)
@@ -193,18 +339,70 @@ public:
      *
      * @param frequency Frequency in Hz (1 - 500,000)
      * @param duty Duty cycle in percent (0.0 - 100.0)
+     * @param result Optional: receives achieved frequency, ppm error and duty resolution
      * @return true if successful
      *
-     * @note Parameters take effect at the next PWM cycle boundary (TEZ event)
+     * @note Parameters take effect at the next PWM cycle boundary (TEZ event).
+     *       A prescaler change is not shadowed and applies immediately.
+     */
+    bool setPWMFrequencyAndDuty(uint32_t frequency, float duty, PWMSynthResult* result = nullptr);
+
+    /**
+     * @brief Resolved register image of one PWM operating point
+     *
+     * Everything setPWMFrequencyAndDuty() computes, kept so the point can
+     * be re-applied later without validation or synthesis.
      */
-    bool setPWMFrequencyAndDuty(uint32_t frequency, float duty);
+    struct PWMImage {
+        uint32_t clockHz;           ///< MCPWM clock the image was resolved for
+        uint32_t frequency;         ///< Requested frequency (Hz)
+        float duty;                 ///< Requested duty (%)
+        uint16_t prescaler;         ///< timer_prescale field
+        uint16_t period;            ///< timer_period field
+        uint32_t compare;           ///< Comparator A value
+        PWMSynthResult synth;       ///< Achieved frequency, error, duty resolution
+    };
+
+    /**
+     * @brief Resolve frequency and duty into a register image (MODE_PWM_RPM only)
+     *
+     * Nothing is written to the hardware.
+     * @param preferredPrescaler Kept when its error is within tolerance, so
+     *        images resolved against the same prescaler switch glitch-free
+     * @return false if not in PWM mode, out of range or not synthesizable
+     */
+    bool resolvePWMImage(uint32_t frequency, float duty, uint32_t preferredPrescaler, PWMImage& image);
+
+    /**
+     * @brief Apply a resolved image (MODE_PWM_RPM only)
+     *
+     * Constant time: one shadow write, period and compare latch together
+     * at the next TEZ. A prescaler different from the current one is not
+     * shadowed and applies immediately. Stops a running ramp, sequence or
+     * RPM loop like setPWMFrequencyAndDuty().
+     * @return false if not in PWM mode, the image was resolved for another
+     *         clock or its frequency exceeds the current maximum
+     */
+    bool applyPWMImage(const PWMImage& image);
 
     /**
      * @brief Get current PWM frequency
-     * @return Current PWM frequency in Hz
+     * @return Requested PWM frequency in Hz (see getPWMSynthesis() for the achieved value)
      */
     uint32_t getPWMFrequency() const { return pwmFrequency; }
 
+    /**
+     * @brief Get the register pair in use and its exact output
+     * @return Achieved frequency, ppm error vs. getPWMFrequency(), duty resolution
+     */
+    const PWMSynthResult& getPWMSynthesis() const { return pwmSynth; }
+
+    /**
+     * @brief Get MCPWM clock feeding the timer prescaler
+     * @return Clock in Hz (base clock / group prescaler, read at init)
+     */
+    uint32_t getPWMClock() const { return mcpwmClockFreq; }
+
     /**
      * @brief Get current PWM duty cycle
      * @return Current duty cycle in percent
@@ -213,13 +411,13 @@ public:
 
     /**
      * @brief Get current PWM prescaler value
-     * @return Current prescaler value
+     * @return timer_prescale register field (timer clock = PWM clock / (value + 1))
      */
     uint32_t getPWMPrescaler() const { return pwmPrescaler; }
 
     /**
      * @brief Get current PWM period value (ticks)
-     * @return Current period value in timer ticks
+     * @return timer_period register field (one PWM cycle = value + 1 ticks)
      */
     uint32_t getPWMPeriod() const { return pwmPeriod; }
 
@@ -235,15 +433,116 @@ public:
      */
     bool isPWMEnabled() const { return pwmEnabled; }
 
+    // ========================================================================
+    // PWM Ramp (MODE_PWM_RPM only)
+    // ========================================================================
+
+    /**
+     * @brief Ramp progress snapshot
+     */
+    struct RampStatus {
+        bool active;
+        bool frequencyRamp;         ///< true = PWM_FREQ ramp, false = PWM_DUTY ramp
+        PWMRamp::Profile profile;
+        bool timerPaced;            ///< false = one step per PWM period (TEZ)
+        uint32_t durationMs;
+        uint32_t elapsedMs;
+        uint32_t step;              ///< Current table entry
+        uint32_t steps;             ///< Table length
+        float startValue;
+        float targetValue;
+    };
+
+    /**
+     * @brief Ramp PWM frequency to a new value without blocking
+     *
+     * Builds a per-step (period, compare) table and hands it to an
+     * interrupt that copies one entry at a time into the shadow registers,
+     * latched on TEZ like updatePWMRegistersDirectly(). Below
+     * RAMP_TEZ_MAX_HZ the interrupt is the MCPWM TEZ itself (one step per
+     * PWM period); above it a hardware timer paces steps at RAMP_TIMER_HZ
+     * to bound the interrupt rate. Any other PWM setter cancels the ramp.
+     *
+     * @param frequency Target frequency in Hz
+     * @param durationMs Ramp time (0 = set immediately)
+     * @param profile Ramp shape
+     * @return false if the ramp needs a prescaler change or PWM is not active
+     */
+    bool rampPWMFrequency(uint32_t frequency, uint32_t durationMs, PWMRamp::Profile profile);
+
+    /**
+     * @brief Ramp PWM duty cycle to a new value without blocking
+     * @param duty Target duty in percent (0.0 - 100.0)
+     * @param durationMs Ramp time (0 = set immediately)
+     * @param profile Ramp shape
+     * @return true if the ramp was started
+     */
+    bool rampPWMDuty(float duty, uint32_t durationMs, PWMRamp::Profile profile);
+
+    /**
+     * @brief Abort a running ramp, holding the current step
+     */
+    void stopRamp();
+
+    /**
+     * @brief Check if a ramp is running
+     */
+    bool isRamping() const { return rampActive; }
+
+    /**
+     * @brief Get ramp progress
+     */
+    RampStatus getRampStatus() const;
+
+    /**
+     * @brief Mirror ramp progress into frequency/duty and finish completed ramps
+     *
+     * Called periodically from PeripheralManager::update(); never blocks.
+     */
+    void updateRamp();
+
     /**
      * @brief Update RPM frequency measurement (MODE_PWM_RPM only)
      *
-     * Should be called periodically to update frequency reading from MCPWM Capture.
-     * Frequency is calculated from captured period between rising edges.
-     * Formula: frequency = 80,000,000 / capture_period
+     * Drains the capture ring filled by the MCPWM Capture ISR into the
+     * RPM filter. Called from PeripheralManager::update(); while the RPM
+     * loop runs, its task is the only consumer and this call returns early.
+     * Formula: frequency = periods × 80,000,000 / (t_last − t_first)
      */
     void updateRPMFrequency();
 
+    /**
+     * @brief Get the RPM filter (filter type, window, statistics)
+     * @return Reference to the filter fed by updateRPMFrequency()
+     */
+    RPMFilter& getRPMFilter() { return rpmFilter; }
+
+    /**
+     * @brief Get number of capture edges dropped because the ring was full
+     */
+    uint32_t getCaptureDrops() const { return captureRing.getDrops(); }
+
+    /**
+     * @brief Get active RPM measurement range
+     */
+    RPMRange getRPMRange() const { return rpmRange; }
+
+    /**
+     * @brief Get active RPM measurement range as string
+     */
+    const char* getRPMRangeName() const;
+
+    /**
+     * @brief Get RPM measurement interrupt rate (capture + PCNT overflow)
+     * @return Interrupts per second, averaged over the last second
+     */
+    uint32_t getRPMIsrRate() const { return rpmIsrRate; }
+
+    /**
+     * @brief Get number of automatic range switches since RPM init
+     */
+    uint32_t getRPMRangeSwitches() const { return rpmRangeSwitches; }
+
     /**
      * @brief Get measured RPM frequency on RX pin (MODE_PWM_RPM only)
      * @return Frequency in Hz, 0 if no signal or not in PWM_RPM mode
@@ -256,6 +555,136 @@ public:
      */
     bool hasRPMSignal() const;
 
+    // ========================================================================
+    // Stall Detection (MODE_PWM_RPM only)
+    // ========================================================================
+
+    /**
+     * @brief Actions taken when a stall is detected (bitmask)
+     */
+    enum StallAction : uint8_t {
+        STALL_ACTION_CUT_PWM = 0x01,    ///< Duty forced to 0 from the timer ISR
+        STALL_ACTION_BEEP = 0x02,       ///< Left to the stall callback (buzzer)
+        STALL_ACTION_NOTIFY = 0x04      ///< Left to the stall callback (WebSocket/SSE/BLE/HID)
+    };
+
+    /**
+     * @brief One detected stall
+     */
+    struct StallEvent {
+        uint32_t sequence;      ///< 1-based stall count
+        uint32_t timeMs;        ///< millis() when handled
+        uint32_t detectUs;      ///< Last tach edge → stall handled in task context
+        uint32_t timeoutUs;     ///< Timeout that expired
+        float lastRpm;          ///< Filtered RPM before the signal stopped
+        float duty;             ///< Duty that was applied
+        uint8_t actions;        ///< StallAction bits in effect
+    };
+
+    struct StallStats {
+        uint32_t count;
+        uint32_t lastDetectUs;
+        uint32_t minDetectUs;
+        uint32_t maxDetectUs;
+        uint64_t totalDetectUs;
+        uint32_t lastTimeMs;    ///< millis() of the last stall, 0 if none
+    };
+
+    typedef void (*StallCallback)(const StallEvent& event, void* arg);
+
+    /**
+     * @brief Receives every drained capture edge (see setEdgeTap)
+     * @param timestamp 80 MHz capture timer value, polarity in bit 0
+     * @param rising Edge polarity
+     * @param gap Edges were lost between the previous edge and this one
+     */
+    typedef void (*EdgeTap)(uint32_t timestamp, bool rising, bool gap, void* arg);
+
+    static const uint8_t STALL_MIN_PERIODS = 2;
+    static const uint8_t STALL_MAX_PERIODS = 16;
+    static const uint32_t STALL_MIN_TIMEOUT_US = 10000;
+    static const uint32_t STALL_MAX_TIMEOUT_US = 500000;   // Same as the polled signal timeout
+
+    /**
+     * @brief Enable hardware-timed stall detection
+     *
+     * Every capture interrupt re-arms a one-shot hardware timer to
+     * periods × the current edge interval (bounded to
+     * STALL_MIN_TIMEOUT_US - STALL_MAX_TIMEOUT_US). If no edge arrives in
+     * time the timer interrupt cuts PWM (if configured) and wakes a task
+     * that records the event and calls the stall callback. Armed by the
+     * first edge, so a fan that never started is not reported; ignored
+     * while duty is 0 or PWM is off. In the PCNT range the timer is
+     * re-armed once per gate with the maximum timeout.
+     */
+    bool setStallDetection(bool enabled);
+    bool isStallDetectionEnabled() const { return stallEnabled; }
+
+    /**
+     * @brief Set the timeout multiple
+     * @param periods STALL_MIN_PERIODS - STALL_MAX_PERIODS edge intervals
+     */
+    bool setStallPeriods(uint8_t periods);
+    uint8_t getStallPeriods() const { return stallPeriods; }
+
+    void setStallActions(uint8_t actions) { stallActions = actions & 0x07; }
+    uint8_t getStallActions() const { return stallActions; }
+
+    /**
+     * @brief Current stall timeout
+     */
+    uint32_t getStallTimeoutUs() const { return stallTimeoutUs; }
+
+    StallStats getStallStats() const { return stallStats; }
+    void resetStallStats();
+
+    /**
+     * @brief Register the function called (from the stall task) for every stall
+     */
+    void setStallCallback(StallCallback callback, void* arg);
+
+    // ========================================================================
+    // Pulse Width / Duty Measurement (MODE_PWM_RPM only)
+    // ========================================================================
+
+    /**
+     * @brief Capture both edges and measure high/low time, period and duty
+     *
+     * The capture switches to both edges; the ISR keeps queueing raw
+     * timestamps and carries the polarity in bit 0 (one 12.5 ns tick).
+     * Rising edges still feed the RPM filter. Auto-ranging stays in the
+     * every-edge capture range; above the ring's rate the capture
+     * throttles and the meter measures in bursts, dropping cycles that
+     * span a gap.
+     *
+     * PULSE_LOOPBACK routes the TX pad back into the capture input
+     * through the GPIO matrix, so the measured duty is what actually
+     * leaves the pin; statistics restart whenever the PWM setting
+     * changes. RPM then follows the PWM frequency, so loopback is
+     * refused while the RPM loop runs.
+     */
+    bool setPulseSource(PulseSource source);
+    PulseSource getPulseSource() const { return pulseSource; }
+    static const char* getPulseSourceName(PulseSource source);
+
+    PulseMeter::Statistics getPulseStatistics() const { return pulseMeter.getStatistics(); }
+    void resetPulseStatistics();
+
+    /**
+     * @brief Current level of the measured line (for 0 % / 100 % with no edges)
+     */
+    bool getPulseLineLevel() const;
+
+    /**
+     * @brief Hand every drained capture edge to a consumer (logic capture)
+     *
+     * While a tap is set the capture runs on both edges in the every-edge
+     * range, as for pulse measurement. The tap is called under the
+     * measurement lock from whichever task drains the ring, so it must be
+     * short; after setEdgeTap(nullptr, ...) returns it is no longer called.
+     */
+    void setEdgeTap(EdgeTap tap, void* arg);
+
     // ========================================================================
     // Motor Control Functions (MODE_PWM_RPM only)
     // ========================================================================
@@ -294,6 +723,154 @@ public:
      */
     float getCalculatedRPM() const;
 
+    // ========================================================================
+    // Closed-loop RPM Control (MODE_PWM_RPM only)
+    // ========================================================================
+
+    /**
+     * @brief Regulate motor speed to a target RPM
+     *
+     * A hardware timer wakes a high-priority task at the loop rate; the
+     * task refreshes the RPM measurement, runs the PID and writes the duty
+     * through the shadow registers. Calling again while running only
+     * changes the target. Any manual PWM setter or ramp leaves the loop.
+     * @param targetRpm Motor RPM (> 0)
+     * @return false if PWM is not active, pulse loopback is on or the timer cannot start
+     */
+    bool startRPMLoop(float targetRpm);
+
+    /**
+     * @brief Leave closed-loop mode, holding the current duty
+     */
+    void stopRPMLoop();
+
+    /**
+     * @brief Check if the RPM loop is running
+     */
+    bool isRPMLoopActive() const { return rpmLoopActive; }
+
+    /**
+     * @brief Set control loop rate
+     * @param hz 100 - 1000 Hz (applied immediately if running)
+     */
+    bool setRPMLoopRate(uint32_t hz);
+    uint32_t getRPMLoopRate() const { return rpmLoopHz; }
+
+    /**
+     * @brief Get the controller (gains, slew, feed-forward curve, metrics)
+     */
+    RPMController& getRPMController() { return rpmController; }
+
+    // ========================================================================
+    // PWM Sequencer (MODE_PWM_RPM only)
+    // ========================================================================
+
+    /**
+     * @brief Sequencer progress snapshot
+     */
+    struct SequenceStatus {
+        bool playing;
+        uint32_t length;            ///< Table entries
+        uint32_t loopStart;         ///< Entry later passes restart from
+        uint32_t repeat;            ///< Passes requested (0 = endless)
+        uint32_t index;             ///< Entry being played
+        uint32_t pass;              ///< Current pass (0-based)
+        uint32_t stepsPlayed;       ///< Steps completed since playback start
+        uint32_t elapsedMs;
+        uint64_t durationMs;        ///< Total for the requested passes (one pass if endless)
+        uint32_t results;           ///< Entries in the result buffer
+        uint32_t resultsDropped;    ///< Steps not recorded because the buffer was full
+        uint32_t prescaler;         ///< Prescaler field used for the whole table
+        double worstPpm;            ///< Largest frequency error in the compiled table
+    };
+
+    /**
+     * @brief Remove all profile entries
+     * @return false while playing
+     */
+    bool clearSequence();
+
+    /**
+     * @brief Append one profile entry
+     * @return false while playing, if the entry is out of range or the table is full
+     */
+    bool appendSequence(const PWMSequenceEntry& entry);
+
+    /**
+     * @brief Replace the profile with parsed text (see PWMSequence for the format)
+     * @param errorLine Optional: receives the first bad line (0 if the error is not line-specific)
+     * @return false while playing or on a parse error (table unchanged)
+     */
+    bool loadSequenceText(const char* text, size_t length, size_t* errorLine = nullptr);
+
+    uint32_t getSequenceLength() const { return seqLength; }
+
+    /**
+     * @brief Get a profile entry
+     * @return nullptr if index is out of range
+     */
+    const PWMSequenceEntry* getSequenceEntry(uint32_t index) const;
+
+    /**
+     * @brief Set the entry repeated passes restart from
+     * @return false while playing or if index is not a table entry
+     */
+    bool setSequenceLoopStart(uint32_t index);
+    uint32_t getSequenceLoopStart() const { return seqLoopStart; }
+
+    /**
+     * @brief Play the profile with hardware-timed transitions
+     *
+     * The whole table is compiled for one prescaler, so every transition
+     * goes through the shadow registers. A hardware timer alarm fires at
+     * each dwell boundary; its interrupt writes the next step and wakes a
+     * task that samples the RPM for the step just finished into the
+     * result buffer. Any manual PWM setter, ramp or RPM loop stops it.
+     * @param repeat Passes to play (0 = until stopped)
+     * @return false if PWM is not active, the table is empty or does not compile
+     */
+    bool playSequence(uint32_t repeat);
+
+    /**
+     * @brief Stop playback, holding the current step
+     */
+    void stopSequence();
+
+    bool isSequencePlaying() const { return seqPlaying; }
+
+    /**
+     * @brief Get sequencer progress
+     */
+    SequenceStatus getSequenceStatus() const;
+
+    /**
+     * @brief Number of recorded steps (kept until the next playback starts)
+     */
+    uint32_t getSequenceResultCount() const { return seqResultCount; }
+
+    /**
+     * @brief Get a recorded step
+     * @return nullptr if index is out of range
+     */
+    const PWMSequenceResult* getSequenceResult(uint32_t index) const;
+
+    /**
+     * @brief Mirror sequencer progress into frequency/duty and finish completed playback
+     *
+     * Called periodically from PeripheralManager::update(); never blocks.
+     */
+    void updateSequence();
+
+    /**
+     * @brief Save the profile to flash (SPIFFS, same text format as uploads)
+     */
+    bool saveSequence();
+
+    /**
+     * @brief Load the profile saved by saveSequence()
+     */
+    bool loadSequence();
+
     // ========================================================================
     // Settings Persistence
     // ========================================================================
@@ -310,6 +887,16 @@ public:
      */
     bool loadSettings();
 
+    /**
+     * @brief Load only the RPM filter and speed loop configuration from NVS
+     *
+     * Called at boot so the measurement filter, PID tuning and learned
+     * feed-forward curve survive a reset even though motor settings are
+     * only restored by LOAD.
+     * @return true if successful
+     */
+    bool loadRPMSettings();
+
     /**
      * @brief Reset UART1 settings to factory defaults
      */
@@ -337,11 +924,28 @@ public:
      * @return Current baud rate (0 if not in UART mode)
      */
     uint32_t getUARTBaudRate() const { return uartBaudRate; }
+    uart_stop_bits_t getUARTStopBits() const { return uartStopBits; }
+    uart_parity_t getUARTParity() const { return uartParity; }
+    uart_word_length_t getUARTDataBits() const { return uartDataBits; }
 
 private:
     Mode currentMode = MODE_DISABLED;
     uart_port_t uartNum = UART_NUM_UART1;
 
+    // Mode switching: drivers are installed on first use and kept; a switch
+    // parks the active peripheral and reroutes the pins in the GPIO matrix
+    static const uint32_t UART_DRAIN_TIMEOUT_MS = 100;     // Pending TX before leaving UART mode
+    static const uint32_t MODE_SETTLE_FRAMES = 4;          // RX idle wait limit, in character times
+    static const int64_t PWM_SETTLE_TIMEOUT_US = 200;      // Slowest counter tick is ~26 µs
+    bool uartInstalled = false;
+    static const int UART_EVENT_QUEUE_SIZE = 32;
+    QueueHandle_t uartEventQueue = nullptr;    // Read only while bridged; full queue drops events
+    bool pwmInitialized = false;
+    bool rpmInitialized = false;
+    bool captureRearm = false;         // Capture left prescaled/throttled/on PCNT by the last session
+    bool pinsReleased = true;
+    ModeSwitchStats switchStats = {};
+
     // Critical section mutex for atomic PWM parameter updates
     portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
 
@@ -353,14 +957,18 @@ private:
     uint32_t uartTxBytes = 0;
     uint32_t uartRxBytes = 0;
     uint32_t uartErrors = 0;
+    // Asynchronous TX: write() queues into the driver ring; fences count queued bytes
+    UARTTxCombiner txCombiner{*this, uartNum};
 
     // PWM mode state (MCPWM)
     uint32_t pwmFrequency = 1000;      // Default 1kHz
     float pwmDuty = 50.0;              // Default 50%
     bool pwmEnabled = false;
-    uint32_t pwmPrescaler = 0;         // Current prescaler value
-    uint32_t pwmPeriod = 0;            // Current period value (ticks)
-    uint32_t mcpwmClockFreq = 80000000; // MCPWM clock frequency (detected at init)
+    uint32_t pwmPrescaler = 0;         // timer_prescale field (divide by value + 1)
+    uint32_t pwmPeriod = 0;            // timer_period field (value + 1 ticks per cycle)
+    uint32_t mcpwmClockFreq = 10000000; // Clock into the timer prescaler (read at init)
+    PWMSynthResult pwmSynth = {};      // Achieved output for pwmFrequency
+    PWMSynth::Constraints pwmSynthConstraints = PWMSynth::defaultConstraints();
     bool pwmChangePulseState = false;  // GPIO12 toggle state for non-blocking pulse
 
     // Motor control parameters (integrated from old MotorControl)
@@ -368,11 +976,69 @@ private:
     uint32_t maxFrequency = 100000;    // Maximum frequency limit (100 kHz)
 
     // RPM measurement state (MCPWM Capture)
-    float rpmFrequency = 0.0;              // Measured frequency in Hz
-    unsigned long lastRPMUpdate = 0;       // Last valid capture time
-    static volatile uint32_t capturePeriod;        // Period between captures (in timer ticks)
-    static volatile bool newCaptureAvailable;      // New capture data flag
-    static volatile unsigned long lastCaptureTime; // Timestamp of last capture
+    static const size_t CAPTURE_RING_SIZE = 256;   // Edges buffered between task polls
+    static const uint32_t RPM_SIGNAL_TIMEOUT_MS = 500;
+    float rpmFrequency = 0.0;              // Filtered frequency in Hz
+    unsigned long lastRPMUpdate = 0;       // Last time an edge was drained
+    CaptureRing<CAPTURE_RING_SIZE> captureRing;    // ISR → task timestamps (internal RAM)
+    RPMFilter rpmFilter;                   // Reciprocal counting + digital filter
+
+    // Dual-edge pulse measurement (fed from the same ring as rpmFilter)
+    volatile PulseSource pulseSource = PULSE_OFF;
+    PulseMeter pulseMeter;
+    uint32_t pulseRefPeriod = 0;           // PWM period/duty the loopback statistics belong to
+    float pulseRefDuty = 0.0f;
+    volatile bool captureBothEdges = false;    // Pulse measurement or edge tap active
+    EdgeTap edgeTap = nullptr;
+    void* edgeTapArg = nullptr;
+    volatile TrafficTap trafficTap = nullptr;
+    void* volatile trafficTapArg = nullptr;
+
+    // Auto-ranging: capture below ~2 kHz, prescaled capture up to ~20 kHz,
+    // PCNT gated counting above. Down-thresholds are lower for hysteresis.
+    static const uint16_t RPM_CAPTURE_DIV = 16;            // Capture prescaler in RPM_RANGE_CAPTURE_DIV
+    static constexpr float RPM_DIV_UP_HZ = 2000.0f;
+    static constexpr float RPM_DIV_DOWN_HZ = 1500.0f;
+    static constexpr float RPM_PCNT_UP_HZ = 20000.0f;
+    static constexpr float RPM_PCNT_DOWN_HZ = 15000.0f;
+    static const uint32_t PCNT_GATE_MS = 100;              // Gate time per PCNT sample
+    static const int16_t PCNT_HIGH_LIMIT = 32000;          // Counter wraps here (overflow ISR)
+    RPMRange rpmRange = RPM_RANGE_CAPTURE;
+    uint32_t rpmRangeSwitches = 0;
+    volatile bool captureThrottled = false;                // ISR disabled itself on ring overflow
+    volatile uint32_t rpmIsrCount = 0;                     // Capture + PCNT overflow interrupts
+    uint32_t rpmIsrRate = 0;
+    uint32_t rpmIsrCountLast = 0;
+    unsigned long rpmIsrRateTime = 0;
+    volatile uint32_t pcntOverflows = 0;
+    bool pcntIsrInstalled = false;
+    uint32_t pcntGateCount = 0;                            // Total count at gate start
+    int64_t pcntGateStartUs = 0;
+
+    // Stall detection. The capture ISR pushes the alarm of a free-running
+    // 1 MHz timer forward on every edge; the alarm ISR only cuts PWM and
+    // notifies the stall task (no FPU in interrupts).
+    volatile bool stallEnabled = false;
+    volatile bool stallArmed = false;                      // PWM/RPM mode active and detection on
+    volatile uint32_t stallTimeoutUs = STALL_MAX_TIMEOUT_US;
+    volatile uint32_t stallLastEdgeUs = 0;                 // Timer count (low 32 bits) at the last edge
+    volatile bool stallPWMCut = false;                     // ISR zeroed the compare; the task reconciles pwmDuty
+    uint8_t stallPeriods = 4;
+    uint8_t stallActions = STALL_ACTION_NOTIFY;
+    bool stallTimerRunning = false;
+    StallStats stallStats = {};
+    StallCallback stallCallback = nullptr;
+    void* stallCallbackArg = nullptr;
+    TaskHandle_t stallTaskHandle = nullptr;
+
+    bool startStallTimer();
+    void stopStallTimer();
+    void rearmStallTimer();
+    void disarmStallTimer();
+    void updateStallTimeout();
+    void handleStall();
+    static void stallTask(void* arg);
+    static bool IRAM_ATTR stallTimerISR(void* arg);
 
     // Static callback function for MCPWM Capture ISR
     static bool IRAM_ATTR captureCallback(mcpwm_unit_t mcpwm,
@@ -380,21 +1046,128 @@ private:
                                           const cap_event_data_t *edata,
                                           void *user_data);
 
+    // PCNT high-limit (overflow) ISR handler
+    static void IRAM_ATTR pcntOverflowHandler(void* arg);
+
     // Helper functions
     bool initUART();
     bool initPWM();
     bool initRPM();
-    void deinitUART();
-    void deinitPWM();
-    void deinitRPM();
+    bool switchToUART(uint32_t baudRate, uart_stop_bits_t stopBits,
+                      uart_parity_t parity, uart_word_length_t dataBits);
+    bool switchToPWM_RPM();
+    void parkMode();
+    void parkPWM();
+    void parkRPM();
+    void routePins(Mode mode);
+    bool waitRxIdle();
+    bool waitPWMRunning();
+    void recordModeSwitch(int64_t startUs, bool settled);
+    void tapTraffic(const uint8_t* data, size_t length, bool tx);
+    bool isTxOpen() override { return currentMode == MODE_UART; }
+    int queueTx(const uint8_t* data, size_t len) override;
+    static void summarizeLatencies(uint32_t* samples, uint32_t count, ModeSwitchPercentiles& out);
+    void releaseDrivers();
+    bool enableCapture(uint32_t prescale);
+    bool startPCNT();
+    void stopPCNT();
+    uint32_t readPCNTTotal();
+    void updatePCNTSample();
+    void selectRPMRange();
+    void setRPMRange(RPMRange range);
+    void routeCaptureInput();
+    void haltCapture();
+    bool restartCapture(bool active);
     void releasePins();
     bool validateUARTConfig(uint32_t baudRate, uart_stop_bits_t stopBits,
                            uart_parity_t parity, uart_word_length_t dataBits);
     bool validatePWMFrequency(uint32_t frequency);
 
+    // PWM ramp state. The table is written in task context before the
+    // interrupt source is enabled and only read by the interrupt afterwards.
+    static const uint32_t RAMP_TEZ_MAX_HZ = 5000;   // Highest PWM frequency paced by TEZ
+    static const uint32_t RAMP_TIMER_HZ = 2000;     // Step rate when paced by timer
+    PWMRampStep* rampTable = nullptr;              // PSRAM when available
+    volatile uint32_t rampLength = 0;
+    volatile uint32_t rampIndex = 0;
+    volatile uint32_t rampRemaining = 0;            // Pacing events left on current entry
+    volatile bool rampDone = false;                 // Set by ISR after the last entry
+    bool rampActive = false;
+    bool rampIsFrequency = false;
+    bool rampTimerPaced = false;
+    PWMRamp::Profile rampProfile = PWMRamp::PROFILE_LINEAR;
+    uint32_t rampDurationMs = 0;
+    unsigned long rampStartTime = 0;
+    float rampStartValue = 0.0;
+    float rampTargetValue = 0.0;
+    uint32_t rampPeriodClock = 0;                   // Counter clock after prescaler during the ramp
+    intr_handle_t rampTezHandle = nullptr;
+
+    bool startRamp(const PWMRamp::Endpoint& target, uint32_t durationMs, PWMRamp::Profile profile);
+    void releaseRampSource();
+    void mirrorRampStep();
+    void IRAM_ATTR rampTick();
+    static void IRAM_ATTR rampTezISR(void* arg);
+    static bool IRAM_ATTR rampTimerISR(void* arg);
+
+    // Closed-loop RPM control. The timer ISR only notifies the loop task
+    // (no FPU in interrupts); rpmMeasureLock serialises the measurement
+    // consumer so PeripheralManager and the loop task never drain together.
+    // It is recursive and also held by every PWM setter and stop*() teardown,
+    // so the stall task's PWM cut cannot interleave with a command.
+    static const uint32_t RPM_LOOP_MIN_HZ = 100;
+    static const uint32_t RPM_LOOP_MAX_HZ = 1000;
+    RPMController rpmController;
+    TaskHandle_t rpmLoopTaskHandle = nullptr;
+    SemaphoreHandle_t rpmMeasureLock = nullptr;
+    volatile bool rpmLoopActive = false;
+    uint32_t rpmLoopHz = 200;
+    int64_t rpmLoopLastUs = 0;
+    uint32_t rpmLoopLastSample = 0;                 // Filter sample count at the last learn
+
+    void measureRPM();
+    bool startRPMLoopTimer();
+    void stopRPMLoopTimer();
+    void rpmLoopStep();
+    static void rpmLoopTask(void* arg);
+    static bool IRAM_ATTR rpmLoopTimerISR(void* arg);
+
+    // PWM sequencer. Entries and compiled steps are only modified while
+    // stopped; the timer ISR walks the steps, and the sequencer task turns
+    // each completed step ordinal into a result under rpmMeasureLock.
+    PWMSequenceEntry* seqEntries = nullptr;         // PSRAM when available
+    PWMSequenceStep* seqSteps = nullptr;
+    PWMSequenceResult* seqResults = nullptr;
+    uint32_t seqLength = 0;
+    uint32_t seqLoopStart = 0;
+    uint32_t seqRepeat = 1;
+    volatile uint32_t seqIndex = 0;
+    volatile uint32_t seqPass = 0;
+    volatile uint32_t seqOrdinal = 0;               // Steps completed (written by ISR)
+    volatile bool seqDone = false;                  // Set by ISR after the last step
+    volatile bool seqPlaying = false;
+    uint32_t seqRecorded = 0;                       // Steps turned into results
+    uint64_t seqRecordedEndUs = 0;                  // Scheduled end of the last recorded step
+    volatile uint32_t seqResultCount = 0;
+    uint32_t seqResultsDropped = 0;
+    uint32_t seqPrescaler = 0;
+    double seqWorstPpm = 0.0;
+    unsigned long seqStartTime = 0;
+    TaskHandle_t seqTaskHandle = nullptr;
+
+    bool allocateSequence();
+    void releaseSequenceTimer();
+    void mirrorSequenceStep();
+    void recordSequenceSteps();
+    void IRAM_ATTR sequenceTick();
+    static void sequenceTask(void* arg);
+    static bool IRAM_ATTR sequenceTimerISR(void* arg);
+
     // PWM low-level register manipulation helpers
-    void calculatePWMParameters(uint32_t frequency, uint32_t& prescaler, uint32_t& period);
     void updatePWMRegistersDirectly(uint32_t period, float duty);
+    uint32_t dutyToCompare(uint32_t period, float duty) const;
+    void commitPWMShadow(uint32_t period, float duty);  // Period + compare latched on the same TEZ
+    void IRAM_ATTR writePWMShadow(uint32_t period, uint32_t compare);  // Task or ISR context
 
     // Debug/Test functions
     void initPWMChangePulse();    // Initialize GPIO 12 for pulse output
@@ -2,6 +2,11 @@
 
 
 #include "driver/gpio.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+
+static const uint32_t FRAME_POLL_MS = 50;          // Receiver task: check for stop
+static const uint32_t FRAME_STOP_TIMEOUT_MS = 500;
 
 UART2Manager::UART2Manager() {
 }
@@ -54,7 +59,8 @@ bool UART2Manager::begin(uint32_t baudRate, uart_stop_bits_t stopBits,
     gpio_set_pull_mode((gpio_num_t)PIN_UART2_RX, GPIO_PULLUP_ONLY);
 
     // Install UART driver with buffers
-    err = uart_driver_install(uartNum, rxBufferSize, txBufferSize, 0, NULL, 0);
+    // Event queue: read by the frame receiver or while bridged; the driver drops events when it is full
+    err = uart_driver_install(uartNum, rxBufferSize, txBufferSize, EVENT_QUEUE_SIZE, &eventQueue, 0);
     if (err != ESP_OK) {
         Serial.printf("[UART2] uart_driver_install failed: %d\n", err);
         return false;
@@ -69,6 +75,9 @@ bool UART2Manager::begin(uint32_t baudRate, uart_stop_bits_t stopBits,
     rxBufSize = rxBufferSize;
     initialized = true;
 
+    // A frame must fit into the driver buffer with room for the next one
+    frameSplitLength = rxBufferSize / 2 < MAX_FRAME_LENGTH ? rxBufferSize / 2 : MAX_FRAME_LENGTH;
+
     Serial.printf("[UART2] Initialized: %u baud, %d data bits, %d stop bits\n",
                   baudRate, dataBits + 5, stopBits + 1);
 
@@ -80,7 +89,12 @@ void UART2Manager::end() {
         return;
     }
 
+    stopFrames();
+    flushCombined();
+    uart_wait_tx_done(uartNum, pdMS_TO_TICKS(100));
     uart_driver_delete(uartNum);
+    eventQueue = nullptr;
+    idleCharacters = IDLE_DEFAULT_CHARACTERS;   // The next driver install starts at the default
     initialized = false;
 
     Serial.println("[UART2] Shutdown complete");
@@ -134,12 +148,7 @@ int UART2Manager::write(const uint8_t* data, size_t len, uint32_t timeoutMs) {
         return -1;
     }
 
-    int written = uart_write_bytes(uartNum, (const char*)data, len);
-    if (written > 0) {
-        totalTxBytes += written;
-    } else {
-        errorCount++;
-    }
+    int written = txCombiner.write(data, len);     // Staged bytes go first
 
     // Optional: Wait for transmission to complete
     if (timeoutMs > 0) {
@@ -161,9 +170,15 @@ int UART2Manager::read(uint8_t* buffer, size_t maxLen, uint32_t timeoutMs) {
         return -1;
     }
 
+    // The bytes belong to the frame receiver
+    if (frameMode != FRAME_OFF) {
+        return -1;
+    }
+
     int len = uart_read_bytes(uartNum, buffer, maxLen, pdMS_TO_TICKS(timeoutMs));
     if (len > 0) {
         totalRxBytes += len;
+        tapTraffic(buffer, len, false);
     } else if (len < 0) {
         errorCount++;
     }
@@ -176,47 +191,28 @@ int UART2Manager::readLine(char* buffer, size_t maxLen, uint32_t timeoutMs) {
         return -1;
     }
 
-    size_t idx = 0;
-    uint32_t startTime = millis();
-
-    while (idx < maxLen - 1) {
-        // Check timeout
-        if (millis() - startTime >= timeoutMs) {
-            buffer[idx] = '\0';
-            return (idx > 0) ? idx : 0;  // Return 0 for timeout with no data
-        }
+    // Lines come from the frame receiver
+    if (frameMode == FRAME_OFF && !startFrames(FRAME_LINE)) {
+        return -1;
+    }
 
-        // Read one byte
-        uint8_t c;
-        int result = uart_read_bytes(uartNum, &c, 1, pdMS_TO_TICKS(10));
+    Frame frame;
+    if (!receiveFrame(frame, timeoutMs)) {
+        buffer[0] = '\0';
+        return 0;
+    }
 
-        if (result == 1) {
-            totalRxBytes++;
+    bool newline = frameMode == FRAME_LINE && !(frame.flags & FRAME_FLAG_SPLIT);
+    size_t room = maxLen - 1 - (newline ? 1 : 0);
+    size_t len = frame.length < room ? frame.length : room;
+    memcpy(buffer, frame.data, len);
+    releaseFrame(frame);
 
-            // Check for newline
-            if (c == '\n') {
-                buffer[idx++] = c;
-                buffer[idx] = '\0';
-                return idx;
-            }
-            // Skip \r (handle \r\n or \n)
-            else if (c == '\r') {
-                continue;
-            }
-            // Store character
-            else {
-                buffer[idx++] = c;
-            }
-        } else if (result < 0) {
-            errorCount++;
-            return -1;
-        }
-        // result == 0: No data yet, continue waiting
+    if (newline) {
+        buffer[len++] = '\n';
     }
-
-    // Buffer full
-    buffer[maxLen - 1] = '\0';
-    return maxLen - 1;
+    buffer[len] = '\0';
+    return len;
 }
 
 int UART2Manager::available() {
@@ -238,6 +234,30 @@ bool UART2Manager::flush(uint32_t timeoutMs) {
     return (err == ESP_OK);
 }
 
+int UART2Manager::queueTx(const uint8_t* data, size_t len) {
+    int written = uart_write_bytes(uartNum, (const char*)data, len);
+    if (written > 0) {
+        totalTxBytes += written;
+        tapTraffic(data, written, true);
+    } else {
+        errorCount++;
+    }
+    return written;
+}
+
+void UART2Manager::setTrafficTap(TrafficTap tap, void* arg) {
+    // Argument first: a reader seeing the new tap also sees its argument
+    trafficTapArg = arg;
+    trafficTap = tap;
+}
+
+void UART2Manager::tapTraffic(const uint8_t* data, size_t length, bool tx) {
+    TrafficTap tap = trafficTap;
+    if (tap && length > 0) {
+        tap(data, length, tx, trafficTapArg);
+    }
+}
+
 void UART2Manager::clearRxBuffer() {
     if (!initialized) {
         return;
@@ -246,6 +266,270 @@ void UART2Manager::clearRxBuffer() {
     uart_flush_input(uartNum);
 }
 
+// ============================================================================
+// Frame Receiver
+// ============================================================================
+
+const char* UART2Manager::getFrameModeName(FrameMode mode) {
+    switch (mode) {
+        case FRAME_OFF:       return "OFF";
+        case FRAME_LINE:      return "LINE";
+        case FRAME_DELIMITER: return "DELIMITER";
+        case FRAME_IDLE:      return "IDLE";
+        default:              return "UNKNOWN";
+    }
+}
+
+bool UART2Manager::allocateFrameRing() {
+    if (frameRing) {
+        return true;
+    }
+
+    frameRingStorage = static_cast<uint8_t*>(heap_caps_malloc(FRAME_RING_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+    if (frameRingStorage) {
+        frameRingSize = FRAME_RING_SIZE;
+        frameRingInPSRAM = true;
+    } else {
+        frameRingStorage = static_cast<uint8_t*>(heap_caps_malloc(FRAME_RING_FALLBACK, MALLOC_CAP_8BIT));
+        if (!frameRingStorage) {
+            Serial.println("[UART2] Frame ring allocation failed");
+            return false;
+        }
+        frameRingSize = FRAME_RING_FALLBACK;
+        frameRingInPSRAM = false;
+    }
+
+    // Only tasks touch the ring, so its storage may live in PSRAM
+    frameRing = xRingbufferCreateStatic(frameRingSize, RINGBUF_TYPE_NOSPLIT, frameRingStorage, &frameRingStruct);
+    if (!frameRing) {
+        heap_caps_free(frameRingStorage);
+        frameRingStorage = nullptr;
+        frameRingSize = 0;
+        return false;
+    }
+
+    Serial.printf("[UART2] Frame ring: %u bytes in %s\n",
+                  (unsigned)frameRingSize, frameRingInPSRAM ? "PSRAM" : "internal RAM");
+    return true;
+}
+
+bool UART2Manager::startFrames(FrameMode mode, uint8_t delimiter) {
+    if (!initialized || mode == FRAME_OFF) {
+        return false;
+    }
+
+    stopFrames();
+    if (!allocateFrameRing()) {
+        return false;
+    }
+
+    // Frames of an earlier session are stale
+    size_t size;
+    void* item;
+    while ((item = xRingbufferReceive(frameRing, &size, 0)) != nullptr) {
+        vRingbufferReturnItem(frameRing, item);
+    }
+
+    frameAssembler.start((FrameAssembler::Mode)mode, delimiter, frameSplitLength);
+    rxOverflows = 0;
+
+    // Delimiter positions are only recorded from here on: start empty
+    uart_flush_input(uartNum);
+    if (mode != FRAME_IDLE) {
+        // One delimiter is a pattern; no idle time around it
+        uart_enable_pattern_det_baud_intr(uartNum, frameAssembler.getDelimiter(), 1, 9, 0, 0);
+        uart_pattern_queue_reset(uartNum, PATTERN_QUEUE_SIZE);
+    }
+    xQueueReset(eventQueue);
+
+    frameStopRequested = false;
+    frameMode = mode;
+
+    BaseType_t ok = xTaskCreatePinnedToCore(
+        frameTask,
+        "UART2_Frames",
+        4096,
+        this,
+        3,                  // Same as the RPM loop: keep the driver buffer drained at 1.5 Mbps
+        &frameTaskHandle,
+        1);
+    if (ok != pdPASS) {
+        frameTaskHandle = nullptr;
+        frameMode = FRAME_OFF;
+        uart_disable_pattern_det_intr(uartNum);
+        return false;
+    }
+
+    if (mode == FRAME_IDLE) {
+        Serial.println("[UART2] Frame receiver: IDLE");
+    } else {
+        Serial.printf("[UART2] Frame receiver: %s (delimiter 0x%02X)\n", getFrameModeName(mode),
+                      frameAssembler.getDelimiter());
+    }
+    return true;
+}
+
+bool UART2Manager::setIdleCharacters(uint8_t characters) {
+    if (!initialized || characters < 1 || characters > IDLE_MAX_CHARACTERS) {
+        return false;
+    }
+    if (uart_set_rx_timeout(uartNum, characters) != ESP_OK) {
+        return false;
+    }
+    idleCharacters = characters;
+    return true;
+}
+
+void UART2Manager::stopFrames() {
+    if (frameMode == FRAME_OFF) {
+        return;
+    }
+
+    frameStopRequested = true;
+    unsigned long stopStart = millis();
+    while (frameTaskHandle && millis() - stopStart < FRAME_STOP_TIMEOUT_MS) {
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+    uart_disable_pattern_det_intr(uartNum);
+    frameMode = FRAME_OFF;
+}
+
+bool UART2Manager::receiveFrame(Frame& frame, uint32_t timeoutMs) {
+    if (!frameRing) {
+        return false;
+    }
+
+    size_t size = 0;
+    FrameHeader* header = static_cast<FrameHeader*>(
+        xRingbufferReceive(frameRing, &size, pdMS_TO_TICKS(timeoutMs)));
+    if (!header) {
+        return false;
+    }
+
+    frame.data = reinterpret_cast<const uint8_t*>(header + 1);
+    frame.length = header->length;
+    frame.timestamp = header->timestamp;
+    frame.timestampUs = header->timestampUs;
+    frame.flags = header->flags;
+    frame.item = header;
+    return true;
+}
+
+void UART2Manager::releaseFrame(Frame& frame) {
+    if (frameRing && frame.item) {
+        vRingbufferReturnItem(frameRing, frame.item);
+    }
+    frame.item = nullptr;
+    frame.data = nullptr;
+}
+
+UART2Manager::FrameStatistics UART2Manager::getFrameStatistics() const {
+    const FrameAssembler::Statistics& assembled = frameAssembler.getStatistics();
+    FrameStatistics stats;
+    stats.frames = assembled.frames;
+    stats.splitFrames = assembled.splitFrames;
+    stats.droppedFrames = assembled.droppedFrames;
+    stats.droppedBytes = assembled.droppedBytes;
+    stats.rxOverflows = rxOverflows;
+    return stats;
+}
+
+size_t UART2Manager::getFrameRingUsed() const {
+    if (!frameRing) {
+        return 0;
+    }
+    return frameRingSize - xRingbufferGetCurFreeSize(frameRing);
+}
+
+void UART2Manager::frameTask(void* arg) {
+    UART2Manager* self = static_cast<UART2Manager*>(arg);
+    self->frameLoop();
+    self->frameTaskHandle = nullptr;
+    vTaskDelete(NULL);
+}
+
+void UART2Manager::frameLoop() {
+    while (!frameStopRequested) {
+        uart_event_t event;
+        if (xQueueReceive(eventQueue, &event, pdMS_TO_TICKS(FRAME_POLL_MS)) != pdTRUE) {
+            // The RX timeout interrupt needs data in the FIFO: a frame that
+            // ended exactly on a FIFO-full read has no idle event
+            if (frameMode == FRAME_IDLE) {
+                collectFrames(true);
+            }
+            continue;
+        }
+
+        bool idle = false;
+        switch (event.type) {
+            case UART_DATA:
+                idle = event.timeout_flag;      // RX timeout interrupt: the line went quiet
+                break;
+            case UART_FIFO_OVF:
+                // The driver resets the FIFO; the buffered data and delimiter
+                // positions stay valid, the frame spanning the loss does not
+                rxOverflows++;
+                errorCount++;
+                frameAssembler.markLoss();
+                break;
+            case UART_PARITY_ERR:
+            case UART_FRAME_ERR:
+                errorCount++;
+                break;
+            default:
+                break;  // UART_PATTERN_DET / UART_BUFFER_FULL: collected below
+        }
+        collectFrames(idle);
+    }
+}
+
+void UART2Manager::collectFrames(bool idle) {
+    while (!frameStopRequested && frameAssembler.collectOne(frameInput, frameOutput, idle)) {
+    }
+}
+
+size_t UART2Manager::DriverInput::buffered() {
+    size_t buffered = 0;
+    uart_get_buffered_data_len(owner.uartNum, &buffered);
+    return buffered;
+}
+
+int UART2Manager::DriverInput::delimiterPosition() {
+    return uart_pattern_get_pos(owner.uartNum);
+}
+
+void UART2Manager::DriverInput::popDelimiter() {
+    uart_pattern_pop_pos(owner.uartNum);
+}
+
+size_t UART2Manager::DriverInput::read(uint8_t* buffer, size_t length) {
+    int got = uart_read_bytes(owner.uartNum, buffer, length, 0);
+    if (got <= 0) {
+        return 0;
+    }
+    owner.totalRxBytes += got;
+    owner.tapTraffic(buffer, got, false);
+    return got;
+}
+
+uint8_t* UART2Manager::RingOutput::acquire(size_t length) {
+    void* item = nullptr;
+    if (xRingbufferSendAcquire(owner.frameRing, &item, sizeof(FrameHeader) + length, 0) != pdTRUE) {
+        return nullptr;
+    }
+    return reinterpret_cast<uint8_t*>(static_cast<FrameHeader*>(item) + 1);
+}
+
+void UART2Manager::RingOutput::complete(uint8_t* data, size_t length, uint8_t flags) {
+    FrameHeader* header = reinterpret_cast<FrameHeader*>(data) - 1;
+    header->timestamp = millis();
+    header->timestampUs = (uint32_t)esp_timer_get_time();
+    header->length = length;
+    header->flags = flags;
+    header->reserved = 0;
+    xRingbufferSendComplete(owner.frameRing, header);
+}
+
 void UART2Manager::getStatistics(uint32_t* txBytes, uint32_t* rxBytes, uint32_t* errors) {
     if (txBytes) *txBytes = totalTxBytes;
     if (rxBytes) *rxBytes = totalRxBytes;
@@ -3,7 +3,13 @@
 
 #include <Arduino.h>
 #include "driver/uart.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/ringbuf.h"
+#include "freertos/semphr.h"
 #include "PeripheralPins.h"
+#include "FrameAssembler.h"
+#include "UARTTxCombiner.h"
 
 /**
  * @brief UART2 Manager - Standard UART communication interface
@@ -15,6 +21,7 @@
  * - Configurable data bits (5, 6, 7, 8)
  * - TX/RX buffering with DMA
  * - Non-blocking read/write operations
+ * - Interrupt-driven line / frame receiver (startFrames)
  *
  * Hardware:
  * - GPIO 43: UART2 TX (with internal pull-up)
@@ -26,9 +33,73 @@
  *   uart2.write("Hello\n", 6);
  *   uint8_t buf[128];
  *   int len = uart2.read(buf, 128);
+ *
+ * Frame receiver:
+ *   The UART's pattern detection interrupt marks every delimiter (or the
+ *   RX timeout interrupt marks an idle gap); a receiver task moves each
+ *   complete frame out of the driver buffer with one read into a frame
+ *   ring (PSRAM, FRAME_RING_SIZE: several seconds of a 1.5 Mbps burst).
+ *   No byte is looked at in software. Where to cut is decided by
+ *   FrameAssembler (host-tested), fed from the driver buffer.
+ *
+ *   uart2.startFrames(UART2Manager::FRAME_LINE);
+ *   UART2Manager::Frame frame;
+ *   if (uart2.receiveFrame(frame, 1000)) {
+ *       // frame.data / frame.length (without "\r\n")
+ *       uart2.releaseFrame(frame);
+ *   }
  */
-class UART2Manager {
+class UART2Manager : private UARTTxCombiner::Port {
 public:
+    /**
+     * @brief How the frame receiver splits the RX stream
+     */
+    enum FrameMode : uint8_t {
+        FRAME_OFF = FrameAssembler::MODE_OFF,
+        FRAME_LINE = FrameAssembler::MODE_LINE,             ///< '\n'-terminated lines, a trailing '\r' is removed
+        FRAME_DELIMITER = FrameAssembler::MODE_DELIMITER,   ///< Terminated by a custom delimiter byte
+        FRAME_IDLE = FrameAssembler::MODE_IDLE              ///< Everything up to an RX idle gap (setIdleCharacters(), default 10)
+    };
+
+    /**
+     * @brief Frame flags
+     */
+    enum FrameFlags : uint8_t {
+        FRAME_FLAG_SPLIT = FrameAssembler::FLAG_SPLIT,  ///< No delimiter within the maximum length: continues in the next frame
+        FRAME_FLAG_LOSS = FrameAssembler::FLAG_LOSS     ///< RX data was lost before this frame (FIFO overflow or frame ring full)
+    };
+
+    /**
+     * @brief A received frame, valid until releaseFrame()
+     */
+    struct Frame {
+        const uint8_t* data = nullptr;      ///< Frame bytes without the delimiter
+        size_t length = 0;
+        uint32_t timestamp = 0;             ///< millis() when the frame was complete
+        uint32_t timestampUs = 0;           ///< esp_timer_get_time() when the frame was complete
+        uint8_t flags = 0;
+        void* item = nullptr;               ///< Ring item, returned by releaseFrame()
+    };
+
+    /**
+     * @brief Frame receiver counters (since startFrames())
+     */
+    struct FrameStatistics {
+        uint32_t frames;            ///< Frames put into the ring
+        uint32_t splitFrames;       ///< Frames cut at the maximum length
+        uint32_t droppedFrames;     ///< Frames discarded because the ring was full
+        uint32_t droppedBytes;
+        uint32_t rxOverflows;       ///< Hardware FIFO overflows
+    };
+
+    static const size_t FRAME_RING_SIZE = 512 * 1024;      // PSRAM: ~3.5 s at 1.5 Mbps
+    static const size_t FRAME_RING_FALLBACK = 16 * 1024;   // Internal RAM without PSRAM
+    static const size_t MAX_FRAME_LENGTH = 1024;           // Longer frames are split (at most half the RX buffer)
+    static const uint8_t IDLE_DEFAULT_CHARACTERS = 10;     // Driver default RX timeout
+    static const uint8_t IDLE_MAX_CHARACTERS = 64;
+    static const uint16_t TX_BUFFER_SIZE = 4096;           // Driver TX ring: bursts are queued, not waited on
+    static const size_t TX_COMBINE_SIZE = UARTTxCombiner::SIZE;  // writeCombined() staging buffer
+
     /**
      * @brief Constructor
      */
@@ -45,7 +116,7 @@ public:
      * @param stopBits Stop bits (UART_STOP_BITS_1, UART_STOP_BITS_1_5, UART_STOP_BITS_2)
      * @param parity Parity mode (UART_PARITY_DISABLE, UART_PARITY_EVEN, UART_PARITY_ODD)
      * @param dataBits Data bits (UART_DATA_5_BITS to UART_DATA_8_BITS)
-     * @param txBufferSize TX buffer size in bytes (default: 1024)
+     * @param txBufferSize TX buffer size in bytes (default: TX_BUFFER_SIZE)
      * @param rxBufferSize RX buffer size in bytes (default: 2048)
      * @return true if initialization successful
      */
@@ -53,7 +124,7 @@ public:
                uart_stop_bits_t stopBits = UART_STOP_BITS_1,
                uart_parity_t parity = UART_PARITY_DISABLE,
                uart_word_length_t dataBits = UART_DATA_8_BITS,
-               uint16_t txBufferSize = 1024,
+               uint16_t txBufferSize = TX_BUFFER_SIZE,
                uint16_t rxBufferSize = 2048);
 
     /**
@@ -76,32 +147,90 @@ public:
 
     /**
      * @brief Write data to UART2
+     *
+     * Returns once the data is in the driver's TX ring (blocks only while
+     * the ring is full). Use a TX fence to learn when it has been sent.
      * @param data Pointer to data buffer
      * @param len Number of bytes to write
-     * @param timeoutMs Timeout in milliseconds (0 = non-blocking)
+     * @param timeoutMs 0: do not wait; > 0: also wait up to this long until sent
      * @return Number of bytes actually written, -1 on error
      */
-    int write(const uint8_t* data, size_t len, uint32_t timeoutMs = 100);
+    int write(const uint8_t* data, size_t len, uint32_t timeoutMs = 0);
 
     /**
      * @brief Write string to UART2
      * @param str String to write
-     * @param timeoutMs Timeout in milliseconds
+     * @param timeoutMs 0: do not wait; > 0: also wait up to this long until sent
      * @return Number of bytes written, -1 on error
      */
-    int write(const char* str, uint32_t timeoutMs = 100);
+    int write(const char* str, uint32_t timeoutMs = 0);
+
+    /**
+     * @brief Collect small writes and hand them to the driver as one block
+     *
+     * Bytes go into a TX_COMBINE_SIZE staging buffer that is sent when it
+     * fills, on flushCombined(), or ahead of the next write() or fence
+     * wait, so the stream keeps its order. Each driver write costs a ring
+     * buffer item and a lock, which dominates for writes of a few bytes.
+     * @return Number of bytes accepted, -1 on error
+     */
+    int writeCombined(const uint8_t* data, size_t len) { return txCombiner.writeCombined(data, len); }
+
+    /**
+     * @brief Send bytes staged by writeCombined()
+     */
+    void flushCombined() { txCombiner.flush(); }
+
+    /**
+     * @brief TX stream position after everything written so far
+     *
+     * write() returns once the data is in the driver's TX ring; pass the
+     * fence to isTxFenceDone() / waitTxFence() to learn when it has left
+     * the UART.
+     */
+    uint32_t getTxFence() const { return txCombiner.getFence(); }
+
+    /**
+     * @brief Whether everything up to a fence has been sent (does not block or flush)
+     */
+    bool isTxFenceDone(uint32_t fence) { return txCombiner.isFenceDone(fence); }
+
+    /**
+     * @brief Wait until everything up to a fence has been sent
+     * @return false on timeout
+     */
+    bool waitTxFence(uint32_t fence, uint32_t timeoutMs) { return txCombiner.waitFence(fence, timeoutMs); }
 
     /**
      * @brief Read data from UART2
      * @param buffer Buffer to store received data
      * @param maxLen Maximum bytes to read
      * @param timeoutMs Timeout in milliseconds (0 = return immediately)
-     * @return Number of bytes actually read, -1 on error
+     * @return Number of bytes actually read, -1 on error or while the frame receiver runs
      */
     int read(uint8_t* buffer, size_t maxLen, uint32_t timeoutMs = 100);
 
+    /**
+     * @brief Receives every block written to or read from the UART driver
+     */
+    typedef void (*TrafficTap)(const uint8_t* data, size_t length, bool tx, void* arg);
+
+    /**
+     * @brief Hand every block written or read (including the frame receiver's) to a consumer
+     *
+     * Called from the writing or reading task right after the driver call,
+     * so it must be short.
+     */
+    void setTrafficTap(TrafficTap tap, void* arg);
+
     /**
      * @brief Read a line from UART2 (until \n or \r\n)
+     *
+     * Takes the next frame from the frame receiver, which is started in
+     * FRAME_LINE mode on first use. In other frame modes the next frame is
+     * returned without a newline. The rest of a frame longer than the
+     * buffer is discarded.
+     *
      * @param buffer Buffer to store line
      * @param maxLen Maximum buffer size
      * @param timeoutMs Timeout in milliseconds
@@ -157,6 +286,63 @@ public:
      */
     bool isInitialized() const { return initialized; }
 
+    /**
+     * @brief Get the UART driver's event queue (RX data/timeout, overflow, errors)
+     * @return nullptr if not initialized
+     */
+    QueueHandle_t getEventQueue() const { return eventQueue; }
+
+    // ========================================================================
+    // Frame Receiver
+    // ========================================================================
+
+    /**
+     * @brief Start the frame receiver (clears the RX buffer)
+     * @param mode FRAME_LINE, FRAME_DELIMITER or FRAME_IDLE
+     * @param delimiter Delimiter byte for FRAME_DELIMITER
+     * @return false if not initialized, the ring cannot be allocated or the task cannot start
+     */
+    bool startFrames(FrameMode mode, uint8_t delimiter = '\n');
+
+    /**
+     * @brief Stop the frame receiver (frames already in the ring stay readable)
+     */
+    void stopFrames();
+
+    /**
+     * @brief RX idle gap that ends a FRAME_IDLE frame
+     * @param characters Gap in character times (1-IDLE_MAX_CHARACTERS), takes effect immediately
+     * @return false if not initialized or out of range
+     */
+    bool setIdleCharacters(uint8_t characters);
+    uint8_t getIdleCharacters() const { return idleCharacters; }
+
+    FrameMode getFrameMode() const { return frameMode; }
+    uint8_t getFrameDelimiter() const { return frameAssembler.getDelimiter(); }
+    static const char* getFrameModeName(FrameMode mode);
+
+    /**
+     * @brief Take the next frame from the ring
+     * @param frame Filled in; must be passed to releaseFrame()
+     * @param timeoutMs Timeout in milliseconds (0 = return immediately)
+     * @return false on timeout
+     */
+    bool receiveFrame(Frame& frame, uint32_t timeoutMs);
+
+    /**
+     * @brief Give a frame's ring space back
+     */
+    void releaseFrame(Frame& frame);
+
+    FrameStatistics getFrameStatistics() const;
+
+    /**
+     * @brief Frame ring size and usage in bytes (0 before the first start)
+     */
+    size_t getFrameRingSize() const { return frameRingSize; }
+    size_t getFrameRingUsed() const;
+    bool isFrameRingInPSRAM() const { return frameRingInPSRAM; }
+
     /**
      * @brief Get UART statistics
      * @param txBytes Pointer to store total TX bytes (optional)
@@ -173,19 +359,80 @@ public:
 private:
     bool initialized = false;
     uart_port_t uartNum = UART_NUM_UART2;
+    static const int EVENT_QUEUE_SIZE = 32;
+    QueueHandle_t eventQueue = nullptr;
 
     // Current configuration
     uint32_t currentBaudRate = 115200;
     uart_stop_bits_t currentStopBits = UART_STOP_BITS_1;
     uart_parity_t currentParity = UART_PARITY_DISABLE;
     uart_word_length_t currentDataBits = UART_DATA_8_BITS;
-    uint16_t txBufSize = 1024;
+    uint16_t txBufSize = TX_BUFFER_SIZE;
     uint16_t rxBufSize = 2048;
 
     // Statistics
     uint32_t totalTxBytes = 0;
     uint32_t totalRxBytes = 0;
     uint32_t errorCount = 0;
+    volatile TrafficTap trafficTap = nullptr;
+    void* volatile trafficTapArg = nullptr;
+
+    // Asynchronous TX: write() queues into the driver ring; fences count queued bytes
+    UARTTxCombiner txCombiner{*this, uartNum};
+
+    // Frame receiver
+    struct FrameHeader {
+        uint32_t timestamp;
+        uint32_t timestampUs;
+        uint16_t length;
+        uint8_t flags;
+        uint8_t reserved;
+    };
+    static const int PATTERN_QUEUE_SIZE = 64;
+
+    // FrameAssembler's ends: the driver RX buffer and the frame ring
+    class DriverInput : public FrameAssembler::Input {
+    public:
+        explicit DriverInput(UART2Manager& owner) : owner(owner) {}
+        size_t buffered() override;
+        int delimiterPosition() override;
+        void popDelimiter() override;
+        size_t read(uint8_t* buffer, size_t length) override;
+    private:
+        UART2Manager& owner;
+    };
+
+    class RingOutput : public FrameAssembler::Output {
+    public:
+        explicit RingOutput(UART2Manager& owner) : owner(owner) {}
+        uint8_t* acquire(size_t length) override;
+        void complete(uint8_t* data, size_t length, uint8_t flags) override;
+    private:
+        UART2Manager& owner;
+    };
+
+    volatile FrameMode frameMode = FRAME_OFF;
+    FrameAssembler frameAssembler;
+    DriverInput frameInput{*this};
+    RingOutput frameOutput{*this};
+    uint8_t idleCharacters = IDLE_DEFAULT_CHARACTERS;
+    TaskHandle_t frameTaskHandle = nullptr;
+    volatile bool frameStopRequested = false;
+    RingbufHandle_t frameRing = nullptr;
+    StaticRingbuffer_t frameRingStruct;
+    uint8_t* frameRingStorage = nullptr;        // Kept once allocated
+    size_t frameRingSize = 0;
+    bool frameRingInPSRAM = false;
+    size_t frameSplitLength = MAX_FRAME_LENGTH;
+    uint32_t rxOverflows = 0;                   // Since startFrames()
+
+    bool allocateFrameRing();
+    void collectFrames(bool idle);
+    void tapTraffic(const uint8_t* data, size_t length, bool tx);
+    bool isTxOpen() override { return initialized; }
+    int queueTx(const uint8_t* data, size_t len) override;
+    void frameLoop();
+    static void frameTask(void* arg);
 
     // Validation helpers
     bool isValidBaudRate(uint32_t baudRate);
@@ -0,0 +1,518 @@
+#include "UARTBert.h"
+#include "UART1Mux.h"
+#include "UART2Manager.h"
+#include "PeripheralPins.h"
+#include "esp_heap_caps.h"
+
+static const uint32_t RX_POLL_MS = 20;
+static const uint32_t RX_TAIL_MS = 100;        // Keep reading after the last byte was sent
+static const uint32_t TX_CHUNK_MS = 20;        // TX chunk length in line time (stop latency)
+static const size_t MIN_TX_CHUNK = 16;
+static const uint32_t STOP_TIMEOUT_MS = 3000;
+
+UARTBert::UARTBert(UART1Mux& uart1, UART2Manager& uart2) : uart1(uart1), uart2(uart2) {
+}
+
+const char* UARTBert::getStateName() const {
+    switch (state) {
+        case STATE_IDLE:    return "IDLE";
+        case STATE_RUNNING: return "RUNNING";
+        case STATE_DONE:    return "DONE";
+        case STATE_ABORTED: return "ABORTED";
+        case STATE_FAILED:  return "FAILED";
+        default:            return "UNKNOWN";
+    }
+}
+
+const char* UARTBert::getPortName(Port port) {
+    switch (port) {
+        case PORT_UART1: return "UART1";
+        case PORT_UART2: return "UART2";
+        default:         return "UNKNOWN";
+    }
+}
+
+const char* UARTBert::getPatternName(Pattern pattern) {
+    switch (pattern) {
+        case PRBS_7:  return "PRBS7";
+        case PRBS_15: return "PRBS15";
+        case PRBS_31: return "PRBS31";
+        default:      return "UNKNOWN";
+    }
+}
+
+UARTBert::Result UARTBert::getResult() const {
+    Result copy = result;
+    copy.elapsedMs = (state == STATE_RUNNING ? millis() : endTime) - startTime;
+    return copy;
+}
+
+// ============================================================================
+// PRBS
+// ============================================================================
+
+bool UARTBert::allocateTable() {
+    if (table) {
+        return true;
+    }
+    table = static_cast<uint8_t*>(heap_caps_malloc((1u << 15) - 1, MALLOC_CAP_8BIT));
+    tableIndex = static_cast<uint16_t*>(heap_caps_malloc((1u << 15) * sizeof(uint16_t), MALLOC_CAP_8BIT));
+    if (!table || !tableIndex) {
+        Serial.println("[BERT] Table allocation failed");
+        heap_caps_free(table);
+        heap_caps_free(tableIndex);
+        table = nullptr;
+        tableIndex = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void UARTBert::buildTable() {
+    // One period of bits is 2^N - 1; packed into bytes it repeats after 2^N - 1 bytes
+    uint8_t order = pattern;
+    uint32_t length = (1u << order) - 1;
+    uint32_t history = length;          // Last N bits, oldest in bit 0; any non-zero seed
+
+    for (uint32_t i = 0; i < length; i++) {
+        uint8_t byte = 0;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            // b[n] = b[n-N] ^ b[n-N+1] for x^N + x^(N-1) + 1
+            uint32_t next = (history ^ (history >> 1)) & 1;
+            history = (history >> 1) | (next << (order - 1));
+            byte |= next << bit;
+        }
+        table[i] = byte;
+    }
+
+    // 8 and 2^N - 1 are coprime, so the bytes start at every bit phase of
+    // the period once: each non-zero N-bit window heads exactly one byte
+    uint32_t mask = length;
+    memset(tableIndex, 0xFF, (length + 1) * sizeof(uint16_t));
+    for (uint32_t i = 0; i < length; i++) {
+        uint32_t window = (table[i] | (table[(i + 1) % length] << 8)) & mask;
+        tableIndex[window] = i;
+    }
+}
+
+void UARTBert::Sequence::fill(uint8_t* out, size_t count) {
+    if (pattern == PRBS_31) {
+        // b[n] = b[n-31] ^ b[n-28]: 8 new bits only depend on bits already in the register
+        for (size_t i = 0; i < count; i++) {
+            uint8_t byte = (reg ^ (reg >> 3)) & 0xFF;
+            reg = (reg >> 8) | ((uint32_t)byte << 23);
+            out[i] = byte;
+        }
+        return;
+    }
+
+    while (count > 0) {
+        size_t n = length - position;
+        if (n > count) {
+            n = count;
+        }
+        memcpy(out, table + position, n);
+        out += n;
+        count -= n;
+        position = (position + n) % length;
+    }
+}
+
+bool UARTBert::Sequence::sync(const uint8_t* received) {
+    if (pattern == PRBS_31) {
+        uint32_t word = received[0] | (received[1] << 8) | (received[2] << 16) | ((uint32_t)received[3] << 24);
+        reg = word >> 1;            // The 31 newest bits
+        return reg != 0;
+    }
+
+    // The first N bits name the only place in the period they can start;
+    // the rest of the 4 bytes must follow from there
+    uint32_t window = (received[0] | (received[1] << 8)) & length;
+    uint32_t start = index[window];
+    if (start >= length) {
+        return false;               // All-zero window
+    }
+    for (uint8_t k = 0; k < 4; k++) {
+        if (table[(start + k) % length] != received[k]) {
+            return false;
+        }
+    }
+    position = (start + 4) % length;
+    return true;
+}
+
+// ============================================================================
+// Port Access
+// ============================================================================
+
+bool UARTBert::setBaudRate(uint32_t baud) {
+    if (port == PORT_UART1) {
+        return uart1.reconfigureUART(baud, uart1.getUARTStopBits(), uart1.getUARTParity(), uart1.getUARTDataBits());
+    }
+    return uart2.reconfigure(baud, uart2.getStopBits(), uart2.getParity(), uart2.getDataBits());
+}
+
+void UARTBert::setLoopback(bool enable) {
+    uart_set_loop_back(port == PORT_UART1 ? UART_NUM_UART1 : UART_NUM_UART2, enable);
+}
+
+int UARTBert::writeChunk(const uint8_t* data, size_t length) {
+    // No TX-done wait: blocking on a full TX ring paces the task at line rate
+    return port == PORT_UART1 ? uart1.write(data, length, 0) : uart2.write(data, length, 0);
+}
+
+int UARTBert::readChunk(uint8_t* buffer, size_t maxLength, uint32_t timeoutMs) {
+    return port == PORT_UART1 ? uart1.read(buffer, maxLength, timeoutMs) : uart2.read(buffer, maxLength, timeoutMs);
+}
+
+// ============================================================================
+// Test Control
+// ============================================================================
+
+bool UARTBert::start(Port newPort, uint32_t newBaudRate, uint32_t newSeconds, Pattern newPattern,
+                     bool newInternalLoopback) {
+    if (isRunning() || txTaskHandle || rxTaskHandle) {
+        return false;
+    }
+    if (newSeconds == 0 || newSeconds > MAX_SECONDS || newBaudRate < 2400 || newBaudRate > 1500000) {
+        return false;
+    }
+    if (newPattern != PRBS_7 && newPattern != PRBS_15 && newPattern != PRBS_31) {
+        return false;
+    }
+
+    uart_stop_bits_t stopBits;
+    uart_parity_t parity;
+    if (newPort == PORT_UART1) {
+        if (uart1.getMode() != UART1Mux::MODE_UART || uart1.getUARTDataBits() != UART_DATA_8_BITS) {
+            return false;
+        }
+        events = uart1.getUARTEventQueue();
+        savedBaudRate = uart1.getUARTBaudRate();
+        stopBits = uart1.getUARTStopBits();
+        parity = uart1.getUARTParity();
+    } else if (newPort == PORT_UART2) {
+        // The frame receiver owns UART2 RX while it runs
+        if (!uart2.isInitialized() || uart2.getFrameMode() != UART2Manager::FRAME_OFF ||
+            uart2.getDataBits() != UART_DATA_8_BITS) {
+            return false;
+        }
+        events = uart2.getEventQueue();
+        savedBaudRate = uart2.getBaudRate();
+        stopBits = uart2.getStopBits();
+        parity = uart2.getParity();
+    } else {
+        return false;
+    }
+    if (!events) {
+        return false;
+    }
+
+    port = newPort;
+    baudRate = newBaudRate;
+    seconds = newSeconds;
+    pattern = newPattern;
+    internalLoopback = newInternalLoopback;
+
+    if (pattern != PRBS_31) {
+        if (!allocateTable()) {
+            return false;
+        }
+        buildTable();
+    }
+
+    if (!setBaudRate(baudRate)) {
+        return false;
+    }
+    bitsPerChar = 1 + 8 + (parity != UART_PARITY_DISABLE ? 1 : 0) +
+                  (stopBits == UART_STOP_BITS_2 ? 2.0f : stopBits == UART_STOP_BITS_1_5 ? 1.5f : 1.0f);
+    setLoopback(internalLoopback);
+
+    // Start from an empty receiver
+    if (port == PORT_UART1) {
+        uart1.clearRxBuffer();
+    } else {
+        uart2.clearRxBuffer();
+    }
+    xQueueReset(events);
+
+    txSequence = {};
+    txSequence.pattern = pattern;
+    txSequence.table = table;
+    txSequence.index = tableIndex;
+    txSequence.length = (1u << pattern) - 1;
+    txSequence.reg = 0x7FFFFFFF;
+    rxSequence = txSequence;
+
+    result = {};
+    syncCount = 0;
+    windowBits = 0;
+    windowErrors = 0;
+    windowLongest = 0;
+    bitIndex = 0;
+    inBurst = false;
+    message = "";
+    stopRequested = false;
+    txDone = false;
+    startTime = millis();
+    endTime = startTime;
+    state = STATE_RUNNING;
+
+    BaseType_t ok = xTaskCreatePinnedToCore(
+        rxTask,
+        "BERT_RX",
+        6144,
+        this,
+        3,                  // Same as the RPM loop: the RX ring must not overflow
+        &rxTaskHandle,
+        1);
+    if (ok == pdPASS) {
+        ok = xTaskCreatePinnedToCore(
+            txTask,
+            "BERT_TX",
+            4096,
+            this,
+            2,              // Below RX; blocks on the TX ring most of the time
+            &txTaskHandle,
+            1);
+        if (ok != pdPASS) {
+            txTaskHandle = nullptr;
+            stopRequested = true;   // The RX task cleans up
+            message = "TX task creation failed";
+            return false;
+        }
+    } else {
+        rxTaskHandle = nullptr;
+        setLoopback(false);
+        setBaudRate(savedBaudRate);
+        state = STATE_FAILED;
+        message = "RX task creation failed";
+        return false;
+    }
+
+    Serial.printf("[BERT] %s: %u baud, %u s, %s%s\n", getPortName(port), baudRate, seconds,
+                  getPatternName(pattern), internalLoopback ? ", internal loopback" : "");
+    return true;
+}
+
+void UARTBert::stop() {
+    if (isRunning()) {
+        message = "stopped";
+        stopRequested = true;
+    }
+}
+
+// ============================================================================
+// Tasks
+// ============================================================================
+
+void UARTBert::txTask(void* arg) {
+    UARTBert* self = static_cast<UARTBert*>(arg);
+    self->txLoop();
+    self->txTaskHandle = nullptr;
+    vTaskDelete(NULL);
+}
+
+void UARTBert::rxTask(void* arg) {
+    UARTBert* self = static_cast<UARTBert*>(arg);
+    self->rxLoop();
+    self->rxTaskHandle = nullptr;
+    vTaskDelete(NULL);
+}
+
+void UARTBert::txLoop() {
+    uint8_t buffer[CHUNK_SIZE];
+
+    // About TX_CHUNK_MS of line time per write, so a stop is seen quickly at low baud rates
+    size_t chunk = baudRate / 10 * TX_CHUNK_MS / 1000;
+    if (chunk > CHUNK_SIZE) {
+        chunk = CHUNK_SIZE;
+    } else if (chunk < MIN_TX_CHUNK) {
+        chunk = MIN_TX_CHUNK;
+    }
+
+    uint32_t durationMs = seconds * 1000;
+    while (!stopRequested && millis() - startTime < durationMs) {
+        txSequence.fill(buffer, chunk);
+        int written = writeChunk(buffer, chunk);
+        if (written < 0) {
+            break;  // Port gone; the RX task reports it
+        }
+        result.txBytes += written;
+    }
+
+    // The tail is still in the TX ring / FIFO
+    uart_wait_tx_done(port == PORT_UART1 ? UART_NUM_UART1 : UART_NUM_UART2, pdMS_TO_TICKS(1000));
+    txDone = true;
+}
+
+void UARTBert::rxLoop() {
+    uint8_t buffer[CHUNK_SIZE];
+    unsigned long tailStart = 0;
+    bool aborted = false;
+
+    while (true) {
+        if (stopRequested) {
+            aborted = true;
+            break;
+        }
+
+        int length = readChunk(buffer, CHUNK_SIZE, RX_POLL_MS);
+        if (length < 0) {
+            message = port == PORT_UART1 ? "UART1 left UART mode" : "UART2 RX not available";
+            aborted = true;
+            break;
+        }
+        if (length > 0) {
+            result.rxBytes += length;
+            check(buffer, length);
+        }
+        drainEvents();
+
+        if (txDone) {
+            if (tailStart == 0) {
+                tailStart = millis();
+            } else if (length == 0 && millis() - tailStart >= RX_TAIL_MS) {
+                break;
+            }
+        }
+    }
+
+    // Let the TX task finish before the port is reconfigured
+    stopRequested = true;
+    unsigned long stopStart = millis();
+    while (txTaskHandle && millis() - stopStart < STOP_TIMEOUT_MS) {
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+
+    if (windowBits > 0) {
+        closeWindow();
+    }
+    setLoopback(false);
+    setBaudRate(savedBaudRate);
+
+    endTime = millis();
+    state = aborted ? STATE_ABORTED : STATE_DONE;
+    Serial.printf("[BERT] %s: %llu bits checked, %llu errors\n", getStateName(),
+                  (unsigned long long)result.checkedBits, (unsigned long long)result.bitErrors);
+}
+
+void UARTBert::drainEvents() {
+    uart_event_t event;
+    while (xQueueReceive(events, &event, 0) == pdTRUE) {
+        switch (event.type) {
+            case UART_FRAME_ERR:
+                result.frameErrors++;
+                break;
+            case UART_PARITY_ERR:
+                result.parityErrors++;
+                break;
+            case UART_FIFO_OVF:
+                result.fifoOverflows++;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+// ============================================================================
+// Checker (RX task)
+// ============================================================================
+
+void UARTBert::check(const uint8_t* data, size_t length) {
+    uint8_t expected[CHUNK_SIZE];
+    bool searched = false;
+
+    while (length > 0) {
+        if (!result.synced) {
+            // Slide a 4-byte window over the stream until it matches the pattern
+            syncBuffer[syncCount++] = *data++;
+            length--;
+            if (syncCount < 4) {
+                continue;
+            }
+            if (rxSequence.sync(syncBuffer)) {
+                result.synced = true;
+                syncCount = 0;
+            } else {
+                memmove(syncBuffer, syncBuffer + 1, 3);
+                syncCount = 3;
+                searched = true;
+            }
+            continue;
+        }
+
+        size_t n = length < CHUNK_SIZE ? length : CHUNK_SIZE;
+        rxSequence.fill(expected, n);
+        compare(data, expected, n);
+        data += n;
+        length -= n;
+
+        if (windowBits >= SYNC_WINDOW_BITS) {
+            closeWindow();
+        }
+    }
+
+    // A stream that never syncs (wrong pattern, noise) must not hold the CPU
+    if (searched) {
+        taskYIELD();
+    }
+}
+
+void UARTBert::compare(const uint8_t* data, const uint8_t* expected, size_t length) {
+    for (size_t i = 0; i < length; ) {
+        // 32 bits at a time; the tail byte by byte. Bit k of the word is wire bit k.
+        uint32_t received;
+        uint32_t wanted;
+        size_t step = length - i >= 4 ? 4 : 1;
+        if (step == 4) {
+            memcpy(&received, data + i, 4);
+            memcpy(&wanted, expected + i, 4);
+        } else {
+            received = data[i];
+            wanted = expected[i];
+        }
+
+        uint32_t diff = received ^ wanted;
+        if (diff) {
+            uint64_t base = bitIndex + i * 8;
+            uint64_t first = base + __builtin_ctz(diff);
+            uint64_t last = base + 31 - __builtin_clz(diff);
+            windowErrors += __builtin_popcount(diff);
+
+            if (!inBurst || first - lastErrorBit > BURST_GAP_BITS) {
+                burstStart = first;
+                inBurst = true;
+            }
+            lastErrorBit = last;
+            uint32_t burst = last - burstStart + 1;
+            if (burst > windowLongest) {
+                windowLongest = burst;
+            }
+        }
+        i += step;
+    }
+
+    bitIndex += length * 8;
+    windowBits += length * 8;
+}
+
+void UARTBert::closeWindow() {
+    if (windowErrors * 4 > windowBits) {
+        // Slipped (bytes lost or inserted): these are not bit errors
+        result.syncLosses++;
+        result.synced = false;
+        syncCount = 0;
+        inBurst = false;
+    } else {
+        result.checkedBits += windowBits;
+        result.bitErrors += windowErrors;
+        if (windowLongest > result.longestBurstBits) {
+            result.longestBurstBits = windowLongest;
+        }
+    }
+    windowBits = 0;
+    windowErrors = 0;
+    windowLongest = 0;
+}
@@ -0,0 +1,200 @@
+#ifndef UART_BERT_H
+#define UART_BERT_H
+
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+class UART1Mux;
+class UART2Manager;
+
+/**
+ * @brief Bit-error-rate and throughput test for UART1 / UART2
+ *
+ * Sends a PRBS-7, PRBS-15 or PRBS-31 stream at the test baud rate and
+ * checks whatever comes back on RX: the same UART through its internal
+ * loopback, a TX→RX jumper or cable, or a remote peer sending the same
+ * pattern. The checker synchronizes on the received stream (any phase),
+ * so the peer does not need to start at the same time.
+ *
+ * - PRBS-7 / PRBS-15 come from a table holding one full period (127 /
+ *   32767 bytes), built at start; sending is a copy from the table.
+ *   PRBS-31 (period 2^31-1) is generated a byte per register step.
+ * - Synchronizing is a lookup, not a search: every N-bit window occurs
+ *   once per period, so an index built with the table maps the first N
+ *   received bits to their table position; PRBS-31 loads its register
+ *   from the received bits.
+ * - Received data is compared 32 bits at a time against the expected
+ *   stream; errors are counted with popcount.
+ * - When more than a quarter of the bits in a window are wrong, the
+ *   checker declares loss of sync (dropped or inserted bytes), discards
+ *   the window and synchronizes again.
+ * - An error burst is a run of errored bits without BURST_GAP_BITS
+ *   error-free bits in between; the longest one is reported in bits.
+ *
+ * A TX task keeps the driver's TX ring full (it blocks while the ring is
+ * full, so it paces itself at line rate) and an RX task reads in bulk and
+ * checks; both block between chunks and leave the CPU to other tasks.
+ * The port's baud rate (and loopback) is restored when the test ends.
+ *
+ * Usage:
+ *   UARTBert bert(uart1, uart2);
+ *   bert.start(UARTBert::PORT_UART2, 1500000, 10, UARTBert::PRBS_15, true);
+ *   // ... later, when !bert.isRunning()
+ *   UARTBert::Result result = bert.getResult();
+ */
+class UARTBert {
+public:
+    enum Port : uint8_t {
+        PORT_UART1 = 1,
+        PORT_UART2 = 2
+    };
+
+    enum Pattern : uint8_t {
+        PRBS_7 = 7,             ///< x^7 + x^6 + 1
+        PRBS_15 = 15,           ///< x^15 + x^14 + 1
+        PRBS_31 = 31            ///< x^31 + x^28 + 1
+    };
+
+    enum State : uint8_t {
+        STATE_IDLE = 0,
+        STATE_RUNNING,
+        STATE_DONE,
+        STATE_ABORTED,          ///< Stopped by command or the port went away
+        STATE_FAILED
+    };
+
+    struct Result {
+        uint64_t txBytes;
+        uint64_t rxBytes;
+        uint64_t checkedBits;       ///< Bits compared while in sync
+        uint64_t bitErrors;
+        uint32_t frameErrors;
+        uint32_t parityErrors;
+        uint32_t fifoOverflows;     ///< RX FIFO overflows (bytes lost)
+        uint32_t syncLosses;
+        uint32_t longestBurstBits;
+        uint32_t elapsedMs;
+        bool synced;                ///< Checker currently in sync
+    };
+
+    static const uint32_t MAX_SECONDS = 3600;
+    static const size_t CHUNK_SIZE = 512;
+    static const uint32_t BURST_GAP_BITS = 64;
+    static const uint32_t SYNC_WINDOW_BITS = 4096;
+
+    UARTBert(UART1Mux& uart1, UART2Manager& uart2);
+
+    /**
+     * @brief Start a test in the background
+     * @param internalLoopback Loop TX to RX inside the UART (no wiring)
+     * @return false if a test is running, the port is not available
+     *         (UART1 not in UART mode, UART2 not initialized or its RX owned
+     *         by the frame receiver), it is not set to 8 data bits, the
+     *         baud rate or duration is out of range or the tasks cannot start
+     */
+    bool start(Port port, uint32_t baudRate, uint32_t seconds, Pattern pattern, bool internalLoopback);
+
+    /**
+     * @brief Stop the running test (returns immediately, keeps the counts)
+     */
+    void stop();
+
+    bool isRunning() const { return state == STATE_RUNNING; }
+    State getState() const { return state; }
+    const char* getStateName() const;
+    const char* getMessage() const { return message; }
+
+    Port getPort() const { return port; }
+    uint32_t getBaudRate() const { return baudRate; }
+    uint32_t getSeconds() const { return seconds; }
+    Pattern getPattern() const { return pattern; }
+    bool isInternalLoopback() const { return internalLoopback; }
+    static const char* getPortName(Port port);
+    static const char* getPatternName(Pattern pattern);
+
+    /**
+     * @brief Counts so far (while running) or of the last test
+     */
+    Result getResult() const;
+
+    /**
+     * @brief Bits on the wire per character (start + data + parity + stop)
+     */
+    float getBitsPerChar() const { return bitsPerChar; }
+
+private:
+    /**
+     * @brief PRBS byte stream (LSB first, as the UART sends it)
+     */
+    struct Sequence {
+        Pattern pattern;
+        const uint8_t* table;       // PRBS-7 / PRBS-15: one period
+        const uint16_t* index;      // First N bits of a byte → its table position
+        uint32_t length;
+        uint32_t position;
+        uint32_t reg;               // PRBS-31: last 31 bits, oldest in bit 0
+
+        void fill(uint8_t* out, size_t count);
+        bool sync(const uint8_t* received);     // 4 bytes; continues after them
+    };
+
+    UART1Mux& uart1;
+    UART2Manager& uart2;
+    TaskHandle_t txTaskHandle = nullptr;
+    TaskHandle_t rxTaskHandle = nullptr;
+    QueueHandle_t events = nullptr;
+
+    // Test parameters
+    Port port = PORT_UART2;
+    uint32_t baudRate = 0;
+    uint32_t seconds = 0;
+    Pattern pattern = PRBS_15;
+    bool internalLoopback = false;
+    uint32_t savedBaudRate = 0;
+    float bitsPerChar = 10.0f;
+
+    volatile State state = STATE_IDLE;
+    volatile bool stopRequested = false;
+    volatile bool txDone = false;
+    const char* message = "";
+    unsigned long startTime = 0;
+    unsigned long endTime = 0;
+
+    // Table and its sync index for PRBS-7 / PRBS-15 (kept once allocated)
+    uint8_t* table = nullptr;
+    uint16_t* tableIndex = nullptr;
+
+    Sequence txSequence = {};
+    Sequence rxSequence = {};
+    Result result = {};
+
+    // Checker state (RX task)
+    uint8_t syncBuffer[4];
+    uint8_t syncCount = 0;
+    uint64_t windowBits = 0;
+    uint64_t windowErrors = 0;
+    uint32_t windowLongest = 0;
+    uint64_t bitIndex = 0;          // Checked bits including the open window
+    uint64_t burstStart = 0;
+    uint64_t lastErrorBit = 0;
+    bool inBurst = false;
+
+    bool allocateTable();
+    void buildTable();
+    bool setBaudRate(uint32_t baud);
+    void setLoopback(bool enable);
+    int writeChunk(const uint8_t* data, size_t length);
+    int readChunk(uint8_t* buffer, size_t maxLength, uint32_t timeoutMs);
+    void check(const uint8_t* data, size_t length);
+    void compare(const uint8_t* data, const uint8_t* expected, size_t length);
+    void closeWindow();
+    void drainEvents();
+    void txLoop();
+    void rxLoop();
+    static void txTask(void* arg);
+    static void rxTask(void* arg);
+};
+
+#endif // UART_BERT_H
@@ -0,0 +1,256 @@
+#include "UARTBridge.h"
+#include "UART1Mux.h"
+#include "UART2Manager.h"
+#include "soc/soc_caps.h"
+
+static const uint32_t ESCAPE_POLL_MS = 50;         // Console task wakeup without host data
+static const uint32_t RX_POLL_MS = 20;             // Drain even if driver events were dropped
+static const uint32_t RX_STOP_TIMEOUT_MS = 500;
+
+// CDC event handlers get the USBCDC instance as argument, not ours
+static UARTBridge* bridgeInstance = nullptr;
+
+UARTBridge::UARTBridge(USBCDC& host) : host(host) {
+}
+
+void UARTBridge::begin() {
+    bridgeInstance = this;
+    host.onEvent(ARDUINO_USB_CDC_RX_EVENT, onHostEvent);
+}
+
+const char* UARTBridge::getPortName(Port port) {
+    switch (port) {
+        case PORT_UART1: return "UART1";
+        case PORT_UART2: return "UART2";
+        default:         return "UNKNOWN";
+    }
+}
+
+UARTBridge::Statistics UARTBridge::getStatistics() const {
+    Statistics copy = stats;
+    if (active) {
+        copy.durationMs = millis() - startTime;
+    }
+    return copy;
+}
+
+// ============================================================================
+// Session
+// ============================================================================
+
+bool UARTBridge::run(Port newPort, UART1Mux& newUart1, UART2Manager& newUart2) {
+    if (active) {
+        return false;
+    }
+
+    QueueHandle_t queue = nullptr;
+    if (newPort == PORT_UART1) {
+        if (newUart1.getMode() == UART1Mux::MODE_UART) {
+            queue = newUart1.getUARTEventQueue();
+        }
+    } else if (newPort == PORT_UART2) {
+        // The frame receiver owns the event queue and the RX data
+        if (newUart2.isInitialized() && newUart2.getFrameMode() == UART2Manager::FRAME_OFF) {
+            queue = newUart2.getEventQueue();
+        }
+    }
+    if (!queue) {
+        return false;
+    }
+
+    port = newPort;
+    uart1 = &newUart1;
+    uart2 = &newUart2;
+    events = queue;
+    stats = {};
+    escapeHeld = 0;
+    stopRx = false;
+    portLost = false;
+    endReason = "";
+    startTime = millis();
+    lastHostByte = startTime;       // The guard time before "+++" starts now
+
+    // Events from before the session describe data nobody asked for
+    xQueueReset(events);
+
+    consoleTask = xTaskGetCurrentTaskHandle();
+    BaseType_t ok = xTaskCreatePinnedToCore(
+        rxTaskEntry,
+        "Bridge_RX",
+        4096,
+        this,
+        BRIDGE_PRIORITY,
+        &rxTask,
+        1);
+    if (ok != pdPASS) {
+        rxTask = nullptr;
+        consoleTask = nullptr;
+        return false;
+    }
+
+    // Host → UART runs here; keep up with the RX side while bridged
+    UBaseType_t savedPriority = uxTaskPriorityGet(NULL);
+    vTaskPrioritySet(NULL, BRIDGE_PRIORITY);
+    active = true;
+
+    static uint8_t buffer[CHUNK_SIZE];
+    while (true) {
+        // Woken by CDC RX events; the timeout only serves the escape guard time
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ESCAPE_POLL_MS));
+        unsigned long now = millis();
+
+        size_t length;
+        while (!portLost && (length = host.read(buffer, CHUNK_SIZE)) > 0) {
+            forwardHost(buffer, length, now);
+        }
+
+        if (portLost) {
+            endReason = port == PORT_UART1 ? "UART1 left UART mode" : "UART2 not available";
+            break;
+        }
+        if (escapeHeld > 0 && now - escapeTime >= ESCAPE_GUARD_MS) {
+            if (escapeHeld == ESCAPE_COUNT) {
+                endReason = "escape";
+                break;
+            }
+            flushEscape();  // Lone '+' characters: ordinary data
+        }
+    }
+
+    active = false;
+    stopRx = true;
+    unsigned long stopStart = millis();
+    while (rxTask && millis() - stopStart < RX_STOP_TIMEOUT_MS) {
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+    vTaskPrioritySet(NULL, savedPriority);
+    consoleTask = nullptr;
+    stats.durationMs = millis() - startTime;
+    return true;
+}
+
+void UARTBridge::onHostEvent(void* /*arg*/, esp_event_base_t /*base*/, int32_t /*id*/, void* /*data*/) {
+    UARTBridge* self = bridgeInstance;
+    if (self && self->active && self->consoleTask) {
+        xTaskNotifyGive(self->consoleTask);
+    }
+}
+
+// ============================================================================
+// Host → UART (console task)
+// ============================================================================
+
+void UARTBridge::forwardHost(const uint8_t* data, size_t len, unsigned long now) {
+    // Bytes of one read arrived back to back, so only the first can follow
+    // a guard time; once broken, the sequence cannot restart in this chunk
+    size_t runStart = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (escapeHeld > 0) {
+            if (data[i] == ESCAPE_CHAR && escapeHeld < ESCAPE_COUNT) {
+                escapeHeld++;
+                escapeTime = now;
+                runStart = i + 1;
+                continue;
+            }
+            flushEscape();
+            runStart = i;
+            break;
+        }
+        if (i == 0 && data[i] == ESCAPE_CHAR && now - lastHostByte >= ESCAPE_GUARD_MS) {
+            escapeHeld = 1;
+            escapeTime = now;
+            runStart = 1;
+            continue;
+        }
+        break;
+    }
+    lastHostByte = now;
+
+    if (runStart < len) {
+        writeUART(data + runStart, len - runStart);
+    }
+}
+
+void UARTBridge::flushEscape() {
+    uint8_t held[ESCAPE_COUNT];
+    memset(held, ESCAPE_CHAR, sizeof(held));
+    writeUART(held, escapeHeld);
+    escapeHeld = 0;
+}
+
+int UARTBridge::writeUART(const uint8_t* data, size_t len) {
+    if (len == 0) {
+        return 0;
+    }
+    // No TX-done wait: the driver's ring buffer carries the data, and a
+    // full ring blocks here (the host is NAKed meanwhile)
+    int written = port == PORT_UART1 ? uart1->write(data, len, 0) : uart2->write(data, len, 0);
+    if (written < 0) {
+        portLost = true;
+        return -1;
+    }
+    stats.hostToUart += written;
+    return written;
+}
+
+// ============================================================================
+// UART → Host (bridge task)
+// ============================================================================
+
+void UARTBridge::rxTaskEntry(void* arg) {
+    UARTBridge* self = static_cast<UARTBridge*>(arg);
+    self->rxLoop();
+    self->rxTask = nullptr;
+    vTaskDelete(NULL);
+}
+
+void UARTBridge::rxLoop() {
+    uint8_t buffer[CHUNK_SIZE];
+
+    while (!stopRx) {
+        uart_event_t event;
+        if (xQueueReceive(events, &event, pdMS_TO_TICKS(RX_POLL_MS)) == pdTRUE) {
+            switch (event.type) {
+                case UART_FIFO_OVF:
+                    // The driver resets the FIFO: its contents are gone
+                    stats.rxOverflows++;
+                    stats.rxDroppedBytes += SOC_UART_FIFO_LEN;
+                    break;
+                case UART_PARITY_ERR:
+                case UART_FRAME_ERR:
+                    stats.lineErrors++;
+                    break;
+                case UART_BREAK:
+                    stats.breaks++;
+                    break;
+                default:
+                    break;  // UART_DATA / UART_BUFFER_FULL: drained below
+            }
+        }
+        drainUART(buffer);
+    }
+}
+
+void UARTBridge::drainUART(uint8_t* buffer) {
+    while (!stopRx) {
+        int length = readUART(buffer, CHUNK_SIZE);
+        if (length < 0) {
+            portLost = true;
+            xTaskNotifyGive(consoleTask);   // End the session now
+            return;
+        }
+        if (length == 0) {
+            return;
+        }
+        size_t sent = host.write(buffer, length);
+        stats.uartToHost += sent;
+        if (sent < (size_t)length) {
+            stats.hostDroppedBytes += length - sent;  // Host stopped reading
+        }
+    }
+}
+
+int UARTBridge::readUART(uint8_t* buffer, size_t maxLen) {
+    // Zero timeout: take what the ring buffer holds
+    return port == PORT_UART1 ? uart1->read(buffer, maxLen, 0) : uart2->read(buffer, maxLen, 0);
+}
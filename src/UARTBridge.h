@@ -0,0 +1,129 @@
+#ifndef UART_BRIDGE_H
+#define UART_BRIDGE_H
+
+#include <Arduino.h>
+#include "USBCDC.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+class UART1Mux;
+class UART2Manager;
+
+/**
+ * @brief Transparent USB-CDC ↔ UART bridge
+ *
+ * Turns the CDC console into a plain USB-serial adapter for UART1 (in
+ * UART mode) or UART2 until the host sends the escape sequence.
+ *
+ * Both directions move data in blocks, never a byte per wakeup:
+ * - UART → host: a bridge task blocks on the UART driver's event queue.
+ *   The driver posts an event per RX FIFO threshold or RX timeout
+ *   interrupt; the task then copies everything in the driver's ring
+ *   buffer to the CDC endpoint.
+ * - Host → UART: the CDC RX event notifies the calling (console) task,
+ *   which copies whole USB packets into the UART TX ring buffer. A full
+ *   TX ring blocks the copy, which NAKs the host (USB flow control).
+ *
+ * run() blocks the console task for the whole session, so nothing else
+ * prints to the CDC port while bytes are bridged (console output is
+ * serialized by the same task/mutex).
+ *
+ * Escape: ESCAPE_COUNT × ESCAPE_CHAR with at least ESCAPE_GUARD_MS of
+ * silence from the host before and after ("+++" as on a modem). Held
+ * back '+' characters are forwarded if the sequence does not complete.
+ *
+ * Usage:
+ *   UARTBridge bridge(USBSerial);
+ *   bridge.begin();
+ *   bridge.run(UARTBridge::PORT_UART2, uart1, uart2);   // returns on "+++"
+ *   UARTBridge::Statistics stats = bridge.getStatistics();
+ */
+class UARTBridge {
+public:
+    enum Port : uint8_t {
+        PORT_UART1 = 1,
+        PORT_UART2 = 2
+    };
+
+    /**
+     * @brief Counters of the current / last session
+     */
+    struct Statistics {
+        uint64_t hostToUart;        ///< Bytes written to the UART
+        uint64_t uartToHost;        ///< Bytes written to the host
+        uint32_t rxOverflows;       ///< UART RX FIFO overflows
+        uint32_t rxDroppedBytes;    ///< Lower bound of RX bytes lost (a FIFO per overflow)
+        uint32_t hostDroppedBytes;  ///< UART bytes the host did not accept within the CDC timeout
+        uint32_t lineErrors;        ///< Parity / framing errors
+        uint32_t breaks;            ///< Break conditions on RX
+        uint32_t durationMs;
+    };
+
+    static const char ESCAPE_CHAR = '+';
+    static const uint8_t ESCAPE_COUNT = 3;
+    static const uint32_t ESCAPE_GUARD_MS = 1000;
+    static const size_t CHUNK_SIZE = 1024;
+    static const uint8_t BRIDGE_PRIORITY = 3;          // Above the console / WiFi tasks
+
+    explicit UARTBridge(USBCDC& host);
+
+    /**
+     * @brief Register for CDC RX events (call after USBSerial.begin())
+     */
+    void begin();
+
+    /**
+     * @brief Bridge the port until the escape sequence or the port goes away
+     *
+     * Runs in the calling task, which must be the one owning the CDC
+     * console. UART1 must be in UART mode, UART2 initialized without the
+     * frame receiver running.
+     *
+     * @return false if the port is not available or the bridge task cannot start
+     */
+    bool run(Port port, UART1Mux& uart1, UART2Manager& uart2);
+
+    bool isActive() const { return active; }
+    Port getPort() const { return port; }
+    static const char* getPortName(Port port);
+
+    /**
+     * @brief Why the last session ended ("escape", "UART1 left UART mode", ...)
+     */
+    const char* getEndReason() const { return endReason; }
+
+    Statistics getStatistics() const;
+
+private:
+    USBCDC& host;
+    TaskHandle_t consoleTask = nullptr;     // Notified by CDC RX events while active
+    TaskHandle_t rxTask = nullptr;
+    QueueHandle_t events = nullptr;
+    UART1Mux* uart1 = nullptr;
+    UART2Manager* uart2 = nullptr;
+    volatile bool active = false;
+    volatile bool stopRx = false;
+    volatile bool portLost = false;
+    Port port = PORT_UART2;
+    const char* endReason = "";
+    unsigned long startTime = 0;
+
+    Statistics stats = {};
+
+    // Escape detection (host → UART direction)
+    uint8_t escapeHeld = 0;                 // '+' characters held back
+    unsigned long lastHostByte = 0;
+    unsigned long escapeTime = 0;           // Last held '+'
+
+    int readUART(uint8_t* buffer, size_t maxLen);
+    int writeUART(const uint8_t* data, size_t len);
+    void forwardHost(const uint8_t* data, size_t len, unsigned long now);
+    void flushEscape();
+    void drainUART(uint8_t* buffer);
+    void rxLoop();
+    static void rxTaskEntry(void* arg);
+    static void onHostEvent(void* arg, esp_event_base_t base, int32_t id, void* data);
+};
+
+#endif // UART_BRIDGE_H
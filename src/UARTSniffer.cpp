@@ -0,0 +1,393 @@
+#include "UARTSniffer.h"
+#include "UART1Mux.h"
+#include "UART2Manager.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+
+static const uint32_t LOCK_TIMEOUT_MS = 2;      // Tap side: drop the block rather than stall the UART task
+static const uint32_t STOP_TIMEOUT_MS = 1000;
+static const size_t MONITOR_CHUNK = 256;
+
+static const uint16_t BINARY_VERSION = 1;
+static const size_t BINARY_HEADER_SIZE = 16;
+static const size_t BINARY_RECORD_HEADER = 12;
+static const size_t PCAP_HEADER_SIZE = 24;
+static const size_t PCAP_RECORD_HEADER = 16 + 1;   // Packet header + flags byte
+static const uint32_t PCAP_LINKTYPE_USER0 = 147;
+
+static void putU16(uint8_t* out, uint16_t value) {
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+}
+
+static void putU32(uint8_t* out, uint32_t value) {
+    for (uint8_t i = 0; i < 4; i++) {
+        out[i] = (value >> (8 * i)) & 0xFF;
+    }
+}
+
+static void putU64(uint8_t* out, uint64_t value) {
+    putU32(out, (uint32_t)value);
+    putU32(out + 4, (uint32_t)(value >> 32));
+}
+
+UARTSniffer::UARTSniffer(UART1Mux& uart1, UART2Manager& uart2) : uart1(uart1), uart2(uart2) {
+}
+
+const char* UARTSniffer::getPortsName(uint8_t ports) {
+    switch (ports) {
+        case PORT_UART1: return "UART1";
+        case PORT_UART2: return "UART2";
+        case PORT_BOTH:  return "ALL";
+        default:         return "NONE";
+    }
+}
+
+uint32_t UARTSniffer::getElapsedMs() const {
+    if (startTime == 0) {
+        return 0;
+    }
+    return (running ? millis() : endTime) - startTime;
+}
+
+bool UARTSniffer::allocate() {
+    if (buffer) {
+        return true;
+    }
+
+    if (!lock) {
+        lock = xSemaphoreCreateMutex();
+        if (!lock) {
+            return false;
+        }
+    }
+
+    buffer = static_cast<uint8_t*>(heap_caps_malloc(CAPTURE_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+    if (buffer) {
+        capacity = CAPTURE_SIZE;
+        inPSRAM = true;
+    } else {
+        buffer = static_cast<uint8_t*>(heap_caps_malloc(FALLBACK_SIZE, MALLOC_CAP_8BIT));
+        if (!buffer) {
+            Serial.println("[SNIFF] Ring allocation failed");
+            return false;
+        }
+        capacity = FALLBACK_SIZE;
+        inPSRAM = false;
+        Serial.println("[SNIFF] No PSRAM, using a 16 KB ring in internal RAM");
+    }
+    return true;
+}
+
+// ============================================================================
+// Control
+// ============================================================================
+
+bool UARTSniffer::start(uint8_t selectedPorts, bool monitorRx) {
+    if (running || (selectedPorts & PORT_BOTH) == 0) {
+        return false;
+    }
+    if (!allocate()) {
+        return false;
+    }
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    head = 0;
+    tail = 0;
+    generation++;
+    stats = {};
+    xSemaphoreGive(lock);
+
+    ports = selectedPorts & PORT_BOTH;
+    monitor = monitorRx;
+    startUs = esp_timer_get_time();
+    startTime = millis();
+    endTime = startTime;
+    stopRequested = false;
+    running = true;
+
+    if (ports & PORT_UART1) {
+        uart1.setTrafficTap(tapUART1, this);
+    }
+    if (ports & PORT_UART2) {
+        uart2.setTrafficTap(tapUART2, this);
+    }
+
+    if (monitor) {
+        BaseType_t ok = xTaskCreatePinnedToCore(monitorTask, "UART_Sniffer", 4096, this, 2, &taskHandle, 1);
+        if (ok != pdPASS) {
+            taskHandle = nullptr;
+            stop();
+            return false;
+        }
+    }
+
+    Serial.printf("[SNIFF] Started on %s%s, %u KB ring\n", getPortsName(ports),
+                  monitor ? " (monitor)" : "", (unsigned)(capacity / 1024));
+    return true;
+}
+
+void UARTSniffer::stop() {
+    if (!running) {
+        return;
+    }
+
+    if (taskHandle) {
+        stopRequested = true;
+        unsigned long start = millis();
+        while (taskHandle && millis() - start < STOP_TIMEOUT_MS) {
+            vTaskDelay(pdMS_TO_TICKS(5));
+        }
+    }
+
+    if (ports & PORT_UART1) {
+        uart1.setTrafficTap(nullptr, nullptr);
+    }
+    if (ports & PORT_UART2) {
+        uart2.setTrafficTap(nullptr, nullptr);
+    }
+
+    // A tap already inside record() finishes under the lock
+    xSemaphoreTake(lock, portMAX_DELAY);
+    running = false;
+    endTime = millis();
+    xSemaphoreGive(lock);
+
+    Serial.printf("[SNIFF] Stopped, %u records\n", (unsigned)stats.records);
+}
+
+// ============================================================================
+// Ring
+// ============================================================================
+
+void UARTSniffer::copyIn(uint64_t position, const void* data, size_t length) {
+    size_t offset = (size_t)(position % capacity);
+    size_t first = capacity - offset;
+    if (first > length) {
+        first = length;
+    }
+    memcpy(buffer + offset, data, first);
+    memcpy(buffer, static_cast<const uint8_t*>(data) + first, length - first);
+}
+
+void UARTSniffer::copyOut(uint64_t position, void* data, size_t length) const {
+    size_t offset = (size_t)(position % capacity);
+    size_t first = capacity - offset;
+    if (first > length) {
+        first = length;
+    }
+    memcpy(data, buffer + offset, first);
+    memcpy(static_cast<uint8_t*>(data) + first, buffer, length - first);
+}
+
+void UARTSniffer::record(uint8_t port, const uint8_t* data, size_t length, bool tx) {
+    int64_t now = esp_timer_get_time();
+
+    if (xSemaphoreTake(lock, pdMS_TO_TICKS(LOCK_TIMEOUT_MS)) != pdTRUE) {
+        stats.lockMisses++;
+        return;
+    }
+    if (!running) {
+        xSemaphoreGive(lock);
+        return;
+    }
+
+    if (tx) {
+        stats.txBytes[port - 1] += length;
+    } else {
+        stats.rxBytes[port - 1] += length;
+    }
+
+    while (length > 0) {
+        size_t part = length > MAX_RECORD_DATA ? MAX_RECORD_DATA : length;
+        size_t size = storedSize(part);
+
+        // Evict whole records from the oldest end
+        while (head + size - tail > capacity) {
+            StoredHeader old;
+            copyOut(tail, &old, sizeof(old));
+            tail += storedSize(old.length);
+            stats.overwritten++;
+        }
+
+        StoredHeader header;
+        header.timeLow = (uint32_t)now;
+        header.timeHigh = (uint32_t)((uint64_t)now >> 32);
+        header.length = part;
+        header.flags = port | (tx ? FLAG_TX : 0);
+        header.reserved = 0;
+        copyIn(head, &header, sizeof(header));
+        copyIn(head + sizeof(header), data, part);
+        head += size;
+        stats.records++;
+
+        data += part;
+        length -= part;
+    }
+
+    xSemaphoreGive(lock);
+}
+
+void UARTSniffer::tapUART1(const uint8_t* data, size_t length, bool tx, void* arg) {
+    static_cast<UARTSniffer*>(arg)->record(PORT_UART1, data, length, tx);
+}
+
+void UARTSniffer::tapUART2(const uint8_t* data, size_t length, bool tx, void* arg) {
+    static_cast<UARTSniffer*>(arg)->record(PORT_UART2, data, length, tx);
+}
+
+// ============================================================================
+// Reading
+// ============================================================================
+
+bool UARTSniffer::next(Cursor& cursor, Record& out, uint8_t* data, uint64_t limit) const {
+    if (!buffer || cursor.generation != generation) {
+        return false;
+    }
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (cursor.position < tail) {
+        cursor.position = tail;
+        cursor.lost = true;
+    }
+    if (limit > head) {
+        limit = head;
+    }
+    if (cursor.position >= limit) {
+        xSemaphoreGive(lock);
+        return false;
+    }
+
+    StoredHeader header;
+    copyOut(cursor.position, &header, sizeof(header));
+    copyOut(cursor.position + sizeof(header), data, header.length);
+    cursor.position += storedSize(header.length);
+    xSemaphoreGive(lock);
+
+    out.timeUs = ((uint64_t)header.timeHigh << 32) | header.timeLow;
+    out.length = header.length;
+    out.flags = header.flags;
+    if (cursor.lost) {
+        out.flags |= FLAG_LOSS;
+        cursor.lost = false;
+    }
+    return true;
+}
+
+size_t UARTSniffer::exportChunk(Format format, Cursor& cursor, uint8_t* out, size_t maxLen) const {
+    size_t written = 0;
+
+    if (cursor.stage == 0) {
+        if (maxLen < EXPORT_HEADER_MAX || !buffer) {
+            return 0;
+        }
+        xSemaphoreTake(lock, portMAX_DELAY);
+        cursor.generation = generation;
+        cursor.position = tail;
+        cursor.end = head;
+        cursor.lost = false;
+        xSemaphoreGive(lock);
+
+        if (format == FORMAT_PCAP) {
+            putU32(out, 0xa1b2c3d4);
+            putU16(out + 4, 2);
+            putU16(out + 6, 4);
+            putU32(out + 8, 0);                 // GMT offset
+            putU32(out + 12, 0);                // Accuracy
+            putU32(out + 16, 65535);            // Snap length
+            putU32(out + 20, PCAP_LINKTYPE_USER0);
+            written = PCAP_HEADER_SIZE;
+        } else {
+            memcpy(out, "USNF", 4);
+            putU16(out + 4, BINARY_VERSION);
+            putU16(out + 6, 0);
+            putU64(out + 8, startUs);
+            written = BINARY_HEADER_SIZE;
+        }
+        cursor.stage = 1;
+    }
+
+    size_t headerSize = format == FORMAT_PCAP ? PCAP_RECORD_HEADER : BINARY_RECORD_HEADER;
+    while (cursor.stage == 1 && maxLen - written >= headerSize + MAX_RECORD_DATA) {
+        Record record;
+        uint8_t* header = out + written;
+        if (!next(cursor, record, header + headerSize, cursor.end)) {
+            cursor.stage = 2;
+            break;
+        }
+
+        if (format == FORMAT_PCAP) {
+            putU32(header, (uint32_t)(record.timeUs / 1000000));
+            putU32(header + 4, (uint32_t)(record.timeUs % 1000000));
+            putU32(header + 8, record.length + 1);
+            putU32(header + 12, record.length + 1);
+            header[16] = record.flags;
+        } else {
+            putU64(header, record.timeUs);
+            putU16(header + 8, record.length);
+            header[10] = record.flags;
+            header[11] = 0;
+        }
+        written += headerSize + record.length;
+    }
+    return written;
+}
+
+bool UARTSniffer::isExportDone(const Cursor& cursor) const {
+    return cursor.stage == 2 || (cursor.stage == 1 && cursor.generation != generation);
+}
+
+void UARTSniffer::beginTail(Cursor& cursor) const {
+    if (lock) {
+        xSemaphoreTake(lock, portMAX_DELAY);
+    }
+    cursor.generation = generation;
+    cursor.position = head;
+    cursor.end = 0;
+    cursor.stage = 1;
+    cursor.lost = false;
+    if (lock) {
+        xSemaphoreGive(lock);
+    }
+}
+
+bool UARTSniffer::readNext(Cursor& cursor, Record& record, uint8_t* data) const {
+    return next(cursor, record, data, UINT64_MAX);
+}
+
+// ============================================================================
+// Monitor Task
+// ============================================================================
+
+void UARTSniffer::run() {
+    uint8_t chunk[MONITOR_CHUNK];
+
+    while (!stopRequested) {
+        bool idle = true;
+
+        // Only ports nobody else reads: the bridge, BERT, frame receiver and
+        // its users refuse to start on a monitored port or own RX themselves
+        if ((ports & PORT_UART1) && uart1.getMode() == UART1Mux::MODE_UART && uart1.available() > 0) {
+            if (uart1.read(chunk, sizeof(chunk), 0) > 0) {
+                idle = false;
+            }
+        }
+        if ((ports & PORT_UART2) && uart2.isInitialized() && uart2.getFrameMode() == UART2Manager::FRAME_OFF &&
+            uart2.available() > 0) {
+            if (uart2.read(chunk, sizeof(chunk), 0) > 0) {
+                idle = false;
+            }
+        }
+
+        if (idle) {
+            vTaskDelay(pdMS_TO_TICKS(1));
+        }
+    }
+}
+
+void UARTSniffer::monitorTask(void* arg) {
+    UARTSniffer* self = static_cast<UARTSniffer*>(arg);
+    self->run();
+    self->taskHandle = nullptr;
+    vTaskDelete(NULL);
+}
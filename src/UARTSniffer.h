@@ -0,0 +1,202 @@
+#ifndef UART_SNIFFER_H
+#define UART_SNIFFER_H
+
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+class UART1Mux;
+class UART2Manager;
+
+/**
+ * @brief Timestamped UART1 / UART2 traffic capture into a PSRAM ring
+ *
+ * Records what this device wrote to and read from the UARTs, with µs
+ * timestamps and direction, without taking part in the traffic. The
+ * managers hand every block passing the driver to a traffic tap (their
+ * write() / read() and the UART2 frame receiver), so one record holds a
+ * whole block and nothing is done per byte. TX is timestamped when it is
+ * queued to the driver, RX when it leaves the driver buffer.
+ *
+ * RX only passes the driver when someone reads it (console, frame
+ * receiver, Modbus, packet link, bridge, BERT). MONITOR mode adds a
+ * sniffer task that reads a port itself while nothing else does.
+ *
+ * The ring (allocated on first start and kept) overwrites the oldest
+ * records. Records are read out through a cursor while the capture keeps
+ * running; a cursor overtaken by the writer continues at the oldest
+ * record and marks the gap.
+ *
+ * Export formats:
+ * - FORMAT_BINARY: "USNF" header, then per record
+ *   [time_us:8][length:2][flags:1][0:1][data], little-endian.
+ * - FORMAT_PCAP: pcap, link type USER0 (147), µs timestamps since boot,
+ *   each packet prefixed with the flags byte.
+ * Flags: bits 0-1 port (1 = UART1, 2 = UART2), FLAG_TX, FLAG_LOSS.
+ *
+ * Usage:
+ *   UARTSniffer sniffer(uart1, uart2);
+ *   sniffer.start(UARTSniffer::PORT_UART2, false);
+ *   UARTSniffer::Cursor cursor;
+ *   while ((n = sniffer.exportChunk(UARTSniffer::FORMAT_PCAP, cursor, buf, sizeof(buf))) > 0) { ... }
+ */
+class UARTSniffer {
+public:
+    enum Port : uint8_t {
+        PORT_UART1 = 0x01,
+        PORT_UART2 = 0x02,
+        PORT_BOTH = 0x03
+    };
+
+    enum RecordFlags : uint8_t {
+        FLAG_PORT_MASK = 0x03,
+        FLAG_TX = 0x04,             ///< Written by this device (else received)
+        FLAG_LOSS = 0x08            ///< Records before this one were overwritten before they were read
+    };
+
+    enum Format : uint8_t {
+        FORMAT_BINARY = 0,
+        FORMAT_PCAP
+    };
+
+    struct Record {
+        uint64_t timeUs;            ///< esp_timer_get_time()
+        uint16_t length;
+        uint8_t flags;
+    };
+
+    /**
+     * @brief Read position in the ring (export or live tail)
+     */
+    struct Cursor {
+        uint64_t position = 0;      ///< Absolute ring position of the next record
+        uint64_t end = 0;           ///< Export: ring head when the export began
+        uint16_t generation = 0;    ///< Capture being read
+        uint8_t stage = 0;          ///< Header, records, done
+        bool lost = false;          ///< Overtaken by the writer since the last record
+    };
+
+    struct Statistics {
+        uint32_t records;
+        uint64_t rxBytes[2];        ///< Per port (UART1, UART2)
+        uint64_t txBytes[2];
+        uint32_t overwritten;       ///< Oldest records dropped to make room
+        uint32_t lockMisses;        ///< Blocks not recorded because the ring stayed locked
+    };
+
+    static const size_t CAPTURE_SIZE = 2 * 1024 * 1024;    // PSRAM
+    static const size_t FALLBACK_SIZE = 16 * 1024;          // Internal RAM without PSRAM
+    static const size_t MAX_RECORD_DATA = 256;              // Longer blocks are split
+    static const size_t EXPORT_HEADER_MAX = 24;             // exportChunk() needs this much for the file header
+    static const size_t EXPORT_RECORD_MAX = 16 + 1 + MAX_RECORD_DATA;
+
+    UARTSniffer(UART1Mux& uart1, UART2Manager& uart2);
+
+    /**
+     * @brief Start a capture (clears the ring)
+     * @param ports PORT_UART1, PORT_UART2 or PORT_BOTH
+     * @param monitor Also read RX of ports nobody else reads
+     * @return false if already running, no port is given or the ring cannot be allocated
+     */
+    bool start(uint8_t ports, bool monitor);
+
+    /**
+     * @brief Stop recording (the ring stays readable)
+     */
+    void stop();
+
+    bool isRunning() const { return running; }
+    uint8_t getPorts() const { return ports; }
+    bool isMonitor() const { return monitor; }
+    static const char* getPortsName(uint8_t ports);
+
+    /**
+     * @brief Push new records to WebSocket clients (see WebServerManager)
+     */
+    void setLiveTail(bool enabled) { liveTail = enabled; }
+    bool isLiveTail() const { return liveTail; }
+
+    size_t getCapacity() const { return capacity; }
+    bool isInPSRAM() const { return inPSRAM; }
+    size_t getUsed() const { return (size_t)(head - tail); }
+    uint32_t getElapsedMs() const;
+    Statistics getStatistics() const { return stats; }
+    bool hasData() const { return head != tail; }
+    uint16_t getGeneration() const { return generation; }
+
+    // ========================================================================
+    // Reading
+    // ========================================================================
+
+    /**
+     * @brief Write the next part of a download
+     *
+     * Covers the records present when the export began. Writes whole
+     * records only: the header needs EXPORT_HEADER_MAX bytes, a record at
+     * most EXPORT_RECORD_MAX.
+     *
+     * @return Bytes written; 0 when the export is complete or maxLen is too
+     *         small for the next record
+     */
+    size_t exportChunk(Format format, Cursor& cursor, uint8_t* out, size_t maxLen) const;
+    bool isExportDone(const Cursor& cursor) const;
+
+    /**
+     * @brief Position a cursor at the newest end (live tail)
+     */
+    void beginTail(Cursor& cursor) const;
+
+    /**
+     * @brief Take the next record written since the cursor (live tail)
+     * @param data At least MAX_RECORD_DATA bytes
+     * @return false if there is none (yet)
+     */
+    bool readNext(Cursor& cursor, Record& record, uint8_t* data) const;
+
+private:
+    // Stored before each record's data, which follows padded to 4 bytes
+    struct StoredHeader {
+        uint32_t timeLow;
+        uint32_t timeHigh;
+        uint16_t length;
+        uint8_t flags;
+        uint8_t reserved;
+    };
+
+    UART1Mux& uart1;
+    UART2Manager& uart2;
+    SemaphoreHandle_t lock = nullptr;
+    TaskHandle_t taskHandle = nullptr;
+    volatile bool running = false;
+    volatile bool stopRequested = false;
+    volatile bool liveTail = false;
+    uint8_t ports = 0;
+    bool monitor = false;
+    unsigned long startTime = 0;
+    unsigned long endTime = 0;
+    uint64_t startUs = 0;
+
+    // Ring (kept once allocated); positions are absolute byte counts
+    uint8_t* buffer = nullptr;
+    size_t capacity = 0;
+    bool inPSRAM = false;
+    uint64_t head = 0;
+    uint64_t tail = 0;
+    uint16_t generation = 0;
+
+    Statistics stats = {};
+
+    bool allocate();
+    static size_t storedSize(size_t length) { return (sizeof(StoredHeader) + length + 3) & ~(size_t)3; }
+    void copyIn(uint64_t position, const void* data, size_t length);
+    void copyOut(uint64_t position, void* data, size_t length) const;
+    void record(uint8_t port, const uint8_t* data, size_t length, bool tx);
+    bool next(Cursor& cursor, Record& record, uint8_t* data, uint64_t limit) const;
+    void run();
+    static void monitorTask(void* arg);
+    static void tapUART1(const uint8_t* data, size_t length, bool tx, void* arg);
+    static void tapUART2(const uint8_t* data, size_t length, bool tx, void* arg);
+};
+
+#endif // UART_SNIFFER_H
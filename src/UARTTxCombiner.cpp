@@ -0,0 +1,121 @@
+#include "UARTTxCombiner.h"
+#include <string.h>
+
+UARTTxCombiner::UARTTxCombiner(Port& port, uart_port_t uartNum)
+    : port(port), uartNum(uartNum) {
+    lock = xSemaphoreCreateMutex();
+}
+
+UARTTxCombiner::~UARTTxCombiner() {
+    vSemaphoreDelete(lock);
+}
+
+// ============================================================================
+// Writing (under the lock)
+// ============================================================================
+
+int UARTTxCombiner::write(const uint8_t* data, size_t len) {
+    if (data == nullptr || len == 0) {
+        return -1;
+    }
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    sendStaged();       // Staged bytes go first
+    int written = port.isTxOpen() ? queue(data, len) : -1;
+    xSemaphoreGive(lock);
+    return written;
+}
+
+int UARTTxCombiner::writeCombined(const uint8_t* data, size_t len) {
+    if (data == nullptr || len == 0) {
+        return -1;
+    }
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    int accepted = len;
+    if (!port.isTxOpen()) {
+        accepted = -1;
+    } else {
+        if (stagedLength + len > SIZE) {
+            sendStaged();
+        }
+        if (len >= SIZE) {
+            accepted = queue(data, len);        // Already a block of its own
+        } else {
+            memcpy(staged + stagedLength, data, len);
+            stagedLength += len;
+            if (stagedLength == SIZE) {
+                sendStaged();
+            }
+        }
+    }
+    xSemaphoreGive(lock);
+    return accepted;
+}
+
+void UARTTxCombiner::flush() {
+    if (stagedLength == 0) {
+        return;
+    }
+    xSemaphoreTake(lock, portMAX_DELAY);
+    sendStaged();
+    xSemaphoreGive(lock);
+}
+
+int UARTTxCombiner::queue(const uint8_t* data, size_t len) {
+    int written = port.queueTx(data, len);
+    if (written > 0) {
+        queued += written;
+    }
+    return written;
+}
+
+void UARTTxCombiner::sendStaged() {
+    // Staged bytes are dropped if the port went away meanwhile
+    if (stagedLength > 0 && port.isTxOpen()) {
+        queue(staged, stagedLength);
+    }
+    stagedLength = 0;
+}
+
+// ============================================================================
+// Fences
+// ============================================================================
+
+bool UARTTxCombiner::isFenceDone(uint32_t fence) {
+    if ((int32_t)(completed - fence) >= 0) {
+        return true;
+    }
+    if (!port.isTxOpen()) {
+        return true;    // Nothing more will leave this port
+    }
+
+    // Queued count first: if the UART is idle after it, everything up to it is out
+    uint32_t queuedNow = queued;
+    if ((int32_t)(queuedNow - fence) < 0) {
+        return false;           // Still staged (or not written yet)
+    }
+    return uart_wait_tx_done(uartNum, 0) == ESP_OK;
+}
+
+bool UARTTxCombiner::waitFence(uint32_t fence, uint32_t timeoutMs) {
+    if ((int32_t)(completed - fence) >= 0) {
+        return true;
+    }
+    if (!port.isTxOpen()) {
+        return true;    // Nothing more will leave this port
+    }
+    if ((int32_t)(queued - fence) < 0) {
+        flush();
+    }
+
+    // The driver only reports "TX idle": everything queued before the wait is out
+    uint32_t queuedNow = queued;
+    if (uart_wait_tx_done(uartNum, pdMS_TO_TICKS(timeoutMs)) != ESP_OK) {
+        return false;
+    }
+    if ((int32_t)(queuedNow - completed) > 0) {
+        completed = queuedNow;
+    }
+    return (int32_t)(queuedNow - fence) >= 0;
+}
@@ -0,0 +1,97 @@
+#ifndef UART_TX_COMBINER_H
+#define UART_TX_COMBINER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "driver/uart.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+/**
+ * @brief Asynchronous TX for a UART driver: write combining and TX fences
+ *
+ * Shared by UART1Mux and UART2Manager. Writes go into the driver's TX
+ * ring and return; a fence (the stream position after a write) tells when
+ * the bytes have left the UART.
+ *
+ * - writeCombined() collects small writes in a SIZE-byte staging buffer
+ *   that goes to the driver as one block when it fills, on flush(), or
+ *   ahead of the next write() or fence wait, so the stream keeps its
+ *   order. Each driver write costs a ring buffer item and a lock, which
+ *   dominates for writes of a few bytes.
+ * - The staging buffer and the queued count only change under the lock.
+ * - The driver only reports "TX idle", so a fence is done once the UART
+ *   went idle after everything up to it was queued.
+ *
+ * The owner provides the driver write (with its statistics and traffic
+ * tap) through Port.
+ */
+class UARTTxCombiner {
+public:
+    static const size_t SIZE = 128;
+
+    /**
+     * @brief The owning port
+     */
+    class Port {
+    public:
+        virtual ~Port() {}
+        /** Whether the driver is installed and the port may send */
+        virtual bool isTxOpen() = 0;
+        /** Hand bytes to the driver's TX ring; bytes accepted, -1 on error */
+        virtual int queueTx(const uint8_t* data, size_t len) = 0;
+    };
+
+    UARTTxCombiner(Port& port, uart_port_t uartNum);
+    ~UARTTxCombiner();
+
+    /**
+     * @brief Send staged bytes, then data, as one step
+     * @return Number of bytes written, -1 on error
+     */
+    int write(const uint8_t* data, size_t len);
+
+    /**
+     * @brief Stage small writes and hand them to the driver as one block
+     * @return Number of bytes accepted, -1 on error
+     */
+    int writeCombined(const uint8_t* data, size_t len);
+
+    /**
+     * @brief Send staged bytes
+     */
+    void flush();
+
+    /**
+     * @brief TX stream position after everything written so far
+     */
+    uint32_t getFence() const { return queued + stagedLength; }
+
+    /**
+     * @brief Whether everything up to a fence has been sent
+     *
+     * A pure check: does not block, take the lock or flush staged bytes
+     * (a fence behind staged bytes stays open until they are flushed).
+     */
+    bool isFenceDone(uint32_t fence);
+
+    /**
+     * @brief Flush if the fence needs it and wait until it has been sent
+     * @return false on timeout
+     */
+    bool waitFence(uint32_t fence, uint32_t timeoutMs);
+
+private:
+    Port& port;
+    uart_port_t uartNum;
+    SemaphoreHandle_t lock;
+    uint8_t staged[SIZE];
+    volatile size_t stagedLength = 0;
+    volatile uint32_t queued = 0;
+    volatile uint32_t completed = 0;
+
+    int queue(const uint8_t* data, size_t len);
+    void sendStaged();
+};
+
+#endif // UART_TX_COMBINER_H
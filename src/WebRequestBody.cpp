@@ -0,0 +1,437 @@
+#include "WebRequestBody.h"
+#include <esp_heap_caps.h>
+
+namespace {
+
+const uint32_t ARENA_MAGIC = 0x42445941;  // "BDYA"
+
+struct BodyField {
+    const char* key;
+    const char* value;
+    WebRequestBody::FieldType type;
+};
+
+/**
+ * Header of the per-request arena. Body bytes follow the header in the
+ * same allocation so a single free() releases everything.
+ */
+struct BodyArena {
+    uint32_t magic;
+    size_t capacity;
+    size_t length;
+    bool tooLarge;
+    bool complete;
+    bool indexed;
+    bool malformed;
+    uint8_t fieldCount;
+    BodyField fields[WebRequestBody::MAX_FIELDS];
+
+    char* data() { return reinterpret_cast<char*>(this + 1); }
+};
+
+BodyArena* allocateArena(size_t capacity) {
+    size_t size = sizeof(BodyArena) + capacity + 1;
+    void* mem = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!mem) {
+        mem = heap_caps_malloc(size, MALLOC_CAP_8BIT);
+    }
+    if (!mem) {
+        return nullptr;
+    }
+
+    BodyArena* arena = static_cast<BodyArena*>(mem);
+    memset(arena, 0, sizeof(BodyArena));
+    arena->magic = ARENA_MAGIC;
+    arena->capacity = capacity;
+    arena->data()[0] = '\0';
+    return arena;
+}
+
+BodyArena* getArena(AsyncWebServerRequest* request) {
+    BodyArena* arena = static_cast<BodyArena*>(request->_tempObject);
+    if (!arena || arena->magic != ARENA_MAGIC) {
+        return nullptr;
+    }
+    return arena;
+}
+
+void indexJSON(BodyArena* arena) {
+    char* text = arena->data();
+    size_t i = 0;
+    while (i < arena->length && isspace((unsigned char)text[i])) {
+        i++;
+    }
+    if (i >= arena->length || text[i] != '{') {
+        return;  // Not a JSON object; leave raw body for getRaw()
+    }
+
+    JsonFieldReader reader(text, arena->length);
+    const char* key;
+    const char* value;
+    WebRequestBody::FieldType type;
+
+    while (reader.next(key, value, type)) {
+        if (arena->fieldCount >= WebRequestBody::MAX_FIELDS) {
+            arena->tooLarge = true;
+            break;
+        }
+        BodyField& field = arena->fields[arena->fieldCount++];
+        field.key = key;
+        field.value = value;
+        field.type = type;
+    }
+
+    arena->indexed = true;
+    arena->malformed = reader.failed();
+}
+
+const BodyField* findField(BodyArena* arena, const char* name) {
+    if (!arena || !arena->indexed) {
+        return nullptr;
+    }
+    for (uint8_t i = 0; i < arena->fieldCount; i++) {
+        if (strcmp(arena->fields[i].key, name) == 0) {
+            return &arena->fields[i];
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+// ============================================================================
+// WebRequestBody
+// ============================================================================
+
+void WebRequestBody::accumulate(AsyncWebServerRequest* request, uint8_t* data, size_t len,
+                                size_t index, size_t total, size_t limit) {
+    if (index == 0) {
+        if (request->_tempObject != nullptr) {
+            return;  // Already owned by another handler
+        }
+
+        // Oversized bodies get a header-only arena so the request handler can answer 413
+        bool tooLarge = total > limit;
+        BodyArena* arena = allocateArena(tooLarge ? 0 : total);
+        if (!arena) {
+            Serial.printf("[Web] Body arena allocation failed (%u bytes)\n", (unsigned)total);
+            return;
+        }
+        arena->tooLarge = tooLarge;
+        request->_tempObject = arena;
+    }
+
+    BodyArena* arena = getArena(request);
+    if (!arena || arena->tooLarge || arena->complete) {
+        return;
+    }
+
+    if (index + len > arena->capacity) {
+        arena->tooLarge = true;  // Sender lied about Content-Length
+        return;
+    }
+
+    memcpy(arena->data() + index, data, len);
+    if (index + len > arena->length) {
+        arena->length = index + len;
+    }
+
+    if (arena->length >= total) {
+        arena->data()[arena->length] = '\0';
+        arena->complete = true;
+        indexJSON(arena);
+    }
+}
+
+bool WebRequestBody::isTooLarge(AsyncWebServerRequest* request) {
+    BodyArena* arena = getArena(request);
+    return arena && arena->tooLarge;
+}
+
+bool WebRequestBody::isMalformed(AsyncWebServerRequest* request) {
+    BodyArena* arena = getArena(request);
+    return arena && arena->malformed;
+}
+
+bool WebRequestBody::hasParam(AsyncWebServerRequest* request, const char* name) {
+    if (request->hasParam(name, true)) {
+        return true;
+    }
+    return findField(getArena(request), name) != nullptr;
+}
+
+String WebRequestBody::getParam(AsyncWebServerRequest* request, const char* name) {
+    if (request->hasParam(name, true)) {
+        return request->getParam(name, true)->value();
+    }
+    const BodyField* field = findField(getArena(request), name);
+    return field ? String(field->value) : String();
+}
+
+size_t WebRequestBody::forEachField(AsyncWebServerRequest* request, FieldCallback callback) {
+    size_t count = 0;
+
+    int params = request->params();
+    for (int i = 0; i < params; i++) {
+        AsyncWebParameter* p = request->getParam(i);
+        if (p->isPost() && !p->isFile()) {
+            callback(p->name().c_str(), p->value().c_str(), FIELD_STRING);
+            count++;
+        }
+    }
+
+    BodyArena* arena = getArena(request);
+    if (arena && arena->indexed) {
+        for (uint8_t i = 0; i < arena->fieldCount; i++) {
+            callback(arena->fields[i].key, arena->fields[i].value, arena->fields[i].type);
+            count++;
+        }
+    }
+
+    return count;
+}
+
+const char* WebRequestBody::getRaw(AsyncWebServerRequest* request, size_t* length) {
+    BodyArena* arena = getArena(request);
+    if (!arena || !arena->complete || arena->indexed) {
+        return nullptr;
+    }
+    if (length) {
+        *length = arena->length;
+    }
+    return arena->data();
+}
+
+// ============================================================================
+// JsonFieldReader
+// ============================================================================
+
+JsonFieldReader::JsonFieldReader(char* buffer, size_t length)
+    : buf(buffer), len(length) {
+}
+
+char JsonFieldReader::peek() const {
+    if (pending) {
+        return pending;
+    }
+    return pos < len ? buf[pos] : '\0';
+}
+
+void JsonFieldReader::advance() {
+    pending = 0;
+    if (pos < len) {
+        pos++;
+    }
+}
+
+void JsonFieldReader::skipWhitespace() {
+    while (isspace((unsigned char)peek())) {
+        advance();
+    }
+}
+
+void JsonFieldReader::terminateAt(size_t end) {
+    // Remember the displaced delimiter so parsing can continue past it
+    pending = end < len ? buf[end] : 0;
+    if (end <= len) {
+        buf[end] = '\0';
+    }
+    pos = end;
+}
+
+bool JsonFieldReader::fail() {
+    error = true;
+    done = true;
+    return false;
+}
+
+bool JsonFieldReader::next(const char*& key, const char*& value, WebRequestBody::FieldType& type) {
+    if (done) {
+        return false;
+    }
+
+    skipWhitespace();
+    if (!started) {
+        if (peek() != '{') {
+            return fail();
+        }
+        advance();
+        started = true;
+        skipWhitespace();
+        if (peek() == '}') {
+            done = true;
+            return false;
+        }
+    } else {
+        if (peek() == '}') {
+            done = true;
+            return false;
+        }
+        if (peek() != ',') {
+            return fail();
+        }
+        advance();
+        skipWhitespace();
+    }
+
+    if (peek() != '"') {
+        return fail();
+    }
+    char* k = readString();
+    if (!k) {
+        return fail();
+    }
+
+    skipWhitespace();
+    if (peek() != ':') {
+        return fail();
+    }
+    advance();
+    skipWhitespace();
+
+    char* v;
+    char c = peek();
+    if (c == '"') {
+        v = readString();
+        type = WebRequestBody::FIELD_STRING;
+    } else if (c == '{' || c == '[') {
+        v = readNested(type);
+    } else {
+        v = readScalar(type);
+    }
+    if (!v) {
+        return fail();
+    }
+
+    key = k;
+    value = v;
+    return true;
+}
+
+char* JsonFieldReader::readString() {
+    advance();  // Opening quote
+    char* start = buf + pos;
+    size_t out = pos;
+
+    while (pos < len) {
+        char c = buf[pos];
+        if (c == '"') {
+            buf[out] = '\0';
+            pos++;
+            return start;
+        }
+        if ((unsigned char)c < 0x20) {
+            return nullptr;
+        }
+        if (c != '\\') {
+            buf[out++] = c;
+            pos++;
+            continue;
+        }
+
+        if (pos + 1 >= len) {
+            return nullptr;
+        }
+        char e = buf[pos + 1];
+        pos += 2;
+        switch (e) {
+            case '"':  buf[out++] = '"';  break;
+            case '\\': buf[out++] = '\\'; break;
+            case '/':  buf[out++] = '/';  break;
+            case 'b':  buf[out++] = '\b'; break;
+            case 'f':  buf[out++] = '\f'; break;
+            case 'n':  buf[out++] = '\n'; break;
+            case 'r':  buf[out++] = '\r'; break;
+            case 't':  buf[out++] = '\t'; break;
+            case 'u': {
+                if (pos + 4 > len) {
+                    return nullptr;
+                }
+                char hex[5] = { buf[pos], buf[pos + 1], buf[pos + 2], buf[pos + 3], '\0' };
+                char* endp;
+                uint32_t cp = strtoul(hex, &endp, 16);
+                if (endp != hex + 4) {
+                    return nullptr;
+                }
+                pos += 4;
+                // Encoded form is 6 bytes, UTF-8 needs at most 3, so writing in place is safe
+                if (cp < 0x80) {
+                    buf[out++] = (char)cp;
+                } else if (cp < 0x800) {
+                    buf[out++] = (char)(0xC0 | (cp >> 6));
+                    buf[out++] = (char)(0x80 | (cp & 0x3F));
+                } else if (cp >= 0xD800 && cp <= 0xDFFF) {
+                    buf[out++] = '?';  // Surrogate pairs not needed by any endpoint
+                } else {
+                    buf[out++] = (char)(0xE0 | (cp >> 12));
+                    buf[out++] = (char)(0x80 | ((cp >> 6) & 0x3F));
+                    buf[out++] = (char)(0x80 | (cp & 0x3F));
+                }
+                break;
+            }
+            default:
+                return nullptr;
+        }
+    }
+    return nullptr;  // Unterminated string
+}
+
+char* JsonFieldReader::readScalar(WebRequestBody::FieldType& type) {
+    size_t start = pos;
+    while (pos < len) {
+        char c = buf[pos];
+        if (c == ',' || c == '}' || c == ']' || isspace((unsigned char)c)) {
+            break;
+        }
+        pos++;
+    }
+    if (pos == start) {
+        return nullptr;
+    }
+    terminateAt(pos);
+
+    char* token = buf + start;
+    if (strcmp(token, "true") == 0 || strcmp(token, "false") == 0) {
+        type = WebRequestBody::FIELD_BOOL;
+    } else if (strcmp(token, "null") == 0) {
+        type = WebRequestBody::FIELD_NULL;
+    } else {
+        char* endp;
+        strtod(token, &endp);
+        if (*endp != '\0') {
+            return nullptr;
+        }
+        type = WebRequestBody::FIELD_NUMBER;
+    }
+    return token;
+}
+
+char* JsonFieldReader::readNested(WebRequestBody::FieldType& type) {
+    type = (peek() == '{') ? WebRequestBody::FIELD_OBJECT : WebRequestBody::FIELD_ARRAY;
+    size_t start = pos;
+    int depth = 0;
+    bool inString = false;
+
+    while (pos < len) {
+        char c = buf[pos++];
+        if (inString) {
+            if (c == '\\') {
+                pos++;
+            } else if (c == '"') {
+                inString = false;
+            }
+            continue;
+        }
+        if (c == '"') {
+            inString = true;
+        } else if (c == '{' || c == '[') {
+            depth++;
+        } else if (c == '}' || c == ']') {
+            if (--depth == 0) {
+                terminateAt(pos);
+                return buf + start;
+            }
+        }
+    }
+    return nullptr;  // Unbalanced brackets
+}
@@ -0,0 +1,139 @@
+#ifndef WEB_REQUEST_BODY_H
+#define WEB_REQUEST_BODY_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <functional>
+
+/**
+ * @brief Bounded POST body accumulator for ESPAsyncWebServer
+ *
+ * Every POST route registers the same body handler. The first chunk
+ * allocates one arena (PSRAM when available) sized to Content-Length,
+ * refusing anything above the route's limit, and later chunks are
+ * memcpy'd into it. Once the last chunk arrives a JSON object body is
+ * indexed in place by JsonFieldReader, so handlers can read fields the
+ * same way they read url-encoded form parameters.
+ *
+ * The arena lives in request->_tempObject. It is a single block from
+ * heap_caps_malloc(), which the request destructor releases with free(),
+ * so aborted uploads do not leak.
+ */
+namespace WebRequestBody {
+
+    static const size_t DEFAULT_LIMIT = 1024;   // Simple control endpoints
+    static const size_t CONFIG_LIMIT = 2048;    // Settings page JSON
+    static const size_t SEQUENCE_LIMIT = 131072; // PWM sequencer profile upload (CSV text)
+    static const size_t PATTERN_LIMIT = 65536;   // RMT pattern segment list
+    static const uint8_t MAX_FIELDS = 24;       // Top-level JSON fields indexed per request
+
+    /**
+     * @brief Value type of an indexed JSON field
+     */
+    enum FieldType : uint8_t {
+        FIELD_STRING = 0,
+        FIELD_NUMBER,
+        FIELD_BOOL,
+        FIELD_NULL,
+        FIELD_OBJECT,   // Raw text of nested object, including braces
+        FIELD_ARRAY     // Raw text of nested array, including brackets
+    };
+
+    typedef std::function<void(const char* key, const char* value, FieldType type)> FieldCallback;
+
+    /**
+     * @brief Body handler shared by all POST routes
+     * @param limit Largest accepted body in bytes; larger bodies are flagged for 413
+     */
+    void accumulate(AsyncWebServerRequest* request, uint8_t* data, size_t len,
+                    size_t index, size_t total, size_t limit);
+
+    /**
+     * @brief Check if the body exceeded the route's limit (respond 413)
+     */
+    bool isTooLarge(AsyncWebServerRequest* request);
+
+    /**
+     * @brief Check if the body looked like JSON but failed to parse (respond 400)
+     */
+    bool isMalformed(AsyncWebServerRequest* request);
+
+    /**
+     * @brief Check for a field in form parameters or the JSON body
+     */
+    bool hasParam(AsyncWebServerRequest* request, const char* name);
+
+    /**
+     * @brief Get a field from form parameters or the JSON body
+     * @return Field text, or empty string if missing
+     */
+    String getParam(AsyncWebServerRequest* request, const char* name);
+
+    /**
+     * @brief Visit every form parameter, then every JSON field in document order
+     * @return Number of fields visited
+     */
+    size_t forEachField(AsyncWebServerRequest* request, FieldCallback callback);
+
+    /**
+     * @brief Get the raw body bytes (NUL-terminated)
+     *
+     * Only valid for bodies that were not indexed as JSON; indexing
+     * rewrites the arena in place.
+     * @param length Receives body length (may be nullptr)
+     * @return Pointer into the arena, or nullptr if there is no body
+     */
+    const char* getRaw(AsyncWebServerRequest* request, size_t* length);
+}
+
+/**
+ * @brief In-situ reader for the top level of a JSON object
+ *
+ * Walks "key": value pairs one at a time without building a document.
+ * Strings are unescaped in place and every key/value is NUL-terminated
+ * inside the caller's buffer, so no memory is allocated. Nested objects
+ * and arrays are returned as raw text for the caller to parse further.
+ */
+class JsonFieldReader {
+public:
+    /**
+     * @brief Constructor
+     * @param buffer Writable, NUL-terminated JSON text (modified in place)
+     * @param length Length of text excluding the terminator
+     */
+    JsonFieldReader(char* buffer, size_t length);
+
+    /**
+     * @brief Read the next field
+     * @param key Receives field name
+     * @param value Receives field text
+     * @param type Receives field type
+     * @return true if a field was read, false at end of object or on error
+     */
+    bool next(const char*& key, const char*& value, WebRequestBody::FieldType& type);
+
+    /**
+     * @brief Check if reading stopped because of a syntax error
+     */
+    bool failed() const { return error; }
+
+private:
+    char* buf;
+    size_t len;
+    size_t pos = 0;
+    char pending = 0;       // Character displaced by the last NUL terminator
+    bool started = false;
+    bool done = false;
+    bool error = false;
+
+    char peek() const;
+    void advance();
+    void skipWhitespace();
+    void terminateAt(size_t end);
+    char* readString();
+    char* readScalar(WebRequestBody::FieldType& type);
+    char* readNested(WebRequestBody::FieldType& type);
+    bool fail();
+};
+
+#endif // WEB_REQUEST_BODY_H
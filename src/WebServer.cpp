@@ -30,6 +30,7 @@ bool WebServerManager::begin(WiFiSettings* wifiSettings,
     // Create server instance
     server = new AsyncWebServer(wifiSettings->web_port);
     ws = new AsyncWebSocket("/ws");
+    events = new AsyncEventSource("/api/events");
 
     Serial.printf("✅ Web Server initialized on port %d\n", wifiSettings->web_port);
     return true;
@@ -55,6 +56,10 @@ bool WebServerManager::start() {
     server->addHandler(ws);
     USBSerial.printf("[WS] WebSocket 處理器已添加\n");
 
+    // Setup Server-Sent Events
+    setupEventSource();
+    server->addHandler(events);
+
     // Setup HTTP routes
     setupRoutes();
 
@@ -95,6 +100,11 @@ void WebServerManager::update() {
             broadcastStatus();
         }
     }
+
+    // SSE telemetry at its own configurable rate
+    updateSSE(now);
+
+    updateSnifferTail();
 }
 
 bool WebServerManager::isRunning() const {
@@ -124,7 +134,7 @@ void WebServerManager::broadcastStatus() {
         return;
     }
 
-    StaticJsonDocument<512> doc;
+    StaticJsonDocument<1024> doc;  // Room for the fan channel array
     doc["type"] = "status";
     // Motor control now via UART1
     doc["rpm"] = pPeripheralManager->getUART1().getCalculatedRPM();
@@ -134,11 +144,243 @@ void WebServerManager::broadcastStatus() {
     // Ramping and emergency stop features removed in v3.0
     doc["uptime"] = millis() / 1000;  // System uptime in seconds
 
+    FanBank& fans = pPeripheralManager->getFans();
+    JsonArray fanArray = doc.createNestedArray("fans");
+    for (uint8_t ch = 1; ch <= fans.getChannelCount(); ch++) {
+        FanBank::ChannelInfo info;
+        fans.getInfo(ch, info);
+        JsonObject fan = fanArray.createNestedObject();
+        fan["ch"] = ch;
+        fan["enabled"] = info.enabled;
+        fan["freq"] = info.frequency;
+        fan["duty"] = info.duty;
+        fan["rpm"] = info.rpm;
+        fan["stalled"] = info.stalled;
+    }
+
+    String json;
+    serializeJson(doc, json);
+    ws->textAll(json);
+}
+
+void WebServerManager::broadcastStall(const UART1Mux::StallEvent& event, int channel) {
+    StaticJsonDocument<256> doc;
+    doc["type"] = "stall";
+    if (channel >= 0) {
+        doc["ch"] = channel;
+    }
+    doc["seq"] = event.sequence;
+    doc["detect_us"] = event.detectUs;
+    doc["timeout_us"] = event.timeoutUs;
+    doc["rpm"] = event.lastRpm;
+    doc["duty"] = event.duty;
+    doc["pwm_cut"] = (event.actions & UART1Mux::STALL_ACTION_CUT_PWM) != 0;
+
+    String json;
+    serializeJson(doc, json);
+    if (ws && ws->count() > 0) {
+        ws->textAll(json);
+    }
+    // Events are not snapshots, so SSE clients get them outside the status throttle
+    if (events && events->count() > 0) {
+        events->send(json.c_str(), "stall", ++sseEventId);
+    }
+}
+
+void WebServerManager::broadcastPacket(const PacketLink::Packet& packet) {
+    if (!ws || ws->count() == 0) {
+        return;
+    }
+
+    static const char HEX_DIGITS[] = "0123456789ABCDEF";
+    String hex;
+    hex.reserve(packet.length * 2);
+    for (size_t i = 0; i < packet.length; i++) {
+        hex += HEX_DIGITS[packet.data[i] >> 4];
+        hex += HEX_DIGITS[packet.data[i] & 0x0F];
+    }
+
+    StaticJsonDocument<128> doc;
+    doc["type"] = "packet";
+    doc["seq"] = packet.seq;
+    doc["len"] = packet.length;
+    doc["data"] = hex.c_str();      // Stored by pointer, not copied into the document
+
     String json;
     serializeJson(doc, json);
     ws->textAll(json);
 }
 
+void WebServerManager::updateSnifferTail() {
+    if (!pPeripheralManager) {
+        return;
+    }
+    UARTSniffer& sniffer = pPeripheralManager->getSniffer();
+    if (!sniffer.isLiveTail() || ws->count() == 0) {
+        snifferTailActive = false;
+        return;
+    }
+    // Start at the newest record, and again after every new capture
+    if (!snifferTailActive || snifferTail.generation != sniffer.getGeneration()) {
+        sniffer.beginTail(snifferTail);
+        snifferTailActive = true;
+        return;
+    }
+    // Back-pressure: leave the records in the ring until clients drain
+    if (!ws->availableForWriteAll()) {
+        return;
+    }
+
+    static const char HEX_DIGITS[] = "0123456789ABCDEF";
+    uint8_t data[UARTSniffer::MAX_RECORD_DATA];
+    UARTSniffer::Record record;
+    String json;
+    size_t total = 0;
+    uint32_t count = 0;
+
+    json.reserve(SNIFFER_TAIL_MAX_DATA * 2 + 512);
+    json = "{\"type\":\"uart\",\"records\":[";
+    while (total < SNIFFER_TAIL_MAX_DATA && sniffer.readNext(snifferTail, record, data)) {
+        char head[96];
+        snprintf(head, sizeof(head), "%s{\"t\":%llu,\"port\":%u,\"dir\":\"%s\",%s\"data\":\"",
+                 count > 0 ? "," : "", (unsigned long long)record.timeUs,
+                 record.flags & UARTSniffer::FLAG_PORT_MASK,
+                 (record.flags & UARTSniffer::FLAG_TX) ? "tx" : "rx",
+                 (record.flags & UARTSniffer::FLAG_LOSS) ? "\"lost\":true," : "");
+        json += head;
+        for (uint16_t i = 0; i < record.length; i++) {
+            json += HEX_DIGITS[data[i] >> 4];
+            json += HEX_DIGITS[data[i] & 0x0F];
+        }
+        json += "\"}";
+        total += record.length;
+        count++;
+    }
+    if (count == 0) {
+        return;
+    }
+    json += "]}";
+    ws->textAll(json);
+}
+
+// ============================================================================
+// Server-Sent Events
+// ============================================================================
+
+void WebServerManager::setupEventSource() {
+    events->onConnect([this](AsyncEventSourceClient *client) {
+        // Client limit: each client can hold up to SSE_MAX_QUEUED_MESSAGES frames in the library
+        if (events->count() > SSE_MAX_CLIENTS) {
+            sseClientsRejected++;
+            USBSerial.printf("[SSE] Client rejected (limit %u)\n", SSE_MAX_CLIENTS);
+            client->close();
+            return;
+        }
+
+        if (client->lastId() > 0) {
+            USBSerial.printf("[SSE] Client resumed from event %u (current %u)\n", client->lastId(), sseEventId);
+        } else {
+            USBSerial.printf("[SSE] Client connected (%u total)\n", events->count());
+        }
+
+        // Status is a snapshot stream: resuming means sending the current snapshot with the current ID
+        String frame = generateSSEFrame(readSSEStatus());
+        client->send(frame.c_str(), "status", sseEventId, SSE_RETRY_MS);
+    });
+}
+
+WebServerManager::SSEStatus WebServerManager::readSSEStatus() const {
+    SSEStatus status;
+    if (pPeripheralManager) {
+        UART1Mux& uart1 = pPeripheralManager->getUART1();
+        status.rpm = uart1.getCalculatedRPM();
+        status.rawFreq = uart1.getRPMFrequency();
+        status.freq = uart1.getPWMFrequency();
+        status.duty = uart1.getPWMDuty();
+        status.pwmEnabled = uart1.isPWMEnabled();
+    }
+    return status;
+}
+
+String WebServerManager::generateSSEFrame(const SSEStatus& status) const {
+    StaticJsonDocument<256> doc;
+    if (pPeripheralManager) {
+        doc["rpm"] = status.rpm;
+        doc["raw_freq"] = status.rawFreq;
+        doc["freq"] = status.freq;
+        doc["duty"] = status.duty;
+        doc["pwm_enabled"] = status.pwmEnabled;
+    }
+    doc["uptime"] = millis() / 1000;
+
+    String json;
+    serializeJson(doc, json);
+    return json;
+}
+
+void WebServerManager::updateSSE(unsigned long now) {
+    if (!events || events->count() == 0) {
+        return;
+    }
+    if (now - lastSSEFrame < sseIntervalMs) {
+        return;
+    }
+
+    // Back-pressure: if clients are not draining, skip this tick instead of queueing more
+    if (events->avgPacketsWaiting() >= SSE_MAX_BACKLOG) {
+        sseTicksSkipped++;
+        lastSSEFrame = now;
+        return;
+    }
+
+    // Only push changes, plus a periodic keep-alive of the unchanged status;
+    // nothing is serialized for an unchanged tick
+    SSEStatus status = readSSEStatus();
+    if (lastSSEStatusValid && status == lastSSEStatus && now - lastSSEFrame < SSE_KEEPALIVE_MS) {
+        return;
+    }
+
+    // One serialized frame; AsyncEventSource formats it once and queues it to every client
+    String frame = generateSSEFrame(status);
+    events->send(frame.c_str(), "status", ++sseEventId);
+    lastSSEStatus = status;
+    lastSSEStatusValid = true;
+    lastSSEFrame = now;
+}
+
+uint32_t WebServerManager::getSSEClientCount() const {
+    return events ? events->count() : 0;
+}
+
+bool WebServerManager::setSSEInterval(uint32_t intervalMs) {
+    if (intervalMs < SSE_MIN_INTERVAL_MS || intervalMs > SSE_MAX_INTERVAL_MS) {
+        return false;
+    }
+    sseIntervalMs = intervalMs;
+    return true;
+}
+
+void WebServerManager::getSSEStatistics(uint32_t* lastEventId, uint32_t* ticksSkipped, uint32_t* clientsRejected) const {
+    if (lastEventId) *lastEventId = sseEventId;
+    if (ticksSkipped) *ticksSkipped = sseTicksSkipped;
+    if (clientsRejected) *clientsRejected = sseClientsRejected;
+}
+
+void WebServerManager::handlePostEventsConfig(AsyncWebServerRequest *request) {
+    if (!WebRequestBody::hasParam(request, "interval")) {
+        request->send(400, "application/json", "{\"success\":false,\"error\":\"Missing interval parameter\"}");
+        return;
+    }
+
+    uint32_t interval = WebRequestBody::getParam(request, "interval").toInt();
+    if (!setSSEInterval(interval)) {
+        request->send(400, "application/json", "{\"success\":false,\"error\":\"interval must be 50-60000 ms\"}");
+        return;
+    }
+
+    request->send(200, "application/json", "{\"success\":true,\"interval\":" + String(sseIntervalMs) + "}");
+}
+
 void WebServerManager::setupWebSocket() {
     USBSerial.printf("[WS] setupWebSocket: 正在設置 WebSocket 事件處理器...\n");
 
@@ -316,6 +558,28 @@ void WebServerManager::handleWebSocketMessage(void *arg, uint8_t *data, size_t l
     }
 }
 
+void WebServerManager::onPost(const char* uri, ArRequestHandlerFunction handler, size_t bodyLimit) {
+    server->on(uri, HTTP_POST,
+        [handler, bodyLimit](AsyncWebServerRequest *request) {
+            // Form-urlencoded bodies are parsed into params and never reach the arena,
+            // so the limit is also checked against Content-Length for every content type
+            if (request->contentLength() > bodyLimit || WebRequestBody::isTooLarge(request)) {
+                request->send(413, "application/json", "{\"success\":false,\"error\":\"Request body too large\"}");
+                return;
+            }
+            if (WebRequestBody::isMalformed(request)) {
+                request->send(400, "application/json", "{\"success\":false,\"error\":\"Malformed JSON body\"}");
+                return;
+            }
+            handler(request);
+        },
+        NULL,  // upload handler
+        [bodyLimit](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+            WebRequestBody::accumulate(request, data, len, index, total, bodyLimit);
+        }
+    );
+}
+
 void WebServerManager::setupRoutes() {
     // Serve main page from SPIFFS (root path)
     server->on("/", HTTP_GET, [this](AsyncWebServerRequest *request) {
@@ -371,31 +635,31 @@ void WebServerManager::setupRoutes() {
         handleGetSettings(request);
     });
 
-    server->on("/api/motor/freq", HTTP_POST, [this](AsyncWebServerRequest *request) {
+    onPost("/api/motor/freq", [this](AsyncWebServerRequest *request) {
         handleSetPWMFreq(request);
     });
 
-    server->on("/api/motor/duty", HTTP_POST, [this](AsyncWebServerRequest *request) {
+    onPost("/api/motor/duty", [this](AsyncWebServerRequest *request) {
         handleSetPWMDuty(request);
     });
 
-    server->on("/api/motor/stop", HTTP_POST, [this](AsyncWebServerRequest *request) {
+    onPost("/api/motor/stop", [this](AsyncWebServerRequest *request) {
         handleMotorStop(request);
     });
 
-    server->on("/api/motor/clear-error", HTTP_POST, [this](AsyncWebServerRequest *request) {
+    onPost("/api/motor/clear-error", [this](AsyncWebServerRequest *request) {
         handleClearError(request);
     });
 
-    server->on("/api/settings/save", HTTP_POST, [this](AsyncWebServerRequest *request) {
+    onPost("/api/settings/save", [this](AsyncWebServerRequest *request) {
         handleSaveSettings(request);
     });
 
-    server->on("/api/settings/load", HTTP_POST, [this](AsyncWebServerRequest *request) {
+    onPost("/api/settings/load", [this](AsyncWebServerRequest *request) {
         handleLoadSettings(request);
     });
 
-    server->on("/api/settings/reset", HTTP_POST, [this](AsyncWebServerRequest *request) {
+    onPost("/api/settings/reset", [this](AsyncWebServerRequest *request) {
         handleResetSettings(request);
     });
 
@@ -416,32 +680,23 @@ void WebServerManager::setupRoutes() {
         handleGetConfig(request);
     });
 
-    server->on("/api/config", HTTP_POST,
-        [this](AsyncWebServerRequest *request) {
-            handlePostConfig(request);
-        },
-        NULL,  // upload handler
-        [this](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
-            // Body handler - store body data for processing in handlePostConfig
-            if (index == 0) {
-                request->_tempObject = new String();
-            }
-            String* bodyStr = (String*)request->_tempObject;
-            for (size_t i = 0; i < len; i++) {
-                bodyStr->concat((char)data[i]);
-            }
-        }
-    );
+    onPost("/api/config", [this](AsyncWebServerRequest *request) {
+        handlePostConfig(request);
+    }, WebRequestBody::CONFIG_LIMIT);
 
-    server->on("/api/pwm", HTTP_POST, [this](AsyncWebServerRequest *request) {
+    onPost("/api/pwm", [this](AsyncWebServerRequest *request) {
         handlePostPWM(request);
     });
 
-    server->on("/api/pole-pairs", HTTP_POST, [this](AsyncWebServerRequest *request) {
+    onPost("/api/batch", [this](AsyncWebServerRequest *request) {
+        handlePostBatch(request);
+    });
+
+    onPost("/api/pole-pairs", [this](AsyncWebServerRequest *request) {
         handlePostPolePairs(request);
     });
 
-    server->on("/api/max-frequency", HTTP_POST, [this](AsyncWebServerRequest *request) {
+    onPost("/api/max-frequency", [this](AsyncWebServerRequest *request) {
         handlePostMaxFrequency(request);
     });
 
@@ -449,15 +704,19 @@ void WebServerManager::setupRoutes() {
         handleGetAPMode(request);
     });
 
-    server->on("/api/ap-mode", HTTP_POST, [this](AsyncWebServerRequest *request) {
+    onPost("/api/ap-mode", [this](AsyncWebServerRequest *request) {
         handlePostAPMode(request);
     });
 
-    server->on("/api/save", HTTP_POST, [this](AsyncWebServerRequest *request) {
+    onPost("/api/events/config", [this](AsyncWebServerRequest *request) {
+        handlePostEventsConfig(request);
+    });
+
+    onPost("/api/save", [this](AsyncWebServerRequest *request) {
         handlePostSave(request);
     });
 
-    server->on("/api/load", HTTP_POST, [this](AsyncWebServerRequest *request) {
+    onPost("/api/load", [this](AsyncWebServerRequest *request) {
         handlePostLoad(request);
     });
 
@@ -495,34 +754,138 @@ void WebServerManager::setupRoutes() {
         handleGetUART1Status(request);
     });
 
-    server->on("/api/uart1/mode", HTTP_POST, [this](AsyncWebServerRequest *request) {
+    onPost("/api/uart1/mode", [this](AsyncWebServerRequest *request) {
         handlePostUART1Mode(request);
     });
 
-    server->on("/api/uart1/pwm", HTTP_POST, [this](AsyncWebServerRequest *request) {
+    onPost("/api/uart1/pwm", [this](AsyncWebServerRequest *request) {
         handlePostUART1PWM(request);
     });
 
+    server->on("/api/uart1/pulse", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        handleGetPulse(request);
+    });
+
+    onPost("/api/uart1/pulse", [this](AsyncWebServerRequest *request) {
+        handlePostPulse(request);
+    });
+
+    server->on("/api/uart1/sequence", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        handleGetSequence(request);
+    });
+
+    onPost("/api/uart1/sequence", [this](AsyncWebServerRequest *request) {
+        handlePostSequence(request);
+    }, WebRequestBody::SEQUENCE_LIMIT);
+
+    onPost("/api/uart1/sequence/play", [this](AsyncWebServerRequest *request) {
+        handlePostSequencePlay(request);
+    });
+
+    onPost("/api/uart1/sequence/stop", [this](AsyncWebServerRequest *request) {
+        handlePostSequenceStop(request);
+    });
+
+    server->on("/api/uart1/sequence/result", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        handleGetSequenceResult(request);
+    });
+
+    server->on("/api/characterize", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        handleGetCharacterize(request);
+    });
+
+    onPost("/api/characterize", [this](AsyncWebServerRequest *request) {
+        handlePostCharacterize(request);
+    });
+
+    onPost("/api/characterize/stop", [this](AsyncWebServerRequest *request) {
+        handlePostCharacterizeStop(request);
+    });
+
+    server->on("/api/characterize/result", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        handleGetCharacterizeResult(request);
+    });
+
+    server->on("/api/characterize/trace", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        handleGetCharacterizeTrace(request);
+    });
+
+    server->on("/api/capture", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        handleGetCapture(request);
+    });
+
+    onPost("/api/capture", [this](AsyncWebServerRequest *request) {
+        handlePostCapture(request);
+    });
+
+    onPost("/api/capture/stop", [this](AsyncWebServerRequest *request) {
+        handlePostCaptureStop(request);
+    });
+
+    server->on("/api/capture.vcd", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        handleGetCaptureData(request, LogicCapture::FORMAT_VCD);
+    });
+
+    server->on("/api/capture.csv", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        handleGetCaptureData(request, LogicCapture::FORMAT_CSV);
+    });
+
+    server->on("/api/fans", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        handleGetFans(request);
+    });
+
+    onPost("/api/fans", [this](AsyncWebServerRequest *request) {
+        handlePostFans(request);
+    });
+
     server->on("/api/uart2/status", HTTP_GET, [this](AsyncWebServerRequest *request) {
         handleGetUART2Status(request);
     });
 
-    server->on("/api/buzzer", HTTP_POST, [this](AsyncWebServerRequest *request) {
+    server->on("/api/uart/sniffer", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        handleGetSniffer(request);
+    });
+
+    server->on("/api/uart/capture", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        handleGetUARTCapture(request);
+    });
+
+    onPost("/api/buzzer", [this](AsyncWebServerRequest *request) {
         handlePostBuzzer(request);
     });
 
-    server->on("/api/led", HTTP_POST, [this](AsyncWebServerRequest *request) {
+    onPost("/api/led", [this](AsyncWebServerRequest *request) {
         handlePostLEDPWM(request);
     });
 
-    server->on("/api/relay", HTTP_POST, [this](AsyncWebServerRequest *request) {
+    onPost("/api/relay", [this](AsyncWebServerRequest *request) {
         handlePostRelay(request);
     });
 
-    server->on("/api/gpio", HTTP_POST, [this](AsyncWebServerRequest *request) {
+    onPost("/api/gpio", [this](AsyncWebServerRequest *request) {
         handlePostGPIO(request);
     });
 
+    server->on("/api/pattern", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        handleGetPattern(request);
+    });
+
+    onPost("/api/pattern", [this](AsyncWebServerRequest *request) {
+        handlePostPattern(request);
+    }, WebRequestBody::PATTERN_LIMIT);
+
+    onPost("/api/pattern/stop", [this](AsyncWebServerRequest *request) {
+        handlePostPatternStop(request);
+    });
+
+    server->on("/api/presets", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        handleGetPresets(request);
+    });
+
+    onPost("/api/preset", [this](AsyncWebServerRequest *request) {
+        handlePostPreset(request);
+    });
+
     server->on("/api/keys", HTTP_GET, [this](AsyncWebServerRequest *request) {
         handleGetKeys(request);
     });
@@ -548,12 +911,12 @@ void WebServerManager::handleSetPWMFreq(AsyncWebServerRequest *request) {
         return;
     }
 
-    if (!request->hasParam("value", true)) {
+    if (!WebRequestBody::hasParam(request, "value")) {
         request->send(400, "application/json", "{\"error\":\"Missing value parameter\"}");
         return;
     }
 
-    uint32_t freq = request->getParam("value", true)->value().toInt();
+    uint32_t freq = WebRequestBody::getParam(request, "value").toInt();
 
     if (pPeripheralManager->getUART1().setPWMFrequency(freq)) {
         request->send(200, "application/json", "{\"success\":true}");
@@ -569,12 +932,12 @@ void WebServerManager::handleSetPWMDuty(AsyncWebServerRequest *request) {
         return;
     }
 
-    if (!request->hasParam("value", true)) {
+    if (!WebRequestBody::hasParam(request, "value")) {
         request->send(400, "application/json", "{\"error\":\"Missing value parameter\"}");
         return;
     }
 
-    float duty = request->getParam("value", true)->value().toFloat();
+    float duty = WebRequestBody::getParam(request, "value").toFloat();
 
     if (pPeripheralManager->getUART1().setPWMDuty(duty)) {
         request->send(200, "application/json", "{\"success\":true}");
@@ -667,6 +1030,9 @@ String WebServerManager::generateStatusJSON() {
         doc["raw_freq"] = uart1.getRPMFrequency();  // Raw frequency instead of raw RPM
         doc["frequency"] = uart1.getPWMFrequency();
         doc["freq"] = uart1.getPWMFrequency();  // Alias for compatibility
+        doc["actual_freq"] = uart1.getPWMSynthesis().frequency;
+        doc["freq_error_ppm"] = uart1.getPWMSynthesis().errorPpm;
+        doc["duty_resolution"] = uart1.getPWMSynthesis().dutyResolution;
         doc["duty"] = uart1.getPWMDuty();
         doc["realInputFrequency"] = uart1.getRPMFrequency();
         doc["input_freq"] = uart1.getRPMFrequency();  // Alias
@@ -807,112 +1173,80 @@ void WebServerManager::handleGetConfig(AsyncWebServerRequest *request) {
 }
 
 void WebServerManager::handlePostConfig(AsyncWebServerRequest *request) {
-    // This handler is called after body is parsed
-    // Check if we have JSON body data
+    // Fields arrive either as form parameters or as a JSON object (settings page)
+    // and are applied in the order they appear in the body.
     bool updated = false;
+    bool wifiUpdated = false;
     String updateMessage = "";
 
-    // v3.0: LED brightness and chart update settings moved to WiFi/UI settings
-    // (ledBrightness now in StatusLED, chartUpdateRate/rpmUpdateRate in UI config)
-    if (request->hasParam("ledBrightness", true)) {
-        uint8_t brightness = request->getParam("ledBrightness", true)->value().toInt();
-        if (pStatusLED) {
-            pStatusLED->setBrightness(brightness);
-        }
-        updated = true;
-    }
-
-    // Handle JSON body (from settings page)
-    if (request->_tempObject != nullptr) {
-        String* bodyStr = (String*)request->_tempObject;
-
-        StaticJsonDocument<1024> doc;
-        DeserializationError error = deserializeJson(doc, *bodyStr);
-
-        if (!error) {
-            // v3.0: Language settings removed (was in MotorSettings)
-            // LED brightness now handled directly via StatusLED
-            if (doc.containsKey("ledBrightness")) {
-                uint8_t brightness = doc["ledBrightness"];
-                // Apply brightness to actual LED immediately
-                if (pStatusLED) {
-                    pStatusLED->setBrightness(brightness);
-                    Serial.printf("✅ LED brightness updated and applied: %d\n", brightness);
-                }
-                updated = true;
+    WebRequestBody::forEachField(request, [&](const char* key, const char* value, WebRequestBody::FieldType type) {
+        // v3.0: LED brightness now handled directly via StatusLED
+        if (strcmp(key, "ledBrightness") == 0) {
+            uint8_t brightness = atoi(value);
+            // Apply brightness to actual LED immediately
+            if (pStatusLED) {
+                pStatusLED->setBrightness(brightness);
+                Serial.printf("✅ LED brightness updated and applied: %d\n", brightness);
             }
-
-            // rpmUpdateRate removed in v3.0 (was UI-only setting)
-
-            // Motor settings now via UART1 (v3.0)
-            if (doc.containsKey("polePairs") && pPeripheralManager) {
-                uint8_t polePairs = doc["polePairs"];
-                pPeripheralManager->getUART1().setPolePairs(polePairs);
-                Serial.printf("✅ Pole pairs set to: %d\n", polePairs);
-                updated = true;
+            updated = true;
+        }
+        // Motor settings now via UART1 (v3.0)
+        else if (strcmp(key, "polePairs") == 0 && pPeripheralManager) {
+            uint8_t polePairs = atoi(value);
+            pPeripheralManager->getUART1().setPolePairs(polePairs);
+            Serial.printf("✅ Pole pairs set to: %d\n", polePairs);
+            updated = true;
+        }
+        // WiFi settings
+        else if (strcmp(key, "wifiSSID") == 0 || strcmp(key, "wifiPassword") == 0) {
+            if (!pWiFiSettingsManager) {
+                return;
             }
+            WiFiSettings& wifiSettings = pWiFiSettingsManager->get();
 
-            // maxFrequency, maxSafeRPM, maxSafeRPMEnabled removed in v3.0
-
-            // WiFi settings
-            if (doc.containsKey("wifiSSID") || doc.containsKey("wifiPassword")) {
-                bool wifiUpdated = false;
-
-                if (pWiFiSettingsManager) {
-                    WiFiSettings& wifiSettings = pWiFiSettingsManager->get();
-
-                    if (doc.containsKey("wifiSSID")) {
-                        const char* ssid = doc["wifiSSID"];
-                        Serial.printf("📡 WiFi SSID received: %s\n", ssid);
-                        strncpy(wifiSettings.sta_ssid, ssid, sizeof(wifiSettings.sta_ssid) - 1);
-                        wifiSettings.sta_ssid[sizeof(wifiSettings.sta_ssid) - 1] = '\0';
-                        wifiUpdated = true;
-                    }
-
-                    if (doc.containsKey("wifiPassword")) {
-                        const char* password = doc["wifiPassword"];
-                        Serial.println("📡 WiFi password received");
-                        // Only update password if not empty (empty means keep existing)
-                        if (password && strlen(password) > 0) {
-                            strncpy(wifiSettings.sta_password, password, sizeof(wifiSettings.sta_password) - 1);
-                            wifiSettings.sta_password[sizeof(wifiSettings.sta_password) - 1] = '\0';
-                            wifiUpdated = true;
-                        }
-                    }
-
-                    if (wifiUpdated) {
-                        if (pWiFiSettingsManager->save()) {
-                            Serial.println("💾 WiFi settings saved to NVS");
-                            updateMessage += "WiFi settings saved. ";
-                        } else {
-                            Serial.println("❌ Failed to save WiFi settings");
-                            updateMessage += "WiFi settings save failed. ";
-                        }
-                    }
-                } else {
-                    Serial.println("⚠️ WiFiSettingsManager not available");
-                    updateMessage += "WiFi settings manager not available. ";
+            if (strcmp(key, "wifiSSID") == 0) {
+                Serial.printf("📡 WiFi SSID received: %s\n", value);
+                strncpy(wifiSettings.sta_ssid, value, sizeof(wifiSettings.sta_ssid) - 1);
+                wifiSettings.sta_ssid[sizeof(wifiSettings.sta_ssid) - 1] = '\0';
+                wifiUpdated = true;
+            } else {
+                Serial.println("📡 WiFi password received");
+                // Only update password if not empty (empty means keep existing)
+                if (strlen(value) > 0) {
+                    strncpy(wifiSettings.sta_password, value, sizeof(wifiSettings.sta_password) - 1);
+                    wifiSettings.sta_password[sizeof(wifiSettings.sta_password) - 1] = '\0';
+                    wifiUpdated = true;
                 }
             }
+        }
+        // BLE device name
+        else if (strcmp(key, "bleDeviceName") == 0) {
+            Serial.printf("📶 BLE device name received: %s\n", value);
+            // Note: BLE name requires BLEDevice access to update
+            // TODO: Update BLE device name dynamically
+            updateMessage += "BLE name requires implementation. ";
+        }
+        // rpmUpdateRate, maxFrequency, maxSafeRPM, maxSafeRPMEnabled removed in v3.0
+    });
 
-            // BLE device name
-            if (doc.containsKey("bleDeviceName")) {
-                const char* bleName = doc["bleDeviceName"];
-                Serial.printf("📶 BLE device name received: %s\n", bleName);
-                // Note: BLE name requires BLEDevice access to update
-                // TODO: Update BLE device name dynamically
-                updateMessage += "BLE name requires implementation. ";
-            }
-
-            // Save settings to NVS if anything changed (v3.0: via peripheral manager)
-            if (updated && pPeripheralManager) {
-                pPeripheralManager->saveSettings();
-                Serial.println("💾 Settings saved to NVS");
-            }
+    if (wifiUpdated) {
+        if (pWiFiSettingsManager->save()) {
+            Serial.println("💾 WiFi settings saved to NVS");
+            updateMessage += "WiFi settings saved. ";
+        } else {
+            Serial.println("❌ Failed to save WiFi settings");
+            updateMessage += "WiFi settings save failed. ";
         }
+    } else if (!pWiFiSettingsManager &&
+               (WebRequestBody::hasParam(request, "wifiSSID") || WebRequestBody::hasParam(request, "wifiPassword"))) {
+        Serial.println("⚠️ WiFiSettingsManager not available");
+        updateMessage += "WiFi settings manager not available. ";
+    }
 
-        delete bodyStr;
-        request->_tempObject = nullptr;
+    // Save settings to NVS if anything changed (v3.0: via peripheral manager)
+    if (updated && pPeripheralManager) {
+        pPeripheralManager->saveSettings();
+        Serial.println("💾 Settings saved to NVS");
     }
 
     if (updated) {
@@ -928,8 +1262,8 @@ void WebServerManager::handlePostConfig(AsyncWebServerRequest *request) {
 }
 
 void WebServerManager::handlePostPWM(AsyncWebServerRequest *request) {
-    bool hasFreq = request->hasParam("frequency", true);
-    bool hasDuty = request->hasParam("duty", true);
+    bool hasFreq = WebRequestBody::hasParam(request, "frequency");
+    bool hasDuty = WebRequestBody::hasParam(request, "duty");
 
     if (!hasFreq && !hasDuty) {
         request->send(400, "application/json", "{\"success\":false,\"error\":\"Missing frequency or duty parameter\"}");
@@ -941,7 +1275,7 @@ void WebServerManager::handlePostPWM(AsyncWebServerRequest *request) {
 
     // v3.0: Motor control via UART1
     if (hasFreq && pPeripheralManager) {
-        uint32_t freq = request->getParam("frequency", true)->value().toInt();
+        uint32_t freq = WebRequestBody::getParam(request, "frequency").toInt();
         if (pPeripheralManager->getUART1().setPWMFrequency(freq)) {
             message += "Frequency: " + String(freq) + "Hz ";
         } else {
@@ -950,7 +1284,7 @@ void WebServerManager::handlePostPWM(AsyncWebServerRequest *request) {
     }
 
     if (hasDuty && pPeripheralManager) {
-        float duty = request->getParam("duty", true)->value().toFloat();
+        float duty = WebRequestBody::getParam(request, "duty").toFloat();
         if (pPeripheralManager->getUART1().setPWMDuty(duty)) {
             message += "Duty: " + String(duty, 1) + "%";
         } else {
@@ -965,13 +1299,58 @@ void WebServerManager::handlePostPWM(AsyncWebServerRequest *request) {
     }
 }
 
+void WebServerManager::handlePostBatch(AsyncWebServerRequest *request) {
+    if (!pPeripheralManager) {
+        request->send(500, "application/json", "{\"success\":false,\"error\":\"Peripheral manager not initialized\"}");
+        return;
+    }
+
+    // Collect every field first; any bad field rejects the whole batch
+    PeripheralBatch batch;
+    String error;
+    bool parsed = true;
+    WebRequestBody::forEachField(request, [&](const char* key, const char* value, WebRequestBody::FieldType type) {
+        if (parsed && !batch.setField(key, value, error)) {
+            parsed = false;
+        }
+    });
+
+    if (!parsed || !pPeripheralManager->applyBatch(batch, error)) {
+        StaticJsonDocument<192> doc;
+        doc["success"] = false;
+        doc["error"] = error;
+        String json;
+        serializeJson(doc, json);
+        request->send(400, "application/json", json);
+        return;
+    }
+
+    // Observers see one notification for the whole operating point
+    broadcastStatus();
+
+    UART1Mux& uart1 = pPeripheralManager->getUART1();
+    StaticJsonDocument<256> doc;
+    doc["success"] = true;
+    doc["frequency"] = uart1.getPWMFrequency();
+    doc["duty"] = uart1.getPWMDuty();
+    doc["polePairs"] = uart1.getPolePairs();
+    doc["maxFrequency"] = uart1.getMaxFrequency();
+    doc["led"] = pPeripheralManager->getLEDPWM().getBrightness();
+    doc["ledEnabled"] = pPeripheralManager->getLEDPWM().isEnabled();
+    doc["relay"] = pPeripheralManager->getRelay().getState();
+
+    String json;
+    serializeJson(doc, json);
+    request->send(200, "application/json", json);
+}
+
 void WebServerManager::handlePostPolePairs(AsyncWebServerRequest *request) {
-    if (!request->hasParam("polePairs", true)) {
+    if (!WebRequestBody::hasParam(request, "polePairs")) {
         request->send(400, "application/json", "{\"success\":false,\"error\":\"Missing polePairs parameter\"}");
         return;
     }
 
-    uint8_t polePairs = request->getParam("polePairs", true)->value().toInt();
+    uint8_t polePairs = WebRequestBody::getParam(request, "polePairs").toInt();
 
     if (polePairs < 1 || polePairs > 12) {
         request->send(400, "application/json", "{\"success\":false,\"error\":\"Pole pairs must be between 1 and 12\"}");
@@ -1017,12 +1396,12 @@ void WebServerManager::handleGetAPMode(AsyncWebServerRequest *request) {
 }
 
 void WebServerManager::handlePostAPMode(AsyncWebServerRequest *request) {
-    if (!request->hasParam("enabled", true)) {
+    if (!WebRequestBody::hasParam(request, "enabled")) {
         request->send(400, "application/json", "{\"success\":false,\"error\":\"Missing enabled parameter\"}");
         return;
     }
 
-    String enabledStr = request->getParam("enabled", true)->value();
+    String enabledStr = WebRequestBody::getParam(request, "enabled");
     bool enabled = (enabledStr == "true" || enabledStr == "1");
 
     // TODO: Implement AP mode control in WiFiManager
@@ -19,6 +19,7 @@ class WiFiSettingsManager;
 #include "WiFiManager.h"
 #include "StatusLED.h"
 #include "PeripheralManager.h"
+#include "WebRequestBody.h"
 
 /**
  * @brief Web Server Manager
@@ -92,6 +93,52 @@ public:
      */
     void broadcastStatus();
 
+    /**
+     * @brief Push a fan stall to all WebSocket clients and as an SSE "stall" event
+     * @param channel FanBank channel, or -1 for the UART1 channel (no "ch" field)
+     */
+    void broadcastStall(const UART1Mux::StallEvent& event, int channel = -1);
+
+    /**
+     * @brief Push a UART2 packet (streaming mode) to all WebSocket clients
+     */
+    void broadcastPacket(const PacketLink::Packet& packet);
+
+    // ========================================================================
+    // Server-Sent Events (/api/events)
+    // ========================================================================
+
+    /**
+     * @brief Get number of connected SSE clients
+     * @return Client count
+     */
+    uint32_t getSSEClientCount() const;
+
+    /**
+     * @brief Set SSE telemetry interval
+     * @param intervalMs Interval in ms (SSE_MIN_INTERVAL_MS - SSE_MAX_INTERVAL_MS)
+     * @return true if valid
+     */
+    bool setSSEInterval(uint32_t intervalMs);
+
+    /**
+     * @brief Get SSE telemetry interval
+     * @return Interval in ms
+     */
+    uint32_t getSSEInterval() const { return sseIntervalMs; }
+
+    /**
+     * @brief Get SSE statistics
+     * @param lastEventId Last event ID sent
+     * @param ticksSkipped Ticks skipped because clients were backlogged
+     * @param clientsRejected Connections refused by the client limit
+     */
+    void getSSEStatistics(uint32_t* lastEventId, uint32_t* ticksSkipped, uint32_t* clientsRejected) const;
+
+    static const uint32_t SSE_MIN_INTERVAL_MS = 50;
+    static const uint32_t SSE_MAX_INTERVAL_MS = 60000;
+    static const uint32_t SSE_MAX_CLIENTS = 4;
+
 private:
     AsyncWebServer* server = nullptr;
     AsyncWebSocket* ws = nullptr;
@@ -103,21 +150,96 @@ private:
     PeripheralManager* pPeripheralManager = nullptr;
     WiFiSettingsManager* pWiFiSettingsManager = nullptr;
 
+    AsyncEventSource* events = nullptr;
+
     bool running = false;
     unsigned long lastWSBroadcast = 0;
 
     static const uint32_t WS_BROADCAST_INTERVAL_MS = 200;  // 5 Hz updates
 
+    // SSE telemetry state (frames are built once per tick and shared by all clients)
+    uint32_t sseIntervalMs = 500;
+    unsigned long lastSSEFrame = 0;
+    uint32_t sseEventId = 0;
+    uint32_t sseTicksSkipped = 0;
+    uint32_t sseClientsRejected = 0;
+
+    // Inputs of the SSE status frame; uptime is not part of it, so an idle
+    // device only sends the keep-alive
+    struct SSEStatus {
+        float rpm = 0.0f;
+        float rawFreq = 0.0f;
+        uint32_t freq = 0;
+        float duty = 0.0f;
+        bool pwmEnabled = false;
+
+        bool operator==(const SSEStatus& other) const {
+            return rpm == other.rpm && rawFreq == other.rawFreq && freq == other.freq &&
+                   duty == other.duty && pwmEnabled == other.pwmEnabled;
+        }
+    };
+    SSEStatus lastSSEStatus;
+    bool lastSSEStatusValid = false;
+
+    static const uint32_t SSE_KEEPALIVE_MS = 5000;   // Resend unchanged status at least this often
+    static const uint32_t SSE_RETRY_MS = 2000;       // Client reconnect delay hint
+    static const uint32_t SSE_MAX_BACKLOG = 4;       // Avg queued frames per client before ticks are skipped
+
+    // UART sniffer live tail (records since SNIFF TAIL ON, pushed each update())
+    UARTSniffer::Cursor snifferTail;
+    bool snifferTailActive = false;
+
+    static const size_t SNIFFER_TAIL_MAX_DATA = 2048;   // Payload bytes per tick (about 4 KB of JSON)
+
     /**
      * @brief Setup HTTP routes
      */
     void setupRoutes();
 
+    /**
+     * @brief Register a POST route with the bounded body accumulator
+     *
+     * Bodies larger than bodyLimit are answered with 413 and malformed
+     * JSON with 400 before the handler runs. Handlers read fields through
+     * WebRequestBody, which covers both form and JSON bodies.
+     * @param uri Route path
+     * @param handler Request handler
+     * @param bodyLimit Largest accepted body in bytes
+     */
+    void onPost(const char* uri, ArRequestHandlerFunction handler,
+                size_t bodyLimit = WebRequestBody::DEFAULT_LIMIT);
+
     /**
      * @brief Setup WebSocket handlers
      */
     void setupWebSocket();
 
+    /**
+     * @brief Setup Server-Sent Events source
+     */
+    void setupEventSource();
+
+    /**
+     * @brief Read the values the SSE status frame is built from
+     */
+    SSEStatus readSSEStatus() const;
+
+    /**
+     * @brief Serialize the status frame shared by SSE clients (adds the uptime)
+     */
+    String generateSSEFrame(const SSEStatus& status) const;
+
+    /**
+     * @brief Push a status frame to SSE clients if due
+     * @param now Current millis()
+     */
+    void updateSSE(unsigned long now);
+
+    /**
+     * @brief Push UART sniffer records written since the last tick to WebSocket clients
+     */
+    void updateSnifferTail();
+
     /**
      * @brief Handle WebSocket event
      */
@@ -166,23 +288,50 @@ private:
     void handleGetConfig(AsyncWebServerRequest *request);
     void handlePostConfig(AsyncWebServerRequest *request);
     void handlePostPWM(AsyncWebServerRequest *request);
+    void handlePostBatch(AsyncWebServerRequest *request);
     void handlePostPolePairs(AsyncWebServerRequest *request);
     void handlePostMaxFrequency(AsyncWebServerRequest *request);
     void handleGetAPMode(AsyncWebServerRequest *request);
     void handlePostAPMode(AsyncWebServerRequest *request);
     void handlePostSave(AsyncWebServerRequest *request);
     void handlePostLoad(AsyncWebServerRequest *request);
+    void handlePostEventsConfig(AsyncWebServerRequest *request);
 
     // Peripheral API handlers
     void handleGetPeripheralStatus(AsyncWebServerRequest *request);
     void handleGetUART1Status(AsyncWebServerRequest *request);
     void handlePostUART1Mode(AsyncWebServerRequest *request);
     void handlePostUART1PWM(AsyncWebServerRequest *request);
+    void handleGetPulse(AsyncWebServerRequest *request);
+    void handlePostPulse(AsyncWebServerRequest *request);
+    void handleGetSequence(AsyncWebServerRequest *request);
+    void handlePostSequence(AsyncWebServerRequest *request);
+    void handlePostSequencePlay(AsyncWebServerRequest *request);
+    void handlePostSequenceStop(AsyncWebServerRequest *request);
+    void handleGetSequenceResult(AsyncWebServerRequest *request);
+    void handleGetCharacterize(AsyncWebServerRequest *request);
+    void handlePostCharacterize(AsyncWebServerRequest *request);
+    void handlePostCharacterizeStop(AsyncWebServerRequest *request);
+    void handleGetCharacterizeResult(AsyncWebServerRequest *request);
+    void handleGetCharacterizeTrace(AsyncWebServerRequest *request);
+    void handleGetCapture(AsyncWebServerRequest *request);
+    void handlePostCapture(AsyncWebServerRequest *request);
+    void handlePostCaptureStop(AsyncWebServerRequest *request);
+    void handleGetCaptureData(AsyncWebServerRequest *request, LogicCapture::Format format);
+    void handleGetFans(AsyncWebServerRequest *request);
+    void handlePostFans(AsyncWebServerRequest *request);
     void handleGetUART2Status(AsyncWebServerRequest *request);
+    void handleGetSniffer(AsyncWebServerRequest *request);
+    void handleGetUARTCapture(AsyncWebServerRequest *request);
     void handlePostBuzzer(AsyncWebServerRequest *request);
     void handlePostLEDPWM(AsyncWebServerRequest *request);
     void handlePostRelay(AsyncWebServerRequest *request);
     void handlePostGPIO(AsyncWebServerRequest *request);
+    void handleGetPattern(AsyncWebServerRequest *request);
+    void handlePostPattern(AsyncWebServerRequest *request);
+    void handlePostPatternStop(AsyncWebServerRequest *request);
+    void handleGetPresets(AsyncWebServerRequest *request);
+    void handlePostPreset(AsyncWebServerRequest *request);
     void handleGetKeys(AsyncWebServerRequest *request);
 };
 
@@ -96,18 +96,18 @@ void WebServerManager::handlePostUART1Mode(AsyncWebServerRequest *request) {
         return;
     }
 
-    if (!request->hasParam("mode", true)) {
+    if (!WebRequestBody::hasParam(request, "mode")) {
         request->send(400, "application/json", "{\"error\":\"Missing 'mode' parameter\"}");
         return;
     }
 
-    String mode = request->getParam("mode", true)->value();
+    String mode = WebRequestBody::getParam(request, "mode");
     mode.toUpperCase();
 
     bool success = false;
     if (mode == "UART") {
-        uint32_t baud = request->hasParam("baud", true) ?
-                        request->getParam("baud", true)->value().toInt() : 115200;
+        uint32_t baud = WebRequestBody::hasParam(request, "baud") ?
+                        WebRequestBody::getParam(request, "baud").toInt() : 115200;
         success = pPeripheralManager->getUART1().setModeUART(baud);
     } else if (mode == "PWM") {
         success = pPeripheralManager->getUART1().setModePWM_RPM();
@@ -140,24 +140,24 @@ void WebServerManager::handlePostUART1PWM(AsyncWebServerRequest *request) {
     bool success = true;
     String message = "PWM updated";
 
-    if (request->hasParam("frequency", true)) {
-        uint32_t freq = request->getParam("frequency", true)->value().toInt();
+    if (WebRequestBody::hasParam(request, "frequency")) {
+        uint32_t freq = WebRequestBody::getParam(request, "frequency").toInt();
         if (!pPeripheralManager->getUART1().setPWMFrequency(freq)) {
             success = false;
             message = "Invalid frequency";
         }
     }
 
-    if (success && request->hasParam("duty", true)) {
-        float duty = request->getParam("duty", true)->value().toFloat();
+    if (success && WebRequestBody::hasParam(request, "duty")) {
+        float duty = WebRequestBody::getParam(request, "duty").toFloat();
         if (!pPeripheralManager->getUART1().setPWMDuty(duty)) {
             success = false;
             message = "Invalid duty cycle";
         }
     }
 
-    if (success && request->hasParam("enabled", true)) {
-        bool enabled = request->getParam("enabled", true)->value() == "true";
+    if (success && WebRequestBody::hasParam(request, "enabled")) {
+        bool enabled = WebRequestBody::getParam(request, "enabled") == "true";
         pPeripheralManager->getUART1().setPWMEnabled(enabled);
     }
 
@@ -172,26 +172,844 @@ void WebServerManager::handlePostUART1PWM(AsyncWebServerRequest *request) {
     request->send(success ? 200 : 400, "application/json", response);
 }
 
+void WebServerManager::handleGetPulse(AsyncWebServerRequest *request) {
+    if (!pPeripheralManager) {
+        request->send(503, "application/json", "{\"error\":\"Peripheral manager not available\"}");
+        return;
+    }
+
+    auto& uart1 = pPeripheralManager->getUART1();
+    PulseMeter::Statistics stats = uart1.getPulseStatistics();
+
+    StaticJsonDocument<1024> doc;
+    doc["source"] = UART1Mux::getPulseSourceName(uart1.getPulseSource());
+    doc["edges"] = stats.edges;
+    doc["cycles"] = stats.cycles;
+    doc["unpaired"] = stats.unpaired;
+    doc["capture_drops"] = uart1.getCaptureDrops();
+    doc["line_level"] = uart1.getPulseLineLevel() ? 1 : 0;
+
+    const struct {
+        const char* name;
+        const PulseMeter::Range& range;
+    } ranges[] = {
+        {"high_us", stats.highUs},
+        {"low_us", stats.lowUs},
+        {"period_us", stats.periodUs},
+        {"duty", stats.duty},
+    };
+    for (const auto& entry : ranges) {
+        JsonObject obj = doc.createNestedObject(entry.name);
+        obj["last"] = entry.range.last;
+        obj["min"] = entry.range.min;
+        obj["max"] = entry.range.max;
+        obj["mean"] = entry.range.mean;
+    }
+    doc["duty"]["stddev"] = stats.dutyStddev;
+    doc["frequency"] = stats.frequency;
+
+    if (uart1.getPulseSource() == UART1Mux::PULSE_LOOPBACK) {
+        doc["set_duty"] = uart1.getPWMDuty();
+        doc["set_frequency"] = uart1.getPWMSynthesis().frequency;
+    }
+
+    String response;
+    serializeJson(doc, response);
+    request->send(200, "application/json", response);
+}
+
+void WebServerManager::handlePostPulse(AsyncWebServerRequest *request) {
+    // source=off|input|loopback, reset=true
+    if (!pPeripheralManager) {
+        request->send(503, "application/json", "{\"error\":\"Peripheral manager not available\"}");
+        return;
+    }
+
+    auto& uart1 = pPeripheralManager->getUART1();
+
+    if (WebRequestBody::hasParam(request, "source")) {
+        String name = WebRequestBody::getParam(request, "source");
+        name.toUpperCase();
+
+        UART1Mux::PulseSource source;
+        if (name == "OFF") {
+            source = UART1Mux::PULSE_OFF;
+        } else if (name == "INPUT") {
+            source = UART1Mux::PULSE_INPUT;
+        } else if (name == "LOOPBACK") {
+            source = UART1Mux::PULSE_LOOPBACK;
+        } else {
+            request->send(400, "application/json", "{\"success\":false,\"error\":\"Invalid source\"}");
+            return;
+        }
+
+        if (!uart1.setPulseSource(source)) {
+            request->send(409, "application/json", "{\"success\":false,\"error\":\"Source change refused\"}");
+            return;
+        }
+    }
+
+    if (WebRequestBody::hasParam(request, "reset") && WebRequestBody::getParam(request, "reset") == "true") {
+        uart1.resetPulseStatistics();
+    }
+
+    request->send(200, "application/json", "{\"success\":true}");
+}
+
+void WebServerManager::handleGetSequence(AsyncWebServerRequest *request) {
+    if (!pPeripheralManager) {
+        request->send(503, "application/json", "{\"error\":\"Peripheral manager not available\"}");
+        return;
+    }
+
+    UART1Mux& uart1 = pPeripheralManager->getUART1();
+    UART1Mux::SequenceStatus status = uart1.getSequenceStatus();
+
+    StaticJsonDocument<512> doc;
+    doc["playing"] = status.playing;
+    doc["length"] = status.length;
+    doc["loop_start"] = status.loopStart;
+    doc["repeat"] = status.repeat;
+    doc["index"] = status.index;
+    doc["pass"] = status.pass;
+    doc["steps_played"] = status.stepsPlayed;
+    doc["elapsed_ms"] = status.elapsedMs;
+    doc["duration_ms"] = status.durationMs;
+    doc["results"] = status.results;
+    doc["results_dropped"] = status.resultsDropped;
+    doc["prescaler"] = status.prescaler;
+    doc["worst_ppm"] = status.worstPpm;
+
+    String response;
+    serializeJson(doc, response);
+    request->send(200, "application/json", response);
+}
+
+void WebServerManager::handlePostSequence(AsyncWebServerRequest *request) {
+    // Body is the profile text: "freq_hz,duty_pct,dwell_ms" per line
+    if (!pPeripheralManager) {
+        request->send(503, "application/json", "{\"error\":\"Peripheral manager not available\"}");
+        return;
+    }
+
+    size_t length = 0;
+    const char* text = WebRequestBody::getRaw(request, &length);
+    if (!text || length == 0) {
+        request->send(400, "application/json", "{\"success\":false,\"error\":\"Missing profile text\"}");
+        return;
+    }
+
+    UART1Mux& uart1 = pPeripheralManager->getUART1();
+    if (uart1.isSequencePlaying()) {
+        request->send(409, "application/json", "{\"success\":false,\"error\":\"Sequence is playing\"}");
+        return;
+    }
+
+    size_t errorLine = 0;
+    StaticJsonDocument<128> doc;
+    bool success = uart1.loadSequenceText(text, length, &errorLine);
+    doc["success"] = success;
+    if (success) {
+        doc["length"] = uart1.getSequenceLength();
+        doc["loop_start"] = uart1.getSequenceLoopStart();
+    } else {
+        doc["error"] = "Invalid profile";
+        if (errorLine > 0) {
+            doc["line"] = errorLine;
+        }
+    }
+
+    String response;
+    serializeJson(doc, response);
+    request->send(success ? 200 : 400, "application/json", response);
+}
+
+void WebServerManager::handlePostSequencePlay(AsyncWebServerRequest *request) {
+    if (!pPeripheralManager) {
+        request->send(503, "application/json", "{\"error\":\"Peripheral manager not available\"}");
+        return;
+    }
+
+    UART1Mux& uart1 = pPeripheralManager->getUART1();
+    if (uart1.getMode() != UART1Mux::MODE_PWM_RPM) {
+        request->send(400, "application/json", "{\"error\":\"UART1 not in PWM mode\"}");
+        return;
+    }
+
+    long repeat = 1;
+    if (WebRequestBody::hasParam(request, "repeat")) {
+        repeat = WebRequestBody::getParam(request, "repeat").toInt();
+        if (repeat < 0) {
+            request->send(400, "application/json", "{\"success\":false,\"error\":\"Invalid repeat\"}");
+            return;
+        }
+    }
+
+    if (!uart1.playSequence((uint32_t)repeat)) {
+        request->send(400, "application/json", "{\"success\":false,\"error\":\"Sequence could not start\"}");
+        return;
+    }
+
+    request->send(200, "application/json", "{\"success\":true}");
+    broadcastStatus();
+}
+
+void WebServerManager::handlePostSequenceStop(AsyncWebServerRequest *request) {
+    if (!pPeripheralManager) {
+        request->send(503, "application/json", "{\"error\":\"Peripheral manager not available\"}");
+        return;
+    }
+
+    pPeripheralManager->getUART1().stopSequence();
+    request->send(200, "application/json", "{\"success\":true}");
+    broadcastStatus();
+}
+
+void WebServerManager::handleGetSequenceResult(AsyncWebServerRequest *request) {
+    if (!pPeripheralManager) {
+        request->send(503, "application/json", "{\"error\":\"Peripheral manager not available\"}");
+        return;
+    }
+
+    // Up to MAX_RESULTS lines: stream whole lines per chunk instead of building a String
+    UART1Mux* uart1 = &pPeripheralManager->getUART1();
+    uint32_t total = uart1->getSequenceResultCount();
+    uint32_t next = 0;
+    bool headerSent = false;
+
+    AsyncWebServerResponse *response = request->beginChunkedResponse("text/csv",
+        [uart1, total, next, headerSent](uint8_t *buffer, size_t maxLen, size_t /*index*/) mutable -> size_t {
+            static const size_t LINE_MAX = 96;
+            size_t written = 0;
+            char* out = reinterpret_cast<char*>(buffer);
+
+            if (!headerSent) {
+                if (maxLen < LINE_MAX) {
+                    return RESPONSE_TRY_AGAIN;
+                }
+                written += snprintf(out, maxLen, "index,pass,end_ms,freq_hz,duty_pct,rpm_hz,rpm,flags\n");
+                headerSent = true;
+            }
+
+            while (next < total && maxLen - written >= LINE_MAX) {
+                const PWMSequenceResult* r = uart1->getSequenceResult(next);
+                if (!r) {
+                    next = total;  // Buffer was reset by a new playback
+                    break;
+                }
+                written += snprintf(out + written, maxLen - written, "%u,%u,%u,%u,%.2f,%.2f,%.1f,%u\n",
+                                    r->index, r->pass, r->endMs, r->frequency, r->duty,
+                                    r->rpmFrequency, r->rpm, r->flags);
+                next++;
+            }
+
+            if (written == 0 && next < total) {
+                return RESPONSE_TRY_AGAIN;
+            }
+            return written;
+        });
+    response->addHeader("Content-Disposition", "attachment; filename=\"sequence_result.csv\"");
+    request->send(response);
+}
+
+void WebServerManager::handleGetCharacterize(AsyncWebServerRequest *request) {
+    if (!pPeripheralManager) {
+        request->send(503, "application/json", "{\"error\":\"Peripheral manager not available\"}");
+        return;
+    }
+
+    FanCharacterizer& job = pPeripheralManager->getCharacterizer();
+
+    StaticJsonDocument<512> doc;
+    doc["state"] = job.getStateName();
+    doc["mode"] = job.getModeName();
+    doc["steps"] = job.getStepCount();
+    doc["completed"] = job.getCompletedSteps();
+    doc["dwell_ms"] = job.getDwellMs();
+    doc["elapsed_ms"] = job.getElapsedMs();
+    doc["trace_samples"] = job.getTraceCount();
+    doc["sample_period_ms"] = job.getSamplePeriodMs();
+    doc["message"] = job.getMessage();
+
+    const FanDeadBand& band = job.getDeadBand();
+    if (band.hasStart) {
+        doc["start_duty"] = band.startDuty;
+    }
+    if (band.hasStop) {
+        doc["stop_duty"] = band.stopDuty;
+    }
+
+    String response;
+    serializeJson(doc, response);
+    request->send(200, "application/json", response);
+}
+
+void WebServerManager::handlePostCharacterize(AsyncWebServerRequest *request) {
+    // mode=duty|freq|step, from, to, step / points / cycles, dwell
+    if (!pPeripheralManager) {
+        request->send(503, "application/json", "{\"error\":\"Peripheral manager not available\"}");
+        return;
+    }
+
+    FanCharacterizer& job = pPeripheralManager->getCharacterizer();
+    if (job.isRunning()) {
+        request->send(409, "application/json", "{\"success\":false,\"error\":\"Characterization is running\"}");
+        return;
+    }
+    if (!WebRequestBody::hasParam(request, "mode") || !WebRequestBody::hasParam(request, "from") ||
+        !WebRequestBody::hasParam(request, "to")) {
+        request->send(400, "application/json", "{\"success\":false,\"error\":\"Missing mode/from/to\"}");
+        return;
+    }
+
+    String mode = WebRequestBody::getParam(request, "mode");
+    mode.toLowerCase();
+    float from = WebRequestBody::getParam(request, "from").toFloat();
+    float to = WebRequestBody::getParam(request, "to").toFloat();
+    uint32_t dwellMs = 3000;
+    if (WebRequestBody::hasParam(request, "dwell")) {
+        dwellMs = (uint32_t)WebRequestBody::getParam(request, "dwell").toInt();
+    }
+
+    bool success;
+    if (mode == "duty" && WebRequestBody::hasParam(request, "step")) {
+        success = job.startDutySweep(from, to, WebRequestBody::getParam(request, "step").toFloat(), dwellMs);
+    } else if (mode == "freq" && WebRequestBody::hasParam(request, "points")) {
+        success = job.startFrequencySweep((uint32_t)from, (uint32_t)to,
+                                          (uint32_t)WebRequestBody::getParam(request, "points").toInt(), dwellMs);
+    } else if (mode == "step") {
+        uint32_t cycles = 3;
+        if (WebRequestBody::hasParam(request, "cycles")) {
+            cycles = (uint32_t)WebRequestBody::getParam(request, "cycles").toInt();
+        }
+        success = job.startStep(from, to, cycles, dwellMs);
+    } else {
+        request->send(400, "application/json", "{\"success\":false,\"error\":\"Invalid mode\"}");
+        return;
+    }
+
+    if (!success) {
+        request->send(400, "application/json",
+                      "{\"success\":false,\"error\":\"Characterization could not start\"}");
+        return;
+    }
+
+    StaticJsonDocument<128> doc;
+    doc["success"] = true;
+    doc["steps"] = job.getStepCount();
+    doc["dwell_ms"] = job.getDwellMs();
+
+    String response;
+    serializeJson(doc, response);
+    request->send(200, "application/json", response);
+    broadcastStatus();
+}
+
+void WebServerManager::handlePostCharacterizeStop(AsyncWebServerRequest *request) {
+    if (!pPeripheralManager) {
+        request->send(503, "application/json", "{\"error\":\"Peripheral manager not available\"}");
+        return;
+    }
+
+    pPeripheralManager->getCharacterizer().stop();
+    request->send(200, "application/json", "{\"success\":true}");
+}
+
+void WebServerManager::handleGetCharacterizeResult(AsyncWebServerRequest *request) {
+    if (!pPeripheralManager) {
+        request->send(503, "application/json", "{\"error\":\"Peripheral manager not available\"}");
+        return;
+    }
+
+    FanCharacterizer* job = &pPeripheralManager->getCharacterizer();
+    uint32_t total = job->getCompletedSteps();
+    uint32_t next = 0;
+    bool headerSent = false;
+
+    AsyncWebServerResponse *response = request->beginChunkedResponse("text/csv",
+        [job, total, next, headerSent](uint8_t *buffer, size_t maxLen, size_t /*index*/) mutable -> size_t {
+            static const size_t LINE_MAX = 128;
+            size_t written = 0;
+            char* out = reinterpret_cast<char*>(buffer);
+
+            if (!headerSent) {
+                if (maxLen < LINE_MAX) {
+                    return RESPONSE_TRY_AGAIN;
+                }
+                written += snprintf(out, maxLen, "step,setpoint,dir,initial_rpm,final_rpm,rise_ms,"
+                                    "settle_ms,overshoot_pct,ripple_rpm,settled\n");
+                headerSent = true;
+            }
+
+            while (next < total && maxLen - written >= LINE_MAX) {
+                const FanCharacterizer::Row* row = job->getRow(next);
+                if (!row) {
+                    next = total;  // A new job was started
+                    break;
+                }
+                const FanStepMetrics& m = row->metrics;
+                written += snprintf(out + written, maxLen - written, "%u,%.2f,%s,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%u\n",
+                                    next, row->setpoint, row->rising ? "up" : "down", m.initialRpm,
+                                    m.finalRpm, m.riseMs, m.settleMs, m.overshootPct, m.rippleRpm,
+                                    m.settled ? 1 : 0);
+                next++;
+            }
+
+            if (written == 0 && next < total) {
+                return RESPONSE_TRY_AGAIN;
+            }
+            return written;
+        });
+    response->addHeader("Content-Disposition", "attachment; filename=\"characterize_result.csv\"");
+    request->send(response);
+}
+
+void WebServerManager::handleGetCharacterizeTrace(AsyncWebServerRequest *request) {
+    if (!pPeripheralManager) {
+        request->send(503, "application/json", "{\"error\":\"Peripheral manager not available\"}");
+        return;
+    }
+
+    // Up to MAX_TRACE lines, streamed like the sequence results
+    FanCharacterizer* job = &pPeripheralManager->getCharacterizer();
+    uint32_t total = job->getTraceCount();
+    uint32_t next = 0;
+    bool headerSent = false;
+
+    AsyncWebServerResponse *response = request->beginChunkedResponse("text/csv",
+        [job, total, next, headerSent](uint8_t *buffer, size_t maxLen, size_t /*index*/) mutable -> size_t {
+            static const size_t LINE_MAX = 48;
+            size_t written = 0;
+            char* out = reinterpret_cast<char*>(buffer);
+
+            if (!headerSent) {
+                if (maxLen < LINE_MAX) {
+                    return RESPONSE_TRY_AGAIN;
+                }
+                written += snprintf(out, maxLen, "time_ms,rpm\n");
+                headerSent = true;
+            }
+
+            while (next < total && maxLen - written >= LINE_MAX) {
+                const FanTraceSample* sample = job->getTraceSample(next);
+                if (!sample) {
+                    next = total;  // A new job was started
+                    break;
+                }
+                written += snprintf(out + written, maxLen - written, "%.1f,%.1f\n",
+                                    sample->timeUs / 1000.0f, sample->rpm);
+                next++;
+            }
+
+            if (written == 0 && next < total) {
+                return RESPONSE_TRY_AGAIN;
+            }
+            return written;
+        });
+    response->addHeader("Content-Disposition", "attachment; filename=\"characterize_trace.csv\"");
+    request->send(response);
+}
+
+void WebServerManager::handleGetCapture(AsyncWebServerRequest *request) {
+    if (!pPeripheralManager) {
+        request->send(503, "application/json", "{\"error\":\"Peripheral manager not available\"}");
+        return;
+    }
+
+    LogicCapture& capture = pPeripheralManager->getLogicCapture();
+
+    StaticJsonDocument<768> doc;
+    doc["state"] = capture.getStateName();
+    doc["trigger"] = capture.getTriggerName();
+    doc["min_us"] = capture.getTriggerMinUs();
+    doc["max_us"] = capture.getTriggerMaxUs();
+    doc["gap_us"] = capture.getTriggerGapUs();
+    doc["pre"] = capture.getPreTrigger();
+    doc["capacity"] = capture.getCapacity();
+    doc["psram"] = capture.isInPSRAM();
+    doc["unit"] = capture.getLimit() == LogicCapture::LIMIT_EDGES ? "edges" : "ms";
+    doc["amount"] = capture.getAmount();
+    doc["elapsed_ms"] = capture.getElapsedMs();
+    doc["seen"] = capture.getSeenCount();
+    doc["edges"] = capture.getEdgeCount();
+    doc["pre_edges"] = capture.getPreTriggerCount();
+    doc["drops"] = capture.getDropCount();
+    if (!capture.isRunning()) {
+        doc["duration_ms"] = capture.getDurationMs();
+    }
+    doc["message"] = capture.getMessage();
+
+    String response;
+    serializeJson(doc, response);
+    request->send(200, "application/json", response);
+}
+
+void WebServerManager::handlePostCapture(AsyncWebServerRequest *request) {
+    // trigger=none|period|gap, min_us, max_us, gap_us, pre, amount, unit=edges|ms
+    if (!pPeripheralManager) {
+        request->send(503, "application/json", "{\"error\":\"Peripheral manager not available\"}");
+        return;
+    }
+
+    LogicCapture& capture = pPeripheralManager->getLogicCapture();
+    if (capture.isRunning()) {
+        request->send(409, "application/json", "{\"success\":false,\"error\":\"Capture is running\"}");
+        return;
+    }
+
+    if (WebRequestBody::hasParam(request, "trigger")) {
+        String trigger = WebRequestBody::getParam(request, "trigger");
+        trigger.toLowerCase();
+
+        bool ok;
+        if (trigger == "none") {
+            ok = capture.setNoTrigger();
+        } else if (trigger == "period" && WebRequestBody::hasParam(request, "min_us") &&
+                   WebRequestBody::hasParam(request, "max_us")) {
+            long minUs = WebRequestBody::getParam(request, "min_us").toInt();
+            long maxUs = WebRequestBody::getParam(request, "max_us").toInt();
+            ok = minUs >= 0 && maxUs >= 0 && capture.setPeriodTrigger((uint32_t)minUs, (uint32_t)maxUs);
+        } else if (trigger == "gap" && WebRequestBody::hasParam(request, "gap_us")) {
+            long gapUs = WebRequestBody::getParam(request, "gap_us").toInt();
+            ok = gapUs > 0 && capture.setGapTrigger((uint32_t)gapUs);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            request->send(400, "application/json", "{\"success\":false,\"error\":\"Invalid trigger\"}");
+            return;
+        }
+    }
+
+    if (WebRequestBody::hasParam(request, "pre")) {
+        long pre = WebRequestBody::getParam(request, "pre").toInt();
+        if (pre < 0 || !capture.setPreTrigger((uint32_t)pre)) {
+            request->send(400, "application/json", "{\"success\":false,\"error\":\"Invalid pre-trigger\"}");
+            return;
+        }
+    }
+
+    if (WebRequestBody::hasParam(request, "amount")) {
+        LogicCapture::Limit limit = LogicCapture::LIMIT_EDGES;
+        if (WebRequestBody::hasParam(request, "unit")) {
+            String unit = WebRequestBody::getParam(request, "unit");
+            unit.toLowerCase();
+            if (unit == "ms") {
+                limit = LogicCapture::LIMIT_TIME;
+            } else if (unit != "edges") {
+                request->send(400, "application/json", "{\"success\":false,\"error\":\"Invalid unit\"}");
+                return;
+            }
+        }
+
+        long amount = WebRequestBody::getParam(request, "amount").toInt();
+        if (amount <= 0 || !capture.start((uint32_t)amount, limit)) {
+            request->send(400, "application/json", "{\"success\":false,\"error\":\"Capture could not start\"}");
+            return;
+        }
+    }
+
+    StaticJsonDocument<128> doc;
+    doc["success"] = true;
+    doc["state"] = capture.getStateName();
+    doc["capacity"] = capture.getCapacity();
+
+    String response;
+    serializeJson(doc, response);
+    request->send(200, "application/json", response);
+}
+
+void WebServerManager::handlePostCaptureStop(AsyncWebServerRequest *request) {
+    if (!pPeripheralManager) {
+        request->send(503, "application/json", "{\"error\":\"Peripheral manager not available\"}");
+        return;
+    }
+
+    pPeripheralManager->getLogicCapture().stop();
+    request->send(200, "application/json", "{\"success\":true}");
+}
+
+void WebServerManager::handleGetCaptureData(AsyncWebServerRequest *request, LogicCapture::Format format) {
+    if (!pPeripheralManager) {
+        request->send(503, "application/json", "{\"error\":\"Peripheral manager not available\"}");
+        return;
+    }
+
+    LogicCapture* capture = &pPeripheralManager->getLogicCapture();
+    if (capture->isRunning()) {
+        request->send(409, "application/json", "{\"error\":\"Capture is running\"}");
+        return;
+    }
+    if (!capture->hasData()) {
+        request->send(404, "application/json", "{\"error\":\"No capture data\"}");
+        return;
+    }
+
+    // Millions of edges: streamed straight from the capture buffer
+    LogicCapture::ExportCursor cursor;
+    AsyncWebServerResponse *response = request->beginChunkedResponse(
+        format == LogicCapture::FORMAT_VCD ? "text/plain" : "text/csv",
+        [capture, format, cursor](uint8_t *buffer, size_t maxLen, size_t /*index*/) mutable -> size_t {
+            if (capture->isExportDone(cursor)) {
+                return 0;
+            }
+            size_t written = capture->exportChunk(format, cursor, reinterpret_cast<char*>(buffer), maxLen);
+            if (written == 0 && !capture->isExportDone(cursor)) {
+                return RESPONSE_TRY_AGAIN;  // Not enough room for the next line
+            }
+            return written;
+        });
+    response->addHeader("Content-Disposition", format == LogicCapture::FORMAT_VCD ?
+                        "attachment; filename=\"capture.vcd\"" : "attachment; filename=\"capture.csv\"");
+    request->send(response);
+}
+
+void WebServerManager::handleGetFans(AsyncWebServerRequest *request) {
+    if (!pPeripheralManager) {
+        request->send(503, "application/json", "{\"error\":\"Peripheral manager not available\"}");
+        return;
+    }
+
+    FanBank& fans = pPeripheralManager->getFans();
+
+    StaticJsonDocument<3072> doc;
+    JsonArray array = doc.createNestedArray("fans");
+    for (uint8_t ch = 1; ch <= fans.getChannelCount(); ch++) {
+        FanBank::ChannelInfo info;
+        fans.getInfo(ch, info);
+        const RPMFilter* filter = fans.getRPMFilter(ch);
+
+        JsonObject fan = array.createNestedObject();
+        fan["ch"] = ch;
+        fan["pwm_pin"] = info.pwmPin;
+        fan["tach_pin"] = info.tachPin;
+        fan["pwm_driver"] = FanBank::getPWMDriverName(info.pwmDriver);
+        fan["tach_driver"] = FanBank::getTachDriverName(info.tachDriver);
+        fan["enabled"] = info.enabled;
+        fan["freq"] = info.frequency;
+        fan["duty"] = info.duty;
+        fan["poles"] = info.polePairs;
+        fan["tach_freq"] = info.tachFrequency;
+        fan["rpm"] = info.rpm;
+        fan["filter"] = RPMFilter::getFilterName(filter->getFilterType());
+        fan["filter_size"] = filter->getWindowSize();
+        fan["stall"] = info.stallEnabled;
+        fan["stall_periods"] = info.stallPeriods;
+        fan["stall_actions"] = info.stallActions;
+        fan["stall_timeout_us"] = info.stallTimeoutUs;
+        fan["stalled"] = info.stalled;
+        fan["stall_count"] = info.stallCount;
+        fan["capture_drops"] = info.captureDrops;
+    }
+
+    String response;
+    serializeJson(doc, response);
+    request->send(200, "application/json", response);
+}
+
+void WebServerManager::handlePostFans(AsyncWebServerRequest *request) {
+    // ch (1-based), then any of freq, duty, poles, filter, filter_size, stall,
+    // stall_periods, stall_actions (bits: 1=CUT, 2=BEEP, 4=NOTIFY), enabled
+    // (applied last, so the channel starts with the values of the same request)
+    if (!pPeripheralManager) {
+        request->send(503, "application/json", "{\"error\":\"Peripheral manager not available\"}");
+        return;
+    }
+
+    FanBank& fans = pPeripheralManager->getFans();
+    uint8_t ch = WebRequestBody::hasParam(request, "ch") ? WebRequestBody::getParam(request, "ch").toInt() : 0;
+    if (!fans.isValidChannel(ch)) {
+        request->send(400, "application/json", "{\"success\":false,\"error\":\"Invalid channel\"}");
+        return;
+    }
+
+    bool success = true;
+    String message;
+
+    if (WebRequestBody::hasParam(request, "freq")) {
+        if (!fans.setFrequency(ch, WebRequestBody::getParam(request, "freq").toInt())) {
+            success = false;
+            message = "Invalid frequency";
+        }
+    }
+
+    if (success && WebRequestBody::hasParam(request, "duty")) {
+        if (!fans.setDuty(ch, WebRequestBody::getParam(request, "duty").toFloat())) {
+            success = false;
+            message = "Invalid duty cycle";
+        }
+    }
+
+    if (success && WebRequestBody::hasParam(request, "poles")) {
+        if (!fans.setPolePairs(ch, WebRequestBody::getParam(request, "poles").toInt())) {
+            success = false;
+            message = "Invalid pole pairs";
+        }
+    }
+
+    if (success && WebRequestBody::hasParam(request, "filter")) {
+        String name = WebRequestBody::getParam(request, "filter");
+        name.toUpperCase();
+        bool found = false;
+        for (uint8_t t = RPMFilter::FILTER_NONE; t <= RPMFilter::FILTER_WINDOW; t++) {
+            if (name == RPMFilter::getFilterName((RPMFilter::FilterType)t)) {
+                found = fans.setFilterType(ch, (RPMFilter::FilterType)t);
+                break;
+            }
+        }
+        if (!found) {
+            success = false;
+            message = "Invalid filter";
+        }
+    }
+
+    if (success && WebRequestBody::hasParam(request, "filter_size")) {
+        if (!fans.setFilterWindow(ch, WebRequestBody::getParam(request, "filter_size").toInt())) {
+            success = false;
+            message = "Invalid filter size";
+        }
+    }
+
+    if (success && WebRequestBody::hasParam(request, "stall_periods")) {
+        if (!fans.setStallPeriods(ch, WebRequestBody::getParam(request, "stall_periods").toInt())) {
+            success = false;
+            message = "Invalid stall periods";
+        }
+    }
+
+    if (success && WebRequestBody::hasParam(request, "stall_actions")) {
+        fans.setStallActions(ch, WebRequestBody::getParam(request, "stall_actions").toInt());
+    }
+
+    if (success && WebRequestBody::hasParam(request, "stall")) {
+        fans.setStallDetection(ch, WebRequestBody::getParam(request, "stall") == "true");
+    }
+
+    if (success && WebRequestBody::hasParam(request, "enabled")) {
+        if (!fans.setEnabled(ch, WebRequestBody::getParam(request, "enabled") == "true")) {
+            success = false;
+            message = "Channel failed to start";
+        }
+    }
+
+    StaticJsonDocument<128> doc;
+    doc["success"] = success;
+    if (!success) {
+        doc["error"] = message;
+    }
+
+    String response;
+    serializeJson(doc, response);
+    request->send(success ? 200 : 400, "application/json", response);
+}
+
 void WebServerManager::handleGetUART2Status(AsyncWebServerRequest *request) {
     if (!pPeripheralManager) {
         request->send(503, "application/json", "{\"error\":\"Peripheral manager not available\"}");
         return;
     }
 
-    StaticJsonDocument<256> doc;
-    doc["baud"] = pPeripheralManager->getUART2().getBaudRate();
+    auto& uart2 = pPeripheralManager->getUART2();
+
+    StaticJsonDocument<512> doc;
+    doc["baud"] = uart2.getBaudRate();
 
     uint32_t tx, rx, err;
-    pPeripheralManager->getUART2().getStatistics(&tx, &rx, &err);
+    uart2.getStatistics(&tx, &rx, &err);
     doc["tx_bytes"] = tx;
     doc["rx_bytes"] = rx;
     doc["errors"] = err;
 
+    JsonObject frames = doc.createNestedObject("frames");
+    frames["mode"] = UART2Manager::getFrameModeName(uart2.getFrameMode());
+    frames["delimiter"] = uart2.getFrameDelimiter();
+    UART2Manager::FrameStatistics stats = uart2.getFrameStatistics();
+    frames["count"] = stats.frames;
+    frames["split"] = stats.splitFrames;
+    frames["dropped"] = stats.droppedFrames;
+    frames["dropped_bytes"] = stats.droppedBytes;
+    frames["rx_overflows"] = stats.rxOverflows;
+    frames["ring_size"] = uart2.getFrameRingSize();
+    frames["ring_used"] = uart2.getFrameRingUsed();
+
     String response;
     serializeJson(doc, response);
     request->send(200, "application/json", response);
 }
 
+void WebServerManager::handleGetSniffer(AsyncWebServerRequest *request) {
+    if (!pPeripheralManager) {
+        request->send(503, "application/json", "{\"error\":\"Peripheral manager not available\"}");
+        return;
+    }
+
+    UARTSniffer& sniffer = pPeripheralManager->getSniffer();
+    UARTSniffer::Statistics stats = sniffer.getStatistics();
+
+    StaticJsonDocument<512> doc;
+    doc["running"] = sniffer.isRunning();
+    doc["ports"] = UARTSniffer::getPortsName(sniffer.getPorts());
+    doc["monitor"] = sniffer.isMonitor();
+    doc["live_tail"] = sniffer.isLiveTail();
+    doc["elapsed_ms"] = sniffer.getElapsedMs();
+    doc["capacity"] = sniffer.getCapacity();
+    doc["used"] = sniffer.getUsed();
+    doc["psram"] = sniffer.isInPSRAM();
+    doc["records"] = stats.records;
+    doc["overwritten"] = stats.overwritten;
+    doc["lock_misses"] = stats.lockMisses;
+    doc["uart1_tx"] = stats.txBytes[0];
+    doc["uart1_rx"] = stats.rxBytes[0];
+    doc["uart2_tx"] = stats.txBytes[1];
+    doc["uart2_rx"] = stats.rxBytes[1];
+
+    String response;
+    serializeJson(doc, response);
+    request->send(200, "application/json", response);
+}
+
+void WebServerManager::handleGetUARTCapture(AsyncWebServerRequest *request) {
+    if (!pPeripheralManager) {
+        request->send(503, "application/json", "{\"error\":\"Peripheral manager not available\"}");
+        return;
+    }
+
+    UARTSniffer* sniffer = &pPeripheralManager->getSniffer();
+    if (!sniffer->hasData()) {
+        request->send(404, "application/json", "{\"error\":\"No capture data\"}");
+        return;
+    }
+
+    UARTSniffer::Format format = UARTSniffer::FORMAT_BINARY;
+    if (request->hasParam("format")) {
+        String name = request->getParam("format")->value();
+        if (name == "pcap") {
+            format = UARTSniffer::FORMAT_PCAP;
+        } else if (name != "bin") {
+            request->send(400, "application/json", "{\"error\":\"format must be bin or pcap\"}");
+            return;
+        }
+    }
+
+    // Up to the ring size: streamed from PSRAM, the capture may keep running meanwhile
+    UARTSniffer::Cursor cursor;
+    AsyncWebServerResponse *response = request->beginChunkedResponse(
+        format == UARTSniffer::FORMAT_PCAP ? "application/vnd.tcpdump.pcap" : "application/octet-stream",
+        [sniffer, format, cursor](uint8_t *buffer, size_t maxLen, size_t /*index*/) mutable -> size_t {
+            if (sniffer->isExportDone(cursor)) {
+                return 0;
+            }
+            size_t written = sniffer->exportChunk(format, cursor, buffer, maxLen);
+            if (written == 0 && !sniffer->isExportDone(cursor)) {
+                return RESPONSE_TRY_AGAIN;  // Not enough room for the next record
+            }
+            return written;
+        });
+    response->addHeader("Content-Disposition", format == UARTSniffer::FORMAT_PCAP ?
+                        "attachment; filename=\"uart_capture.pcap\"" : "attachment; filename=\"uart_capture.bin\"");
+    request->send(response);
+}
+
 void WebServerManager::handlePostBuzzer(AsyncWebServerRequest *request) {
     if (!pPeripheralManager) {
         request->send(503, "application/json", "{\"error\":\"Peripheral manager not available\"}");
@@ -201,35 +1019,35 @@ void WebServerManager::handlePostBuzzer(AsyncWebServerRequest *request) {
     bool success = true;
     String message = "Buzzer updated";
 
-    if (request->hasParam("frequency", true)) {
-        uint32_t freq = request->getParam("frequency", true)->value().toInt();
+    if (WebRequestBody::hasParam(request, "frequency")) {
+        uint32_t freq = WebRequestBody::getParam(request, "frequency").toInt();
         if (!pPeripheralManager->getBuzzer().setFrequency(freq)) {
             success = false;
             message = "Invalid frequency (10-20000 Hz)";
         }
     }
 
-    if (success && request->hasParam("duty", true)) {
-        float duty = request->getParam("duty", true)->value().toFloat();
+    if (success && WebRequestBody::hasParam(request, "duty")) {
+        float duty = WebRequestBody::getParam(request, "duty").toFloat();
         if (!pPeripheralManager->getBuzzer().setDuty(duty)) {
             success = false;
             message = "Invalid duty cycle (0-100%)";
         }
     }
 
-    if (success && request->hasParam("enabled", true)) {
-        bool enabled = request->getParam("enabled", true)->value() == "true";
+    if (success && WebRequestBody::hasParam(request, "enabled")) {
+        bool enabled = WebRequestBody::getParam(request, "enabled") == "true";
         pPeripheralManager->getBuzzer().enable(enabled);
     }
 
     // Handle beep command
-    if (success && request->hasParam("beep", true)) {
-        uint32_t freq = request->hasParam("beep_freq", true) ?
-                        request->getParam("beep_freq", true)->value().toInt() : 2000;
-        uint32_t duration = request->hasParam("beep_duration", true) ?
-                            request->getParam("beep_duration", true)->value().toInt() : 100;
-        float duty = request->hasParam("beep_duty", true) ?
-                     request->getParam("beep_duty", true)->value().toFloat() : 50.0;
+    if (success && WebRequestBody::hasParam(request, "beep")) {
+        uint32_t freq = WebRequestBody::hasParam(request, "beep_freq") ?
+                        WebRequestBody::getParam(request, "beep_freq").toInt() : 2000;
+        uint32_t duration = WebRequestBody::hasParam(request, "beep_duration") ?
+                            WebRequestBody::getParam(request, "beep_duration").toInt() : 100;
+        float duty = WebRequestBody::hasParam(request, "beep_duty") ?
+                     WebRequestBody::getParam(request, "beep_duty").toFloat() : 50.0;
         pPeripheralManager->getBuzzer().beep(freq, duration, duty);
         message = "Beep executed";
     }
@@ -255,24 +1073,24 @@ void WebServerManager::handlePostLEDPWM(AsyncWebServerRequest *request) {
     bool success = true;
     String message = "LED updated";
 
-    if (request->hasParam("frequency", true)) {
-        uint32_t freq = request->getParam("frequency", true)->value().toInt();
+    if (WebRequestBody::hasParam(request, "frequency")) {
+        uint32_t freq = WebRequestBody::getParam(request, "frequency").toInt();
         if (!pPeripheralManager->getLEDPWM().setFrequency(freq)) {
             success = false;
             message = "Invalid frequency (100-20000 Hz)";
         }
     }
 
-    if (success && request->hasParam("brightness", true)) {
-        float brightness = request->getParam("brightness", true)->value().toFloat();
+    if (success && WebRequestBody::hasParam(request, "brightness")) {
+        float brightness = WebRequestBody::getParam(request, "brightness").toFloat();
         if (!pPeripheralManager->getLEDPWM().setBrightness(brightness)) {
             success = false;
             message = "Invalid brightness (0-100%)";
         }
     }
 
-    if (success && request->hasParam("enabled", true)) {
-        bool enabled = request->getParam("enabled", true)->value() == "true";
+    if (success && WebRequestBody::hasParam(request, "enabled")) {
+        bool enabled = WebRequestBody::getParam(request, "enabled") == "true";
         pPeripheralManager->getLEDPWM().enable(enabled);
     }
 
@@ -294,12 +1112,12 @@ void WebServerManager::handlePostRelay(AsyncWebServerRequest *request) {
         return;
     }
 
-    if (!request->hasParam("state", true)) {
+    if (!WebRequestBody::hasParam(request, "state")) {
         request->send(400, "application/json", "{\"error\":\"Missing 'state' parameter\"}");
         return;
     }
 
-    String state = request->getParam("state", true)->value();
+    String state = WebRequestBody::getParam(request, "state");
     state.toLowerCase();
 
     if (state == "on" || state == "true" || state == "1") {
@@ -328,12 +1146,12 @@ void WebServerManager::handlePostGPIO(AsyncWebServerRequest *request) {
         return;
     }
 
-    if (!request->hasParam("state", true)) {
+    if (!WebRequestBody::hasParam(request, "state")) {
         request->send(400, "application/json", "{\"error\":\"Missing 'state' parameter\"}");
         return;
     }
 
-    String state = request->getParam("state", true)->value();
+    String state = WebRequestBody::getParam(request, "state");
     state.toLowerCase();
 
     if (state == "high" || state == "true" || state == "1") {
@@ -356,6 +1174,220 @@ void WebServerManager::handlePostGPIO(AsyncWebServerRequest *request) {
     request->send(200, "application/json", response);
 }
 
+void WebServerManager::handleGetPattern(AsyncWebServerRequest *request) {
+    if (!pPeripheralManager) {
+        request->send(503, "application/json", "{\"error\":\"Peripheral manager not available\"}");
+        return;
+    }
+
+    PatternGenerator& pattern = pPeripheralManager->getPattern();
+
+    StaticJsonDocument<512> doc;
+    doc["state"] = pattern.getStateName();
+    doc["pin"] = PatternGenerator::getOutputName(pattern.getOutput());
+    doc["loops"] = pattern.getLoops();
+    doc["loops_done"] = pattern.getLoopsDone();
+    doc["hw_loop"] = pattern.isHardwareLoop();
+    doc["segments"] = pattern.getSegmentCount();
+    doc["symbols"] = pattern.getSymbolCount();
+    doc["duration_us"] = pattern.getDurationUs();
+    doc["res_ns"] = pattern.getResolutionNs();
+    doc["capacity"] = pattern.getCapacity();
+    doc["psram"] = pattern.isInPSRAM();
+    doc["message"] = pattern.getMessage();
+
+    String response;
+    serializeJson(doc, response);
+    request->send(200, "application/json", response);
+}
+
+void WebServerManager::handlePostPattern(AsyncWebServerRequest *request) {
+    // res_ns, append, segments="1:2.5us 0:500ns", high+low[+count], bits+bit_time, pin=41|12 (plays), loops (0 = forever)
+    if (!pPeripheralManager) {
+        request->send(503, "application/json", "{\"error\":\"Peripheral manager not available\"}");
+        return;
+    }
+
+    PatternGenerator& pattern = pPeripheralManager->getPattern();
+    if (pattern.isPlaying()) {
+        request->send(409, "application/json", "{\"success\":false,\"error\":\"Pattern is playing\"}");
+        return;
+    }
+
+    bool hasContent = WebRequestBody::hasParam(request, "segments") || WebRequestBody::hasParam(request, "high") ||
+                      WebRequestBody::hasParam(request, "bits");
+    bool append = WebRequestBody::hasParam(request, "append") &&
+                  WebRequestBody::getParam(request, "append") == "true";
+    if (hasContent && !append) {
+        pattern.clear();
+    }
+
+    if (WebRequestBody::hasParam(request, "res_ns") &&
+        !pattern.setResolution(WebRequestBody::getParam(request, "res_ns").toFloat())) {
+        request->send(400, "application/json",
+                      "{\"success\":false,\"error\":\"Invalid resolution (multiple of 12.5 ns, pattern must be empty)\"}");
+        return;
+    }
+
+    if (WebRequestBody::hasParam(request, "segments")) {
+        String error;
+        if (!pattern.addSegments(WebRequestBody::getParam(request, "segments").c_str(), error)) {
+            StaticJsonDocument<256> doc;
+            doc["success"] = false;
+            doc["error"] = error;
+            String response;
+            serializeJson(doc, response);
+            request->send(400, "application/json", response);
+            return;
+        }
+    }
+
+    if (WebRequestBody::hasParam(request, "high")) {
+        uint32_t high, low;
+        long count = WebRequestBody::hasParam(request, "count") ? WebRequestBody::getParam(request, "count").toInt() : 1;
+        if (!WebRequestBody::hasParam(request, "low") ||
+            !pattern.durationToTicks(WebRequestBody::getParam(request, "high").c_str(), high) ||
+            !pattern.durationToTicks(WebRequestBody::getParam(request, "low").c_str(), low) ||
+            count < 1 || !pattern.addPulses(high, low, (uint32_t)count)) {
+            request->send(400, "application/json", "{\"success\":false,\"error\":\"Invalid pulses\"}");
+            return;
+        }
+    }
+
+    if (WebRequestBody::hasParam(request, "bits")) {
+        uint32_t bitTicks;
+        if (!WebRequestBody::hasParam(request, "bit_time") ||
+            !pattern.durationToTicks(WebRequestBody::getParam(request, "bit_time").c_str(), bitTicks) ||
+            !pattern.addBits(WebRequestBody::getParam(request, "bits").c_str(), bitTicks)) {
+            request->send(400, "application/json", "{\"success\":false,\"error\":\"Invalid bits\"}");
+            return;
+        }
+    }
+
+    if (WebRequestBody::hasParam(request, "pin")) {
+        PatternGenerator::Output output;
+        long loops = WebRequestBody::hasParam(request, "loops") ? WebRequestBody::getParam(request, "loops").toInt() : 1;
+        if (!PatternGenerator::parseOutput(WebRequestBody::getParam(request, "pin"), output) ||
+            loops < 0 || (uint32_t)loops > PatternGenerator::MAX_LOOPS) {
+            request->send(400, "application/json", "{\"success\":false,\"error\":\"Invalid pin or loops\"}");
+            return;
+        }
+        if (!pattern.play(output, (uint32_t)loops)) {
+            request->send(400, "application/json", "{\"success\":false,\"error\":\"Pattern could not start\"}");
+            return;
+        }
+    }
+
+    StaticJsonDocument<192> doc;
+    doc["success"] = true;
+    doc["state"] = pattern.getStateName();
+    doc["segments"] = pattern.getSegmentCount();
+    doc["duration_us"] = pattern.getDurationUs();
+    doc["hw_loop"] = pattern.isHardwareLoop();
+
+    String response;
+    serializeJson(doc, response);
+    request->send(200, "application/json", response);
+}
+
+void WebServerManager::handlePostPatternStop(AsyncWebServerRequest *request) {
+    if (!pPeripheralManager) {
+        request->send(503, "application/json", "{\"error\":\"Peripheral manager not available\"}");
+        return;
+    }
+
+    pPeripheralManager->getPattern().stop();
+    request->send(200, "application/json", "{\"success\":true}");
+}
+
+void WebServerManager::handleGetPresets(AsyncWebServerRequest *request) {
+    if (!pPeripheralManager) {
+        request->send(503, "application/json", "{\"error\":\"Peripheral manager not available\"}");
+        return;
+    }
+
+    OperatingPresets& presets = pPeripheralManager->getPresets();
+    const OperatingPresets::Statistics& stats = presets.getStatistics();
+
+    StaticJsonDocument<3072> doc;
+    doc["active"] = presets.getActive();
+    doc["recalls"] = stats.recalls;
+    doc["prescaler_changes"] = stats.prescalerChanges;
+    doc["last_recall_us"] = stats.lastRecallUs;
+    doc["max_recall_us"] = stats.maxRecallUs;
+    JsonArray array = doc.createNestedArray("presets");
+    for (uint8_t i = 1; i <= OperatingPresets::MAX_PRESETS; i++) {
+        const OperatingPresets::Preset* preset = presets.get(i);
+        if (!preset) {
+            continue;
+        }
+        JsonObject item = array.createNestedObject();
+        item["index"] = i;
+        item["name"] = preset->name;
+        item["freq"] = preset->pwm.frequency;
+        item["actual_freq"] = preset->pwm.synth.frequency;
+        item["duty"] = preset->pwm.duty;
+        item["led"] = preset->ledBrightness;
+        item["led_enabled"] = preset->ledEnabled;
+        item["relay"] = preset->relay;
+        item["prescaler"] = preset->pwm.prescaler;
+        item["period"] = preset->pwm.period;
+        item["compare"] = preset->pwm.compare;
+        item["prescaler_conflicts"] = presets.getPrescalerConflicts(i);   // Bit n-1 = preset n
+    }
+
+    String response;
+    serializeJson(doc, response);
+    request->send(200, "application/json", response);
+}
+
+void WebServerManager::handlePostPreset(AsyncWebServerRequest *request) {
+    // index=1-8 recalls; save=true [name] stores the current state instead
+    if (!pPeripheralManager) {
+        request->send(503, "application/json", "{\"error\":\"Peripheral manager not available\"}");
+        return;
+    }
+    if (!WebRequestBody::hasParam(request, "index")) {
+        request->send(400, "application/json", "{\"success\":false,\"error\":\"Missing index parameter\"}");
+        return;
+    }
+
+    OperatingPresets& presets = pPeripheralManager->getPresets();
+    int index = WebRequestBody::getParam(request, "index").toInt();
+    if (index < 1 || index > OperatingPresets::MAX_PRESETS) {
+        request->send(400, "application/json", "{\"success\":false,\"error\":\"index must be 1-8\"}");
+        return;
+    }
+
+    bool save = WebRequestBody::hasParam(request, "save") &&
+                WebRequestBody::getParam(request, "save") == "true";
+    String error;
+    bool prescalerChanged = false;
+    bool ok;
+    if (save) {
+        String name = WebRequestBody::hasParam(request, "name") ? WebRequestBody::getParam(request, "name") : "";
+        ok = presets.saveCurrent(index, name.c_str(), error);
+    } else {
+        ok = presets.recall(index, error, &prescalerChanged);
+    }
+
+    StaticJsonDocument<256> doc;
+    doc["success"] = ok;
+    if (!ok) {
+        doc["error"] = error;
+    } else if (save) {
+        doc["prescaler_conflicts"] = presets.getPrescalerConflicts(index);
+    } else {
+        doc["prescaler_changed"] = prescalerChanged;
+        doc["recall_us"] = presets.getStatistics().lastRecallUs;
+        broadcastStatus();
+    }
+
+    String response;
+    serializeJson(doc, response);
+    request->send(ok ? 200 : 400, "application/json", response);
+}
+
 void WebServerManager::handleGetKeys(AsyncWebServerRequest *request) {
     if (!pPeripheralManager) {
         request->send(503, "application/json", "{\"error\":\"Peripheral manager not available\"}");
@@ -12,6 +12,8 @@
 #include "WiFiManager.h"
 #include "WebServer.h"
 #include "PeripheralManager.h"
+#include "UARTBridge.h"
+#include "HIDDataChannel.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
@@ -92,6 +94,12 @@ WebServerManager webServerManager;
 // Peripheral Manager instance
 PeripheralManager peripheralManager;
 
+// USB-CDC ↔ UART 透明橋接（BRIDGE 命令）
+UARTBridge uartBridge(USBSerial);
+
+// HID 資料報告 (0xA0) ↔ UART 通道（HIDUART 命令）
+HIDDataChannel hidChannel(HID);
+
 // BLE Server Callbacks
 class MyServerCallbacks: public BLEServerCallbacks {
     void onConnect(BLEServer* pServer) {
@@ -152,6 +160,12 @@ class MyRxCallbacks: public BLECharacteristicCallbacks {
 
 // HID 資料接收回調函數（在 ISR 上下文中執行）
 void onHIDData(const uint8_t* data, uint16_t len) {
+    // 資料通道啟動時，0xA0 報告直接送往 UART，不經過命令處理
+    if (len > 0 && data[0] == HIDProtocol::TYPE_DATA && hidChannel.isActive()) {
+        hidChannel.receiveFromISR(data, len);
+        return;
+    }
+
     if (len <= 64) {
         // 準備資料包
         HIDDataPacket packet;
@@ -354,8 +368,9 @@ void wifiTask(void* parameter) {
             lastWiFiUpdate = now;
         }
 
-        // Update web server (WebSocket broadcasts, cleanup)
-        if (now - lastWebUpdate >= pdMS_TO_TICKS(200)) {  // Every 200ms (5 Hz)
+        // Update web server (WebSocket broadcasts, SSE telemetry, cleanup)
+        // Broadcast rates are gated inside update(); run it every loop so SSE can go down to 50ms
+        if (now - lastWebUpdate >= pdMS_TO_TICKS(50)) {
             if (webServerManager.isRunning()) {
                 webServerManager.update();
             }
@@ -381,19 +396,80 @@ void peripheralTask(void* parameter) {
     }
 }
 
+// 失速事件通知（channel < 0 表示 UART1 通道）
+static void reportStall(int channel, const UART1Mux::StallEvent& event) {
+    if (event.actions & UART1Mux::STALL_ACTION_NOTIFY) {
+        // 機器可解析的事件行，送往 CDC/HID/BLE
+        char chField[12] = "";
+        if (channel >= 0) {
+            snprintf(chField, sizeof(chField), " ch=%d", channel);
+        }
+        char line[176];
+        snprintf(line, sizeof(line),
+                 "EVENT STALL%s seq=%u detect_us=%u timeout_us=%u rpm=%.0f duty=%.1f pwm_cut=%u",
+                 chField, event.sequence, event.detectUs, event.timeoutUs, event.lastRpm, event.duty,
+                 (event.actions & UART1Mux::STALL_ACTION_CUT_PWM) ? 1 : 0);
+        if (multi_response) {
+            multi_response->println(line);
+        }
+        if (ble_response) {
+            ble_response->println(line);
+        }
+        if (webServerManager.isRunning()) {
+            webServerManager.broadcastStall(event, channel);
+        }
+    }
+
+    // 最後才響蜂鳴器（beep 會阻塞）
+    if (event.actions & UART1Mux::STALL_ACTION_BEEP) {
+        peripheralManager.getBuzzer().beep(3000, 300);
+    }
+}
+
+// 風扇失速回調（在 RPM_Stall task 中執行）
+void onFanStall(const UART1Mux::StallEvent& event, void* arg) {
+    reportStall(-1, event);
+}
+
+// 多通道風扇失速回調（在 Fan_Bank task 中執行）
+void onFanBankStall(uint8_t channel, const UART1Mux::StallEvent& event, void* arg) {
+    reportStall(channel, event);
+}
+
+// UART2 封包串流回調（在 UART2_Packet task 中執行）
+void onPacket(const PacketLink::Packet& packet, void* arg) {
+    static const char HEX_DIGITS[] = "0123456789ABCDEF";
+    static char line[48 + 2 * PacketLink::MAX_PAYLOAD];
+
+    // 機器可解析的事件行，送往 CDC/HID/BLE
+    int pos = snprintf(line, sizeof(line), "EVENT PKT seq=%u len=%u data=",
+                       packet.seq, (unsigned)packet.length);
+    for (size_t i = 0; i < packet.length && pos + 3 < (int)sizeof(line); i++) {
+        line[pos++] = HEX_DIGITS[packet.data[i] >> 4];
+        line[pos++] = HEX_DIGITS[packet.data[i] & 0x0F];
+    }
+    line[pos] = '\0';
+
+    if (multi_response) {
+        multi_response->println(line);
+    }
+    if (ble_response) {
+        ble_response->println(line);
+    }
+    if (webServerManager.isRunning()) {
+        webServerManager.broadcastPacket(packet);
+    }
+}
+
 // Peripheral 處理 Task (migrated from motorTask)
 void motorTask(void* parameter) {
-    TickType_t lastRPMUpdate = 0;
     TickType_t lastLEDUpdate = 0;
 
     while (true) {
         TickType_t now = xTaskGetTickCount();
 
-        // Update UART1 RPM reading if in PWM/RPM mode (every 50ms)
-        if (now - lastRPMUpdate >= pdMS_TO_TICKS(50)) {
-            peripheralManager.getUART1().updateRPMFrequency();
-            lastRPMUpdate = now;
-        }
+        // UART1 RPM reading is drained by peripheralManager.update() in
+        // peripheralTask; the capture ring has a single consumer.
 
         // Update LED based on system state every 200ms
         if (now - lastLEDUpdate >= pdMS_TO_TICKS(200)) {
@@ -428,6 +504,7 @@ void motorTask(void* parameter) {
 void setup() {
     // ========== 步驟 1: 初始化 USB ==========
     USBSerial.begin();
+    uartBridge.begin();
     HID.begin();
     HID.onData(onHIDData);
     USB.begin();
@@ -449,6 +526,9 @@ void setup() {
         // Non-critical - system can continue without peripherals
     } else {
         USBSerial.println("✅ Peripheral manager initialized successfully");
+        peripheralManager.getUART1().setStallCallback(onFanStall, nullptr);
+        peripheralManager.getFans().setStallCallback(onFanBankStall, nullptr);
+        peripheralManager.getPacketLink().setPacketCallback(onPacket, nullptr);
 
         // Initialize peripheral settings
         if (peripheralManager.beginSettings()) {
@@ -0,0 +1,254 @@
+// Host tests for FanAnalysis, fed with synthetic RPM step traces and duty
+// sweeps whose rise/settle/overshoot are known in closed form.
+// Run: pio test -e native -f test_fan_analysis
+
+#include <unity.h>
+#include <math.h>
+#include "FanAnalysis.h"
+
+static const uint32_t SAMPLE_US = 10000;        // 100 Hz RPM readings, as the characterizer logs them
+static const size_t MAX_SAMPLES = 1000;
+static const float SAMPLE_MS = SAMPLE_US / 1000.0f;
+
+static FanTraceSample trace[MAX_SAMPLES];
+
+// Deterministic noise in [-1, 1)
+static uint32_t lcgState;
+static float noise() {
+    lcgState = lcgState * 1664525u + 1013904223u;
+    return (float)(lcgState >> 8) / (float)(1u << 23) - 1.0f;
+}
+
+// First-order step from → to with time constant tau, optional ± noise
+static size_t firstOrder(float from, float to, float tauMs, uint32_t stepUs, float durationMs,
+                         float noiseRpm = 0.0f) {
+    size_t count = (size_t)(durationMs / SAMPLE_MS);
+    lcgState = 12345;
+    for (size_t i = 0; i < count; i++) {
+        float tMs = (i + 1) * SAMPLE_MS;
+        trace[i].timeUs = stepUs + (uint32_t)(i + 1) * SAMPLE_US;
+        trace[i].rpm = to + (from - to) * expf(-tMs / tauMs) + noiseRpm * noise();
+    }
+    return count;
+}
+
+// Underdamped second-order step 0 → final
+static float secondOrder(float final, float zeta, float wn, float tS) {
+    float wd = wn * sqrtf(1.0f - zeta * zeta);
+    float phi = acosf(zeta);
+    return final * (1.0f - expf(-zeta * wn * tS) / sqrtf(1.0f - zeta * zeta) * sinf(wd * tS + phi));
+}
+
+static size_t underdamped(float final, float zeta, float wn, float durationMs) {
+    size_t count = (size_t)(durationMs / SAMPLE_MS);
+    for (size_t i = 0; i < count; i++) {
+        float tS = (i + 1) * SAMPLE_MS / 1000.0f;
+        trace[i].timeUs = (uint32_t)(i + 1) * SAMPLE_US;
+        trace[i].rpm = secondOrder(final, zeta, wn, tS);
+    }
+    return count;
+}
+
+// First time (ms) the continuous second-order response reaches fraction of final
+static float secondOrderCrossing(float zeta, float wn, float fraction) {
+    float lo = 0.0f;
+    float hi = 0.0f;
+    while (secondOrder(1.0f, zeta, wn, hi) < fraction) {
+        lo = hi;
+        hi += 0.001f;
+    }
+    for (int i = 0; i < 40; i++) {
+        float mid = 0.5f * (lo + hi);
+        if (secondOrder(1.0f, zeta, wn, mid) < fraction) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return hi * 1000.0f;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_first_order_rise_and_settle() {
+    // tau 200 ms: rise (10-90 %) = tau ln 9, settle (±2 %) = tau ln 50
+    size_t n = firstOrder(0.0f, 3000.0f, 200.0f, 0, 4000.0f);
+    FanStepMetrics m = FanAnalysis::analyzeStep(trace, n, 0, 0.0f, FanAnalysis::defaultOptions());
+
+    TEST_ASSERT_TRUE(m.transition);
+    TEST_ASSERT_TRUE(m.settled);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 3000.0f, m.finalRpm);
+    TEST_ASSERT_FLOAT_WITHIN(SAMPLE_MS, 200.0f * logf(9.0f), m.riseMs);
+    TEST_ASSERT_FLOAT_WITHIN(SAMPLE_MS, 200.0f * logf(50.0f), m.settleMs);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.0f, m.overshootPct);       // Rounding only
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 0.0f, m.rippleRpm);
+    TEST_ASSERT_EQUAL_UINT32(n, m.samples);
+}
+
+void test_falling_step_with_offset_start() {
+    // 3000 → 1000 RPM, applied 5 s into the job; band is 2 % of the 2000 RPM change
+    uint32_t stepUs = 5000000;
+    size_t n = firstOrder(3000.0f, 1000.0f, 300.0f, stepUs, 5000.0f);
+    FanStepMetrics m = FanAnalysis::analyzeStep(trace, n, stepUs, 3000.0f, FanAnalysis::defaultOptions());
+
+    TEST_ASSERT_TRUE(m.transition);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 1000.0f, m.finalRpm);
+    TEST_ASSERT_FLOAT_WITHIN(SAMPLE_MS, 300.0f * logf(9.0f), m.riseMs);
+    TEST_ASSERT_FLOAT_WITHIN(SAMPLE_MS, 300.0f * logf(50.0f), m.settleMs);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.0f, m.overshootPct);       // Rounding only
+}
+
+void test_underdamped_overshoot() {
+    // zeta 0.3: overshoot = exp(-zeta pi / sqrt(1 - zeta^2)) = 37.2 %
+    float zeta = 0.3f;
+    float wn = 15.0f;
+    size_t n = underdamped(2500.0f, zeta, wn, 6000.0f);
+    FanStepMetrics m = FanAnalysis::analyzeStep(trace, n, 0, 0.0f, FanAnalysis::defaultOptions());
+
+    float expectedOvershoot = 100.0f * expf(-zeta * (float)M_PI / sqrtf(1.0f - zeta * zeta));
+    TEST_ASSERT_TRUE(m.transition);
+    TEST_ASSERT_TRUE(m.settled);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 2500.0f, m.finalRpm);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, expectedOvershoot, m.overshootPct);
+
+    float expectedRise = secondOrderCrossing(zeta, wn, 0.9f) - secondOrderCrossing(zeta, wn, 0.1f);
+    TEST_ASSERT_FLOAT_WITHIN(SAMPLE_MS, expectedRise, m.riseMs);
+
+    // Settle: every reading from settleMs on is inside ±2 %, the one before is not,
+    // and it is no later than the decay envelope reaching the band
+    size_t first = (size_t)(m.settleMs / SAMPLE_MS + 0.5f) - 1;
+    TEST_ASSERT_TRUE(fabsf(trace[first - 1].rpm - 2500.0f) > 0.02f * 2500.0f);
+    for (size_t i = first; i < n; i++) {
+        TEST_ASSERT_TRUE(fabsf(trace[i].rpm - 2500.0f) <= 0.02f * 2500.0f);
+    }
+    float envelopeMs = 1000.0f * logf(1.0f / (0.02f * sqrtf(1.0f - zeta * zeta))) / (zeta * wn);
+    TEST_ASSERT_TRUE(m.settleMs <= envelopeMs + SAMPLE_MS);
+    TEST_ASSERT_TRUE(m.settleMs > secondOrderCrossing(zeta, wn, 1.0f));
+}
+
+void test_noisy_trace() {
+    // ±15 RPM uniform tach noise (0.5 %) on a 3000 RPM step stays inside the 2 % band
+    size_t n = firstOrder(0.0f, 3000.0f, 200.0f, 0, 4000.0f, 15.0f);
+    FanStepMetrics m = FanAnalysis::analyzeStep(trace, n, 0, 0.0f, FanAnalysis::defaultOptions());
+
+    TEST_ASSERT_TRUE(m.settled);
+    TEST_ASSERT_FLOAT_WITHIN(3.0f, 3000.0f, m.finalRpm);
+    TEST_ASSERT_FLOAT_WITHIN(2.0f, 15.0f / sqrtf(3.0f), m.rippleRpm);   // Std of uniform noise
+    TEST_ASSERT_FLOAT_WITHIN(3 * SAMPLE_MS, 200.0f * logf(9.0f), m.riseMs);
+    TEST_ASSERT_FLOAT_WITHIN(6 * SAMPLE_MS, 200.0f * logf(50.0f), m.settleMs);
+    TEST_ASSERT_TRUE(m.overshootPct < 1.0f);                           // Noise peaks only
+}
+
+void test_unsettled_and_no_transition() {
+    // Step cut off at 2 tau: never inside the band of its (tail) final value
+    size_t n = firstOrder(0.0f, 3000.0f, 500.0f, 0, 1000.0f);
+    FanStepMetrics m = FanAnalysis::analyzeStep(trace, n, 0, 0.0f, FanAnalysis::defaultOptions());
+    TEST_ASSERT_TRUE(m.transition);
+    TEST_ASSERT_FALSE(m.settled);
+    TEST_ASSERT_EQUAL_FLOAT(1000.0f, m.settleMs);
+
+    // A change below minDeltaRpm is not a transition
+    n = firstOrder(2000.0f, 2005.0f, 200.0f, 0, 2000.0f);
+    m = FanAnalysis::analyzeStep(trace, n, 0, 2000.0f, FanAnalysis::defaultOptions());
+    TEST_ASSERT_FALSE(m.transition);
+    TEST_ASSERT_TRUE(m.settled);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, m.riseMs);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, m.settleMs);
+
+    m = FanAnalysis::analyzeStep(trace, 0, 0, 1500.0f, FanAnalysis::defaultOptions());
+    TEST_ASSERT_EQUAL_UINT32(0, m.samples);
+    TEST_ASSERT_EQUAL_FLOAT(1500.0f, m.finalRpm);
+}
+
+// Fan with start-up hysteresis: starts at >= 25 % on the way up, keeps
+// turning down to 15 %, ~50 RPM per % above that; stopped readings show
+// the few RPM of a coasting rotor
+static float sweepRpm(float duty, bool& turning) {
+    if (turning ? duty < 15.0f : duty >= 25.0f) {
+        turning = !turning;
+    }
+    return turning ? 50.0f * duty + 300.0f : 8.0f;
+}
+
+void test_dead_band_from_sweep() {
+    float duty[64];
+    bool rising[64];
+    float rpm[64];
+    size_t n = FanAnalysis::planDutySweep(0.0f, 60.0f, 5.0f, duty, rising, 64);
+    TEST_ASSERT_EQUAL(25, n);                   // 0..60 up, 55..0 down
+
+    bool turning = false;
+    for (size_t i = 0; i < n; i++) {
+        rpm[i] = sweepRpm(duty[i], turning);
+    }
+
+    FanDeadBand band = FanAnalysis::findDeadBand(duty, rpm, rising, n, 0.05f);
+    TEST_ASSERT_TRUE(band.hasStart);
+    TEST_ASSERT_TRUE(band.hasStop);
+    TEST_ASSERT_EQUAL_FLOAT(25.0f, band.startDuty);
+    TEST_ASSERT_EQUAL_FLOAT(10.0f, band.stopDuty);      // Highest falling duty below 15 %
+    TEST_ASSERT_EQUAL_FLOAT(0.05f * 3300.0f, band.thresholdRpm);
+
+    // A fan that never stops on the way down (sweep floor above the stop duty)
+    n = FanAnalysis::planDutySweep(20.0f, 60.0f, 5.0f, duty, rising, 64);
+    turning = false;
+    for (size_t i = 0; i < n; i++) {
+        rpm[i] = sweepRpm(duty[i], turning);
+    }
+    band = FanAnalysis::findDeadBand(duty, rpm, rising, n, 0.05f);
+    TEST_ASSERT_TRUE(band.hasStart);
+    TEST_ASSERT_FALSE(band.hasStop);
+    TEST_ASSERT_EQUAL_FLOAT(25.0f, band.startDuty);
+
+    // Never turns: no start, the threshold stays at its 1 RPM floor
+    for (size_t i = 0; i < n; i++) {
+        rpm[i] = 0.0f;
+    }
+    band = FanAnalysis::findDeadBand(duty, rpm, rising, n, 0.05f);
+    TEST_ASSERT_FALSE(band.hasStart);
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, band.thresholdRpm);
+}
+
+void test_setpoint_plans() {
+    float out[64];
+    bool rising[64];
+
+    // Last rising step clamps to the target
+    size_t n = FanAnalysis::planDutySweep(10.0f, 32.0f, 10.0f, out, rising, 64);
+    TEST_ASSERT_EQUAL(7, n);
+    const float expected[] = {10.0f, 20.0f, 30.0f, 32.0f, 30.0f, 20.0f, 10.0f};
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT_EQUAL_FLOAT(expected[i], out[i]);
+        TEST_ASSERT_EQUAL(i <= 3, rising[i]);
+    }
+    TEST_ASSERT_EQUAL(0, FanAnalysis::planDutySweep(10.0f, 32.0f, 10.0f, out, rising, 6));
+    TEST_ASSERT_EQUAL(0, FanAnalysis::planDutySweep(50.0f, 20.0f, 5.0f, out, rising, 64));
+
+    n = FanAnalysis::planFrequencySweep(100.0f, 100000.0f, 4, out, rising, 64);
+    TEST_ASSERT_EQUAL(4, n);
+    TEST_ASSERT_EQUAL_FLOAT(100.0f, out[0]);
+    TEST_ASSERT_EQUAL_FLOAT(1000.0f, out[1]);
+    TEST_ASSERT_EQUAL_FLOAT(10000.0f, out[2]);
+    TEST_ASSERT_EQUAL_FLOAT(100000.0f, out[3]);
+
+    n = FanAnalysis::planStep(20.0f, 80.0f, 2, out, rising, 64);
+    TEST_ASSERT_EQUAL(5, n);
+    TEST_ASSERT_EQUAL_FLOAT(20.0f, out[0]);
+    TEST_ASSERT_EQUAL_FLOAT(80.0f, out[1]);
+    TEST_ASSERT_EQUAL_FLOAT(20.0f, out[4]);
+    TEST_ASSERT_FALSE(rising[0]);
+    TEST_ASSERT_TRUE(rising[3]);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_order_rise_and_settle);
+    RUN_TEST(test_falling_step_with_offset_start);
+    RUN_TEST(test_underdamped_overshoot);
+    RUN_TEST(test_noisy_trace);
+    RUN_TEST(test_unsettled_and_no_transition);
+    RUN_TEST(test_dead_band_from_sweep);
+    RUN_TEST(test_setpoint_plans);
+    return UNITY_END();
+}
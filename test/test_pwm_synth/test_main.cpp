@@ -0,0 +1,252 @@
+// Host tests for PWMSynth: every integer frequency from 1 Hz to 500 kHz is
+// checked against an exhaustive integer search of the MCPWM register space.
+// Run: pio test -e native -f test_pwm_synth
+
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include "PWMSynth.h"
+
+static const uint32_t CLOCK = 10000000;     // Default group clock (160 MHz / 16)
+static const uint32_t MAX_FREQ = 500000;    // SET PWM_FREQ upper limit
+
+/**
+ * Reference search over every prescaler with exact integer arithmetic.
+ * For a fixed divider f ∝ 1/ticks, so only the two ticks bracketing
+ * clock / (divider · f) are candidates; these are found by integer
+ * division, independently of PWMSynth's floating-point search.
+ */
+struct Reference {
+    bool any;                   // Some pair is in the 16-bit range
+    bool constrained;           // Some bracketing pair meets minDutySteps
+    double bestError;           // Smallest |f − requested| among constrained pairs
+    bool exact;                 // A constrained pair hits the frequency exactly
+    uint32_t finestTicks;       // Fallback: largest ticks among each divider's nearest pair
+    double finestError;         // Smallest error at finestTicks
+};
+
+static double pairError(uint32_t clock, uint32_t divider, uint32_t ticks, uint32_t frequency) {
+    return fabs((double)clock / ((double)divider * ticks) - (double)frequency);
+}
+
+static Reference reference(uint32_t clock, uint32_t frequency, uint32_t minDutySteps) {
+    Reference r = {};
+    for (uint32_t divider = 1; divider <= PWMSynth::MAX_DIVIDER; divider++) {
+        uint64_t step = (uint64_t)divider * frequency;
+        uint64_t lower = clock / step;
+        uint64_t candidates[2] = { lower, lower + 1 };
+        uint32_t nearestTicks = 0;
+        double nearestError = 0.0;
+        for (uint64_t ticks : candidates) {
+            if (ticks < PWMSynth::MIN_TICKS || ticks > PWMSynth::MAX_TICKS) {
+                continue;
+            }
+            double error = pairError(clock, divider, (uint32_t)ticks, frequency);
+            r.any = true;
+            if (nearestTicks == 0 || error < nearestError) {
+                nearestTicks = (uint32_t)ticks;
+                nearestError = error;
+            }
+            if (ticks >= minDutySteps) {
+                if (!r.constrained || error < r.bestError) {
+                    r.bestError = error;
+                }
+                r.constrained = true;
+                if (step * ticks == clock) {
+                    r.exact = true;
+                }
+            }
+        }
+        if (nearestTicks > r.finestTicks || (nearestTicks == r.finestTicks && nearestError < r.finestError)) {
+            r.finestTicks = nearestTicks;
+            r.finestError = nearestError;
+        }
+    }
+    return r;
+}
+
+/**
+ * Fields reported for a pair must describe that pair
+ */
+static void checkReported(uint32_t clock, double requested, const PWMSynthResult& out) {
+    char msg[64];
+    snprintf(msg, sizeof(msg), "%.3f Hz", requested);
+    TEST_ASSERT_TRUE_MESSAGE(out.prescaler < PWMSynth::MAX_DIVIDER, msg);
+    TEST_ASSERT_TRUE_MESSAGE(out.period + 1u >= PWMSynth::MIN_TICKS, msg);
+    TEST_ASSERT_TRUE_MESSAGE(out.period + 1u <= PWMSynth::MAX_TICKS, msg);
+
+    double achieved = (double)clock / ((double)(out.prescaler + 1) * (double)(out.period + 1));
+    TEST_ASSERT_TRUE_MESSAGE(out.frequency == achieved, msg);
+    double ppm = (achieved - requested) / requested * 1e6;
+    TEST_ASSERT_DOUBLE_WITHIN_MESSAGE(1e-9 + fabs(ppm) * 1e-12, ppm, out.errorPpm, msg);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(out.period + 1u, out.dutySteps, msg);
+    TEST_ASSERT_FLOAT_WITHIN_MESSAGE(1e-6f, 100.0f / (out.period + 1), out.dutyResolution, msg);
+}
+
+/**
+ * Sweep every integer frequency with no prescaler in use: the result is
+ * the exact pair when one exists, otherwise the minimum-error pair; with
+ * no pair reaching minDutySteps, the finest resolution available
+ */
+static void sweep(uint32_t clock, const PWMSynth::Constraints& constraints) {
+    uint32_t exactCount = 0;
+    for (uint32_t f = 1; f <= MAX_FREQ; f++) {
+        char msg[48];
+        snprintf(msg, sizeof(msg), "%u Hz @ %u Hz clock", f, clock);
+
+        Reference ref = reference(clock, f, constraints.minDutySteps);
+        PWMSynthResult out;
+        bool ok = PWMSynth::synthesize(clock, f, -1, constraints, out);
+        TEST_ASSERT_EQUAL_MESSAGE(ref.any, ok, msg);
+        if (!ok) {
+            continue;
+        }
+        checkReported(clock, f, out);
+        TEST_ASSERT_FALSE_MESSAGE(out.keptPrescaler, msg);
+
+        uint32_t ticks = out.period + 1u;
+        double error = pairError(clock, out.prescaler + 1u, ticks, f);
+        if (ref.constrained) {
+            TEST_ASSERT_TRUE_MESSAGE(ticks >= constraints.minDutySteps, msg);
+            TEST_ASSERT_TRUE_MESSAGE(error <= ref.bestError * (1.0 + 1e-12), msg);
+            if (ref.exact) {
+                exactCount++;
+                TEST_ASSERT_TRUE_MESSAGE((uint64_t)(out.prescaler + 1u) * ticks * f == clock, msg);
+                TEST_ASSERT_TRUE_MESSAGE(out.errorPpm == 0.0, msg);
+            }
+        } else {
+            TEST_ASSERT_EQUAL_UINT32_MESSAGE(ref.finestTicks, ticks, msg);
+            TEST_ASSERT_TRUE_MESSAGE(error <= ref.finestError * (1.0 + 1e-12), msg);
+        }
+    }
+    TEST_ASSERT_TRUE(exactCount > 0);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// ============================================================================
+// Sweeps
+// ============================================================================
+
+void test_sweep_default_clock(void) {
+    sweep(CLOCK, PWMSynth::defaultConstraints());
+}
+
+void test_sweep_full_pll_clock(void) {
+    // Group prescaler 1: many more exact pairs and a wider fallback band
+    sweep(160000000, PWMSynth::defaultConstraints());
+}
+
+void test_sweep_fine_resolution(void) {
+    // 0.1 % duty: the fallback band starts at clock / 1000
+    PWMSynth::Constraints constraints = PWMSynth::defaultConstraints();
+    constraints.minDutySteps = 1000;
+    sweep(CLOCK, constraints);
+}
+
+void test_sweep_fractional_frequencies(void) {
+    PWMSynth::Constraints constraints = PWMSynth::defaultConstraints();
+    for (double f = 0.7; f <= MAX_FREQ; f *= 1.0137) {
+        PWMSynthResult out;
+        TEST_ASSERT_TRUE(PWMSynth::synthesize(CLOCK, f, -1, constraints, out));
+        checkReported(CLOCK, f, out);
+
+        // Same minimum against every prescaler, via the per-prescaler search
+        double error = fabs(out.frequency - f);
+        for (uint32_t prescaler = 0; prescaler < PWMSynth::MAX_DIVIDER; prescaler++) {
+            uint32_t period;
+            if (PWMSynth::periodForPrescaler(CLOCK, f, prescaler, period) &&
+                period + 1 >= constraints.minDutySteps) {
+                double other = fabs(PWMSynth::achievedFrequency(CLOCK, prescaler, period) - f);
+                TEST_ASSERT_TRUE(error <= other * (1.0 + 1e-12));
+            }
+        }
+    }
+}
+
+// ============================================================================
+// Keeping the current prescaler
+// ============================================================================
+
+void test_keep_prescaler_policy(void) {
+    PWMSynth::Constraints constraints = PWMSynth::defaultConstraints();
+    const int32_t currents[] = { 0, 9, 79, 255 };
+    for (int32_t current : currents) {
+        for (uint32_t f = 1; f <= MAX_FREQ; f += 97) {
+            char msg[48];
+            snprintf(msg, sizeof(msg), "%u Hz from prescaler %d", f, (int)current);
+
+            PWMSynthResult best, out;
+            bool ok = PWMSynth::synthesize(CLOCK, f, -1, constraints, best);
+            TEST_ASSERT_EQUAL_MESSAGE(ok, PWMSynth::synthesize(CLOCK, f, current, constraints, out), msg);
+            if (!ok) {
+                continue;
+            }
+            checkReported(CLOCK, f, out);
+
+            if (out.prescaler != current) {
+                // Not kept: exactly the free search
+                TEST_ASSERT_FALSE_MESSAGE(out.keptPrescaler, msg);
+                TEST_ASSERT_EQUAL_UINT16_MESSAGE(best.prescaler, out.prescaler, msg);
+                TEST_ASSERT_EQUAL_UINT16_MESSAGE(best.period, out.period, msg);
+                continue;
+            }
+            TEST_ASSERT_TRUE_MESSAGE(out.keptPrescaler, msg);
+            // Kept: within tolerance or no worse, and no coarser than required
+            TEST_ASSERT_TRUE_MESSAGE(fabs(out.errorPpm) <= constraints.keepTolerancePpm ||
+                                     fabs(out.errorPpm) <= fabs(best.errorPpm), msg);
+            TEST_ASSERT_TRUE_MESSAGE(out.dutySteps >= constraints.minDutySteps ||
+                                     out.period >= best.period, msg);
+        }
+    }
+}
+
+void test_keep_prescaler_when_exact(void) {
+    // 25 kHz from prescaler 3: 10 MHz / 4 / 100, exact on the current prescaler
+    PWMSynthResult out;
+    TEST_ASSERT_TRUE(PWMSynth::synthesize(CLOCK, 25000, 3, PWMSynth::defaultConstraints(), out));
+    TEST_ASSERT_TRUE(out.keptPrescaler);
+    TEST_ASSERT_EQUAL_UINT16(3, out.prescaler);
+    TEST_ASSERT_EQUAL_UINT16(99, out.period);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, (float)out.errorPpm);
+}
+
+// ============================================================================
+// Range
+// ============================================================================
+
+void test_out_of_range(void) {
+    PWMSynth::Constraints constraints = PWMSynth::defaultConstraints();
+    PWMSynthResult out;
+    TEST_ASSERT_FALSE(PWMSynth::synthesize(CLOCK, 0.0, -1, constraints, out));
+    TEST_ASSERT_FALSE(PWMSynth::synthesize(CLOCK, -10.0, -1, constraints, out));
+    TEST_ASSERT_FALSE(PWMSynth::synthesize(CLOCK, NAN, -1, constraints, out));
+    TEST_ASSERT_FALSE(PWMSynth::synthesize(0, 1000.0, -1, constraints, out));
+
+    // Slowest: 256 × 65536 ticks
+    double slowest = (double)CLOCK / (256.0 * 65536.0);
+    TEST_ASSERT_TRUE(PWMSynth::synthesize(CLOCK, slowest, -1, constraints, out));
+    TEST_ASSERT_EQUAL_UINT16(255, out.prescaler);
+    TEST_ASSERT_EQUAL_UINT16(65535, out.period);
+    TEST_ASSERT_FALSE(PWMSynth::synthesize(CLOCK, slowest * 0.99, -1, constraints, out));
+
+    // Fastest: 2 ticks, which is also the nearest pair for anything above
+    TEST_ASSERT_TRUE(PWMSynth::synthesize(CLOCK, CLOCK / 2.0, -1, constraints, out));
+    TEST_ASSERT_EQUAL_UINT32(2, out.dutySteps);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, (float)out.errorPpm);
+    TEST_ASSERT_TRUE(PWMSynth::synthesize(CLOCK, CLOCK * 0.7, -1, constraints, out));
+    TEST_ASSERT_EQUAL_UINT32(2, out.dutySteps);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_sweep_default_clock);
+    RUN_TEST(test_sweep_full_pll_clock);
+    RUN_TEST(test_sweep_fine_resolution);
+    RUN_TEST(test_sweep_fractional_frequencies);
+    RUN_TEST(test_keep_prescaler_policy);
+    RUN_TEST(test_keep_prescaler_when_exact);
+    RUN_TEST(test_out_of_range);
+    return UNITY_END();
+}
@@ -0,0 +1,444 @@
+// Closed-loop tests for RPMController against a simulated fan.
+// The controller and the tach measurement (RPMFilter) are the firmware
+// sources; only the fan and the loop timing are modelled here.
+// Run: pio test -e native -f test_rpm_controller
+// Set RPM_SIM_CSV=<file> to also write the step-response trace, which
+// scripts/rpm_plant_sim.py plots.
+
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "RPMController.h"
+#include "RPMFilter.h"
+
+static const uint32_t CLOCK = 80000000;     // MCPWM capture clock (APB)
+static const double PHYSICS_DT = 20e-6;
+
+/**
+ * First-order fan: stalls below the deadband, steady-state RPM rises
+ * as duty^gamma above it
+ */
+struct FanPlant {
+    double maxRpm = 5000.0;
+    double tau = 0.4;                       // Mechanical time constant (s)
+    double deadband = 15.0;                 // Duty (%) below which the fan stalls
+    double gamma = 0.8;
+    double rpm = 0.0;
+
+    double steadyState(double duty) const {
+        if (duty <= deadband) {
+            return 0.0;
+        }
+        return maxRpm * pow((duty - deadband) / (100.0 - deadband), gamma);
+    }
+
+    void step(double duty, double dt) {
+        rpm += (steadyState(duty) - rpm) * (dt / tau);
+    }
+};
+
+struct SimConfig {
+    float kp = 0.01f;                       // Firmware defaults (MOTOR PID / LOOP / SLEW)
+    float ki = 0.05f;
+    float kd = 0.0f;
+    float slew = 200.0f;
+    double loopHz = 200.0;
+    double jitterUs = 20.0;                 // Loop wake-up jitter (±)
+    uint8_t polePairs = 2;
+    uint16_t periods = 8;                   // SET RPM_PERIODS
+    uint16_t gateMs = 50;                   // SET RPM_GATE
+    double noisePct = 0.5;                  // Tach edge jitter (% of one period, ±)
+    bool pretrain = false;                  // Start with the whole FF curve learned
+};
+
+struct StepResult {
+    double riseS;                           // 10-90 %
+    double overshootPct;
+    double settleS;                         // Last time outside ±2 %, from the step
+    double finalError;                      // RPM, at the end of the segment
+};
+
+/**
+ * Fan + tach + loop timer. The tach produces edge timestamps on the
+ * 80 MHz capture clock that go through RPMFilter the way measureRPM()
+ * feeds it, and the loop runs the same sequence as rpmLoopTick().
+ */
+class Sim {
+public:
+    FanPlant plant;
+    RPMFilter filter{CLOCK};
+    RPMController pid;
+    SimConfig cfg;
+
+    double t = 0.0;
+    float duty = 0.0f;
+    float measured = 0.0f;
+    float maxDutyStep = 0.0f;               // Largest output change per update
+    float maxDutyStepAllowed = 0.0f;        // slew·dt at that update
+
+    explicit Sim(const SimConfig& config) : cfg(config) {
+        pid.setGains(cfg.kp, cfg.ki, cfg.kd);
+        pid.setSlewRate(cfg.slew);
+        filter.setSamplePeriods(cfg.periods);
+        filter.setMaxGateMs(cfg.gateMs);
+        if (cfg.pretrain) {
+            for (uint8_t i = 0; i < RPMController::CURVE_POINTS; i++) {
+                pid.setCurvePoint(i, (float)plant.steadyState(i * 10.0));
+            }
+        }
+        nextTick = 1.0 / cfg.loopHz;
+    }
+
+    void start(float target) {
+        pid.setTarget(target);
+        pid.start(duty, measured);
+        pid.resetMetrics();
+        lastTick = t;
+        lastSample = filter.getSampleCount();
+    }
+
+    /**
+     * Run until `until` seconds, recording (t, rpm) at every loop update
+     * @param trace Optional CSV output
+     */
+    void run(double until, FILE* trace = nullptr) {
+        while (t < until) {
+            stepPhysics();
+            if (t >= nextTick) {
+                loopTick();
+                if (trace) {
+                    fprintf(trace, "%.4f,%.1f,%.1f,%.1f,%.2f\n", t, pid.getTarget(), plant.rpm,
+                            measured, duty);
+                }
+                if (samples < MAX_SAMPLES) {
+                    sampleT[samples] = t;
+                    sampleRpm[samples] = plant.rpm;
+                    samples++;
+                }
+            }
+        }
+    }
+
+    StepResult analyse(double from, double to, float startRpm, float target) const {
+        StepResult r = { NAN, 0.0, NAN, 0.0 };
+        double lo = startRpm + 0.1 * (target - startRpm);
+        double hi = startRpm + 0.9 * (target - startRpm);
+        bool rising = target > startRpm;
+        double t10 = -1.0, t90 = -1.0;
+        double peak = startRpm;
+        double settle = from;
+        double last = startRpm;
+        for (size_t i = 0; i < samples; i++) {
+            if (sampleT[i] < from || sampleT[i] > to) {
+                continue;
+            }
+            double rpm = sampleRpm[i];
+            if (t10 < 0 && (rising ? rpm >= lo : rpm <= lo)) t10 = sampleT[i];
+            if (t90 < 0 && (rising ? rpm >= hi : rpm <= hi)) t90 = sampleT[i];
+            if (rising ? rpm > peak : rpm < peak) peak = rpm;
+            if (fabs(rpm - target) > 0.02 * target) settle = sampleT[i];
+            last = rpm;
+        }
+        if (t10 >= 0 && t90 >= 0) r.riseS = t90 - t10;
+        double over = rising ? peak - target : target - peak;
+        r.overshootPct = over > 0 ? over / fabs(target - startRpm) * 100.0 : 0.0;
+        r.settleS = settle - from;
+        r.finalError = target - last;
+        return r;
+    }
+
+private:
+    static const size_t MAX_SAMPLES = 8192;
+
+    double phase = 0.0;                     // Fraction of a tach period since the last edge
+    double lastEdgeT = -1.0;
+    double nextTick;
+    double lastTick = 0.0;
+    uint32_t lastSample = 0;
+    uint32_t rng = 12345;
+    size_t samples = 0;
+    double sampleT[MAX_SAMPLES];
+    double sampleRpm[MAX_SAMPLES];
+
+    double uniform() {
+        rng = rng * 1664525u + 1013904223u;  // Deterministic across hosts
+        return (rng >> 8) / (double)(1u << 24) * 2.0 - 1.0;
+    }
+
+    void stepPhysics() {
+        double hz = plant.rpm * cfg.polePairs / 60.0;
+        plant.step(duty, PHYSICS_DT);
+        t += PHYSICS_DT;
+        phase += hz * PHYSICS_DT;
+        if (phase >= 1.0) {
+            // Interpolate the crossing, then jitter it like a real hall sensor
+            phase -= 1.0;
+            double edge = t - phase / hz + uniform() * cfg.noisePct / 100.0 / hz;
+            filter.addEdge((uint32_t)(uint64_t)(edge * CLOCK));
+            lastEdgeT = t;
+        }
+    }
+
+    void loopTick() {
+        double dt = t - lastTick;
+        pid.recordPeriod((uint32_t)(dt * 1e6 + 0.5), (uint32_t)(1e6 / cfg.loopHz + 0.5));
+        lastTick = t;
+        nextTick += 1.0 / cfg.loopHz + uniform() * cfg.jitterUs * 1e-6;
+
+        // measureRPM(): no edge for 500 ms drops the reading to zero
+        if (lastEdgeT < 0 || t - lastEdgeT > 0.5) {
+            if (measured != 0.0f) {
+                filter.reset();
+            }
+            measured = 0.0f;
+        } else {
+            measured = filter.getFrequency() * 60.0f / cfg.polePairs;
+        }
+
+        float previous = duty;
+        duty = pid.update(measured, (float)dt);
+        if (fabsf(duty - previous) > maxDutyStep) {
+            maxDutyStep = fabsf(duty - previous);
+            maxDutyStepAllowed = cfg.slew * (float)dt;
+        }
+
+        uint32_t count = filter.getSampleCount();
+        float target = pid.getTarget();
+        if (count != lastSample && measured > 0.0f && fabsf(target - measured) < target * 0.02f) {
+            pid.learn(duty, measured);
+        }
+        lastSample = count;
+    }
+};
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// ============================================================================
+// Closed loop
+// ============================================================================
+
+void test_step_from_standstill(void) {
+    SimConfig cfg;
+    cfg.pretrain = true;
+    Sim sim(cfg);
+    sim.start(2000.0f);
+    sim.run(10.0);
+
+    StepResult r = sim.analyse(0.0, 10.0, 0.0f, 2000.0f);
+    TEST_ASSERT_LESS_THAN(1.0, r.riseS);
+    TEST_ASSERT_LESS_THAN(3.5, r.settleS);
+    TEST_ASSERT_LESS_THAN(20.0, r.overshootPct);
+    TEST_ASSERT_DOUBLE_WITHIN(20.0, 0.0, r.finalError);
+    TEST_ASSERT_LESS_THAN(25.0f, sim.pid.getMetrics().errorRms);   // ~1 s window: tach noise only
+}
+
+void test_step_without_curve_learns_it(void) {
+    SimConfig cfg;                          // FF enabled, nothing learned yet
+    Sim sim(cfg);
+    sim.start(2000.0f);
+    sim.run(10.0);
+
+    StepResult r = sim.analyse(0.0, 10.0, 0.0f, 2000.0f);
+    TEST_ASSERT_LESS_THAN(3.5, r.settleS);
+    TEST_ASSERT_DOUBLE_WITHIN(20.0, 0.0, r.finalError);
+
+    // Settled at 2000 RPM on ~42 % duty: the nearest curve point (40 %)
+    // picks up that operating point
+    TEST_ASSERT_TRUE(sim.pid.getCurveKnownPoints() >= 1);
+    TEST_ASSERT_FLOAT_WITHIN(0.02f * 2000.0f, 2000.0f, sim.pid.getCurvePoint(4));
+}
+
+void test_target_step_while_running(void) {
+    SimConfig cfg;
+    cfg.pretrain = true;
+    Sim sim(cfg);
+
+    const char* csv = getenv("RPM_SIM_CSV");
+    FILE* trace = csv ? fopen(csv, "w") : nullptr;
+    if (trace) {
+        fprintf(trace, "t,target,rpm,measured,duty\n");
+    }
+
+    sim.start(2000.0f);
+    sim.run(4.0, trace);
+    sim.pid.setTarget(3000.0f);
+    sim.run(8.0, trace);
+    sim.pid.setTarget(1000.0f);
+    sim.run(12.0, trace);
+    if (trace) {
+        fclose(trace);
+    }
+
+    StepResult up = sim.analyse(4.0, 8.0, 2000.0f, 3000.0f);
+    TEST_ASSERT_LESS_THAN(3.0, up.settleS);
+    TEST_ASSERT_LESS_THAN(20.0, up.overshootPct);
+    TEST_ASSERT_DOUBLE_WITHIN(30.0, 0.0, up.finalError);
+
+    StepResult down = sim.analyse(8.0, 12.0, 3000.0f, 1000.0f);
+    TEST_ASSERT_LESS_THAN(3.5, down.settleS);
+    TEST_ASSERT_LESS_THAN(30.0, down.overshootPct);
+    TEST_ASSERT_DOUBLE_WITHIN(15.0, 0.0, down.finalError);
+}
+
+void test_unreachable_target_does_not_wind_up(void) {
+    SimConfig cfg;
+    cfg.pretrain = true;
+    Sim sim(cfg);
+    sim.start(6000.0f);                     // Above the fan's 5000 RPM
+    sim.run(5.0);
+
+    RPMController::Metrics m = sim.pid.getMetrics();
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 100.0f, m.output);
+    TEST_ASSERT_TRUE(m.saturationPct > 50.0f);
+    // The integrator stops where the output hit the limit
+    TEST_ASSERT_TRUE(m.feedForward + m.integral < 110.0f);
+
+    // Recovers as fast as a plain step instead of unwinding first
+    sim.pid.setTarget(2000.0f);
+    sim.run(9.0);
+    StepResult r = sim.analyse(5.0, 9.0, 5000.0f, 2000.0f);
+    TEST_ASSERT_LESS_THAN(3.5, r.settleS);
+    TEST_ASSERT_DOUBLE_WITHIN(20.0, 0.0, r.finalError);
+}
+
+void test_slew_limit_holds(void) {
+    SimConfig cfg;
+    cfg.pretrain = true;
+    cfg.slew = 20.0f;
+    Sim sim(cfg);
+    sim.start(4000.0f);
+    sim.run(2.0);
+
+    TEST_ASSERT_TRUE(sim.maxDutyStep > 0.0f);
+    TEST_ASSERT_TRUE(sim.maxDutyStep <= sim.maxDutyStepAllowed * 1.0001f);
+    // 2 s at 20 %/s cannot get past 40 % duty
+    TEST_ASSERT_LESS_OR_EQUAL(40.5f, sim.duty);
+}
+
+void test_long_gate_still_converges(void) {
+    // Slow measurement: 64 periods per sample, up to 200 ms gate. The
+    // default gains oscillate on this much measurement lag, lower ones hold
+    SimConfig cfg;
+    cfg.kp = 0.004f;
+    cfg.ki = 0.01f;
+    cfg.pretrain = true;
+    cfg.periods = 64;
+    cfg.gateMs = 200;
+    Sim sim(cfg);
+    sim.start(1500.0f);
+    sim.run(8.0);
+
+    StepResult r = sim.analyse(0.0, 8.0, 0.0f, 1500.0f);
+    TEST_ASSERT_LESS_THAN(5.0, r.settleS);
+    TEST_ASSERT_LESS_THAN(5.0, r.overshootPct);
+    TEST_ASSERT_DOUBLE_WITHIN(15.0, 0.0, r.finalError);
+}
+
+// ============================================================================
+// Controller in isolation
+// ============================================================================
+
+void test_start_is_bumpless(void) {
+    RPMController pid;
+    pid.setTarget(3000.0f);
+    pid.start(40.0f, 2500.0f);
+    float duty = pid.update(2500.0f, 0.005f);
+    // Only the integral of one step (Ki·e·dt) on top of the applied duty
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 40.0f + 0.05f * 500.0f * 0.005f, duty);
+}
+
+void test_derivative_acts_on_measurement(void) {
+    RPMController pid;
+    pid.setGains(0.0f, 0.0f, 0.01f);
+    pid.setSlewRate(0.0f);
+    pid.setFeedForwardEnabled(false);
+    pid.setTarget(1000.0f);
+    pid.start(30.0f, 1000.0f);
+    float before = pid.update(1000.0f, 0.005f);
+
+    // A target step does not kick the output...
+    pid.setTarget(2000.0f);
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, before, pid.update(1000.0f, 0.005f));
+    // ...a falling measurement pushes it up by Kd·(−d rpm/dt)
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, before + 0.01f * 10.0f / 0.005f, pid.update(990.0f, 0.005f));
+}
+
+void test_feed_forward_interpolates_curve(void) {
+    RPMController pid;
+    TEST_ASSERT_EQUAL_FLOAT(-1.0f, pid.feedForward(1000.0f));
+    pid.learn(40.0f, 2000.0f);
+    pid.learn(60.0f, 3000.0f);
+    pid.learn(55.0f, 9999.0f);              // Too far from a curve point
+    TEST_ASSERT_EQUAL_UINT8(2, pid.getCurveKnownPoints());
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 50.0f, pid.feedForward(2500.0f));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 40.0f, pid.feedForward(1500.0f));
+    TEST_ASSERT_EQUAL_FLOAT(-1.0f, pid.feedForward(3500.0f));
+
+    pid.learn(40.0f, 2100.0f);              // Existing points move slowly
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 2002.0f, pid.getCurvePoint(4));
+    pid.clearCurve();
+    TEST_ASSERT_EQUAL_UINT8(0, pid.getCurveKnownPoints());
+}
+
+void test_configuration_limits(void) {
+    RPMController pid;
+    TEST_ASSERT_FALSE(pid.setGains(-0.1f, 0.0f, 0.0f));
+    TEST_ASSERT_FALSE(pid.setGains(0.1f, NAN, 0.0f));
+    TEST_ASSERT_FALSE(pid.setGains(0.1f, 0.0f, INFINITY));
+    TEST_ASSERT_TRUE(pid.setGains(0.02f, 0.1f, 0.0f));
+    TEST_ASSERT_EQUAL_FLOAT(0.02f, pid.getKp());
+
+    TEST_ASSERT_TRUE(pid.setSlewRate(0.0f));
+    TEST_ASSERT_FALSE(pid.setSlewRate(0.05f));
+    TEST_ASSERT_FALSE(pid.setSlewRate(20000.0f));
+    TEST_ASSERT_TRUE(pid.setSlewRate(100.0f));
+
+    TEST_ASSERT_FALSE(pid.setOutputLimits(50.0f, 40.0f));
+    TEST_ASSERT_FALSE(pid.setOutputLimits(-1.0f, 40.0f));
+    TEST_ASSERT_TRUE(pid.setOutputLimits(20.0f, 80.0f));
+}
+
+void test_output_limits_clamp(void) {
+    RPMController pid;
+    pid.setOutputLimits(20.0f, 80.0f);
+    pid.setSlewRate(0.0f);
+    pid.setTarget(3000.0f);
+    pid.start(50.0f, 3000.0f);
+    TEST_ASSERT_EQUAL_FLOAT(80.0f, pid.update(0.0f, 0.005f));       // Stall: Kp·e alone is +30 %
+    pid.start(50.0f, 3000.0f);
+    TEST_ASSERT_EQUAL_FLOAT(20.0f, pid.update(6000.0f, 0.005f));
+    TEST_ASSERT_EQUAL_UINT32(2, pid.getMetrics().saturated);
+}
+
+void test_period_metrics(void) {
+    RPMController pid;
+    pid.recordPeriod(5000, 5000);
+    pid.recordPeriod(5030, 5000);
+    pid.recordPeriod(4970, 5000);
+    RPMController::Metrics m = pid.getMetrics();
+    TEST_ASSERT_EQUAL_UINT32(4970, m.periodMinUs);
+    TEST_ASSERT_EQUAL_UINT32(5030, m.periodMaxUs);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, sqrtf(600.0f), m.jitterRmsUs);
+
+    pid.resetMetrics();
+    TEST_ASSERT_EQUAL_UINT32(0, pid.getMetrics().periodMaxUs);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_step_from_standstill);
+    RUN_TEST(test_step_without_curve_learns_it);
+    RUN_TEST(test_target_step_while_running);
+    RUN_TEST(test_unreachable_target_does_not_wind_up);
+    RUN_TEST(test_slew_limit_holds);
+    RUN_TEST(test_long_gate_still_converges);
+    RUN_TEST(test_start_is_bumpless);
+    RUN_TEST(test_derivative_acts_on_measurement);
+    RUN_TEST(test_feed_forward_interpolates_curve);
+    RUN_TEST(test_configuration_limits);
+    RUN_TEST(test_output_limits_clamp);
+    RUN_TEST(test_period_metrics);
+    return UNITY_END();
+}
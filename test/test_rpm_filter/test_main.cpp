@@ -0,0 +1,383 @@
+// Host tests for RPMFilter / CaptureRing, fed with recorded tach edge traces.
+// Run: pio test -e native -f test_rpm_filter
+
+#include <unity.h>
+#include "RPMFilter.h"
+
+static const uint32_t CLOCK = 80000000;     // MCPWM capture clock (APB)
+
+// Recorded tach periods (capture ticks at 80 MHz) of a 2-pole fan at
+// ~1000 Hz tach frequency, with the usual few-hundred-ppm jitter
+static const uint32_t TRACE_1KHZ[] = {
+    80012, 79987, 80004, 79995, 80021, 79978, 80009, 79993,
+    80001, 80015, 79982, 80006, 79990, 80011, 79997, 80003,
+    79986, 80019, 80000, 79994, 80008, 79991, 80013, 79989,
+};
+static const size_t TRACE_1KHZ_LEN = sizeof(TRACE_1KHZ) / sizeof(TRACE_1KHZ[0]);
+
+// Same fan with a commutation glitch: a spurious edge 9200 ticks after a
+// real one splits one period into 9200 + 70801
+static const uint32_t TRACE_GLITCH[] = {
+    80012, 79987, 80004, 79995, 80021, 79978, 9200, 70801, 80009, 79993,
+    80001, 80015, 79982, 80006, 79990, 80011, 79997, 80003,
+};
+
+// Same fan with one missed edge: two periods merge into 160003 ticks
+static const uint32_t TRACE_MISSED[] = {
+    80012, 79987, 80004, 79995, 80021, 79978, 160003, 80009, 79993,
+    80001, 80015, 79982, 80006, 79990, 80011, 79997, 80003, 79986,
+};
+
+// Spin-up from ~1000 Hz to ~1500 Hz (53333 ticks) within one period
+static const uint32_t TRACE_STEP[] = {
+    80012, 79987, 80004, 79995, 80021, 79978,
+    53340, 53329, 53337, 53331, 53335, 53330, 53338, 53328,
+    53336, 53332, 53334, 53333, 53339, 53327, 53333, 53334,
+    53331, 53336, 53330, 53335, 53333, 53332, 53337, 53329,
+};
+
+// Stalling fan: ~10 Hz, every period longer than the 50 ms gate
+static const uint32_t TRACE_10HZ[] = {
+    8000400, 7999100, 8001200, 7998800, 8000000, 8000600,
+};
+
+static size_t sampleCount;
+static float samples[64];
+
+/**
+ * Replay periods as absolute timestamps starting at start (wraps at 2^32).
+ * Records every raw sample produced.
+ */
+static uint32_t replay(RPMFilter& filter, uint32_t start, const uint32_t* periods, size_t count,
+                       bool firstEdge = true) {
+    uint32_t t = start;
+    if (firstEdge) {
+        filter.addEdge(t);
+    }
+    for (size_t i = 0; i < count; i++) {
+        t += periods[i];
+        if (filter.addEdge(t) && sampleCount < sizeof(samples) / sizeof(samples[0])) {
+            samples[sampleCount++] = filter.getRawFrequency();
+        }
+    }
+    return t;
+}
+
+static double meanPeriod(const uint32_t* periods, size_t from, size_t to) {
+    double sum = 0;
+    for (size_t i = from; i < to; i++) {
+        sum += periods[i];
+    }
+    return sum / (to - from);
+}
+
+void setUp(void) {
+    sampleCount = 0;
+}
+
+void tearDown(void) {
+}
+
+// ============================================================================
+// CaptureRing
+// ============================================================================
+
+void test_ring_fifo_order_and_index_wrap(void) {
+    CaptureRing<8> ring;
+    uint32_t value;
+    bool gap;
+    // Several laps so head/tail pass the buffer size many times
+    for (uint32_t i = 0; i < 100; i++) {
+        TEST_ASSERT_TRUE(ring.push(i * 3));
+        TEST_ASSERT_TRUE(ring.push(i * 3 + 1));
+        TEST_ASSERT_TRUE(ring.pop(value, gap));
+        TEST_ASSERT_EQUAL_UINT32(i * 3, value);
+        TEST_ASSERT_FALSE(gap);
+        TEST_ASSERT_TRUE(ring.pop(value, gap));
+        TEST_ASSERT_EQUAL_UINT32(i * 3 + 1, value);
+    }
+    TEST_ASSERT_FALSE(ring.pop(value, gap));
+    TEST_ASSERT_EQUAL_UINT32(0, ring.getDrops());
+}
+
+void test_ring_overflow_flags_gap_on_next_edge(void) {
+    CaptureRing<4> ring;
+    uint32_t value;
+    bool gap;
+    for (uint32_t i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE(ring.push(i));
+    }
+    TEST_ASSERT_FALSE(ring.push(100));
+    TEST_ASSERT_FALSE(ring.push(101));
+    TEST_ASSERT_EQUAL_UINT32(2, ring.getDrops());
+    TEST_ASSERT_EQUAL(4, ring.size());
+
+    for (uint32_t i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE(ring.pop(value, gap));
+        TEST_ASSERT_EQUAL_UINT32(i, value);
+        TEST_ASSERT_FALSE(gap);
+    }
+    TEST_ASSERT_TRUE(ring.push(102));
+    TEST_ASSERT_TRUE(ring.push(103));
+    TEST_ASSERT_TRUE(ring.pop(value, gap));
+    TEST_ASSERT_EQUAL_UINT32(102, value);
+    TEST_ASSERT_TRUE(gap);                  // Edges were lost before this one
+    TEST_ASSERT_TRUE(ring.pop(value, gap));
+    TEST_ASSERT_FALSE(gap);
+}
+
+void test_ring_clear(void) {
+    CaptureRing<4> ring;
+    uint32_t value;
+    bool gap;
+    ring.push(1);
+    ring.push(2);
+    ring.clear();
+    TEST_ASSERT_EQUAL(0, ring.size());
+    TEST_ASSERT_FALSE(ring.pop(value, gap));
+    TEST_ASSERT_TRUE(ring.push(3));
+    TEST_ASSERT_TRUE(ring.pop(value, gap));
+    TEST_ASSERT_EQUAL_UINT32(3, value);
+}
+
+// ============================================================================
+// Reciprocal samples
+// ============================================================================
+
+void test_clean_trace_multi_period_samples(void) {
+    RPMFilter filter(CLOCK);
+    filter.setFilterType(RPMFilter::FILTER_NONE);
+    filter.setSamplePeriods(8);
+    replay(filter, 1000, TRACE_1KHZ, TRACE_1KHZ_LEN);
+
+    TEST_ASSERT_EQUAL(3, sampleCount);
+    for (size_t s = 0; s < 3; s++) {
+        double expected = CLOCK / meanPeriod(TRACE_1KHZ, s * 8, s * 8 + 8);
+        TEST_ASSERT_FLOAT_WITHIN(0.01, expected, samples[s]);
+    }
+    RPMFilter::Statistics stats = filter.getStatistics();
+    TEST_ASSERT_EQUAL_UINT32(TRACE_1KHZ_LEN + 1, stats.edges);
+    TEST_ASSERT_EQUAL_UINT32(3, stats.samples);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.outliers);
+}
+
+void test_timestamp_wrap(void) {
+    // Start so the counter wraps inside the first gate
+    RPMFilter wrapped(CLOCK);
+    RPMFilter reference(CLOCK);
+    wrapped.setFilterType(RPMFilter::FILTER_NONE);
+    reference.setFilterType(RPMFilter::FILTER_NONE);
+
+    replay(wrapped, 0xFFFFFFFFu - 200000, TRACE_1KHZ, TRACE_1KHZ_LEN);
+    size_t wrappedCount = sampleCount;
+    float wrappedSamples[8];
+    memcpy(wrappedSamples, samples, wrappedCount * sizeof(float));
+
+    sampleCount = 0;
+    replay(reference, 1000, TRACE_1KHZ, TRACE_1KHZ_LEN);
+
+    TEST_ASSERT_EQUAL(sampleCount, wrappedCount);
+    for (size_t s = 0; s < sampleCount; s++) {
+        TEST_ASSERT_EQUAL_FLOAT(samples[s], wrappedSamples[s]);
+    }
+}
+
+void test_gate_timeout_at_low_frequency(void) {
+    RPMFilter filter(CLOCK);
+    filter.setFilterType(RPMFilter::FILTER_NONE);
+    filter.setSamplePeriods(8);
+    filter.setMaxGateMs(50);                // 4,000,000 ticks < one 10 Hz period
+    replay(filter, 5, TRACE_10HZ, sizeof(TRACE_10HZ) / sizeof(TRACE_10HZ[0]));
+
+    // One sample per period instead of waiting for 8 periods (0.8 s)
+    TEST_ASSERT_EQUAL(6, sampleCount);
+    for (size_t s = 0; s < sampleCount; s++) {
+        TEST_ASSERT_FLOAT_WITHIN(0.001, (double)CLOCK / TRACE_10HZ[s], samples[s]);
+    }
+}
+
+void test_edge_divider(void) {
+    RPMFilter filter(CLOCK);
+    filter.setFilterType(RPMFilter::FILTER_NONE);
+    filter.setEdgeDivider(16);              // Capture prescaler: one timestamp per 16 periods
+    replay(filter, 0, TRACE_1KHZ, 8);
+    TEST_ASSERT_EQUAL(1, sampleCount);
+    TEST_ASSERT_FLOAT_WITHIN(0.2, 16.0 * CLOCK / meanPeriod(TRACE_1KHZ, 0, 8), samples[0]);
+}
+
+// ============================================================================
+// Glitches, missed edges, gaps
+// ============================================================================
+
+void test_glitch_edge_is_ignored(void) {
+    RPMFilter filter(CLOCK);
+    filter.setFilterType(RPMFilter::FILTER_NONE);
+    filter.setSamplePeriods(4);
+    filter.setOutlierTolerance(20);
+    replay(filter, 0, TRACE_GLITCH, sizeof(TRACE_GLITCH) / sizeof(TRACE_GLITCH[0]));
+
+    RPMFilter::Statistics stats = filter.getStatistics();
+    TEST_ASSERT_EQUAL_UINT32(1, stats.outliers);
+    // The glitch edge is skipped, the real edge after it closes a normal period
+    TEST_ASSERT_EQUAL(4, sampleCount);
+    for (size_t s = 0; s < sampleCount; s++) {
+        TEST_ASSERT_FLOAT_WITHIN(0.5, 1000.0, samples[s]);
+    }
+}
+
+void test_glitch_without_rejection_corrupts_sample(void) {
+    // Control case: with rejection disabled the glitch shows up in the raw samples
+    RPMFilter filter(CLOCK);
+    filter.setFilterType(RPMFilter::FILTER_NONE);
+    filter.setSamplePeriods(1);
+    replay(filter, 0, TRACE_GLITCH, sizeof(TRACE_GLITCH) / sizeof(TRACE_GLITCH[0]));
+    TEST_ASSERT_FLOAT_WITHIN(1.0, (double)CLOCK / 9200, samples[6]);
+}
+
+void test_missed_edge_restarts_gate(void) {
+    RPMFilter filter(CLOCK);
+    filter.setFilterType(RPMFilter::FILTER_NONE);
+    filter.setSamplePeriods(4);
+    filter.setOutlierTolerance(20);
+    replay(filter, 0, TRACE_MISSED, sizeof(TRACE_MISSED) / sizeof(TRACE_MISSED[0]));
+
+    TEST_ASSERT_EQUAL_UINT32(1, filter.getStatistics().outliers);
+    // No sample spans the merged period (it would read ~800 Hz)
+    TEST_ASSERT_EQUAL(3, sampleCount);
+    for (size_t s = 0; s < sampleCount; s++) {
+        TEST_ASSERT_FLOAT_WITHIN(0.5, 1000.0, samples[s]);
+    }
+}
+
+void test_mark_gap_discards_partial_gate(void) {
+    RPMFilter filter(CLOCK);
+    filter.setFilterType(RPMFilter::FILTER_NONE);
+    filter.setSamplePeriods(8);
+
+    uint32_t t = replay(filter, 0, TRACE_1KHZ, 5);     // Partial gate
+    filter.markGap();                                   // Ring overflow: edges lost
+    t += 3 * 80000 + 12345;                             // Next edge not on the old grid
+    replay(filter, t, TRACE_1KHZ, 8);
+
+    TEST_ASSERT_EQUAL(1, sampleCount);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, CLOCK / meanPeriod(TRACE_1KHZ, 0, 8), samples[0]);
+}
+
+void test_outlier_reference_relearns_after_speed_step(void) {
+    RPMFilter filter(CLOCK);
+    filter.setFilterType(RPMFilter::FILTER_NONE);
+    filter.setSamplePeriods(2);
+    filter.setOutlierTolerance(20);
+    replay(filter, 0, TRACE_STEP, sizeof(TRACE_STEP) / sizeof(TRACE_STEP[0]));
+
+    RPMFilter::Statistics stats = filter.getStatistics();
+    TEST_ASSERT_GREATER_THAN(0, stats.outliers);
+    TEST_ASSERT_LESS_OR_EQUAL(4, stats.outliers);       // Rejected only until relearned
+    TEST_ASSERT_FLOAT_WITHIN(1.0, 1500.0, filter.getRawFrequency());
+}
+
+// ============================================================================
+// Filters and statistics
+// ============================================================================
+
+static void feed(RPMFilter& filter, const float* values, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        filter.addSample(values[i]);
+    }
+}
+
+void test_filter_none(void) {
+    RPMFilter filter;
+    filter.setFilterType(RPMFilter::FILTER_NONE);
+    const float values[] = {1000, 1200, 900};
+    feed(filter, values, 3);
+    TEST_ASSERT_EQUAL_FLOAT(900, filter.getFrequency());
+}
+
+void test_filter_median_rejects_spike(void) {
+    RPMFilter filter;
+    filter.setFilterType(RPMFilter::FILTER_MEDIAN);
+    filter.setWindowSize(5);
+    const float values[] = {1000, 1001, 5000, 999, 1002};
+    feed(filter, values, 5);
+    TEST_ASSERT_EQUAL_FLOAT(1001, filter.getFrequency());
+
+    // Even window: mean of the two middle values
+    filter.setWindowSize(4);
+    const float even[] = {10, 40, 20, 30};
+    feed(filter, even, 4);
+    TEST_ASSERT_EQUAL_FLOAT(25, filter.getFrequency());
+}
+
+void test_filter_ema(void) {
+    RPMFilter filter;
+    filter.setFilterType(RPMFilter::FILTER_EMA);
+    filter.setEmaAlpha(0.5f);
+    const float values[] = {1000, 2000, 2000};
+    feed(filter, values, 1);
+    TEST_ASSERT_EQUAL_FLOAT(1000, filter.getFrequency());      // First sample seeds the average
+    feed(filter, values + 1, 2);
+    TEST_ASSERT_EQUAL_FLOAT(1750, filter.getFrequency());
+}
+
+void test_filter_window_mean(void) {
+    RPMFilter filter;
+    filter.setFilterType(RPMFilter::FILTER_WINDOW);
+    filter.setWindowSize(3);
+    const float values[] = {100, 200, 300, 400};
+    feed(filter, values, 2);
+    TEST_ASSERT_EQUAL_FLOAT(150, filter.getFrequency());       // Partial window
+    feed(filter, values + 2, 2);
+    TEST_ASSERT_EQUAL_FLOAT(300, filter.getFrequency());       // 200, 300, 400
+}
+
+void test_statistics(void) {
+    RPMFilter filter;
+    const float values[] = {2, 4, 4, 4, 5, 5, 7, 9};
+    feed(filter, values, 8);
+    RPMFilter::Statistics stats = filter.getStatistics();
+    TEST_ASSERT_EQUAL_UINT32(8, stats.samples);
+    TEST_ASSERT_EQUAL_FLOAT(2, stats.min);
+    TEST_ASSERT_EQUAL_FLOAT(9, stats.max);
+    TEST_ASSERT_EQUAL_FLOAT(5, stats.mean);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, 2.13809, stats.stddev);     // Sample standard deviation
+
+    filter.resetStatistics();
+    TEST_ASSERT_EQUAL_UINT32(0, filter.getStatistics().samples);
+}
+
+void test_configuration_limits(void) {
+    RPMFilter filter;
+    TEST_ASSERT_FALSE(filter.setWindowSize(0));
+    TEST_ASSERT_FALSE(filter.setWindowSize(RPMFilter::MAX_WINDOW + 1));
+    TEST_ASSERT_FALSE(filter.setEmaAlpha(0.0f));
+    TEST_ASSERT_FALSE(filter.setSamplePeriods(0));
+    TEST_ASSERT_FALSE(filter.setMaxGateMs(0));
+    TEST_ASSERT_FALSE(filter.setOutlierTolerance(2));
+    TEST_ASSERT_TRUE(filter.setOutlierTolerance(0));
+    TEST_ASSERT_FALSE(filter.setEdgeDivider(0));
+    TEST_ASSERT_FALSE(filter.setFilterType((RPMFilter::FilterType)7));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_ring_fifo_order_and_index_wrap);
+    RUN_TEST(test_ring_overflow_flags_gap_on_next_edge);
+    RUN_TEST(test_ring_clear);
+    RUN_TEST(test_clean_trace_multi_period_samples);
+    RUN_TEST(test_timestamp_wrap);
+    RUN_TEST(test_gate_timeout_at_low_frequency);
+    RUN_TEST(test_edge_divider);
+    RUN_TEST(test_glitch_edge_is_ignored);
+    RUN_TEST(test_glitch_without_rejection_corrupts_sample);
+    RUN_TEST(test_missed_edge_restarts_gate);
+    RUN_TEST(test_mark_gap_discards_partial_gate);
+    RUN_TEST(test_outlier_reference_relearns_after_speed_step);
+    RUN_TEST(test_filter_none);
+    RUN_TEST(test_filter_median_rejects_spike);
+    RUN_TEST(test_filter_ema);
+    RUN_TEST(test_filter_window_mean);
+    RUN_TEST(test_statistics);
+    RUN_TEST(test_configuration_limits);
+    return UNITY_END();
+}
@@ -0,0 +1,284 @@
+// Host tests for FrameAssembler (UART2 frame receiver), fed with byte
+// streams split at every byte boundary.
+// Run: pio test -e native -f test_uart2_framing
+
+#include <unity.h>
+#include <deque>
+#include <string>
+#include <vector>
+#include "FrameAssembler.h"
+
+// The UART driver's RX buffer: bounded, with the pattern detection's
+// delimiter positions recorded as bytes arrive (bytes that do not fit are
+// lost, like on a FIFO overflow)
+class SimInput : public FrameAssembler::Input {
+public:
+    SimInput(size_t capacity, uint8_t delimiter, bool patterns)
+        : capacity(capacity), delimiter(delimiter), patterns(patterns) {}
+
+    // Returns false if bytes were lost
+    bool receive(const uint8_t* data, size_t length) {
+        bool lost = false;
+        for (size_t i = 0; i < length; i++) {
+            if (bytes.size() >= capacity) {
+                lost = true;
+                continue;
+            }
+            if (patterns && data[i] == delimiter) {
+                positions.push_back(readIndex + bytes.size());
+            }
+            bytes.push_back(data[i]);
+        }
+        return !lost;
+    }
+
+    size_t buffered() override { return bytes.size(); }
+
+    int delimiterPosition() override {
+        return positions.empty() ? -1 : (int)(positions.front() - readIndex);
+    }
+
+    void popDelimiter() override { positions.pop_front(); }
+
+    size_t read(uint8_t* buffer, size_t length) override {
+        size_t n = length < bytes.size() ? length : bytes.size();
+        for (size_t i = 0; i < n; i++) {
+            buffer[i] = bytes.front();
+            bytes.pop_front();
+        }
+        readIndex += n;
+        // Positions read past without a pop (split frames) are consumed too
+        while (!positions.empty() && positions.front() < readIndex) {
+            positions.pop_front();
+        }
+        return n;
+    }
+
+private:
+    size_t capacity;
+    uint8_t delimiter;
+    bool patterns;
+    std::deque<uint8_t> bytes;
+    std::deque<size_t> positions;       // Absolute stream offsets
+    size_t readIndex = 0;
+};
+
+struct Frame {
+    std::string data;
+    uint8_t flags;
+
+    bool operator==(const Frame& other) const { return data == other.data && flags == other.flags; }
+};
+
+// The frame ring, optionally limited to a number of frames
+class SimOutput : public FrameAssembler::Output {
+public:
+    explicit SimOutput(size_t maxFrames = SIZE_MAX) : maxFrames(maxFrames) {}
+
+    uint8_t* acquire(size_t length) override {
+        if (frames.size() >= maxFrames) {
+            return nullptr;
+        }
+        slot.assign(length, 0);
+        return slot.data();
+    }
+
+    void complete(uint8_t* data, size_t length, uint8_t flags) override {
+        frames.push_back({std::string((const char*)data, length), flags});
+    }
+
+    size_t maxFrames;
+    std::vector<Frame> frames;
+
+private:
+    std::vector<uint8_t> slot;
+};
+
+// Large enough to hold each test stream as one chunk; overflow is tested
+// with a smaller buffer
+static const size_t RX_BUFFER = 256;
+static const size_t SPLIT = 32;
+
+struct Receiver {
+    FrameAssembler assembler;
+    SimInput input;
+    SimOutput output;
+
+    Receiver(FrameAssembler::Mode mode, uint8_t delimiter, size_t capacity = RX_BUFFER,
+             size_t maxFrames = SIZE_MAX)
+        : input(capacity, mode == FrameAssembler::MODE_LINE ? '\n' : delimiter,
+                mode != FrameAssembler::MODE_IDLE),
+          output(maxFrames) {
+        assembler.start(mode, delimiter, SPLIT);
+    }
+
+    // One driver RX event: data in, then collect as the receiver task does
+    void chunk(const std::string& data, bool idle = false) {
+        if (!input.receive((const uint8_t*)data.data(), data.size())) {
+            assembler.markLoss();
+        }
+        while (assembler.collectOne(input, output, idle)) {
+        }
+    }
+};
+
+static std::vector<Frame> receiveWhole(FrameAssembler::Mode mode, uint8_t delimiter, const std::string& stream) {
+    Receiver rx(mode, delimiter);
+    rx.chunk(stream, true);
+    return rx.output.frames;
+}
+
+// Every split into two chunks, then one byte per chunk, must give the same frames
+static void checkEverySplit(FrameAssembler::Mode mode, uint8_t delimiter, const std::string& stream,
+                            const std::vector<Frame>& expected) {
+    char message[64];
+    for (size_t cut = 0; cut <= stream.size(); cut++) {
+        Receiver rx(mode, delimiter);
+        rx.chunk(stream.substr(0, cut));
+        rx.chunk(stream.substr(cut), true);
+        snprintf(message, sizeof(message), "split at byte %u", (unsigned)cut);
+        TEST_ASSERT_EQUAL_MESSAGE(expected.size(), rx.output.frames.size(), message);
+        TEST_ASSERT_TRUE_MESSAGE(rx.output.frames == expected, message);
+    }
+
+    Receiver rx(mode, delimiter);
+    for (size_t i = 0; i < stream.size(); i++) {
+        rx.chunk(stream.substr(i, 1), i + 1 == stream.size());
+    }
+    TEST_ASSERT_TRUE_MESSAGE(rx.output.frames == expected, "byte by byte");
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_lines_at_every_split() {
+    // LF and CRLF lines, empty lines, a lone '\r' kept inside a line
+    std::string stream = "hello\r\nworld\n\n\r\nab\rcd\nlast";
+    std::vector<Frame> expected = {
+        {"hello", 0}, {"world", 0}, {"", 0}, {"", 0}, {"ab\rcd", 0},
+    };
+    TEST_ASSERT_TRUE(receiveWhole(FrameAssembler::MODE_LINE, '\n', stream) == expected);
+    checkEverySplit(FrameAssembler::MODE_LINE, '\n', stream, expected);
+}
+
+void test_delimiter_at_every_split() {
+    // Custom delimiter; '\r' is data outside MODE_LINE
+    std::string stream = std::string("A1\r\x03") + "B22\x03" + "\x03" + "C\n333\x03" + "tail";
+    std::vector<Frame> expected = {
+        {"A1\r", 0}, {"B22", 0}, {"", 0}, {"C\n333", 0},
+    };
+    checkEverySplit(FrameAssembler::MODE_DELIMITER, 0x03, stream, expected);
+}
+
+void test_long_lines_split_at_every_split() {
+    // Exactly SPLIT - 1 bytes fits with its delimiter; SPLIT bytes is cut
+    // before the delimiter, which then ends an empty frame; a '\r' at the
+    // cut stays in the split frame
+    std::string fits(SPLIT - 1, 'a');
+    std::string full(SPLIT, 'b');
+    std::string crAtCut = std::string(SPLIT - 1, 'c') + "\r";
+    std::string twice(2 * SPLIT + 5, 'd');
+    std::string stream = fits + "\n" + full + "\n" + crAtCut + "\n" + twice + "\r\n" + "ok\n";
+    std::vector<Frame> expected = {
+        {fits, 0},
+        {full, FrameAssembler::FLAG_SPLIT}, {"", 0},
+        {crAtCut, FrameAssembler::FLAG_SPLIT}, {"", 0},
+        {std::string(SPLIT, 'd'), FrameAssembler::FLAG_SPLIT},
+        {std::string(SPLIT, 'd'), FrameAssembler::FLAG_SPLIT},
+        {std::string(5, 'd'), 0},
+        {"ok", 0},
+    };
+    checkEverySplit(FrameAssembler::MODE_LINE, '\n', stream, expected);
+
+    Receiver rx(FrameAssembler::MODE_LINE, '\n');
+    rx.chunk(stream);
+    TEST_ASSERT_EQUAL_UINT32(4, rx.assembler.getStatistics().splitFrames);
+    TEST_ASSERT_EQUAL_UINT32(expected.size(), rx.assembler.getStatistics().frames);
+
+    // SPLIT bytes without a delimiter are cut at once, not held for more
+    Receiver held(FrameAssembler::MODE_LINE, '\n');
+    held.chunk(std::string(SPLIT, 'e'));
+    TEST_ASSERT_EQUAL(1, held.output.frames.size());
+    TEST_ASSERT_EQUAL(0, held.input.buffered());
+}
+
+void test_idle_frames_at_every_split() {
+    // Only the idle gap at the end closes a frame; longer bursts are split
+    std::string stream = std::string(SPLIT + 7, 'x') + "\n\r\x03";
+    std::vector<Frame> expected = {
+        {std::string(SPLIT, 'x'), FrameAssembler::FLAG_SPLIT},
+        {std::string(7, 'x') + "\n\r\x03", 0},
+    };
+    checkEverySplit(FrameAssembler::MODE_IDLE, 0, stream, expected);
+
+    // Each idle gap ends one frame
+    Receiver rx(FrameAssembler::MODE_IDLE, 0);
+    rx.chunk("first", true);
+    rx.chunk("sec");
+    rx.chunk("ond", true);
+    rx.chunk("", true);
+    std::vector<Frame> gaps = {{"first", 0}, {"second", 0}};
+    TEST_ASSERT_TRUE(rx.output.frames == gaps);
+}
+
+void test_rx_overflow_marks_loss() {
+    // A burst larger than the RX buffer: bytes past it are lost, the next
+    // frame is marked, frames after it are clean
+    Receiver rx(FrameAssembler::MODE_LINE, '\n', 16);
+    rx.chunk("0123456789\n0123456789\n");
+    rx.chunk("next\n");
+    rx.chunk("clean\n");
+
+    // 16 bytes fit: "0123456789\n" and "01234"; the rest and its '\n' are lost
+    std::vector<Frame> expected = {
+        {"0123456789", FrameAssembler::FLAG_LOSS},
+        {"01234next", 0},
+        {"clean", 0},
+    };
+    TEST_ASSERT_EQUAL(expected.size(), rx.output.frames.size());
+    TEST_ASSERT_TRUE(rx.output.frames == expected);
+}
+
+void test_ring_full_drops_and_marks_loss() {
+    Receiver rx(FrameAssembler::MODE_LINE, '\n', RX_BUFFER, 2);
+    rx.chunk("one\ntwo\nthree\nfour\n");
+    TEST_ASSERT_EQUAL(2, rx.output.frames.size());
+    TEST_ASSERT_EQUAL_UINT32(2, rx.assembler.getStatistics().droppedFrames);
+    TEST_ASSERT_EQUAL_UINT32(6 + 5, rx.assembler.getStatistics().droppedBytes);     // "three\n", "four\n"
+    TEST_ASSERT_EQUAL(0, rx.input.buffered());         // Dropped bytes left the RX buffer
+
+    // Room again: the next frame carries the loss, the one after is clean
+    rx.output.maxFrames = SIZE_MAX;
+    rx.chunk("five\nsix\n");
+    TEST_ASSERT_EQUAL(4, rx.output.frames.size());
+    TEST_ASSERT_TRUE((rx.output.frames[2] == Frame{"five", FrameAssembler::FLAG_LOSS}));
+    TEST_ASSERT_TRUE((rx.output.frames[3] == Frame{"six", 0}));
+}
+
+void test_start_resets_state() {
+    Receiver rx(FrameAssembler::MODE_DELIMITER, ';');
+    rx.assembler.markLoss();
+    rx.chunk("a;");
+    TEST_ASSERT_EQUAL_UINT8(FrameAssembler::FLAG_LOSS, rx.output.frames[0].flags);
+
+    rx.assembler.markLoss();
+    rx.assembler.start(FrameAssembler::MODE_LINE, ';', SPLIT);
+    TEST_ASSERT_EQUAL_UINT8('\n', rx.assembler.getDelimiter());   // MODE_LINE ignores the argument
+    TEST_ASSERT_EQUAL_UINT32(0, rx.assembler.getStatistics().frames);
+
+    Receiver off(FrameAssembler::MODE_OFF, '\n');
+    off.chunk("x\n", true);
+    TEST_ASSERT_EQUAL(0, off.output.frames.size());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_lines_at_every_split);
+    RUN_TEST(test_delimiter_at_every_split);
+    RUN_TEST(test_long_lines_split_at_every_split);
+    RUN_TEST(test_idle_frames_at_every_split);
+    RUN_TEST(test_rx_overflow_marks_loss);
+    RUN_TEST(test_ring_full_drops_and_marks_loss);
+    RUN_TEST(test_start_resets_state);
+    return UNITY_END();
+}